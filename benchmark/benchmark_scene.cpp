@@ -0,0 +1,288 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file benchmark_scene.cpp
+ */
+
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include <dbot/depth_stream.h>
+#include <dbot/simple_wavefront_object_loader.h>
+
+#include "benchmark_scene.h"
+
+namespace dbot
+{
+namespace
+{
+// radius of the sphere and distance of the wall behind it in m
+const double sphere_radius = 0.05;
+const double wall_depth = 1.0;
+
+// distance of neighbouring spheres in m
+const double part_distance = 0.12;
+
+/**
+ * \brief Writes a sphere made by subdividing an octahedron as a Wavefront
+ *        file, the triangles are oriented outwards
+ */
+void write_sphere(const std::string& path, int subdivisions)
+{
+    std::vector<Eigen::Vector3d> vertices = {Eigen::Vector3d(1, 0, 0),
+                                             Eigen::Vector3d(-1, 0, 0),
+                                             Eigen::Vector3d(0, 1, 0),
+                                             Eigen::Vector3d(0, -1, 0),
+                                             Eigen::Vector3d(0, 0, 1),
+                                             Eigen::Vector3d(0, 0, -1)};
+    std::vector<std::vector<int>> triangles = {{0, 2, 4},
+                                               {2, 1, 4},
+                                               {1, 3, 4},
+                                               {3, 0, 4},
+                                               {2, 0, 5},
+                                               {1, 2, 5},
+                                               {3, 1, 5},
+                                               {0, 3, 5}};
+
+    for (int i = 0; i < subdivisions; i++)
+    {
+        std::map<std::pair<int, int>, int> midpoints;
+        auto midpoint = [&](int a, int b) {
+            const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+            const auto it = midpoints.find(key);
+            if (it != midpoints.end()) return it->second;
+            vertices.push_back((vertices[a] + vertices[b]).normalized());
+            midpoints[key] = vertices.size() - 1;
+            return int(vertices.size() - 1);
+        };
+
+        std::vector<std::vector<int>> finer;
+        for (const std::vector<int>& t : triangles)
+        {
+            const int ab = midpoint(t[0], t[1]);
+            const int bc = midpoint(t[1], t[2]);
+            const int ca = midpoint(t[2], t[0]);
+            finer.push_back({t[0], ab, ca});
+            finer.push_back({ab, t[1], bc});
+            finer.push_back({ca, bc, t[2]});
+            finer.push_back({ab, bc, ca});
+        }
+        triangles.swap(finer);
+    }
+
+    std::ofstream file(path.c_str());
+    for (const Eigen::Vector3d& vertex : vertices)
+    {
+        const Eigen::Vector3d v = sphere_radius * vertex;
+        file << "v " << v(0) << " " << v(1) << " " << v(2) << "\n";
+    }
+    for (const std::vector<int>& t : triangles)
+    {
+        file << "f " << t[0] + 1 << " " << t[1] + 1 << " " << t[2] + 1
+             << "\n";
+    }
+}
+
+/**
+ * \brief Depth image of the state in front of the wall, such that every
+ *        pixel is valid
+ */
+Eigen::MatrixXd render(RigidBodyRenderer& renderer,
+                       const BenchmarkScene::State& state,
+                       const Eigen::Matrix3d& camera_matrix,
+                       int n_rows,
+                       int n_cols)
+{
+    std::vector<float> depth;
+    renderer.Render(BenchmarkScene::affines(state),
+                    camera_matrix,
+                    n_rows,
+                    n_cols,
+                    depth);
+
+    Eigen::MatrixXd depth_image(n_rows, n_cols);
+    for (int row = 0; row < n_rows; row++)
+    {
+        for (int col = 0; col < n_cols; col++)
+        {
+            const float value = depth[row * n_cols + col];
+            depth_image(row, col) = std::isinf(value) ? wall_depth : value;
+        }
+    }
+    return depth_image;
+}
+}
+
+BenchmarkScene::BenchmarkScene(int downsampling_factor,
+                               int subdivisions,
+                               int part_count)
+{
+    // the package name is the last component of the package path
+    const boost::filesystem::path package =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("dbot_benchmark_%%%%%%%%");
+    boost::filesystem::create_directories(package / "meshes");
+    package_path_ = package.string();
+    write_sphere((package / "meshes" / "sphere.obj").string(), subdivisions);
+
+    ori_ = ObjectResourceIdentifier(
+        package_path_,
+        "meshes",
+        std::vector<std::string>(part_count, "sphere.obj"));
+    object_model_ = std::make_shared<ObjectModel>(
+        std::shared_ptr<ObjectModelLoader>(
+            new SimpleWavefrontObjectModelLoader(ori_, false)),
+        true);
+
+    auto provider = std::make_shared<VirtualCameraDataProvider>(
+        downsampling_factor, "/benchmark_camera");
+    camera_data_ = std::make_shared<CameraData>(provider);
+    const int n_rows = camera_data_->resolution().height;
+    const int n_cols = camera_data_->resolution().width;
+
+    pose_ = pose(0);
+
+    RigidBodyRenderer renderer(object_model_->mesh_levels());
+    const Eigen::MatrixXd depth_image = render(
+        renderer, pose_, camera_data_->camera_matrix(), n_rows, n_cols);
+    provider->set_depth_image(depth_image);
+    observation_ = camera_data_->depth_image_vector();
+}
+
+auto BenchmarkScene::pose(int frame) const -> State
+{
+    const int part_count = object_model_->count_parts();
+    const double time = frame / 30.0;
+
+    // a slow Lissajous path of a few cm, the same for all parts
+    const Eigen::Vector3d offset(0.03 * std::sin(2 * M_PI * 0.5 * time),
+                                 0.02 * std::sin(2 * M_PI * 0.3 * time),
+                                 0.04 * std::sin(2 * M_PI * 0.2 * time));
+
+    State state(part_count);
+    for (int part = 0; part < part_count; part++)
+    {
+        const double shift = part_distance * (part - (part_count - 1) / 2.0);
+        state.component(part).position() =
+            Eigen::Vector3d(0.02 + shift, -0.01, 0.7) + offset;
+        state.component(part).orientation().angle_axis(
+            0.3, Eigen::Vector3d(1, 1, 0).normalized());
+    }
+    return state;
+}
+
+bool BenchmarkScene::record(const std::string& path, int frame_count) const
+{
+    VirtualCameraDataProvider provider(1, "/benchmark_camera");
+    const CameraData::Resolution resolution = provider.native_resolution();
+
+    DepthStreamWriter writer(path,
+                             provider.camera_matrix(),
+                             resolution,
+                             provider.frame_id(),
+                             object_model_->count_parts());
+
+    RigidBodyRenderer renderer(object_model_->mesh_levels());
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        const State state = pose(frame);
+        DepthStream::Poses poses;
+        for (int part = 0; part < state.count(); part++)
+        {
+            poses.push_back(state.component(part).affine().cast<double>());
+        }
+        if (!writer.add_frame(frame / 30.0,
+                              render(renderer,
+                                     state,
+                                     provider.camera_matrix(),
+                                     resolution.height,
+                                     resolution.width),
+                              poses))
+        {
+            return false;
+        }
+    }
+    return writer.close();
+}
+
+BenchmarkScene::~BenchmarkScene()
+{
+    boost::system::error_code error;
+    boost::filesystem::remove_all(package_path_, error);
+}
+
+auto BenchmarkScene::affines(const State& state)
+    -> std::vector<RigidBodyRenderer::Affine>
+{
+    std::vector<RigidBodyRenderer::Affine> poses;
+    for (int part = 0; part < state.count(); part++)
+    {
+        poses.push_back(state.component(part).affine());
+    }
+    return poses;
+}
+
+auto BenchmarkScene::deltas(int count,
+                            double linear_sigma,
+                            double angular_sigma) const
+    -> std::vector<State>
+{
+    // a fixed seed keeps the work of the runs comparable
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal;
+
+    std::vector<State> deltas(count, State(object_model_->count_parts()));
+    for (State& delta : deltas)
+    {
+        for (int part = 0; part < delta.count(); part++)
+        {
+            Eigen::Vector3d position;
+            Eigen::Vector3d rotation;
+            for (int i = 0; i < 3; i++)
+            {
+                position(i) = linear_sigma * normal(generator);
+                rotation(i) = angular_sigma * normal(generator);
+            }
+            delta.component(part).position() = position;
+            if (rotation.norm() > 0)
+            {
+                delta.component(part).orientation().angle_axis(
+                    rotation.norm(), rotation.normalized());
+            }
+        }
+    }
+    return deltas;
+}
+
+auto BenchmarkScene::sensor_parameters(int sample_count, bool use_gpu)
+    -> RbSensorBuilder<State>::Parameters
+{
+    RbSensorBuilder<State>::Parameters params;
+    params.use_gpu = use_gpu;
+    params.occlusion.p_occluded_visible = 0.1;
+    params.occlusion.p_occluded_occluded = 0.7;
+    params.occlusion.initial_occlusion_prob = 0.1;
+    params.kinect.tail_weight = 0.01;
+    params.kinect.model_sigma = 0.003;
+    params.kinect.sigma_factor = 0.00142478;
+    params.delta_time = 0.033;
+    params.sample_count = sample_count;
+    params.use_custom_shaders = false;
+    return params;
+}
+}
@@ -0,0 +1,128 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file benchmark_scene.h
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/builder/rb_sensor_builder.h>
+#include <dbot/camera_data.h>
+#include <dbot/object_model.h>
+#include <dbot/object_resource_identifier.h>
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/rigid_body_renderer.h>
+#include <dbot/virtual_camera_data_provider.h>
+
+namespace dbot
+{
+/**
+ * \brief Synthetic scene of the benchmarks: sphere meshes side by side in
+ *        front of a wall, seen by a VirtualCameraDataProvider.
+ *
+ * The mesh is written as a Wavefront file into a temporary package, such
+ * that the loaders and builders can be used as in a real setup. The depth
+ * image of the provider is a rendering of the sphere in its true pose.
+ */
+class BenchmarkScene
+{
+public:
+    typedef FreeFloatingRigidBodiesState<> State;
+
+public:
+    /**
+     * \param downsampling_factor  of the 640 x 480 camera
+     * \param subdivisions         of the octahedron the sphere is created
+     *                             from, it has 8 * 4^subdivisions triangles
+     * \param part_count           number of spheres, each one a part of
+     *                             the object
+     */
+    BenchmarkScene(int downsampling_factor,
+                   int subdivisions = 4,
+                   int part_count = 1);
+
+    /**
+     * \brief Removes the temporary package
+     */
+    ~BenchmarkScene();
+
+    const ObjectResourceIdentifier& ori() const { return ori_; }
+    std::string mesh_path() const { return ori_.mesh_path(0); }
+
+    const std::shared_ptr<ObjectModel>& object_model() const
+    {
+        return object_model_;
+    }
+
+    const std::shared_ptr<CameraData>& camera_data() const
+    {
+        return camera_data_;
+    }
+
+    /** \brief The pose the observation is rendered in */
+    const State& pose() const { return pose_; }
+
+    /**
+     * \brief The pose of the moving parts at the given frame of a
+     *        recording, the true pose at frame 0
+     */
+    State pose(int frame) const;
+
+    /** \brief Depth image of the provider as a column vector */
+    const Eigen::VectorXd& observation() const { return observation_; }
+
+    /**
+     * \brief Random deviations from the true pose, as scored by the
+     *        sensors, with the given standard deviations in m and rad
+     */
+    std::vector<State> deltas(int count,
+                              double linear_sigma = 0.005,
+                              double angular_sigma = 0.02) const;
+
+    /**
+     * \brief Records frame_count frames of the parts moving along pose(frame)
+     *        at 30 Hz in front of the wall as a DepthStream of the full 640 x
+     *        480 resolution, with the poses as ground truth. Returns false
+     *        if the stream cannot be written.
+     */
+    bool record(const std::string& path, int frame_count) const;
+
+    /**
+     * \brief Poses of the parts of the state as rendered by the
+     *        RigidBodyRenderer
+     */
+    static std::vector<RigidBodyRenderer::Affine> affines(const State& state);
+
+    /**
+     * \brief Parameters of the Kinect image model as used by the trackers
+     */
+    static RbSensorBuilder<State>::Parameters sensor_parameters(
+        int sample_count,
+        bool use_gpu);
+
+private:
+    std::string package_path_;
+    ObjectResourceIdentifier ori_;
+    std::shared_ptr<ObjectModel> object_model_;
+    std::shared_ptr<CameraData> camera_data_;
+    State pose_;
+    Eigen::VectorXd observation_;
+};
+}
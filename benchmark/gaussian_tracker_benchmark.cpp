@@ -0,0 +1,71 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gaussian_tracker_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dbot/builder/gaussian_tracker_builder.h>
+
+#include "benchmark_scene.h"
+
+/**
+ * Arguments: downsampling factor
+ */
+static void GaussianTracker_on_track(benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(state.range(0));
+
+    dbot::GaussianTrackerBuilder::Parameters params;
+    params.ori = scene.ori();
+    params.ut_alpha = 1.2;
+    params.moving_average_update_rate = 0;
+    params.center_object_frame = true;
+
+    params.observation.bg_depth = 7.0;
+    params.observation.fg_noise_std = 0.001;
+    params.observation.bg_noise_std = 0.5;
+    params.observation.tail_weight = 0.01;
+    params.observation.uniform_tail_min = 0.0;
+    params.observation.uniform_tail_max = 7.0;
+    params.observation.sensors = scene.camera_data()->pixels();
+
+    auto& transition = params.object_transition;
+    transition.linear_sigma_x = 0.002;
+    transition.linear_sigma_y = 0.002;
+    transition.linear_sigma_z = 0.002;
+    transition.angular_sigma_x = 0.01;
+    transition.angular_sigma_y = 0.01;
+    transition.angular_sigma_z = 0.01;
+    transition.velocity_factor = 0.8;
+    transition.part_count = scene.object_model()->count_parts();
+
+    auto tracker =
+        dbot::GaussianTrackerBuilder(params, scene.camera_data()).build();
+    tracker->initialize(std::vector<dbot::GaussianTracker::State>(
+        1, scene.pose()));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(tracker->on_track(scene.observation()));
+    }
+    state.SetItemsProcessed(state.iterations() * params.observation.sensors);
+}
+BENCHMARK(GaussianTracker_on_track)
+    ->ArgNames({"downsampling"})
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,231 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file helper_functions_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <dbot/helper_functions.h>
+
+namespace
+{
+/**
+ * The previous vector implementations, which the in place ones are compared
+ * with
+ */
+namespace previous
+{
+template <typename T>
+void LinearlyInterpolate(std::vector<T>& data)
+{
+    std::vector<int> limits;
+    limits.push_back(0);
+    limits.push_back(data.size() - 1);
+    std::vector<int> step_direction;
+    step_direction.push_back(1);
+    step_direction.push_back(-1);
+
+    for (int i = 0; i < 2; i++)
+    {
+        int index_first_real = dbot::hf::IndexNextReal(
+            data, limits[i] - step_direction[i], step_direction[i]);
+        int index_next_real =
+            dbot::hf::IndexNextReal(data, index_first_real, step_direction[i]);
+        if (index_next_real >= int(data.size()) || index_next_real < 0) return;
+
+        double slope = double(data[index_next_real] - data[index_first_real]) /
+                       double(index_next_real - index_first_real);
+
+        for (int j = limits[i]; j != index_first_real; j += step_direction[i])
+            data[j] = data[index_first_real] + (j - index_first_real) * slope;
+    }
+
+    int index_current_real = dbot::hf::IndexNextReal(
+        data, limits[0] - step_direction[0], step_direction[0]);
+    int index_next_real =
+        dbot::hf::IndexNextReal(data, index_current_real, step_direction[0]);
+
+    while (index_next_real < int(data.size()))
+    {
+        double slope =
+            double(data[index_next_real] - data[index_current_real]) /
+            double(index_next_real - index_current_real);
+
+        for (int i = index_current_real + 1; i < index_next_real; i++)
+            data[i] =
+                data[index_current_real] + (i - index_current_real) * slope;
+
+        index_current_real = index_next_real;
+        index_next_real =
+            dbot::hf::IndexNextReal(data, index_next_real, step_direction[0]);
+    }
+}
+
+template <typename T>
+std::vector<int> SortAscend(const std::vector<T>& values)
+{
+    std::vector<int> indices(values.size());
+
+    std::vector<dbot::hf::ValueIndex<T>> values_indices(values.size());
+    for (int i = 0; i < int(values.size()); i++)
+    {
+        values_indices[i].index = i;
+        values_indices[i].value = values[i];
+    }
+
+    std::sort(values_indices.begin(), values_indices.end());
+
+    for (int i = 0; i < int(indices.size()); i++)
+        indices[i] = values_indices[i].index;
+
+    return indices;
+}
+}
+
+/**
+ * \brief A depth row of a VGA frame on a tilted plane, with holes of the
+ *        given length at a tenth of the pixels
+ */
+std::vector<float> depth_row(int hole_length)
+{
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<int> start(0, 639);
+
+    std::vector<float> row(640);
+    for (int i = 0; i < int(row.size()); i++) row[i] = 0.8f + 0.001f * i;
+    for (int hole = 0; hole < 64 / hole_length; hole++)
+    {
+        const int begin = start(generator);
+        for (int i = begin; i < std::min(begin + hole_length, 640); i++)
+        {
+            row[i] = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    return row;
+}
+
+std::vector<double> weights(int count)
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> weight(0, 1);
+    std::vector<double> weights(count);
+    for (auto& w : weights) w = weight(generator);
+    return weights;
+}
+}
+
+/**
+ * Hole filling of a depth row, the previous implementation and the
+ * vectorized in place one
+ *
+ * Arguments: hole length in pixels
+ */
+static void LinearlyInterpolate_Previous(benchmark::State& state)
+{
+    const std::vector<float> row = depth_row(state.range(0));
+    std::vector<float> data;
+    for (auto _ : state)
+    {
+        data = row;
+        previous::LinearlyInterpolate(data);
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetItemsProcessed(state.iterations() * row.size());
+}
+BENCHMARK(LinearlyInterpolate_Previous)
+    ->ArgNames({"hole"})
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32);
+
+static void LinearlyInterpolate_InPlace(benchmark::State& state)
+{
+    const std::vector<float> row = depth_row(state.range(0));
+    std::vector<float> data;
+    for (auto _ : state)
+    {
+        data = row;
+        dbot::hf::LinearlyInterpolate(data.data(), int(data.size()));
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetItemsProcessed(state.iterations() * row.size());
+}
+BENCHMARK(LinearlyInterpolate_InPlace)
+    ->ArgNames({"hole"})
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32);
+
+/**
+ * Particle indices sorted by their weights
+ *
+ * Arguments: particles
+ */
+static void SortAscend_ValueIndex(benchmark::State& state)
+{
+    const std::vector<double> values = weights(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(previous::SortAscend(values));
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(SortAscend_ValueIndex)->ArgNames({"particles"})->Arg(100)->Arg(10000);
+
+static void SortAscend_InPlace(benchmark::State& state)
+{
+    const std::vector<double> values = weights(state.range(0));
+    std::vector<int> indices(values.size());
+    for (auto _ : state)
+    {
+        dbot::hf::SortAscend(values.data(), int(values.size()), indices.data());
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(SortAscend_InPlace)->ArgNames({"particles"})->Arg(100)->Arg(10000);
+
+/**
+ * Normalization of the particle weights
+ *
+ * Arguments: particles
+ */
+static void SetSum_Copy(benchmark::State& state)
+{
+    const std::vector<double> values = weights(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(dbot::hf::SetSum(values, 1.));
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(SetSum_Copy)->ArgNames({"particles"})->Arg(100)->Arg(10000);
+
+static void SetSum_InPlace(benchmark::State& state)
+{
+    std::vector<double> values = weights(state.range(0));
+    for (auto _ : state)
+    {
+        dbot::hf::SetSum(values.data(), int(values.size()), 1.);
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(SetSum_InPlace)->ArgNames({"particles"})->Arg(100)->Arg(10000);
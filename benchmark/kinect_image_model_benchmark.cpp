@@ -0,0 +1,84 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file kinect_image_model_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dbot/builder/rb_sensor_builder.h>
+
+#include "benchmark_scene.h"
+
+namespace
+{
+typedef dbot::BenchmarkScene::State State;
+typedef dbot::RbSensor<State> Sensor;
+
+/**
+ * Arguments: number of particles, downsampling factor
+ */
+void loglikes(benchmark::State& state, bool use_gpu)
+{
+    const int particles = state.range(0);
+    dbot::BenchmarkScene scene(state.range(1));
+    dbot::RbSensorBuilder<State> builder(
+        scene.object_model(),
+        scene.camera_data(),
+        dbot::BenchmarkScene::sensor_parameters(particles, use_gpu));
+    std::shared_ptr<Sensor> sensor = builder.build();
+    sensor->set_observation(scene.observation());
+
+    const std::vector<State> deltas = scene.deltas(particles);
+    Sensor::StateArray deviations(particles);
+    for (int i = 0; i < particles; i++) deviations[i] = deltas[i];
+    Sensor::IntArray indices = Sensor::IntArray::Zero(particles);
+
+    Sensor::RealArray log_likelihoods;
+    for (auto _ : state)
+    {
+        sensor->compute_loglikes(deviations, indices, false, log_likelihoods);
+        benchmark::DoNotOptimize(log_likelihoods.data());
+    }
+    state.SetItemsProcessed(state.iterations() * particles);
+}
+
+void particle_and_resolution_args(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"particles", "downsampling"});
+    for (int downsampling : {2, 4, 8})
+    {
+        for (int particles : {100, 400, 1600})
+        {
+            benchmark->Args({particles, downsampling});
+        }
+    }
+}
+}
+
+static void KinectImageModel_loglikes(benchmark::State& state)
+{
+    loglikes(state, false);
+}
+BENCHMARK(KinectImageModel_loglikes)->Apply(particle_and_resolution_args);
+
+#ifdef DBOT_BUILD_GPU
+static void KinectImageModelGPU_loglikes(benchmark::State& state)
+{
+    loglikes(state, true);
+}
+BENCHMARK(KinectImageModelGPU_loglikes)
+    ->Apply(particle_and_resolution_args)
+    ->UseRealTime();
+#endif
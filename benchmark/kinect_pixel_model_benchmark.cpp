@@ -0,0 +1,175 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file kinect_pixel_model_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <dbot/model/kinect_pixel_model.h>
+
+namespace
+{
+/**
+ * The previous scalar loop of BatchLogLikelihoodRatio(), which the Eigen
+ * array blocks are compared with, for the default parameters
+ */
+namespace previous
+{
+double BatchLogLikelihoodRatio(const int count,
+                               const float* predictions,
+                               const float* observations,
+                               const float* occlusions,
+                               float* posterior_occlusions,
+                               float* terms)
+{
+    const float lambda = -std::log(0.5f);
+    const float tail = 0.01f / 6.0f;
+    const float body = 0.99f;
+    const float model_sigma = 0.003f;
+    const float sigma_factor = 0.00142478f;
+    const float one_div_sqrt_of_two = 1. / std::sqrt(2.);
+    const float one_div_sqrt_of_two_pi = 1. / std::sqrt(2 * M_PI);
+
+    for (int i = 0; i < count; i++)
+    {
+        const float observation = observations[i];
+        const float prediction = predictions[i];
+        const float occlusion = occlusions[i];
+
+        const float sigma =
+            model_sigma + sigma_factor * observation * observation;
+        const float sigma_sq = sigma * sigma;
+        const float pred_minus_obs = prediction - observation;
+
+        const float p_visible =
+            tail +
+            body * std::exp(-pred_minus_obs * pred_minus_obs /
+                            (2 * sigma_sq)) *
+                one_div_sqrt_of_two_pi / sigma;
+
+        const float p_occluded =
+            tail +
+            body * lambda *
+                std::exp(0.5f * lambda *
+                         (2 * pred_minus_obs + lambda * sigma_sq)) *
+                (1 + std::erf((pred_minus_obs + lambda * sigma_sq) *
+                              one_div_sqrt_of_two / sigma)) /
+                (2 * (std::exp(prediction * lambda) - 1));
+
+        const float p_infinite =
+            tail +
+            body * lambda *
+                std::exp(0.5f * lambda *
+                         (-2 * observation + lambda * sigma_sq));
+
+        const float p_obsIpred_vis = p_visible * (1 - occlusion);
+        const float p_obsIpred_occl = p_occluded * occlusion;
+        const float p_obsIpred = p_obsIpred_vis + p_obsIpred_occl;
+
+        terms[i] = std::log(p_obsIpred / p_infinite);
+        posterior_occlusions[i] = p_obsIpred_occl / p_obsIpred;
+    }
+
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += terms[i];
+    }
+    return sum;
+}
+}
+
+/**
+ * \brief Pixels of a rendering close to the observed surface
+ */
+struct Pixels
+{
+    explicit Pixels(int count)
+        : predictions(count),
+          observations(count),
+          occlusions(count),
+          posterior_occlusions(count),
+          terms(count)
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> depth(0.5f, 2.0f);
+        std::uniform_real_distribution<float> offset(-0.02f, 0.02f);
+        std::uniform_real_distribution<float> occlusion(0.0f, 0.5f);
+        for (int i = 0; i < count; i++)
+        {
+            observations[i] = depth(generator);
+            predictions[i] = observations[i] + offset(generator);
+            occlusions[i] = occlusion(generator);
+        }
+    }
+
+    std::vector<float> predictions;
+    std::vector<float> observations;
+    std::vector<float> occlusions;
+    std::vector<float> posterior_occlusions;
+    std::vector<float> terms;
+};
+}
+
+/**
+ * Scoring of the visible pixels of one particle, the previous scalar loop
+ * and the Eigen array blocks
+ *
+ * Arguments: number of pixels
+ */
+static void BatchLogLikelihoodRatio_Previous(benchmark::State& state)
+{
+    Pixels pixels(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(previous::BatchLogLikelihoodRatio(
+            pixels.terms.size(),
+            pixels.predictions.data(),
+            pixels.observations.data(),
+            pixels.occlusions.data(),
+            pixels.posterior_occlusions.data(),
+            pixels.terms.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BatchLogLikelihoodRatio_Previous)
+    ->ArgNames({"pixels"})
+    ->Arg(100)
+    ->Arg(4096);
+
+static void BatchLogLikelihoodRatio_Array(benchmark::State& state)
+{
+    const dbot::KinectPixelModel model;
+    Pixels pixels(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            model.BatchLogLikelihoodRatio(pixels.terms.size(),
+                                          pixels.predictions.data(),
+                                          pixels.observations.data(),
+                                          pixels.occlusions.data(),
+                                          pixels.posterior_occlusions.data(),
+                                          pixels.terms.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BatchLogLikelihoodRatio_Array)
+    ->ArgNames({"pixels"})
+    ->Arg(100)
+    ->Arg(4096);
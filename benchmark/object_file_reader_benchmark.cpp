@@ -0,0 +1,44 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file object_file_reader_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dbot/object_file_reader.h>
+
+#include "benchmark_scene.h"
+
+/**
+ * Arguments: subdivisions of the sphere, 8 * 4^subdivisions triangles
+ */
+static void ObjectFileReader_Read(benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(8, state.range(0));
+
+    for (auto _ : state)
+    {
+        dbot::ObjectFileReader reader;
+        reader.set_filename(scene.mesh_path());
+        reader.Read();
+        benchmark::DoNotOptimize(reader.get_vertices());
+    }
+}
+BENCHMARK(ObjectFileReader_Read)
+    ->ArgNames({"subdivisions"})
+    ->Arg(3)
+    ->Arg(5)
+    ->Arg(7)
+    ->Unit(benchmark::kMillisecond);
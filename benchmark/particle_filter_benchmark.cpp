@@ -0,0 +1,119 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_filter_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dbot/builder/particle_tracker_builder.h>
+
+#include "benchmark_scene.h"
+
+namespace
+{
+typedef dbot::ParticleTrackerBuilder<dbot::ParticleTracker> Builder;
+typedef Builder::Filter Filter;
+
+/**
+ * \brief Filter of the particle tracker, initialized like
+ *        ParticleTracker::on_initialize() does
+ */
+std::shared_ptr<Filter> create_filter(const dbot::BenchmarkScene& scene,
+                                      int evaluation_count)
+{
+    dbot::ObjectTransitionBuilder<Builder::State>::Parameters transition;
+    transition.linear_sigma_x = 0.002;
+    transition.linear_sigma_y = 0.002;
+    transition.linear_sigma_z = 0.002;
+    transition.angular_sigma_x = 0.01;
+    transition.angular_sigma_y = 0.01;
+    transition.angular_sigma_z = 0.01;
+    transition.velocity_factor = 0.8;
+    transition.part_count = scene.object_model()->count_parts();
+
+    Builder::Parameters params;
+    params.evaluation_count = evaluation_count;
+    params.moving_average_update_rate = 0;
+    params.max_kl_divergence = 2.0;
+    params.center_object_frame = true;
+
+    Builder builder(
+        std::make_shared<dbot::ObjectTransitionBuilder<Builder::State>>(
+            transition),
+        std::make_shared<Builder::SensorBuilder>(
+            scene.object_model(),
+            scene.camera_data(),
+            dbot::BenchmarkScene::sensor_parameters(evaluation_count,
+                                                    false)),
+        scene.object_model(),
+        params);
+
+    auto filter =
+        builder.create_filter(scene.object_model(), params.max_kl_divergence);
+    filter->set_particles(std::vector<Builder::State>(1, scene.pose()));
+    filter->resample(evaluation_count / filter->sampling_blocks().size());
+
+    const Builder::State delta_mean = filter->belief().mean();
+    for (size_t i = 0; i < filter->belief().size(); i++)
+    {
+        filter->belief().location(i).subtract(delta_mean);
+    }
+    filter->sensor()->integrated_poses().apply_delta(delta_mean);
+    return filter;
+}
+}
+
+/**
+ * Arguments: number of evaluations, downsampling factor
+ */
+static void RaoBlackwellCoordinateParticleFilter_filter(
+    benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(state.range(1));
+    auto filter = create_filter(scene, state.range(0));
+    const Builder::Input input = Builder::Input::Zero(1);
+
+    for (auto _ : state)
+    {
+        filter->filter(scene.observation(), input);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(RaoBlackwellCoordinateParticleFilter_filter)
+    ->ArgNames({"evaluations", "downsampling"})
+    ->Args({200, 4})
+    ->Args({800, 4})
+    ->Args({800, 2});
+
+/**
+ * Arguments: number of particles
+ */
+static void RaoBlackwellCoordinateParticleFilter_resample(
+    benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(8);
+    auto filter = create_filter(scene, state.range(0));
+
+    for (auto _ : state)
+    {
+        filter->resample(state.range(0));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(RaoBlackwellCoordinateParticleFilter_resample)
+    ->ArgNames({"particles"})
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
@@ -0,0 +1,210 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/pose/pose_cache.h>
+#include <dbot/pose/pose_composition.h>
+#include <dbot/pose/pose_hashing.h>
+
+namespace
+{
+typedef dbot::FreeFloatingRigidBodiesState<> State;
+
+/** particles as deltas of small rotations around the mean */
+std::vector<State> particles(int count)
+{
+    srand(1);
+    std::vector<State> states(count, State(1));
+    for (auto& state : states)
+    {
+        state.component(0).position() = 0.01 * Eigen::Vector3d::Random();
+        state.component(0).orientation() = 0.05 * Eigen::Vector3d::Random();
+    }
+    return states;
+}
+
+/**
+ * unscented sigma points of consecutive frames of a slowly moving object,
+ * as generated by the Gaussian tracker
+ */
+std::vector<dbot::PoseVector> sigma_points(int frames)
+{
+    std::mt19937 generator(1);
+    std::normal_distribution<double> normal;
+
+    dbot::PoseVector mean;
+    mean << 0, 0, 0.8, 0, 0, 0;
+    dbot::PoseVector deviations;
+    deviations << 1e-3, 1e-3, 1e-3, 1e-2, 1e-2, 1e-2;
+    const double scale = std::sqrt(double(mean.size()) + 1.);
+
+    std::vector<dbot::PoseVector> points;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (int i = 0; i < mean.size(); i++)
+        {
+            mean(i) += 0.2 * deviations(i) * normal(generator);
+        }
+        points.push_back(mean);
+        for (int i = 0; i < mean.size(); i++)
+        {
+            dbot::PoseVector point = mean;
+            point(i) += scale * deviations(i);
+            points.push_back(point);
+            point(i) -= 2 * scale * deviations(i);
+            points.push_back(point);
+        }
+    }
+    return points;
+}
+}
+
+static void EulerVector_Quaternion(benchmark::State& state)
+{
+    const dbot::EulerVector euler = 0.1 * Eigen::Vector3d::Random();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(euler.quaternion());
+    }
+}
+BENCHMARK(EulerVector_Quaternion);
+
+static void EulerVector_RotationMatrix(benchmark::State& state)
+{
+    const dbot::EulerVector euler = 0.1 * Eigen::Vector3d::Random();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(euler.rotation_matrix());
+    }
+}
+BENCHMARK(EulerVector_RotationMatrix);
+
+static void EulerVector_Product(benchmark::State& state)
+{
+    dbot::EulerVector a = 0.1 * Eigen::Vector3d::Random();
+    const dbot::EulerVector b = 0.1 * Eigen::Vector3d::Random();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(a * b);
+    }
+}
+BENCHMARK(EulerVector_Product);
+
+/**
+ * The particles are made relative to their mean after every filter step,
+ * per state or with the conversions of the mean cached.
+ *
+ * Arguments: particles
+ */
+static void Pose_Subtract(benchmark::State& state)
+{
+    std::vector<State> states = particles(state.range(0));
+    const State mean = states[0];
+    for (auto _ : state)
+    {
+        for (auto& particle : states) particle.subtract(mean);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * states.size());
+}
+BENCHMARK(Pose_Subtract)->ArgNames({"particles"})->Arg(100)->Arg(1000);
+
+static void Pose_SubtractCached(benchmark::State& state)
+{
+    std::vector<State> states = particles(state.range(0));
+    dbot::PoseCache cache;
+    cache.set(states[0]);
+    for (auto _ : state)
+    {
+        for (auto& particle : states) cache.subtract_from(particle);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * states.size());
+}
+BENCHMARK(Pose_SubtractCached)->ArgNames({"particles"})->Arg(100)->Arg(1000);
+
+/**
+ * Poses of the particles for the renderer, the deltas applied to the
+ * default pose
+ *
+ * Arguments: particles
+ */
+static void Pose_Compose(benchmark::State& state)
+{
+    const std::vector<State> states = particles(state.range(0));
+    dbot::PoseComposition composition;
+    composition.base_poses(particles(1)[0]);
+
+    std::vector<float> matrices(states.size() * 16);
+    for (auto _ : state)
+    {
+        composition.compose(states, 0, states.size(), matrices.data());
+        benchmark::DoNotOptimize(matrices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * states.size());
+}
+BENCHMARK(Pose_Compose)->ArgNames({"particles"})->Arg(100)->Arg(1000);
+
+/**
+ * Lookups of the sigma points of the Gaussian tracker in a set of quantized
+ * poses. The counters report the full hash collisions among the distinct
+ * points and the rate of points sharing their bucket, next to the rate of
+ * ideal uniform hashing.
+ *
+ * Arguments: frames
+ */
+static void PoseHash_SigmaPointLookup(benchmark::State& state)
+{
+    typedef dbot::PoseVector Pose;
+    typedef std::
+        unordered_set<Pose, dbot::PoseHash<Pose>, dbot::PoseEqual<Pose>>
+            PoseSet;
+
+    const std::vector<Pose> points = sigma_points(state.range(0));
+    const PoseSet set(points.begin(), points.end());
+
+    std::unordered_map<std::size_t, int> hashes;
+    for (const Pose& point : set) hashes[set.hash_function()(point)]++;
+
+    int shared = 0;
+    for (size_t bucket = 0; bucket < set.bucket_count(); bucket++)
+    {
+        if (set.bucket_size(bucket) > 1) shared += set.bucket_size(bucket);
+    }
+    const double load = double(set.size()) / set.bucket_count();
+
+    for (auto _ : state)
+    {
+        int found = 0;
+        for (const Pose& point : points) found += int(set.count(point));
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+    state.counters["distinct_points"] = set.size();
+    state.counters["hash_collisions"] = set.size() - hashes.size();
+    state.counters["shared_bucket_rate"] = double(shared) / set.size();
+    state.counters["uniform_shared_bucket_rate"] = 1. - std::exp(-load);
+}
+BENCHMARK(PoseHash_SigmaPointLookup)->ArgNames({"frames"})->Arg(2000);
@@ -0,0 +1,85 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file rigid_body_renderer_benchmark.cpp
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dbot/rigid_body_renderer.h>
+
+#include "benchmark_scene.h"
+
+/**
+ * Arguments: downsampling factor, sphere subdivisions
+ */
+static void RigidBodyRenderer_Render(benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(state.range(0), state.range(1));
+    dbot::RigidBodyRenderer renderer(scene.object_model()->mesh_levels());
+    const auto poses = dbot::BenchmarkScene::affines(scene.pose());
+
+    std::vector<float> depth_image;
+    for (auto _ : state)
+    {
+        renderer.Render(poses,
+                        scene.camera_data()->camera_matrix(),
+                        scene.camera_data()->resolution().height,
+                        scene.camera_data()->resolution().width,
+                        depth_image);
+        benchmark::DoNotOptimize(depth_image.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RigidBodyRenderer_Render)
+    ->ArgNames({"downsampling", "subdivisions"})
+    ->Args({1, 4})
+    ->Args({2, 4})
+    ->Args({4, 4})
+    ->Args({8, 4})
+    ->Args({4, 6});
+
+/**
+ * Arguments: downsampling factor, number of pose hypotheses
+ */
+static void RigidBodyRenderer_RenderSparse(benchmark::State& state)
+{
+    dbot::BenchmarkScene scene(state.range(0));
+    dbot::RigidBodyRenderer renderer(scene.object_model()->mesh_levels());
+
+    std::vector<std::vector<dbot::RigidBodyRenderer::Affine>> poses;
+    for (const auto& delta : scene.deltas(state.range(1)))
+    {
+        auto pose = scene.pose();
+        pose.apply_delta(delta);
+        poses.push_back(dbot::BenchmarkScene::affines(pose));
+    }
+
+    dbot::SparseDepthImages images;
+    for (auto _ : state)
+    {
+        renderer.RenderSparse(poses,
+                              scene.camera_data()->camera_matrix(),
+                              scene.camera_data()->resolution().height,
+                              scene.camera_data()->resolution().width,
+                              images);
+        benchmark::DoNotOptimize(images.depths.data());
+    }
+    state.SetItemsProcessed(state.iterations() * poses.size());
+}
+BENCHMARK(RigidBodyRenderer_RenderSparse)
+    ->ArgNames({"downsampling", "poses"})
+    ->Args({4, 100})
+    ->Args({4, 1000})
+    ->Args({2, 1000});
@@ -0,0 +1,567 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file scaling_benchmark.cpp
+ *
+ * Scaling matrix of the full tracking loop: Tracker::track of the particle
+ * tracker on recorded sequences across particle counts, resolutions, part
+ * counts, CPU thread counts and the CPU and CUDA backends of
+ * RbSensorBuilder. Every cell tracks the whole sequence per iteration and
+ * reports the frames per second next to the mean error of the estimates
+ * with respect to the recorded ground truth.
+ *
+ * Besides the flags of Google Benchmark, e.g. --benchmark_filter and
+ * --benchmark_out for the JSON results, it takes
+ *
+ *   --scaling_frames=N         frames of the synthetic sequences, 30
+ *   --scaling_sequence=PATH    DepthStream to track instead of the
+ *                              synthetic sequences of moving spheres
+ *   --scaling_mesh=PATH        Wavefront mesh of every part of that stream
+ *   --scaling_results=PATH     writes the results as CSV
+ *   --scaling_baseline=PATH    results of an earlier run to compare with
+ *   --scaling_tolerance=F      relative drop of the frames per second which
+ *                              is a regression, 0.1
+ *   --scaling_accuracy_tolerance=MM
+ *                              increase of the mean translation error in mm
+ *                              which is a regression, 0.5
+ *
+ * The run fails if any cell regressed with respect to the baseline. The
+ * rotation error is reported but not compared, the orientation of the
+ * synthetic spheres cannot be observed.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <dbot/builder/particle_tracker_builder.h>
+#include <dbot/depth_stream.h>
+#include <dbot/recorded_camera_data_provider.h>
+#include <dbot/simple_wavefront_object_loader.h>
+
+#include "benchmark_scene.h"
+
+namespace
+{
+typedef dbot::ParticleTrackerBuilder<dbot::ParticleTracker> Builder;
+typedef dbot::Tracker::State State;
+
+/**
+ * \brief Recorded sequence and the meshes of its parts
+ */
+struct Recording
+{
+    std::string path;
+    dbot::ObjectResourceIdentifier ori;
+    int part_count;
+
+    /** recorded resolution */
+    int width;
+    int height;
+};
+
+/**
+ * \brief Configuration of a cell of the scaling matrix
+ */
+struct Cell
+{
+    bool use_gpu;
+    int particle_count;
+    int downsampling_factor;
+    int thread_count;
+
+    std::string name(const Recording& recording) const
+    {
+        std::ostringstream name;
+        name << "ParticleTracker_track/" << (use_gpu ? "gpu" : "cpu")
+             << "/particles:" << particle_count
+             << "/resolution:" << recording.width / downsampling_factor
+             << "x" << recording.height / downsampling_factor
+             << "/parts:" << recording.part_count
+             << "/threads:" << thread_count;
+        return name.str();
+    }
+};
+
+/**
+ * \brief Frames per second and accuracy of a cell
+ */
+struct Result
+{
+    double frames_per_second;
+    double translation_error_mm;
+    double rotation_error_deg;
+};
+
+std::string flag_value(const char* argument, const char* name)
+{
+    const std::string prefix = std::string("--") + name + "=";
+    if (std::strncmp(argument, prefix.c_str(), prefix.size()) != 0)
+    {
+        return std::string();
+    }
+    return argument + prefix.size();
+}
+
+State ground_truth(const dbot::DepthStream::Poses& poses)
+{
+    State state(poses.size());
+    for (std::size_t i = 0; i < poses.size(); i++)
+    {
+        state.component(i).affine(poses[i].cast<fl::Real>());
+    }
+    return state;
+}
+
+/**
+ * \brief Particle tracker of the cell, configured like the particle filter
+ *        benchmark but without averaging, such that the estimates are the
+ *        ones of the filter
+ */
+std::shared_ptr<dbot::Tracker> create_tracker(
+    const Recording& recording,
+    const std::shared_ptr<dbot::CameraData>& camera_data,
+    const Cell& cell)
+{
+    auto object_model = std::make_shared<dbot::ObjectModel>(
+        std::shared_ptr<dbot::ObjectModelLoader>(
+            new dbot::SimpleWavefrontObjectModelLoader(recording.ori, false)),
+        true);
+
+    dbot::ObjectTransitionBuilder<Builder::State>::Parameters transition;
+    transition.linear_sigma_x = 0.002;
+    transition.linear_sigma_y = 0.002;
+    transition.linear_sigma_z = 0.002;
+    transition.angular_sigma_x = 0.01;
+    transition.angular_sigma_y = 0.01;
+    transition.angular_sigma_z = 0.01;
+    transition.velocity_factor = 0.8;
+    transition.part_count = object_model->count_parts();
+
+    auto sensor = dbot::BenchmarkScene::sensor_parameters(
+        cell.particle_count, cell.use_gpu);
+    sensor.thread_count = cell.thread_count;
+
+    Builder::Parameters params;
+    params.evaluation_count = cell.particle_count;
+    params.moving_average_update_rate = 1;
+    params.max_kl_divergence = 2.0;
+    params.center_object_frame = true;
+    params.thread_count = cell.thread_count;
+
+    return Builder(
+               std::make_shared<
+                   dbot::ObjectTransitionBuilder<Builder::State>>(
+                   transition),
+               std::make_shared<Builder::SensorBuilder>(
+                   object_model, camera_data, sensor),
+               object_model,
+               params)
+        .build();
+}
+
+/**
+ * \brief Tracks all frames of the recording per iteration, starting from
+ *        the ground truth of the first frame. Decoding the frames and
+ *        scoring the estimates is not timed.
+ */
+void track(benchmark::State& state,
+           const Recording& recording,
+           const Cell& cell)
+{
+    auto stream = std::make_shared<dbot::DepthStream>();
+    if (!stream->open(recording.path) || stream->frame_count() == 0)
+    {
+        state.SkipWithError("the sequence cannot be opened");
+        return;
+    }
+
+    auto provider = std::make_shared<dbot::RecordedCameraDataProvider>(
+        stream,
+        cell.downsampling_factor,
+        dbot::RecordedCameraDataProvider::Playback::MaximumSpeed,
+        true);
+    auto camera_data = std::make_shared<dbot::CameraData>(provider);
+    auto tracker = create_tracker(recording, camera_data, cell);
+
+    double translation_error = 0;
+    double rotation_error = 0;
+    std::size_t error_count = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        tracker->initialize({ground_truth(provider->ground_truth())});
+        state.ResumeTiming();
+
+        for (std::size_t frame = 0; frame < stream->frame_count(); frame++)
+        {
+            const State estimate =
+                tracker->track(camera_data->depth_image_view());
+
+            state.PauseTiming();
+            const dbot::DepthStream::Poses truth = provider->ground_truth();
+            for (std::size_t i = 0; i < truth.size(); i++)
+            {
+                const Eigen::Affine3d pose =
+                    estimate.component(i).affine().cast<double>();
+                translation_error +=
+                    (pose.translation() - truth[i].translation()).norm();
+                rotation_error +=
+                    Eigen::AngleAxisd(pose.rotation().transpose() *
+                                      truth[i].rotation())
+                        .angle();
+                error_count++;
+            }
+            provider->next_frame();
+            state.ResumeTiming();
+        }
+    }
+
+    const double frame_count = state.iterations() * stream->frame_count();
+    state.SetItemsProcessed(frame_count);
+    state.counters["frames_per_second"] =
+        benchmark::Counter(frame_count, benchmark::Counter::kIsRate);
+    state.counters["translation_error_mm"] =
+        error_count > 0 ? 1000 * translation_error / error_count : 0;
+    state.counters["rotation_error_deg"] =
+        error_count > 0 ? 180 / M_PI * rotation_error / error_count : 0;
+}
+
+/**
+ * \brief Particle counts from 100 to 10k, resolutions from 80 x 60 to
+ *        640 x 480 and, on the CPU, thread counts up to the number of
+ *        hardware threads
+ */
+std::vector<Cell> matrix()
+{
+    std::vector<int> thread_counts;
+    const int hardware_threads =
+        std::max(1, int(std::thread::hardware_concurrency()));
+    for (int threads = 1; threads < hardware_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(hardware_threads);
+
+    std::vector<bool> backends(1, false);
+#ifdef DBOT_BUILD_GPU
+    backends.push_back(true);
+#endif
+
+    std::vector<Cell> cells;
+    for (bool use_gpu : backends)
+    {
+        for (int particles : {100, 1000, 10000})
+        {
+            for (int downsampling : {8, 4, 2, 1})
+            {
+                for (int threads : thread_counts)
+                {
+                    // the GPU backend evaluates on the device
+                    if (use_gpu && threads > 1) break;
+                    cells.push_back(
+                        {use_gpu, particles, downsampling, threads});
+                }
+            }
+        }
+    }
+    return cells;
+}
+
+/**
+ * \brief Keeps the results of all cells while reporting them as usual
+ */
+class ResultReporter : public benchmark::ConsoleReporter
+{
+public:
+    void ReportRuns(const std::vector<Run>& runs) override
+    {
+        for (const Run& run : runs)
+        {
+            if (run.error_occurred || run.run_type != Run::RT_Iteration)
+            {
+                continue;
+            }
+            Result& result = results[run.benchmark_name()];
+            result.frames_per_second = counter(run, "frames_per_second");
+            result.translation_error_mm =
+                counter(run, "translation_error_mm");
+            result.rotation_error_deg = counter(run, "rotation_error_deg");
+        }
+        ConsoleReporter::ReportRuns(runs);
+    }
+
+    std::map<std::string, Result> results;
+
+private:
+    static double counter(const Run& run, const std::string& name)
+    {
+        const auto it = run.counters.find(name);
+        return it != run.counters.end() ? double(it->second) : 0;
+    }
+};
+
+bool write_results(const std::string& path,
+                   const std::map<std::string, Result>& results)
+{
+    std::ofstream file(path.c_str());
+    file << "name,frames_per_second,translation_error_mm,rotation_error_deg\n";
+    for (const auto& entry : results)
+    {
+        file << entry.first << "," << entry.second.frames_per_second << ","
+             << entry.second.translation_error_mm << ","
+             << entry.second.rotation_error_deg << "\n";
+    }
+    return bool(file);
+}
+
+bool read_results(const std::string& path,
+                  std::map<std::string, Result>& results)
+{
+    std::ifstream file(path.c_str());
+    std::string line;
+    if (!std::getline(file, line)) return false;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        Result result;
+        char comma;
+        if (std::getline(fields, name, ',') &&
+            fields >> result.frames_per_second >> comma >>
+                result.translation_error_mm >> comma >>
+                result.rotation_error_deg)
+        {
+            results[name] = result;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Prints the cells which are slower or less accurate than in the
+ *        baseline and returns their number
+ */
+int count_regressions(const std::map<std::string, Result>& results,
+                      const std::map<std::string, Result>& baseline,
+                      double tolerance,
+                      double accuracy_tolerance)
+{
+    int regressions = 0;
+    for (const auto& entry : results)
+    {
+        const auto it = baseline.find(entry.first);
+        if (it == baseline.end()) continue;
+
+        const Result& now = entry.second;
+        const Result& before = it->second;
+        if (now.frames_per_second < (1 - tolerance) * before.frames_per_second)
+        {
+            std::cout << "REGRESSION: " << entry.first << " tracks "
+                      << now.frames_per_second << " frames per second, "
+                      << before.frames_per_second << " in the baseline"
+                      << std::endl;
+            regressions++;
+        }
+        if (now.translation_error_mm >
+            before.translation_error_mm + accuracy_tolerance)
+        {
+            std::cout << "REGRESSION: " << entry.first
+                      << " has a mean error of " << now.translation_error_mm
+                      << " mm, " << before.translation_error_mm
+                      << " mm in the baseline"
+                      << std::endl;
+            regressions++;
+        }
+    }
+    return regressions;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int frame_count = 30;
+    std::string sequence;
+    std::string mesh;
+    std::string results_path;
+    std::string baseline_path;
+    double tolerance = 0.1;
+    double accuracy_tolerance = 0.5;
+
+    // the own flags are removed before Google Benchmark parses the others
+    int remaining = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string value;
+        if (!(value = flag_value(argv[i], "scaling_frames")).empty())
+        {
+            frame_count = std::atoi(value.c_str());
+        }
+        else if (!(value = flag_value(argv[i], "scaling_sequence")).empty())
+        {
+            sequence = value;
+        }
+        else if (!(value = flag_value(argv[i], "scaling_mesh")).empty())
+        {
+            mesh = value;
+        }
+        else if (!(value = flag_value(argv[i], "scaling_results")).empty())
+        {
+            results_path = value;
+        }
+        else if (!(value = flag_value(argv[i], "scaling_baseline")).empty())
+        {
+            baseline_path = value;
+        }
+        else if (!(value = flag_value(argv[i], "scaling_tolerance")).empty())
+        {
+            tolerance = std::atof(value.c_str());
+        }
+        else if (!(value = flag_value(argv[i], "scaling_accuracy_tolerance"))
+                      .empty())
+        {
+            accuracy_tolerance = std::atof(value.c_str());
+        }
+        else
+        {
+            argv[remaining++] = argv[i];
+        }
+    }
+    argc = remaining;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    std::map<std::string, Result> baseline;
+    if (!baseline_path.empty() && !read_results(baseline_path, baseline))
+    {
+        std::cout << "ERROR: cannot read the baseline " << baseline_path
+                  << std::endl;
+        return 1;
+    }
+
+    // the scenes own the meshes of the synthetic recordings
+    std::vector<std::unique_ptr<dbot::BenchmarkScene>> scenes;
+    std::vector<Recording> recordings;
+    if (!sequence.empty())
+    {
+        dbot::DepthStream stream;
+        if (!stream.open(sequence) || mesh.empty())
+        {
+            std::cout << "ERROR: tracking " << sequence
+                      << " needs the stream and the mesh of its parts"
+                      << std::endl;
+            return 1;
+        }
+        const boost::filesystem::path mesh_path(mesh);
+        Recording recording;
+        recording.path = sequence;
+        recording.part_count = stream.part_count();
+        recording.width = stream.resolution().width;
+        recording.height = stream.resolution().height;
+        recording.ori = dbot::ObjectResourceIdentifier(
+            mesh_path.parent_path().string(),
+            "",
+            std::vector<std::string>(stream.part_count(),
+                                     mesh_path.filename().string()));
+        recordings.push_back(recording);
+    }
+    else
+    {
+        const std::vector<int> part_counts =
+            dbot::Tracker::BodyCount == Eigen::Dynamic
+                ? std::vector<int>({1, 2})
+                : std::vector<int>(1, int(dbot::Tracker::BodyCount));
+        for (int parts : part_counts)
+        {
+            scenes.emplace_back(new dbot::BenchmarkScene(8, 4, parts));
+            Recording recording;
+            recording.path =
+                (boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("dbot_scaling_%%%%%%%%"))
+                    .string();
+            recording.ori = scenes.back()->ori();
+            recording.part_count = parts;
+            recording.width = 640;
+            recording.height = 480;
+            if (!scenes.back()->record(recording.path, frame_count))
+            {
+                std::cout << "ERROR: cannot record " << recording.path
+                          << std::endl;
+                return 1;
+            }
+            recordings.push_back(recording);
+        }
+    }
+
+    const std::vector<Cell> cells = matrix();
+    for (const Recording& recording : recordings)
+    {
+        for (const Cell& cell : cells)
+        {
+            benchmark::RegisterBenchmark(
+                cell.name(recording).c_str(),
+                [recording, cell](benchmark::State& state) {
+                    track(state, recording, cell);
+                })
+                ->Unit(benchmark::kMillisecond)
+                ->UseRealTime();
+        }
+    }
+
+    ResultReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    if (sequence.empty())
+    {
+        for (const Recording& recording : recordings)
+        {
+            boost::system::error_code error;
+            boost::filesystem::remove(recording.path, error);
+        }
+    }
+
+    if (!results_path.empty() && !write_results(results_path, reporter.results))
+    {
+        std::cout << "ERROR: cannot write the results " << results_path
+                  << std::endl;
+        return 1;
+    }
+
+    if (!baseline.empty())
+    {
+        const int regressions = count_regressions(
+            reporter.results, baseline, tolerance, accuracy_tolerance);
+        std::cout << regressions << " regressions with respect to "
+                  << baseline_path << std::endl;
+        if (regressions > 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+
+find_package(benchmark REQUIRED)
+
+add_executable(dbot_benchmarks
+    benchmark/benchmark_scene.cpp
+    benchmark/rigid_body_renderer_benchmark.cpp
+    benchmark/kinect_image_model_benchmark.cpp
+    benchmark/kinect_pixel_model_benchmark.cpp
+    benchmark/particle_filter_benchmark.cpp
+    benchmark/gaussian_tracker_benchmark.cpp
+    benchmark/object_file_reader_benchmark.cpp
+    benchmark/pose_benchmark.cpp
+    benchmark/helper_functions_benchmark.cpp)
+
+target_link_libraries(dbot_benchmarks
+    benchmark::benchmark
+    benchmark::benchmark_main
+    ${dbot_LIBRARIES}
+    ${Boost_LIBRARIES})
+
+# scaling matrix of the tracking loop, with its own main for the baseline
+# comparison
+add_executable(dbot_scaling_benchmark
+    benchmark/benchmark_scene.cpp
+    benchmark/scaling_benchmark.cpp)
+
+target_link_libraries(dbot_scaling_benchmark
+    benchmark::benchmark
+    ${dbot_LIBRARIES}
+    ${Boost_LIBRARIES})
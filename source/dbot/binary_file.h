@@ -0,0 +1,52 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file binary_file.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+
+namespace dbot
+{
+/**
+ * \brief Number of bytes from the current position of the file to its end.
+ *        The position is kept.
+ */
+inline std::uint64_t remaining_size(std::istream& file)
+{
+    const std::streampos position = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streampos end = file.tellg();
+    file.seekg(position);
+    return end > position ? std::uint64_t(end - position) : 0;
+}
+
+/**
+ * \brief Product of a count read from a file and an element size, which
+ *        is only computed if it does not exceed the limit, e.g. the size of
+ *        the file. Returns false otherwise, before the product can wrap.
+ */
+inline bool bounded_product(std::uint64_t count,
+                            std::uint64_t size,
+                            std::uint64_t limit,
+                            std::uint64_t& product)
+{
+    if (size != 0 && count > limit / size) return false;
+    product = count * size;
+    return product <= limit;
+}
+}
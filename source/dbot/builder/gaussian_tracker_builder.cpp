@@ -22,8 +22,14 @@
  */
 
 #include <dbot/builder/gaussian_tracker_builder.h>
+#include <dbot/builder/rb_sensor_builder.h>
+#include <dbot/default_shader_provider.h>
 #include <dbot/simple_wavefront_object_loader.h>
 
+#ifdef DBOT_BUILD_GPU
+#include <dbot/gpu/gaussian_image_model_gpu.h>
+#endif
+
 namespace dbot
 {
 GaussianTrackerBuilder::GaussianTrackerBuilder(
@@ -45,6 +51,17 @@ std::shared_ptr<GaussianTracker> GaussianTrackerBuilder::build()
                                           param_.moving_average_update_rate,
                                           param_.center_object_frame);
 
+    // the filter only predicts, the GPU or CPU sensor updates
+    if (param_.use_gpu)
+    {
+        tracker->set_gpu_sensor(create_gpu_sensor(object_model));
+    }
+    else if (param_.update_threads > 0)
+    {
+        tracker->set_cpu_sensor(create_cpu_sensor(object_model));
+    }
+    tracker->set_pixel_selection(create_pixel_selection(object_model));
+
     return tracker;
 }
 
@@ -98,6 +115,90 @@ auto GaussianTrackerBuilder::create_sensor(
     return Sensor(body_tail_pixel_model, camera_data->pixels());
 }
 
+auto GaussianTrackerBuilder::create_gpu_sensor(
+    const std::shared_ptr<ObjectModel>& object_model) const
+    -> std::shared_ptr<GaussianTracker::GpuSensor>
+{
+#ifdef DBOT_BUILD_GPU
+    GlContext::Parameters gl_context;
+    gl_context.device = param_.gpu_device;
+    if (!GlContext::parse_backend(param_.gpu_gl_backend, gl_context.backend))
+    {
+        std::cout << "Unknown OpenGL backend " << param_.gpu_gl_backend
+                  << std::endl;
+        exit(-1);
+    }
+
+    const SigmaPointMoments::Parameters moments = moment_parameters();
+
+    return std::make_shared<GaussianTracker::GpuSensor>(
+        camera_data_->camera_matrix(),
+        camera_data_->resolution().height,
+        camera_data_->resolution().width,
+        object_model->vertices(),
+        object_model->triangle_indices(),
+        std::make_shared<DefaultShaderProvider>(),
+        moments,
+        param_.ut_alpha,
+        gl_context);
+#else
+    throw NoGpuSupportException();
+#endif
+}
+
+auto GaussianTrackerBuilder::create_cpu_sensor(
+    const std::shared_ptr<ObjectModel>& object_model) const
+    -> std::shared_ptr<GaussianTracker::CpuSensor>
+{
+    return std::make_shared<GaussianTracker::CpuSensor>(
+        create_renderer(object_model),
+        moment_parameters(),
+        param_.ut_alpha,
+        param_.update_threads);
+}
+
+SigmaPointMoments::Parameters GaussianTrackerBuilder::moment_parameters()
+    const
+{
+    SigmaPointMoments::Parameters moments;
+    moments.bg_depth = param_.observation.bg_depth;
+    moments.fg_noise_std = param_.observation.fg_noise_std;
+    moments.bg_noise_std = param_.observation.bg_noise_std;
+    moments.tail_weight = param_.observation.tail_weight;
+    moments.uniform_tail_min = param_.observation.uniform_tail_min;
+    moments.uniform_tail_max = param_.observation.uniform_tail_max;
+    return moments;
+}
+
+auto GaussianTrackerBuilder::create_pixel_selection(
+    const std::shared_ptr<ObjectModel>& object_model) const
+    -> std::shared_ptr<PixelSelection>
+{
+    PixelSelection::Parameters selection;
+    if (!PixelSelection::parse_selection(param_.pixel_selection,
+                                         selection.selection))
+    {
+        std::cout << "Unknown pixel selection " << param_.pixel_selection
+                  << std::endl;
+        exit(-1);
+    }
+    if (selection.selection == PixelSelection::Selection::all)
+    {
+        return std::shared_ptr<PixelSelection>();
+    }
+
+    selection.margin = param_.pixel_selection_margin;
+    selection.fraction = param_.pixel_selection_fraction;
+    selection.seed = param_.pixel_selection_seed;
+
+    return std::make_shared<PixelSelection>(
+        camera_data_->camera_matrix(),
+        camera_data_->resolution().height,
+        camera_data_->resolution().width,
+        bounding_box_corners(object_model->vertices()),
+        selection);
+}
+
 std::shared_ptr<ObjectModel> GaussianTrackerBuilder::create_object_model(
     const ObjectResourceIdentifier& ori) const
 {
@@ -123,8 +224,7 @@ std::shared_ptr<RigidBodyRenderer> GaussianTrackerBuilder::create_renderer(
     const std::shared_ptr<ObjectModel>& object_model) const
 {
     std::shared_ptr<RigidBodyRenderer> renderer(
-        new RigidBodyRenderer(object_model->vertices(),
-                              object_model->triangle_indices(),
+        new RigidBodyRenderer(object_model->mesh_levels(),
                               camera_data_->camera_matrix(),
                               camera_data_->resolution().height,
                               camera_data_->resolution().width));
@@ -34,6 +34,7 @@
 #include <dbot/object_resource_identifier.h>
 #include <dbot/tracker/gaussian_tracker.h>
 #include <exception>
+#include <string>
 
 namespace dbot
 {
@@ -69,6 +70,25 @@ public:
             int sensors;
         };
 
+        /* -- update the belief on the GPU, see GaussianImageModelGPU -- */
+        bool use_gpu = false;
+
+        /* -- threads of the CPU measurement update, see
+         *    GaussianImageModel. 0 updates with the filter instead -- */
+        int update_threads = 1;
+
+        /* -- GPU sensor: OpenGL context backend, "default", "glx" or "egl",
+         *    and the CUDA ordinal of the GPU, negative for the default -- */
+        std::string gpu_gl_backend = "default";
+        int gpu_device = -1;
+
+        /* -- pixels of the measurement update, "all", "region", "random",
+         *    "stratified" or "edge_weighted", see PixelSelection -- */
+        std::string pixel_selection = "all";
+        int pixel_selection_margin = 16;
+        double pixel_selection_fraction = 0.25;
+        unsigned pixel_selection_seed = 0;
+
         ObjectResourceIdentifier ori;
         Observation observation;
         ObjectTransitionBuilder<State>::Parameters object_transition;
@@ -113,6 +133,32 @@ protected:
                          const std::shared_ptr<CameraData>& camera_data,
                          const Parameters::Observation& param) const;
 
+    /**
+     * \brief Creates the GPU measurement update of the tracker
+     *
+     * \throws NoGpuSupportException if compile with DBOT_BUILD_GPU=OFF
+     */
+    std::shared_ptr<GaussianTracker::GpuSensor> create_gpu_sensor(
+        const std::shared_ptr<ObjectModel>& object_model) const;
+
+    /**
+     * \brief Creates the CPU measurement update of the tracker
+     */
+    std::shared_ptr<GaussianTracker::CpuSensor> create_cpu_sensor(
+        const std::shared_ptr<ObjectModel>& object_model) const;
+
+    /**
+     * \brief Body/tail pixel model of the GPU and CPU sensors
+     */
+    SigmaPointMoments::Parameters moment_parameters() const;
+
+    /**
+     * \brief Creates the selection of the pixels of the measurement update,
+     *        null for all pixels
+     */
+    std::shared_ptr<PixelSelection> create_pixel_selection(
+        const std::shared_ptr<ObjectModel>& object_model) const;
+
     /**
      * \brief Creates an object model renderer
      */
@@ -34,6 +34,7 @@
 #include <dbot/object_model_loader.h>
 #include <dbot/object_resource_identifier.h>
 #include <dbot/tracker/particle_tracker.h>
+#include <algorithm>
 #include <exception>
 
 namespace dbot
@@ -68,6 +69,34 @@ public:
         double moving_average_update_rate;
         double max_kl_divergence;
         bool center_object_frame;
+        ResamplingStrategy resampling_strategy =
+            ResamplingStrategy::systematic;
+        /* -- number of threads the particles are propagated on -- */
+        int thread_count = 1;
+        /* -- CPUs the propagation threads are placed on, e.g.
+         *    ThreadPool::node_cpus(0), not placed if empty. The thread
+         *    building the tracker is restricted to them as well. -- */
+        std::vector<int> cpu_set;
+        /* -- time budget of the filter step in seconds, 0 for none -- */
+        double time_budget = 0;
+
+        /* -- adapt the number of evaluations by KLD-sampling -- */
+        struct AdaptiveEvaluationCount
+        {
+            bool enabled = false;
+            /* the number of evaluations varies within
+             * [min_evaluation_count, evaluation_count] */
+            int min_evaluation_count = 0;
+            double bin_size = 0.01;
+            double epsilon = 0.05;
+            double quantile = 2.33;
+        };
+        AdaptiveEvaluationCount adaptive_evaluation_count;
+
+        /* -- checkpoint of the belief every checkpoint_period frames, see
+         *    ParticleTracker::resume(). An empty path disables it. -- */
+        std::string checkpoint_path;
+        int checkpoint_period = 30;
     };
 
 public:
@@ -101,6 +130,27 @@ public:
             params_.moving_average_update_rate,
             params_.center_object_frame);
 
+        if (params_.adaptive_evaluation_count.enabled)
+        {
+            tracker->set_sample_count_adaptation(
+                create_sample_count_adaptation(filter));
+        }
+
+        // the camera lets the tracker downsample the frames under load
+        const auto& camera_data = sensor_builder_->camera_data();
+        if (camera_data)
+        {
+            tracker->set_camera(camera_data->camera_matrix(),
+                                camera_data->resolution().height,
+                                camera_data->resolution().width);
+        }
+
+        if (!params_.checkpoint_path.empty())
+        {
+            tracker->set_checkpoint(params_.checkpoint_path,
+                                    params_.checkpoint_period);
+        }
+
         return tracker;
     }
 
@@ -122,10 +172,41 @@ public:
             transition->noise_dimension() / object_model->count_parts());
 
         auto filter = std::shared_ptr<Filter>(
-            new Filter(transition, sensor, sampling_blocks, max_kl_divergence));
+            new Filter(transition,
+                       sensor,
+                       sampling_blocks,
+                       max_kl_divergence,
+                       params_.resampling_strategy));
+        filter->set_thread_count(params_.thread_count, params_.cpu_set);
+        filter->set_time_budget(params_.time_budget);
         return filter;
     }
 
+    /**
+     * \brief Creates the KLD-sampling adaptation of the number of particles.
+     *        The bounds on the evaluations are divided by the number of
+     *        sampling blocks, as for the fixed count.
+     */
+    virtual std::shared_ptr<ParticleTracker::SampleCountAdaptation>
+    create_sample_count_adaptation(const std::shared_ptr<Filter>& filter) const
+    {
+        const auto& adaptive = params_.adaptive_evaluation_count;
+        const int blocks = filter->sampling_blocks().size();
+
+        ParticleTracker::SampleCountAdaptation::Parameters parameters;
+        parameters.max_sample_count =
+            std::max(params_.evaluation_count / blocks, 1);
+        parameters.min_sample_count =
+            std::min(std::max(adaptive.min_evaluation_count / blocks, 1),
+                     parameters.max_sample_count);
+        parameters.bin_size = adaptive.bin_size;
+        parameters.epsilon = adaptive.epsilon;
+        parameters.quantile = adaptive.quantile;
+
+        return std::make_shared<ParticleTracker::SampleCountAdaptation>(
+            parameters);
+    }
+
     /**
      * \brief Creates a sampling block definition used by the coordinate
      *        particle filter
@@ -34,4 +34,7 @@
 namespace dbot
 {
 template class RbSensorBuilder<dbot::FreeFloatingRigidBodiesState<>>;
+#ifdef DBOT_FIXED_SIZE_STATE
+template class RbSensorBuilder<dbot::FreeFloatingRigidBodiesState<1>>;
+#endif
 }
@@ -41,6 +41,7 @@
 #include <dbot/pose/euler_vector.h>
 #include <dbot/rigid_body_renderer.h>
 #include <memory>
+#include <vector>
 
 namespace dbot
 {
@@ -88,6 +89,59 @@ public:
         std::string vertex_shader_file;
         std::string fragment_shader_file;
         std::string geometry_shader_file;
+
+        /* -- CPU model: number of threads the particles are scored on -- */
+        int thread_count = 1;
+
+        /* -- CPU model: CPUs the scoring threads are placed on, e.g.
+         *    ThreadPool::node_cpus(0), not placed if empty -- */
+        std::vector<int> cpu_set;
+
+        /* -- GPU model: upload observations asynchronously -- */
+        bool gpu_pipelining = false;
+
+        /* -- GPU model: keep the particle weights on the GPU -- */
+        bool gpu_device_weights = false;
+
+        /* -- GPU model: tabulate the pixel likelihoods -- */
+        bool gpu_likelihood_table = false;
+
+        /* -- GPU model: occlusion storage, "float", "half" or "uint8" -- */
+        std::string gpu_occlusion_storage = "float";
+
+        /* -- GPU model: render with CUDA instead of OpenGL -- */
+        bool gpu_cuda_rasterizer = false;
+
+        /* -- GPU model: render within the likelihood kernel, implies
+         *    gpu_cuda_rasterizer -- */
+        bool gpu_fused_evaluation = false;
+
+        /* -- GPU model: evaluate with resident warps pulling tiles of the
+         *    pose bounding boxes instead of one block per pose -- */
+        bool gpu_persistent_evaluation = false;
+
+        /* -- GPU model: only write the occlusion tiles the poses can cover
+         *    on an update, the others refer to the tiles of the parents -- */
+        bool gpu_incremental_occlusions = false;
+
+        /* -- GPU model: cache file of the tuned kernel thread count, the
+         *    thread count is not tuned if empty -- */
+        std::string gpu_thread_tuning_cache;
+
+        /* -- GPU model: OpenGL context backend, "default", "glx" or "egl",
+         *    and the CUDA ordinal of the GPU, negative for the default -- */
+        std::string gpu_gl_backend = "default";
+        int gpu_device = -1;
+
+        /* -- GPU model: CUDA ordinals of the GPUs the particles are split
+         *    over, gpu_device is used if there are fewer than two -- */
+        std::vector<int> gpu_devices;
+
+        /* -- GPU model: downsampling factor of the coarse level of a coarse
+         *    to fine evaluation, 1 disables it, and the fraction of the
+         *    particles which is scored again at full resolution -- */
+        int gpu_coarse_factor = 1;
+        double gpu_refined_fraction = 0.25;
     };
 
     typedef RbSensor<State> Model;
@@ -103,9 +157,42 @@ public:
     /* GPU model factor functions */
     virtual std::shared_ptr<Model> create_gpu_based_model() const;
 
+    /**
+     * \brief Kinect image model on one GPU, sharded ones are part of a
+     *        model on several GPUs
+     */
+    std::shared_ptr<Model> create_gpu_shard(int device,
+                                            int sample_count,
+                                            bool sharded) const;
+
+    /**
+     * \brief Same as create_gpu_shard() for images of the given resolution
+     *        and camera matrix, e.g. the coarse level of a coarse to fine
+     *        model
+     */
+    std::shared_ptr<Model> create_gpu_shard(
+        int device,
+        int sample_count,
+        bool sharded,
+        const Eigen::Matrix3d& camera_matrix,
+        int nr_rows,
+        int nr_cols) const;
+
+    /**
+     * \brief Kinect image model which refines the best particles of a
+     *        downsampled level, see CoarseToFineKinectImageModel
+     */
+    std::shared_ptr<Model> create_coarse_to_fine_model() const;
+
     std::shared_ptr<ShaderProvider> create_shader_provider() const;
 
 public:
+    /** \brief Camera whose frames the sensors observe */
+    const std::shared_ptr<CameraData>& camera_data() const
+    {
+        return camera_data_;
+    }
+
     /* CPU model factor functions */
     virtual std::shared_ptr<Model> create_cpu_based_model() const;
     virtual std::shared_ptr<KinectPixelModel> create_pixel_model() const;
@@ -33,7 +33,9 @@
 #include <dbot/model/kinect_image_model.h>
 
 #ifdef DBOT_BUILD_GPU
+#include <dbot/gpu/coarse_to_fine_kinect_image_model.h>
 #include <dbot/gpu/kinect_image_model_gpu.h>
+#include <dbot/gpu/multi_gpu_kinect_image_model.h>
 #endif
 
 namespace dbot
@@ -69,11 +71,115 @@ auto RbSensorBuilder<State>::create_gpu_based_model() const
     -> std::shared_ptr<Model>
 {
 #ifdef DBOT_BUILD_GPU
-    auto sensor = std::shared_ptr<Model>(new dbot::KinectImageModelGPU<State>(
-        camera_data_->camera_matrix(),
-        camera_data_->resolution().height,
-        camera_data_->resolution().width,
+    if (params_.gpu_coarse_factor > 1)
+    {
+        return create_coarse_to_fine_model();
+    }
+
+    if (params_.gpu_devices.size() < 2)
+    {
+        return create_gpu_shard(
+            params_.gpu_device, params_.sample_count, false);
+    }
+
+    typedef MultiGpuKinectImageModel<State> MultiGpuModel;
+    auto factory = [this](int device, int sample_count) {
+        return std::static_pointer_cast<typename MultiGpuModel::Shard>(
+            create_gpu_shard(device, sample_count, true));
+    };
+    return std::make_shared<MultiGpuModel>(params_.gpu_devices,
+                                           params_.sample_count,
+                                           object_model_->count_parts(),
+                                           factory,
+                                           params_.delta_time);
+#else
+    throw NoGpuSupportException();
+#endif
+}
+
+template <typename State>
+auto RbSensorBuilder<State>::create_coarse_to_fine_model() const
+    -> std::shared_ptr<Model>
+{
+#ifdef DBOT_BUILD_GPU
+    typedef CoarseToFineKinectImageModel<State> CoarseToFineModel;
+    typedef typename CoarseToFineModel::Level Level;
+
+    const int factor = params_.gpu_coarse_factor;
+    const int rows = camera_data_->resolution().height;
+    const int cols = camera_data_->resolution().width;
+    const DepthPreprocessor coarse_preprocessor(
+        CoarseToFineModel::preprocessor_parameters(factor));
+
+    // the fine level only has room for the refined particles
+    const int refined = std::max(
+        1, int(std::ceil(params_.gpu_refined_fraction * params_.sample_count)));
+    auto coarse = std::static_pointer_cast<Level>(create_gpu_shard(
+        params_.gpu_device,
         params_.sample_count,
+        true,
+        coarse_preprocessor.camera_matrix(camera_data_->camera_matrix()),
+        rows / factor,
+        cols / factor));
+    auto fine = std::static_pointer_cast<Level>(
+        create_gpu_shard(params_.gpu_device,
+                         refined,
+                         true,
+                         camera_data_->camera_matrix(),
+                         rows,
+                         cols));
+
+    return std::make_shared<CoarseToFineModel>(coarse,
+                                               fine,
+                                               rows,
+                                               cols,
+                                               factor,
+                                               params_.gpu_refined_fraction,
+                                               object_model_->count_parts(),
+                                               params_.delta_time);
+#else
+    throw NoGpuSupportException();
+#endif
+}
+
+template <typename State>
+auto RbSensorBuilder<State>::create_gpu_shard(int device,
+                                              int sample_count,
+                                              bool sharded) const
+    -> std::shared_ptr<Model>
+{
+    return create_gpu_shard(device,
+                            sample_count,
+                            sharded,
+                            camera_data_->camera_matrix(),
+                            camera_data_->resolution().height,
+                            camera_data_->resolution().width);
+}
+
+template <typename State>
+auto RbSensorBuilder<State>::create_gpu_shard(
+    int device,
+    int sample_count,
+    bool sharded,
+    const Eigen::Matrix3d& camera_matrix,
+    int nr_rows,
+    int nr_cols) const -> std::shared_ptr<Model>
+{
+#ifdef DBOT_BUILD_GPU
+    GlContext::Parameters gl_context;
+    gl_context.device = device;
+    if (!GlContext::parse_backend(params_.gpu_gl_backend, gl_context.backend))
+    {
+        std::cout << "Unknown OpenGL backend " << params_.gpu_gl_backend
+                  << std::endl;
+        exit(-1);
+    }
+
+    auto gpu_sensor = std::make_shared<dbot::KinectImageModelGPU<State>>(
+        camera_matrix,
+        nr_rows,
+        nr_cols,
+        sample_count,
         object_model_->vertices(),
         object_model_->triangle_indices(),
         create_shader_provider(),
@@ -85,8 +191,48 @@ auto RbSensorBuilder<State>::create_gpu_based_model() const
         params_.occlusion.p_occluded_occluded,
         params_.kinect.tail_weight,
         params_.kinect.model_sigma,
-        params_.kinect.sigma_factor));
+        params_.kinect.sigma_factor,
+        6.0f,        // max depth
+        -log(0.5f),  // exponential rate
+        gl_context);
+
+    // the shards of several GPUs neither prefetch nor keep the weights
+    gpu_sensor->set_pipelining(params_.gpu_pipelining && !sharded);
+    gpu_sensor->set_device_weights(params_.gpu_device_weights && !sharded);
+    if (params_.gpu_likelihood_table)
+    {
+        const double error = gpu_sensor->set_likelihood_table(true);
+        std::cout << "GPU: tabulated pixel likelihoods, log likelihood error "
+                     "per pixel below "
+                  << error << std::endl;
+    }
+    if (params_.gpu_occlusion_storage == "half")
+    {
+        gpu_sensor->set_occlusion_storage(
+            CudaEvaluator::OcclusionStorage::float16);
+    }
+    else if (params_.gpu_occlusion_storage == "uint8")
+    {
+        gpu_sensor->set_occlusion_storage(
+            CudaEvaluator::OcclusionStorage::uint8);
+    }
+    else if (params_.gpu_occlusion_storage != "float")
+    {
+        std::cout << "Unknown GPU occlusion storage "
+                  << params_.gpu_occlusion_storage << std::endl;
+        exit(-1);
+    }
+    gpu_sensor->set_persistent_evaluation(params_.gpu_persistent_evaluation);
+    gpu_sensor->set_incremental_occlusions(params_.gpu_incremental_occlusions);
+    gpu_sensor->set_cuda_rasterization(
+        params_.gpu_cuda_rasterizer || params_.gpu_fused_evaluation,
+        params_.gpu_fused_evaluation);
+    if (!params_.gpu_thread_tuning_cache.empty())
+    {
+        gpu_sensor->set_thread_tuning_cache(params_.gpu_thread_tuning_cache);
+    }
 
+    auto sensor = std::static_pointer_cast<Model>(gpu_sensor);
     return sensor;
 #else
     throw NoGpuSupportException();
@@ -125,7 +271,9 @@ auto RbSensorBuilder<State>::create_cpu_based_model() const
             pixel_model,
             occlusion_process,
             params_.occlusion.initial_occlusion_prob,
-            params_.delta_time));
+            params_.delta_time,
+            params_.thread_count,
+            params_.cpu_set));
 
     return sensor;
 }
@@ -156,8 +304,8 @@ template <typename State>
 auto RbSensorBuilder<State>::create_renderer() const
     -> std::shared_ptr<RigidBodyRenderer>
 {
-    std::shared_ptr<RigidBodyRenderer> renderer(new RigidBodyRenderer(
-        object_model_->vertices(), object_model_->triangle_indices()));
+    std::shared_ptr<RigidBodyRenderer> renderer(
+        new RigidBodyRenderer(object_model_->mesh_levels()));
 
     return renderer;
 }
@@ -17,6 +17,7 @@
  * \date December 2015
  */
 
+#include <iostream>
 #include <string>
 
 #include <Eigen/Dense>
@@ -27,18 +28,95 @@
 namespace dbot
 {
 CameraData::CameraData(const std::shared_ptr<CameraDataProvider> &data_provider)
-    : data_provider_(std::move(data_provider))
+    : data_provider_(std::move(data_provider)),
+      prefetched_(false),
+      prefetched_number_(0),
+      frame_number_(0)
 {
 }
 
 Eigen::MatrixXd CameraData::depth_image() const
 {
-    return data_provider_->depth_image();
+    if (!preprocessor_) return data_provider_->depth_image();
+
+    const DepthPreprocessor::Frame& frame = depth_frame();
+    Eigen::MatrixXd image(frame.rows, frame.cols);
+    for (int row = 0; row < frame.rows; ++row)
+    {
+        for (int col = 0; col < frame.cols; ++col)
+        {
+            image(row, col) = frame.depth[row * frame.cols + col];
+        }
+    }
+    return image;
 }
 
 Eigen::VectorXd CameraData::depth_image_vector() const
 {
-   return data_provider_->depth_image_vector();
+    if (!preprocessor_) return data_provider_->depth_image_vector();
+
+    return depth_frame().view().cast<double>();
+}
+
+DepthImageView CameraData::depth_image_view() const
+{
+    if (!preprocessor_) return data_provider_->depth_image_view();
+
+    return depth_frame().view();
+}
+
+void CameraData::set_preprocessor(
+    const std::shared_ptr<DepthPreprocessor>& preprocessor)
+{
+    if (preprocessor_) preprocessor_->wait(frame_);
+    preprocessor_ = preprocessor;
+    prefetched_ = false;
+    frame_number_ = 0;
+}
+
+void CameraData::prefetch_depth_image()
+{
+    if (!preprocessor_ || prefetched_) return;
+
+    // the frame may have been processed already
+    const std::uint64_t number = data_provider_->frame_number();
+    if (number != 0 && number == frame_number_) return;
+
+    const Resolution input = provider_resolution();
+    preprocessor_->submit(
+        data_provider_->depth_image_view(), input.height, input.width);
+    prefetched_ = true;
+    prefetched_number_ = number;
+}
+
+const DepthPreprocessor::Frame& CameraData::depth_frame() const
+{
+    if (!preprocessor_)
+    {
+        std::cout << "CameraData: depth_frame() requires a preprocessor"
+                  << std::endl;
+        exit(-1);
+    }
+
+    if (prefetched_)
+    {
+        preprocessor_->wait(frame_);
+        prefetched_ = false;
+        frame_number_ = prefetched_number_;
+        return frame_;
+    }
+
+    const std::uint64_t number = data_provider_->frame_number();
+    if (number == 0 || number != frame_number_)
+    {
+        const Resolution input = provider_resolution();
+        preprocessor_->process(data_provider_->depth_image_view(),
+                               input.height,
+                               input.width,
+                               frame_);
+        frame_number_ = number;
+    }
+    return frame_;
 }
 
 std::string CameraData::frame_id() const
@@ -48,20 +126,38 @@ std::string CameraData::frame_id() const
 
 Eigen::Matrix3d CameraData::camera_matrix() const
 {
-    return data_provider_->camera_matrix();
+    if (!preprocessor_) return data_provider_->camera_matrix();
+
+    return preprocessor_->camera_matrix(data_provider_->camera_matrix());
 }
 
 int CameraData::downsampling_factor() const
 {
-    return data_provider_->downsampling_factor();
+    if (!preprocessor_) return data_provider_->downsampling_factor();
+
+    return data_provider_->downsampling_factor() *
+           preprocessor_->parameters().factor;
 }
 
 CameraData::Resolution CameraData::resolution() const
+{
+    Resolution res = provider_resolution();
+
+    if (preprocessor_)
+    {
+        res.width = res.width / preprocessor_->parameters().factor;
+        res.height = res.height / preprocessor_->parameters().factor;
+    }
+
+    return res;
+}
+
+CameraData::Resolution CameraData::provider_resolution() const
 {
     Resolution res = native_resolution();
 
-    res.width = res.width / downsampling_factor();
-    res.height = res.height / downsampling_factor();
+    res.width = res.width / data_provider_->downsampling_factor();
+    res.height = res.height / data_provider_->downsampling_factor();
 
     return res;
 }
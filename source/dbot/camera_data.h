@@ -19,9 +19,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <Eigen/Dense>
+#include <dbot/depth_image_view.h>
+#include <dbot/depth_preprocessor.h>
 
 namespace dbot
 {
@@ -65,6 +68,42 @@ public:
      */
     Eigen::VectorXd depth_image_vector() const;
 
+    /**
+     * \brief returns an obtained depth image as a float view, see
+     *        CameraDataProvider::depth_image_view(). With a preprocessor
+     *        this is the preprocessed image.
+     */
+    DepthImageView depth_image_view() const;
+
+    /**
+     * \brief Sets the preprocessing applied to every depth image. The
+     *        camera matrix and the resolution refer to the preprocessed
+     *        images from then on. Passing nullptr removes the preprocessing.
+     */
+    void set_preprocessor(
+        const std::shared_ptr<DepthPreprocessor>& preprocessor);
+
+    const std::shared_ptr<DepthPreprocessor>& preprocessor() const
+    {
+        return preprocessor_;
+    }
+
+    /**
+     * \brief Starts preprocessing the current depth image of the provider on
+     *        the preprocessor thread. The next depth image accessor waits for
+     *        the result instead of processing the image itself. Does nothing
+     *        without a preprocessor.
+     */
+    void prefetch_depth_image();
+
+    /**
+     * \brief Returns the preprocessed frame including the list of valid
+     *        pixels. Requires a preprocessor. The frame is processed once per
+     *        frame_number() of the provider and stays valid until the
+     *        provider serves the next image.
+     */
+    const DepthPreprocessor::Frame& depth_frame() const;
+
     /**
      * \brief Returns the frame_id name of the camera
      */
@@ -97,12 +136,31 @@ public:
     int pixels() const;
 
 protected:
+    /**
+     * \brief Resolution of the images of the provider before preprocessing
+     */
+    Resolution provider_resolution() const;
+
     /**
      * \brief Instance of the data provider which obtains the camera images.
      *        The source of the data depends on the implementation of
      *        \c CameraDataProvider
      */
     std::shared_ptr<CameraDataProvider> data_provider_;
+
+    /**
+     * \brief Optional preprocessing of the depth images
+     */
+    std::shared_ptr<DepthPreprocessor> preprocessor_;
+    mutable bool prefetched_;
+    mutable std::uint64_t prefetched_number_;
+
+    /**
+     * \brief Preprocessed image of the provider frame frame_number_, 0 if
+     *        it is not known
+     */
+    mutable DepthPreprocessor::Frame frame_;
+    mutable std::uint64_t frame_number_;
 };
 
 }
@@ -19,10 +19,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <Eigen/Dense>
 
 #include <dbot/camera_data.h>
+#include <dbot/depth_image_view.h>
 
 namespace dbot
 {
@@ -48,6 +50,19 @@ public:
      */
     virtual Eigen::VectorXd depth_image_vector() const = 0;
 
+    /**
+     * \brief returns the obtained depth image as a float view which stays
+     *        valid until the next call. Providers backed by a float buffer
+     *        should return a view of that buffer, the default implementation
+     *        converts depth_image_vector().
+     */
+    virtual DepthImageView depth_image_view() const
+    {
+        depth_image_buffer_ = depth_image_vector().cast<float>();
+        return DepthImageView(depth_image_buffer_.data(),
+                              depth_image_buffer_.size());
+    }
+
     /**
      * \brief Obtains the camera matrix
      */
@@ -68,6 +83,19 @@ public:
      *        pixels
      */
     virtual CameraData::Resolution native_resolution() const = 0;
+
+    /**
+     * \brief Number of the current depth image, which changes whenever the
+     *        image does. 0 if the provider does not count its images, which
+     *        makes CameraData preprocess the image on every access.
+     */
+    virtual std::uint64_t frame_number() const { return 0; }
+
+protected:
+    /**
+     * \brief Converted image of the default depth_image_view()
+     */
+    mutable Eigen::VectorXf depth_image_buffer_;
 };
 
 }
@@ -0,0 +1,234 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_decoding.cpp
+ */
+
+#include <cstring>
+#include <limits>
+
+#include <dbot/depth_decoding.h>
+
+namespace dbot
+{
+namespace
+{
+/**
+ * \brief Reads the nibbles of an RVL code, the first nibble of a word is
+ *        in its most significant bits
+ */
+class NibbleReader
+{
+public:
+    NibbleReader(const std::uint8_t* code, std::size_t size)
+        : code_(code), words_(size / 4), word_(0), nibbles_(0)
+    {
+    }
+
+    /** \brief Returns false if the code ends within the value */
+    bool read(std::uint32_t& value)
+    {
+        value = 0;
+        int shift = 0;
+        std::uint32_t nibble;
+        do
+        {
+            // a nibble beyond the 32 bits of the value is not valid
+            if (shift > 30) return false;
+            if (nibbles_ == 0)
+            {
+                if (words_ == 0) return false;
+                std::memcpy(&word_, code_, 4);
+                code_ += 4;
+                words_--;
+                nibbles_ = 8;
+            }
+            nibble = word_ >> 28;
+            value |= (nibble & 7) << shift;
+            word_ <<= 4;
+            nibbles_--;
+            shift += 3;
+        } while (nibble & 8);
+        return true;
+    }
+
+private:
+    const std::uint8_t* code_;
+    std::size_t words_;
+    std::uint32_t word_;
+    int nibbles_;
+};
+
+class NibbleWriter
+{
+public:
+    explicit NibbleWriter(std::vector<std::uint8_t>& code)
+        : code_(code), word_(0), nibbles_(0)
+    {
+    }
+
+    void write(std::uint32_t value)
+    {
+        do
+        {
+            std::uint32_t nibble = value & 7;
+            value >>= 3;
+            if (value) nibble |= 8;
+            word_ = (word_ << 4) | nibble;
+            if (++nibbles_ == 8) flush_word();
+        } while (value);
+    }
+
+    /** \brief Pads and writes the last partial word */
+    void flush()
+    {
+        if (nibbles_ == 0) return;
+        word_ <<= 4 * (8 - nibbles_);
+        flush_word();
+    }
+
+private:
+    void flush_word()
+    {
+        const std::size_t end = code_.size();
+        code_.resize(end + 4);
+        std::memcpy(&code_[end], &word_, 4);
+        word_ = 0;
+        nibbles_ = 0;
+    }
+
+private:
+    std::vector<std::uint8_t>& code_;
+    std::uint32_t word_;
+    int nibbles_;
+};
+}
+
+bool DepthDecoding::decode(const EncodedDepthFrame& frame, float* meters)
+{
+    switch (frame.encoding)
+    {
+        case EncodedDepthFrame::Encoding::Uint16:
+        {
+            if (frame.size < frame.pixels * sizeof(std::uint16_t))
+            {
+                return false;
+            }
+            // the data of a message is not necessarily aligned
+            const std::uint16_t* depth =
+                reinterpret_cast<const std::uint16_t*>(frame.data);
+            if (reinterpret_cast<std::uintptr_t>(depth) %
+                    alignof(std::uint16_t) !=
+                0)
+            {
+                std::vector<std::uint16_t> aligned(frame.pixels);
+                std::memcpy(aligned.data(),
+                            frame.data,
+                            frame.pixels * sizeof(std::uint16_t));
+                convert(aligned.data(), frame.pixels, frame.scale, meters);
+                return true;
+            }
+            convert(depth, frame.pixels, frame.scale, meters);
+            return true;
+        }
+        case EncodedDepthFrame::Encoding::Rvl:
+            return decode_rvl(
+                frame.data, frame.size, frame.pixels, frame.scale, meters);
+    }
+    return false;
+}
+
+void DepthDecoding::convert(const std::uint16_t* depth,
+                            int count,
+                            float scale,
+                            float* meters)
+{
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+    // adding NaN for the invalid values keeps the loop free of branches
+    for (int i = 0; i < count; i++)
+    {
+        const float offset = depth[i] == 0 ? invalid : 0.f;
+        meters[i] = depth[i] * scale + offset;
+    }
+}
+
+bool DepthDecoding::decode_rvl(const std::uint8_t* code,
+                               std::size_t size,
+                               int count,
+                               float scale,
+                               float* meters)
+{
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+    NibbleReader reader(code, size);
+
+    int previous = 0;
+    int i = 0;
+    while (i < count)
+    {
+        std::uint32_t zeros;
+        std::uint32_t nonzeros;
+        if (!reader.read(zeros) || zeros > std::uint32_t(count - i))
+        {
+            return false;
+        }
+        for (const int end = i + zeros; i < end; i++) meters[i] = invalid;
+
+        if (!reader.read(nonzeros) || nonzeros > std::uint32_t(count - i))
+        {
+            return false;
+        }
+        for (const int end = i + nonzeros; i < end; i++)
+        {
+            std::uint32_t zigzag;
+            if (!reader.read(zigzag)) return false;
+            previous += (zigzag & 1) ? -int(zigzag >> 1) - 1 : int(zigzag >> 1);
+            meters[i] = previous * scale;
+        }
+    }
+    return true;
+}
+
+void DepthDecoding::encode_rvl(const std::uint16_t* depth,
+                               int count,
+                               std::vector<std::uint8_t>& code)
+{
+    NibbleWriter writer(code);
+
+    int previous = 0;
+    int i = 0;
+    while (i < count)
+    {
+        int zeros = 0;
+        while (i < count && depth[i] == 0)
+        {
+            zeros++;
+            i++;
+        }
+        writer.write(zeros);
+
+        int nonzeros = 0;
+        while (i + nonzeros < count && depth[i + nonzeros] != 0) nonzeros++;
+        writer.write(nonzeros);
+
+        for (const int end = i + nonzeros; i < end; i++)
+        {
+            const int difference = depth[i] - previous;
+            previous = depth[i];
+            writer.write(difference >= 0 ? 2 * difference
+                                         : -2 * difference - 1);
+        }
+    }
+    writer.flush();
+}
+}
@@ -0,0 +1,103 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_decoding.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief A depth frame as delivered by a camera or a recording, before it
+ *        is converted to meters
+ */
+struct EncodedDepthFrame
+{
+    enum class Encoding
+    {
+        /** raw row major uint16 values, size is 2 * pixels bytes */
+        Uint16,
+        /** run length and variable length coded uint16 values (RVL) */
+        Rvl
+    };
+
+    EncodedDepthFrame(Encoding encoding,
+                      const void* data,
+                      std::size_t size,
+                      int pixels,
+                      float scale = 0.001f)
+        : encoding(encoding),
+          data(static_cast<const std::uint8_t*>(data)),
+          size(size),
+          pixels(pixels),
+          scale(scale)
+    {
+    }
+
+    Encoding encoding;
+    const std::uint8_t* data;
+    std::size_t size;
+    int pixels;
+    /** meters per unit, 0.001 for millimeters */
+    float scale;
+};
+
+/**
+ * \brief Conversion of encoded depth frames straight into the float meter
+ *        images the sensors take. A value of 0 marks an invalid pixel and
+ *        becomes NaN.
+ *
+ * The RVL code is the one of A. D. Wilson, "Fast Lossless Depth Image
+ * Compression", ISS 2017: alternating runs of zeros and of non zero values,
+ * the latter as zigzag differences, all written as variable length codes of
+ * 3 bit nibbles packed into little endian 32 bit words.
+ */
+class DepthDecoding
+{
+public:
+    /**
+     * \brief Decodes the frame into frame.pixels meters. Returns false if
+     *        the frame is truncated or malformed, the output is undefined
+     *        then.
+     */
+    static bool decode(const EncodedDepthFrame& frame, float* meters);
+
+    /**
+     * \brief Converts count uint16 values, branch free such that the
+     *        compiler vectorizes the loop
+     */
+    static void convert(const std::uint16_t* depth,
+                        int count,
+                        float scale,
+                        float* meters);
+
+    static bool decode_rvl(const std::uint8_t* code,
+                           std::size_t size,
+                           int count,
+                           float scale,
+                           float* meters);
+
+    /**
+     * \brief Appends the RVL code of count values
+     */
+    static void encode_rvl(const std::uint16_t* depth,
+                           int count,
+                           std::vector<std::uint8_t>& code);
+};
+}
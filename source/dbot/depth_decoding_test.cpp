@@ -0,0 +1,138 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_decoding_test.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include <dbot/depth_decoding.h>
+
+namespace
+{
+/** \brief A row with invalid runs at its ends and a jump in between */
+std::vector<std::uint16_t> depth_row()
+{
+    std::vector<std::uint16_t> depth(100, 0);
+    for (int i = 7; i < 90; i++)
+    {
+        depth[i] = i < 50 ? 800 + i : 1500 - 3 * i;
+    }
+    depth[60] = 0;
+    depth[61] = 65535;
+    return depth;
+}
+
+void expect_meters(const std::vector<std::uint16_t>& depth,
+                   const std::vector<float>& meters)
+{
+    ASSERT_EQ(depth.size(), meters.size());
+    for (size_t i = 0; i < depth.size(); i++)
+    {
+        if (depth[i] == 0)
+        {
+            EXPECT_TRUE(std::isnan(meters[i]));
+        }
+        else
+        {
+            EXPECT_FLOAT_EQ(meters[i], depth[i] * 0.001f);
+        }
+    }
+}
+}
+
+TEST(DepthDecodingTests, uint16_frames_are_converted_to_meters)
+{
+    const std::vector<std::uint16_t> depth = depth_row();
+    std::vector<float> meters(depth.size());
+
+    ASSERT_TRUE(dbot::DepthDecoding::decode(
+        dbot::EncodedDepthFrame(dbot::EncodedDepthFrame::Encoding::Uint16,
+                                depth.data(),
+                                2 * depth.size(),
+                                depth.size()),
+        meters.data()));
+    expect_meters(depth, meters);
+
+    // an unaligned message buffer
+    std::vector<std::uint8_t> message(2 * depth.size() + 1);
+    std::memcpy(&message[1], depth.data(), 2 * depth.size());
+    std::fill(meters.begin(), meters.end(), 0.f);
+    ASSERT_TRUE(dbot::DepthDecoding::decode(
+        dbot::EncodedDepthFrame(dbot::EncodedDepthFrame::Encoding::Uint16,
+                                &message[1],
+                                2 * depth.size(),
+                                depth.size()),
+        meters.data()));
+    expect_meters(depth, meters);
+}
+
+TEST(DepthDecodingTests, rvl_round_trips)
+{
+    const std::vector<std::uint16_t> depth = depth_row();
+    std::vector<std::uint8_t> code;
+    dbot::DepthDecoding::encode_rvl(depth.data(), depth.size(), code);
+    EXPECT_EQ(code.size() % 4, 0u);
+    EXPECT_LT(code.size(), 2 * depth.size());
+
+    std::vector<float> meters(depth.size());
+    ASSERT_TRUE(dbot::DepthDecoding::decode(
+        dbot::EncodedDepthFrame(dbot::EncodedDepthFrame::Encoding::Rvl,
+                                code.data(),
+                                code.size(),
+                                depth.size()),
+        meters.data()));
+    expect_meters(depth, meters);
+}
+
+TEST(DepthDecodingTests, rvl_matches_the_reference_packing)
+{
+    // runs 1 zero, 2 values: 5 (zigzag 10) and 4 (zigzag 1). The nibbles
+    // 1, 2, 2+8, 1, 1 fill the first word from its most significant bits.
+    const std::uint16_t depth[3] = {0, 5, 4};
+    std::vector<std::uint8_t> code;
+    dbot::DepthDecoding::encode_rvl(depth, 3, code);
+
+    ASSERT_EQ(code.size(), 4u);
+    std::uint32_t word;
+    std::memcpy(&word, code.data(), 4);
+    EXPECT_EQ(word, 0x12A11000u);
+}
+
+TEST(DepthDecodingTests, truncated_rvl_is_rejected)
+{
+    const std::vector<std::uint16_t> depth = depth_row();
+    std::vector<std::uint8_t> code;
+    dbot::DepthDecoding::encode_rvl(depth.data(), depth.size(), code);
+
+    std::vector<float> meters(depth.size());
+    EXPECT_FALSE(dbot::DepthDecoding::decode_rvl(
+        code.data(), code.size() - 4, depth.size(), 0.001f, meters.data()));
+    EXPECT_FALSE(dbot::DepthDecoding::decode_rvl(
+        code.data(), code.size(), depth.size() + 1, 0.001f, meters.data()));
+}
+
+TEST(DepthDecodingTests, overlong_rvl_values_are_rejected)
+{
+    // continuation nibbles only, the value would exceed 32 bits within the
+    // second word
+    const std::vector<std::uint8_t> code(12, 0xFF);
+
+    std::vector<float> meters(4);
+    EXPECT_FALSE(dbot::DepthDecoding::decode_rvl(
+        code.data(), code.size(), meters.size(), 0.001f, meters.data()));
+}
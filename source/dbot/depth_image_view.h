@@ -0,0 +1,30 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_image_view.h
+ */
+
+#pragma once
+
+#include <Eigen/Core>
+
+namespace dbot
+{
+/**
+ * \brief Non-owning view of a float depth image in row major pixel order,
+ *        e.g. of the buffer of a camera driver. The viewed memory has to
+ *        outlive the view.
+ */
+typedef Eigen::Map<const Eigen::VectorXf> DepthImageView;
+}
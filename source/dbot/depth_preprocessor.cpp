@@ -0,0 +1,225 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_preprocessor.cpp
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include <dbot/depth_preprocessor.h>
+
+namespace dbot
+{
+DepthPreprocessor::DepthPreprocessor(const Parameters& parameters)
+    : parameters_(parameters),
+      processed_(false),
+      pending_image_(nullptr),
+      pending_rows_(0),
+      pending_cols_(0),
+      pending_(false),
+      stop_(false)
+{
+    if (parameters_.factor < 1)
+    {
+        std::cout << "DepthPreprocessor: the downsampling factor has to be "
+                     "at least 1"
+                  << std::endl;
+        exit(-1);
+    }
+
+    thread_ = std::thread(&DepthPreprocessor::work, this);
+}
+
+DepthPreprocessor::~DepthPreprocessor()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+Eigen::Matrix3d DepthPreprocessor::camera_matrix(
+    const Eigen::Matrix3d& input) const
+{
+    Eigen::Matrix3d camera_matrix = input;
+    camera_matrix.topRows(2) /= parameters_.factor;
+    return camera_matrix;
+}
+
+void DepthPreprocessor::process(const DepthImageView& image,
+                                int rows,
+                                int cols,
+                                Frame& frame)
+{
+    run(image.data(), rows, cols, frame);
+}
+
+void DepthPreprocessor::submit(const DepthImageView& image, int rows, int cols)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return !pending_; });
+        pending_image_ = image.data();
+        pending_rows_ = rows;
+        pending_cols_ = cols;
+        pending_ = true;
+    }
+    condition_.notify_all();
+}
+
+void DepthPreprocessor::wait(Frame& frame)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !pending_; });
+    if (!processed_) return;
+
+    std::swap(frame, frame_);
+    processed_ = false;
+}
+
+void DepthPreprocessor::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        condition_.wait(lock, [this] { return pending_ || stop_; });
+        if (stop_) return;
+
+        lock.unlock();
+        run(pending_image_, pending_rows_, pending_cols_, frame_);
+        lock.lock();
+
+        pending_ = false;
+        processed_ = true;
+        condition_.notify_all();
+    }
+}
+
+void DepthPreprocessor::run(const float* image,
+                            int rows,
+                            int cols,
+                            Frame& frame) const
+{
+    const int factor = parameters_.factor;
+    const float min_depth = parameters_.min_depth;
+    const float max_depth = parameters_.max_depth;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    frame.rows = rows / factor;
+    frame.cols = cols / factor;
+    frame.depth.resize(frame.rows * frame.cols);
+    float* depth = frame.depth.data();
+
+    // a depth is valid if it lies strictly within the range, this rejects
+    // NaN as well as the zeros which some sensors report for missing depth
+    switch (parameters_.downsampling)
+    {
+        case Downsampling::subsample:
+            for (int row = 0; row < frame.rows; row++)
+            {
+                const float* line = image + row * factor * cols;
+                float* out = depth + row * frame.cols;
+                for (int col = 0; col < frame.cols; col++)
+                {
+                    const float d = line[col * factor];
+                    out[col] = d > min_depth && d < max_depth ? d : nan;
+                }
+            }
+            break;
+
+        case Downsampling::block_min:
+            // the out of range depths are replaced by infinity, which the
+            // minimum over the block ignores
+            for (int row = 0; row < frame.rows; row++)
+            {
+                float* out = depth + row * frame.cols;
+                std::fill(out,
+                          out + frame.cols,
+                          std::numeric_limits<float>::infinity());
+                for (int i = 0; i < factor; i++)
+                {
+                    const float* line = image + (row * factor + i) * cols;
+                    for (int col = 0; col < frame.cols; col++)
+                    {
+                        for (int j = 0; j < factor; j++)
+                        {
+                            const float d = line[col * factor + j];
+                            const float valid =
+                                d > min_depth && d < max_depth
+                                    ? d
+                                    : std::numeric_limits<float>::infinity();
+                            out[col] = std::min(out[col], valid);
+                        }
+                    }
+                }
+                for (int col = 0; col < frame.cols; col++)
+                {
+                    out[col] = out[col] < max_depth ? out[col] : nan;
+                }
+            }
+            break;
+
+        case Downsampling::block_median:
+        {
+            // scratch of the median of one block, local such that frames can
+            // be processed on several threads at once
+            std::vector<float> block;
+            block.reserve(factor * factor);
+            for (int row = 0; row < frame.rows; row++)
+            {
+                float* out = depth + row * frame.cols;
+                for (int col = 0; col < frame.cols; col++)
+                {
+                    block.clear();
+                    for (int i = 0; i < factor; i++)
+                    {
+                        const float* line =
+                            image + (row * factor + i) * cols + col * factor;
+                        for (int j = 0; j < factor; j++)
+                        {
+                            if (line[j] > min_depth && line[j] < max_depth)
+                            {
+                                block.push_back(line[j]);
+                            }
+                        }
+                    }
+
+                    if (block.empty())
+                    {
+                        out[col] = nan;
+                        continue;
+                    }
+                    auto median = block.begin() + block.size() / 2;
+                    std::nth_element(block.begin(), median, block.end());
+                    out[col] = *median;
+                }
+            }
+            break;
+        }
+    }
+
+    // list the valid pixels, the trackers only have to visit those
+    frame.valid_pixels.resize(frame.depth.size());
+    int count = 0;
+    for (int i = 0; i < int(frame.depth.size()); i++)
+    {
+        frame.valid_pixels[count] = i;
+        count += depth[i] == depth[i];
+    }
+    frame.valid_pixels.resize(count);
+}
+}
@@ -0,0 +1,151 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_preprocessor.h
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/depth_image_view.h>
+
+namespace dbot
+{
+/**
+ * \brief Preprocessing of the depth frames shared by all trackers. Every
+ *        frame is downsampled by an integer factor, depths outside of the
+ *        valid range are set to NaN and the valid pixels are listed.
+ *
+ * A frame can either be processed on the calling thread or on the thread
+ * owned by the preprocessor, see submit().
+ */
+class DepthPreprocessor
+{
+public:
+    /**
+     * \brief How a block of factor x factor pixels is reduced to one pixel
+     */
+    enum class Downsampling
+    {
+        /** top left pixel of the block */
+        subsample,
+        /** closest valid depth, keeps thin foreground structures */
+        block_min,
+        /** median of the valid depths, suppresses single outliers */
+        block_median
+    };
+
+    struct Parameters
+    {
+        Parameters()
+            : factor(1),
+              downsampling(Downsampling::block_min),
+              min_depth(0.f),
+              max_depth(std::numeric_limits<float>::infinity())
+        {
+        }
+
+        int factor;
+        Downsampling downsampling;
+        float min_depth;
+        float max_depth;
+    };
+
+    /**
+     * \brief A preprocessed frame
+     */
+    struct Frame
+    {
+        Frame() : rows(0), cols(0) {}
+
+        DepthImageView view() const
+        {
+            return DepthImageView(depth.data(), depth.size());
+        }
+
+        int rows;
+        int cols;
+
+        /** row major depths, NaN where the depth is not valid */
+        std::vector<float> depth;
+
+        /** ascending indices of the pixels with a valid depth */
+        std::vector<int> valid_pixels;
+    };
+
+public:
+    explicit DepthPreprocessor(const Parameters& parameters = Parameters());
+
+    ~DepthPreprocessor();
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /**
+     * \brief Camera matrix of the preprocessed frames given the camera
+     *        matrix of the input frames
+     */
+    Eigen::Matrix3d camera_matrix(const Eigen::Matrix3d& input) const;
+
+    /**
+     * \brief Processes the row major rows x cols image on the calling thread
+     *        into the frame, whose buffers are reused
+     */
+    void process(const DepthImageView& image, int rows, int cols, Frame& frame);
+
+    /**
+     * \brief Starts processing the image on the preprocessor thread and
+     *        returns immediately. The image has to stay valid until wait()
+     *        returns.
+     */
+    void submit(const DepthImageView& image, int rows, int cols);
+
+    /**
+     * \brief Blocks until the submitted frame is processed and swaps it into
+     *        the given frame, whose buffers the next submit() reuses. Leaves
+     *        the frame unchanged if nothing has been submitted.
+     */
+    void wait(Frame& frame);
+
+private:
+    DepthPreprocessor(const DepthPreprocessor&);
+    DepthPreprocessor& operator=(const DepthPreprocessor&);
+
+    void work();
+    void run(const float* image, int rows, int cols, Frame& frame) const;
+
+private:
+    Parameters parameters_;
+
+    // frame of the preprocessor thread and whether it holds a result which
+    // has not been taken by wait()
+    Frame frame_;
+    bool processed_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    const float* pending_image_;
+    int pending_rows_;
+    int pending_cols_;
+    bool pending_;
+    bool stop_;
+};
+}
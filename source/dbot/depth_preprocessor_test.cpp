@@ -0,0 +1,174 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_preprocessor_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <dbot/camera_data.h>
+#include <dbot/depth_preprocessor.h>
+#include <dbot/virtual_camera_data_provider.h>
+
+namespace
+{
+const float nan = std::numeric_limits<float>::quiet_NaN();
+
+// 4 x 4 image, each 2 x 2 block has one outlier or missing depth
+std::vector<float> test_image()
+{
+    return {1.0f, 1.1f, 2.0f, 0.0f,
+            1.2f, 0.2f, 2.1f, 2.2f,
+            nan,  nan,  3.0f, 3.1f,
+            nan,  nan,  9.0f, 3.2f};
+}
+
+dbot::DepthPreprocessor::Parameters parameters(
+    dbot::DepthPreprocessor::Downsampling downsampling)
+{
+    dbot::DepthPreprocessor::Parameters parameters;
+    parameters.factor = 2;
+    parameters.downsampling = downsampling;
+    parameters.min_depth = 0.5f;
+    parameters.max_depth = 5.0f;
+    return parameters;
+}
+
+// counts the images read from the provider, 8 x 6 pixels
+class CountingCameraDataProvider : public dbot::VirtualCameraDataProvider
+{
+public:
+    CountingCameraDataProvider()
+        : dbot::VirtualCameraDataProvider(80, "camera"), reads(0)
+    {
+    }
+
+    dbot::DepthImageView depth_image_view() const
+    {
+        reads++;
+        return dbot::VirtualCameraDataProvider::depth_image_view();
+    }
+
+    mutable int reads;
+};
+}
+
+TEST(DepthPreprocessorTests, block_min)
+{
+    dbot::DepthPreprocessor preprocessor(
+        parameters(dbot::DepthPreprocessor::Downsampling::block_min));
+
+    const std::vector<float> image = test_image();
+    dbot::DepthPreprocessor::Frame frame;
+    preprocessor.process(
+        dbot::DepthImageView(image.data(), image.size()), 4, 4, frame);
+
+    ASSERT_EQ(frame.rows, 2);
+    ASSERT_EQ(frame.cols, 2);
+    EXPECT_FLOAT_EQ(frame.depth[0], 1.0f);
+    EXPECT_FLOAT_EQ(frame.depth[1], 2.0f);
+    EXPECT_TRUE(std::isnan(frame.depth[2]));
+    EXPECT_FLOAT_EQ(frame.depth[3], 3.0f);
+    EXPECT_EQ(frame.valid_pixels, std::vector<int>({0, 1, 3}));
+}
+
+TEST(DepthPreprocessorTests, block_median)
+{
+    dbot::DepthPreprocessor preprocessor(
+        parameters(dbot::DepthPreprocessor::Downsampling::block_median));
+
+    const std::vector<float> image = test_image();
+    dbot::DepthPreprocessor::Frame frame;
+    preprocessor.process(
+        dbot::DepthImageView(image.data(), image.size()), 4, 4, frame);
+
+    EXPECT_FLOAT_EQ(frame.depth[0], 1.1f);
+    EXPECT_FLOAT_EQ(frame.depth[1], 2.1f);
+    EXPECT_TRUE(std::isnan(frame.depth[2]));
+    EXPECT_FLOAT_EQ(frame.depth[3], 3.1f);
+}
+
+TEST(DepthPreprocessorTests, asynchronous_matches_synchronous)
+{
+    dbot::DepthPreprocessor synchronous(
+        parameters(dbot::DepthPreprocessor::Downsampling::subsample));
+    dbot::DepthPreprocessor asynchronous(
+        parameters(dbot::DepthPreprocessor::Downsampling::subsample));
+
+    const std::vector<float> image = test_image();
+    const dbot::DepthImageView view(image.data(), image.size());
+
+    dbot::DepthPreprocessor::Frame synchronous_frame;
+    synchronous.process(view, 4, 4, synchronous_frame);
+    const std::vector<float>& expected = synchronous_frame.depth;
+
+    dbot::DepthPreprocessor::Frame frame;
+    for (int i = 0; i < 3; i++)
+    {
+        asynchronous.submit(view, 4, 4);
+        asynchronous.wait(frame);
+        ASSERT_EQ(frame.depth.size(), expected.size());
+        for (size_t k = 0; k < expected.size(); k++)
+        {
+            EXPECT_TRUE(
+                frame.depth[k] == expected[k] ||
+                (std::isnan(frame.depth[k]) && std::isnan(expected[k])));
+        }
+    }
+    EXPECT_FLOAT_EQ(expected[0], 1.0f);
+    EXPECT_FLOAT_EQ(expected[1], 2.0f);
+    EXPECT_TRUE(std::isnan(expected[2]));
+}
+
+TEST(DepthPreprocessorTests, camera_matrix)
+{
+    dbot::DepthPreprocessor preprocessor(
+        parameters(dbot::DepthPreprocessor::Downsampling::subsample));
+
+    Eigen::Matrix3d camera_matrix;
+    camera_matrix << 580, 0, 320, 0, 580, 240, 0, 0, 1;
+    const Eigen::Matrix3d scaled = preprocessor.camera_matrix(camera_matrix);
+
+    EXPECT_DOUBLE_EQ(scaled(0, 0), 290);
+    EXPECT_DOUBLE_EQ(scaled(1, 1), 290);
+    EXPECT_DOUBLE_EQ(scaled(0, 2), 160);
+    EXPECT_DOUBLE_EQ(scaled(1, 2), 120);
+    EXPECT_DOUBLE_EQ(scaled(2, 2), 1);
+}
+
+TEST(DepthPreprocessorTests, camera_data_caches_frames)
+{
+    auto provider = std::make_shared<CountingCameraDataProvider>();
+    dbot::CameraData camera_data(provider);
+    camera_data.set_preprocessor(std::make_shared<dbot::DepthPreprocessor>(
+        parameters(dbot::DepthPreprocessor::Downsampling::subsample)));
+
+    provider->set_depth_image(Eigen::MatrixXd::Constant(6, 8, 1.0));
+    EXPECT_FLOAT_EQ(camera_data.depth_frame().depth[0], 1.0f);
+    camera_data.depth_image_view();
+    camera_data.depth_image_vector();
+    EXPECT_EQ(provider->reads, 1);
+
+    // a prefetched frame is not processed again either
+    provider->set_depth_image(Eigen::MatrixXd::Constant(6, 8, 2.0));
+    camera_data.prefetch_depth_image();
+    EXPECT_FLOAT_EQ(camera_data.depth_frame().depth[0], 2.0f);
+    EXPECT_EQ(camera_data.depth_frame().valid_pixels.size(), 12u);
+    camera_data.prefetch_depth_image();
+    EXPECT_EQ(provider->reads, 2);
+}
@@ -0,0 +1,322 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_stream.cpp
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <dbot/depth_decoding.h>
+#include <dbot/depth_stream.h>
+
+namespace dbot
+{
+namespace
+{
+const char magic[8] = {'D', 'B', 'O', 'T', 'D', 'P', 'T', 'H'};
+// version 2 stores the frames as RVL instead of per row differences
+const std::uint32_t version = 2;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t part_count;
+    std::uint32_t width;
+    std::uint32_t height;
+    double camera_matrix[9];  // row major
+    double depth_scale;
+    char frame_id[64];
+    std::uint64_t frame_count;
+    std::uint64_t index_offset;
+};
+
+struct IndexEntry
+{
+    double timestamp;
+    std::uint64_t offset;
+    std::uint64_t code_size;
+};
+
+const std::size_t pose_size = 7 * sizeof(double);
+}
+
+DepthStream::DepthStream() : part_count_(0), depth_scale_(0)
+{
+    resolution_.width = 0;
+    resolution_.height = 0;
+    camera_matrix_.setZero();
+}
+
+DepthStream::~DepthStream()
+{
+}
+
+bool DepthStream::open(const std::string& path)
+{
+    index_.clear();
+    region_.reset();
+
+    try
+    {
+        boost::interprocess::file_mapping file(
+            path.c_str(), boost::interprocess::read_only);
+        region_.reset(new boost::interprocess::mapped_region(
+            file, boost::interprocess::read_only));
+    }
+    catch (const boost::interprocess::interprocess_exception&)
+    {
+        return false;
+    }
+
+    const std::uint8_t* data =
+        static_cast<const std::uint8_t*>(region_->get_address());
+    const std::uint64_t size = region_->get_size();
+
+    Header header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != version)
+    {
+        return false;
+    }
+
+    // the index lies within the mapped file
+    if (header.index_offset > size ||
+        header.frame_count >
+            (size - header.index_offset) / sizeof(IndexEntry))
+    {
+        return false;
+    }
+
+    part_count_ = header.part_count;
+    resolution_.width = header.width;
+    resolution_.height = header.height;
+    camera_matrix_ =
+        Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(
+            header.camera_matrix);
+    depth_scale_ = header.depth_scale;
+    frame_id_.assign(header.frame_id,
+                     strnlen(header.frame_id, sizeof(header.frame_id)));
+
+    const std::uint64_t poses_size = part_count_ * pose_size;
+    for (std::uint64_t i = 0; i < header.frame_count; i++)
+    {
+        IndexEntry entry;
+        std::memcpy(&entry,
+                    data + header.index_offset + i * sizeof(entry),
+                    sizeof(entry));
+        if (entry.offset > header.index_offset ||
+            poses_size + entry.code_size > header.index_offset - entry.offset)
+        {
+            index_.clear();
+            return false;
+        }
+
+        Frame frame;
+        frame.timestamp = entry.timestamp;
+        frame.poses = data + entry.offset;
+        frame.code = frame.poses + poses_size;
+        frame.code_size = entry.code_size;
+        index_.push_back(frame);
+    }
+
+    return true;
+}
+
+double DepthStream::timestamp(std::size_t frame) const
+{
+    return index_[frame].timestamp;
+}
+
+auto DepthStream::poses(std::size_t frame) const -> Poses
+{
+    Poses poses(part_count_);
+    for (int part = 0; part < part_count_; part++)
+    {
+        // the frames are not aligned within the file
+        double pose[7];
+        std::memcpy(pose, index_[frame].poses + part * pose_size, pose_size);
+
+        poses[part] = Eigen::Translation3d(pose[0], pose[1], pose[2]) *
+                      Eigen::Quaterniond(pose[3], pose[4], pose[5], pose[6]);
+    }
+    return poses;
+}
+
+void DepthStream::decode(std::size_t frame,
+                         int downsampling_factor,
+                         float* depth) const
+{
+    const int rows = resolution_.height;
+    const int cols = resolution_.width;
+    const int out_rows = rows / downsampling_factor;
+    const int out_cols = cols / downsampling_factor;
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+
+    // the full frame decodes straight into the output, a downsampled one
+    // through a buffer of the thread
+    static thread_local std::vector<float> full;
+    float* meters = depth;
+    if (downsampling_factor != 1)
+    {
+        full.resize(rows * cols);
+        meters = full.data();
+    }
+
+    const EncodedDepthFrame code(EncodedDepthFrame::Encoding::Rvl,
+                                 index_[frame].code,
+                                 index_[frame].code_size,
+                                 rows * cols,
+                                 float(depth_scale_));
+    if (!DepthDecoding::decode(code, meters))
+    {
+        std::fill(depth, depth + out_rows * out_cols, invalid);
+        return;
+    }
+    if (downsampling_factor == 1) return;
+
+    for (int row = 0; row < out_rows; row++)
+    {
+        const float* line = meters + row * downsampling_factor * cols;
+        for (int col = 0; col < out_cols; col++)
+        {
+            depth[row * out_cols + col] = line[col * downsampling_factor];
+        }
+    }
+}
+
+DepthStreamWriter::DepthStreamWriter(const std::string& path,
+                                     const Eigen::Matrix3d& camera_matrix,
+                                     const CameraData::Resolution& resolution,
+                                     const std::string& frame_id,
+                                     int part_count,
+                                     double depth_scale)
+    : path_(path),
+      file_((path + ".tmp").c_str(), std::ios::binary),
+      open_(true),
+      failed_(!file_),
+      part_count_(part_count),
+      resolution_(resolution),
+      depth_scale_(depth_scale),
+      camera_matrix_(camera_matrix),
+      frame_id_(frame_id)
+{
+    // the header is written by close(), once the index is known
+    const Header placeholder = Header();
+    file_.write(reinterpret_cast<const char*>(&placeholder),
+                sizeof(placeholder));
+    units_.resize(resolution_.width * resolution_.height);
+}
+
+DepthStreamWriter::~DepthStreamWriter()
+{
+    if (open_) close();
+}
+
+bool DepthStreamWriter::add_frame(double timestamp,
+                                  const Eigen::MatrixXd& depth,
+                                  const DepthStream::Poses& poses)
+{
+    if (!open_ || failed_) return false;
+    if (depth.rows() != resolution_.height ||
+        depth.cols() != resolution_.width || int(poses.size()) != part_count_)
+    {
+        return false;
+    }
+
+    for (int row = 0; row < depth.rows(); row++)
+    {
+        for (int col = 0; col < depth.cols(); col++)
+        {
+            const double units = std::round(depth(row, col) / depth_scale_);
+            units_[row * depth.cols() + col] =
+                std::isfinite(units) && units > 0 && units <= 65535
+                    ? std::uint16_t(units)
+                    : 0;
+        }
+    }
+    code_.clear();
+    DepthDecoding::encode_rvl(
+        units_.data(), resolution_.height * resolution_.width, code_);
+
+    timestamps_.push_back(timestamp);
+    offsets_.push_back(std::uint64_t(file_.tellp()));
+    code_sizes_.push_back(code_.size());
+
+    for (const Eigen::Affine3d& pose : poses)
+    {
+        const Eigen::Vector3d position = pose.translation();
+        const Eigen::Quaterniond orientation(pose.rotation());
+        const double values[7] = {position(0),
+                                  position(1),
+                                  position(2),
+                                  orientation.w(),
+                                  orientation.x(),
+                                  orientation.y(),
+                                  orientation.z()};
+        file_.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+    file_.write(reinterpret_cast<const char*>(code_.data()), code_.size());
+
+    failed_ = failed_ || !file_;
+    return !failed_;
+}
+
+bool DepthStreamWriter::close()
+{
+    if (!open_) return !failed_;
+    open_ = false;
+
+    Header header = Header();
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.part_count = part_count_;
+    header.width = resolution_.width;
+    header.height = resolution_.height;
+    Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(
+        header.camera_matrix) = camera_matrix_;
+    header.depth_scale = depth_scale_;
+    std::strncpy(
+        header.frame_id, frame_id_.c_str(), sizeof(header.frame_id) - 1);
+    header.frame_count = timestamps_.size();
+    header.index_offset = std::uint64_t(file_.tellp());
+
+    for (size_t i = 0; i < timestamps_.size(); i++)
+    {
+        const IndexEntry entry = {timestamps_[i], offsets_[i], code_sizes_[i]};
+        file_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.close();
+    failed_ = failed_ || !file_;
+
+    // readers never see a partially written stream
+    const std::string tmp_path = path_ + ".tmp";
+    if (failed_ || std::rename(tmp_path.c_str(), path_.c_str()) != 0)
+    {
+        std::remove(tmp_path.c_str());
+        failed_ = true;
+    }
+    return !failed_;
+}
+}
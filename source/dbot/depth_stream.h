@@ -0,0 +1,174 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_stream.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+#include <dbot/camera_data.h>
+
+namespace boost
+{
+namespace interprocess
+{
+class mapped_region;
+}
+}
+
+namespace dbot
+{
+/**
+ * \brief Recorded depth stream: 16 bit depth frames with timestamps, the
+ *        camera matrix and the ground truth poses of the tracked objects.
+ *
+ * The file holds a fixed header followed by the frames and an index of the
+ * frames at its end. A frame consists of its poses, 7 doubles per object
+ * (position, quaternion w x y z), and its compressed depth. The depth is
+ * stored in units of depth_scale meters, 0 marks invalid pixels. Each frame
+ * is RVL coded, see DepthDecoding, such that it decodes in a single pass
+ * straight into meters.
+ */
+class DepthStream
+{
+public:
+    typedef std::vector<Eigen::Affine3d,
+                        Eigen::aligned_allocator<Eigen::Affine3d>>
+        Poses;
+
+public:
+    DepthStream();
+    ~DepthStream();
+
+    /**
+     * \brief Maps the stream file into memory. Returns false if the file
+     *        cannot be mapped or is malformed.
+     */
+    bool open(const std::string& path);
+
+    std::size_t frame_count() const { return index_.size(); }
+    int part_count() const { return part_count_; }
+
+    /** \brief Resolution of the recorded frames */
+    const CameraData::Resolution& resolution() const { return resolution_; }
+
+    /** \brief Camera matrix of the recorded resolution */
+    const Eigen::Matrix3d& camera_matrix() const { return camera_matrix_; }
+
+    const std::string& frame_id() const { return frame_id_; }
+
+    /** \brief Meters per depth unit */
+    double depth_scale() const { return depth_scale_; }
+
+    /** \brief Recording time of the frame in seconds */
+    double timestamp(std::size_t frame) const;
+
+    /** \brief Ground truth poses of the objects in the frame */
+    Poses poses(std::size_t frame) const;
+
+    /**
+     * \brief Decodes the frame into depth in meters, row major, NaN for
+     *        invalid pixels. Only every downsampling_factor-th pixel of
+     *        every downsampling_factor-th row is written, depth has to hold
+     *        (rows / factor) * (cols / factor) values.
+     */
+    void decode(std::size_t frame, int downsampling_factor, float* depth) const;
+
+private:
+    DepthStream(const DepthStream&);
+    DepthStream& operator=(const DepthStream&);
+
+    struct Frame
+    {
+        double timestamp;
+        const std::uint8_t* poses;
+        const std::uint8_t* code;
+        std::uint64_t code_size;
+    };
+
+private:
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+    std::vector<Frame> index_;
+    int part_count_;
+    CameraData::Resolution resolution_;
+    Eigen::Matrix3d camera_matrix_;
+    std::string frame_id_;
+    double depth_scale_;
+};
+
+/**
+ * \brief Records frames into a DepthStream file
+ */
+class DepthStreamWriter
+{
+public:
+    /**
+     * \param depth_scale  meters per depth unit, depth beyond 65535 units
+     *                     is stored as invalid
+     */
+    DepthStreamWriter(const std::string& path,
+                      const Eigen::Matrix3d& camera_matrix,
+                      const CameraData::Resolution& resolution,
+                      const std::string& frame_id,
+                      int part_count,
+                      double depth_scale = 0.001);
+
+    /**
+     * \brief Closes the stream if that has not been done
+     */
+    ~DepthStreamWriter();
+
+    /**
+     * \brief Appends a frame of the recorded resolution in meters. NaN,
+     *        infinite and non-positive depth is stored as invalid.
+     */
+    bool add_frame(double timestamp,
+                   const Eigen::MatrixXd& depth,
+                   const DepthStream::Poses& poses);
+
+    /**
+     * \brief Writes the index and moves the file into place. Returns false
+     *        if any write failed, the stream is not created then.
+     */
+    bool close();
+
+private:
+    std::string path_;
+    std::ofstream file_;
+    bool open_;
+    bool failed_;
+    int part_count_;
+    CameraData::Resolution resolution_;
+    double depth_scale_;
+
+    std::vector<double> timestamps_;
+    std::vector<std::uint64_t> offsets_;
+    std::vector<std::uint64_t> code_sizes_;
+    std::vector<std::uint16_t> units_;
+    std::vector<std::uint8_t> code_;
+
+    // header fields, written last
+    Eigen::Matrix3d camera_matrix_;
+    std::string frame_id_;
+};
+}
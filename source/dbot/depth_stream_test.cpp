@@ -0,0 +1,151 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file depth_stream_test.cpp
+ */
+
+#include <cmath>
+#include <limits>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include <dbot/depth_stream.h>
+#include <dbot/recorded_camera_data_provider.h>
+
+namespace
+{
+class DepthStreamTests : public testing::Test
+{
+protected:
+    DepthStreamTests()
+        : path_((boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("dbot_stream_%%%%%%%%"))
+                    .string())
+    {
+        resolution_.width = 8;
+        resolution_.height = 6;
+        camera_matrix_ << 10, 0, 4, 0, 10, 3, 0, 0, 1;
+    }
+
+    ~DepthStreamTests() { boost::filesystem::remove(path_); }
+
+    /** \brief A tilted plane with a hole in the middle */
+    Eigen::MatrixXd frame(int index) const
+    {
+        Eigen::MatrixXd depth(resolution_.height, resolution_.width);
+        for (int row = 0; row < depth.rows(); row++)
+        {
+            for (int col = 0; col < depth.cols(); col++)
+            {
+                depth(row, col) = 0.8 + 0.01 * row + 0.002 * col + 0.1 * index;
+            }
+        }
+        depth(3, 4) = std::numeric_limits<double>::quiet_NaN();
+        return depth;
+    }
+
+    dbot::DepthStream::Poses poses(int index) const
+    {
+        dbot::DepthStream::Poses poses(1);
+        poses[0] = Eigen::Translation3d(0.1 * index, 0.2, 0.7) *
+                   Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitY());
+        return poses;
+    }
+
+    void record(int frame_count)
+    {
+        dbot::DepthStreamWriter writer(
+            path_, camera_matrix_, resolution_, "/camera", 1);
+        for (int i = 0; i < frame_count; i++)
+        {
+            ASSERT_TRUE(writer.add_frame(0.05 * i, frame(i), poses(i)));
+        }
+        ASSERT_TRUE(writer.close());
+    }
+
+    std::string path_;
+    dbot::CameraData::Resolution resolution_;
+    Eigen::Matrix3d camera_matrix_;
+};
+}
+
+TEST_F(DepthStreamTests, frames_round_trip)
+{
+    record(3);
+
+    dbot::DepthStream stream;
+    ASSERT_TRUE(stream.open(path_));
+    ASSERT_EQ(stream.frame_count(), 3u);
+    EXPECT_EQ(stream.part_count(), 1);
+    EXPECT_EQ(stream.resolution().width, 8);
+    EXPECT_EQ(stream.resolution().height, 6);
+    EXPECT_TRUE(stream.camera_matrix().isApprox(camera_matrix_));
+    EXPECT_EQ(stream.frame_id(), "/camera");
+    EXPECT_DOUBLE_EQ(stream.timestamp(2), 0.1);
+    EXPECT_TRUE(stream.poses(2)[0].isApprox(poses(2)[0]));
+
+    std::vector<float> depth(8 * 6);
+    stream.decode(2, 1, depth.data());
+    const Eigen::MatrixXd expected = frame(2);
+    for (int row = 0; row < 6; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            if (row == 3 && col == 4)
+            {
+                EXPECT_TRUE(std::isnan(depth[row * 8 + col]));
+            }
+            else
+            {
+                EXPECT_NEAR(depth[row * 8 + col], expected(row, col), 5e-4);
+            }
+        }
+    }
+}
+
+TEST_F(DepthStreamTests, malformed_streams_are_rejected)
+{
+    dbot::DepthStream stream;
+    EXPECT_FALSE(stream.open(path_));
+
+    record(2);
+    boost::filesystem::resize_file(path_,
+                                   boost::filesystem::file_size(path_) - 1);
+    EXPECT_FALSE(stream.open(path_));
+}
+
+TEST_F(DepthStreamTests, provider_plays_back_downsampled_frames)
+{
+    record(2);
+    auto stream = std::make_shared<dbot::DepthStream>();
+    ASSERT_TRUE(stream->open(path_));
+
+    dbot::RecordedCameraDataProvider provider(stream, 2);
+    EXPECT_EQ(provider.camera_matrix()(0, 0), 5);
+    EXPECT_EQ(provider.camera_matrix()(1, 2), 1.5);
+    EXPECT_EQ(provider.depth_image().rows(), 3);
+    EXPECT_EQ(provider.depth_image().cols(), 4);
+    EXPECT_NEAR(provider.depth_image()(1, 3), frame(0)(2, 6), 5e-4);
+    EXPECT_EQ(provider.depth_image_view().size(), 12);
+
+    EXPECT_TRUE(provider.next_frame());
+    EXPECT_EQ(provider.frame_index(), 1u);
+    EXPECT_NEAR(provider.depth_image_vector()(0), frame(1)(0, 0), 5e-4);
+    EXPECT_TRUE(provider.ground_truth()[0].isApprox(poses(1)[0]));
+
+    // the last frame is kept at the end of the stream
+    EXPECT_FALSE(provider.next_frame());
+    EXPECT_EQ(provider.frame_index(), 1u);
+}
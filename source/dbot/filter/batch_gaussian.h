@@ -0,0 +1,135 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file batch_gaussian.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace dbot
+{
+/**
+ * \brief Counter based generator of standard normal samples.
+ *
+ * Sample k of stream s at counter c is a pure function of (seed, c, s, k):
+ * the bits are obtained by hashing the tuple and mapped to a normal
+ * distribution with the Box-Muller transform. There is no generator state,
+ * hence any subset of the samples can be generated in any order or on any
+ * thread and the result is always the same.
+ */
+class BatchGaussian
+{
+public:
+    explicit BatchGaussian(std::uint64_t seed = 1) : seed_(mix(seed)) {}
+
+    /**
+     * \brief Fills samples[s * count + k] with sample k of stream s for all
+     *        s < stream_count and k < count at the given counter.
+     */
+    template <typename Scalar>
+    void fill(std::uint64_t counter,
+              int stream_count,
+              int count,
+              Scalar* samples) const
+    {
+        for (int s = 0; s < stream_count; s++)
+        {
+            fill_stream(counter, s, count, samples + s * count);
+        }
+    }
+
+    /**
+     * \brief Fills samples[k] with sample k of the given stream
+     *
+     * The loop is scalar, GCC does not vectorize the hashing and the libm
+     * calls of the Box-Muller transform even at -O3. The gain over drawing
+     * the samples one by one is the missing generator state.
+     */
+    template <typename Scalar>
+    void fill_stream(std::uint64_t counter,
+                     std::uint64_t stream,
+                     int count,
+                     Scalar* samples) const
+    {
+        const std::uint64_t key = this->key(counter, stream);
+
+        // the samples come in Box-Muller pairs
+        for (int k = 0; k + 1 < count; k += 2)
+        {
+            double radius, angle;
+            polar(key, k, radius, angle);
+            samples[k] = Scalar(radius * std::cos(angle));
+            samples[k + 1] = Scalar(radius * std::sin(angle));
+        }
+        if (count % 2)
+        {
+            double radius, angle;
+            polar(key, count - 1, radius, angle);
+            samples[count - 1] = Scalar(radius * std::cos(angle));
+        }
+    }
+
+    /**
+     * \brief Sample k of the given stream
+     */
+    double operator()(std::uint64_t counter,
+                      std::uint64_t stream,
+                      int k) const
+    {
+        double radius, angle;
+        polar(key(counter, stream), k, radius, angle);
+        return radius * (k % 2 ? std::sin(angle) : std::cos(angle));
+    }
+
+private:
+    /** splitmix64 finalizer, a bijective 64 bit mixing function */
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    std::uint64_t key(std::uint64_t counter, std::uint64_t stream) const
+    {
+        return mix(mix(seed_ ^ counter) + stream * 0xd1b54a32d192ed03ULL);
+    }
+
+    /** uniform in (0, 1] from the upper 53 bits */
+    static double uniform(std::uint64_t bits)
+    {
+        return (double(bits >> 11) + 1.) * (1. / 9007199254740992.);
+    }
+
+    void polar(std::uint64_t key, int k, double& radius, double& angle) const
+    {
+        const std::uint64_t pair = std::uint64_t(k >> 1);
+        const double u1 = uniform(mix(key + 2 * pair * 0x9e3779b97f4a7c15ULL));
+        const double u2 =
+            uniform(mix(key + (2 * pair + 1) * 0x9e3779b97f4a7c15ULL));
+
+        radius = std::sqrt(-2. * std::log(u1));
+        angle = 6.283185307179586 * u2;
+    }
+
+private:
+    std::uint64_t seed_;
+};
+}
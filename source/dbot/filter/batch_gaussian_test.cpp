@@ -0,0 +1,70 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file batch_gaussian_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/filter/batch_gaussian.h>
+
+TEST(BatchGaussianTests, samples_only_depend_on_their_coordinates)
+{
+    dbot::BatchGaussian gaussian(42);
+
+    const int streams = 7;
+    const int count = 5;
+    std::vector<double> batch(streams * count);
+    gaussian.fill(3, streams, count, batch.data());
+
+    for (int s = 0; s < streams; s++)
+    {
+        std::vector<double> stream(count);
+        gaussian.fill_stream(3, s, count, stream.data());
+        for (int k = 0; k < count; k++)
+        {
+            EXPECT_EQ(batch[s * count + k], stream[k]);
+            EXPECT_EQ(batch[s * count + k], gaussian(3, s, k));
+        }
+    }
+
+    std::vector<double> other(streams * count);
+    gaussian.fill(4, streams, count, other.data());
+    EXPECT_NE(batch, other);
+}
+
+TEST(BatchGaussianTests, samples_are_standard_normal)
+{
+    dbot::BatchGaussian gaussian;
+
+    const int streams = 1000;
+    const int count = 100;
+    std::vector<float> samples(streams * count);
+    gaussian.fill(0, streams, count, samples.data());
+
+    double mean = 0;
+    double second_moment = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        mean += samples[i];
+        second_moment += samples[i] * samples[i];
+    }
+    mean /= samples.size();
+    second_moment /= samples.size();
+
+    EXPECT_NEAR(mean, 0., 0.01);
+    EXPECT_NEAR(second_moment, 1., 0.02);
+}
@@ -0,0 +1,126 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file kld_sampling.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+#include <dbot/pose/pose_hashing.h>
+
+namespace dbot
+{
+/**
+ * \brief Number of particles required such that, with probability
+ *        1 - delta, the KL divergence between the particle approximation and
+ *        a posterior occupying the given number of bins stays below epsilon
+ *        (Fox, 2003).
+ *
+ * \param quantile	upper 1 - delta quantile of the standard normal
+ */
+inline int kld_sample_count(int bin_count, double epsilon, double quantile)
+{
+    if (bin_count < 2) return 1;
+
+    const double k = bin_count - 1;
+    const double a = 2. / (9. * k);
+    const double b = 1. - a + std::sqrt(a) * quantile;
+
+    return int(std::ceil(k / (2. * epsilon) * b * b * b));
+}
+
+/**
+ * \brief Adapts the number of particles to the spread of the belief by
+ *        KLD-sampling. The state space is divided into bins of equal size in
+ *        every coordinate and the required number of particles is computed
+ *        from the number of occupied bins.
+ */
+template <typename State>
+class KldSampling
+{
+public:
+    struct Parameters
+    {
+        Parameters()
+            : min_sample_count(1),
+              max_sample_count(1),
+              bin_size(0.01),
+              epsilon(0.05),
+              quantile(2.33)
+        {
+        }
+
+        int min_sample_count;
+        int max_sample_count;
+
+        /** edge length of the bins in every state coordinate */
+        double bin_size;
+
+        /** bound on the KL divergence */
+        double epsilon;
+
+        /** normal quantile of the confidence, 2.33 for 99% */
+        double quantile;
+    };
+
+public:
+    explicit KldSampling(const Parameters& parameters)
+        : parameters_(parameters),
+          bins_(0,
+                PoseHash<State>(parameters.bin_size),
+                PoseEqual<State>(parameters.bin_size))
+    {
+    }
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /**
+     * \brief Changes the upper bound, e.g. to trade accuracy for time. It
+     *        takes precedence over a lower bound above it.
+     */
+    void set_max_sample_count(int count)
+    {
+        parameters_.max_sample_count = std::max(count, 1);
+    }
+
+    /**
+     * \brief Number of particles for the belief within the bounds
+     */
+    template <typename Belief>
+    int sample_count(const Belief& belief)
+    {
+        bins_.clear();
+        for (int i = 0; i < int(belief.size()); i++)
+        {
+            bins_.insert(belief.location(i));
+        }
+
+        const int count = kld_sample_count(
+            bins_.size(), parameters_.epsilon, parameters_.quantile);
+
+        return std::min(std::max(count, parameters_.min_sample_count),
+                        parameters_.max_sample_count);
+    }
+
+private:
+    Parameters parameters_;
+
+    // occupied bins, the buckets are kept between frames
+    std::unordered_set<State, PoseHash<State>, PoseEqual<State>> bins_;
+};
+}
@@ -0,0 +1,93 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file kld_sampling_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/filter/kld_sampling.h>
+
+namespace
+{
+typedef Eigen::Vector3d State;
+
+struct Belief
+{
+    int size() const { return int(locations.size()); }
+    const State& location(int i) const { return locations[i]; }
+
+    std::vector<State> locations;
+};
+
+dbot::KldSampling<State>::Parameters parameters()
+{
+    dbot::KldSampling<State>::Parameters parameters;
+    parameters.min_sample_count = 10;
+    parameters.max_sample_count = 1000;
+    parameters.bin_size = 0.1;
+    return parameters;
+}
+}
+
+TEST(KldSamplingTests, sample_count_grows_with_bins)
+{
+    EXPECT_EQ(dbot::kld_sample_count(1, 0.05, 2.33), 1);
+
+    int previous = 0;
+    for (int bins = 2; bins < 100; bins++)
+    {
+        const int count = dbot::kld_sample_count(bins, 0.05, 2.33);
+        EXPECT_GT(count, previous);
+        previous = count;
+    }
+
+    // (k - 1) / (2 epsilon) chi^2 quantile for k = 10
+    EXPECT_NEAR(dbot::kld_sample_count(10, 0.05, 2.33), 216, 2);
+}
+
+TEST(KldSamplingTests, tight_belief_uses_min_count)
+{
+    dbot::KldSampling<State> kld(parameters());
+
+    Belief belief;
+    for (int i = 0; i < 100; i++)
+    {
+        belief.locations.push_back(State::Constant(0.001 * (i % 10)));
+    }
+    EXPECT_EQ(kld.sample_count(belief), 10);
+}
+
+TEST(KldSamplingTests, spread_belief_uses_more_particles)
+{
+    dbot::KldSampling<State> kld(parameters());
+
+    Belief narrow;
+    Belief wide;
+    for (int i = 0; i < 100; i++)
+    {
+        narrow.locations.push_back(State(0.1 * (i % 5), 0, 0));
+        wide.locations.push_back(State(0.1 * (i % 50), 0, 0));
+    }
+
+    const int narrow_count = kld.sample_count(narrow);
+    const int wide_count = kld.sample_count(wide);
+    EXPECT_EQ(narrow_count, dbot::kld_sample_count(5, 0.05, 2.33));
+    EXPECT_GT(wide_count, narrow_count);
+    EXPECT_LE(wide_count, 1000);
+}
@@ -0,0 +1,221 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file parallel_information_update.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/thread_pool.h>
+
+namespace dbot
+{
+/**
+ * \brief Measurement update of a Gaussian belief with many independent
+ *        scalar sensors, e.g. one per pixel, in information form.
+ *
+ * Every sensor is linearized statistically over the same set of sigma
+ * points. Its contribution to the information matrix and vector only
+ * depends on that sensor, hence the sensors are split into chunks of a
+ * fixed size which are processed in parallel. The per chunk sums are
+ * reduced in chunk order, such that the result does not depend on the
+ * number of threads.
+ */
+class ParallelInformationUpdate
+{
+public:
+    typedef Eigen::VectorXd Vector;
+    typedef Eigen::MatrixXd Matrix;
+
+public:
+    /**
+     * \param chunk_size	number of sensors processed as one unit, small
+     *                      enough for the observations of a chunk to stay
+     *                      in cache
+     */
+    explicit ParallelInformationUpdate(int thread_count = 1,
+                                       int chunk_size = 1024)
+        : chunk_size_(std::max(chunk_size, 1))
+    {
+        set_thread_count(thread_count);
+    }
+
+    /** \param cpus  CPUs the threads are placed on, see ThreadPool */
+    void set_thread_count(int thread_count,
+                          const ThreadPool::CpuSet& cpus = ThreadPool::CpuSet())
+    {
+        thread_pool_ = std::make_shared<ThreadPool>(thread_count, cpus);
+    }
+
+    int thread_count() const { return thread_pool_->thread_count(); }
+
+    /**
+     * \brief Updates the belief given by mean and covariance.
+     *
+     * \param points		sigma points of the belief, one per column
+     * \param weights		weights of the sigma points
+     * \param observations	observation of each sensor, sensors with a
+     *                      non-finite observation are skipped
+     * \param predict		predict(sensor, point, mean, variance) writes
+     *                      the mean and the variance of the observation of
+     *                      the sensor given the state of the sigma point.
+     *                      It is called concurrently for different chunks.
+     */
+    template <typename Predict>
+    void update(const Vector& mean,
+                const Matrix& covariance,
+                const Matrix& points,
+                const Vector& weights,
+                const Vector& observations,
+                Predict predict,
+                Vector& posterior_mean,
+                Matrix& posterior_covariance)
+    {
+        const int dimension = mean.size();
+        const int point_count = points.cols();
+        const int sensor_count = observations.size();
+        const int chunk_count = (sensor_count + chunk_size_ - 1) / chunk_size_;
+
+        deviations_ = points.colwise() - mean;
+        weighted_deviations_ = deviations_ * weights.asDiagonal();
+        const Eigen::LDLT<Matrix> prior(covariance);
+
+        chunks_.resize(chunk_count);
+        workers_.resize(thread_pool_->thread_count());
+        thread_pool_->parallel_for(
+            chunk_count, [&](int begin, int end, int worker_index) {
+                Worker& worker = workers_[worker_index];
+                worker.predictions.resize(point_count);
+                worker.variances.resize(point_count);
+
+                for (int chunk = begin; chunk < end; chunk++)
+                {
+                    Chunk& sums = chunks_[chunk];
+                    sums.information_matrix.setZero(dimension, dimension);
+                    sums.information_vector.setZero(dimension);
+
+                    const int first = chunk * chunk_size_;
+                    const int last =
+                        std::min(first + chunk_size_, sensor_count);
+                    for (int sensor = first; sensor < last; sensor++)
+                    {
+                        if (!std::isfinite(observations(sensor))) continue;
+
+                        accumulate(sensor,
+                                   observations(sensor),
+                                   weights,
+                                   prior,
+                                   predict,
+                                   worker,
+                                   sums);
+                    }
+                }
+            });
+
+        // the reduction runs in chunk order independent of the threads
+        information_matrix_ =
+            prior.solve(Matrix::Identity(dimension, dimension));
+        information_vector_.setZero(dimension);
+        for (int chunk = 0; chunk < chunk_count; chunk++)
+        {
+            information_matrix_ += chunks_[chunk].information_matrix;
+            information_vector_ += chunks_[chunk].information_vector;
+        }
+
+        const Eigen::LDLT<Matrix> posterior(information_matrix_);
+        posterior_covariance =
+            posterior.solve(Matrix::Identity(dimension, dimension));
+        posterior_mean = mean + posterior_covariance * information_vector_;
+    }
+
+private:
+    /** \brief Information of the sensors of one chunk */
+    struct Chunk
+    {
+        Matrix information_matrix;
+        Vector information_vector;
+    };
+
+    /** \brief Scratch memory of one thread */
+    struct Worker
+    {
+        Vector predictions;
+        Vector variances;
+        Vector cross_covariance;
+        Vector gain;
+    };
+
+    /**
+     * \brief Linearizes the sensor over the sigma points and adds
+     *        H^T R^-1 H and H^T R^-1 (y - y_mean) to the chunk sums, where
+     *        H is the statistical linearization and R contains the
+     *        observation noise and the linearization error
+     */
+    template <typename Predict>
+    void accumulate(int sensor,
+                    double observation,
+                    const Vector& weights,
+                    const Eigen::LDLT<Matrix>& prior,
+                    Predict& predict,
+                    Worker& worker,
+                    Chunk& sums) const
+    {
+        const int point_count = weights.size();
+        for (int point = 0; point < point_count; point++)
+        {
+            predict(sensor,
+                    point,
+                    worker.predictions(point),
+                    worker.variances(point));
+        }
+
+        const double prediction = weights.dot(worker.predictions);
+        worker.predictions.array() -= prediction;
+
+        const double variance =
+            weights.dot(worker.predictions.cwiseProduct(worker.predictions)) +
+            weights.dot(worker.variances);
+        worker.cross_covariance = weighted_deviations_ * worker.predictions;
+        worker.gain = prior.solve(worker.cross_covariance);
+
+        const double noise =
+            variance - worker.gain.dot(worker.cross_covariance);
+        if (!(noise > 0)) return;
+
+        sums.information_matrix.noalias() +=
+            worker.gain * worker.gain.transpose() / noise;
+        sums.information_vector.noalias() +=
+            worker.gain * ((observation - prediction) / noise);
+    }
+
+private:
+    int chunk_size_;
+    std::shared_ptr<ThreadPool> thread_pool_;
+
+    std::vector<Chunk> chunks_;
+    std::vector<Worker> workers_;
+
+    Matrix deviations_;
+    Matrix weighted_deviations_;
+    Matrix information_matrix_;
+    Vector information_vector_;
+};
+}
@@ -0,0 +1,143 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file parallel_information_update_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include <dbot/filter/parallel_information_update.h>
+
+namespace
+{
+typedef dbot::ParallelInformationUpdate::Vector Vector;
+typedef dbot::ParallelInformationUpdate::Matrix Matrix;
+
+const int dimension = 4;
+const int sensor_count = 3000;
+const double noise_variance = 0.01;
+
+/** unscented points with kappa = 1 */
+void unscented_points(const Vector& mean,
+                      const Matrix& covariance,
+                      Matrix& points,
+                      Vector& weights)
+{
+    const double kappa = 1.;
+    const double scale = dimension + kappa;
+    Matrix root = (scale * covariance).llt().matrixL();
+
+    points.resize(dimension, 2 * dimension + 1);
+    weights.resize(2 * dimension + 1);
+    points.col(0) = mean;
+    weights(0) = kappa / scale;
+    for (int i = 0; i < dimension; i++)
+    {
+        points.col(1 + 2 * i) = mean + root.col(i);
+        points.col(2 + 2 * i) = mean - root.col(i);
+        weights(1 + 2 * i) = weights(2 + 2 * i) = 0.5 / scale;
+    }
+}
+
+class ParallelInformationUpdateTests : public ::testing::Test
+{
+protected:
+    ParallelInformationUpdateTests()
+    {
+        srand(1);
+        mean = Vector::Random(dimension);
+        Matrix root = Matrix::Random(dimension, dimension);
+        covariance = root * root.transpose() +
+                     0.1 * Matrix::Identity(dimension, dimension);
+        unscented_points(mean, covariance, points, weights);
+
+        // linear sensors, a few without observation
+        sensors = Matrix::Random(dimension, sensor_count);
+        observations = Vector::Random(sensor_count);
+        for (int i = 0; i < sensor_count; i += 97)
+        {
+            observations(i) = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    void update(dbot::ParallelInformationUpdate& filter,
+                Vector& posterior_mean,
+                Matrix& posterior_covariance)
+    {
+        filter.update(
+            mean,
+            covariance,
+            points,
+            weights,
+            observations,
+            [&](int sensor, int point, double& prediction, double& variance) {
+                prediction = sensors.col(sensor).dot(points.col(point));
+                variance = noise_variance;
+            },
+            posterior_mean,
+            posterior_covariance);
+    }
+
+    Vector mean;
+    Matrix covariance;
+    Matrix points;
+    Vector weights;
+    Matrix sensors;
+    Vector observations;
+};
+}
+
+TEST_F(ParallelInformationUpdateTests, linear_sensors_match_kalman_update)
+{
+    // joint Kalman update in information form
+    Matrix information = covariance.inverse();
+    Vector information_vector = Vector::Zero(dimension);
+    for (int i = 0; i < sensor_count; i++)
+    {
+        if (!std::isfinite(observations(i))) continue;
+
+        const Vector a = sensors.col(i);
+        information += a * a.transpose() / noise_variance;
+        information_vector +=
+            a * (observations(i) - a.dot(mean)) / noise_variance;
+    }
+    const Matrix expected_covariance = information.inverse();
+    const Vector expected_mean =
+        mean + expected_covariance * information_vector;
+
+    dbot::ParallelInformationUpdate filter(1, 256);
+    Vector posterior_mean;
+    Matrix posterior_covariance;
+    update(filter, posterior_mean, posterior_covariance);
+
+    EXPECT_TRUE(posterior_mean.isApprox(expected_mean, 1e-6));
+    EXPECT_TRUE(posterior_covariance.isApprox(expected_covariance, 1e-6));
+}
+
+TEST_F(ParallelInformationUpdateTests, threads_do_not_change_result)
+{
+    dbot::ParallelInformationUpdate serial(1, 256);
+    dbot::ParallelInformationUpdate parallel(4, 256);
+
+    Vector serial_mean, parallel_mean;
+    Matrix serial_covariance, parallel_covariance;
+    update(serial, serial_mean, serial_covariance);
+    update(parallel, parallel_mean, parallel_covariance);
+
+    EXPECT_TRUE(serial_mean == parallel_mean);
+    EXPECT_TRUE(serial_covariance == parallel_covariance);
+}
@@ -24,10 +24,12 @@
 
 #pragma once
 
+#include <chrono>
 #include <vector>
 #include <limits>
 #include <string>
 #include <memory>
+#include <random>
 
 #include <Eigen/Core>
 
@@ -35,9 +37,17 @@
 #include <fl/distribution/gaussian.hpp>
 #include <fl/distribution/discrete_distribution.hpp>
 #include <fl/util/profiling.hpp>
+#include <fl/util/random.hpp>
 
 #include <dbot/traits.h>
+#include <dbot/depth_image_view.h>
+#include <dbot/memory_planner.h>
+#include <dbot/profiler.h>
+#include <dbot/thread_pool.h>
+#include <dbot/filter/batch_gaussian.h>
+#include <dbot/filter/resampling.h>
 #include <dbot/model/rao_blackwell_sensor.h>
+#include <dbot/pose/pose_cache.h>
 
 namespace dbot
 {
@@ -53,6 +63,9 @@ public:
     typedef Eigen::Array<fl::Real, -1, 1> RealArray;
     typedef Eigen::Array<int, -1, 1> IntArray;
 
+    /** fixed size noises need the alignment of Eigen */
+    typedef std::vector<Noise, Eigen::aligned_allocator<Noise>> NoiseVector;
+
     typedef typename Sensor::Observation Observation;
 
     typedef fl::DiscreteDistribution<State> Belief;
@@ -63,12 +76,26 @@ public:
         const std::shared_ptr<Transition> transition,
         const std::shared_ptr<Sensor> sensor,
         const std::vector<std::vector<int>>& sampling_blocks,
-        const fl::Real& max_kl_divergence = 0)
+        const fl::Real& max_kl_divergence = 0,
+        const ResamplingStrategy& resampling_strategy =
+            ResamplingStrategy::systematic)
         : sensor_(sensor),
           transition_(transition),
-          max_kl_divergence_(max_kl_divergence)
+          max_kl_divergence_(max_kl_divergence),
+          resampling_strategy_(resampling_strategy),
+          generator_(RANDOM_SEED),
+          noise_generator_(RANDOM_SEED),
+          noise_counter_(0),
+          thread_pool_(std::make_shared<ThreadPool>(1)),
+          time_budget_(0),
+          block_cost_(0),
+          max_block_count_(0),
+          evaluated_block_count_(0),
+          particles_account_(MemoryComponent::HostParticles),
+          noises_account_(MemoryComponent::HostNoises)
     {
         sampling_blocks_ = sampling_blocks;
+        merged_block_.reserve(transition_->noise_dimension());
 
         // make sure sizes are consistent --------------------------------------
         size_t dimension = 0;
@@ -86,73 +113,297 @@ public:
     }
     virtual ~RaoBlackwellCoordinateParticleFilter() noexcept {}
     /// the filter functions ***************************************************
+    /**
+     * \brief Incorporates the observation. All intermediate results live in
+     *        workspaces owned by the filter, hence a frame with an unchanged
+     *        number of particles does not allocate any memory by itself.
+     */
     void filter(const Observation& observation, const Input& input)
     {
         sensor_->set_observation(observation);
+        filter(input);
+    }
+
+    /**
+     * \brief Same as above for a float depth image which is handed to the
+     *        sensor without conversion
+     */
+    void filter(const DepthImageView& observation, const Input& input)
+    {
+        sensor_->set_observation(observation);
+        filter(input);
+    }
 
-        loglikes_ = RealArray::Zero(belief_.size());
-        noises_ = std::vector<Noise>(
-            belief_.size(), Noise::Zero(transition_->noise_dimension()));
+    /**
+     * \brief Same as above for an image whose valid pixels are known, e.g.
+     *        a DepthPreprocessor::Frame
+     */
+    void filter(const DepthImageView& observation,
+                const std::vector<int>& valid_pixels,
+                const Input& input)
+    {
+        sensor_->set_observation(observation, valid_pixels);
+        filter(input);
+    }
+
+    /**
+     * \brief Same as above for a uint16 or RVL coded depth frame, which the
+     *        sensor decodes into its observation buffer. Returns false and
+     *        does not filter if the frame cannot be decoded.
+     */
+    bool filter(const EncodedDepthFrame& observation, const Input& input)
+    {
+        if (!sensor_->set_observation(observation)) return false;
+        filter(input);
+        return true;
+    }
+
+    /**
+     * \brief Incorporates the observation which has been set on the sensor
+     */
+    void filter(const Input& input)
+    {
+        TraceSpan filter_span("filter", "filter");
+        const bool device_weights = sensor_->has_device_weights();
+
+        resize_workspaces(belief_.size());
+        loglikes_.setZero();
+        for (size_t i_sampl = 0; i_sampl < noises_.size(); i_sampl++)
+        {
+            noises_[i_sampl].setZero();
+        }
         old_particles_ = belief_.locations();
-        for (size_t i_block = 0; i_block < sampling_blocks_.size(); i_block++)
+
+        const Clock::time_point start = Clock::now();
+        evaluated_block_count_ = 0;
+        size_t i_block = 0;
+        while (i_block < sampling_blocks_.size())
         {
+            const Clock::time_point block_start = Clock::now();
+            TraceSpan block_span(
+                "sampling_block", "filter", evaluated_block_count_);
+
+            // with a time budget, the remaining blocks are merged into one as
+            // soon as evaluating them one by one is expected to exceed it,
+            // with a block limit once the last allowed block is reached ------
+            const std::vector<int>* current_block = &sampling_blocks_[i_block];
+            size_t next_block = i_block + 1;
+            const size_t remaining = sampling_blocks_.size() - i_block;
+            if (remaining > 1 &&
+                ((time_budget_ > 0 &&
+                  seconds(block_start - start) + remaining * block_cost_ >
+                      time_budget_) ||
+                 (max_block_count_ > 0 &&
+                  evaluated_block_count_ + 1 >= max_block_count_)))
+            {
+                merged_block_.clear();
+                for (size_t i = i_block; i < sampling_blocks_.size(); i++)
+                {
+                    merged_block_.insert(merged_block_.end(),
+                                         sampling_blocks_[i].begin(),
+                                         sampling_blocks_[i].end());
+                }
+                current_block = &merged_block_;
+                next_block = sampling_blocks_.size();
+            }
+
+            ProfileStopwatch stopwatch;
+            stopwatch.restart();
+
             // add noise of this block -----------------------------------------
+            // the noise of all particles is generated in one go, particle
+            // i_sampl always draws from stream i_sampl of the current counter
+            const std::vector<int>& block = *current_block;
+            block_noise_.resize(belief_.size() * block.size());
+            noise_generator_.fill(noise_counter_++,
+                                  belief_.size(),
+                                  block.size(),
+                                  block_noise_.data());
             for (size_t i_sampl = 0; i_sampl < belief_.size(); i_sampl++)
             {
-                for (size_t i = 0; i < sampling_blocks_[i_block].size(); i++)
+                const fl::Real* noise = &block_noise_[i_sampl * block.size()];
+                for (size_t i = 0; i < block.size(); i++)
                 {
-                    noises_[i_sampl](sampling_blocks_[i_block][i]) =
-                        unit_gaussian_.sample()(0);
+                    noises_[i_sampl](block[i]) = noise[i];
                 }
             }
 
             // propagate using partial noise -----------------------------------
-            for (size_t i_sampl = 0; i_sampl < belief_.size(); i_sampl++)
+            // the particles are independent, each one is written by exactly
+            // one worker
+            thread_pool_->parallel_for(
+                belief_.size(), [this, &input](int begin, int end, int) {
+                    for (int i_sampl = begin; i_sampl < end; i_sampl++)
+                    {
+                        belief_.location(i_sampl) = transition_->state(
+                            old_particles_[i_sampl], noises_[i_sampl], input);
+                    }
+                });
+            stopwatch.lap(ProfileStage::Propose);
+
+            bool update = (next_block == sampling_blocks_.size());
+            if (device_weights)
             {
-                belief_.location(i_sampl) = transition_->state(
-                    old_particles_[i_sampl], noises_[i_sampl], input);
+                // the weights stay with the sensor, only the kl divergence
+                // and the parents of a resampling are returned
+                const fl::Real kl_divergence = sensor_->compute_device_weights(
+                    belief_.locations(), update);
+                if (kl_divergence > max_kl_divergence_) resample_on_device();
             }
+            else
+            {
+                // compute likelihood ------------------------------------------
+                sensor_->compute_loglikes(
+                    belief_.locations(), indices_, update, new_loglikes_);
 
-            // compute likelihood ----------------------------------------------
-            bool update = (i_block == sampling_blocks_.size() - 1);
-            RealArray new_loglikes = sensor_->loglikes(
-                belief_.locations(), indices_, update);
-
-            // update the weights and resample if necessary --------------------
-            belief_.delta_log_prob_mass(new_loglikes - loglikes_);
-            loglikes_ = new_loglikes;
+                // update the weights and resample if necessary ----------------
+                log_weights_ = belief_.log_prob_mass();
+                log_weights_ += new_loglikes_ - loglikes_;
+                belief_.log_unnormalized_prob_mass(log_weights_);
+                loglikes_.swap(new_loglikes_);
 
-            if (belief_.kl_given_uniform() > max_kl_divergence_)
-            {
-                resample(belief_.size());
+                if (belief_.kl_given_uniform() > max_kl_divergence_)
+                {
+                    resample(belief_.size());
+                }
             }
+
+            // a merged block costs about as much as a single one, both render
+            // and weigh every particle once
+            const double cost = seconds(Clock::now() - block_start);
+            block_cost_ =
+                block_cost_ > 0 ? 0.8 * block_cost_ + 0.2 * cost : cost;
+
+            evaluated_block_count_++;
+            i_block = next_block;
+        }
+
+        if (device_weights)
+        {
+            sensor_->device_log_weights(log_weights_);
+            belief_.log_unnormalized_prob_mass(log_weights_);
         }
     }
 
+    /**
+     * \brief Draws sample_count particles according to the current weights
+     *        using the resampling strategy of the filter. The parents are
+     *        determined in a single pass over the weights and all per
+     *        particle data is then gathered through that index map.
+     */
     void resample(const size_t& sample_count)
     {
-        IntArray indices(sample_count);
-        std::vector<Noise> noises(sample_count);
-        StateArray next_samples(sample_count);
-        RealArray loglikes(sample_count);
+        ProfileScope scope(ProfileStage::Resample);
+        resize_resampling_workspaces(sample_count);
 
-        Belief new_belief(sample_count);
+        weights_.resize(belief_.size());
+        for (int i = 0; i < belief_.size(); i++)
+        {
+            weights_[i] = belief_.prob_mass(i);
+        }
+        resample_indices(resampling_strategy_,
+                         weights_,
+                         belief_.size(),
+                         sample_count,
+                         generator_,
+                         parents_.data());
 
         for (size_t i = 0; i < sample_count; i++)
         {
-            int index;
-            new_belief.location(i) = belief_.sample(index);
+            const int index = parents_[i];
+            next_locations_[i] = belief_.location(index);
 
-            indices[i] = indices_[index];
-            noises[i] = noises_[index];
-            next_samples[i] = old_particles_[index];
-            loglikes[i] = loglikes_[index];
+            next_indices_[i] = indices_[index];
+            next_noises_[i] = noises_[index];
+            next_old_particles_[i] = old_particles_[index];
+            next_loglikes_[i] = loglikes_[index];
         }
-        belief_ = new_belief;
-        indices_ = indices;
-        noises_ = noises;
-        old_particles_ = next_samples;
-        loglikes_ = loglikes;
+        indices_.swap(next_indices_);
+        noises_.swap(next_noises_);
+        old_particles_.swap(next_old_particles_);
+        loglikes_.swap(next_loglikes_);
+
+        // the resampled particles are uniformly weighted
+        log_weights_.setZero(sample_count);
+        belief_.log_unnormalized_prob_mass(log_weights_);
+        for (size_t i = 0; i < sample_count; i++)
+        {
+            belief_.location(i) = next_locations_[i];
+        }
+    }
+
+    /**
+     * \brief Systematic resampling of the weights kept by the sensor. The
+     *        sensor also moves the occlusion indices and log likelihoods of
+     *        the particles, the filter only gathers the states and noises
+     *        of the returned parents. The resampling strategy of the filter
+     *        is not used.
+     */
+    void resample_on_device()
+    {
+        ProfileScope scope(ProfileStage::Resample);
+        const int sample_count = belief_.size();
+        resize_resampling_workspaces(sample_count);
+
+        std::uniform_real_distribution<fl::Real> uniform(0., 1.);
+        sensor_->resample_device_weights(uniform(generator_), parents_);
+
+        for (int i = 0; i < sample_count; i++)
+        {
+            const int index = parents_[i];
+            next_locations_[i] = belief_.location(index);
+            next_noises_[i] = noises_[index];
+            next_old_particles_[i] = old_particles_[index];
+        }
+        noises_.swap(next_noises_);
+        old_particles_.swap(next_old_particles_);
+        for (int i = 0; i < sample_count; i++)
+        {
+            belief_.location(i) = next_locations_[i];
+        }
+    }
+
+    /**
+     * \brief Computes the weighted mean of the particles and expresses every
+     *        particle relative to it, as State::subtract() does.
+     *
+     * Both passes run on the workers of the propagation. The partial sums
+     * of the workers are added in worker order, hence the mean only depends
+     * on the particles and thread_count().
+     *
+     * \return the mean before the recentring
+     */
+    State recenter()
+    {
+        const int count = belief_.size();
+
+        State zero = belief_.location(0);
+        zero.setZero();
+        partial_means_.assign(thread_pool_->thread_count(), zero);
+        thread_pool_->parallel_for(
+            count, [this](int begin, int end, int worker) {
+                State& sum = partial_means_[worker];
+                for (int i = begin; i < end; i++)
+                {
+                    sum += belief_.prob_mass(i) * belief_.location(i);
+                }
+            });
+
+        State mean = partial_means_[0];
+        for (size_t i = 1; i < partial_means_.size(); i++)
+        {
+            mean += partial_means_[i];
+        }
+
+        mean_cache_.set(mean);
+        thread_pool_->parallel_for(count, [this](int begin, int end, int) {
+            for (int i = begin; i < end; i++)
+            {
+                mean_cache_.subtract_from(belief_.location(i));
+            }
+        });
+
+        return mean;
     }
 
     /// accessors **************************************************************
@@ -161,8 +412,60 @@ public:
         return sampling_blocks_;
     }
 
+    ResamplingStrategy resampling_strategy() const
+    {
+        return resampling_strategy_;
+    }
+
     /// mutators ***************************************************************
     Belief& belief() { return belief_; }
+    void set_resampling_strategy(const ResamplingStrategy& strategy)
+    {
+        resampling_strategy_ = strategy;
+    }
+
+    /**
+     * \brief Sets the number of threads the particles are propagated on. The
+     *        transition must be safe to evaluate concurrently, which holds
+     *        for the const linear transition of the object trackers.
+     *
+     * \param cpus  CPUs the threads are placed on, see ThreadPool
+     */
+    void set_thread_count(int thread_count,
+                          const ThreadPool::CpuSet& cpus = ThreadPool::CpuSet())
+    {
+        thread_pool_ = std::make_shared<ThreadPool>(thread_count, cpus);
+    }
+
+    int thread_count() const { return thread_pool_->thread_count(); }
+
+    /**
+     * \brief Sets the time in seconds a call to filter() should take at most,
+     *        zero disables the budget. The filter measures the cost of the
+     *        blocks and, once the remaining blocks do not fit into the budget
+     *        anymore, samples all of them jointly in a single last block. The
+     *        samples then depend on the timing.
+     */
+    void set_time_budget(double seconds) { time_budget_ = seconds; }
+
+    double time_budget() const { return time_budget_; }
+
+    /**
+     * \brief Sets the number of blocks evaluated one by one at most, the
+     *        remaining ones are sampled jointly in a last block like with the
+     *        time budget. Zero evaluates all blocks.
+     */
+    void set_max_block_count(int count) { max_block_count_ = count; }
+
+    int max_block_count() const { return max_block_count_; }
+
+    /**
+     * \brief Number of blocks evaluated in the last call of filter(),
+     *        smaller than the number of sampling blocks if blocks have been
+     *        merged to meet the time budget
+     */
+    int evaluated_block_count() const { return evaluated_block_count_; }
+
     void set_particles(const std::vector<State>& samples)
     {
         belief_.set_uniform(samples.size());
@@ -170,14 +473,63 @@ public:
             belief_.location(i) = samples[i];
 
         indices_ = IntArray::Zero(belief_.size());
-        loglikes_ = RealArray::Zero(belief_.size());
-        noises_ = std::vector<Noise>(
-            belief_.size(), Noise::Zero(transition_->noise_dimension()));
+        resize_workspaces(belief_.size());
+        loglikes_.setZero();
         old_particles_ = belief_.locations();
 
         sensor_->reset();
     }
 
+    /**
+     * \brief Copies the particles, their normalized log weights and the
+     *        occlusions the sensor keeps for them. occlusions is left empty
+     *        if the sensor does not keep any.
+     */
+    void save(std::vector<State>& particles,
+              RealArray& log_weights,
+              OcclusionSnapshot& occlusions)
+    {
+        particles.resize(belief_.size());
+        for (int i = 0; i < belief_.size(); i++)
+        {
+            particles[i] = belief_.location(i);
+        }
+        log_weights = belief_.log_prob_mass();
+
+        if (!sensor_->save_occlusions(indices_, occlusions))
+        {
+            occlusions = OcclusionSnapshot();
+        }
+    }
+
+    /**
+     * \brief Restores the belief of save(). If the occlusions do not fit
+     *        the sensor, they start over as after set_particles().
+     *
+     * \return whether the occlusions have been restored
+     */
+    bool load(const std::vector<State>& particles,
+              const RealArray& log_weights,
+              const OcclusionSnapshot& occlusions)
+    {
+        set_particles(particles);
+        belief_.log_unnormalized_prob_mass(log_weights);
+        if (sensor_->has_device_weights())
+        {
+            sensor_->set_device_log_weights(log_weights);
+        }
+
+        if (occlusions.particle_count != belief_.size() ||
+            !sensor_->load_occlusions(occlusions))
+        {
+            return false;
+        }
+
+        // particle i owns the occlusions at index i
+        for (int i = 0; i < belief_.size(); i++) indices_[i] = i;
+        return true;
+    }
+
     std::shared_ptr<Sensor> sensor()
     {
         return sensor_;
@@ -188,15 +540,87 @@ public:
         return transition_;
     }
 
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static double seconds(const Clock::duration& duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    /**
+     * \brief Resizes the per particle workspaces. Eigen and std::vector keep
+     *        their memory if the size does not change, so this only
+     *        allocates if the number of particles changed.
+     */
+    void resize_workspaces(const int sample_count)
+    {
+        if (indices_.size() != sample_count)
+        {
+            indices_ = IntArray::Zero(sample_count);
+        }
+        loglikes_.resize(sample_count);
+        new_loglikes_.resize(sample_count);
+        log_weights_.resize(sample_count);
+        old_particles_.resize(sample_count);
+        resize_noises(noises_, sample_count);
+        account_memory();
+    }
+
+    void resize_resampling_workspaces(const int sample_count)
+    {
+        parents_.resize(sample_count);
+        next_indices_.resize(sample_count);
+        next_loglikes_.resize(sample_count);
+        next_locations_.resize(sample_count);
+        next_old_particles_.resize(sample_count);
+        resize_noises(next_noises_, sample_count);
+        account_memory();
+    }
+
+    /** \brief Updates the accounted memory of the particles and noises */
+    void account_memory()
+    {
+        const size_t particle_count = belief_.size() + old_particles_.size() +
+                                      next_locations_.size() +
+                                      next_old_particles_.size();
+        const size_t state_dimension =
+            belief_.size() > 0 ? belief_.location(0).size() : 0;
+        particles_account_.set(particle_count * state_dimension *
+                               sizeof(fl::Real));
+        noises_account_.set((noises_.size() + next_noises_.size()) *
+                            transition_->noise_dimension() * sizeof(fl::Real));
+    }
+
+    void resize_noises(NoiseVector& noises, const int sample_count)
+    {
+        // the prototype noise would allocate, hence the check
+        if (noises.size() == size_t(sample_count)) return;
+
+        noises.resize(sample_count,
+                      Noise::Zero(transition_->noise_dimension()));
+    }
+
 private:
     /// member variables *******************************************************
     Belief belief_;
     IntArray indices_;
 
-    std::vector<Noise> noises_;
+    NoiseVector noises_;
     StateArray old_particles_;
     RealArray loglikes_;
 
+    // workspaces, they keep their memory from frame to frame
+    RealArray new_loglikes_;
+    RealArray log_weights_;
+    RealArray weights_;
+    IntArray parents_;
+    IntArray next_indices_;
+    NoiseVector next_noises_;
+    StateArray next_locations_;
+    StateArray next_old_particles_;
+    RealArray next_loglikes_;
+
     // models
     std::shared_ptr<Sensor> sensor_;
     std::shared_ptr<Transition> transition_;
@@ -204,8 +628,30 @@ private:
     // parameters
     std::vector<std::vector<int>> sampling_blocks_;
     fl::Real max_kl_divergence_;
-
-    // distribution for sampling
-    fl::Gaussian<Eigen::Matrix<fl::Real, 1, 1>> unit_gaussian_;
+    ResamplingStrategy resampling_strategy_;
+
+    // random number generation
+    std::mt19937 generator_;
+    BatchGaussian noise_generator_;
+    std::uint64_t noise_counter_;
+    std::vector<fl::Real> block_noise_;
+
+    // workers of the propagation
+    std::shared_ptr<ThreadPool> thread_pool_;
+
+    // workspaces of recenter()
+    std::vector<State, Eigen::aligned_allocator<State>> partial_means_;
+    PoseCache mean_cache_;
+
+    // time budget of a frame and the running average cost of a block
+    double time_budget_;
+    double block_cost_;
+    int max_block_count_;
+    int evaluated_block_count_;
+    std::vector<int> merged_block_;
+
+    // host memory of the particle sets in MemoryUsage
+    MemoryAccount particles_account_;
+    MemoryAccount noises_account_;
 };
 }
@@ -0,0 +1,312 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file rao_blackwell_coordinate_particle_filter_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+
+#include <dbot/filter/rao_blackwell_coordinate_particle_filter.h>
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+
+namespace
+{
+// number of heap allocations of this test binary
+size_t allocation_count = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    allocation_count++;
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+namespace
+{
+template <typename State_, int Dimension>
+struct TestTransition
+{
+    typedef State_ State;
+    typedef State_ Input;
+    typedef Eigen::VectorXd Noise;
+
+    int noise_dimension() const { return Dimension; }
+    State state(const State& state, const Noise& noise, const Input& input)
+    {
+        return state + 0.01 * noise + input;
+    }
+};
+
+template <typename State_>
+struct TestSensor
+{
+    typedef State_ State;
+    typedef State_ Observation;
+    typedef Eigen::Array<State, -1, 1> StateArray;
+    typedef Eigen::Array<fl::Real, -1, 1> RealArray;
+    typedef Eigen::Array<int, -1, 1> IntArray;
+
+    void set_observation(const Observation& observation)
+    {
+        observation_ = observation;
+    }
+
+    void compute_loglikes(const StateArray& states,
+                          IntArray& indices,
+                          const bool& update,
+                          RealArray& log_likelihoods)
+    {
+        log_likelihoods.resize(states.size());
+        for (int i = 0; i < states.size(); i++)
+        {
+            log_likelihoods[i] = -(states[i] - observation_).squaredNorm();
+            if (update) indices[i] = i;
+        }
+    }
+
+    void reset() {}
+
+    // the weights are always kept by the filter
+    bool has_device_weights() const { return false; }
+    fl::Real compute_device_weights(const StateArray&, const bool)
+    {
+        return 0;
+    }
+    void resample_device_weights(const fl::Real, IntArray&) {}
+    void device_log_weights(RealArray&) {}
+    void set_device_log_weights(const RealArray&) {}
+
+    // the occlusion rows are represented by the indices they were saved from
+    bool save_occlusions(const IntArray& indices,
+                         dbot::OcclusionSnapshot& snapshot)
+    {
+        snapshot.particle_count = indices.size();
+        snapshot.occlusions.assign(indices.data(),
+                                   indices.data() + indices.size());
+        return true;
+    }
+    bool load_occlusions(const dbot::OcclusionSnapshot& snapshot)
+    {
+        loaded_occlusions = snapshot.occlusions;
+        return true;
+    }
+
+    Observation observation_;
+    std::vector<float> loaded_occlusions;
+};
+
+typedef TestTransition<Eigen::Vector3d, 3> Transition;
+typedef TestSensor<Eigen::Vector3d> Sensor;
+typedef dbot::RaoBlackwellCoordinateParticleFilter<Transition, Sensor> Filter;
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, steady_state_does_not_allocate)
+{
+    std::vector<std::vector<int>> sampling_blocks = {{0, 1}, {2}};
+    Filter filter(std::make_shared<Transition>(),
+                  std::make_shared<Sensor>(),
+                  sampling_blocks);
+
+    filter.set_particles(std::vector<Eigen::Vector3d>(
+        100, Eigen::Vector3d::Zero()));
+
+    const Eigen::Vector3d observation(0.1, 0.2, 0.3);
+    const Eigen::Vector3d input = Eigen::Vector3d::Zero();
+
+    // the first frames size the workspaces
+    filter.filter(observation, input);
+    filter.filter(observation, input);
+
+    size_t allocations = allocation_count;
+    for (int i = 0; i < 10; i++)
+    {
+        filter.filter(observation, input);
+    }
+    EXPECT_EQ(allocation_count, allocations);
+    EXPECT_EQ(filter.belief().size(), 100);
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, threads_do_not_change_result)
+{
+    std::vector<std::vector<int>> sampling_blocks = {{0}, {1, 2}};
+    Filter serial(std::make_shared<Transition>(),
+                  std::make_shared<Sensor>(),
+                  sampling_blocks);
+    Filter parallel(std::make_shared<Transition>(),
+                    std::make_shared<Sensor>(),
+                    sampling_blocks);
+    parallel.set_thread_count(4);
+
+    std::vector<Eigen::Vector3d> particles(50, Eigen::Vector3d::Zero());
+    serial.set_particles(particles);
+    parallel.set_particles(particles);
+
+    const Eigen::Vector3d observation(0.1, -0.2, 0.3);
+    const Eigen::Vector3d input = Eigen::Vector3d::Zero();
+    for (int i = 0; i < 5; i++)
+    {
+        serial.filter(observation, input);
+        parallel.filter(observation, input);
+    }
+
+    for (int i = 0; i < serial.belief().size(); i++)
+    {
+        EXPECT_EQ(serial.belief().location(i), parallel.belief().location(i));
+    }
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, time_budget_merges_blocks)
+{
+    std::vector<std::vector<int>> sampling_blocks = {{0}, {1}, {2}};
+    Filter filter(std::make_shared<Transition>(),
+                  std::make_shared<Sensor>(),
+                  sampling_blocks);
+    filter.set_particles(std::vector<Eigen::Vector3d>(
+        20, Eigen::Vector3d::Zero()));
+
+    const Eigen::Vector3d observation(0.1, 0.2, 0.3);
+    const Eigen::Vector3d input = Eigen::Vector3d::Zero();
+
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 3);
+
+    // once the cost of a block is known, no block fits into the budget and
+    // all of them are sampled at once
+    filter.set_time_budget(1e-12);
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 1);
+    EXPECT_EQ(filter.belief().size(), 20);
+
+    filter.set_time_budget(0);
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 3);
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, block_limit_merges_blocks)
+{
+    std::vector<std::vector<int>> sampling_blocks = {{0}, {1}, {2}};
+    Filter filter(std::make_shared<Transition>(),
+                  std::make_shared<Sensor>(),
+                  sampling_blocks);
+    filter.set_particles(std::vector<Eigen::Vector3d>(
+        20, Eigen::Vector3d::Zero()));
+
+    const Eigen::Vector3d observation(0.1, 0.2, 0.3);
+    const Eigen::Vector3d input = Eigen::Vector3d::Zero();
+
+    // the first block on its own, the other two jointly
+    filter.set_max_block_count(2);
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 2);
+
+    filter.set_max_block_count(1);
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 1);
+
+    filter.set_max_block_count(0);
+    filter.filter(observation, input);
+    EXPECT_EQ(filter.evaluated_block_count(), 3);
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, recenter_subtracts_the_mean)
+{
+    typedef dbot::FreeFloatingRigidBodiesState<> State;
+    typedef TestTransition<State, 12> RigidBodyTransition;
+    typedef dbot::RaoBlackwellCoordinateParticleFilter<RigidBodyTransition,
+                                                       TestSensor<State>>
+        RigidBodyFilter;
+
+    std::vector<std::vector<int>> sampling_blocks = {{0, 1, 2, 3, 4, 5},
+                                                     {6, 7, 8, 9, 10, 11}};
+    RigidBodyFilter filter(std::make_shared<RigidBodyTransition>(),
+                           std::make_shared<TestSensor<State>>(),
+                           sampling_blocks);
+    filter.set_thread_count(3);
+
+    srand(4);
+    std::vector<State> particles(40, State(1));
+    for (auto& particle : particles)
+    {
+        particle.setRandom();
+        particle *= 0.1;
+    }
+    filter.set_particles(particles);
+
+    State observation(1);
+    observation.setZero();
+    observation(2) = 0.05;
+    State input(1);
+    input.setZero();
+    filter.filter(observation, input);
+
+    const State expected_mean = filter.belief().mean();
+    std::vector<State> expected;
+    for (int i = 0; i < filter.belief().size(); i++)
+    {
+        expected.push_back(filter.belief().location(i));
+        expected.back().subtract(expected_mean);
+    }
+
+    const State mean = filter.recenter();
+    EXPECT_TRUE((mean - expected_mean).isZero(1e-12));
+    for (int i = 0; i < filter.belief().size(); i++)
+    {
+        EXPECT_TRUE((filter.belief().location(i) - expected[i]).isZero(1e-10));
+    }
+}
+
+TEST(RaoBlackwellCoordinateParticleFilterTests, load_restores_the_belief)
+{
+    std::vector<std::vector<int>> sampling_blocks = {{0}, {1, 2}};
+    Filter filter(std::make_shared<Transition>(),
+                  std::make_shared<Sensor>(),
+                  sampling_blocks);
+    filter.set_particles(
+        std::vector<Eigen::Vector3d>(30, Eigen::Vector3d::Zero()));
+    filter.filter(Eigen::Vector3d(0.1, 0.2, 0.3), Eigen::Vector3d::Zero());
+
+    std::vector<Eigen::Vector3d> particles;
+    Filter::RealArray log_weights;
+    dbot::OcclusionSnapshot occlusions;
+    filter.save(particles, log_weights, occlusions);
+    ASSERT_EQ(particles.size(), 30u);
+    EXPECT_EQ(occlusions.particle_count, 30);
+
+    auto sensor = std::make_shared<Sensor>();
+    Filter restored(std::make_shared<Transition>(), sensor, sampling_blocks);
+    ASSERT_TRUE(restored.load(particles, log_weights, occlusions));
+    ASSERT_EQ(restored.belief().size(), 30);
+    for (int i = 0; i < 30; i++)
+    {
+        EXPECT_EQ(restored.belief().location(i), filter.belief().location(i));
+        EXPECT_NEAR(restored.belief().prob_mass(i),
+                    filter.belief().prob_mass(i),
+                    1e-12);
+    }
+    EXPECT_EQ(sensor->loaded_occlusions, occlusions.occlusions);
+
+    // occlusions of a different number of particles are not restored
+    occlusions.particle_count = 29;
+    EXPECT_FALSE(restored.load(particles, log_weights, occlusions));
+}
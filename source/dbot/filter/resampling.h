@@ -0,0 +1,172 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file resampling.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace dbot
+{
+/**
+ * \brief Scheme used to pick the parents of the next particle generation
+ */
+enum class ResamplingStrategy
+{
+    /** independent draws from the weights, generated in sorted order */
+    multinomial,
+    /** a single uniform offset for N evenly spaced positions */
+    systematic,
+    /** one uniform draw within each of the N strata */
+    stratified,
+    /** floor(N w_i) deterministic copies, the rest systematically */
+    residual
+};
+
+namespace internal
+{
+/**
+ * \brief Walks the cumulative weights along ascending positions in [0, 1)
+ *        and writes the index of the interval containing each position.
+ *
+ * \param position	position(k) of the k-th sample, ascending in k
+ */
+template <typename Weights, typename Position>
+void walk_cumulative_weights(const Weights& weights,
+                             const int weight_count,
+                             const int sample_count,
+                             Position position,
+                             int* indices)
+{
+    int i = 0;
+    double cumulative = weights[0];
+    for (int k = 0; k < sample_count; k++)
+    {
+        const double u = position(k);
+        while (u >= cumulative && i < weight_count - 1)
+        {
+            cumulative += weights[++i];
+        }
+        indices[k] = i;
+    }
+}
+}
+
+/**
+ * \brief Picks sample_count parent indices from the normalized weights.
+ *
+ * All strategies make a single pass over the weights, i.e. they run in
+ * O(weight_count + sample_count) without any cumulative weight search. The
+ * indices are ascending, except for residual resampling which returns the
+ * deterministic copies followed by the ascending residual draws.
+ *
+ * \param weights		normalized weights, accessed through operator[]
+ * \param indices		output, sample_count parent indices
+ */
+template <typename Weights, typename Generator>
+void resample_indices(const ResamplingStrategy strategy,
+                      const Weights& weights,
+                      const int weight_count,
+                      const int sample_count,
+                      Generator& generator,
+                      int* indices)
+{
+    if (weight_count <= 0 || sample_count <= 0) return;
+
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    const double spacing = 1. / sample_count;
+
+    switch (strategy)
+    {
+        case ResamplingStrategy::systematic:
+        {
+            const double offset = uniform(generator);
+            internal::walk_cumulative_weights(
+                weights, weight_count, sample_count,
+                [&](int k) { return (k + offset) * spacing; },
+                indices);
+            break;
+        }
+        case ResamplingStrategy::stratified:
+        {
+            internal::walk_cumulative_weights(
+                weights, weight_count, sample_count,
+                [&](int k) { return (k + uniform(generator)) * spacing; },
+                indices);
+            break;
+        }
+        case ResamplingStrategy::residual:
+        {
+            // deterministic copies of the integer parts
+            int count = 0;
+            double residual_sum = 0;
+            for (int i = 0; i < weight_count; i++)
+            {
+                const double expected = weights[i] * sample_count;
+                const int copies =
+                    std::min(int(expected), sample_count - count);
+                for (int c = 0; c < copies; c++) indices[count++] = i;
+                residual_sum += expected - copies;
+            }
+            if (count == sample_count) break;
+
+            // the remaining samples are drawn systematically from the
+            // residuals, which are recomputed on the fly
+            const int remaining = sample_count - count;
+            const double step = residual_sum / remaining;
+            const double offset = uniform(generator) * step;
+
+            int i = 0;
+            double cumulative = 0;
+            int k = 0;
+            int* residual_indices = indices + count;
+            for (; i < weight_count && k < remaining; i++)
+            {
+                const double expected = weights[i] * sample_count;
+                cumulative += expected - std::floor(expected);
+                while (k < remaining && offset + k * step < cumulative)
+                {
+                    residual_indices[k++] = i;
+                }
+            }
+            // guard against rounding in the last interval
+            for (; k < remaining; k++) residual_indices[k] = weight_count - 1;
+            break;
+        }
+        case ResamplingStrategy::multinomial:
+        {
+            // the sorted uniform order statistics are generated from the
+            // largest one downwards and matched against the weights from
+            // the top
+            double u = 1.;
+            int i = weight_count - 1;
+            double lower = 1. - weights[i];
+            for (int k = sample_count - 1; k >= 0; k--)
+            {
+                u *= std::pow(uniform(generator), 1. / (k + 1));
+                while (u < lower && i > 0)
+                {
+                    lower -= weights[--i];
+                }
+                indices[k] = i;
+            }
+            break;
+        }
+    }
+}
+}
@@ -0,0 +1,124 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file resampling_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <dbot/filter/resampling.h>
+
+using dbot::ResamplingStrategy;
+
+namespace
+{
+const std::vector<double> weights = {0.05, 0.3, 0.0, 0.15, 0.25, 0.25};
+
+std::vector<int> count_children(ResamplingStrategy strategy,
+                                int sample_count,
+                                std::mt19937& generator)
+{
+    std::vector<int> indices(sample_count, -1);
+    dbot::resample_indices(strategy,
+                           weights,
+                           weights.size(),
+                           sample_count,
+                           generator,
+                           indices.data());
+
+    std::vector<int> counts(weights.size(), 0);
+    for (int k = 0; k < sample_count; k++)
+    {
+        EXPECT_GE(indices[k], 0);
+        EXPECT_LT(indices[k], int(weights.size()));
+        counts[indices[k]]++;
+    }
+    return counts;
+}
+}
+
+TEST(ResamplingTests, low_variance_strategies_respect_expected_counts)
+{
+    std::mt19937 generator(1);
+    const int sample_count = 40;
+
+    for (int trial = 0; trial < 100; trial++)
+    {
+        auto systematic = count_children(
+            ResamplingStrategy::systematic, sample_count, generator);
+        auto residual = count_children(
+            ResamplingStrategy::residual, sample_count, generator);
+
+        for (size_t i = 0; i < weights.size(); i++)
+        {
+            double expected = weights[i] * sample_count;
+            EXPECT_GE(systematic[i], int(std::floor(expected)));
+            EXPECT_LE(systematic[i], int(std::ceil(expected)));
+            EXPECT_GE(residual[i], int(std::floor(expected)));
+        }
+        EXPECT_EQ(systematic[2], 0);
+        EXPECT_EQ(residual[2], 0);
+    }
+}
+
+TEST(ResamplingTests, random_strategies_are_unbiased)
+{
+    std::mt19937 generator(1);
+    const int sample_count = 50;
+    const int trials = 2000;
+
+    const ResamplingStrategy strategies[] = {ResamplingStrategy::multinomial,
+                                             ResamplingStrategy::stratified};
+    for (auto strategy : strategies)
+    {
+        std::vector<double> mean(weights.size(), 0);
+        for (int trial = 0; trial < trials; trial++)
+        {
+            auto counts = count_children(strategy, sample_count, generator);
+            for (size_t i = 0; i < weights.size(); i++)
+            {
+                mean[i] += counts[i] / double(trials);
+            }
+        }
+
+        for (size_t i = 0; i < weights.size(); i++)
+        {
+            EXPECT_NEAR(mean[i], weights[i] * sample_count, 0.3);
+        }
+    }
+}
+
+TEST(ResamplingTests, indices_are_sorted)
+{
+    std::mt19937 generator(1);
+    const ResamplingStrategy strategies[] = {ResamplingStrategy::multinomial,
+                                             ResamplingStrategy::systematic,
+                                             ResamplingStrategy::stratified};
+    for (auto strategy : strategies)
+    {
+        std::vector<int> indices(30);
+        dbot::resample_indices(strategy,
+                               weights,
+                               weights.size(),
+                               indices.size(),
+                               generator,
+                               indices.data());
+        EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+    }
+}
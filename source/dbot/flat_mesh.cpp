@@ -0,0 +1,114 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file flat_mesh.cpp
+ */
+
+#include <dbot/flat_mesh.h>
+
+namespace dbot
+{
+FlatMesh::FlatMesh() : vertex_offsets_(1, 0), triangle_offsets_(1, 0)
+{
+}
+
+FlatMesh::FlatMesh(const Vertices& vertices, const TriangleIndices& indices)
+    : vertex_offsets_(1, 0), triangle_offsets_(1, 0)
+{
+    size_t vertex_count = 0;
+    size_t triangle_count = 0;
+    for (size_t part = 0; part < vertices.size(); part++)
+    {
+        vertex_count += vertices[part].size();
+        if (part < indices.size()) triangle_count += indices[part].size();
+    }
+    positions_.reserve(3 * vertex_count);
+    indices_.reserve(3 * triangle_count);
+
+    for (size_t part = 0; part < vertices.size(); part++)
+    {
+        const std::uint32_t first_vertex = vertex_offsets_.back();
+        for (const Eigen::Vector3d& vertex : vertices[part])
+        {
+            positions_.push_back(vertex(0));
+            positions_.push_back(vertex(1));
+            positions_.push_back(vertex(2));
+        }
+
+        int part_triangles = 0;
+        if (part < indices.size())
+        {
+            for (const std::vector<int>& triangle : indices[part])
+            {
+                indices_.push_back(first_vertex + triangle[0]);
+                indices_.push_back(first_vertex + triangle[1]);
+                indices_.push_back(first_vertex + triangle[2]);
+            }
+            part_triangles = indices[part].size();
+        }
+
+        vertex_offsets_.push_back(first_vertex + vertices[part].size());
+        triangle_offsets_.push_back(triangle_offsets_.back() + part_triangles);
+    }
+}
+
+void FlatMesh::append(const FlatMesh& mesh)
+{
+    const std::uint32_t first_vertex = vertex_count();
+    const int first_triangle = triangle_count();
+
+    positions_.insert(
+        positions_.end(), mesh.positions_.begin(), mesh.positions_.end());
+    for (std::uint32_t index : mesh.indices_)
+    {
+        indices_.push_back(first_vertex + index);
+    }
+
+    for (int part = 0; part < mesh.part_count(); part++)
+    {
+        vertex_offsets_.push_back(first_vertex + mesh.vertex_end(part));
+        triangle_offsets_.push_back(first_triangle + mesh.triangle_end(part));
+    }
+}
+
+auto FlatMesh::vertices() const -> Vertices
+{
+    Vertices vertices(part_count());
+    for (int part = 0; part < part_count(); part++)
+    {
+        for (int i = vertex_begin(part); i < vertex_end(part); i++)
+        {
+            vertices[part].push_back(position(i).cast<double>());
+        }
+    }
+    return vertices;
+}
+
+auto FlatMesh::triangle_indices() const -> TriangleIndices
+{
+    TriangleIndices indices(part_count());
+    for (int part = 0; part < part_count(); part++)
+    {
+        const int first_vertex = vertex_begin(part);
+        for (int i = triangle_begin(part); i < triangle_end(part); i++)
+        {
+            const std::uint32_t* corners = triangle(i);
+            indices[part].push_back({int(corners[0]) - first_vertex,
+                                     int(corners[1]) - first_vertex,
+                                     int(corners[2]) - first_vertex});
+        }
+    }
+    return indices;
+}
+}
@@ -0,0 +1,100 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file flat_mesh.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace dbot
+{
+/**
+ * \brief Triangle meshes of all parts of an object in contiguous arrays.
+ *
+ * The positions of all vertices are stored as x, y, z floats one after the
+ * other and the triangles as three indices into all vertices, such that
+ * both arrays can be uploaded to the GPU as they are. The vertices and
+ * triangles of part i are the ranges [vertex_begin(i), vertex_end(i)) and
+ * [triangle_begin(i), triangle_end(i)), the triangles of a part only refer
+ * to vertices of the same part.
+ */
+class FlatMesh
+{
+public:
+    typedef std::vector<std::vector<Eigen::Vector3d>> Vertices;
+    typedef std::vector<std::vector<std::vector<int>>> TriangleIndices;
+
+public:
+    /**
+     * \brief Creates a mesh without parts
+     */
+    FlatMesh();
+
+    /**
+     * \brief Flattens the per part vertices and triangles, the triangle
+     *        indices refer to the vertices of their part
+     */
+    FlatMesh(const Vertices& vertices, const TriangleIndices& indices);
+
+    /**
+     * \brief Appends the parts of the given mesh after the parts of this mesh
+     */
+    void append(const FlatMesh& mesh);
+
+    int part_count() const { return int(vertex_offsets_.size()) - 1; }
+    int vertex_count() const { return vertex_offsets_.back(); }
+    int triangle_count() const { return triangle_offsets_.back(); }
+
+    int vertex_begin(int part) const { return vertex_offsets_[part]; }
+    int vertex_end(int part) const { return vertex_offsets_[part + 1]; }
+    int triangle_begin(int part) const { return triangle_offsets_[part]; }
+    int triangle_end(int part) const { return triangle_offsets_[part + 1]; }
+
+    /** \brief x, y, z of all vertices */
+    const std::vector<float>& positions() const { return positions_; }
+
+    /** \brief Three vertex indices per triangle */
+    const std::vector<std::uint32_t>& indices() const { return indices_; }
+
+    Eigen::Map<const Eigen::Vector3f> position(int vertex) const
+    {
+        return Eigen::Map<const Eigen::Vector3f>(&positions_[3 * vertex]);
+    }
+
+    const std::uint32_t* triangle(int triangle) const
+    {
+        return &indices_[3 * triangle];
+    }
+
+    /**
+     * \brief Nested per part copies of the vertices and of the triangles,
+     *        with indices relative to their part
+     */
+    Vertices vertices() const;
+    TriangleIndices triangle_indices() const;
+
+private:
+    std::vector<float> positions_;
+    std::vector<std::uint32_t> indices_;
+
+    // part_count() + 1 offsets, the last one is the total count
+    std::vector<int> vertex_offsets_;
+    std::vector<int> triangle_offsets_;
+};
+}
@@ -0,0 +1,93 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file flat_mesh_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <dbot/flat_mesh.h>
+
+namespace
+{
+dbot::FlatMesh::Vertices vertices()
+{
+    dbot::FlatMesh::Vertices vertices(2);
+    vertices[0] = {Eigen::Vector3d(0, 0, 1),
+                   Eigen::Vector3d(1, 0, 1),
+                   Eigen::Vector3d(0, 1, 1)};
+    vertices[1] = {Eigen::Vector3d(0, 0, 2),
+                   Eigen::Vector3d(1, 0, 2),
+                   Eigen::Vector3d(0, 1, 2),
+                   Eigen::Vector3d(1, 1, 2)};
+    return vertices;
+}
+
+dbot::FlatMesh::TriangleIndices indices()
+{
+    dbot::FlatMesh::TriangleIndices indices(2);
+    indices[0] = {{0, 1, 2}};
+    indices[1] = {{0, 1, 2}, {1, 3, 2}};
+    return indices;
+}
+}
+
+TEST(FlatMeshTests, flattens_parts)
+{
+    dbot::FlatMesh mesh(vertices(), indices());
+
+    ASSERT_EQ(mesh.part_count(), 2);
+    EXPECT_EQ(mesh.vertex_count(), 7);
+    EXPECT_EQ(mesh.triangle_count(), 3);
+    EXPECT_EQ(mesh.positions().size(), 21);
+    EXPECT_EQ(mesh.indices().size(), 9);
+
+    EXPECT_EQ(mesh.vertex_begin(1), 3);
+    EXPECT_EQ(mesh.triangle_begin(1), 1);
+
+    // the indices of the second part are shifted by the first part
+    const std::uint32_t* triangle = mesh.triangle(2);
+    EXPECT_EQ(triangle[0], 4);
+    EXPECT_EQ(triangle[1], 6);
+    EXPECT_EQ(triangle[2], 5);
+    EXPECT_EQ(mesh.position(triangle[1]), Eigen::Vector3f(1, 1, 2));
+
+    EXPECT_EQ(mesh.vertices(), vertices());
+    EXPECT_EQ(mesh.triangle_indices(), indices());
+}
+
+TEST(FlatMeshTests, append_matches_joint_construction)
+{
+    const dbot::FlatMesh::Vertices part_vertices = vertices();
+    const dbot::FlatMesh::TriangleIndices part_indices = indices();
+    dbot::FlatMesh::Vertices all_vertices = part_vertices;
+    dbot::FlatMesh::TriangleIndices all_indices = part_indices;
+    all_vertices.insert(
+        all_vertices.end(), part_vertices.begin(), part_vertices.end());
+    all_indices.insert(
+        all_indices.end(), part_indices.begin(), part_indices.end());
+
+    dbot::FlatMesh mesh(part_vertices, part_indices);
+    mesh.append(dbot::FlatMesh(part_vertices, part_indices));
+    const dbot::FlatMesh joint(all_vertices, all_indices);
+
+    ASSERT_EQ(mesh.part_count(), 4);
+    EXPECT_EQ(mesh.positions(), joint.positions());
+    EXPECT_EQ(mesh.indices(), joint.indices());
+    for (int part = 0; part < 4; part++)
+    {
+        EXPECT_EQ(mesh.vertex_begin(part), joint.vertex_begin(part));
+        EXPECT_EQ(mesh.triangle_end(part), joint.triangle_end(part));
+    }
+}
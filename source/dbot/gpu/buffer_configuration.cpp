@@ -18,6 +18,7 @@
  */
 
 #include <boost/lexical_cast.hpp>
+#include <cstdint>
 #include <dbot/gpu/buffer_configuration.h>
 #include <iostream>
 #include <sstream>
@@ -34,7 +35,13 @@ BufferConfiguration::BufferConfiguration(
       evaluator_(evaluator),
       max_nr_poses_(max_nr_poses),
       nr_cols_(nr_cols),
-      nr_rows_(nr_rows)
+      nr_rows_(nr_rows),
+      allocated_nr_rows_(0),
+      allocated_nr_cols_(0),
+      renderings_account_(dbot::MemoryComponent::DeviceRenderings),
+      meshes_account_(dbot::MemoryComponent::DeviceMeshes),
+      observations_account_(dbot::MemoryComponent::DeviceObservations),
+      occlusions_account_(dbot::MemoryComponent::DeviceOcclusions)
 {
     max_texture_size_opengl_ = rasterizer_->get_max_texture_size();
     cuda_device_properties_ = evaluator_->get_device_properties();
@@ -119,6 +126,9 @@ bool BufferConfiguration::allocate_memory(const int max_nr_poses,
     rasterizer_->allocate_textures_for_max_poses(
         max_nr_poses_, max_nr_poses_per_row, max_nr_poses_per_col);
 
+    allocated_nr_rows_ = nr_rows_;
+    allocated_nr_cols_ = nr_cols_;
+    account_memory();
     new_max_nr_poses = max_nr_poses_;
     return true;
 }
@@ -133,12 +143,26 @@ bool BufferConfiguration::set_resolution(const int nr_rows,
     evaluator_->set_resolution(nr_rows, nr_cols);
     rasterizer_->set_resolution(nr_rows, nr_cols);
 
+    // the tiles of a smaller resolution fit into the allocated texture with
+    // the same number of poses per row, only the launch parameters change
+    if (fits_allocation(nr_rows, nr_cols))
+    {
+        new_max_nr_poses = max_nr_poses_;
+        return true;
+    }
+
     bool successfully_allocated_memory =
         allocate_memory(max_nr_poses_, new_max_nr_poses);
 
     return successfully_allocated_memory;
 }
 
+bool BufferConfiguration::fits_allocation(const int nr_rows,
+                                          const int nr_cols) const
+{
+    return nr_rows <= allocated_nr_rows_ && nr_cols <= allocated_nr_cols_;
+}
+
 bool BufferConfiguration::set_nr_of_poses(const int nr_poses, int& new_nr_poses)
 {
     new_nr_poses = nr_poses;
@@ -209,6 +233,20 @@ void BufferConfiguration::set_adapt_to_constraints(bool should_adapt)
     adapt_to_constraints_ = should_adapt;
 }
 
+void BufferConfiguration::account_memory()
+{
+    int constant_need, per_pose_need;
+    rasterizer_->get_memory_need_parameters(
+        nr_rows_, nr_cols_, constant_need, per_pose_need);
+    meshes_account_.set(constant_need);
+    renderings_account_.set(std::uint64_t(per_pose_need) * max_nr_poses_);
+
+    evaluator_->get_memory_need_parameters(
+        nr_rows_, nr_cols_, constant_need, per_pose_need);
+    observations_account_.set(constant_need);
+    occlusions_account_.set(std::uint64_t(per_pose_need) * max_nr_poses_);
+}
+
 // ========================================================== //
 // ========= Functions for checking GPU constraints ========= //
 // ========================================================== //
@@ -256,20 +294,26 @@ bool BufferConfiguration::check_against_global_memory_constraint(
     evaluator_->get_memory_need_parameters(
         nr_rows_, nr_cols_, constant_need_evaluator, per_pose_need_evaluator);
 
-    int constant_needs = constant_need_rasterizer + constant_need_evaluator;
-    int per_pose_needs = per_pose_need_rasterizer + per_pose_need_evaluator;
+    // a few hundred poses at VGA exceed the range of int
+    const std::uint64_t constant_needs =
+        std::uint64_t(constant_need_rasterizer) + constant_need_evaluator;
+    const std::uint64_t per_pose_needs =
+        std::uint64_t(per_pose_need_rasterizer) + per_pose_need_evaluator;
 
-    int memory_needs = constant_needs + per_pose_needs * nr_poses;
+    const std::uint64_t memory_needs =
+        constant_needs + per_pose_needs * nr_poses;
 
-    new_nr_poses = std::min(
+    const std::uint64_t total_memory = cuda_device_properties_.totalGlobalMem;
+    new_nr_poses = std::min<std::uint64_t>(
         nr_poses,
-        (int)(cuda_device_properties_.totalGlobalMem - constant_needs) /
-            per_pose_needs);
+        total_memory > constant_needs
+            ? (total_memory - constant_needs) / per_pose_needs
+            : 0);
 
     compute_grid_layout(
         new_nr_poses, new_nr_poses_per_row, new_nr_poses_per_col);
 
-    return memory_needs > cuda_device_properties_.totalGlobalMem;
+    return memory_needs > total_memory;
 }
 
 bool BufferConfiguration::check_against_thread_constraint(const int nr_threads,
@@ -22,6 +22,7 @@
 #include <boost/shared_ptr.hpp>
 #include <dbot/gpu/cuda_likelihood_evaluator.h>
 #include <dbot/gpu/object_rasterizer.h>
+#include <dbot/memory_planner.h>
 
 /**
  * \brief This class takes care of synchronizing the number of poses and other
@@ -65,6 +66,10 @@ public:
     bool allocate_memory(int max_nr_poses, int& new_max_nr_poses);
     /**
      * \brief Set the resolution to a new value.
+     * A resolution which fits the one the memory was allocated for, like a
+     * downsampled one under load, keeps the buffers and only changes the
+     * size of the tiles and the launch parameters. A larger one reallocates
+     * all buffers, see fits_allocation().
      * \param [in] nr_rows the new vertical resolution
      * \param [in] nr_cols the new horizontal resolution
      * \param new_max_nr_poses [out] the reduced maximum number of poses that
@@ -78,6 +83,12 @@ public:
                         const int nr_cols,
                         int& new_max_nr_poses);
 
+    /**
+     * \brief Whether set_resolution() to this resolution keeps the allocated
+     * buffers
+     */
+    bool fits_allocation(const int nr_rows, const int nr_cols) const;
+
     /**
      * \brief Set the number of poses to be evaluated in the next frame
      * \param [in] nr_poses the number of poses that you want to evaluate in
@@ -112,6 +123,16 @@ public:
      */
     void set_adapt_to_constraints(bool should_adapt);
 
+    /**
+     * \brief Device bytes of the allocated buffers, as accounted in
+     * dbot::MemoryUsage
+     */
+    std::uint64_t allocated_bytes() const
+    {
+        return renderings_account_.bytes() + meshes_account_.bytes() +
+               observations_account_.bytes() + occlusions_account_.bytes();
+    }
+
 private:
     enum message_type
     {
@@ -130,6 +151,8 @@ private:
                                                 int& new_nr_poses,
                                                 int& new_nr_poses_per_row,
                                                 int& new_nr_poses_per_col);
+    /** \brief Accounts the buffers of the current allocation */
+    void account_memory();
     bool check_against_thread_constraint(const int nr_threads,
                                          int& new_nr_threads);
     void issue_message(const BufferConfiguration::message_type foo,
@@ -148,6 +171,16 @@ private:
     int nr_rows_;
     int nr_threads_;
 
+    // resolution the buffers were allocated for, 0 before allocate_memory()
+    int allocated_nr_rows_;
+    int allocated_nr_cols_;
+
+    // device memory of the allocation in dbot::MemoryUsage
+    dbot::MemoryAccount renderings_account_;
+    dbot::MemoryAccount meshes_account_;
+    dbot::MemoryAccount observations_account_;
+    dbot::MemoryAccount occlusions_account_;
+
     bool adapt_to_constraints_;
 
     // GPU contraints
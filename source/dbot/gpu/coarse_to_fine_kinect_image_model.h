@@ -0,0 +1,233 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file coarse_to_fine_kinect_image_model.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <dbot/depth_preprocessor.h>
+#include <dbot/gpu/coarse_to_fine_selection.h>
+#include <dbot/gpu/kinect_image_model_gpu.h>
+#include <dbot/model/rao_blackwell_sensor.h>
+#include <dbot/trace_recorder.h>
+
+namespace dbot
+{
+/**
+ * \brief Kinect image model which scores all particles on a downsampled
+ *        image and only the best of them again at full resolution.
+ *
+ * The coarse sensor evaluates every particle on the observation reduced by
+ * a DepthPreprocessor, the same downsampling CameraData applies to the
+ * camera frames, and keeps the occlusions of all particles. The fine
+ * sensor evaluates the refined fraction of the particles with the highest
+ * coarse log likelihoods, see CoarseToFineSelection for how their
+ * occlusions are taken over from the coarse level. Since the fine sensor
+ * only renders a fraction of the particles, far more particles fit into
+ * the same GPU time.
+ *
+ * The particle weights are not kept on the device.
+ */
+template <typename State>
+class CoarseToFineKinectImageModel : public RbSensor<State>
+{
+public:
+    typedef RbSensor<State> Base;
+    typedef KinectImageModelGPU<State> Level;
+
+    typedef typename Base::Observation Observation;
+    typedef typename Base::StateArray StateArray;
+    typedef typename Base::RealArray RealArray;
+    typedef typename Base::IntArray IntArray;
+
+public:
+    /**
+     * \param coarse      sensor of the observations downsampled by factor,
+     *                    evaluating all particles
+     * \param fine        sensor of the full resolution
+     * \param nr_rows, nr_cols  full resolution
+     * \param fraction    of the particles which the fine sensor evaluates,
+     *                    at most its max_sample_count()
+     * \param part_count  number of objects of the state
+     */
+    CoarseToFineKinectImageModel(const std::shared_ptr<Level>& coarse,
+                                 const std::shared_ptr<Level>& fine,
+                                 int nr_rows,
+                                 int nr_cols,
+                                 int factor,
+                                 double fraction,
+                                 int part_count,
+                                 double delta_time)
+        : Base(delta_time),
+          coarse_(coarse),
+          fine_(fine),
+          nr_rows_(nr_rows),
+          nr_cols_(nr_cols),
+          coarse_rows_(nr_rows / factor),
+          coarse_cols_(nr_cols / factor),
+          preprocessor_(preprocessor_parameters(factor)),
+          selection_(fine->max_sample_count(), fraction)
+    {
+        this->default_poses_.recount(part_count);
+        this->default_poses_.setZero();
+    }
+
+    /**
+     * \brief Parameters of the preprocessor which reduces the full
+     *        resolution observations for the coarse sensor, the camera
+     *        matrix of the coarse sensor is the one of the preprocessor
+     */
+    static DepthPreprocessor::Parameters preprocessor_parameters(int factor)
+    {
+        DepthPreprocessor::Parameters parameters;
+        parameters.factor = factor;
+        parameters.downsampling = DepthPreprocessor::Downsampling::block_min;
+        return parameters;
+    }
+
+    RealArray loglikes(const StateArray& deltas,
+                       IntArray& occlusion_indices,
+                       const bool& update_occlusions = false)
+    {
+        RealArray log_likelihoods;
+        compute_loglikes(
+            deltas, occlusion_indices, update_occlusions, log_likelihoods);
+        return log_likelihoods;
+    }
+
+    void compute_loglikes(const StateArray& deltas,
+                          IntArray& occlusion_indices,
+                          const bool& update_occlusions,
+                          RealArray& log_likelihoods)
+    {
+        dbot::TraceSpan trace_span("loglikes", "coarse_to_fine_model");
+
+        const int count = deltas.size();
+        parents_.assign(occlusion_indices.data(),
+                        occlusion_indices.data() + count);
+
+        coarse_->integrated_poses() = this->default_poses_;
+        coarse_->compute_loglikes(
+            deltas, occlusion_indices, update_occlusions, coarse_loglikes_);
+
+        selection_.assign(
+            coarse_loglikes_.data(), parents_.data(), count, update_occlusions);
+
+        for (const auto& migration : selection_.migrations())
+        {
+            fine_->set_occlusion_probabilities(
+                migration.fine_slot,
+                upsample(coarse_->occlusion_probabilities(
+                    migration.coarse_slot)));
+        }
+
+        const std::vector<int>& particles = selection_.particles();
+        const std::vector<int>& slots = selection_.slots();
+        fine_deltas_.resize(particles.size());
+        fine_indices_.resize(particles.size());
+        for (size_t l = 0; l < particles.size(); l++)
+        {
+            fine_deltas_[l] = deltas[particles[l]];
+            fine_indices_[l] = slots[l];
+        }
+
+        fine_->integrated_poses() = this->default_poses_;
+        fine_->compute_loglikes(
+            fine_deltas_, fine_indices_, update_occlusions, fine_loglikes_);
+        if (update_occlusions) selection_.commit_update();
+
+        log_likelihoods.resize(count);
+        selection_.fuse(coarse_loglikes_.data(),
+                        fine_loglikes_.data(),
+                        double(nr_rows_ * nr_cols_) /
+                            (coarse_rows_ * coarse_cols_),
+                        count,
+                        log_likelihoods.data());
+    }
+
+    using Base::set_observation;
+
+    void set_observation(const Observation& image)
+    {
+        observation_buffer_.resize(image.size());
+        for (int i = 0; i < image.size(); ++i)
+        {
+            observation_buffer_[i] = image(i);
+        }
+        set_observation(DepthImageView(observation_buffer_.data(),
+                                       observation_buffer_.size()));
+    }
+
+    void set_observation(const DepthImageView& image)
+    {
+        fine_->set_observation(image);
+        preprocessor_.process(image, nr_rows_, nr_cols_, coarse_frame_);
+        coarse_->set_observation(coarse_frame_.view());
+    }
+
+    void reset()
+    {
+        coarse_->reset();
+        fine_->reset();
+        selection_.reset();
+    }
+
+    const std::shared_ptr<Level>& coarse() const { return coarse_; }
+    const std::shared_ptr<Level>& fine() const { return fine_; }
+
+private:
+    /** \brief Full resolution occlusions of coarse ones, nearest pixel */
+    std::vector<float> upsample(const std::vector<float>& coarse) const
+    {
+        std::vector<float> fine(nr_rows_ * nr_cols_);
+        for (int row = 0; row < nr_rows_; row++)
+        {
+            const int coarse_row =
+                std::min(row * coarse_rows_ / nr_rows_, coarse_rows_ - 1);
+            for (int col = 0; col < nr_cols_; col++)
+            {
+                const int coarse_col =
+                    std::min(col * coarse_cols_ / nr_cols_, coarse_cols_ - 1);
+                fine[row * nr_cols_ + col] =
+                    coarse[coarse_row * coarse_cols_ + coarse_col];
+            }
+        }
+        return fine;
+    }
+
+private:
+    std::shared_ptr<Level> coarse_;
+    std::shared_ptr<Level> fine_;
+    int nr_rows_;
+    int nr_cols_;
+    int coarse_rows_;
+    int coarse_cols_;
+
+    DepthPreprocessor preprocessor_;
+    DepthPreprocessor::Frame coarse_frame_;
+    CoarseToFineSelection selection_;
+
+    std::vector<float> observation_buffer_;
+    std::vector<int> parents_;
+    RealArray coarse_loglikes_;
+    StateArray fine_deltas_;
+    IntArray fine_indices_;
+    RealArray fine_loglikes_;
+};
+}
@@ -0,0 +1,266 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file coarse_to_fine_selection.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief Chooses the particles which a coarse to fine evaluation scores
+ *        again at full resolution and keeps track of their occlusions.
+ *
+ * All particles are scored by the coarse sensor, which keeps the occlusions
+ * of all of them, indexed like the occlusions of any other sensor. The
+ * refined particles, the ones with the highest coarse log likelihoods, are
+ * scored by the fine sensor as well. It only has room for the occlusions of
+ * the refined particles, in slots numbered in the order of evaluation.
+ *
+ * A refined particle whose parent was refined as well continues with the
+ * fine occlusions of its parent. The others start from the coarse
+ * occlusions: these migrate, upsampled, into a fine slot no refined
+ * particle refers to before the fine evaluation, see migrations().
+ *
+ * The log likelihoods of the coarse sensor are scaled by the ratio of the
+ * pixel counts and shifted by the mean difference to the fine ones of the
+ * refined particles. They never exceed the lowest refined log likelihood.
+ */
+class CoarseToFineSelection
+{
+public:
+    /** \brief Coarse occlusions to upsample into a fine slot */
+    struct Migration
+    {
+        int coarse_slot;
+        int fine_slot;
+    };
+
+public:
+    /**
+     * \param fine_slots  number of poses the fine sensor evaluates at most
+     * \param fraction    of the particles which are refined
+     */
+    CoarseToFineSelection(int fine_slots, double fraction)
+        : fraction_(fraction),
+          slot_globals_(fine_slots, -1),
+          uniform_(true)
+    {
+    }
+
+    int fine_slots() const { return int(slot_globals_.size()); }
+    double fraction() const { return fraction_; }
+
+    /** \brief Number of refined particles out of count, at least one */
+    int refined_count(int count) const
+    {
+        const int refined = int(std::ceil(fraction_ * count));
+        return std::max(std::min(refined, std::min(count, fine_slots())),
+                        std::min(count, 1));
+    }
+
+    /** \brief All fine slots hold the initial occlusions */
+    void reset()
+    {
+        uniform_ = true;
+        std::fill(slot_globals_.begin(), slot_globals_.end(), -1);
+        global_slots_.clear();
+    }
+
+    /**
+     * \brief Selects the refined particles and assigns their fine slots. The
+     *        migrations have to be carried out before the fine evaluation.
+     *
+     * \param coarse_loglikes  of all count particles
+     * \param parents          occlusion indices of the particles before the
+     *                         coarse evaluation
+     * \param update           whether the coarse evaluation updated the
+     *                         occlusions, particle i then holds its own
+     *                         coarse occlusions at slot i
+     */
+    template <typename Scalar>
+    void assign(const Scalar* coarse_loglikes,
+                const int* parents,
+                int count,
+                bool update)
+    {
+        // the highest coarse log likelihoods, in particle order
+        order_.resize(count);
+        for (int i = 0; i < count; i++) order_[i] = i;
+        const int refined = refined_count(count);
+        std::nth_element(order_.begin(),
+                         order_.begin() + refined,
+                         order_.end(),
+                         [&](int a, int b) {
+                             return coarse_loglikes[a] > coarse_loglikes[b] ||
+                                    (coarse_loglikes[a] == coarse_loglikes[b] &&
+                                     a < b);
+                         });
+        particles_.assign(order_.begin(), order_.begin() + refined);
+        std::sort(particles_.begin(), particles_.end());
+
+        // slots still held by the parents of refined particles
+        slots_.assign(refined, -1);
+        used_.assign(fine_slots(), false);
+        for (int l = 0; l < refined; l++)
+        {
+            const int parent = parents[particles_[l]];
+            if (uniform_)
+            {
+                slots_[l] = 0;
+            }
+            else if (parent < int(global_slots_.size()))
+            {
+                slots_[l] = global_slots_[parent];
+            }
+            if (slots_[l] >= 0) used_[slots_[l]] = true;
+        }
+
+        // the others migrate into free slots, once per coarse slot
+        migrations_.clear();
+        std::map<int, int> migrated;
+        int free_slot = 0;
+        for (int l = 0; l < refined; l++)
+        {
+            if (slots_[l] >= 0) continue;
+
+            const int particle = particles_[l];
+            const int coarse_slot = update ? particle : parents[particle];
+            auto entry = migrated.find(coarse_slot);
+            if (entry != migrated.end())
+            {
+                slots_[l] = entry->second;
+                continue;
+            }
+
+            while (used_[free_slot]) free_slot++;
+            used_[free_slot] = true;
+            release(free_slot);
+
+            Migration migration;
+            migration.coarse_slot = coarse_slot;
+            migration.fine_slot = free_slot;
+            migrations_.push_back(migration);
+            migrated[coarse_slot] = free_slot;
+            slots_[l] = free_slot;
+
+            // without an update the slot keeps the occlusions of the parent
+            if (!update) hold(free_slot, coarse_slot);
+        }
+    }
+
+    /** \brief Refined particles in ascending order */
+    const std::vector<int>& particles() const { return particles_; }
+
+    /** \brief Occlusion index of every refined particle in the fine sensor */
+    const std::vector<int>& slots() const { return slots_; }
+
+    const std::vector<Migration>& migrations() const { return migrations_; }
+
+    /**
+     * \brief Records that the fine evaluation updated the occlusions,
+     *        refined particle l now holds its own occlusions at slot l
+     */
+    void commit_update()
+    {
+        uniform_ = false;
+        std::fill(slot_globals_.begin(), slot_globals_.end(), -1);
+        global_slots_.clear();
+        for (size_t l = 0; l < particles_.size(); l++)
+        {
+            hold(int(l), particles_[l]);
+        }
+    }
+
+    /**
+     * \brief Combines the log likelihoods of both sensors
+     *
+     * \param coarse_loglikes  of all count particles
+     * \param fine_loglikes    of the refined particles, in their order
+     * \param pixel_ratio      fine pixels per coarse pixel
+     */
+    template <typename Scalar>
+    void fuse(const Scalar* coarse_loglikes,
+              const Scalar* fine_loglikes,
+              double pixel_ratio,
+              int count,
+              Scalar* log_likelihoods) const
+    {
+        double offset = 0;
+        double lowest = 0;
+        for (size_t l = 0; l < particles_.size(); l++)
+        {
+            offset += fine_loglikes[l] -
+                      pixel_ratio * coarse_loglikes[particles_[l]];
+            lowest = l == 0 ? fine_loglikes[l]
+                            : std::min(lowest, double(fine_loglikes[l]));
+        }
+        if (!particles_.empty()) offset /= particles_.size();
+
+        for (int i = 0; i < count; i++)
+        {
+            double value = pixel_ratio * coarse_loglikes[i] + offset;
+            if (!particles_.empty()) value = std::min(value, lowest);
+            log_likelihoods[i] = Scalar(value);
+        }
+        for (size_t l = 0; l < particles_.size(); l++)
+        {
+            log_likelihoods[particles_[l]] = fine_loglikes[l];
+        }
+    }
+
+private:
+    /** \brief The slot holds the fine occlusions of the global index */
+    void hold(int slot, int global)
+    {
+        if (global >= int(global_slots_.size()))
+        {
+            global_slots_.resize(global + 1, -1);
+        }
+        global_slots_[global] = slot;
+        slot_globals_[slot] = global;
+    }
+
+    /** \brief The slot is about to be overwritten */
+    void release(int slot)
+    {
+        if (slot_globals_[slot] >= 0)
+        {
+            global_slots_[slot_globals_[slot]] = -1;
+        }
+        slot_globals_[slot] = -1;
+    }
+
+private:
+    double fraction_;
+
+    // global occlusion index held by every fine slot and the other way
+    // round, -1 if none
+    std::vector<int> slot_globals_;
+    std::vector<int> global_slots_;
+    bool uniform_;
+
+    std::vector<int> order_;
+    std::vector<int> particles_;
+    std::vector<int> slots_;
+    std::vector<bool> used_;
+    std::vector<Migration> migrations_;
+};
+}
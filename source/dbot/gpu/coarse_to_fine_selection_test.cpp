@@ -0,0 +1,116 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file coarse_to_fine_selection_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/gpu/coarse_to_fine_selection.h>
+
+TEST(CoarseToFineSelectionTests, refines_the_best_particles_in_order)
+{
+    dbot::CoarseToFineSelection selection(4, 0.3);
+    EXPECT_EQ(selection.refined_count(10), 3);
+    EXPECT_EQ(selection.refined_count(100), 4);
+    EXPECT_EQ(selection.refined_count(1), 1);
+
+    const std::vector<double> coarse = {1, 7, 3, 9, 2, 8, 0, 4, 5, 6};
+    const std::vector<int> parents(10, 0);
+    selection.assign(coarse.data(), parents.data(), 10, true);
+
+    EXPECT_EQ(selection.particles(), std::vector<int>({1, 3, 5}));
+
+    // after a reset all fine slots hold the initial occlusions
+    EXPECT_EQ(selection.slots(), std::vector<int>({0, 0, 0}));
+    EXPECT_TRUE(selection.migrations().empty());
+}
+
+TEST(CoarseToFineSelectionTests, continues_or_migrates_the_occlusions)
+{
+    dbot::CoarseToFineSelection selection(3, 0.5);
+    std::vector<double> coarse = {5, 4, 3, 2, 1, 0};
+    std::vector<int> parents(6, 0);
+    selection.assign(coarse.data(), parents.data(), 6, true);
+    selection.commit_update();
+
+    // particles 0, 1 and 2 of the last update are held in fine slots 0 to 2.
+    // Particles 3 and 5 descend from refined ones, particle 4 from an
+    // unrefined one.
+    coarse = {0, 0, 0, 9, 8, 7};
+    parents = {0, 0, 4, 2, 5, 0};
+    selection.assign(coarse.data(), parents.data(), 6, true);
+
+    EXPECT_EQ(selection.particles(), std::vector<int>({3, 4, 5}));
+    EXPECT_EQ(selection.slots()[0], 2);
+    EXPECT_EQ(selection.slots()[2], 0);
+
+    // the coarse occlusions of particle 4 after the update move into the
+    // only fine slot no refined particle refers to
+    ASSERT_EQ(selection.migrations().size(), 1u);
+    EXPECT_EQ(selection.migrations()[0].coarse_slot, 4);
+    EXPECT_EQ(selection.migrations()[0].fine_slot, 1);
+    EXPECT_EQ(selection.slots()[1], 1);
+}
+
+TEST(CoarseToFineSelectionTests, keeps_migrated_occlusions_without_update)
+{
+    dbot::CoarseToFineSelection selection(2, 0.5);
+    std::vector<double> coarse = {1, 2, 3, 4};
+    std::vector<int> parents = {0, 1, 2, 3};
+    selection.assign(coarse.data(), parents.data(), 4, true);
+    selection.commit_update();
+
+    // both refined particles descend from the unrefined index 0, whose
+    // coarse occlusions migrate once
+    coarse = {4, 3, 2, 1};
+    parents = {0, 0, 2, 3};
+    selection.assign(coarse.data(), parents.data(), 4, false);
+    EXPECT_EQ(selection.particles(), std::vector<int>({0, 1}));
+    ASSERT_EQ(selection.migrations().size(), 1u);
+    EXPECT_EQ(selection.migrations()[0].coarse_slot, 0);
+    EXPECT_EQ(selection.migrations()[0].fine_slot, 0);
+    EXPECT_EQ(selection.slots(), std::vector<int>({0, 0}));
+
+    // the migrated occlusions of index 0 are found again
+    selection.assign(coarse.data(), parents.data(), 4, false);
+    EXPECT_TRUE(selection.migrations().empty());
+    EXPECT_EQ(selection.slots(), std::vector<int>({0, 0}));
+}
+
+TEST(CoarseToFineSelectionTests, fuses_below_the_refined_log_likelihoods)
+{
+    dbot::CoarseToFineSelection selection(2, 0.5);
+    const std::vector<double> coarse = {-10, -2, -1, -20};
+    const std::vector<int> parents(4, 0);
+    selection.assign(coarse.data(), parents.data(), 4, false);
+    ASSERT_EQ(selection.particles(), std::vector<int>({1, 2}));
+
+    // four fine pixels per coarse pixel, the fine ones are 1 higher
+    const std::vector<double> fine = {-7, -3};
+    std::vector<double> fused(4);
+    selection.fuse(coarse.data(), fine.data(), 4.0, 4, fused.data());
+
+    EXPECT_DOUBLE_EQ(fused[1], -7);
+    EXPECT_DOUBLE_EQ(fused[2], -3);
+    EXPECT_DOUBLE_EQ(fused[0], -39);
+    EXPECT_DOUBLE_EQ(fused[3], -79);
+
+    // an unrefined particle never outranks a refined one
+    const std::vector<double> close = {-1.9, -2, -1, -20};
+    selection.fuse(close.data(), fine.data(), 4.0, 4, fused.data());
+    EXPECT_DOUBLE_EQ(fused[0], -7);
+}
@@ -32,16 +32,24 @@
 #define VECTOR_DIM 3
 #define MATRIX_DIM 9
 
-#include <GL/glut.h>
+// threads of the single block kernels operating on the particle weights
+#define MAX_WEIGHT_THREADS 1024
+
 #include <fl/util/profiling.hpp>
 #include <dbot/gpu/cuda_likelihood_evaluator.h>
+#include <dbot/gpu/cuda_rasterizer_device.h>
+#include <dbot/image_region.h>
+#include <dbot/memory_planner.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 
 
 #include <cuda.h>
+#include <cuda_fp16.h>
 #include <cuda_gl_interop.h>
 #include <math.h>
 #include <math_constants.h>
@@ -49,30 +57,10 @@
 
 using namespace std;
 
-// ====================== CUDA CONSTANT VALUES ======================= //
-
-
-// used in propagateOcclusion
-__constant__ float g_p_occluded_occluded;
-__constant__ float g_one_div_c_minus_one;
-__constant__ float g_log_c;
-
-
-// used in prob
-__constant__ float g_one_minus_tail_weight;
-__constant__ float g_model_sigma;
-__constant__ float g_sigma_factor;
-__constant__ float g_tail_weight_div_max_depth;
-__constant__ float g_exponential_rate;
-__constant__ float g_one_div_sqrt_of_two;
-__constant__ float g_one_div_sqrt_of_two_pi;
-
-
-// used in compare
-__constant__ float g_initial_occlusion_prob;
-
-// texture for OpenGL interop
-texture<float, cudaTextureType2D, cudaReadModeElementType> texture_reference;
+// The model constants and the textures are owned by each CudaEvaluator and passed to the kernels
+// by value as CudaEvaluator::KernelParameters, such that several evaluators with different
+// parameters can run concurrently on their own streams.
+typedef CudaEvaluator::KernelParameters KernelParameters;
 
 
 
@@ -92,48 +80,62 @@ texture<float, cudaTextureType2D, cudaReadModeElementType> texture_reference;
 // ======================= helper functions for compare (observation model)  ======================= //
 
 
-__device__ float propagate_occlusion(float initial_p_source, float time) {
+// the occlusion probabilities are stored as float, half or 8 bit fixed point, see
+// CudaEvaluator::OcclusionStorage. Every access goes through these functions.
+__device__ __forceinline__ float load_occlusion(const float* probs, int i) { return probs[i]; }
+__device__ __forceinline__ float load_occlusion(const __half* probs, int i) { return __half2float(probs[i]); }
+__device__ __forceinline__ float load_occlusion(const unsigned char* probs, int i) { return probs[i] * (1.f / 255.f); }
+
+__device__ __forceinline__ void store_occlusion(float* probs, int i, float p) { probs[i] = p; }
+__device__ __forceinline__ void store_occlusion(__half* probs, int i, float p) { probs[i] = __float2half_rn(p); }
+__device__ __forceinline__ void store_occlusion(unsigned char* probs, int i, float p) {
+    probs[i] = (unsigned char) __float2int_rn(__saturatef(p) * 255.f);
+}
+
+
+
+__device__ float propagate_occlusion(const KernelParameters& p, float initial_p_source, float time) {
     if (isnan(time)) {
         return initial_p_source;
     }
-    float pow_c_time = __expf(time * g_log_c);
-    return 1 - (pow_c_time * (1 - initial_p_source) + (1. - g_p_occluded_occluded) * (pow_c_time - 1.) * g_one_div_c_minus_one);
+    float pow_c_time = __expf(time * p.log_c);
+    return 1 - (pow_c_time * (1 - initial_p_source) + (1. - p.p_occluded_occluded) * (pow_c_time - 1.) * p.one_div_c_minus_one);
 }
 
 
 
-__device__ float prob(float observation, float prediction, bool occluded)
+__device__ float prob(const KernelParameters& p, float observation, float prediction, bool occluded)
 {
     // todo: if the prediction is infinite, the prob should not depend on occlusion. it does not matter
     // for the algorithm right now, but it should be changed
 
-    float sigma = g_model_sigma + g_sigma_factor * observation * observation;
+    float sigma = p.model_sigma + p.sigma_factor * observation * observation;
     float sigma_sq = sigma * sigma;
 
     if(!occluded)
     {
         if(isinf(prediction)) // if the prediction is infinite we return the limit
-            return g_tail_weight_div_max_depth;
+            return p.tail_weight_div_max_depth;
         else {
             float pred_minus_obs = prediction - observation;
-            return g_tail_weight_div_max_depth
-                    + __fdividef(g_one_minus_tail_weight * __expf(- __fdividef(pred_minus_obs * pred_minus_obs, (2 * sigma_sq)))
-                    * g_one_div_sqrt_of_two_pi, sigma);
+            return p.tail_weight_div_max_depth
+                    + __fdividef(p.one_minus_tail_weight * __expf(- __fdividef(pred_minus_obs * pred_minus_obs, (2 * sigma_sq)))
+                    * p.one_div_sqrt_of_two_pi, sigma);
         }
     }
     else
     {
         if(isinf(prediction)) // if the prediction is infinite we return the limit
-            return g_tail_weight_div_max_depth +
-                    g_one_minus_tail_weight * g_exponential_rate *
-                    __expf(0.5 * g_exponential_rate * (-2 * observation + g_exponential_rate * sigma_sq));
+            return p.tail_weight_div_max_depth +
+                    p.one_minus_tail_weight * p.exponential_rate *
+                    __expf(0.5 * p.exponential_rate * (-2 * observation + p.exponential_rate * sigma_sq));
 
         else
-            return g_tail_weight_div_max_depth +
-                    g_one_minus_tail_weight * g_exponential_rate *
-                    __expf(0.5 * g_exponential_rate * (2 * (prediction - observation) + g_exponential_rate * sigma_sq))
-                    * __fdividef((1 + erff(__fdividef((prediction - observation + g_exponential_rate * sigma_sq) * g_one_div_sqrt_of_two, sigma))),
-                    (2 * (__expf(prediction * g_exponential_rate) - 1)));
+            return p.tail_weight_div_max_depth +
+                    p.one_minus_tail_weight * p.exponential_rate *
+                    __expf(0.5 * p.exponential_rate * (2 * (prediction - observation) + p.exponential_rate * sigma_sq))
+                    * __fdividef((1 + erff(__fdividef((prediction - observation + p.exponential_rate * sigma_sq) * p.one_div_sqrt_of_two, sigma))),
+                    (2 * (__expf(prediction * p.exponential_rate) - 1)));
     }
 }
 
@@ -146,410 +148,1995 @@ __device__ float prob(float observation, float prediction, bool occluded)
 
 
 
-__global__ void evaluate_kernel(float *observations, float* old_occlusion_probs, float* new_occlusion_probs, int* occlusion_image_indices, int nr_pixels,
-                                 float *d_log_likelihoods, float delta_time, int n_poses, int n_rows, int n_cols, bool update_occlusions) {
+__device__ int region_offset(const CudaEvaluator::PixelRegion& region, int row, int col) {
+    if (row < region.row || row >= region.row + region.rows ||
+        col < region.col || col >= region.col + region.cols) {
+        return -1;
+    }
+    return (row - region.row) * region.cols + (col - region.col);
+}
+
+
+// occlusion probability of a stored pixel of the slot propagated by time, read through the row its tile refers to.
+// The time the tile still owes is propagated even if time is not known.
+template <typename OcclusionType>
+__device__ float load_tiled_occlusion(const KernelParameters& p, const CudaEvaluator::OcclusionTiles& tiles, int nr_stored_pixels,
+                                      int tile, int slot, int index, float time) {
+    const CudaEvaluator::OcclusionTileState state = tiles.states[tile];
+    const OcclusionType* probs = tiles.buffer_row<OcclusionType>(state.buffer, tiles.row(tile, slot), nr_stored_pixels);
+    return propagate_occlusion(p, load_occlusion(probs, index), isnan(time) ? state.pending_time : state.pending_time + time);
+}
+
+
+// whether the observation of the pixel is not NaN, see compact_observations_kernel
+__device__ __forceinline__ bool is_valid(const CudaEvaluator::KernelParameters& p, int pixel) {
+    return (p.valid_mask[pixel / 32] >> (pixel % 32)) & 1u;
+}
+
+
+struct SumOp {
+    __device__ float operator()(float a, float b) const { return a + b; }
+};
+
+struct MaxOp {
+    __device__ float operator()(float a, float b) const { return fmaxf(a, b); }
+};
+
+
+
+// reduces value over all threads of the block with warp shuffles and a tree over the warps, instead
+// of serializing the threads on a shared atomicAdd. The result is only valid in thread 0. Blocks
+// whose size is not a multiple of the warp size are handled by masking the missing lanes.
+template <typename Op> __device__ float block_reduce(float value, Op op, float identity) {
+    __shared__ float warp_sums[32];
+
+    int lane = threadIdx.x % warpSize;
+    int warp = threadIdx.x / warpSize;
+    int nr_warps = (blockDim.x + warpSize - 1) / warpSize;
+
+    // reduce within each warp
+    int width = min(warpSize, blockDim.x - warp * warpSize);
+    unsigned mask = width == warpSize ? 0xffffffff : (1u << width) - 1;
+    for (int offset = warpSize / 2; offset > 0; offset /= 2) {
+        float other = __shfl_down_sync(mask, value, offset);
+        if (lane + offset < width) value = op(value, other);
+    }
+    if (lane == 0) warp_sums[warp] = value;
+
+    __syncthreads();
+
+    // reduce the partial results of the warps in the first warp
+    if (warp == 0) {
+        value = lane < nr_warps ? warp_sums[lane] : identity;
+        for (int offset = warpSize / 2; offset > 0; offset /= 2) {
+            float other = __shfl_down_sync(mask, value, offset);
+            if (lane + offset < width) value = op(value, other);
+        }
+    }
+
+    return value;
+}
+
+
+
+__device__ float block_reduce_sum(float value) {
+    return block_reduce(value, SumOp(), 0);
+}
+
+
+
+// same as block_reduce, but the result is returned to all threads of the block
+template <typename Op> __device__ float block_all_reduce(float value, Op op, float identity) {
+    __shared__ float result;
+
+    value = block_reduce(value, op, identity);
+    if (threadIdx.x == 0) result = value;
+    __syncthreads();
+    value = result;
+
+    // result and the partial sums are overwritten by the next reduction
+    __syncthreads();
+    return value;
+}
+
+
+
+// log likelihood ratio of the observed depth given the rendered one against no intersection.
+// occlusion_prob is replaced by its posterior given the observation. With UseTable, the pixel
+// likelihoods within the range of the table are fetched from it instead of being evaluated.
+template <bool UseTable>
+__device__ float pixel_log_likelihood(const KernelParameters& p, float observed_depth, float depth, float& occlusion_prob) {
+    float p_obsIpred_vis, p_obsIpred_occl, p_obsIinf;
+
+    float difference = depth - observed_depth;
+    if (UseTable && fabsf(difference) < p.table_max_difference && observed_depth < p.table_max_observation) {
+        // texel i holds the sample at i, its center lies at i + 0.5
+        float4 entry = tex2D<float4>(p.likelihood_table,
+                                     (difference + p.table_max_difference) * p.table_difference_scale + 0.5f,
+                                     observed_depth * p.table_observation_scale + 0.5f);
+        p_obsIpred_vis = entry.x * (1 - occlusion_prob);
+        p_obsIpred_occl = entry.y * occlusion_prob;
+        p_obsIinf = entry.z;
+    } else {
+        // prob of observation given prediction, knowing that the object is not occluded
+        p_obsIpred_vis = prob(p, observed_depth, depth, false) * (1 - occlusion_prob);
+        // prob of observation given prediction, knowing that the object is occluded
+        p_obsIpred_occl = prob(p, observed_depth, depth, true) * occlusion_prob;
+        // prob of observation given no intersection
+        p_obsIinf = prob(p, observed_depth, CUDART_INF_F, true);
+    }
+
+    occlusion_prob = 1 - __fdividef(p_obsIpred_vis, (p_obsIpred_vis + p_obsIpred_occl));
+    return __logf(__fdividef((p_obsIpred_vis + p_obsIpred_occl), p_obsIinf));
+}
+
+
+
+// rendered depth of the pose of the block in the OpenGL texture or the CUDA rasterizer buffer
+struct TextureDepth {
+    cudaTextureObject_t texture;
+    int n_rows, n_cols;
+
+    // OpenGL contructs the texture so that the left lower edge is (0,0), but our observations texture
+    // has its (0,0) in the upper left corner, so we need to reverse the reads from the OpenGL texture.
+    __device__ float operator()(int row, int col) const {
+        return tex2D<float>(texture, blockIdx.x * n_cols + col, gridDim.y * n_rows - 1 - (blockIdx.y * n_rows + row));
+    }
+};
+
+// depth of the evaluation region rendered into shared memory by fused_evaluate_kernel, infinity
+// where no triangle has been drawn
+struct SharedDepth {
+    const float* depth;
+    CudaEvaluator::PixelRegion region;
+
+    __device__ float operator()(int row, int col) const {
+        float value = depth[(row - region.row) * region.cols + col - region.col];
+        return isinf(value) ? 0 : value;
+    }
+};
+
+
+
+// the occlusion probabilities are only stored for the pixels within occlusion_region, all other
+// pixels have never been observed and share outside_occlusion_prob, which is already propagated
+// to the current time. Only the pixels within evaluation_region can be covered by a rendering.
+// Evaluates pose block_id with all threads of the block.
+template <typename OcclusionType, bool UseTable, typename DepthImage>
+__device__ void evaluate_pose(KernelParameters p, const DepthImage& depth_image, int block_id, float *observations,
+                              OcclusionType* old_occlusion_probs, OcclusionType* new_occlusion_probs, int* occlusion_image_indices,
+                              CudaEvaluator::PixelRegion occlusion_region, CudaEvaluator::PixelRegion evaluation_region, float outside_occlusion_prob,
+                              float *d_log_likelihoods, float delta_time, int n_cols, bool update_occlusions,
+                              const CudaEvaluator::OcclusionTiles& tiles) {
+    float depth;
+    float observed_depth;
+    float occlusion_prob;
+    float local_sum_of_likelihoods = 0;
+
+    __shared__ int occlusion_image_index;
+
+    if (threadIdx.x == 0) {
+        occlusion_image_index = occlusion_image_indices[block_id];
+        // after the update every pose owns the occlusions at its own index
+        if (update_occlusions) occlusion_image_indices[block_id] = block_id;
+    }
+
+    __syncthreads();
+
+    int nr_stored_pixels = occlusion_region.rows * occlusion_region.cols;
+    OcclusionType* occlusion_probs = old_occlusion_probs + occlusion_image_index * nr_stored_pixels;
+
+    const bool tiled = tiles.rows != NULL;
+
+    if (update_occlusions && tiled) {
+        // the untouched tiles of the pose refer to the ones of its parent
+        for (int t = threadIdx.x; t < tiles.tile_count; t += blockDim.x) {
+            tiles.next_rows[t * tiles.slot_stride + block_id] = tiles.next_row(t, block_id, occlusion_image_index);
+        }
+
+        // the touched tiles are copied from the parent and propagated, into the buffer they are not in
+        const int first_row = tiles.touched.row * dbot::OcclusionTileMap::TILE_ROWS;
+        const int first_col = tiles.touched.col * dbot::OcclusionTileMap::TILE_COLS;
+        const int touched_rows = min(tiles.touched.rows * dbot::OcclusionTileMap::TILE_ROWS, occlusion_region.rows - first_row);
+        const int touched_cols = min(tiles.touched.cols * dbot::OcclusionTileMap::TILE_COLS, occlusion_region.cols - first_col);
+        for (int i = threadIdx.x; i < touched_rows * touched_cols; i += blockDim.x) {
+            int index = (first_row + i / touched_cols) * occlusion_region.cols + first_col + i % touched_cols;
+            int tile = tiles.tile(occlusion_region.cols, index);
+            OcclusionType* new_probs = tiles.buffer_row<OcclusionType>(1 - tiles.states[tile].buffer, block_id, nr_stored_pixels);
+            store_occlusion(new_probs, index,
+                            load_tiled_occlusion<OcclusionType>(p, tiles, nr_stored_pixels, tile, occlusion_image_index, index, delta_time));
+        }
+
+        __syncthreads();
+    } else if (update_occlusions) {
+        // copy the occlusion probabilities from the old particle and propagate them
+        OcclusionType* new_probs = new_occlusion_probs + block_id * nr_stored_pixels;
+        for (int i = threadIdx.x; i < nr_stored_pixels; i += blockDim.x) {
+            store_occlusion(new_probs, i, propagate_occlusion(p, load_occlusion(occlusion_probs, i), delta_time));
+        }
+        occlusion_probs = new_probs;
+
+        __syncthreads();
+    }
+
+    // only the valid pixels within the rows of the evaluation region are visited
+    int begin = p.valid_row_offsets[evaluation_region.row];
+    int end = p.valid_row_offsets[evaluation_region.row + evaluation_region.rows];
+    for (int i = begin + threadIdx.x; i < end; i += blockDim.x) {
+        int pixel = p.valid_pixels[i];
+        int row = pixel / n_cols;
+        int col = pixel - row * n_cols;
+        if (col < evaluation_region.col || col >= evaluation_region.col + evaluation_region.cols) continue;
+
+        observed_depth = p.valid_depths[i];
+
+        depth = depth_image(row, col);
+        if (depth == 0) continue;
+
+        int occlusion_index = region_offset(occlusion_region, row, col);
+        occlusion_prob = outside_occlusion_prob;
+        OcclusionType* pixel_probs = occlusion_probs;
+        if (occlusion_index >= 0 && tiled) {
+            // the pixels of the evaluation region are in touched tiles, which the update has already copied
+            int tile = tiles.tile(occlusion_region.cols, occlusion_index);
+            if (update_occlusions) {
+                pixel_probs = tiles.buffer_row<OcclusionType>(1 - tiles.states[tile].buffer, block_id, nr_stored_pixels);
+                occlusion_prob = load_occlusion(pixel_probs, occlusion_index);
+            } else {
+                occlusion_prob = load_tiled_occlusion<OcclusionType>(p, tiles, nr_stored_pixels, tile, occlusion_image_index,
+                                                                     occlusion_index, delta_time);
+            }
+        } else if (occlusion_index >= 0) {
+            occlusion_prob = load_occlusion(occlusion_probs, occlusion_index);
+            if (!update_occlusions) occlusion_prob = propagate_occlusion(p, occlusion_prob, delta_time);
+        }
+
+        local_sum_of_likelihoods += pixel_log_likelihood<UseTable>(p, observed_depth, depth, occlusion_prob);
+
+        if (update_occlusions && occlusion_index >= 0) {
+            // we update the occlusion probability with the observations
+            store_occlusion(pixel_probs, occlusion_index, occlusion_prob);
+        }
+    }
+
+    float log_likelihood = block_reduce_sum(local_sum_of_likelihoods);
+
+    if (threadIdx.x == 0) {
+        d_log_likelihoods[block_id] = log_likelihood;
+    }
+}
+
+
+
+template <typename OcclusionType, bool UseTable>
+__global__ void evaluate_kernel(KernelParameters p, float *observations, OcclusionType* old_occlusion_probs, OcclusionType* new_occlusion_probs, int* occlusion_image_indices,
+                                CudaEvaluator::PixelRegion occlusion_region, CudaEvaluator::PixelRegion evaluation_region, float outside_occlusion_prob,
+                                float *d_log_likelihoods, float delta_time, int n_poses, int n_rows, int n_cols, bool update_occlusions,
+                                CudaEvaluator::OcclusionTiles tiles) {
     int block_id = blockIdx.x + blockIdx.y * gridDim.x;
     if (block_id < n_poses) {
+        TextureDepth depth_image;
+        depth_image.texture = p.depth_texture;
+        depth_image.n_rows = n_rows;
+        depth_image.n_cols = n_cols;
+
+        evaluate_pose<OcclusionType, UseTable>(p, depth_image, block_id, observations, old_occlusion_probs, new_occlusion_probs,
+                                               occlusion_image_indices, occlusion_region, evaluation_region, outside_occlusion_prob,
+                                               d_log_likelihoods, delta_time, n_cols, update_occlusions, tiles);
+    } else {
+        __syncthreads();
+    }
+
+}
+
 
-        int pixel_nr = threadIdx.x;
 
-        // OpenGL contructs the texture so that the left lower edge is (0,0), but our observations texture
-        // has its (0,0) in the upper left corner, so we need to reverse the reads from the OpenGL texture.
-        float texture_array_index_x = blockIdx.x * n_cols + pixel_nr % n_cols;
+// keeps the nearest depth of the evaluation region in shared memory
+struct SharedWrite {
+    float* depth;
+    CudaEvaluator::PixelRegion region;
 
-        float texture_array_index_y = gridDim.y * n_rows - 1 - (blockIdx.y * n_rows + __fdividef(pixel_nr, n_cols));
+    __device__ void operator()(int row, int col, float z) const {
+        store_nearest(&depth[(row - region.row) * region.cols + col - region.col], z);
+    }
+};
+
+// Same as evaluate_kernel, but the block first rasterizes its pose into the evaluation region in
+// shared memory, see CudaRasterizer. The depth never goes through global memory.
+template <typename OcclusionType, bool UseTable>
+__global__ void fused_evaluate_kernel(KernelParameters p, CudaRasterizer::Geometry g, float *observations,
+                                      OcclusionType* old_occlusion_probs, OcclusionType* new_occlusion_probs, int* occlusion_image_indices,
+                                      CudaEvaluator::PixelRegion occlusion_region, CudaEvaluator::PixelRegion evaluation_region, float outside_occlusion_prob,
+                                      float *d_log_likelihoods, float delta_time, int n_poses, int n_cols, bool update_occlusions,
+                                      CudaEvaluator::OcclusionTiles tiles) {
+    extern __shared__ float region_depth[];
+
+    int block_id = blockIdx.x + blockIdx.y * gridDim.x;
+    if (block_id >= n_poses) return;
+
+    int nr_pixels = evaluation_region.rows * evaluation_region.cols;
+    for (int i = threadIdx.x; i < nr_pixels; i += blockDim.x) {
+        region_depth[i] = CUDART_INF_F;
+    }
+    __syncthreads();
+
+    SharedWrite write;
+    write.depth = region_depth;
+    write.region = evaluation_region;
+    for (int t = threadIdx.x; t < g.nr_triangles; t += blockDim.x) {
+        rasterize_triangle(g, block_id, t, evaluation_region.row, evaluation_region.row + evaluation_region.rows - 1,
+                           evaluation_region.col, evaluation_region.col + evaluation_region.cols - 1, write);
+    }
+
+    // the depth is complete after the barrier at the start of evaluate_pose()
+    SharedDepth depth_image;
+    depth_image.depth = region_depth;
+    depth_image.region = evaluation_region;
+
+    evaluate_pose<OcclusionType, UseTable>(p, depth_image, block_id, observations, old_occlusion_probs, new_occlusion_probs,
+                                           occlusion_image_indices, occlusion_region, evaluation_region, outside_occlusion_prob,
+                                           d_log_likelihoods, delta_time, n_cols, update_occlusions, tiles);
+}
+
+
+
+// pixels of the work region of a pose which one warp of persistent_evaluate_kernel evaluates at once
+const int PERSISTENT_TILE_PIXELS = 128;
+const int PERSISTENT_THREADS = 256;
+
+// Same as evaluate_kernel, but the resident warps pull tiles of the work regions of all poses from
+// work_counter until none are left. Work region 2 * i of pose i covers the stored occlusions if they
+// are updated and its rendering, region 2 * i + 1 holds the pixels its rendering can cover, see
+// CudaEvaluator::set_pose_regions(). The tiles of all poses are numbered consecutively, those of
+// pose i start at work_offsets[i]. The log likelihoods have to be zero and the occlusion indices
+// are not reset, since other warps may still read them. The occlusion tiles are only read, an
+// incremental update goes through evaluate_kernel.
+template <typename OcclusionType, bool UseTable>
+__global__ void persistent_evaluate_kernel(KernelParameters p, float *observations, OcclusionType* old_occlusion_probs, OcclusionType* new_occlusion_probs,
+                                           const int* occlusion_image_indices, CudaEvaluator::PixelRegion occlusion_region,
+                                           const CudaEvaluator::PixelRegion* work_regions, const int* work_offsets, int* work_counter,
+                                           float outside_occlusion_prob, float *d_log_likelihoods, float delta_time, int n_poses,
+                                           int n_rows, int n_cols, int n_poses_per_row, int n_tile_rows, bool update_occlusions,
+                                           CudaEvaluator::OcclusionTiles tiles) {
+    const int lane = threadIdx.x % warpSize;
+    const int nr_items = work_offsets[n_poses];
+    const int nr_stored_pixels = occlusion_region.rows * occlusion_region.cols;
+
+    while (true) {
+        int item = 0;
+        if (lane == 0) item = atomicAdd(work_counter, 1);
+        item = __shfl_sync(0xffffffff, item, 0);
+        if (item >= nr_items) break;
+
+        // the last pose whose tiles start at or before the item
+        int pose = 0;
+        int end_pose = n_poses;
+        while (end_pose - pose > 1) {
+            int middle = (pose + end_pose) / 2;
+            if (work_offsets[middle] <= item) pose = middle; else end_pose = middle;
+        }
+
+        const CudaEvaluator::PixelRegion work = work_regions[2 * pose];
+        const CudaEvaluator::PixelRegion covered = work_regions[2 * pose + 1];
+        const OcclusionType* occlusion_probs = old_occlusion_probs + occlusion_image_indices[pose] * nr_stored_pixels;
+        OcclusionType* new_probs = new_occlusion_probs + pose * nr_stored_pixels;
+        const int tile_col = (pose % n_poses_per_row) * n_cols;
+        const int tile_row = n_tile_rows * n_rows - 1 - (pose / n_poses_per_row) * n_rows;
 
-        float depth;
-        float observed_depth;
-        float occlusion_prob = g_initial_occlusion_prob;
         float local_sum_of_likelihoods = 0;
-        float p_obsIpred_vis, p_obsIpred_occl, p_obsIinf;
+        const int begin = (item - work_offsets[pose]) * PERSISTENT_TILE_PIXELS;
+        const int end = min(begin + PERSISTENT_TILE_PIXELS, work.rows * work.cols);
+        for (int i = begin + lane; i < end; i += warpSize) {
+            int row = work.row + i / work.cols;
+            int col = work.col + i % work.cols;
+
+            int occlusion_index = region_offset(occlusion_region, row, col);
+            float occlusion_prob = outside_occlusion_prob;
+            if (occlusion_index >= 0 && tiles.rows != NULL) {
+                occlusion_prob = load_tiled_occlusion<OcclusionType>(p, tiles, nr_stored_pixels,
+                                                                     tiles.tile(occlusion_region.cols, occlusion_index),
+                                                                     occlusion_image_indices[pose], occlusion_index, delta_time);
+            } else if (occlusion_index >= 0) {
+                occlusion_prob = propagate_occlusion(p, load_occlusion(occlusion_probs, occlusion_index), delta_time);
+            }
+
+            if (region_offset(covered, row, col) >= 0 && is_valid(p, row * n_cols + col)) {
+                float observed_depth = observations[row * n_cols + col];
+                float depth = tex2D<float>(p.depth_texture, tile_col + col, tile_row - row);
+                if (depth != 0) {
+                    local_sum_of_likelihoods += pixel_log_likelihood<UseTable>(p, observed_depth, depth, occlusion_prob);
+                }
+            }
+
+            if (update_occlusions && occlusion_index >= 0) {
+                store_occlusion(new_probs, occlusion_index, occlusion_prob);
+            }
+        }
+
+        for (int offset = warpSize / 2; offset > 0; offset /= 2) {
+            local_sum_of_likelihoods += __shfl_down_sync(0xffffffff, local_sum_of_likelihoods, offset);
+        }
+        if (lane == 0) atomicAdd(&d_log_likelihoods[pose], local_sum_of_likelihoods);
+    }
+}
+
+
+
+// after an update every pose owns the occlusions at its own index
+__global__ void identity_indices_kernel(int* indices, int n) {
+    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < n) indices[i] = i;
+}
+
+
+
+// every tile of every slot refers to the own row of the slot
+__global__ void identity_tile_rows_kernel(int* rows, int n_tiles, int slot_stride) {
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n_tiles * slot_stride; i += blockDim.x * gridDim.x) {
+        rows[i] = i % slot_stride;
+    }
+}
+
+
+
+// moves the tiles of the first n_slots slots into the own row of the slot in the buffer they are not
+// in and propagates them by their pending time. Only the tiles in from_buffer are moved if it is not
+// negative.
+template <typename OcclusionType>
+__global__ void move_occlusion_tiles_kernel(CudaEvaluator::OcclusionTiles tiles, CudaEvaluator::PixelRegion region,
+                                            KernelParameters p, int n_slots, int from_buffer) {
+    const int nr_stored_pixels = region.rows * region.cols;
+
+    for (int slot = blockIdx.x; slot < n_slots; slot += gridDim.x) {
+        for (int i = threadIdx.x; i < nr_stored_pixels; i += blockDim.x) {
+            int tile = tiles.tile(region.cols, i);
+            const CudaEvaluator::OcclusionTileState state = tiles.states[tile];
+            if (from_buffer >= 0 && state.buffer != from_buffer) continue;
+
+            const OcclusionType* probs = tiles.buffer_row<OcclusionType>(state.buffer, tiles.row(tile, slot), nr_stored_pixels);
+            float value = load_occlusion(probs, i);
+            if (state.pending_time != 0) value = propagate_occlusion(p, value, state.pending_time);
+            store_occlusion(tiles.buffer_row<OcclusionType>(1 - state.buffer, slot, nr_stored_pixels), i, value);
+        }
+    }
+}
+
+
+
+// threads per block of the observation compaction, a multiple of the warp size
+const int COMPACTION_THREADS = 128;
+
+// bit i % 32 of mask word i / 32 is set if observation i is not NaN, one ballot per warp
+__global__ void valid_mask_kernel(const float* observations, unsigned int* mask, int n) {
+    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    unsigned int bits = __ballot_sync(0xffffffff, i < n && !isnan(observations[min(i, n - 1)]));
+    if (threadIdx.x % warpSize == 0 && i < n) mask[i / 32] = bits;
+}
+
 
-        __shared__ float log_likelihoods;
-        __shared__ int occlusion_image_index;
 
-        if (threadIdx.x == 0) {
-            log_likelihoods = 0;
-            occlusion_image_index = occlusion_image_indices[block_id];
+// one block per row, the number of valid pixels of row r is written to row_offsets[r + 1]
+__global__ void count_valid_kernel(const unsigned int* mask, int* row_offsets, int n_cols) {
+    const int row = blockIdx.x;
+    int count = 0;
+    for (int base = 0; base < n_cols; base += blockDim.x) {
+        int pixel = row * n_cols + base + threadIdx.x;
+        bool valid = base + threadIdx.x < n_cols && ((mask[pixel / 32] >> (pixel % 32)) & 1u);
+        count += __syncthreads_count(valid);
+    }
+    if (threadIdx.x == 0) row_offsets[row + 1] = count;
+}
+
+
+
+// turns the counts of the rows into the offsets of their first valid pixels, the rows are few
+__global__ void scan_rows_kernel(int* row_offsets, int n_rows) {
+    row_offsets[0] = 0;
+    for (int row = 0; row < n_rows; row++) row_offsets[row + 1] += row_offsets[row];
+}
+
+
+
+// one block per row, writes the index and the depth of every valid pixel of the row in order
+__global__ void compact_observations_kernel(const float* observations, const unsigned int* mask, const int* row_offsets,
+                                            int* valid_pixels, float* valid_depths, int n_cols) {
+    __shared__ int warp_counts[COMPACTION_THREADS / 32];
+
+    const int row = blockIdx.x;
+    const int lane = threadIdx.x % warpSize;
+    const int warp = threadIdx.x / warpSize;
+    int offset = row_offsets[row];
+    for (int base = 0; base < n_cols; base += blockDim.x) {
+        int col = base + threadIdx.x;
+        int pixel = row * n_cols + col;
+        bool valid = col < n_cols && ((mask[pixel / 32] >> (pixel % 32)) & 1u);
+
+        unsigned int ballot = __ballot_sync(0xffffffff, valid);
+        if (lane == 0) warp_counts[warp] = __popc(ballot);
+        __syncthreads();
+
+        int position = offset + __popc(ballot & ((1u << lane) - 1));
+        for (int w = 0; w < warp; w++) position += warp_counts[w];
+        if (valid) {
+            valid_pixels[position] = pixel;
+            valid_depths[position] = observations[pixel];
         }
+        for (int w = 0; w < blockDim.x / warpSize; w++) offset += warp_counts[w];
 
+        // the counts are overwritten by the next chunk
         __syncthreads();
+    }
+}
+
 
-        float* occlusion_probs = old_occlusion_probs;
-        int occlusion_pixel_index= occlusion_image_index * nr_pixels + pixel_nr;
 
-        if (update_occlusions) {
-            // copy occlusion probabilities from the old particles
-            int index_from_occlusion = occlusion_image_indices[block_id] * nr_pixels;
-            int index_to_occlusion = block_id * nr_pixels;
+// image k of images is the depth of pose indices[k] in the texture, row 0 at the top.
+// blockIdx.y is the image.
+__global__ void gather_depth_kernel(KernelParameters p, const int* indices, float* images, int n_rows, int n_cols,
+                                    int n_poses_per_row, int n_tile_rows) {
+    const int pixel = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pixel >= n_rows * n_cols) return;
 
-            while (pixel_nr < nr_pixels) {
-                new_occlusion_probs[index_to_occlusion + pixel_nr] = old_occlusion_probs[index_from_occlusion + pixel_nr];
-                pixel_nr += blockDim.x;
+    const int pose = indices[blockIdx.y];
+    const int row = pixel / n_cols;
+    const int col = pixel - row * n_cols;
+    images[blockIdx.y * n_rows * n_cols + pixel] =
+        tex2D<float>(p.depth_texture, (pose % n_poses_per_row) * n_cols + col,
+                     n_tile_rows * n_rows - 1 - ((pose / n_poses_per_row) * n_rows + row));
+}
+
+
+
+// image k of images holds the occlusions of slot indices[k] over the full image
+template <typename OcclusionType>
+__global__ void expand_occlusions_kernel(const OcclusionType* stored_probs, const int* indices, float* images,
+                                         CudaEvaluator::PixelRegion region, float outside_occlusion_prob,
+                                         int n_rows, int n_cols) {
+    const int pixel = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pixel >= n_rows * n_cols) return;
+
+    const int offset = region_offset(region, pixel / n_cols, pixel % n_cols);
+    float value = outside_occlusion_prob;
+    if (offset >= 0) value = load_occlusion(stored_probs + indices[blockIdx.y] * region.rows * region.cols, offset);
+    images[blockIdx.y * n_rows * n_cols + pixel] = value;
+}
+
+
+
+// the state dimension and the number of sigma points of reduce_sigma_point_moments()
+const int MAX_MOMENT_DIMENSION = CudaEvaluator::MAX_MOMENT_DIMENSION;
+const int MAX_SIGMA_POINTS = 2 * MAX_MOMENT_DIMENSION + 1;
+
+
+
+// mean and variance of the body/tail mixture of a pixel with the rendered depth, 0 is background.
+// Same as dbot::SigmaPointMoments::pixel_moments().
+__device__ void pixel_moments(const CudaEvaluator::MomentParameters& m, float depth, float& mean, float& variance) {
+    bool background = depth == 0;
+    float body_mean = background ? m.bg_depth : depth;
+    float body_variance = background ? m.bg_variance : m.fg_variance;
+
+    float difference = body_mean - m.tail_mean;
+    mean = body_mean - m.tail_weight * difference;
+    variance = (1 - m.tail_weight) * body_variance + m.tail_weight * m.tail_variance
+               + m.tail_weight * (1 - m.tail_weight) * difference * difference;
+}
+
+
+
+// every thread linearizes one pixel of the evaluation region over the sigma points, which are the
+// poses of the texture, as dbot::SigmaPointMoments::accumulate(). The information terms are summed
+// over the block and written to block_sums[blockIdx.x * nr_sums + k], the blocks are added up on
+// the host in order.
+__global__ void sigma_point_moments_kernel(KernelParameters p, CudaEvaluator::MomentParameters model, const float* coefficients,
+                                           const float* observations, CudaEvaluator::PixelRegion evaluation_region,
+                                           int dimension, int n_points, int n_rows, int n_cols,
+                                           int poses_per_row, int poses_per_col, float* block_sums) {
+    __shared__ float shared_coefficients[2 * MAX_SIGMA_POINTS * (1 + MAX_MOMENT_DIMENSION)];
+
+    int nr_coefficients = 2 * n_points * (1 + dimension);
+    for (int i = threadIdx.x; i < nr_coefficients; i += blockDim.x) {
+        shared_coefficients[i] = coefficients[i];
+    }
+    __syncthreads();
+
+    const float* mean_weights = shared_coefficients;
+    const float* covariance_weights = mean_weights + n_points;
+    const float* weighted_deviations = covariance_weights + n_points;
+    const float* gains = weighted_deviations + dimension * n_points;
+
+    float gain[MAX_MOMENT_DIMENSION];
+    for (int i = 0; i < dimension; i++) gain[i] = 0;
+    float noise = 1;
+    float residual = 0;
+
+    int pixel = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pixel < evaluation_region.rows * evaluation_region.cols) {
+        int row = evaluation_region.row + pixel / evaluation_region.cols;
+        int col = evaluation_region.col + pixel % evaluation_region.cols;
+        float observed_depth = observations[row * n_cols + col];
+
+        if (isfinite(observed_depth)) {
+            float means[MAX_SIGMA_POINTS];
+            float prediction = 0;
+            float variance = 0;
+            for (int point = 0; point < n_points; point++) {
+                // the texture is upside down, see evaluate_kernel
+                int tile_col = point % poses_per_row;
+                int tile_row = point / poses_per_row;
+                float depth = tex2D<float>(p.depth_texture, tile_col * n_cols + col,
+                                           poses_per_col * n_rows - 1 - (tile_row * n_rows + row));
+
+                float point_variance;
+                pixel_moments(model, depth, means[point], point_variance);
+                prediction += mean_weights[point] * means[point];
+                variance += mean_weights[point] * point_variance;
+            }
+
+            float cross[MAX_MOMENT_DIMENSION];
+            for (int i = 0; i < dimension; i++) cross[i] = 0;
+            for (int point = 0; point < n_points; point++) {
+                float deviation = means[point] - prediction;
+                variance += covariance_weights[point] * deviation * deviation;
+                for (int i = 0; i < dimension; i++) {
+                    cross[i] += weighted_deviations[point * dimension + i] * deviation;
+                    gain[i] += gains[point * dimension + i] * deviation;
+                }
+            }
+
+            noise = variance;
+            for (int i = 0; i < dimension; i++) noise -= gain[i] * cross[i];
+
+            if (noise > 0) {
+                residual = __fdividef(observed_depth - prediction, noise);
+            } else {
+                // the linearization failed, the pixel carries no information
+                for (int i = 0; i < dimension; i++) gain[i] = 0;
+                noise = 1;
             }
+        }
+    }
+
+    // the partial sums of the warps are overwritten by the next reduction
+    int nr_sums = dimension * (dimension + 1) / 2 + dimension;
+    float* sums = block_sums + blockIdx.x * nr_sums;
+    int k = 0;
+    for (int i = 0; i < dimension; i++) {
+        for (int j = i; j < dimension; j++) {
+            float sum = block_reduce_sum(__fdividef(gain[i] * gain[j], noise));
+            if (threadIdx.x == 0) sums[k] = sum;
+            k++;
+            __syncthreads();
+        }
+    }
+    for (int i = 0; i < dimension; i++) {
+        float sum = block_reduce_sum(gain[i] * residual);
+        if (threadIdx.x == 0) sums[k] = sum;
+        k++;
+        __syncthreads();
+    }
+}
+
+
+
+// adds the new log likelihoods to the log weights and normalizes them. Runs as a single block over
+// all particles and writes the KL divergence of the weights from the uniform distribution.
+__global__ void update_weights_kernel(float* log_weights, const float* log_likelihoods,
+                                      float* previous_log_likelihoods, int n_poses,
+                                      float* kl_divergence) {
+    float local_max = -CUDART_INF_F;
+    for (int i = threadIdx.x; i < n_poses; i += blockDim.x) {
+        float log_weight = log_weights[i] + log_likelihoods[i] - previous_log_likelihoods[i];
+        log_weights[i] = log_weight;
+        previous_log_likelihoods[i] = log_likelihoods[i];
+        local_max = fmaxf(local_max, log_weight);
+    }
+    float max_log_weight = block_all_reduce(local_max, MaxOp(), -CUDART_INF_F);
+
+    float local_sum = 0;
+    for (int i = threadIdx.x; i < n_poses; i += blockDim.x) {
+        local_sum += __expf(log_weights[i] - max_log_weight);
+    }
+    float log_normalizer = max_log_weight + logf(block_all_reduce(local_sum, SumOp(), 0));
+
+    // KL(w || uniform) = log(n) + sum_i w_i log(w_i)
+    float local_kl = 0;
+    for (int i = threadIdx.x; i < n_poses; i += blockDim.x) {
+        float log_weight = log_weights[i] - log_normalizer;
+        log_weights[i] = log_weight;
+        local_kl += __expf(log_weight) * log_weight;
+    }
+    float kl = block_reduce_sum(local_kl);
+
+    if (threadIdx.x == 0) {
+        *kl_divergence = logf(n_poses) + kl;
+    }
+}
+
+
+
+// systematic resampling from the normalized log weights as a single block. Every thread builds the
+// cumulative weights of one contiguous chunk, the chunk offsets are obtained with a scan over the
+// threads. The parents are then found by binary search and the occlusion indices and previous log
+// likelihoods of the particles are gathered from them. The new weights are uniform.
+__global__ void systematic_resample_kernel(float* log_weights, float* cumulative_weights,
+                                           const int* occlusion_indices, int* new_occlusion_indices,
+                                           const float* previous_log_likelihoods,
+                                           float* new_previous_log_likelihoods,
+                                           int* parents, int n_poses, float offset) {
+    __shared__ float chunk_sums[MAX_WEIGHT_THREADS];
+
+    int chunk_size = (n_poses + blockDim.x - 1) / blockDim.x;
+    int begin = min(n_poses, threadIdx.x * chunk_size);
+    int end = min(n_poses, begin + chunk_size);
+
+    float chunk_sum = 0;
+    for (int i = begin; i < end; i++) {
+        chunk_sum += __expf(log_weights[i]);
+    }
+
+    // inclusive scan of the chunk sums
+    chunk_sums[threadIdx.x] = chunk_sum;
+    __syncthreads();
+    for (int step = 1; step < blockDim.x; step *= 2) {
+        float other = threadIdx.x >= step ? chunk_sums[threadIdx.x - step] : 0;
+        __syncthreads();
+        chunk_sums[threadIdx.x] += other;
+        __syncthreads();
+    }
+
+    float cumulative = chunk_sums[threadIdx.x] - chunk_sum;
+    for (int i = begin; i < end; i++) {
+        cumulative += __expf(log_weights[i]);
+        cumulative_weights[i] = cumulative;
+    }
+    float total = chunk_sums[blockDim.x - 1];
+
+    __syncthreads();
+
+    float log_uniform_weight = -logf(n_poses);
+    for (int k = threadIdx.x; k < n_poses; k += blockDim.x) {
+        float position = (k + offset) / n_poses * total;
+
+        // first particle whose cumulative weight exceeds the position
+        int lower = 0;
+        int upper = n_poses - 1;
+        while (lower < upper) {
+            int middle = (lower + upper) / 2;
+            if (cumulative_weights[middle] > position) upper = middle;
+            else lower = middle + 1;
+        }
+
+        parents[k] = lower;
+        new_occlusion_indices[k] = occlusion_indices[lower];
+        new_previous_log_likelihoods[k] = previous_log_likelihoods[lower];
+        log_weights[k] = log_uniform_weight;
+    }
+}
+
+
+
+__global__ void reset_weights_kernel(float* log_weights, float* previous_log_likelihoods,
+                                     int* occlusion_indices, int n_poses) {
+    float log_uniform_weight = -logf(n_poses);
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n_poses; i += blockDim.x * gridDim.x) {
+        log_weights[i] = log_uniform_weight;
+        previous_log_likelihoods[i] = 0;
+        occlusion_indices[i] = 0;
+    }
+}
+
 
-            // change occlusion prob array to the new one and change the global index
-            occlusion_probs = new_occlusion_probs;
-            // reset pixel_nr for following loop
-            pixel_nr = threadIdx.x;
 
-            occlusion_pixel_index= block_id * nr_pixels + pixel_nr;
+// moves the stored occlusion probabilities of every particle to a new region. Pixels which enter
+// the region start with outside_occlusion_prob.
+template <typename OcclusionType>
+__global__ void relayout_kernel(OcclusionType* old_occlusion_probs, OcclusionType* new_occlusion_probs,
+                                CudaEvaluator::PixelRegion old_region, CudaEvaluator::PixelRegion new_region,
+                                float outside_occlusion_prob, int n_poses) {
+    int old_area = old_region.rows * old_region.cols;
+    int new_area = new_region.rows * new_region.cols;
+
+    for (int pose = blockIdx.x; pose < n_poses; pose += gridDim.x) {
+        OcclusionType* old_probs = old_occlusion_probs + pose * old_area;
+        OcclusionType* new_probs = new_occlusion_probs + pose * new_area;
+
+        for (int i = threadIdx.x; i < new_area; i += blockDim.x) {
+            int row = new_region.row + i / new_region.cols;
+            int col = new_region.col + i % new_region.cols;
+            int old_index = region_offset(old_region, row, col);
+
+            store_occlusion(new_probs, i, old_index < 0 ? outside_occlusion_prob : load_occlusion(old_probs, old_index));
         }
+    }
+}
+
+
+
+// converts between float occlusion probabilities and the storage type
+template <typename OcclusionType>
+__global__ void encode_occlusions_kernel(const float* probs, OcclusionType* stored_probs, int n) {
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += blockDim.x * gridDim.x) {
+        store_occlusion(stored_probs, i, probs[i]);
+    }
+}
+
+// converts count images of the region of interest into the given slots, one
+// row of blocks per image
+template <typename OcclusionType>
+__global__ void encode_occlusion_slots_kernel(const float* probs, const int* slots, OcclusionType* stored_probs,
+                                              int area) {
+    const float* image = probs + blockIdx.y * area;
+    OcclusionType* stored_image = stored_probs + slots[blockIdx.y] * area;
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < area; i += blockDim.x * gridDim.x) {
+        store_occlusion(stored_image, i, image[i]);
+    }
+}
+
+template <typename OcclusionType>
+__global__ void decode_occlusions_kernel(const OcclusionType* stored_probs, float* probs, int n) {
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += blockDim.x * gridDim.x) {
+        probs[i] = load_occlusion(stored_probs, i);
+    }
+}
+
+
+
+// dispatches a kernel templated on the occlusion storage type
+#define DISPATCH_OCCLUSION_STORAGE(storage, KERNEL_CALL)                            \
+    switch (storage) {                                                              \
+        case CudaEvaluator::OcclusionStorage::float16: {                            \
+            typedef __half OcclusionType; KERNEL_CALL; break; }                     \
+        case CudaEvaluator::OcclusionStorage::uint8: {                              \
+            typedef unsigned char OcclusionType; KERNEL_CALL; break; }              \
+        default: {                                                                  \
+            typedef float OcclusionType; KERNEL_CALL; break; }                      \
+    }
+
+
+
+
+
+
+// ************************************************************************************** //
+// ************************************************************************************** //
+// ========================== cuda_likelihood_evaluator MEMBER FUNCTIONS ============================== //
+// ************************************************************************************** //
+// ************************************************************************************** //
+
+
+CudaEvaluator::CudaEvaluator(const int nr_rows,
+                       const int nr_cols,
+                       const int device) :
+
+    nr_rows_(nr_rows),
+    nr_cols_(nr_cols)
+{
+
+    cudaDeviceProp  props;
+    int device_number = device;
+
+    if (device >= 0) {
+        // pinned to the GPU of the OpenGL context, before any other runtime call
+        cudaSetDevice(device);
+        #ifdef DEBUG
+            check_cuda_error("cudaSetDevice");
+        #endif
+    } else {
+        memset( &props, 0, sizeof( cudaDeviceProp ) );
+        props.major = 2;
+        props.minor = 0;
+        cudaChooseDevice( &device_number, &props );
+        #ifdef DEBUG
+            check_cuda_error("No device with compute capability > 2.0 found");
+        #endif
+    }
+
+    /* tell CUDA which device we will be using for graphic interop.
+     * Requires that the CUDA device be specified by
+     * cudaGLSetGLDevice() before any other runtime calls. */
+
+//    cudaGLSetGLDevice( device_number );
+    #ifdef DEBUG
+        check_cuda_error("cudaGLsetGLDevice");
+    #endif
+
+    cudaGetDeviceProperties(&props, device_number);     // we will run the program only on one graphics card, the first one we can find = 0
+
+    cuda_device_properties_ = props;
+
+    #ifdef DEBUG
+        cout << "Your device has the following properties: " << endl
+             << "CUDA Version: " << props.major << "." << props.minor << endl
+             << "Number of multiprocessors: " << props.multiProcessorCount << endl;
+    #endif
+
+    /* each multiprocessor has various KB of memory (64 KB for the GTX 560 Ti 448) which can be subdivided
+     * into L1 cache or shared memory. If you don't need a lot of shared memory set this to prefer L1. */
+    cudaDeviceSetCacheConfig(cudaFuncCachePreferL1);
+
+
+    d_occlusion_probs_ = NULL;
+    d_occlusion_probs_copy_ = NULL;
+    d_observations_ = NULL;
+    d_log_likelihoods_ = NULL;
+    d_valid_pixels_ = NULL;
+    d_valid_depths_ = NULL;
+    d_valid_row_offsets_ = NULL;
+    d_valid_mask_ = NULL;
+    d_occlusion_indices_ = NULL;
+    d_active_observations_ = NULL;
+    occlusion_probs_size_ = 0;
+
+    d_occlusion_indices_copy_ = NULL;
+    d_log_weights_ = NULL;
+    d_previous_log_likelihoods_ = NULL;
+    d_previous_log_likelihoods_copy_ = NULL;
+    d_cumulative_weights_ = NULL;
+    d_parents_ = NULL;
+    d_kl_divergence_ = NULL;
+    weight_count_ = 0;
+    allocate(d_kl_divergence_, sizeof(float));
+    cudaHostAlloc((void **) &h_kl_divergence_, sizeof(float), cudaHostAllocDefault);
+
+    d_moment_coefficients_ = NULL;
+    d_moment_sums_ = NULL;
+
+    d_likelihood_table_ = NULL;
+    d_texture_array_ = NULL;
+    d_depth_buffer_ = NULL;
+    geometry_mapped_ = false;
+    persistent_evaluation_ = false;
+    incremental_occlusions_ = false;
+    d_tile_rows_ = NULL;
+    d_tile_rows_copy_ = NULL;
+    d_tile_states_ = NULL;
+    d_work_regions_ = NULL;
+    d_work_offsets_ = NULL;
+    d_work_counter_ = NULL;
+    d_readback_ = NULL;
+    d_readback_indices_ = NULL;
+    readback_capacity_ = 0;
+    d_occlusion_staging_ = NULL;
+    occlusion_staging_capacity_ = 0;
+    d_occlusion_slots_ = NULL;
+    memset(&parameters_, 0, sizeof(parameters_));
+    occlusion_storage_ = OcclusionStorage::float32;
+
+    pipelining_ = false;
+    upload_stream_ = 0;
+
+    // all work of this evaluator is ordered on its own non blocking stream,
+    // hence it never waits for other trackers or the default stream. The
+    // OpenGL interop is ordered by mapping the resources on this stream.
+    cudaStreamCreateWithFlags(&compute_stream_, cudaStreamNonBlocking);
+    #ifdef DEBUG
+        check_cuda_error("creating the compute stream");
+    #endif
+    upload_slot_ = 0;
+    for (int i = 0; i < 2; i++) {
+        h_observation_buffers_[i] = NULL;
+        d_observation_buffers_[i] = NULL;
+    }
+
+    PixelRegion empty = {0, 0, 0, 0};
+    PixelRegion full = {0, 0, nr_rows_, nr_cols_};
+    occlusion_region_ = empty;
+    evaluation_region_ = full;
+    occlusion_slot_count_ = 0;
+
+    set_nr_threads(DEFAULT_NR_THREADS);
+}
+
+
+
+void CudaEvaluator::init(const float initial_occlusion_prob, const float p_occluded_occluded, const float p_occluded_visible,
+                      const float tail_weight, const float model_sigma, const float sigma_factor, const float max_depth, const float exponential_rate) {
+
+    occlusion_time_ = 0;
+    occlusion_prob_default_ = initial_occlusion_prob;
+    outside_occlusion_prob_ = initial_occlusion_prob;
+
+    // precompute constants that are used in high-performance kernels later
+    float c = p_occluded_occluded - p_occluded_visible;
+    float tail_weight_div_max_depth = tail_weight / max_depth;
+    float one_minus_tail_weight = 1.0f - tail_weight;
+    float one_div_c_minus_one = 1.0f / (c - 1.0f);
+    float one_div_sqrt_of_two = 1.0f / sqrt(2);
+    float one_div_sqrt_of_two_pi = 1.0f / sqrt(2 * M_PI);
+    float log_c = log(c);
+
+    // the kernels receive the constants with every launch
+    parameters_.p_occluded_occluded = p_occluded_occluded;
+    parameters_.one_div_c_minus_one = one_div_c_minus_one;
+    parameters_.log_c = log_c;
+    parameters_.one_minus_tail_weight = one_minus_tail_weight;
+    parameters_.model_sigma = model_sigma;
+    parameters_.sigma_factor = sigma_factor;
+    parameters_.tail_weight_div_max_depth = tail_weight_div_max_depth;
+    parameters_.exponential_rate = exponential_rate;
+    parameters_.one_div_sqrt_of_two = one_div_sqrt_of_two;
+    parameters_.one_div_sqrt_of_two_pi = one_div_sqrt_of_two_pi;
+
+    constants_initialized_ = true;
+}
+
+
+
+
+
+bool CudaEvaluator::weigh_poses_on_device(const bool update_occlusions) {
+    if (observations_set_ && occlusion_indices_set_
+            && memory_allocated_ && number_of_poses_set_ && constants_initialized_
+            && (texture_array_mapped_ || geometry_mapped_)) {
+
+        double delta_time = observation_time_ - occlusion_time_;
+
+        // the pixels outside of the region of interest have never been observed, they all share the same propagated value
+        float outside_occlusion_prob = propagate_occlusion(outside_occlusion_prob_, delta_time);
+        if(update_occlusions) {
+            occlusion_time_ = observation_time_;
+            outside_occlusion_prob_ = outside_occlusion_prob;
+            occlusion_slot_count_ = nr_poses_;
+        }
+
+        const OcclusionTiles tiles = occlusion_tiles();
+
+
+        if (geometry_mapped_) {
+            // the poses are rendered within the kernel, the geometry is only valid for this call
+            size_t shared_size = evaluation_region_.rows * evaluation_region_.cols * sizeof(float);
+            if (d_likelihood_table_) {
+                DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+                    (fused_evaluate_kernel<OcclusionType, true> <<< grid_dimension_, nr_threads_, shared_size, compute_stream_ >>> (
+                        parameters_, geometry_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_,
+                        d_occlusion_indices_, occlusion_region_, evaluation_region_, outside_occlusion_prob,
+                        d_log_likelihoods_, delta_time, nr_poses_, nr_cols_, update_occlusions, tiles)));
+            } else {
+                DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+                    (fused_evaluate_kernel<OcclusionType, false> <<< grid_dimension_, nr_threads_, shared_size, compute_stream_ >>> (
+                        parameters_, geometry_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_,
+                        d_occlusion_indices_, occlusion_region_, evaluation_region_, outside_occlusion_prob,
+                        d_log_likelihoods_, delta_time, nr_poses_, nr_cols_, update_occlusions, tiles)));
+            }
+            geometry_mapped_ = false;
+        } else if (persistent_evaluation_ && int(pose_regions_.size()) >= nr_poses_ && !(tiles.rows && update_occlusions)) {
+            weigh_persistently(update_occlusions, outside_occlusion_prob, delta_time, tiles);
+        } else if (d_likelihood_table_) {
+            DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+                (evaluate_kernel<OcclusionType, true> <<< grid_dimension_, nr_threads_, 0, compute_stream_ >>> (
+                    parameters_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_, d_occlusion_indices_,
+                    occlusion_region_, evaluation_region_, outside_occlusion_prob,
+                    d_log_likelihoods_, delta_time, nr_poses_, nr_rows_, nr_cols_, update_occlusions, tiles)));
+        } else {
+            DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+                (evaluate_kernel<OcclusionType, false> <<< grid_dimension_, nr_threads_, 0, compute_stream_ >>> (
+                    parameters_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_, d_occlusion_indices_,
+                    occlusion_region_, evaluation_region_, outside_occlusion_prob,
+                    d_log_likelihoods_, delta_time, nr_poses_, nr_rows_, nr_cols_, update_occlusions, tiles)));
+        }
+        #ifdef DEBUG
+            check_cuda_error("compare kernel call");
+        #endif
+
+        // switch to new / copied occlusion probabilities. Later work on the compute stream is ordered
+        // after the kernel, hence there is no need to wait for it here.
+        if (update_occlusions && tiles.rows) {
+            advance_occlusion_tiles(tiles, delta_time);
+        } else if (update_occlusions) {
+            void *tmp_pointer;
+            tmp_pointer = d_occlusion_probs_;
+            d_occlusion_probs_ = d_occlusion_probs_copy_;
+            d_occlusion_probs_copy_ = tmp_pointer;
+        }
+
+        return true;
+    } else {
+        std::cout << "WARNING (CUDA): It seems you forgot to do one of the following: set observation image, set occlusion"
+                  << " indices, set number of poses, allocate memory, map texture to texture array or inisitialize constants." << std::endl;
+        return false;
+    }
+}
+
+
+
+void CudaEvaluator::weigh_persistently(const bool update_occlusions, const float outside_occlusion_prob, const float delta_time,
+                                       const OcclusionTiles& tiles) {
+    const dbot::ImageRegion evaluation(evaluation_region_.row, evaluation_region_.col,
+                                       evaluation_region_.rows, evaluation_region_.cols);
+    const dbot::ImageRegion stored(occlusion_region_.row, occlusion_region_.col,
+                                   occlusion_region_.rows, occlusion_region_.cols);
+
+    // the pixels a pose covers and, if updated, all its stored occlusions which are copied
+    h_work_regions_.resize(2 * nr_poses_);
+    h_work_offsets_.resize(nr_poses_ + 1);
+    h_work_offsets_[0] = 0;
+    for (int i = 0; i < nr_poses_; i++) {
+        const PixelRegion& region = pose_regions_[i];
+        dbot::ImageRegion covered = evaluation.intersect(dbot::ImageRegion(region.row, region.col, region.rows, region.cols));
+        dbot::ImageRegion work = update_occlusions ? stored.unite(covered) : covered;
+
+        PixelRegion work_region = {work.row, work.col, work.rows, work.cols};
+        PixelRegion covered_region = {covered.row, covered.col, covered.rows, covered.cols};
+        h_work_regions_[2 * i] = work_region;
+        h_work_regions_[2 * i + 1] = covered_region;
+        h_work_offsets_[i + 1] = h_work_offsets_[i] + (work.area() + PERSISTENT_TILE_PIXELS - 1) / PERSISTENT_TILE_PIXELS;
+    }
+
+    cudaMemcpyAsync(d_work_regions_, h_work_regions_.data(), sizeof(PixelRegion) * 2 * nr_poses_,
+                    cudaMemcpyHostToDevice, compute_stream_);
+    cudaMemcpyAsync(d_work_offsets_, h_work_offsets_.data(), sizeof(int) * (nr_poses_ + 1),
+                    cudaMemcpyHostToDevice, compute_stream_);
+    cudaMemsetAsync(d_work_counter_, 0, sizeof(int), compute_stream_);
+    cudaMemsetAsync(d_log_likelihoods_, 0, sizeof(float) * nr_poses_, compute_stream_);
+
+    // as many blocks as are resident at once
+    int nr_blocks = cuda_device_properties_.multiProcessorCount *
+                    max(1, cuda_device_properties_.maxThreadsPerMultiProcessor / PERSISTENT_THREADS);
+    if (d_likelihood_table_) {
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (persistent_evaluate_kernel<OcclusionType, true> <<< nr_blocks, PERSISTENT_THREADS, 0, compute_stream_ >>> (
+                parameters_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_,
+                d_occlusion_indices_, occlusion_region_, d_work_regions_, d_work_offsets_, d_work_counter_, outside_occlusion_prob,
+                d_log_likelihoods_, delta_time, nr_poses_, nr_rows_, nr_cols_, grid_dimension_.x, grid_dimension_.y, update_occlusions,
+                tiles)));
+    } else {
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (persistent_evaluate_kernel<OcclusionType, false> <<< nr_blocks, PERSISTENT_THREADS, 0, compute_stream_ >>> (
+                parameters_, d_active_observations_, (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_,
+                d_occlusion_indices_, occlusion_region_, d_work_regions_, d_work_offsets_, d_work_counter_, outside_occlusion_prob,
+                d_log_likelihoods_, delta_time, nr_poses_, nr_rows_, nr_cols_, grid_dimension_.x, grid_dimension_.y, update_occlusions,
+                tiles)));
+    }
+
+    if (update_occlusions) {
+        identity_indices_kernel <<< (nr_poses_ + PERSISTENT_THREADS - 1) / PERSISTENT_THREADS, PERSISTENT_THREADS, 0, compute_stream_ >>> (
+            d_occlusion_indices_, nr_poses_);
+    }
+}
+
+
+
+void CudaEvaluator::weigh_poses(const bool update_occlusions, vector<float> &log_likelihoods) {
+    if (!weigh_poses_on_device(update_occlusions)) return;
+
+    cudaMemcpyAsync(&log_likelihoods[0], d_log_likelihoods_, nr_poses_ * sizeof(float), cudaMemcpyDeviceToHost, compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_log_likelihoods -> log_likelihoods");
+    #endif
+
+    // only wait for this stream, a concurrent observation upload goes on
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaStreamSynchronize compare");
+    #endif
+}
+
+
+
+float* CudaEvaluator::device_log_likelihoods() {
+    return d_log_likelihoods_;
+}
+
+
+
+void CudaEvaluator::reduce_sigma_point_moments(const MomentParameters& model, const float* coefficients,
+                                               const int dimension, vector<double>& sums) {
+    int nr_sums = dimension * (dimension + 1) / 2 + dimension;
+    sums.assign(nr_sums, 0);
+
+    if (!(observations_set_ && memory_allocated_ && number_of_poses_set_ && texture_array_mapped_)) {
+        std::cout << "WARNING (CUDA): It seems you forgot to do one of the following: set observation image, set number"
+                  << " of poses, allocate memory or map texture to texture array." << std::endl;
+        return;
+    }
+    if (dimension > MAX_MOMENT_DIMENSION || nr_poses_ != 2 * dimension + 1) {
+        std::cout << "ERROR (CUDA): reduce_sigma_point_moments requires 2 * dimension + 1 poses and a dimension of at"
+                  << " most " << MAX_MOMENT_DIMENSION << ", got " << nr_poses_ << " poses of dimension "
+                  << dimension << "." << std::endl;
+        exit(-1);
+    }
+
+    int nr_pixels = evaluation_region_.rows * evaluation_region_.cols;
+    if (nr_pixels == 0) return;
+    int nr_blocks = (nr_pixels + nr_threads_ - 1) / nr_threads_;
+
+    // the coefficients of the largest dimension fit into the same buffer
+    if (d_moment_coefficients_ == NULL) {
+        allocate(d_moment_coefficients_, sizeof(float) * 2 * MAX_SIGMA_POINTS * (1 + MAX_MOMENT_DIMENSION));
+    }
+    if (moment_sums_.size() < size_t(nr_blocks * nr_sums)) {
+        moment_sums_.resize(nr_blocks * nr_sums);
+        allocate(d_moment_sums_, sizeof(float) * moment_sums_.size());
+    }
+
+    cudaMemcpyAsync(d_moment_coefficients_, coefficients, sizeof(float) * 2 * nr_poses_ * (1 + dimension),
+                    cudaMemcpyHostToDevice, compute_stream_);
+    sigma_point_moments_kernel <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+        parameters_, model, d_moment_coefficients_, d_active_observations_, evaluation_region_,
+        dimension, nr_poses_, nr_rows_, nr_cols_, grid_dimension_.x, grid_dimension_.y, d_moment_sums_);
+    #ifdef DEBUG
+        check_cuda_error("sigma point moments kernel call");
+    #endif
+
+    cudaMemcpyAsync(&moment_sums_[0], d_moment_sums_, sizeof(float) * nr_blocks * nr_sums,
+                    cudaMemcpyDeviceToHost, compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_moment_sums -> moment_sums");
+    #endif
+
+    // the blocks are added in order, the sums do not depend on the scheduling
+    for (int block = 0; block < nr_blocks; block++) {
+        for (int k = 0; k < nr_sums; k++) {
+            sums[k] += moment_sums_[block * nr_sums + k];
+        }
+    }
+}
+
+
+
+void CudaEvaluator::reset_weights(const int nr_poses) {
+    if (!memory_allocated_ || nr_poses > max_nr_poses_) {
+        std::cout << "ERROR (CUDA): reset_weights requires allocated memory for at least "
+                  << nr_poses << " poses." << std::endl;
+        exit(-1);
+    }
+
+    int nr_blocks = (nr_poses + nr_threads_ - 1) / nr_threads_;
+    reset_weights_kernel <<< max(nr_blocks, 1), nr_threads_, 0, compute_stream_ >>> (d_log_weights_, d_previous_log_likelihoods_,
+                                                                                 d_occlusion_indices_, nr_poses);
+    #ifdef DEBUG
+        check_cuda_error("reset weights kernel call");
+    #endif
+
+    weight_count_ = nr_poses;
+    occlusion_indices_set_ = true;
+}
+
+
+
+float CudaEvaluator::update_weights() {
+    if (weight_count_ != nr_poses_) {
+        std::cout << "ERROR (CUDA): There are " << weight_count_ << " weights on the device but "
+                  << nr_poses_ << " poses were weighed. Call reset_weights first." << std::endl;
+        exit(-1);
+    }
+
+    update_weights_kernel <<< 1, weight_threads(), 0, compute_stream_ >>> (d_log_weights_, d_log_likelihoods_,
+                                                                          d_previous_log_likelihoods_, nr_poses_,
+                                                                          d_kl_divergence_);
+    #ifdef DEBUG
+        check_cuda_error("update weights kernel call");
+    #endif
+
+    // the only value the host needs in order to decide about resampling
+    cudaMemcpyAsync(h_kl_divergence_, d_kl_divergence_, sizeof(float), cudaMemcpyDeviceToHost, compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_kl_divergence -> kl_divergence");
+    #endif
+
+    return *h_kl_divergence_;
+}
+
+
+
+void CudaEvaluator::resample_weights(const float offset, int* parents) {
+    systematic_resample_kernel <<< 1, weight_threads(), 0, compute_stream_ >>> (d_log_weights_, d_cumulative_weights_,
+                                                                               d_occlusion_indices_, d_occlusion_indices_copy_,
+                                                                               d_previous_log_likelihoods_,
+                                                                               d_previous_log_likelihoods_copy_,
+                                                                               d_parents_, weight_count_, offset);
+    #ifdef DEBUG
+        check_cuda_error("systematic resample kernel call");
+    #endif
+
+    std::swap(d_occlusion_indices_, d_occlusion_indices_copy_);
+    std::swap(d_previous_log_likelihoods_, d_previous_log_likelihoods_copy_);
+
+    // the host needs the parents to gather the states
+    cudaMemcpyAsync(parents, d_parents_, weight_count_ * sizeof(int), cudaMemcpyDeviceToHost, compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_parents -> parents");
+    #endif
+}
+
+
+
+void CudaEvaluator::get_log_weights(float* log_weights) {
+    cudaMemcpyAsync(log_weights, d_log_weights_, weight_count_ * sizeof(float), cudaMemcpyDeviceToHost, compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_log_weights -> log_weights");
+    #endif
+}
+
+
+void CudaEvaluator::set_log_weights(const float* log_weights, const int nr_poses) {
+    reset_weights(nr_poses);
+
+    cudaMemcpyAsync(d_log_weights_, log_weights, nr_poses * sizeof(float), cudaMemcpyHostToDevice, compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy log_weights -> d_log_weights");
+    #endif
+}
+
+
+
+void CudaEvaluator::get_occlusion_indices(int* occlusion_indices) {
+    cudaMemcpyAsync(occlusion_indices, d_occlusion_indices_, weight_count_ * sizeof(int), cudaMemcpyDeviceToHost,
+                    compute_stream_);
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy d_occlusion_indices -> occlusion_indices");
+    #endif
+}
+
+
+
+
+
+
+
+
+
+// ===================================================================================== //
+// =============================== CUDA EVALUATOR SETTERS ================================= //
+// ===================================================================================== //
+
+void CudaEvaluator::set_nr_threads(const int nr_threads) {
+    if (nr_threads > cuda_device_properties_.maxThreadsDim[0]) {
+        std::cout << "ERROR (CUDA): The number of threads you requested ("
+                  << nr_threads << ") is not supported my CUDA. Max #threads: "
+                  << cuda_device_properties_.maxThreadsDim[0] << std::endl;
+        exit(-1);
+    }
+
+    nr_threads_ = nr_threads;
+}
+
+
+
+void CudaEvaluator::set_observations(const float* observations, const float observation_time) {
+
+    if (nr_rows_ * nr_cols_ > observations_size_) {
+        std::cout << "ERROR (CUDA) in set_observations: You exceeded "
+                  << "(" << nr_rows_ * nr_cols_ << ")"
+                  << "the memory space that was allocated for the observation "
+                  << "values (" << observations_size_ << ")." << std::endl;
+        exit(-1);
+    }
+
+    observation_time_ = observation_time;
+
+    // observations is pageable, the driver has staged it when the call returns. The kernels which
+    // read the observations are ordered after the copy on the same stream.
+    cudaMemcpyAsync(d_observations_, observations, nr_cols_ * nr_rows_ * sizeof(float), cudaMemcpyHostToDevice,
+                    compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy observations -> d_observations_");
+    #endif
+
+    d_active_observations_ = d_observations_;
+    compact_observations();
+    observations_set_ = true;
+}
+
+
+
+void CudaEvaluator::compact_observations() {
+    const int nr_pixels = nr_rows_ * nr_cols_;
+    if (nr_pixels == 0) return;
+
+    valid_mask_kernel <<< (nr_pixels + COMPACTION_THREADS - 1) / COMPACTION_THREADS, COMPACTION_THREADS, 0, compute_stream_ >>> (
+        d_active_observations_, d_valid_mask_, nr_pixels);
+    count_valid_kernel <<< nr_rows_, COMPACTION_THREADS, 0, compute_stream_ >>> (
+        d_valid_mask_, d_valid_row_offsets_, nr_cols_);
+    scan_rows_kernel <<< 1, 1, 0, compute_stream_ >>> (d_valid_row_offsets_, nr_rows_);
+    compact_observations_kernel <<< nr_rows_, COMPACTION_THREADS, 0, compute_stream_ >>> (
+        d_active_observations_, d_valid_mask_, d_valid_row_offsets_, d_valid_pixels_, d_valid_depths_, nr_cols_);
+    #ifdef DEBUG
+        check_cuda_error("compacting the observations");
+    #endif
+}
+
+
+
+void CudaEvaluator::enable_pipelining() {
+
+    if (!memory_allocated_) {
+        std::cout << "WARNING (CUDA): It seems you forgot to call "
+                  << "allocate_memory_for_max_poses before calling "
+                  << "enable_pipelining." << std::endl;
+        return;
+    }
+    if (pipelining_) return;
+
+    // non blocking, such that the uploads overlap with the compute stream
+    cudaStreamCreateWithFlags(&upload_stream_, cudaStreamNonBlocking);
+    for (int i = 0; i < 2; i++) {
+        cudaEventCreateWithFlags(&upload_events_[i], cudaEventDisableTiming);
+    }
+    #ifdef DEBUG
+        check_cuda_error("creating the pipelining streams");
+    #endif
+
+    pipelining_ = true;
+    allocate_pipeline_buffers();
+}
+
+
+
+float* CudaEvaluator::begin_observation_upload() {
+
+    if (!pipelining_) {
+        std::cout << "ERROR (CUDA): begin_observation_upload requires "
+                  << "enable_pipelining()." << std::endl;
+        exit(-1);
+    }
+
+    // the slot may still be read by a previous upload
+    cudaEventSynchronize(upload_events_[upload_slot_]);
+    #ifdef DEBUG
+        check_cuda_error("cudaEventSynchronize begin_observation_upload");
+    #endif
+
+    return h_observation_buffers_[upload_slot_];
+}
+
+
+
+void CudaEvaluator::end_observation_upload() {
+
+    cudaMemcpyAsync(d_observation_buffers_[upload_slot_], h_observation_buffers_[upload_slot_],
+                    nr_rows_ * nr_cols_ * sizeof(float), cudaMemcpyHostToDevice, upload_stream_);
+    cudaEventRecord(upload_events_[upload_slot_], upload_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpyAsync end_observation_upload");
+    #endif
+}
+
+
+
+void CudaEvaluator::activate_observation(const float observation_time) {
+
+    // all following work on the compute stream waits for the upload
+    cudaStreamWaitEvent(compute_stream_, upload_events_[upload_slot_], 0);
+    #ifdef DEBUG
+        check_cuda_error("cudaStreamWaitEvent activate_observation");
+    #endif
+
+    d_active_observations_ = d_observation_buffers_[upload_slot_];
+    upload_slot_ = 1 - upload_slot_;
+    compact_observations();
+
+    observation_time_ = observation_time;
+    observations_set_ = true;
+}
+
+
+
+cudaStream_t CudaEvaluator::compute_stream() const {
+    return compute_stream_;
+}
+
+
+
+void CudaEvaluator::set_occlusion_indices(const int* occlusion_indices,
+                                          const int array_size) {
+
+    if (array_size > max_nr_poses_) {
+        std::cout << "ERROR (CUDA): The amount of occlusion indices sent to "
+                  << "the GPU (" << array_size << ") exceeds the amount of "
+                  << "maximum poses (" << max_nr_poses_ << ")." << std::endl;
+        exit(-1);
+    }
+
+    cudaMemcpyAsync(d_occlusion_indices_, occlusion_indices,
+                    array_size * sizeof(int), cudaMemcpyHostToDevice, compute_stream_);
+
+    #ifdef DEBUG
+        check_cuda_error("cudaMemcpy occlusion_indices -> d_occlusion_indices");
+    #endif
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaStreamSynchronize set_occlusion_indices");
+    #endif
+
+    occlusion_indices_set_ = true;
+}
+
+
+void CudaEvaluator::set_resolution(const int nr_rows, const int nr_cols) {
+
+    const bool changed = nr_rows != nr_rows_ || nr_cols != nr_cols_;
+    nr_rows_ = nr_rows;
+    nr_cols_ = nr_cols;
+
+    PixelRegion full = {0, 0, nr_rows_, nr_cols_};
+    evaluation_region_ = full;
+
+    // the buffers stay, the occlusion region refers to the old pixels
+    if (changed && memory_allocated_) {
+        cudaStreamSynchronize(compute_stream_);
+        reset_occlusion_probabilities();
+    }
+}
+
+
+void CudaEvaluator::set_occlusion_probabilities(const float* occlusion_probabilities,
+                                                const int array_size) {
+
+    if (array_size > nr_rows_ * nr_cols_ * max_nr_poses_) {
+        std::cout << "ERROR (CUDA) in set_occlusion_probabilities: You exceeded "
+                  << "(" << array_size << ")"
+                  << "the memory space that was allocated for the occlusion "
+                  << "probabilities (" << nr_rows_ * nr_cols_ * max_nr_poses_ << "." << std::endl;
+        exit(-1);
+    }
+
+    // full images are given, hence the region of interest is the full image
+    resolve_occlusion_tiles();
+    PixelRegion full = {0, 0, nr_rows_, nr_cols_};
+    set_occlusion_region(full);
+
+    // ordered after the relayout of set_occlusion_region on the compute stream,
+    // the probabilities are converted into the storage type on the device one
+    // image of the staging buffer after the other
+    for (int offset = 0; offset < array_size; offset += observations_size_) {
+        int size = min(observations_size_, array_size - offset);
+        cudaMemcpyAsync(d_occlusion_staging_, occlusion_probabilities + offset,
+                        size * sizeof(float), cudaMemcpyHostToDevice, compute_stream_);
+
+        #ifdef DEBUG
+            check_cuda_error("cudaMemcpy occlusion_probabilities -> d_occlusion_probs_");
+        #endif
+        int nr_blocks = min((size + nr_threads_ - 1) / nr_threads_, cuda_device_properties_.maxGridSize[0]);
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (encode_occlusions_kernel<OcclusionType> <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+                d_occlusion_staging_, (OcclusionType*) d_occlusion_probs_ + offset, size)));
+        #ifdef DEBUG
+            check_cuda_error("encode occlusions kernel call");
+        #endif
+    }
+    cudaStreamSynchronize(compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("cudaStreamSynchronize set_occlusion_probabilities");
+    #endif
+}
+
+
+void CudaEvaluator::set_occlusion_probabilities(const int slot,
+                                                const float* occlusion_probabilities) {
+    set_occlusion_probabilities(&slot, 1, occlusion_probabilities);
+}
+
+
+void CudaEvaluator::set_occlusion_probabilities(const int* slots,
+                                                const int count,
+                                                const float* occlusion_probabilities) {
+
+    if (count > max_nr_poses_) {
+        std::cout << "ERROR (CUDA) in set_occlusion_probabilities: " << count
+                  << " slots exceed the " << max_nr_poses_ << " allocated slots." << std::endl;
+        exit(-1);
+    }
+    for (int i = 0; i < count; i++) {
+        if (slots[i] < 0 || slots[i] >= max_nr_poses_) {
+            std::cout << "ERROR (CUDA) in set_occlusion_probabilities: slot " << slots[i]
+                      << " exceeds the " << max_nr_poses_ << " allocated slots." << std::endl;
+            exit(-1);
+        }
+    }
+
+    // later relayouts of the region of interest move the slots along
+    resolve_occlusion_tiles();
+    for (int i = 0; i < count; i++) {
+        occlusion_slot_count_ = max(occlusion_slot_count_, slots[i] + 1);
+    }
+
+    int area = occlusion_region_.rows * occlusion_region_.cols;
+    if (area == 0 || count == 0) return;
+
+    // the staging buffer only grows for larger batches than any before
+    if (count > occlusion_staging_capacity_) {
+        allocate(d_occlusion_staging_, size_t(count) * observations_size_ * sizeof(float));
+        occlusion_staging_capacity_ = count;
+    }
+    h_occlusion_staging_.resize(max(size_t(count) * area, h_occlusion_staging_.size()));
+
+    for (int i = 0; i < count; i++) {
+        const float* image = occlusion_probabilities + size_t(i) * nr_rows_ * nr_cols_;
+        float* region_image = &h_occlusion_staging_[size_t(i) * area];
+        for (int row = 0; row < occlusion_region_.rows; row++) {
+            for (int col = 0; col < occlusion_region_.cols; col++) {
+                region_image[row * occlusion_region_.cols + col] =
+                    image[(row + occlusion_region_.row) * nr_cols_ + col + occlusion_region_.col];
+            }
+        }
+    }
+
+    // the copies out of pageable memory return once the host buffers may be
+    // reused, the conversion is ordered after them on the compute stream
+    cudaMemcpyAsync(d_occlusion_slots_, slots, count * sizeof(int), cudaMemcpyHostToDevice, compute_stream_);
+    cudaMemcpyAsync(d_occlusion_staging_, &h_occlusion_staging_[0],
+                    size_t(count) * area * sizeof(float), cudaMemcpyHostToDevice, compute_stream_);
+    dim3 grid(min((area + nr_threads_ - 1) / nr_threads_, cuda_device_properties_.maxGridSize[0]), count);
+    DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+        (encode_occlusion_slots_kernel<OcclusionType> <<< grid, nr_threads_, 0, compute_stream_ >>> (
+            d_occlusion_staging_, d_occlusion_slots_, (OcclusionType*) d_occlusion_probs_, area)));
+    #ifdef DEBUG
+        check_cuda_error("encode occlusion slots kernel call");
+    #endif
+}
+
+
+void CudaEvaluator::reset_occlusion_probabilities() {
+
+    PixelRegion empty = {0, 0, 0, 0};
+    occlusion_region_ = empty;
+    occlusion_slot_count_ = max_nr_poses_;
+    outside_occlusion_prob_ = occlusion_prob_default_;
+    occlusion_time_ = 0;
+    reset_occlusion_tiles();
+}
+
+
+void CudaEvaluator::set_occlusion_time(const float occlusion_time,
+                                       const float outside_occlusion_probability) {
+    occlusion_time_ = occlusion_time;
+    outside_occlusion_prob_ = outside_occlusion_probability;
+}
+
+
+void CudaEvaluator::set_occlusion_region(const PixelRegion& region) {
+
+    if (region.row == occlusion_region_.row && region.col == occlusion_region_.col &&
+        region.rows == occlusion_region_.rows && region.cols == occlusion_region_.cols) {
+        return;
+    }
+
+    // the relayout reads the rows of d_occlusion_probs_
+    resolve_occlusion_tiles();
+
+    int area = region.rows * region.cols;
+    int required_size = area * max_nr_poses_;
+    if (required_size > occlusion_probs_size_) {
+        allocate(d_occlusion_probs_copy_, required_size * occlusion_element_size());
+    }
+
+    if (area > 0 && occlusion_slot_count_ > 0) {
+        int nr_blocks = min(occlusion_slot_count_, cuda_device_properties_.maxGridSize[0]);
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (relayout_kernel<OcclusionType> <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+                (OcclusionType*) d_occlusion_probs_, (OcclusionType*) d_occlusion_probs_copy_,
+                occlusion_region_, region, outside_occlusion_prob_, occlusion_slot_count_)));
+        #ifdef DEBUG
+            check_cuda_error("relayout kernel call");
+        #endif
+    }
+
+    void *tmp_pointer;
+    tmp_pointer = d_occlusion_probs_;
+    d_occlusion_probs_ = d_occlusion_probs_copy_;
+    d_occlusion_probs_copy_ = tmp_pointer;
+
+    // the old buffer is not needed anymore, it can be grown without copying
+    if (required_size > occlusion_probs_size_) {
+        allocate(d_occlusion_probs_copy_, required_size * occlusion_element_size());
+        occlusion_probs_size_ = required_size;
+    }
 
+    occlusion_region_ = region;
+}
 
-        while (pixel_nr < nr_pixels ) {
 
-            depth = tex2D(texture_reference, texture_array_index_x, texture_array_index_y);
-            observed_depth = observations[pixel_nr];
+void CudaEvaluator::set_evaluation_region(const PixelRegion& region) {
 
-            occlusion_prob = propagate_occlusion(occlusion_probs[occlusion_pixel_index], delta_time);
-            if (update_occlusions) occlusion_probs[occlusion_pixel_index] = occlusion_prob;
+    evaluation_region_ = region;
+}
 
 
-            if (depth != 0 && !isnan(observed_depth)) {
+void CudaEvaluator::set_pose_regions(const PixelRegion* regions, const int nr_poses) {
 
-                // prob of observation given prediction, knowing that the object is not occluded
-                p_obsIpred_vis = prob(observed_depth, depth, false) * (1 - occlusion_prob);
-                // prob of observation given prediction, knowing that the object is occluded
-                p_obsIpred_occl = prob(observed_depth, depth, true) * occlusion_prob;
-                // prob of observation given no intersection
-                p_obsIinf = prob(observed_depth, CUDART_INF_F, true);
+    pose_regions_.assign(regions, regions + nr_poses);
+}
 
-                local_sum_of_likelihoods += __logf(__fdividef((p_obsIpred_vis + p_obsIpred_occl), p_obsIinf));
 
+void CudaEvaluator::set_persistent_evaluation(const bool persistent) {
 
-                if(update_occlusions) {
-                    // we update the occlusion probability with the observations
-                    occlusion_probs[occlusion_pixel_index] = 1 - __fdividef(p_obsIpred_vis, (p_obsIpred_vis + p_obsIpred_occl));
-                }
-            }
+    persistent_evaluation_ = persistent;
+}
 
-            pixel_nr += blockDim.x;
-            occlusion_pixel_index += blockDim.x;
-            texture_array_index_x = blockIdx.x * n_cols + pixel_nr % n_cols;
-            texture_array_index_y = gridDim.y * n_rows - (blockIdx.y * n_rows + (pixel_nr / n_cols) + 1);
-        }
 
-        atomicAdd(&log_likelihoods, local_sum_of_likelihoods);
+void CudaEvaluator::set_incremental_occlusions(const bool incremental) {
 
-        __syncthreads();
+    if (incremental == incremental_occlusions_) return;
 
-        if (threadIdx.x == 0) {
-            d_log_likelihoods[block_id] = log_likelihoods;
-        }
+    // the tiles are resolved while they can still be read through
+    resolve_occlusion_tiles();
+    incremental_occlusions_ = incremental;
+    if (incremental) {
+        allocate_occlusion_tiles();
     } else {
-        __syncthreads();
+        cudaStreamSynchronize(compute_stream_);
+        free_occlusion_tiles();
     }
-
 }
 
 
+void CudaEvaluator::free_occlusion_tiles() {
 
+    cudaFree(d_tile_rows_);
+    cudaFree(d_tile_rows_copy_);
+    cudaFree(d_tile_states_);
+    d_tile_rows_ = NULL;
+    d_tile_rows_copy_ = NULL;
+    d_tile_states_ = NULL;
+    occlusion_tile_map_.clear();
+}
 
 
+void CudaEvaluator::allocate_occlusion_tiles() {
 
-// ************************************************************************************** //
-// ************************************************************************************** //
-// ========================== cuda_likelihood_evaluator MEMBER FUNCTIONS ============================== //
-// ************************************************************************************** //
-// ************************************************************************************** //
-
+    if (!incremental_occlusions_ || !memory_allocated_) return;
 
-CudaEvaluator::CudaEvaluator(const int nr_rows,
-                       const int nr_cols) :
+    // any later occlusion region fits into the allocated resolution
+    occlusion_tile_map_.allocate(nr_rows_, nr_cols_);
+    const int capacity = occlusion_tile_map_.capacity();
+    allocate(d_tile_rows_, sizeof(int) * capacity * max_nr_poses_);
+    allocate(d_tile_rows_copy_, sizeof(int) * capacity * max_nr_poses_);
+    allocate(d_tile_states_, sizeof(OcclusionTileState) * capacity);
+    identity_tile_rows();
+}
 
-    nr_rows_(nr_rows),
-    nr_cols_(nr_cols)
-{
 
-    cudaDeviceProp  props;
-    int device_number;
+void CudaEvaluator::identity_tile_rows() {
 
-    memset( &props, 0, sizeof( cudaDeviceProp ) );
-    props.major = 2;
-    props.minor = 0;
-    cudaChooseDevice( &device_number, &props );
+    int n = occlusion_tile_map_.capacity() * max_nr_poses_;
+    int nr_blocks = min((n + nr_threads_ - 1) / nr_threads_, cuda_device_properties_.maxGridSize[0]);
+    identity_tile_rows_kernel <<< max(nr_blocks, 1), nr_threads_, 0, compute_stream_ >>> (
+        d_tile_rows_, occlusion_tile_map_.capacity(), max_nr_poses_);
     #ifdef DEBUG
-        check_cuda_error("No device with compute capability > 2.0 found");
+        check_cuda_error("identity tile rows kernel call");
     #endif
+}
 
-    /* tell CUDA which device we will be using for graphic interop.
-     * Requires that the CUDA device be specified by
-     * cudaGLSetGLDevice() before any other runtime calls. */
 
-//    cudaGLSetGLDevice( device_number );
-    #ifdef DEBUG
-        check_cuda_error("cudaGLsetGLDevice");
-    #endif
+void CudaEvaluator::reset_occlusion_tiles() {
 
-    cudaGetDeviceProperties(&props, device_number);     // we will run the program only on one graphics card, the first one we can find = 0
+    if (!occlusion_tile_map_.resolved() && d_tile_rows_ != NULL) identity_tile_rows();
+    occlusion_tile_map_.reset();
+}
 
-    cuda_device_properties_ = props;
 
-    #ifdef DEBUG
-        cout << "Your device has the following properties: " << endl
-             << "CUDA Version: " << props.major << "." << props.minor << endl
-             << "Number of multiprocessors: " << props.multiProcessorCount << endl;
-    #endif
+CudaEvaluator::OcclusionTiles CudaEvaluator::occlusion_tiles() {
 
-    /* each multiprocessor has various KB of memory (64 KB for the GTX 560 Ti 448) which can be subdivided
-     * into L1 cache or shared memory. If you don't need a lot of shared memory set this to prefer L1. */
-    cudaDeviceSetCacheConfig(cudaFuncCachePreferL1);
+    OcclusionTiles tiles;
+    memset(&tiles, 0, sizeof(tiles));
+    if (!incremental_occlusions_ || d_tile_rows_ == NULL) return tiles;
 
+    occlusion_tile_map_.set_region(occlusion_region_.rows, occlusion_region_.cols);
+    tiles.rows = d_tile_rows_;
+    tiles.next_rows = d_tile_rows_copy_;
+    tiles.states = d_tile_states_;
+    tiles.buffers[0] = d_occlusion_probs_;
+    tiles.buffers[1] = d_occlusion_probs_copy_;
+    tiles.slot_stride = max_nr_poses_;
+    tiles.tile_count = occlusion_tile_map_.tile_count();
+    tiles.tile_cols = occlusion_tile_map_.tile_cols();
 
-    d_occlusion_probs_ = NULL;
-    d_occlusion_probs_copy_ = NULL;
-    d_observations_ = NULL;
-    d_log_likelihoods_ = NULL;
-    d_occlusion_indices_ = NULL;
+    // an update writes the tiles of the stored pixels which the poses can cover
+    tiles.touched = occlusion_tile_map_.touched(evaluation_region_.row - occlusion_region_.row,
+                                                evaluation_region_.col - occlusion_region_.col,
+                                                evaluation_region_.rows, evaluation_region_.cols);
 
-    set_nr_threads(DEFAULT_NR_THREADS);
+    // the copy from pageable memory is staged, the host states may change right after
+    if (tiles.tile_count > 0) {
+        cudaMemcpyAsync(d_tile_states_, occlusion_tile_map_.states().data(), sizeof(OcclusionTileState) * tiles.tile_count,
+                        cudaMemcpyHostToDevice, compute_stream_);
+    }
+    return tiles;
 }
 
 
+void CudaEvaluator::advance_occlusion_tiles(const OcclusionTiles& tiles, const float delta_time) {
 
-void CudaEvaluator::init(const float initial_occlusion_prob, const float p_occluded_occluded, const float p_occluded_visible,
-                      const float tail_weight, const float model_sigma, const float sigma_factor, const float max_depth, const float exponential_rate) {
-
-    occlusion_time_ = 0;
-    occlusion_prob_default_ = initial_occlusion_prob;
+    occlusion_tile_map_.advance(tiles.touched, delta_time);
+    std::swap(d_tile_rows_, d_tile_rows_copy_);
+}
 
-    // precompute constants that are used in high-performance kernels later
-    float c = p_occluded_occluded - p_occluded_visible;
-    float tail_weight_div_max_depth = tail_weight / max_depth;
-    float one_minus_tail_weight = 1.0f - tail_weight;
-    float one_div_c_minus_one = 1.0f / (c - 1.0f);
-    float one_div_sqrt_of_two = 1.0f / sqrt(2);
-    float one_div_sqrt_of_two_pi = 1.0f / sqrt(2 * M_PI);
-    float log_c = log(c);
 
+void CudaEvaluator::resolve_occlusion_tiles() {
 
+    if (!incremental_occlusions_ || occlusion_tile_map_.resolved()) return;
 
-    // copy constants to GPU memory
-    cudaMemcpyToSymbol(g_initial_occlusion_prob, &initial_occlusion_prob, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol initial_occlusion_prob -> g_initial_occlusion_prob");
-    #endif
+    const int area = occlusion_region_.rows * occlusion_region_.cols;
+    if (area > 0 && occlusion_slot_count_ > 0) {
+        int nr_blocks = min(occlusion_slot_count_, cuda_device_properties_.maxGridSize[0]);
 
-    cudaMemcpyToSymbol(g_one_div_c_minus_one, &one_div_c_minus_one, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol one_div_c_minus_one -> g_one_div_c_minus_one");
-    #endif
+        // every tile moves into the own row of its slot in the buffer it is not in ...
+        OcclusionTiles tiles = occlusion_tiles();
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (move_occlusion_tiles_kernel<OcclusionType> <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+                tiles, occlusion_region_, parameters_, occlusion_slot_count_, -1)));
+        occlusion_tile_map_.move_all();
+        identity_tile_rows();
 
-    cudaMemcpyToSymbol(g_one_div_sqrt_of_two, &one_div_sqrt_of_two, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol one_div_sqrt_of_two -> g_one_div_sqrt_of_two");
-    #endif
+        // ... and those which are in the copy then move back to d_occlusion_probs_
+        tiles = occlusion_tiles();
+        DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+            (move_occlusion_tiles_kernel<OcclusionType> <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+                tiles, occlusion_region_, parameters_, occlusion_slot_count_, 1)));
+        #ifdef DEBUG
+            check_cuda_error("move occlusion tiles kernel call");
+        #endif
 
-    cudaMemcpyToSymbol(g_one_div_sqrt_of_two_pi, &one_div_sqrt_of_two_pi, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol one_div_sqrt_of_two_pi -> g_one_div_sqrt_of_two_pi");
-    #endif
+        // all tiles are in their own rows of d_occlusion_probs_ and up to date
+        occlusion_tile_map_.reset();
+        return;
+    }
 
-    cudaMemcpyToSymbol(g_log_c, &log_c, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol log_c -> g_log_c");
-    #endif
+    reset_occlusion_tiles();
+}
 
-    cudaMemcpyToSymbol(g_p_occluded_occluded, &p_occluded_occluded, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol p_occluded_occluded -> g_p_occluded_occluded");
-    #endif
 
-    cudaMemcpyToSymbol(g_one_minus_tail_weight, &one_minus_tail_weight, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol one_minus_tail_weight -> g_one_minus_tail_weight");
-    #endif
+void CudaEvaluator::set_likelihood_table(const dbot::PixelLikelihoodTable& table) {
+    clear_likelihood_table();
 
-    cudaMemcpyToSymbol(g_model_sigma, &model_sigma, sizeof(float), 0, cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol model_sigma -> g_model_sigma");
-    #endif
+    const dbot::PixelLikelihoodTable::Parameters& parameters = table.parameters();
+    const int width = parameters.difference_steps;
+    const int height = parameters.observation_steps;
 
-    cudaMemcpyToSymbol(g_sigma_factor, &sigma_factor, sizeof(float), 0, cudaMemcpyHostToDevice);
+    cudaChannelFormatDesc channel_desc = cudaCreateChannelDesc<float4>();
+    cudaMallocArray(&d_likelihood_table_, &channel_desc, width, height);
     #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol sigma_factor -> g_sigma_factor");
+        check_cuda_error("cudaMallocArray likelihood table");
     #endif
 
-    cudaMemcpyToSymbol(g_tail_weight_div_max_depth, &tail_weight_div_max_depth, sizeof(float), 0, cudaMemcpyHostToDevice);
+    cudaMemcpy2DToArray(d_likelihood_table_, 0, 0, table.entries().data(), width * sizeof(float4),
+                        width * sizeof(float4), height, cudaMemcpyHostToDevice);
     #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol tail_weight_div_max_depth -> g_tail_weight_div_max_depth");
+        check_cuda_error("cudaMemcpy2DToArray likelihood table");
     #endif
 
-    cudaMemcpyToSymbol(g_exponential_rate, &exponential_rate, sizeof(float), 0, cudaMemcpyHostToDevice);
+    cudaTextureDesc texture_desc;
+    memset(&texture_desc, 0, sizeof(texture_desc));
+    texture_desc.normalizedCoords = 0;
+    texture_desc.filterMode = cudaFilterModeLinear;
+    texture_desc.addressMode[0] = cudaAddressModeClamp;
+    texture_desc.addressMode[1] = cudaAddressModeClamp;
+    texture_desc.readMode = cudaReadModeElementType;
+    parameters_.likelihood_table = create_texture_object(d_likelihood_table_, texture_desc);
     #ifdef DEBUG
-        check_cuda_error("cudaMemcpyToSymbol exponential_rate -> g_exponential_rate");
+        check_cuda_error("cudaCreateTextureObject likelihood table");
     #endif
 
-
-    constants_initialized_ = true;
+    // the last sample is excluded, beyond it the table is clamped
+    parameters_.table_observation_scale = table.observation_scale();
+    parameters_.table_difference_scale = table.difference_scale();
+    parameters_.table_max_observation = (height - 1) / parameters_.table_observation_scale;
+    parameters_.table_max_difference = parameters.max_difference;
 }
 
 
 
+void CudaEvaluator::clear_likelihood_table() {
+    if (!d_likelihood_table_) return;
 
-
-void CudaEvaluator::weigh_poses(const bool update_occlusions, vector<float> &log_likelihoods) {
-    if (observations_set_ && occlusion_indices_set_
-            && memory_allocated_ && number_of_poses_set_ && constants_initialized_
-            && texture_array_mapped_) {
-
-        double delta_time = observation_time_ - occlusion_time_;
-        if(update_occlusions) occlusion_time_ = observation_time_;
+    cudaDestroyTextureObject(parameters_.likelihood_table);
+    parameters_.likelihood_table = 0;
+    cudaFreeArray(d_likelihood_table_);
+    d_likelihood_table_ = NULL;
+}
 
 
-        evaluate_kernel <<< grid_dimension_, nr_threads_ >>> (d_observations_, d_occlusion_probs_, d_occlusion_probs_copy_, d_occlusion_indices_, nr_cols_ * nr_rows_,
-                                               d_log_likelihoods_, delta_time, nr_poses_, nr_rows_, nr_cols_, update_occlusions);
-        #ifdef DEBUG
-            check_cuda_error("compare kernel call");
-        #endif
 
-        cudaDeviceSynchronize();
-        #ifdef DEBUG
-            check_cuda_error("cudaDeviceSynchronize compare_multiple");
-        #endif
+void CudaEvaluator::map_texture_to_texture_array(const cudaArray_t texture_array) {
 
-        // switch to new / copied occlusion probabilities
-        if (update_occlusions) {
-            float *tmp_pointer;
-            tmp_pointer = d_occlusion_probs_;
-            d_occlusion_probs_ = d_occlusion_probs_copy_;
-            d_occlusion_probs_copy_ = tmp_pointer;
-        }
+    // the interop array usually stays the same between frames, the texture object is only
+    // recreated if it changes
+    if (texture_array != d_texture_array_ || !parameters_.depth_texture) {
+        if (parameters_.depth_texture) cudaDestroyTextureObject(parameters_.depth_texture);
 
+        d_texture_array_ = texture_array;
+        d_depth_buffer_ = NULL;
 
-        cudaMemcpy(&log_likelihoods[0], d_log_likelihoods_, nr_poses_ * sizeof(float), cudaMemcpyDeviceToHost);
-        #ifdef DEBUG
-            check_cuda_error("cudaMemcpy d_log_likelihoods -> log_likelihoods");
-        #endif
+        cudaTextureDesc texture_desc;
+        memset(&texture_desc, 0, sizeof(texture_desc));
+        texture_desc.normalizedCoords = 0;
+        texture_desc.filterMode = cudaFilterModePoint;
+        texture_desc.addressMode[0] = cudaAddressModeClamp;
+        texture_desc.addressMode[1] = cudaAddressModeClamp;
+        texture_desc.readMode = cudaReadModeElementType;
+        parameters_.depth_texture = create_texture_object(d_texture_array_, texture_desc);
 
-        cudaDeviceSynchronize();
         #ifdef DEBUG
-            check_cuda_error("cudaDeviceSynchronize compare");
+            check_cuda_error("cudaCreateTextureObject");
         #endif
-    } else {
-        std::cout << "WARNING (CUDA): It seems you forgot to do one of the following: set observation image, set occlusion"
-                  << " indices, set number of poses, allocate memory, map texture to texture array or inisitialize constants." << std::endl;
     }
 
+    texture_array_mapped_ = true;
 }
 
 
 
+void CudaEvaluator::map_depth_buffer(const float* depth_buffer, size_t pitch, int width, int height) {
 
+    // the buffer only changes when it is reallocated, which unmaps it
+    if (depth_buffer != d_depth_buffer_ || !parameters_.depth_texture) {
+        if (parameters_.depth_texture) cudaDestroyTextureObject(parameters_.depth_texture);
 
+        d_texture_array_ = NULL;
+        d_depth_buffer_ = depth_buffer;
 
+        cudaResourceDesc resource_desc;
+        memset(&resource_desc, 0, sizeof(resource_desc));
+        resource_desc.resType = cudaResourceTypePitch2D;
+        resource_desc.res.pitch2D.devPtr = const_cast<float*>(depth_buffer);
+        resource_desc.res.pitch2D.desc = cudaCreateChannelDesc<float>();
+        resource_desc.res.pitch2D.width = width;
+        resource_desc.res.pitch2D.height = height;
+        resource_desc.res.pitch2D.pitchInBytes = pitch;
 
-// ===================================================================================== //
-// =============================== CUDA EVALUATOR SETTERS ================================= //
-// ===================================================================================== //
-
-void CudaEvaluator::set_nr_threads(const int nr_threads) {
-    if (nr_threads > cuda_device_properties_.maxThreadsDim[0]) {
-        std::cout << "ERROR (CUDA): The number of threads you requested ("
-                  << nr_threads << ") is not supported my CUDA. Max #threads: "
-                  << cuda_device_properties_.maxThreadsDim[0] << std::endl;
-        exit(-1);
-    }
-
-    nr_threads_ = nr_threads;
-}
-
+        cudaTextureDesc texture_desc;
+        memset(&texture_desc, 0, sizeof(texture_desc));
+        texture_desc.normalizedCoords = 0;
+        texture_desc.filterMode = cudaFilterModePoint;
+        texture_desc.addressMode[0] = cudaAddressModeClamp;
+        texture_desc.addressMode[1] = cudaAddressModeClamp;
+        texture_desc.readMode = cudaReadModeElementType;
 
+        parameters_.depth_texture = 0;
+        cudaCreateTextureObject(&parameters_.depth_texture, &resource_desc, &texture_desc, NULL);
 
-void CudaEvaluator::set_observations(const float* observations, const float observation_time) {
-
-    if (nr_rows_ * nr_cols_ > observations_size_) {
-        std::cout << "ERROR (CUDA) in set_observations: You exceeded "
-                  << "(" << nr_rows_ * nr_cols_ << ")"
-                  << "the memory space that was allocated for the observation "
-                  << "values (" << observations_size_ << ")." << std::endl;
-        exit(-1);
+        #ifdef DEBUG
+            check_cuda_error("cudaCreateTextureObject depth buffer");
+        #endif
     }
 
-    observation_time_ = observation_time;
-
-    cudaMemcpy(d_observations_, observations, nr_cols_ * nr_rows_ * sizeof(float), cudaMemcpyHostToDevice);
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpy observations -> d_observations_");
-    #endif
-    cudaDeviceSynchronize();
-    #ifdef DEBUG
-        check_cuda_error("cudaDeviceSynchronize set_observations");
-    #endif
-
-    observations_set_ = true;
+    texture_array_mapped_ = true;
 }
 
 
 
-void CudaEvaluator::set_occlusion_indices(const int* occlusion_indices,
-                                          const int array_size) {
-
-    if (array_size > max_nr_poses_) {
-        std::cout << "ERROR (CUDA): The amount of occlusion indices sent to "
-                  << "the GPU (" << array_size << ") exceeds the amount of "
-                  << "maximum poses (" << max_nr_poses_ << ")." << std::endl;
-        exit(-1);
-    }
-
-    cudaMemcpy(d_occlusion_indices_, occlusion_indices,
-               array_size * sizeof(int), cudaMemcpyHostToDevice);
-
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpy occlusion_indices -> d_occlusion_indices");
-    #endif
-    cudaDeviceSynchronize();
-    #ifdef DEBUG
-        check_cuda_error("cudaDeviceSynchronize set_occlusion_indices");
-    #endif
-
-    occlusion_indices_set_ = true;
-}
-
-
-void CudaEvaluator::set_resolution(const int nr_rows, const int nr_cols) {
+bool CudaEvaluator::map_geometry(const CudaRasterizer::Geometry& geometry) {
 
-    nr_rows_ = nr_rows;
-    nr_cols_ = nr_cols;
+    // the reductions of the kernel need a few bytes of static shared memory besides the depth
+    size_t shared_size = evaluation_region_.rows * evaluation_region_.cols * sizeof(float);
+    if (shared_size + 1024 > cuda_device_properties_.sharedMemPerBlock) return false;
 
+    geometry_ = geometry;
+    geometry_mapped_ = true;
+    return true;
 }
 
 
-void CudaEvaluator::set_occlusion_probabilities(const float* occlusion_probabilities,
-                                                const int array_size) {
-
-    if (array_size > occlusion_probs_size_) {
-        std::cout << "ERROR (CUDA) in set_occlusion_probabilities: You exceeded "
-                  << "(" << array_size << ")"
-                  << "the memory space that was allocated for the occlusion "
-                  << "probabilities (" << occlusion_probs_size_ << "." << std::endl;
-        exit(-1);
-    }
-
-    cudaMemcpy(d_occlusion_probs_, occlusion_probabilities,
-               array_size * sizeof(float), cudaMemcpyHostToDevice);
 
-    #ifdef DEBUG
-        check_cuda_error("cudaMemcpy occlusion_probabilities -> d_occlusion_probs_");
-    #endif
-    cudaDeviceSynchronize();
-    #ifdef DEBUG
-        check_cuda_error("cudaDeviceSynchronize set_occlusion_probabilities");
-    #endif
+void CudaEvaluator::unmap_texture() {
+    if (parameters_.depth_texture) cudaDestroyTextureObject(parameters_.depth_texture);
+    parameters_.depth_texture = 0;
+    d_texture_array_ = NULL;
+    d_depth_buffer_ = NULL;
+    texture_array_mapped_ = false;
 }
 
 
-void CudaEvaluator::map_texture_to_texture_array(const cudaArray_t texture_array) {
 
-    d_texture_array_ = texture_array;
-    cudaBindTextureToArray(texture_reference, d_texture_array_);
+cudaTextureObject_t CudaEvaluator::create_texture_object(const cudaArray_t array,
+                                                         const cudaTextureDesc& texture_desc) {
+    cudaResourceDesc resource_desc;
+    memset(&resource_desc, 0, sizeof(resource_desc));
+    resource_desc.resType = cudaResourceTypeArray;
+    resource_desc.res.array.array = array;
 
-    #ifdef DEBUG
-        check_cuda_error("cudaBindTextureToArray");
-    #endif
+    cudaTextureObject_t texture_object = 0;
+    cudaCreateTextureObject(&texture_object, &resource_desc, &texture_desc, NULL);
 
-    texture_array_mapped_ = true;
+    return texture_object;
 }
 
 
@@ -591,19 +2178,42 @@ void CudaEvaluator::allocate_memory_for_max_poses(int nr_poses,
         // reallocate arrays
         allocate(d_log_likelihoods_, sizeof(float) * max_nr_poses_);
         allocate(d_occlusion_indices_, sizeof(int) * max_nr_poses_);
-        occlusion_probs_size_ = nr_rows_ * nr_cols_ * max_nr_poses_;
-        allocate(d_occlusion_probs_, occlusion_probs_size_ * sizeof(float));
-        allocate(d_occlusion_probs_copy_, occlusion_probs_size_ * sizeof(float));
+        allocate(d_occlusion_indices_copy_, sizeof(int) * max_nr_poses_);
+        allocate(d_log_weights_, sizeof(float) * max_nr_poses_);
+        allocate(d_previous_log_likelihoods_, sizeof(float) * max_nr_poses_);
+        allocate(d_previous_log_likelihoods_copy_, sizeof(float) * max_nr_poses_);
+        allocate(d_cumulative_weights_, sizeof(float) * max_nr_poses_);
+        allocate(d_parents_, sizeof(int) * max_nr_poses_);
+        allocate(d_work_regions_, sizeof(PixelRegion) * 2 * max_nr_poses_);
+        allocate(d_work_offsets_, sizeof(int) * (max_nr_poses_ + 1));
+        allocate(d_work_counter_, sizeof(int));
+        weight_count_ = 0;
         observations_size_ = nr_rows_ * nr_cols_;
+        readback_capacity_ = 0;
         allocate(d_observations_, observations_size_ * sizeof(float));
-
-        vector<float> initial_occlusion_probs (nr_rows_ * nr_cols_ * max_nr_poses_,
-                                               occlusion_prob_default_);
-
-        cudaMemcpy(d_occlusion_probs_, &initial_occlusion_probs[0], occlusion_probs_size_ * sizeof(float), cudaMemcpyHostToDevice);
-        #ifdef DEBUG
-            check_cuda_error("cudaMemcpy occlusion_prob_default_ -> d_occlusion_probs_");
-        #endif
+        allocate(d_occlusion_staging_, observations_size_ * sizeof(float));
+        h_occlusion_staging_.resize(observations_size_);
+        occlusion_staging_capacity_ = 1;
+        allocate(d_occlusion_slots_, sizeof(int) * max_nr_poses_);
+        d_active_observations_ = d_observations_;
+        allocate(d_valid_pixels_, observations_size_ * sizeof(int));
+        allocate(d_valid_depths_, observations_size_ * sizeof(float));
+        allocate(d_valid_row_offsets_, (observations_size_ + 1) * sizeof(int));
+        allocate(d_valid_mask_, (observations_size_ + 31) / 32 * sizeof(unsigned int));
+        parameters_.valid_pixels = d_valid_pixels_;
+        parameters_.valid_depths = d_valid_depths_;
+        parameters_.valid_row_offsets = d_valid_row_offsets_;
+        parameters_.valid_mask = d_valid_mask_;
+        if (pipelining_) allocate_pipeline_buffers();
+
+        // the occlusion buffers are allocated once the region of interest is known
+        cudaFree(d_occlusion_probs_);
+        cudaFree(d_occlusion_probs_copy_);
+        d_occlusion_probs_ = NULL;
+        d_occlusion_probs_copy_ = NULL;
+        occlusion_probs_size_ = 0;
+        free_occlusion_tiles();
+        reset_occlusion_probabilities();
 
         // initialize log likelihoods with 0
         cudaMemset(d_log_likelihoods_, 0, sizeof(float) * max_nr_poses_);
@@ -617,6 +2227,7 @@ void CudaEvaluator::allocate_memory_for_max_poses(int nr_poses,
         #endif
 
         memory_allocated_ = true;
+        allocate_occlusion_tiles();
     } else {
         std::cout << "WARNING (CUDA): It seems you forgot to call init() to "
                   << "initialize the constants before calling "
@@ -676,27 +2287,131 @@ cudaDeviceProp CudaEvaluator::get_device_properties() {
 }
 
 
+void CudaEvaluator::set_occlusion_storage(OcclusionStorage storage) {
+    if (storage == occlusion_storage_) return;
+
+    // the stored probabilities cannot be reinterpreted, they are dropped like
+    // on a reallocation
+    cudaStreamSynchronize(compute_stream_);
+    cudaFree(d_occlusion_probs_);
+    cudaFree(d_occlusion_probs_copy_);
+    d_occlusion_probs_ = NULL;
+    d_occlusion_probs_copy_ = NULL;
+    occlusion_probs_size_ = 0;
+    occlusion_storage_ = storage;
+    if (memory_allocated_) reset_occlusion_probabilities();
+}
+
+size_t CudaEvaluator::occlusion_element_size() const {
+    switch (occlusion_storage_) {
+        case OcclusionStorage::float16: return sizeof(__half);
+        case OcclusionStorage::uint8: return sizeof(unsigned char);
+        default: return sizeof(float);
+    }
+}
+
+
 void CudaEvaluator::get_memory_need_parameters(int nr_rows, int nr_cols,
                                 int& constant_need, int& per_pose_need) {
-    constant_need = nr_rows * nr_cols * sizeof(float);
-    per_pose_need = (3 + 2 * nr_rows * nr_cols) * sizeof(float);
+    static_assert(sizeof(PixelRegion) == 4 * sizeof(int),
+                  "the memory planner counts a PixelRegion as four ints");
+
+    std::uint64_t constant, per_pose;
+    dbot::MemoryPlanner::evaluator_need(nr_rows, nr_cols, occlusion_element_size(), constant, per_pose);
+    constant_need = constant;
+    per_pose_need = per_pose;
+}
+
+void CudaEvaluator::reserve_readback(const int count) {
+    if (count <= readback_capacity_) return;
+
+    // freeing the staging memory waits for the copies out of it. It is sized
+    // for the allocated resolution, which any later one fits.
+    allocate(d_readback_, sizeof(float) * count * observations_size_);
+    allocate(d_readback_indices_, sizeof(int) * count);
+    readback_capacity_ = count;
+}
+
+
+
+void CudaEvaluator::copy_depth_images(const int* poses, const int count, float* h_images) {
+    if (!(memory_allocated_ && texture_array_mapped_)) {
+        std::cout << "WARNING (CUDA): It seems you forgot to allocate memory or map "
+                  << "the rendering before calling copy_depth_images." << std::endl;
+        return;
+    }
+    if (count == 0) return;
+
+    reserve_readback(count);
+    const int nr_pixels = nr_rows_ * nr_cols_;
+    cudaMemcpyAsync(d_readback_indices_, poses, sizeof(int) * count, cudaMemcpyHostToDevice, compute_stream_);
+
+    dim3 grid((nr_pixels + nr_threads_ - 1) / nr_threads_, count);
+    gather_depth_kernel <<< grid, nr_threads_, 0, compute_stream_ >>> (
+        parameters_, d_readback_indices_, d_readback_, nr_rows_, nr_cols_, grid_dimension_.x, grid_dimension_.y);
+    cudaMemcpyAsync(h_images, d_readback_, sizeof(float) * count * nr_pixels, cudaMemcpyDeviceToHost, compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("copy_depth_images");
+    #endif
+}
+
+
+
+void CudaEvaluator::copy_occlusion_probabilities(const int* slots, const int count, float* h_probabilities) {
+    if (!memory_allocated_) {
+        std::cout << "WARNING (CUDA): It seems you forgot to call "
+                  << "allocate_memory_for_max_poses before calling "
+                  << "copy_occlusion_probabilities." << std::endl;
+        return;
+    }
+    if (count == 0) return;
+
+    reserve_readback(count);
+    resolve_occlusion_tiles();
+    const int nr_pixels = nr_rows_ * nr_cols_;
+    cudaMemcpyAsync(d_readback_indices_, slots, sizeof(int) * count, cudaMemcpyHostToDevice, compute_stream_);
+
+    dim3 grid((nr_pixels + nr_threads_ - 1) / nr_threads_, count);
+    DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+        (expand_occlusions_kernel<OcclusionType> <<< grid, nr_threads_, 0, compute_stream_ >>> (
+            (const OcclusionType*) d_occlusion_probs_, d_readback_indices_, d_readback_, occlusion_region_,
+            outside_occlusion_prob_, nr_rows_, nr_cols_)));
+    cudaMemcpyAsync(h_probabilities, d_readback_, sizeof(float) * count * nr_pixels, cudaMemcpyDeviceToHost,
+                    compute_stream_);
+    #ifdef DEBUG
+        check_cuda_error("copy_occlusion_probabilities");
+    #endif
 }
 
+
+
 vector<float> CudaEvaluator::get_occlusion_probabilities(int state_id) {
     if (memory_allocated_) {
-        float* occlusion_probabilities = (float*) malloc(nr_rows_ * nr_cols_ * sizeof(float));
-        int offset = state_id * nr_rows_ * nr_cols_;
-        cudaMemcpy(occlusion_probabilities, d_occlusion_probs_ + offset, nr_rows_ * nr_cols_ * sizeof(float), cudaMemcpyDeviceToHost);
-
-        #ifdef DEBUG
-            check_cuda_error("cudaMemcpy d_occlusion_probabilities -> occlusion_probabilities");
-        #endif
+        resolve_occlusion_tiles();
+        int area = occlusion_region_.rows * occlusion_region_.cols;
+        if (area > 0) {
+            int offset = state_id * area;
+            int nr_blocks = min((area + nr_threads_ - 1) / nr_threads_, cuda_device_properties_.maxGridSize[0]);
+            DISPATCH_OCCLUSION_STORAGE(occlusion_storage_,
+                (decode_occlusions_kernel<OcclusionType> <<< nr_blocks, nr_threads_, 0, compute_stream_ >>> (
+                    (OcclusionType*) d_occlusion_probs_ + offset, d_occlusion_staging_, area)));
+            cudaMemcpyAsync(&h_occlusion_staging_[0], d_occlusion_staging_, area * sizeof(float),
+                            cudaMemcpyDeviceToHost, compute_stream_);
+            cudaStreamSynchronize(compute_stream_);
+
+            #ifdef DEBUG
+                check_cuda_error("cudaMemcpy d_occlusion_probabilities -> occlusion_probabilities");
+            #endif
+        }
 
-        vector<float> occlusion_probabilities_vector;
-        for (int i = 0; i < nr_rows_ * nr_cols_; i++) {
-            occlusion_probabilities_vector.push_back(occlusion_probabilities[i]);
+        // expand the region of interest to the full image
+        vector<float> occlusion_probabilities_vector(nr_rows_ * nr_cols_, outside_occlusion_prob_);
+        for (int row = 0; row < occlusion_region_.rows; row++) {
+            for (int col = 0; col < occlusion_region_.cols; col++) {
+                occlusion_probabilities_vector[(row + occlusion_region_.row) * nr_cols_ + col + occlusion_region_.col] =
+                    h_occlusion_staging_[row * occlusion_region_.cols + col];
+            }
         }
-        free(occlusion_probabilities);
         return occlusion_probabilities_vector;
     } else {
         std::cout << "WARNING (CUDA): It seems you forgot to call "
@@ -717,6 +2432,17 @@ vector<float> CudaEvaluator::get_occlusion_probabilities(int state_id) {
 
 
 
+float CudaEvaluator::propagate_occlusion(float initial_p_source, float time) const {
+    if (isnan(time)) {
+        return initial_p_source;
+    }
+    float pow_c_time = exp(time * parameters_.log_c);
+    return 1 - (pow_c_time * (1 - initial_p_source) + (1. - parameters_.p_occluded_occluded)
+                * (pow_c_time - 1.) * parameters_.one_div_c_minus_one);
+}
+
+
+
 template <typename T> void CudaEvaluator::allocate(T * &pointer, size_t size) {
     cudaFree(pointer);
     cudaMalloc((void **) &pointer, size);
@@ -727,6 +2453,37 @@ template <typename T> void CudaEvaluator::allocate(T * &pointer, size_t size) {
 
 
 
+int CudaEvaluator::weight_threads() const {
+    return min(int(MAX_WEIGHT_THREADS), cuda_device_properties_.maxThreadsDim[0]);
+}
+
+
+
+void CudaEvaluator::allocate_pipeline_buffers() {
+    free_pipeline_buffers();
+
+    for (int i = 0; i < 2; i++) {
+        cudaHostAlloc((void **) &h_observation_buffers_[i], observations_size_ * sizeof(float), cudaHostAllocDefault);
+        allocate(d_observation_buffers_[i], observations_size_ * sizeof(float));
+    }
+    #ifdef DEBUG
+        check_cuda_error("allocate_pipeline_buffers");
+    #endif
+}
+
+
+
+void CudaEvaluator::free_pipeline_buffers() {
+    for (int i = 0; i < 2; i++) {
+        cudaFreeHost(h_observation_buffers_[i]);
+        cudaFree(d_observation_buffers_[i]);
+        h_observation_buffers_[i] = NULL;
+        d_observation_buffers_[i] = NULL;
+    }
+}
+
+
+
 void CudaEvaluator::check_cuda_error(const char *msg)
 {
     cudaError_t err = cudaGetLastError();
@@ -745,11 +2502,44 @@ void CudaEvaluator::check_cuda_error(const char *msg)
 
 
 CudaEvaluator::~CudaEvaluator() {
+    free_pipeline_buffers();
+    clear_likelihood_table();
+    unmap_texture();
+    if (pipelining_) {
+        cudaStreamDestroy(upload_stream_);
+        cudaEventDestroy(upload_events_[0]);
+        cudaEventDestroy(upload_events_[1]);
+    }
+    cudaStreamDestroy(compute_stream_);
     cudaFree(d_occlusion_probs_);
     cudaFree(d_occlusion_probs_copy_);
     cudaFree(d_observations_);
     cudaFree(d_log_likelihoods_);
+    cudaFree(d_valid_pixels_);
+    cudaFree(d_valid_depths_);
+    cudaFree(d_valid_row_offsets_);
+    cudaFree(d_valid_mask_);
     cudaFree(d_occlusion_indices_);
-    cudaDeviceReset();
+    cudaFree(d_occlusion_indices_copy_);
+    cudaFree(d_log_weights_);
+    cudaFree(d_previous_log_likelihoods_);
+    cudaFree(d_previous_log_likelihoods_copy_);
+    cudaFree(d_cumulative_weights_);
+    cudaFree(d_parents_);
+    cudaFree(d_work_regions_);
+    cudaFree(d_work_offsets_);
+    cudaFree(d_work_counter_);
+    cudaFree(d_tile_rows_);
+    cudaFree(d_tile_rows_copy_);
+    cudaFree(d_tile_states_);
+    cudaFree(d_readback_);
+    cudaFree(d_readback_indices_);
+    cudaFree(d_occlusion_staging_);
+    cudaFree(d_occlusion_slots_);
+    cudaFree(d_kl_divergence_);
+    cudaFreeHost(h_kl_divergence_);
+    cudaFree(d_moment_coefficients_);
+    cudaFree(d_moment_sums_);
+    // no device reset, other evaluators may still use the device
 }
 
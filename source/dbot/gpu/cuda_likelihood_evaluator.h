@@ -30,6 +30,9 @@
 #pragma once
 
 #include <curand_kernel.h>
+#include <dbot/gpu/cuda_rasterizer.h>
+#include <dbot/gpu/occlusion_tile_map.h>
+#include <dbot/gpu/pixel_likelihood_table.h>
 #include <vector>
 
 /**
@@ -46,6 +49,18 @@
  * allocate_memory_for_max_poses -> set_occlusion_probabilities
  *                               -> get_occlusion_probabilities
  *
+ * The occlusion probabilities are only stored within a region of interest,
+ * see set_occlusion_region(). All other pixels have never been observed and
+ * share a single probability.
+ *
+ * In pipelining mode (enable_pipelining()) the next observation image can be
+ * uploaded through pinned staging memory on a separate stream while the
+ * current frame is evaluated, see begin_observation_upload().
+ *
+ * The model parameters and textures are held per instance, see
+ * KernelParameters, and all work is issued on the compute stream of the
+ * instance. Several evaluators, e.g. of different trackers, can share a GPU.
+ *
  * Make sure to
  *  always render the poses first with opengl, then map the texture into CUDA,
  *  update the observation image with set_observations() and update the
@@ -54,6 +69,94 @@
  */
 class CudaEvaluator
 {
+public:
+    /**
+     * \brief Rectangle of pixels [row, row + rows) x [col, col + cols)
+     */
+    struct PixelRegion
+    {
+        int row, col, rows, cols;
+    };
+
+    /**
+     * \brief Constants of the pixel and occlusion model and the textures,
+     *        which are passed to the kernels by value. Every evaluator owns
+     *        its own copy, hence evaluators with different parameters can run
+     *        concurrently on their compute streams.
+     */
+    struct KernelParameters
+    {
+        // occlusion process
+        float p_occluded_occluded;
+        float one_div_c_minus_one;
+        float log_c;
+
+        // pixel model
+        float one_minus_tail_weight;
+        float model_sigma;
+        float sigma_factor;
+        float tail_weight_div_max_depth;
+        float exponential_rate;
+        float one_div_sqrt_of_two;
+        float one_div_sqrt_of_two_pi;
+
+        // rendered depth of all poses, see map_texture_to_texture_array()
+        // and map_depth_buffer()
+        cudaTextureObject_t depth_texture;
+
+        // tabulated pixel likelihoods (visible, occluded, no intersection,
+        // unused) over the difference prediction - observation along x and
+        // the observation along y, see PixelLikelihoodTable
+        cudaTextureObject_t likelihood_table;
+        float table_observation_scale;
+        float table_difference_scale;
+        float table_max_observation;
+        float table_max_difference;
+
+        // valid pixels of the active observation, see set_observations():
+        // their image indices and depths in row major order, the position of
+        // the first valid pixel of every row and a bit per image pixel
+        const int* valid_pixels;
+        const float* valid_depths;
+        const int* valid_row_offsets;
+        const unsigned int* valid_mask;
+    };
+
+    /** \brief Tiles of the incremental occlusion update, see
+     *         set_incremental_occlusions() */
+    typedef dbot::OcclusionTileMap::State OcclusionTileState;
+    typedef dbot::OcclusionTileMap::View OcclusionTiles;
+
+    /**
+     * \brief Body/tail pixel model of the Gaussian tracker, see
+     *        dbot::SigmaPointMoments
+     */
+    struct MomentParameters
+    {
+        float bg_depth;
+        float fg_variance;
+        float bg_variance;
+        float tail_weight;
+        float tail_mean;
+        float tail_variance;
+    };
+
+    /**
+     * \brief Element type of the stored occlusion probabilities. The two
+     *        occlusion buffers hold one element per pixel of the occlusion
+     *        region for every pose and bound the number of poses which fit
+     *        into global memory.
+     */
+    enum class OcclusionStorage
+    {
+        /** full precision */
+        float32,
+        /** half precision, half of the memory */
+        float16,
+        /** fixed point with a resolution of 1 / 255, a quarter of the memory */
+        uint8
+    };
+
 public:
     /**
      * \brief Constructor which takes the resolution of the camera image
@@ -62,8 +165,11 @@ public:
      *     The number of rows in each camera image
      * \param [in] nr_cols
      *     The number of columns in each camera image
+     * \param [in] device
+     *     The CUDA device to run on, negative to choose one with compute
+     *     capability 2.0. It has to be the GPU the OpenGL context renders on.
      */
-    CudaEvaluator(const int nr_rows, const int nr_cols);
+    CudaEvaluator(const int nr_rows, const int nr_cols, const int device = -1);
 
     /**
      * \brief Destructor which frees the memory used on the GPU
@@ -120,6 +226,89 @@ public:
     void weigh_poses(const bool update_occlusions,
                      std::vector<float>& log_likelihoods);
 
+    /**
+     * \brief Same as weigh_poses() but leaves the log likelihoods in the
+     *        device buffer device_log_likelihoods() for kernels which are
+     *        launched later on compute_stream(). Does not block.
+     *
+     * \return false if one of the required setters was not called
+     */
+    bool weigh_poses_on_device(const bool update_occlusions);
+
+    /**
+     * \brief Device buffer holding one log likelihood per pose after
+     *        weigh_poses_on_device()
+     */
+    float* device_log_likelihoods();
+
+    /**
+     * \brief Sets nr_poses uniform weights on the device. All poses start
+     *        from the occlusions at index 0 and previous log likelihoods of
+     *        zero, as after RaoBlackwellCoordinateParticleFilter::
+     *        set_particles().
+     */
+    void reset_weights(const int nr_poses);
+
+    /**
+     * \brief Adds the difference between the log likelihoods of the last
+     *        weigh_poses_on_device() call and the previous ones to the device
+     *        log weights and normalizes them.
+     *
+     * \return the KL divergence of the weights from the uniform
+     *         distribution, the only value copied back to the host
+     */
+    float update_weights();
+
+    /**
+     * \brief Systematic resampling of the device weights. The occlusion
+     *        indices and the previous log likelihoods follow the parents on
+     *        the device, the weights become uniform.
+     *
+     * \param [in] offset uniform random offset in [0, 1)
+     * \param [out] parents the parent of every new pose, needed by the host
+     *        to gather the states. Has to hold one int per weight.
+     */
+    void resample_weights(const float offset, int* parents);
+
+    /**
+     * \brief Copies the normalized log weights to the host
+     */
+    void get_log_weights(float* log_weights);
+
+    /**
+     * \brief Replaces the device weights by nr_poses normalized log weights,
+     *        e.g. those of a checkpoint. The occlusion indices and previous
+     *        log likelihoods are reset as by reset_weights().
+     */
+    void set_log_weights(const float* log_weights, const int nr_poses);
+
+    /**
+     * \brief Copies the occlusion index of every weight to the host
+     */
+    void get_occlusion_indices(int* occlusion_indices);
+
+    /**
+     * \brief Linearizes every pixel over the rendered sigma points of a
+     *        Gaussian belief and sums the information matrix and vector of
+     *        all pixels, see dbot::SigmaPointMoments::accumulate(). The
+     *        poses of the last set_number_of_poses() call are the sigma
+     *        points, the observations and the texture have to be set as for
+     *        weigh_poses(). Only the sums of the blocks are copied back, they
+     *        are added up on the host.
+     *
+     * \param [in] model the pixel model
+     * \param [in] coefficients see dbot::SigmaPointMoments::coefficients()
+     * \param [in] dimension of the state, at most MAX_MOMENT_DIMENSION
+     * \param [out] sums the upper triangle of the information matrix row by
+     *        row followed by the information vector
+     */
+    void reduce_sigma_point_moments(const MomentParameters& model,
+                                    const float* coefficients,
+                                    const int dimension,
+                                    std::vector<double>& sums);
+
+    static const int MAX_MOMENT_DIMENSION = 12;
+
     // setters
 
     /**
@@ -136,6 +325,11 @@ public:
      * \brief Copies the observation image from the camera to the GPU for
      * comparison
      *
+     * The NaN pixels carry no information. Once per observation, the valid
+     * pixels are compacted on the GPU and the evaluation iterates over these
+     * instead of testing every pixel of the evaluation region for every
+     * pose.
+     *
      * \param [in] observations a pointer to the observation values
      * \param [in] observation_time the time at which this observation was
      * captured
@@ -143,6 +337,45 @@ public:
     void set_observations(const float* observations,
                           const float observation_time);
 
+    /**
+     * \brief Switches to asynchronous observation uploads. Creates the
+     *        upload and compute streams, two pinned host staging buffers and
+     *        two device observation buffers. Has to be called after
+     *        allocate_memory_for_max_poses().
+     */
+    void enable_pipelining();
+
+    /**
+     * \brief Returns the pinned staging buffer the next observation image
+     *        has to be written to. Blocks until the previous upload from this
+     *        buffer has finished. May be called while poses are weighed on
+     *        another thread.
+     */
+    float* begin_observation_upload();
+
+    /**
+     * \brief Issues the asynchronous upload of the staging buffer written
+     *        since begin_observation_upload() and returns immediately
+     */
+    void end_observation_upload();
+
+    /**
+     * \brief Makes the most recently uploaded observation the one compared
+     *        against by weigh_poses(). The compute stream waits for the
+     *        upload on the GPU, the host does not block.
+     *
+     * \param [in] observation_time the time at which this observation was
+     * captured
+     */
+    void activate_observation(const float observation_time);
+
+    /**
+     * \brief The non blocking stream all work of this evaluator runs on.
+     *        The rendering results have to be mapped on it, which orders the
+     *        OpenGL commands before the kernels without a glFinish().
+     */
+    cudaStream_t compute_stream() const;
+
     /**
      * \brief Sets the indices to the occlusion array for every state
      *
@@ -156,8 +389,11 @@ public:
 
     /**
      * \brief Sets the resolution for the images to be compared
-     * Be sure to call allocate_memory_for_max_poses afterwards to reallocate
-     * the buffers according to the new resolution.
+     * A resolution with no more pixels than the allocated one only changes
+     * the tiling and the launch parameters, the stored occlusions are reset
+     * since they belong to the pixels of the old resolution. For more pixels
+     * call allocate_memory_for_max_poses afterwards to reallocate the
+     * buffers according to the new resolution.
      * \param [in] n_rows the number of rows in an image
      * \param [in] n_cols the number of columns in an image
      */
@@ -173,6 +409,121 @@ public:
     void set_occlusion_probabilities(const float* occlusion_probabilities,
                                      const int array_size);
 
+    /**
+     * \brief Overwrites the occlusion probabilities of one slot with those
+     *        of a full image, as returned by get_occlusion_probabilities().
+     *        Only the pixels in the region of interest are stored, the slot
+     *        is kept by later changes of the region.
+     */
+    void set_occlusion_probabilities(const int slot,
+                                     const float* occlusion_probabilities);
+
+    /**
+     * \brief Same as set_occlusion_probabilities() of a slot for count slots
+     *        in one copy and one kernel, the full images of the slots are
+     *        given back to back
+     */
+    void set_occlusion_probabilities(const int* slots,
+                                     const int count,
+                                     const float* occlusion_probabilities);
+
+    /**
+     * \brief Resets the occlusion probabilities of all states to the initial
+     *        value and empties the region of interest. Nothing is copied.
+     */
+    void reset_occlusion_probabilities();
+
+    /**
+     * \brief Time of the last occlusion update, all stored probabilities
+     *        are propagated from it
+     */
+    float occlusion_time() const { return occlusion_time_; }
+
+    /**
+     * \brief Occlusion probability of the pixels outside of the region of
+     *        interest at occlusion_time()
+     */
+    float outside_occlusion_probability() const
+    {
+        return outside_occlusion_prob_;
+    }
+
+    /**
+     * \brief Restores the update time and the probability of the pixels
+     *        outside of the region of interest, e.g. from a checkpoint
+     */
+    void set_occlusion_time(const float occlusion_time,
+                            const float outside_occlusion_probability);
+
+    /**
+     * \brief Sets the region for which occlusion probabilities are stored.
+     *
+     * The stored probabilities are moved to the new region on the GPU.
+     * Pixels which leave the region are forgotten, pixels which enter it
+     * start from the probability shared by all unobserved pixels. The
+     * buffers grow with the region and are never shrunk.
+     *
+     * \param [in] region the new region, clipped to the image
+     */
+    void set_occlusion_region(const PixelRegion& region);
+
+    /**
+     * \brief Sets the region of the image which is covered by the rendered
+     *        poses of the next weigh_poses() call. Pixels outside of it are
+     *        skipped. Defaults to the full image.
+     *
+     * \param [in] region the region, clipped to the image
+     */
+    void set_evaluation_region(const PixelRegion& region);
+
+    /**
+     * \brief Sets the region each pose of the next weigh_poses() call can
+     *        cover, one per pose. Only needed for the persistent evaluation.
+     */
+    void set_pose_regions(const PixelRegion* regions, int nr_poses);
+
+    /**
+     * \brief Evaluates the poses with a fixed number of resident warps which
+     *        pull tiles of the pose regions from a queue, instead of with one
+     *        block per pose which visits the whole evaluation region. Poses
+     *        covering few pixels then cost little. Requires the pose
+     *        regions of set_pose_regions() and a depth texture, a mapped
+     *        geometry is still evaluated by one block per pose.
+     */
+    void set_persistent_evaluation(bool persistent);
+
+    bool persistent_evaluation() const { return persistent_evaluation_; }
+
+    /**
+     * \brief Updates the occlusions incrementally. An update then only
+     *        writes the tiles of the occlusion region which intersect the
+     *        evaluation region, into the buffer their old probabilities are
+     *        not in. Every other tile of a pose keeps referring to the tile
+     *        of its parent, and its propagation in time is deferred until it
+     *        is written again. The references are resolved before the
+     *        occlusions are relaid out, read or set. The update goes through
+     *        one block per pose, also with the persistent evaluation.
+     */
+    void set_incremental_occlusions(bool incremental);
+
+    bool incremental_occlusions() const { return incremental_occlusions_; }
+
+    /**
+     * \brief Evaluates the pixel likelihoods through the given table from
+     *        now on. Pixels outside of its range are still evaluated
+     *        analytically. The table has to be built for the parameters
+     *        passed to init(), its error is bounded by
+     *        PixelLikelihoodTable::max_relative_error().
+     */
+    void set_likelihood_table(const dbot::PixelLikelihoodTable& table);
+
+    /**
+     * \brief Returns to the analytic evaluation of the pixel likelihoods
+     */
+    void clear_likelihood_table();
+
+    bool has_likelihood_table() const { return d_likelihood_table_ != NULL; }
+
     /**
      * \brief Maps the texture array to an actual texture reference
      *
@@ -180,6 +531,47 @@ public:
      */
     void map_texture_to_texture_array(const cudaArray_t texture_array);
 
+    /**
+     * \brief Reads the rendered depth from device memory instead of an
+     *        OpenGL texture, see CudaRasterizer. The buffer has the layout
+     *        of the OpenGL texture.
+     *
+     * \param [in] depth_buffer  pitched buffer of height rows of width floats
+     * \param [in] pitch  of the rows in bytes
+     */
+    void map_depth_buffer(const float* depth_buffer,
+                          size_t pitch,
+                          int width,
+                          int height);
+
+    /**
+     * \brief Renders the poses within the next weigh_poses() call instead of
+     *        reading a rendered depth. Every block rasterizes its pose into
+     *        the evaluation region in shared memory and weighs the pixels
+     *        right away, the depth is never stored in global memory.
+     *
+     * \return false if the evaluation region does not fit into shared
+     *         memory, nothing is mapped then
+     */
+    bool map_geometry(const CudaRasterizer::Geometry& geometry);
+
+    /**
+     * \brief Releases the texture object of the mapped array or buffer. Has
+     *        to be called before the OpenGL resource is unregistered or the
+     *        buffer is reallocated.
+     */
+    void unmap_texture();
+
+    /**
+     * \brief Sets the element type of the occlusion probabilities. The
+     *        stored probabilities are reset. The memory need per pose changes,
+     *        see get_memory_need_parameters(), hence the memory should be
+     *        allocated again afterwards.
+     */
+    void set_occlusion_storage(OcclusionStorage storage);
+
+    OcclusionStorage occlusion_storage() const { return occlusion_storage_; }
+
     /**
      * \brief Allocates the maximum amount of memory that will ever be needed by
      * CUDA
@@ -205,6 +597,11 @@ public:
     void set_number_of_poses(int nr_poses);
 
     // getters
+    /** \brief Arrangement of the poses in the depth texture */
+    int max_nr_poses() const { return max_nr_poses_; }
+    int max_nr_poses_per_row() const { return max_nr_poses_per_row_; }
+    int max_nr_poses_per_column() const { return max_nr_poses_per_column_; }
+
     /**
      * \brief Gets the maximum number of threads that can be handled with this
      * GPU
@@ -261,24 +658,125 @@ public:
      */
     std::vector<float> get_occlusion_probabilities(int state_id);
 
+    /**
+     * \brief Issues asynchronous copies of the rendered depth images of the
+     *        given poses into pinned host memory, count row major images of
+     *        the full resolution with 0 as the background. The copy is
+     *        ordered on the compute stream, an event recorded on it after
+     *        the call marks its completion. Requires a mapped rendering.
+     */
+    void copy_depth_images(const int* poses, int count, float* h_images);
+
+    /**
+     * \brief Same as copy_depth_images() for the occlusion probabilities of
+     *        the given slots, as get_occlusion_probabilities() returns them
+     */
+    void copy_occlusion_probabilities(const int* slots,
+                                      int count,
+                                      float* h_probabilities);
+
 private:
     static const int DEFAULT_NR_THREADS = 128;
 
     // device pointers to arrays stored in global memory on the GPU
-    float* d_occlusion_probs_;
-    float* d_occlusion_probs_copy_;
+    // stored as occlusion_storage_, see OcclusionStorage
+    void* d_occlusion_probs_;
+    void* d_occlusion_probs_copy_;
     float* d_observations_;
     float* d_log_likelihoods_;
+
+    // valid pixels of the active observation, see KernelParameters
+    int* d_valid_pixels_;
+    float* d_valid_depths_;
+    int* d_valid_row_offsets_;
+    unsigned int* d_valid_mask_;
+
     int* d_occlusion_indices_;  // this contains, for each pose, the index into
                                 // the occlusion probabilities array, which
                                 // contains the occlusion probabilities for that
                                 // particular pose.
 
     int occlusion_probs_size_;
+    OcclusionStorage occlusion_storage_;
     int observations_size_;
 
-    // for OpenGL interop
+    // particle weights which stay on the device between the sampling blocks
+    int* d_occlusion_indices_copy_;
+    float* d_log_weights_;
+    float* d_previous_log_likelihoods_;
+    float* d_previous_log_likelihoods_copy_;
+    float* d_cumulative_weights_;
+    int* d_parents_;
+    float* d_kl_divergence_;
+    float* h_kl_divergence_;
+    int weight_count_;
+
+    // coefficients and per block sums of reduce_sigma_point_moments()
+    float* d_moment_coefficients_;
+    float* d_moment_sums_;
+    std::vector<float> moment_sums_;
+
+    // the occlusion probabilities are stored for the pixels within
+    // occlusion_region_ for the first occlusion_slot_count_ states, all other
+    // pixels share outside_occlusion_prob_
+    PixelRegion occlusion_region_;
+    PixelRegion evaluation_region_;
+    int occlusion_slot_count_;
+    float outside_occlusion_prob_;
+
+    // for OpenGL interop, or the buffer of the CUDA rasterizer
     cudaArray_t d_texture_array_;
+    const float* d_depth_buffer_;
+
+    // persistent evaluation: the regions of the poses and for every pose its
+    // work region, its covered pixels and the offset of its first tile
+    bool persistent_evaluation_;
+    std::vector<PixelRegion> pose_regions_;
+    std::vector<PixelRegion> h_work_regions_;
+    std::vector<int> h_work_offsets_;
+    PixelRegion* d_work_regions_;
+    int* d_work_offsets_;
+    int* d_work_counter_;
+
+    // incremental occlusion update: the tiles on the host, and the rows of
+    // the tiles of every slot, their next rows and the states of the tiles
+    // on the device
+    bool incremental_occlusions_;
+    dbot::OcclusionTileMap occlusion_tile_map_;
+    int* d_tile_rows_;
+    int* d_tile_rows_copy_;
+    OcclusionTileState* d_tile_states_;
+
+    // device staging memory of the asynchronous copies to the host
+    float* d_readback_;
+    int* d_readback_indices_;
+    int readback_capacity_;
+
+    // float occlusion probabilities on both sides of their conversion from
+    // and into the storage type and the slots they are stored in. One image
+    // is allocated with the buffers, more are kept once a batch needs them.
+    float* d_occlusion_staging_;
+    std::vector<float> h_occlusion_staging_;
+    int occlusion_staging_capacity_;
+    int* d_occlusion_slots_;
+
+    // poses rendered by the next weighing, see map_geometry()
+    CudaRasterizer::Geometry geometry_;
+    bool geometry_mapped_;
+
+    // tabulated pixel likelihoods, NULL for the analytic evaluation
+    cudaArray_t d_likelihood_table_;
+
+    // pipelining: double buffered observations which are uploaded from
+    // pinned memory on upload_stream_ while compute_stream_ evaluates
+    bool pipelining_;
+    cudaStream_t upload_stream_;
+    cudaStream_t compute_stream_;
+    float* h_observation_buffers_[2];
+    float* d_observation_buffers_[2];
+    cudaEvent_t upload_events_[2];
+    int upload_slot_;
+    float* d_active_observations_;
 
     // resolution
     int nr_cols_;
@@ -299,6 +797,9 @@ private:
     // occlusion probability default value
     float occlusion_prob_default_;
 
+    // model constants and textures of the kernels
+    KernelParameters parameters_;
+
     // time values to compute the time deltas when calling the weighting
     // function
     float occlusion_time_;
@@ -315,4 +816,25 @@ private:
     template <typename T>
     void allocate(T*& pointer, size_t size);
     void check_cuda_error(const char* msg);
+    void allocate_pipeline_buffers();
+    void free_pipeline_buffers();
+    void compact_observations();
+    void reserve_readback(int count);
+    OcclusionTiles occlusion_tiles();
+    void advance_occlusion_tiles(const OcclusionTiles& tiles,
+                                 float delta_time);
+    void resolve_occlusion_tiles();
+    void allocate_occlusion_tiles();
+    void reset_occlusion_tiles();
+    void identity_tile_rows();
+    void free_occlusion_tiles();
+    void weigh_persistently(bool update_occlusions,
+                            float outside_occlusion_prob,
+                            float delta_time,
+                            const OcclusionTiles& tiles);
+    int weight_threads() const;
+    size_t occlusion_element_size() const;
+    static cudaTextureObject_t create_texture_object(
+        const cudaArray_t array, const cudaTextureDesc& texture_desc);
+    float propagate_occlusion(float initial_p_source, float time) const;
 };
@@ -0,0 +1,278 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file cuda_rasterizer.cu
+ */
+
+#include <dbot/gpu/cuda_rasterizer.h>
+#include <dbot/gpu/cuda_rasterizer_device.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#include <cuda.h>
+#include <math.h>
+
+using namespace std;
+
+namespace {
+
+// threads per block of the kernels
+const int NR_THREADS = 128;
+
+// far beyond any far plane, the depth buffer is cleared with these bytes
+const int CLEAR_BYTE = 0x7f;
+
+struct RasterParameters {
+    float far_plane;
+    int nr_rows, nr_cols;
+    int nr_poses_per_row;
+    int nr_tile_rows;  // of the current call, the tiles are stacked from the top
+    size_t pitch;  // in floats
+};
+
+// Row of the depth buffer which holds image row 0 of the tile row. The buffer has the layout of the
+// OpenGL texture, its row 0 is the bottom of the image.
+__device__ int top_row(const RasterParameters& p, int tile_row) {
+    return p.nr_tile_rows * p.nr_rows - 1 - tile_row * p.nr_rows;
+}
+
+
+// writes into the tile of one pose, image rows run downwards in the buffer
+struct TileWrite {
+    float* tile;
+    size_t pitch;
+    __device__ void operator()(int row, int col, float z) const { store_nearest(&tile[col - row * pitch], z); }
+};
+
+
+// One thread per triangle and pose, blockIdx.y is the pose
+__global__ void rasterize_kernel(RasterParameters p, CudaRasterizer::Geometry g, float* depth) {
+    const int pose = blockIdx.y;
+    TileWrite write;
+    write.tile = depth + top_row(p, pose / p.nr_poses_per_row) * p.pitch + (pose % p.nr_poses_per_row) * p.nr_cols;
+    write.pitch = p.pitch;
+
+    for (int t = blockIdx.x * blockDim.x + threadIdx.x; t < g.nr_triangles; t += blockDim.x * gridDim.x) {
+        rasterize_triangle(g, pose, t, 0, p.nr_rows - 1, 0, p.nr_cols - 1, write);
+    }
+}
+
+
+// pixels no triangle has been drawn into get the clear value of the OpenGL rendering
+__global__ void resolve_background_kernel(RasterParameters p, float* depth, const int width, const int height) {
+    const int col = blockIdx.x * blockDim.x + threadIdx.x;
+    const int row = blockIdx.y;
+    if (col >= width || row >= height) return;
+
+    float& value = depth[row * p.pitch + col];
+    if (value > p.far_plane) value = 0;
+}
+
+}
+
+
+CudaRasterizer::CudaRasterizer(const Mesh& mesh, const Camera& camera, const int nr_rows, const int nr_cols)
+    : camera_(camera),
+      nr_rows_(nr_rows),
+      nr_cols_(nr_cols),
+      d_positions_(NULL),
+      d_indices_(NULL),
+      level_triangle_begin_(mesh.triangle_begin),
+      level_triangle_count_(mesh.triangle_count),
+      nr_objects_(mesh.triangle_begin.empty() ? 0 : mesh.triangle_begin[0].size()),
+      max_nr_poses_(0),
+      max_nr_poses_per_row_(0),
+      max_nr_poses_per_column_(0),
+      buffer_nr_rows_(nr_rows),
+      buffer_nr_cols_(nr_cols),
+      d_depth_buffer_(NULL),
+      depth_pitch_(0),
+      pose_slot_(0),
+      d_poses_(NULL) {
+
+    cudaMalloc((void**) &d_positions_, mesh.positions.size() * sizeof(float));
+    cudaMalloc((void**) &d_indices_, mesh.indices.size() * sizeof(uint32_t));
+    cudaMemcpy(d_positions_, mesh.positions.data(), mesh.positions.size() * sizeof(float),
+               cudaMemcpyHostToDevice);
+    cudaMemcpy(d_indices_, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t),
+               cudaMemcpyHostToDevice);
+    check_cuda_error("uploading the mesh");
+
+    for (int i = 0; i < NR_POSE_BUFFERS; i++) {
+        h_poses_[i] = NULL;
+        cudaEventCreateWithFlags(&pose_events_[i], cudaEventDisableTiming);
+    }
+
+    set_levels(std::vector<int>(nr_objects_, 0));
+}
+
+
+CudaRasterizer::~CudaRasterizer() {
+    free_buffers();
+    for (int i = 0; i < NR_POSE_BUFFERS; i++) cudaEventDestroy(pose_events_[i]);
+    cudaFree(d_positions_);
+    cudaFree(d_indices_);
+}
+
+
+void CudaRasterizer::allocate_for_max_poses(int nr_poses, int nr_poses_per_row, int nr_poses_per_col) {
+    free_buffers();
+
+    max_nr_poses_ = nr_poses;
+    max_nr_poses_per_row_ = nr_poses_per_row;
+    max_nr_poses_per_column_ = nr_poses_per_col;
+    buffer_nr_rows_ = nr_rows_;
+    buffer_nr_cols_ = nr_cols_;
+
+    cudaMallocPitch((void**) &d_depth_buffer_, &depth_pitch_, depth_width() * sizeof(float),
+                    depth_height());
+
+    // the model matrices of all poses followed by the ranges of the objects
+    const size_t size = (max_nr_poses_ * nr_objects_ * 16 + 2 * nr_objects_) * sizeof(float);
+    cudaMalloc((void**) &d_poses_, size);
+    for (int i = 0; i < NR_POSE_BUFFERS; i++) {
+        cudaHostAlloc((void**) &h_poses_[i], size, cudaHostAllocWriteCombined);
+    }
+    pose_slot_ = 0;
+
+    check_cuda_error("allocating the rasterizer buffers");
+}
+
+
+void CudaRasterizer::set_resolution(const int nr_rows, const int nr_cols, const Camera& camera) {
+    nr_rows_ = nr_rows;
+    nr_cols_ = nr_cols;
+    camera_ = camera;
+}
+
+
+float* CudaRasterizer::begin_pose_upload(const int nr_poses) {
+    if (nr_poses > max_nr_poses_) {
+        std::cout << "ERROR (CUDA): You tried to render more poses ("
+                  << nr_poses << ") than specified by max_poses ("
+                  << max_nr_poses_ << ")." << std::endl;
+        exit(-1);
+    }
+
+    // the copy of this buffer was issued two frames ago and has almost always finished
+    cudaEventSynchronize(pose_events_[pose_slot_]);
+    return h_poses_[pose_slot_];
+}
+
+
+void CudaRasterizer::set_levels(const std::vector<int>& levels) {
+    ranges_.resize(2 * nr_objects_);
+    for (int k = 0; k < nr_objects_; k++) {
+        const int level = k < levels.size() ? levels[k] : 0;
+        ranges_[2 * k] = level_triangle_begin_[level][k];
+        ranges_[2 * k + 1] = level_triangle_count_[level][k];
+    }
+}
+
+
+void CudaRasterizer::render_uploaded_poses(const int nr_poses, cudaStream_t stream) {
+    if (nr_poses == 0) return;
+
+    render(upload_poses(nr_poses, stream), nr_poses, stream);
+}
+
+
+CudaRasterizer::Geometry CudaRasterizer::upload_poses(const int nr_poses, cudaStream_t stream) {
+    // the ranges are copied along with the poses, the pinned buffer is not written until the event
+    float* h_poses = h_poses_[pose_slot_];
+    const size_t pose_floats = max_nr_poses_ * nr_objects_ * 16;
+    memcpy(h_poses + pose_floats, ranges_.data(), ranges_.size() * sizeof(int));
+    cudaMemcpyAsync(d_poses_, h_poses, nr_poses * nr_objects_ * 16 * sizeof(float),
+                    cudaMemcpyHostToDevice, stream);
+    cudaMemcpyAsync(d_poses_ + pose_floats, h_poses + pose_floats, ranges_.size() * sizeof(int),
+                    cudaMemcpyHostToDevice, stream);
+    cudaEventRecord(pose_events_[pose_slot_], stream);
+    pose_slot_ = (pose_slot_ + 1) % NR_POSE_BUFFERS;
+
+    Geometry geometry;
+    geometry.positions = d_positions_;
+    geometry.indices = d_indices_;
+    geometry.poses = d_poses_;
+    geometry.ranges = (const int*) (d_poses_ + pose_floats);
+    geometry.nr_objects = nr_objects_;
+    geometry.nr_triangles = 0;
+    for (int k = 0; k < nr_objects_; k++) geometry.nr_triangles += ranges_[2 * k + 1];
+    geometry.camera = camera_;
+
+    return geometry;
+}
+
+
+void CudaRasterizer::render(const Geometry& geometry, const int nr_poses, cudaStream_t stream) {
+    if (nr_poses == 0) return;
+
+    if (nr_rows_ > buffer_nr_rows_ || nr_cols_ > buffer_nr_cols_) {
+        std::cout << "ERROR (CUDA): The resolution " << nr_rows_ << " x " << nr_cols_
+                  << " exceeds the one the depth buffer was allocated for ("
+                  << buffer_nr_rows_ << " x " << buffer_nr_cols_ << ")." << std::endl;
+        exit(-1);
+    }
+
+    RasterParameters p;
+    p.far_plane = camera_.far_plane;
+    p.nr_rows = nr_rows_;
+    p.nr_cols = nr_cols_;
+    p.nr_poses_per_row = min(max_nr_poses_per_row_, nr_poses);
+    p.nr_tile_rows = (nr_poses + p.nr_poses_per_row - 1) / p.nr_poses_per_row;
+    p.pitch = depth_pitch_ / sizeof(float);
+
+    // the tile layout of CudaEvaluator::set_number_of_poses()
+    const int width = p.nr_poses_per_row * nr_cols_;
+    const int height = p.nr_tile_rows * nr_rows_;
+    cudaMemset2DAsync(d_depth_buffer_, depth_pitch_, CLEAR_BYTE, width * sizeof(float), height, stream);
+
+    if (geometry.nr_triangles > 0) {
+        dim3 grid(min((geometry.nr_triangles + NR_THREADS - 1) / NR_THREADS, 1024), nr_poses);
+        rasterize_kernel<<<grid, NR_THREADS, 0, stream>>>(p, geometry, d_depth_buffer_);
+    }
+
+    dim3 background_grid((width + NR_THREADS - 1) / NR_THREADS, height);
+    resolve_background_kernel<<<background_grid, NR_THREADS, 0, stream>>>(p, d_depth_buffer_, width, height);
+
+#ifdef DEBUG
+    check_cuda_error("rasterizing the poses");
+#endif
+}
+
+
+void CudaRasterizer::free_buffers() {
+    // a pending copy may still read the pinned buffers
+    for (int i = 0; i < NR_POSE_BUFFERS; i++) {
+        cudaEventSynchronize(pose_events_[i]);
+        cudaFreeHost(h_poses_[i]);
+        h_poses_[i] = NULL;
+    }
+    cudaFree(d_poses_);
+    cudaFree(d_depth_buffer_);
+    d_poses_ = NULL;
+    d_depth_buffer_ = NULL;
+}
+
+
+void CudaRasterizer::check_cuda_error(const char *msg) {
+    cudaError_t err = cudaGetLastError();
+    if (cudaSuccess != err) {
+        fprintf(stderr, "CUDA error: %s: %s.\n", msg, cudaGetErrorString(err));
+        exit(EXIT_FAILURE);
+    }
+}
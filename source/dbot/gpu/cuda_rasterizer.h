@@ -0,0 +1,201 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file cuda_rasterizer.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <cuda_runtime.h>
+
+/**
+ * \brief Software rasterizer which renders the depth of all poses with CUDA
+ *        kernels, an alternative to ObjectRasterizer without OpenGL.
+ *
+ * The depth images are written into a pitched device buffer with the tile
+ * layout of the OpenGL texture, hence CudaEvaluator reads them through
+ * CudaEvaluator::map_depth_buffer() with the same kernels. Rendering and
+ * weighing are issued on one stream, there is no interop mapping and no
+ * synchronization between two APIs in between.
+ *
+ * One thread rasterizes one triangle in one pose, see
+ * cuda_rasterizer_device.h. The depth of a pixel is the camera z
+ * interpolated perspective correctly at its center and the nearest one is
+ * kept with an atomic minimum. Triangles with a vertex in
+ * front of the near plane are dropped instead of being clipped, which only
+ * matters for objects touching the camera.
+ */
+class CudaRasterizer
+{
+public:
+    /**
+     * \brief Triangles of all levels of detail of all objects
+     */
+    struct Mesh
+    {
+        /** xyz of the vertices of all levels */
+        std::vector<float> positions;
+
+        /** three vertex indices per triangle, global within positions */
+        std::vector<std::uint32_t> indices;
+
+        /** [level][object] first triangle and number of triangles */
+        std::vector<std::vector<int>> triangle_begin;
+        std::vector<std::vector<int>> triangle_count;
+    };
+
+    /**
+     * \brief Pinhole camera and the clipping planes of the rendering
+     */
+    struct Camera
+    {
+        float fx, fy, cx, cy;
+        float near_plane;
+        float far_plane;
+    };
+
+    /**
+     * \brief Device pointers to the mesh and to the uploaded poses, passed to
+     *        the kernels by value
+     */
+    struct Geometry
+    {
+        const float* positions;
+        const std::uint32_t* indices;
+
+        /** column major model matrices, pose after pose */
+        const float* poses;
+
+        /** first triangle and triangle count per object */
+        const int* ranges;
+
+        int nr_objects;
+        int nr_triangles;
+        Camera camera;
+    };
+
+public:
+    /**
+     * \brief Uploads the mesh, the objects are drawn with the first level
+     *        until set_levels() is called
+     */
+    CudaRasterizer(const Mesh& mesh,
+                   const Camera& camera,
+                   const int nr_rows,
+                   const int nr_cols);
+
+    ~CudaRasterizer();
+
+    /**
+     * \brief Allocates the depth buffer for the arrangement of the poses of
+     *        CudaEvaluator::allocate_memory_for_max_poses()
+     */
+    void allocate_for_max_poses(int nr_poses,
+                                int nr_poses_per_row,
+                                int nr_poses_per_col);
+
+    /**
+     * \brief Renders the following poses at the resolution with the camera,
+     *        e.g. a downsampled one. The depth buffer is not reallocated, a
+     *        resolution beyond the one of allocate_for_max_poses() needs
+     *        another call of it.
+     */
+    void set_resolution(const int nr_rows,
+                        const int nr_cols,
+                        const Camera& camera);
+
+    /**
+     * \brief Pinned buffer for the column major model matrices of all
+     *        objects in all poses, pose after pose. It stays valid until the
+     *        next render_uploaded_poses() call.
+     */
+    float* begin_pose_upload(const int nr_poses);
+
+    /**
+     * \brief Selects the level of detail per object
+     */
+    void set_levels(const std::vector<int>& levels);
+
+    /**
+     * \brief Uploads the poses and renders them on the stream
+     */
+    void render_uploaded_poses(const int nr_poses, cudaStream_t stream);
+
+    /**
+     * \brief Uploads the poses and the selected levels on the stream without
+     *        rendering them. The geometry stays valid until the second next
+     *        upload, e.g. for CudaEvaluator::map_geometry().
+     */
+    Geometry upload_poses(const int nr_poses, cudaStream_t stream);
+
+    /**
+     * \brief Renders uploaded poses into the depth buffer
+     */
+    void render(const Geometry& geometry,
+                const int nr_poses,
+                cudaStream_t stream);
+
+    const float* depth_buffer() const { return d_depth_buffer_; }
+    size_t depth_pitch() const { return depth_pitch_; }
+    int depth_width() const { return max_nr_poses_per_row_ * buffer_nr_cols_; }
+    int depth_height() const
+    {
+        return max_nr_poses_per_column_ * buffer_nr_rows_;
+    }
+
+private:
+    CudaRasterizer(const CudaRasterizer&);
+    CudaRasterizer& operator=(const CudaRasterizer&);
+
+    void free_buffers();
+    void check_cuda_error(const char* msg);
+
+private:
+    Camera camera_;
+    int nr_rows_;
+    int nr_cols_;
+
+    // mesh of all levels and the triangle ranges per level and object
+    float* d_positions_;
+    std::uint32_t* d_indices_;
+    std::vector<std::vector<int>> level_triangle_begin_;
+    std::vector<std::vector<int>> level_triangle_count_;
+    int nr_objects_;
+
+    // first triangle and triangle count of the selected level per object
+    std::vector<int> ranges_;
+
+    int max_nr_poses_;
+    int max_nr_poses_per_row_;
+    int max_nr_poses_per_column_;
+
+    // depth of all poses in the tile layout of the OpenGL texture, sized for
+    // the resolution of the allocation
+    int buffer_nr_rows_;
+    int buffer_nr_cols_;
+    float* d_depth_buffer_;
+    size_t depth_pitch_;
+
+    // model matrices of up to max_nr_poses_ poses followed by the
+    // ranges. The host buffers are cycled, such that a new upload does not
+    // overwrite the one still being copied.
+    static const int NR_POSE_BUFFERS = 2;
+    float* h_poses_[NR_POSE_BUFFERS];
+    cudaEvent_t pose_events_[NR_POSE_BUFFERS];
+    int pose_slot_;
+    float* d_poses_;
+};
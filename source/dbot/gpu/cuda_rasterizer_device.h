@@ -0,0 +1,121 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file cuda_rasterizer_device.h
+ *
+ * Device functions which rasterize the triangles of a
+ * CudaRasterizer::Geometry, shared by the kernels of CudaRasterizer and the
+ * fused evaluation of CudaEvaluator. Only to be included by .cu files.
+ */
+
+#pragma once
+
+#include <dbot/gpu/cuda_rasterizer.h>
+
+/**
+ * \brief Vertex indices of triangle t of all objects in the selected levels,
+ *        the object it belongs to is returned in object
+ */
+__device__ __forceinline__ const std::uint32_t* find_triangle(
+    const CudaRasterizer::Geometry& g, int t, int& object)
+{
+    object = 0;
+    while (t >= g.ranges[2 * object + 1])
+    {
+        t -= g.ranges[2 * object + 1];
+        object++;
+    }
+    return g.indices + 3 * (g.ranges[2 * object] + t);
+}
+
+/**
+ * \brief Rasterizes triangle t of the pose within the pixels
+ *        [row_begin, row_end] x [col_begin, col_end] of the image and calls
+ *        write(row, col, z) for every pixel center it covers with the camera
+ *        z at that center. Both windings are drawn, pixels beyond the far
+ *        plane are skipped and triangles with a vertex in front of the near
+ *        plane are dropped.
+ */
+template <typename Write>
+__device__ void rasterize_triangle(const CudaRasterizer::Geometry& g,
+                                   int pose,
+                                   int t,
+                                   int row_begin,
+                                   int row_end,
+                                   int col_begin,
+                                   int col_end,
+                                   const Write& write)
+{
+    int object;
+    const std::uint32_t* triangle = find_triangle(g, t, object);
+    const float* m = g.poses + (pose * g.nr_objects + object) * 16;
+
+    float u[3], v[3], inverse_z[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const float* x = g.positions + 3 * triangle[i];
+        const float camera_x = m[0] * x[0] + m[4] * x[1] + m[8] * x[2] + m[12];
+        const float camera_y = m[1] * x[0] + m[5] * x[1] + m[9] * x[2] + m[13];
+        const float camera_z =
+            m[2] * x[0] + m[6] * x[1] + m[10] * x[2] + m[14];
+        if (camera_z < g.camera.near_plane) return;
+
+        inverse_z[i] = 1.0f / camera_z;
+        u[i] = g.camera.fx * camera_x * inverse_z[i] + g.camera.cx;
+        v[i] = g.camera.fy * camera_y * inverse_z[i] + g.camera.cy;
+    }
+
+    const float area =
+        (u[1] - u[0]) * (v[2] - v[0]) - (u[2] - u[0]) * (v[1] - v[0]);
+    if (fabsf(area) < 1e-12f) return;
+    const float inverse_area = 1.0f / area;
+
+    // pixel centers are at integer coordinates
+    col_begin = max(col_begin, int(ceilf(fminf(u[0], fminf(u[1], u[2])))));
+    col_end = min(col_end, int(floorf(fmaxf(u[0], fmaxf(u[1], u[2])))));
+    row_begin = max(row_begin, int(ceilf(fminf(v[0], fminf(v[1], v[2])))));
+    row_end = min(row_end, int(floorf(fmaxf(v[0], fmaxf(v[1], v[2])))));
+
+    for (int row = row_begin; row <= row_end; row++)
+    {
+        for (int col = col_begin; col <= col_end; col++)
+        {
+            // barycentric coordinates in the image
+            const float w0 = ((u[1] - col) * (v[2] - row) -
+                              (u[2] - col) * (v[1] - row)) *
+                             inverse_area;
+            const float w1 = ((u[2] - col) * (v[0] - row) -
+                              (u[0] - col) * (v[2] - row)) *
+                             inverse_area;
+            const float w2 = 1.0f - w0 - w1;
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+
+            // 1 / z is linear in the image
+            const float z = 1.0f / (w0 * inverse_z[0] + w1 * inverse_z[1] +
+                                    w2 * inverse_z[2]);
+            if (z > g.camera.far_plane) continue;
+
+            write(row, col, z);
+        }
+    }
+}
+
+/**
+ * \brief Keeps the nearest depth in a float, positive floats order like
+ *        their bit patterns
+ */
+__device__ __forceinline__ void store_nearest(float* depth, float z)
+{
+    atomicMin((int*)depth, __float_as_int(z));
+}
@@ -0,0 +1,313 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gaussian_image_model_gpu.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <boost/shared_ptr.hpp>
+
+#include <dbot/gpu/buffer_configuration.h>
+#include <dbot/gpu/cuda_likelihood_evaluator.h>
+#include <dbot/gpu/gl_context.h>
+#include <dbot/gpu/object_rasterizer.h>
+#include <dbot/gpu/shader_provider.h>
+#include <dbot/gpu/sigma_point_moments.h>
+#include <dbot/image_region.h>
+#include <dbot/mesh_levels.h>
+#include <dbot/pose/pose_composition.h>
+#include <dbot/pose/pose_vector.h>
+#include <dbot/trace_recorder.h>
+
+#include <cuda_gl_interop.h>
+
+namespace dbot
+{
+/**
+ * \brief Measurement update of the Gaussian tracker on the GPU.
+ *
+ * All unscented sigma points of the belief are rendered in one batch of the
+ * ObjectRasterizer. The CUDA evaluator computes the moments of the body/tail
+ * pixel model under every sigma point and reduces the information of all
+ * pixels, only these sums are copied back, see SigmaPointMoments. The
+ * states are deltas from the nominal pose as for the CPU DepthPixelModel.
+ */
+template <typename State>
+class GaussianImageModelGPU
+{
+public:
+    typedef SigmaPointMoments::Vector Vector;
+    typedef SigmaPointMoments::Matrix Matrix;
+    typedef Eigen::Matrix3d CameraMatrix;
+
+public:
+    /**
+     * \param parameters	body/tail pixel model
+     * \param ut_alpha		spread of the sigma points
+     * \param gl_context	backend and GPU of the OpenGL context, the CUDA
+     *                      kernels run on the same GPU
+     */
+    GaussianImageModelGPU(
+        const CameraMatrix& camera_matrix,
+        const int nr_rows,
+        const int nr_cols,
+        const std::vector<std::vector<Eigen::Vector3d>>& vertices,
+        const std::vector<std::vector<std::vector<int>>>& indices,
+        const std::shared_ptr<ShaderProvider>& shader_provider,
+        const SigmaPointMoments::Parameters& parameters,
+        const double ut_alpha,
+        const GlContext::Parameters& gl_context = GlContext::Parameters())
+        : camera_matrix_(camera_matrix),
+          nr_rows_(nr_rows),
+          nr_cols_(nr_cols),
+          moments_(parameters, ut_alpha),
+          resource_registered_(false),
+          observations_set_(false)
+    {
+        nominal_pose_.recount(vertices.size());
+        nominal_pose_.setZero();
+
+        mesh_levels_ = MeshLevels(
+            std::make_shared<FlatMesh>(vertices, indices), nr_mesh_levels);
+        box_corners_ = bounding_box_corners(vertices);
+
+        const GlContext::Parameters context = GlContext::resolve(gl_context);
+        opengl_ = boost::shared_ptr<ObjectRasterizer>(
+            new ObjectRasterizer(mesh_levels_.levels(),
+                                 shader_provider,
+                                 camera_matrix_.cast<float>(),
+                                 nr_rows_,
+                                 nr_cols_,
+                                 0.4,
+                                 4,
+                                 context));
+
+        // the occlusion model is not used, init() only enables the
+        // allocation of the buffers
+        cuda_ = boost::shared_ptr<CudaEvaluator>(
+            new CudaEvaluator(nr_rows_, nr_cols_, context.device));
+        cuda_->init(0.1f,
+                    0.7f,
+                    0.1f,
+                    moments_.tail_weight(),
+                    0.003f,
+                    0.0014247f,
+                    6.0f,
+                    -log(0.5f));
+
+        model_.bg_depth = moments_.bg_depth();
+        model_.fg_variance = moments_.fg_variance();
+        model_.bg_variance = moments_.bg_variance();
+        model_.tail_weight = moments_.tail_weight();
+        model_.tail_mean = moments_.tail_mean();
+        model_.tail_variance = moments_.tail_variance();
+
+        // room for the sigma points of the largest supported state
+        const int max_nr_poses = SigmaPointMoments::max_point_count;
+        buffer_config_ = boost::shared_ptr<BufferConfiguration>(
+            new BufferConfiguration(
+                opengl_, cuda_, max_nr_poses, nr_rows_, nr_cols_));
+        int nr_poses;
+        if (!buffer_config_->allocate_memory(max_nr_poses, nr_poses) ||
+            !buffer_config_->set_resolution(nr_rows_, nr_cols_, nr_poses) ||
+            nr_poses < max_nr_poses)
+        {
+            std::cout << "GPU: cannot render " << max_nr_poses
+                      << " sigma points" << std::endl;
+            exit(-1);
+        }
+
+        register_resource();
+    }
+
+    ~GaussianImageModelGPU() { unregister_resource(); }
+
+    /**
+     * \brief Sets the pose the deltas of the states are applied to
+     */
+    void nominal_pose(const State& pose) { nominal_pose_ = pose; }
+
+    const State& nominal_pose() const { return nominal_pose_; }
+
+    /**
+     * \brief Uploads the depth image, one value per pixel in row major
+     *        order. Pixels without a finite value are skipped.
+     */
+    void set_observation(const Eigen::VectorXd& image)
+    {
+        observation_buffer_.resize(image.size());
+        for (int i = 0; i < image.size(); i++)
+        {
+            observation_buffer_[i] = image(i);
+        }
+        cuda_->set_observations(observation_buffer_.data(), 0);
+        observations_set_ = true;
+    }
+
+    /**
+     * \brief Updates the belief given by the mean delta and its covariance
+     *        with the current observation
+     */
+    void update(const State& mean,
+                const Matrix& covariance,
+                State& posterior_mean,
+                Matrix& posterior_covariance)
+    {
+        dbot::TraceSpan trace_span("update", "gpu_gaussian_model");
+
+        if (!observations_set_)
+        {
+            std::cout << "GPU: observations not set" << std::endl;
+            exit(-1);
+        }
+
+        moments_.linearize(mean, covariance);
+        render(moments_.points());
+
+        cudaGraphicsMapResources(
+            1, &texture_resource_, cuda_->compute_stream());
+        cudaGraphicsSubResourceGetMappedArray(
+            &texture_array_, texture_resource_, 0, 0);
+        cuda_->map_texture_to_texture_array(texture_array_);
+
+        cuda_->reduce_sigma_point_moments(model_,
+                                          moments_.coefficients().data(),
+                                          moments_.dimension(),
+                                          sums_);
+
+        cudaGraphicsUnmapResources(
+            1, &texture_resource_, cuda_->compute_stream());
+
+        Vector delta;
+        moments_.posterior(sums_, delta, posterior_covariance);
+        posterior_mean = State(delta);
+    }
+
+private:
+    /**
+     * \brief Renders the sigma points applied to the nominal pose and
+     *        restricts the evaluation to the pixels they cover
+     */
+    void render(const Matrix& points)
+    {
+        const int nr_poses = points.cols();
+        const int nr_objects = box_corners_.size();
+
+        int tmp_nr_poses;
+        if (!buffer_config_->set_nr_of_poses(nr_poses, tmp_nr_poses) ||
+            tmp_nr_poses != nr_poses)
+        {
+            exit(-1);
+        }
+
+        float* model_matrices = opengl_->begin_pose_upload(nr_poses);
+        ImageRegion footprint;
+        std::vector<int> levels(nr_objects, mesh_levels_.level_count() - 1);
+
+        composition_.base_poses(nominal_pose_);
+        Eigen::Matrix4d homogeneous;
+        for (int i_point = 0; i_point < nr_poses; i_point++)
+        {
+            for (int i_obj = 0; i_obj < nr_objects; i_obj++)
+            {
+                composition_.compose(
+                    points.col(i_point), i_obj, homogeneous.data());
+                Eigen::Map<Eigen::Matrix4f>(
+                    model_matrices + (i_point * nr_objects + i_obj) * 16) =
+                    homogeneous.cast<float>();
+
+                footprint = footprint.unite(
+                    projected_region(box_corners_[i_obj],
+                                     homogeneous.topLeftCorner(3, 3),
+                                     homogeneous.topRightCorner(3, 1),
+                                     camera_matrix_,
+                                     nr_rows_,
+                                     nr_cols_));
+
+                levels[i_obj] = std::min(
+                    levels[i_obj],
+                    mesh_levels_.select(i_obj,
+                                        homogeneous.topLeftCorner(3, 3),
+                                        homogeneous.topRightCorner(3, 1),
+                                        camera_matrix_));
+            }
+        }
+        opengl_->set_levels(levels);
+
+        // pixels no sigma point covers have the same moments under all of
+        // them and carry no information
+        CudaEvaluator::PixelRegion region = {
+            footprint.row, footprint.col, footprint.rows, footprint.cols};
+        cuda_->set_evaluation_region(region);
+
+        opengl_->render_uploaded_poses(nr_poses);
+    }
+
+    void register_resource()
+    {
+        if (!resource_registered_)
+        {
+            GLuint texture = opengl_->get_framebuffer_texture();
+            cudaGraphicsGLRegisterImage(&texture_resource_,
+                                        texture,
+                                        GL_TEXTURE_2D,
+                                        cudaGraphicsRegisterFlagsReadOnly);
+            resource_registered_ = true;
+        }
+    }
+
+    void unregister_resource()
+    {
+        if (resource_registered_)
+        {
+            cuda_->unmap_texture();
+            cudaGraphicsUnregisterResource(texture_resource_);
+            resource_registered_ = false;
+        }
+    }
+
+private:
+    CameraMatrix camera_matrix_;
+    int nr_rows_;
+    int nr_cols_;
+
+    SigmaPointMoments moments_;
+    CudaEvaluator::MomentParameters model_;
+    std::vector<double> sums_;
+    State nominal_pose_;
+    PoseComposition composition_;
+
+    static constexpr int nr_mesh_levels = 4;
+    MeshLevels mesh_levels_;
+    std::vector<std::vector<Eigen::Vector3d>> box_corners_;
+
+    boost::shared_ptr<ObjectRasterizer> opengl_;
+    boost::shared_ptr<CudaEvaluator> cuda_;
+    boost::shared_ptr<BufferConfiguration> buffer_config_;
+
+    cudaGraphicsResource* texture_resource_;
+    cudaArray_t texture_array_;
+    bool resource_registered_;
+
+    std::vector<float> observation_buffer_;
+    bool observations_set_;
+};
+}
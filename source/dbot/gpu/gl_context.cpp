@@ -0,0 +1,393 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gl_context.cpp
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <GL/glx.h>
+
+#ifdef DBOT_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <dbot/gpu/gl_context.h>
+
+#ifndef EGL_CUDA_DEVICE_NV
+#define EGL_CUDA_DEVICE_NV 0x323A
+#endif
+
+namespace dbot
+{
+namespace
+{
+void fail(const char* message)
+{
+    fprintf(stderr, "%s\n", message);
+    exit(1);
+}
+}
+
+struct GlContext::Glx
+{
+    Glx(int width, int height);
+    ~Glx();
+
+    Display* display = nullptr;
+    GLXContext context = nullptr;
+    GLXPbuffer pbuffer = 0;
+
+    /* -- pbuffer or the root window if the driver does not render
+     *    without a default framebuffer -- */
+    GLXDrawable drawable = 0;
+};
+
+#ifdef DBOT_HAVE_EGL
+struct GlContext::Egl
+{
+    Egl(int width, int height, int device);
+    ~Egl();
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+};
+#else
+struct GlContext::Egl
+{
+};
+#endif
+
+GlContext::GlContext(int width, int height, const Parameters& parameters)
+    : parameters_(resolve(parameters))
+{
+    if (parameters_.backend == Backend::Egl)
+    {
+#ifdef DBOT_HAVE_EGL
+        egl_.reset(new Egl(width, height, parameters_.device));
+#else
+        fail("dbot has been compiled without EGL support");
+#endif
+    }
+    else
+    {
+        if (parameters_.device >= 0)
+        {
+            fprintf(stderr,
+                    "GLX renders on the GPU of the X screen, the EGL "
+                    "backend is needed to render on device %d\n",
+                    parameters_.device);
+        }
+        glx_.reset(new Glx(width, height));
+    }
+
+    printf("vendor: %s\n", (const char*)glGetString(GL_VENDOR));
+}
+
+GlContext::~GlContext()
+{
+}
+
+void GlContext::make_current()
+{
+    if (glx_)
+    {
+        if (glXGetCurrentContext() != glx_->context &&
+            !glXMakeContextCurrent(
+                glx_->display, glx_->drawable, glx_->drawable, glx_->context))
+        {
+            fail("failed to make current");
+        }
+    }
+#ifdef DBOT_HAVE_EGL
+    else if (egl_)
+    {
+        if (eglGetCurrentContext() != egl_->context &&
+            !eglMakeCurrent(
+                egl_->display, egl_->surface, egl_->surface, egl_->context))
+        {
+            fail("failed to make current");
+        }
+    }
+#endif
+}
+
+auto GlContext::resolve(const Parameters& parameters) -> Parameters
+{
+    Parameters resolved = parameters;
+
+    if (resolved.backend == Backend::Default)
+    {
+        const char* name = std::getenv("DBOT_GL_BACKEND");
+        if (name && !parse_backend(name, resolved.backend))
+        {
+            fprintf(stderr, "Unknown DBOT_GL_BACKEND %s\n", name);
+            exit(1);
+        }
+    }
+    if (resolved.backend == Backend::Default)
+    {
+#ifdef DBOT_GL_DEFAULT_EGL
+        resolved.backend = Backend::Egl;
+#else
+        resolved.backend = Backend::Glx;
+#endif
+    }
+
+    if (resolved.device < 0)
+    {
+        const char* device = std::getenv("DBOT_GPU_DEVICE");
+        if (device && *device) resolved.device = std::atoi(device);
+    }
+
+    return resolved;
+}
+
+bool GlContext::parse_backend(const std::string& name, Backend& backend)
+{
+    if (name == "glx")
+    {
+        backend = Backend::Glx;
+    }
+    else if (name == "egl")
+    {
+        backend = Backend::Egl;
+    }
+    else if (name == "default" || name.empty())
+    {
+        backend = Backend::Default;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool GlContext::egl_supported()
+{
+#ifdef DBOT_HAVE_EGL
+    return true;
+#else
+    return false;
+#endif
+}
+
+GlContext::Glx::Glx(int width, int height)
+{
+    typedef GLXContext (*glXCreateContextAttribsARBProc)(
+        Display*, GLXFBConfig, GLXContext, Bool, const int*);
+    typedef Bool (*glXMakeContextCurrentARBProc)(
+        Display*, GLXDrawable, GLXDrawable, GLXContext);
+    static glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
+    static glXMakeContextCurrentARBProc glXMakeContextCurrentARB = 0;
+
+    static int visual_attribs[] = {None};
+    int context_attribs[] = {GLX_CONTEXT_MAJOR_VERSION_ARB,
+                             3,
+                             GLX_CONTEXT_MINOR_VERSION_ARB,
+                             2,
+                             None};
+
+    int fbcount = 0;
+    GLXFBConfig* fbc = NULL;
+
+    /* open display */
+    if (!(display = XOpenDisplay(0)))
+    {
+        fail("Failed to open display");
+    }
+
+    /* get framebuffer configs, any is usable (might want to add proper attribs)
+     */
+    if (!(fbc = glXChooseFBConfig(
+              display, DefaultScreen(display), visual_attribs, &fbcount)))
+    {
+        fail("Failed to get FBConfig");
+    }
+
+    /* get the required extensions */
+    glXCreateContextAttribsARB =
+        (glXCreateContextAttribsARBProc)glXGetProcAddressARB(
+            (const GLubyte*)"glXCreateContextAttribsARB");
+    glXMakeContextCurrentARB =
+        (glXMakeContextCurrentARBProc)glXGetProcAddressARB(
+            (const GLubyte*)"glXMakeContextCurrent");
+    if (!(glXCreateContextAttribsARB && glXMakeContextCurrentARB))
+    {
+        XFree(fbc);
+        fail("missing support for GLX_ARB_create_context");
+    }
+
+    /* create a context using glXCreateContextAttribsARB */
+    if (!(context = glXCreateContextAttribsARB(
+              display, fbc[0], 0, True, context_attribs)))
+    {
+        XFree(fbc);
+        fail("Failed to create opengl context");
+    }
+
+    /* create temporary pbuffer */
+    int pbuffer_attribs[] = {
+        GLX_PBUFFER_WIDTH, width, GLX_PBUFFER_HEIGHT, height, None};
+    pbuffer = glXCreatePbuffer(display, fbc[0], pbuffer_attribs);
+
+    XFree(fbc);
+    XSync(display, False);
+
+    /* try to make it the current context */
+    drawable = pbuffer;
+    if (!glXMakeContextCurrent(display, drawable, drawable, context))
+    {
+        /* some drivers do not support context without default framebuffer,
+         * so fallback on using the default window.
+         */
+        drawable = DefaultRootWindow(display);
+        if (!glXMakeContextCurrent(display, drawable, drawable, context))
+        {
+            fail("failed to make current");
+        }
+    }
+}
+
+GlContext::Glx::~Glx()
+{
+    glXMakeContextCurrent(display, None, None, NULL);
+    if (pbuffer) glXDestroyPbuffer(display, pbuffer);
+    glXDestroyContext(display, context);
+    XCloseDisplay(display);
+}
+
+#ifdef DBOT_HAVE_EGL
+namespace
+{
+/**
+ * \brief The EGL device whose CUDA ordinal is the requested one, devices
+ *        which do not report one are matched by their enumeration index
+ */
+EGLDisplay open_egl_device(int device)
+{
+    PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT =
+        (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    PFNEGLQUERYDEVICEATTRIBEXTPROC eglQueryDeviceAttribEXT =
+        (PFNEGLQUERYDEVICEATTRIBEXTPROC)eglGetProcAddress(
+            "eglQueryDeviceAttribEXT");
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    if (!(eglQueryDevicesEXT && eglGetPlatformDisplayEXT))
+    {
+        fail("missing support for EGL_EXT_device_enumeration");
+    }
+
+    EGLint count = 0;
+    eglQueryDevicesEXT(0, NULL, &count);
+    std::vector<EGLDeviceEXT> devices(count);
+    if (count == 0 || !eglQueryDevicesEXT(count, devices.data(), &count))
+    {
+        fail("Failed to find an EGL device");
+    }
+
+    const int ordinal = device < 0 ? 0 : device;
+    int selected = -1;
+    for (int i = 0; i < count && selected < 0; i++)
+    {
+        EGLAttrib cuda_device = -1;
+        if (eglQueryDeviceAttribEXT &&
+            eglQueryDeviceAttribEXT(
+                devices[i], EGL_CUDA_DEVICE_NV, &cuda_device) &&
+            cuda_device == ordinal)
+        {
+            selected = i;
+        }
+    }
+    if (selected < 0 && ordinal < count) selected = ordinal;
+    if (selected < 0)
+    {
+        fprintf(stderr, "There is no EGL device %d\n", device);
+        exit(1);
+    }
+
+    return eglGetPlatformDisplayEXT(
+        EGL_PLATFORM_DEVICE_EXT, devices[selected], NULL);
+}
+}
+
+GlContext::Egl::Egl(int width, int height, int device)
+{
+    display = open_egl_device(device);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        fail("Failed to initialize the EGL display");
+    }
+
+    const EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+                                     EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE,
+                                     EGL_OPENGL_BIT,
+                                     EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) ||
+        config_count == 0)
+    {
+        fail("Failed to get an EGL config");
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) fail("Failed to bind the OpenGL API");
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      2,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+    context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        fail("Failed to create opengl context");
+    }
+
+    /* rendering goes to framebuffer objects, a surface is only created for
+     * drivers without EGL_KHR_surfaceless_context */
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        const EGLint pbuffer_attribs[] = {
+            EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+        if (surface == EGL_NO_SURFACE ||
+            !eglMakeCurrent(display, surface, surface, context))
+        {
+            fail("failed to make current");
+        }
+    }
+}
+
+GlContext::Egl::~Egl()
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+#endif
+}
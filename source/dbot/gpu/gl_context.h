@@ -0,0 +1,98 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gl_context.h
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace dbot
+{
+/**
+ * \brief Offscreen OpenGL 3.2 context, current on the creating thread
+ *        until another context is made current on it.
+ *
+ * The GLX backend needs an X server, the EGL backend creates the context
+ * on an EGL device without any display server and can select the GPU it
+ * runs on. The backend is taken from the parameters, else from the
+ * DBOT_GL_BACKEND environment variable ("glx" or "egl"), else from the
+ * DBOT_GL_BACKEND build setting. The device likewise falls back to the
+ * DBOT_GPU_DEVICE environment variable.
+ */
+class GlContext
+{
+public:
+    enum class Backend
+    {
+        Default,
+        Glx,
+        Egl
+    };
+
+    struct Parameters
+    {
+        Backend backend = Backend::Default;
+
+        /* -- CUDA ordinal of the GPU, negative for the default one. The
+         *    GLX backend renders on the GPU of the X screen -- */
+        int device = -1;
+    };
+
+public:
+    /**
+     * \brief Creates the context and makes it current, exits if that fails
+     *
+     * \param width, height  of the default framebuffer if the backend
+     *                       needs one, rendering goes to framebuffer objects
+     */
+    GlContext(int width, int height, const Parameters& parameters);
+
+    ~GlContext();
+
+    /**
+     * \brief Makes the context current on the calling thread again if
+     *        another one has been made current, exits if that fails
+     */
+    void make_current();
+
+    /**
+     * \brief Parameters with the default backend and device replaced by
+     *        the environment and build settings
+     */
+    static Parameters resolve(const Parameters& parameters);
+
+    /**
+     * \brief Parses "glx", "egl" or "default", returns false otherwise
+     */
+    static bool parse_backend(const std::string& name, Backend& backend);
+
+    static bool egl_supported();
+
+    Backend backend() const { return parameters_.backend; }
+
+    /** \brief CUDA ordinal the context renders on, -1 if not known */
+    int device() const { return parameters_.device; }
+
+private:
+    struct Glx;
+    struct Egl;
+
+    Parameters parameters_;
+    std::unique_ptr<Glx> glx_;
+    std::unique_ptr<Egl> egl_;
+};
+}
@@ -0,0 +1,63 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gl_context_test.cpp
+ */
+
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include <dbot/gpu/gl_context.h>
+
+using dbot::GlContext;
+
+TEST(GlContextTests, backend_names_are_parsed)
+{
+    GlContext::Backend backend = GlContext::Backend::Glx;
+    EXPECT_TRUE(GlContext::parse_backend("egl", backend));
+    EXPECT_EQ(backend, GlContext::Backend::Egl);
+    EXPECT_TRUE(GlContext::parse_backend("glx", backend));
+    EXPECT_EQ(backend, GlContext::Backend::Glx);
+    EXPECT_TRUE(GlContext::parse_backend("default", backend));
+    EXPECT_EQ(backend, GlContext::Backend::Default);
+
+    backend = GlContext::Backend::Glx;
+    EXPECT_FALSE(GlContext::parse_backend("glut", backend));
+    EXPECT_EQ(backend, GlContext::Backend::Glx);
+}
+
+TEST(GlContextTests, environment_fills_in_the_defaults)
+{
+    setenv("DBOT_GL_BACKEND", "egl", 1);
+    setenv("DBOT_GPU_DEVICE", "2", 1);
+
+    GlContext::Parameters resolved = GlContext::resolve({});
+    EXPECT_EQ(resolved.backend, GlContext::Backend::Egl);
+    EXPECT_EQ(resolved.device, 2);
+
+    GlContext::Parameters explicit_parameters;
+    explicit_parameters.backend = GlContext::Backend::Glx;
+    explicit_parameters.device = 1;
+    resolved = GlContext::resolve(explicit_parameters);
+    EXPECT_EQ(resolved.backend, GlContext::Backend::Glx);
+    EXPECT_EQ(resolved.device, 1);
+
+    unsetenv("DBOT_GL_BACKEND");
+    unsetenv("DBOT_GPU_DEVICE");
+
+    resolved = GlContext::resolve({});
+    EXPECT_NE(resolved.backend, GlContext::Backend::Default);
+    EXPECT_EQ(resolved.device, -1);
+}
@@ -0,0 +1,252 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gpu_resources.cpp
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <dbot/gpu/gpu_resources.h>
+#include <dbot/gpu/shader.h>
+
+namespace dbot
+{
+namespace
+{
+/**
+ * \brief The driver strings, a binary is only valid for the driver which
+ *        produced it
+ */
+std::string driver_key()
+{
+    std::string key;
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names)
+    {
+        const GLubyte* value = glGetString(name);
+        if (value) key += reinterpret_cast<const char*>(value);
+        key += '\n';
+    }
+    return key;
+}
+
+/**
+ * \brief Program created from the cached binary, 0 if there is none or the
+ *        driver rejects it, e.g. after an update which kept its version
+ */
+GLuint load_program(const ProgramBinaryCache& cache, const std::string& key)
+{
+    std::uint32_t format;
+    std::vector<char> binary;
+    if (!cache.find(key, format, binary)) return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), binary.size());
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void store_program(const ProgramBinaryCache& cache,
+                   const std::string& key,
+                   GLuint program)
+{
+    GLint status = GL_FALSE;
+    GLint size = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (status == GL_FALSE || size <= 0) return;
+
+    GLenum format;
+    std::vector<char> binary(size);
+    glGetProgramBinary(program, size, &size, &format, binary.data());
+    binary.resize(size);
+
+    if (!cache.store(key, format, binary))
+    {
+        fprintf(stderr,
+                "Failed to store the program binary in %s\n",
+                cache.directory().c_str());
+    }
+}
+}
+
+GpuResources::GpuResources()
+    : binary_cache_(ProgramBinaryCache::default_directory())
+{
+}
+
+GpuResources& GpuResources::instance()
+{
+    // destroying contexts during the static destruction would race with the
+    // shutdown of the drivers, the process exit frees them anyway
+    static GpuResources* resources = new GpuResources();
+    return *resources;
+}
+
+std::shared_ptr<GlContext> GpuResources::context(
+    int width,
+    int height,
+    const GlContext::Parameters& parameters)
+{
+    const GlContext::Parameters resolved = GlContext::resolve(parameters);
+    const std::thread::id thread = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : entries_)
+    {
+        if (entry.thread == thread && entry.backend == resolved.backend &&
+            entry.device == resolved.device)
+        {
+            entry.context->make_current();
+            return entry.context;
+        }
+    }
+
+    Entry entry;
+    entry.thread = thread;
+    entry.backend = resolved.backend;
+    entry.device = resolved.device;
+    entry.context = std::make_shared<GlContext>(width, height, resolved);
+
+    glewExperimental = true;  // Needed for core profile
+    GLenum glew_status = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX finds no GLX display in an EGL context but loads
+    // the entry points nevertheless
+    if (glew_status == GLEW_ERROR_NO_GLX_DISPLAY &&
+        resolved.backend == GlContext::Backend::Egl)
+    {
+        glew_status = GLEW_OK;
+    }
+#endif
+    if (glew_status != GLEW_OK)
+    {
+        fprintf(stderr, "Failed to initialize GLEW\n");
+        exit(EXIT_FAILURE);
+    }
+
+    entries_.push_back(entry);
+
+    // constructed once per thread which created a context
+    static thread_local ThreadRelease thread_release;
+    (void)thread_release;
+
+    return entry.context;
+}
+
+GLuint GpuResources::program(const GlContext& context,
+                             const std::vector<ShaderSource>& sources)
+{
+    std::string key;
+    for (const ShaderSource& source : sources)
+    {
+        key += std::to_string(source.type) + '\n' + source.code + '\0';
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : entries_)
+    {
+        if (entry.context.get() != &context) continue;
+
+        auto cached = entry.programs.find(key);
+        if (cached != entry.programs.end()) return cached->second;
+
+        const bool binaries = binary_cache_.enabled() &&
+                              GLEW_ARB_get_program_binary;
+        const std::string binary_key = binaries ? driver_key() + key : "";
+
+        GLuint program = binaries ? load_program(binary_cache_, binary_key) : 0;
+        if (!program)
+        {
+            std::vector<GLuint> shaders;
+            for (const ShaderSource& source : sources)
+            {
+                shaders.push_back(CreateShader(source.type, source.code));
+            }
+            program = CreateProgram(shaders, binaries);
+            for (size_t i = 0; i < shaders.size(); i++)
+            {
+                glDeleteShader(shaders[i]);
+            }
+
+            if (binaries) store_program(binary_cache_, binary_key, program);
+        }
+
+        entry.programs[key] = program;
+        return program;
+    }
+
+    fprintf(stderr, "The context has not been created by GpuResources\n");
+    exit(EXIT_FAILURE);
+}
+
+void GpuResources::set_binary_cache_directory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    binary_cache_ = ProgramBinaryCache(directory);
+}
+
+void GpuResources::release_unused()
+{
+    release(false);
+}
+
+GpuResources::ThreadRelease::~ThreadRelease()
+{
+    GpuResources::instance().release(true);
+}
+
+void GpuResources::release(bool used)
+{
+    const std::thread::id thread = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < entries_.size();)
+    {
+        Entry& entry = entries_[i];
+        if (entry.thread != thread ||
+            (!used && entry.context.use_count() > 1))
+        {
+            i++;
+            continue;
+        }
+
+        entry.context->make_current();
+        for (auto& program : entry.programs) glDeleteProgram(program.second);
+        entries_.erase(entries_.begin() + i);
+    }
+}
+
+int GpuResources::context_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+int GpuResources::program_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int count = 0;
+    for (const Entry& entry : entries_) count += entry.programs.size();
+    return count;
+}
+}
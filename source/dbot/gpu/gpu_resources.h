@@ -0,0 +1,134 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gpu_resources.h
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dbot/gpu/gl_context.h>
+#include <dbot/gpu/program_binary_cache.h>
+
+namespace dbot
+{
+/**
+ * \brief Source code of one stage of a shader program
+ */
+struct ShaderSource
+{
+    GLenum type;
+    std::string code;
+};
+
+/**
+ * \brief Process wide pool of the OpenGL contexts and compiled shader
+ *        programs, shared by all ObjectRasterizer instances.
+ *
+ * Building a tracker used to create a context, initialize GLEW and compile
+ * the shaders every time. The pool creates a context per backend, device
+ * and thread when it is first asked for and keeps it when the trackers
+ * using it are destroyed, hence rebuilding a tracker only allocates its
+ * buffers again. Programs are compiled once per context and source code,
+ * and their binaries are kept in a ProgramBinaryCache for the next start
+ * if the driver supports ARB_get_program_binary.
+ *
+ * The objects a rasterizer creates stay private to it, only the state it
+ * sets before every use is shared. The contexts of a thread and their
+ * programs are released when the thread exits, e.g. a worker of a
+ * MultiGpuKinectImageModel or an OfflineBatchTracker, since a context is
+ * only current on the thread it was created for.
+ */
+class GpuResources
+{
+public:
+    /** \brief The pool of the process, it is never destroyed */
+    static GpuResources& instance();
+
+    /**
+     * \brief Context of the calling thread for the backend and device of
+     *        the parameters, created on first use and made current
+     *
+     * \param width, height  of the default framebuffer if a new context
+     *                       needs one
+     */
+    std::shared_ptr<GlContext> context(int width,
+                                       int height,
+                                       const GlContext::Parameters& parameters);
+
+    /**
+     * \brief Program linked from the sources, compiled within the context on
+     *        first use. It is owned by the pool and must not be deleted.
+     *
+     * \param context  a context returned by context(), current on the
+     *                 calling thread
+     */
+    GLuint program(const GlContext& context,
+                   const std::vector<ShaderSource>& sources);
+
+    /**
+     * \brief Directory of the program binaries, an empty one disables
+     *        the cache. Defaults to ProgramBinaryCache::default_directory().
+     */
+    void set_binary_cache_directory(const std::string& directory);
+
+    /**
+     * \brief Destroys the contexts of the calling thread which are no longer
+     *        used by any rasterizer, together with their programs
+     */
+    void release_unused();
+
+    int context_count() const;
+    int program_count() const;
+
+private:
+    GpuResources();
+    GpuResources(const GpuResources&) = delete;
+    GpuResources& operator=(const GpuResources&) = delete;
+
+    /** \brief Releases the contexts of its thread when the thread exits */
+    struct ThreadRelease
+    {
+        ~ThreadRelease();
+    };
+
+    /**
+     * \brief Destroys the contexts of the calling thread, all of them or
+     *        only those no rasterizer uses, together with their programs
+     */
+    void release(bool used);
+
+    struct Entry
+    {
+        std::thread::id thread;
+        GlContext::Backend backend;
+        int device;
+        std::shared_ptr<GlContext> context;
+
+        /** programs by the concatenated types and sources */
+        std::map<std::string, GLuint> programs;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    ProgramBinaryCache binary_cache_;
+};
+}
@@ -29,23 +29,33 @@
 
 #pragma once
 
-#define PROFILING_ACTIVE
 //#define OPTIMIZE_NR_THREADS
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/shared_ptr.hpp>
 #include <dbot/gpu/buffer_configuration.h>
 #include <dbot/gpu/cuda_likelihood_evaluator.h>
+#include <dbot/gpu/cuda_rasterizer.h>
+#include <dbot/gpu/launch_configuration_cache.h>
+#include <dbot/gpu/pinned_image_buffer.h>
+#include <dbot/gpu/pixel_likelihood_table.h>
 #include <dbot/gpu/object_rasterizer.h>
 #include <dbot/helper_functions.h>
+#include <dbot/image_region.h>
+#include <dbot/mesh_levels.h>
 #include <dbot/model/rao_blackwell_sensor.h>
 #include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/pose/pose_composition.h>
 #include <dbot/pose/pose_vector.h>
+#include <dbot/profiler.h>
+#include <dbot/trace_recorder.h>
 #include <dbot/traits.h>
 #include <fl/util/profiling.hpp>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
@@ -151,6 +161,8 @@ public:
      * \param [in] exponential_rate the rate of the exponential distribution
      * that
      * models the probability of a measurement coming from an unknown object
+     * \param [in] gl_context backend and GPU of the OpenGL context, the
+     * CUDA kernels run on the same GPU
      */
     KinectImageModelGPU(
         const CameraMatrix& camera_matrix,
@@ -170,12 +182,13 @@ public:
         const float model_sigma = 0.003f,
         const float sigma_factor = 0.0014247f,
         const float max_depth = 6.0f,
-        const float exponential_rate = -log(0.5f))
+        const float exponential_rate = -log(0.5f),
+        const GlContext::Parameters& gl_context = GlContext::Parameters())
         : camera_matrix_(camera_matrix),
           nr_rows_(nr_rows),
           nr_cols_(nr_cols),
           nr_max_poses_(max_sample_count),
-          indices_(indices),
+          requested_max_poses_(max_sample_count),
           optimize_nr_threads_(optimize_nr_threads),
           initial_occlusion_prob_(initial_occlusion_prob),
           tail_weight_(tail_weight),
@@ -186,40 +199,41 @@ public:
           nr_poses_(max_sample_count),
           observations_set_(false),
           resource_registered_(false),
+          pipelining_(false),
+          observation_prefetched_(false),
+          device_weights_(false),
+          device_weights_reset_(true),
+          fused_evaluation_(false),
+          depth_rendered_(false),
           observation_time_(0),
+          region_of_interest_(nr_rows, nr_cols),
           Traits::Base(delta_time)
     {
         // set constants
         this->default_poses_.recount(vertices_double.size());
         this->default_poses_.setZero();
 
-        // convert doubles to floats
-        vertices_.resize(vertices_double.size());
-        for (size_t object_index = 0; object_index < vertices_.size();
-             object_index++)
-        {
-            vertices_[object_index].resize(
-                vertices_double[object_index].size());
-            for (size_t vertex_index = 0;
-                 vertex_index < vertices_[object_index].size();
-                 vertex_index++)
-                vertices_[object_index][vertex_index] =
-                    vertices_double[object_index][vertex_index].cast<float>();
-        }
+        // the rasterizer uploads the flat arrays of all levels of detail
+        mesh_levels_ = MeshLevels(
+            std::make_shared<FlatMesh>(vertices_double, indices),
+            nr_mesh_levels);
+
+        box_corners_ = bounding_box_corners(vertices_double);
 
-        // initialize opengl and cuda
+        // initialize opengl and cuda, both on the device of the context
+        const GlContext::Parameters context = GlContext::resolve(gl_context);
         opengl_ = boost::shared_ptr<ObjectRasterizer>(
-            new ObjectRasterizer(vertices_,
-                                 indices_,
+            new ObjectRasterizer(mesh_levels_.levels(),
                                  shader_provider,
                                  camera_matrix_.cast<float>(),
                                  nr_rows_,
                                  nr_cols_,
                                  0.4,
-                                 4));
+                                 4,
+                                 context));
 
         cuda_ = boost::shared_ptr<CudaEvaluator>(
-            new CudaEvaluator(nr_rows_, nr_cols_));
+            new CudaEvaluator(nr_rows_, nr_cols_, context.device));
 
         cuda_->init(initial_occlusion_prob_,
                     p_occluded_occluded,
@@ -236,102 +250,815 @@ public:
 
         bufferConfig_->set_adapt_to_constraints(adapt_to_constraints);
 
-        // allocates memory and sets the dimensions of how many poses will be
-        // rendered per row and per column in the texture
-        int tmp_max_nr_poses;
-        if (bufferConfig_->allocate_memory(nr_max_poses_, tmp_max_nr_poses))
+        allocate_memory();
+
+        register_resource();
+
+        reset();
+
+        count_ = 0;
+
+        occlusion_probs_.resize(nr_rows_ * nr_cols_);
+
+        optimize_nr_threads_ = false;
+
+#ifdef OPTIMIZE_NR_THREADS
+        set_optimization_of_thread_nr(true);
+#endif
+        if (optimize_nr_threads_) start_thread_optimization();
+
+        optimization_runs_ = 0;
+
+        create_trace_events();
+    }
+
+    /**
+     * \brief computes the loglikelihoods for the given states
+     * Make sure the observation image was set previously, as it is used for
+     * comparison.
+     * \param [in] deltas the states which should be evaluated
+     * \param [in][out] occlusion_indices for each state, this should contain
+     * the index into the occlusion array where the corresponding occlusion
+     * probabilities per pixel are stored
+     * \param [in] update_occlusions whether or not the occlusions should be
+     * updated in this evaluation step
+     * \return the loglikelihoods for the given states
+     */
+    RealArray loglikes(const StateArray& deltas,
+                       IntArray& occlusion_indices,
+                       const bool& update_occlusions = false)
+    {
+        dbot::TraceSpan trace_span("loglikes", "gpu_model");
+        restart_stopwatch();
+
+        if (!observations_set_)
         {
-            nr_max_poses_ = tmp_max_nr_poses;
+            std::cout << "GPU: observations not set" << std::endl;
+            exit(-1);
         }
-        else
+
+        set_nr_of_poses(deltas.size());
+        std::vector<float> flog_likelihoods(nr_poses_, 0);
+
+        // transform occlusion indices from size_t to int
+        std::vector<int> occlusion_indices_transformed(occlusion_indices.size(),
+                                                       0);
+        for (size_t i = 0; i < occlusion_indices.size(); i++)
+        {
+            occlusion_indices_transformed[i] = (int)occlusion_indices[i];
+        }
+
+        // copy occlusion indices to GPU
+        cuda_->set_occlusion_indices(occlusion_indices_transformed.data(),
+                                     occlusion_indices.size());
+
+        stopwatch_.lap(dbot::ProfileStage::Upload);
+
+        render_and_weigh(deltas, update_occlusions, &flog_likelihoods);
+
+        if (update_occlusions)
+        {
+            for (size_t i_state = 0; i_state < occlusion_indices.size();
+                 i_state++)
+                occlusion_indices[i_state] = i_state;
+        }
+
+        // convert
+        RealArray log_likelihoods(flog_likelihoods.size());
+        for (size_t i = 0; i < flog_likelihoods.size(); i++)
+            log_likelihoods[i] = flog_likelihoods[i];
+
+        stopwatch_.lap(dbot::ProfileStage::Map);
+
+        count_++;
+        return log_likelihoods;
+    }
+
+    /**
+     * \brief Enables or disables keeping the particle weights on the GPU,
+     *        see compute_device_weights()
+     */
+    void set_device_weights(bool device_weights)
+    {
+        device_weights_ = device_weights;
+        device_weights_reset_ = true;
+    }
+
+    bool has_device_weights() const { return device_weights_; }
+
+    /**
+     * \brief Weighs the given states and updates the particle weights, the
+     *        occlusion indices and the previous log likelihoods on the GPU.
+     *        Neither the log likelihoods nor the occlusion indices are copied
+     *        between host and device, the host only receives the KL
+     *        divergence of the weights from the uniform distribution.
+     *
+     * \param [in] deltas the states which should be evaluated
+     * \param [in] update_occlusions whether or not the occlusions should be
+     * updated in this evaluation step
+     * \return the KL divergence of the normalized weights from uniform
+     */
+    fl::Real compute_device_weights(const StateArray& deltas,
+                                    const bool update_occlusions)
+    {
+        dbot::TraceSpan trace_span("compute_device_weights", "gpu_model");
+        restart_stopwatch();
+
+        if (!observations_set_)
+        {
+            std::cout << "GPU: observations not set" << std::endl;
+            exit(-1);
+        }
+
+        set_nr_of_poses(deltas.size());
+        if (device_weights_reset_)
+        {
+            cuda_->reset_weights(nr_poses_);
+            device_weights_reset_ = false;
+        }
+
+        render_and_weigh(deltas, update_occlusions, nullptr);
+
+        count_++;
+        return cuda_->update_weights();
+    }
+
+    /**
+     * \brief Systematic resampling of the device weights
+     *
+     * \param [in] offset uniform random number in [0, 1)
+     * \param [out] parents the parent index of every new particle
+     */
+    void resample_device_weights(const fl::Real offset, IntArray& parents)
+    {
+        parents.resize(nr_poses_);
+        cuda_->resample_weights(float(offset), parents.data());
+    }
+
+    /** \brief Copies the normalized log weights from the GPU */
+    void device_log_weights(RealArray& log_weights)
+    {
+        flog_weights_.resize(nr_poses_);
+        cuda_->get_log_weights(flog_weights_.data());
+
+        log_weights.resize(nr_poses_);
+        for (int i = 0; i < nr_poses_; i++) log_weights[i] = flog_weights_[i];
+    }
+
+    void set_device_log_weights(const RealArray& log_weights)
+    {
+        set_nr_of_poses(log_weights.size());
+
+        flog_weights_.resize(nr_poses_);
+        for (int i = 0; i < nr_poses_; i++) flog_weights_[i] = log_weights[i];
+        cuda_->set_log_weights(flog_weights_.data(), nr_poses_);
+        device_weights_reset_ = false;
+    }
+
+    /**
+     * \brief Copies the occlusions of every particle from the GPU, one
+     *        slot after the other. Only meant for checkpoints, not for the
+     *        frame loop.
+     */
+    bool save_occlusions(const IntArray& indices, OcclusionSnapshot& snapshot)
+    {
+        // with device weights the indices only exist on the GPU, before the
+        // first evaluation all particles start from slot 0
+        IntArray slots = indices;
+        if (device_weights_)
+        {
+            slots = IntArray::Zero(nr_poses_);
+            if (!device_weights_reset_)
+            {
+                cuda_->get_occlusion_indices(slots.data());
+            }
+        }
+
+        const ImageRegion& region = region_of_interest_.region();
+        snapshot.region = region;
+        snapshot.particle_count = slots.size();
+        snapshot.observation_time = observation_time_;
+        snapshot.occlusion_time = cuda_->occlusion_time();
+        snapshot.outside_occlusion = cuda_->outside_occlusion_probability();
+        snapshot.times.clear();
+        snapshot.occlusions.resize(size_t(slots.size()) * region.area());
+
+        float* row = snapshot.occlusions.data();
+        for (int i = 0; i < slots.size(); i++)
+        {
+            const std::vector<float> image =
+                cuda_->get_occlusion_probabilities(slots[i]);
+            for (int r = region.row; r < region.row + region.rows; r++)
+            {
+                row = std::copy(image.begin() + r * nr_cols_ + region.col,
+                                image.begin() + r * nr_cols_ + region.col +
+                                    region.cols,
+                                row);
+            }
+        }
+        return true;
+    }
+
+    bool load_occlusions(const OcclusionSnapshot& snapshot)
+    {
+        const ImageRegion& region = snapshot.region;
+        const size_t area = region.area();
+        if (!ImageRegion::full(nr_rows_, nr_cols_).contains(region) ||
+            snapshot.particle_count > nr_max_poses_ ||
+            snapshot.occlusions.size() != snapshot.particle_count * area)
+        {
+            return false;
+        }
+
+        region_of_interest_.set(region);
+        cuda_->set_occlusion_region(pixel_region(region));
+
+        std::vector<float> image(nr_rows_ * nr_cols_,
+                                 snapshot.outside_occlusion);
+        for (int i = 0; i < snapshot.particle_count; i++)
+        {
+            const float* row = snapshot.occlusions.data() + i * area;
+            for (int r = 0; r < region.rows; r++)
+            {
+                std::copy(row + r * region.cols,
+                          row + (r + 1) * region.cols,
+                          image.begin() + (r + region.row) * nr_cols_ +
+                              region.col);
+            }
+            cuda_->set_occlusion_probabilities(i, image.data());
+        }
+
+        // the GPU keeps a single update time, per pixel times of another
+        // sensor are reduced to the most recent one
+        double occlusion_time = snapshot.occlusion_time;
+        if (!snapshot.times.empty())
+        {
+            occlusion_time = *std::max_element(snapshot.times.begin(),
+                                               snapshot.times.end());
+        }
+        cuda_->set_occlusion_time(occlusion_time, snapshot.outside_occlusion);
+        observation_time_ = snapshot.observation_time;
+
+        if (device_weights_)
+        {
+            std::vector<int> identity(snapshot.particle_count);
+            for (int i = 0; i < snapshot.particle_count; i++) identity[i] = i;
+            cuda_->set_occlusion_indices(identity.data(), identity.size());
+        }
+        return true;
+    }
+
+    /**
+     * \brief Sets the observation image that should be used for comparison in
+     * the
+     * next evaluation step
+     *
+     * \param [in] image the image obtained from the camera
+     */
+    void set_observation(const Observation& image)
+    {
+        if (pipelining_)
+        {
+            activate_observation(image);
+            return;
+        }
+
+        observation_buffer_.resize(image.size());
+        for (int i = 0; i < image.size(); ++i)
+        {
+            observation_buffer_[i] = image(i);
+        }
+
+        set_observation(DepthImageView(observation_buffer_.data(),
+                                       observation_buffer_.size()));
+    }
+
+    /**
+     * \brief Same as above for a float image which is uploaded without any
+     *        intermediate host copy
+     */
+    void set_observation(const DepthImageView& image)
+    {
+        if (pipelining_)
+        {
+            activate_observation(image);
+            return;
+        }
+
+        observation_time_ += this->delta_time_;
+
+        cuda_->set_observations(image.data(), observation_time_);
+        observations_set_ = true;
+    }
+
+    /**
+     * \brief Same as above for a uint16 or RVL coded frame. With pipelining
+     *        the frame is decoded straight into the pinned staging memory,
+     *        otherwise into the float buffer which is uploaded. Returns false
+     *        and keeps the observation if the frame does not have the
+     *        resolution of the sensor or cannot be decoded.
+     */
+    bool set_observation(const dbot::EncodedDepthFrame& frame)
+    {
+        if (frame.pixels != nr_rows_ * nr_cols_) return false;
+
+        if (pipelining_)
+        {
+            std::lock_guard<std::mutex> lock(pipeline_mutex_);
+            if (!observation_prefetched_)
+            {
+                // the staging slot is not the active observation, a failed
+                // decode is not uploaded and the slot is reused
+                float* staging = cuda_->begin_observation_upload();
+                if (!dbot::DepthDecoding::decode(frame, staging))
+                {
+                    return false;
+                }
+                cuda_->end_observation_upload();
+            }
+            observation_prefetched_ = false;
+
+            observation_time_ += this->delta_time_;
+            cuda_->activate_observation(observation_time_);
+            observations_set_ = true;
+            return true;
+        }
+
+        observation_buffer_.resize(frame.pixels);
+        if (!dbot::DepthDecoding::decode(frame, observation_buffer_.data()))
+        {
+            return false;
+        }
+        set_observation(DepthImageView(observation_buffer_.data(),
+                                       observation_buffer_.size()));
+        return true;
+    }
+
+    /**
+     * \brief Enables the asynchronous observation pipeline, see
+     *        prefetch_observation()
+     */
+    void set_pipelining(bool pipelining)
+    {
+        if (pipelining) cuda_->enable_pipelining();
+        pipelining_ = pipelining;
+    }
+
+    /**
+     * \brief Evaluates the pixel likelihoods through a table with the given
+     *        resolution instead of analytically, see PixelLikelihoodTable.
+     *        Returns the bound on the error of the per pixel log likelihood
+     *        for observed depths of at least min_observation, or zero if the
+     *        table is disabled.
+     */
+    double set_likelihood_table(bool enable,
+                                int observation_steps = 512,
+                                int difference_steps = 512,
+                                float max_difference = 0.1f,
+                                float min_observation = 0.3f)
+    {
+        if (!enable)
+        {
+            cuda_->clear_likelihood_table();
+            return 0;
+        }
+
+        PixelLikelihoodTable::Parameters parameters;
+        parameters.tail_weight = tail_weight_;
+        parameters.model_sigma = model_sigma_;
+        parameters.sigma_factor = sigma_factor_;
+        parameters.max_depth = max_depth_;
+        parameters.exponential_rate = exponential_rate_;
+        parameters.observation_steps = observation_steps;
+        parameters.difference_steps = difference_steps;
+        parameters.max_difference = max_difference;
+
+        PixelLikelihoodTable table(parameters);
+        cuda_->set_likelihood_table(table);
+
+        return PixelLikelihoodTable::log_likelihood_error(
+            table.max_relative_error(min_observation, 2));
+    }
+
+    /**
+     * \brief Stores the occlusion probabilities in half precision or 8 bit
+     *        fixed point instead of float, which reduces the memory of the two
+     *        occlusion buffers per pose accordingly. The memory is allocated
+     *        again for the number of poses requested on construction, with
+     *        adapt_to_constraints that may now be more than before. Resets
+     *        the occlusions and returns the new maximum number of poses.
+     */
+    int set_occlusion_storage(CudaEvaluator::OcclusionStorage storage)
+    {
+        if (storage == cuda_->occlusion_storage()) return nr_max_poses_;
+
+        cuda_->set_occlusion_storage(storage);
+
+        unregister_resource();
+        nr_max_poses_ = requested_max_poses_;
+        allocate_memory();
+        register_resource();
+        if (cuda_rasterizer_) allocate_cuda_rasterizer();
+
+        if (nr_poses_ > nr_max_poses_) nr_poses_ = nr_max_poses_;
+        reset();
+
+        return nr_max_poses_;
+    }
+
+    /**
+     * \brief Switches to another resolution of the observations, e.g. a
+     *        downsampled one while the tracking falls behind. Up to the
+     *        resolution of construction the GPU buffers are kept and only
+     *        the tiling of the poses and the kernel launches change, a
+     *        larger one reallocates them. Resets the occlusions, the next
+     *        observation has to have the new resolution.
+     *
+     * \param camera_matrix  intrinsics at the new resolution
+     */
+    bool set_resolution(int nr_rows,
+                        int nr_cols,
+                        const Eigen::Matrix3d& camera_matrix)
+    {
+        cudaStreamSynchronize(cuda_->compute_stream());
+
+        const bool reallocate =
+            !bufferConfig_->fits_allocation(nr_rows, nr_cols);
+        if (reallocate) unregister_resource();
+
+        camera_matrix_ = camera_matrix;
+        nr_rows_ = nr_rows;
+        nr_cols_ = nr_cols;
+
+        int tmp_max_nr_poses;
+        if (!bufferConfig_->set_resolution(
+                nr_rows_, nr_cols_, tmp_max_nr_poses))
         {
             exit(-1);
         }
+        nr_max_poses_ = tmp_max_nr_poses;
+        opengl_->set_camera_matrix(camera_matrix_.cast<float>());
+        if (reallocate) register_resource();
+
+        if (cuda_rasterizer_)
+        {
+            cuda_rasterizer_->set_resolution(
+                nr_rows_, nr_cols_, rasterizer_camera());
+            if (reallocate) allocate_cuda_rasterizer();
+        }
+        depth_rendered_ = false;
+
+        {
+            // a prefetched observation has the old resolution
+            std::lock_guard<std::mutex> lock(pipeline_mutex_);
+            observation_prefetched_ = false;
+        }
+        observations_set_ = false;
+
+        region_of_interest_ = RegionOfInterest(nr_rows_, nr_cols_);
+        occlusion_probs_.resize(nr_rows_ * nr_cols_);
+        if (nr_poses_ > nr_max_poses_) nr_poses_ = nr_max_poses_;
+        reset();
+        return true;
+    }
+
+    /**
+     * \brief Renders the poses with CudaRasterizer into device memory
+     *        instead of with OpenGL, such that the rendering and the weighing
+     *        run on the compute stream without mapping a texture in between.
+     *        OpenGL still sizes the buffers of the poses.
+     *
+     * \param fused  renders every pose within the likelihood kernel instead,
+     *               see CudaEvaluator::map_geometry(). Frames whose
+     *               evaluation region does not fit into shared memory are
+     *               rendered into the depth buffer as without.
+     */
+    void set_cuda_rasterization(bool enable, bool fused = false)
+    {
+        fused_evaluation_ = enable && fused;
+
+        if (!enable)
+        {
+            if (cuda_rasterizer_)
+            {
+                cudaStreamSynchronize(cuda_->compute_stream());
+                cuda_->unmap_texture();
+                cuda_rasterizer_.reset();
+            }
+            return;
+        }
+        if (cuda_rasterizer_) return;
+
+        // the levels are concatenated like in ObjectRasterizer
+        CudaRasterizer::Mesh mesh;
+        const auto& levels = mesh_levels_.levels();
+        mesh.triangle_begin.resize(levels.size());
+        mesh.triangle_count.resize(levels.size());
+        for (size_t l = 0; l < levels.size(); l++)
+        {
+            const FlatMesh& level = *levels[l];
+            const std::uint32_t first_vertex = mesh.positions.size() / 3;
+            const int first_triangle = mesh.indices.size() / 3;
+
+            mesh.positions.insert(mesh.positions.end(),
+                                  level.positions().begin(),
+                                  level.positions().end());
+            for (auto index : level.indices())
+            {
+                mesh.indices.push_back(first_vertex + index);
+            }
+            for (int i = 0; i < level.part_count(); i++)
+            {
+                mesh.triangle_begin[l].push_back(first_triangle +
+                                                 level.triangle_begin(i));
+                mesh.triangle_count[l].push_back(level.triangle_end(i) -
+                                                 level.triangle_begin(i));
+            }
+        }
+
+        cuda_rasterizer_ = boost::shared_ptr<CudaRasterizer>(new CudaRasterizer(
+            mesh, rasterizer_camera(), nr_rows_, nr_cols_));
+        allocate_cuda_rasterizer();
+    }
+
+    /**
+     * \brief Evaluates the poses with resident warps which only visit the
+     *        projected bounding boxes of the poses, see
+     *        CudaEvaluator::set_persistent_evaluation()
+     */
+    void set_persistent_evaluation(bool persistent)
+    {
+        cuda_->set_persistent_evaluation(persistent);
+    }
+
+    /**
+     * \brief Only writes the tiles of the stored occlusions which the poses
+     *        can cover on an update, see
+     *        CudaEvaluator::set_incremental_occlusions()
+     */
+    void set_incremental_occlusions(bool incremental)
+    {
+        cuda_->set_incremental_occlusions(incremental);
+    }
+
+    /** \brief Maximum number of poses evaluated in one call */
+    int max_sample_count() const { return nr_max_poses_; }
+
+    /**
+     * \brief Occlusion probabilities of every pixel kept in the slot which
+     *        occlusion indices refer to
+     */
+    std::vector<float> occlusion_probabilities(int slot)
+    {
+        return cuda_->get_occlusion_probabilities(slot);
+    }
+
+    /**
+     * \brief Overwrites the occlusions of the slot with those of another
+     *        sensor, see occlusion_probabilities()
+     */
+    void set_occlusion_probabilities(int slot,
+                                     const std::vector<float>& probabilities)
+    {
+        cuda_->set_occlusion_probabilities(slot, probabilities.data());
+    }
+
+    /**
+     * \brief Overwrites the occlusions of several slots in one copy, the
+     *        images of the slots are given back to back
+     */
+    void set_occlusion_probabilities(const std::vector<int>& slots,
+                                     const std::vector<float>& probabilities)
+    {
+        cuda_->set_occlusion_probabilities(
+            slots.data(), slots.size(), probabilities.data());
+    }
+
+    /**
+     * \brief Converts and uploads the next observation image while the
+     *        current frame may still be evaluated on another thread. The
+     *        next set_observation() call then only activates this image,
+     *        hence it has to be called with the same image. Requires
+     *        set_pipelining(true).
+     */
+    void prefetch_observation(const Observation& image)
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        upload(image);
+        observation_prefetched_ = true;
+    }
+
+    void prefetch_observation(const DepthImageView& image)
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        upload(image);
+        observation_prefetched_ = true;
+    }
+
+    /** \brief Resets the occlusion probabilities and observation time */
+    virtual void reset()
+    {
+        cuda_->reset_occlusion_probabilities();
+        region_of_interest_.reset();
+        device_weights_reset_ = true;
+
+        observation_time_ = 0;
+    }
+
+    /** activates automatic optimization of the number of threads */
+    void set_optimization_of_thread_nr(bool shouldOptimize)
+    {
+        optimize_nr_threads_ = shouldOptimize;
+    }
+
+    /**
+     * \brief Uses the number of threads cached for this device, resolution
+     *        and maximum number of poses. If there is no entry, the number of
+     *        threads is optimized over the next frames and the result is
+     *        stored in the cache. The thread count only changes the
+     *        scheduling, not the likelihoods.
+     *
+     * \param [in] cache_path path of the cache file, see
+     *        LaunchConfigurationCache::default_path()
+     */
+    void set_thread_tuning_cache(const std::string& cache_path)
+    {
+        thread_tuning_cache_ = cache_path;
+
+        int cached_nr_threads;
+        LaunchConfigurationCache cache(cache_path);
+        if (cache.find(thread_tuning_key(), cached_nr_threads))
+        {
+            int tmp_nr_threads;
+            if (!bufferConfig_->set_number_of_threads(cached_nr_threads,
+                                                      tmp_nr_threads))
+            {
+                exit(-1);
+            }
+            nr_threads_ = tmp_nr_threads;
+            optimize_nr_threads_ = false;
+            return;
+        }
+
+        optimize_nr_threads_ = true;
+        start_thread_optimization();
+    }
+
+    /**
+     * \brief Returns the occlusion probabilities for each pixel for a given
+     * state
+     *
+     * \param [in] index the index into the state array of the state you are
+     * interested in
+     * \return the occlusion probabilities for each pixel for the given state
+     */
+    Observation get_occlusions(size_t index) const
+    {
+        std::vector<float> occlusion_probs =
+            cuda_->get_occlusion_probabilities((int)index);
+
+        return Eigen::Map<Eigen::VectorXf>(occlusion_probs.data(),
+                                           occlusion_probs.size())
+            .template cast<Scalar>();
+    }
+
+    /**
+     * \brief Returns the depth values of the rendered states, one image per
+     *        pose of the last evaluation. Blocks until they are read back,
+     *        see copy_range_images() for a non blocking alternative.
+     */
+    std::vector<Observation> get_range_image()
+    {
+        std::vector<std::vector<float>> depth_values =
+            opengl_->get_depth_values(nr_poses_);
+
+        std::vector<Observation> range_images(depth_values.size());
+        for (size_t i = 0; i < depth_values.size(); i++)
+        {
+            range_images[i] = Eigen::Map<Eigen::VectorXf>(
+                                  depth_values[i].data(),
+                                  depth_values[i].size())
+                                  .template cast<Scalar>();
+        }
+        return range_images;
+    }
+
+    /**
+     * \brief Issues the copy of the depth images of the given poses of the
+     *        last evaluation into the buffer and returns without waiting for
+     *        it, e.g. for the best_indices() of the weights. Works with
+     *        either rasterizer.
+     */
+    void copy_range_images(const std::vector<int>& poses,
+                           PinnedImageBuffer& buffer)
+    {
+        float* images = buffer.begin_copy(poses);
+        cudaStream_t stream = cuda_->compute_stream();
 
-        // sets the resolution and rearranges the pose grid accordingly
-        if (bufferConfig_->set_resolution(nr_rows_, nr_cols_, tmp_max_nr_poses))
+        if (cuda_rasterizer_)
         {
-            nr_max_poses_ = tmp_max_nr_poses;
+            // the fused evaluation never wrote the depth to global memory
+            if (!depth_rendered_)
+            {
+                cuda_rasterizer_->render(rendered_geometry_, nr_poses_, stream);
+                depth_rendered_ = true;
+            }
+            cuda_->map_depth_buffer(cuda_rasterizer_->depth_buffer(),
+                                    cuda_rasterizer_->depth_pitch(),
+                                    cuda_rasterizer_->depth_width(),
+                                    cuda_rasterizer_->depth_height());
+            cuda_->copy_depth_images(poses.data(), poses.size(), images);
         }
         else
         {
-            exit(-1);
+            // the texture keeps the rendering until the next evaluation
+            cudaGraphicsMapResources(1, &texture_resource_, stream);
+            cudaGraphicsSubResourceGetMappedArray(
+                &texture_array_, texture_resource_, 0, 0);
+            cuda_->map_texture_to_texture_array(texture_array_);
+            cuda_->copy_depth_images(poses.data(), poses.size(), images);
+            cudaGraphicsUnmapResources(1, &texture_resource_, stream);
         }
 
-        register_resource();
-
-        reset();
-
-        count_ = 0;
+        buffer.end_copy(stream);
+    }
 
-        occlusion_probs_.resize(nr_rows_ * nr_cols_);
+    /**
+     * \brief Issues the copy of the occlusion probabilities of the given
+     *        slots, which occlusion indices refer to, into the buffer and
+     *        returns without waiting for it
+     */
+    void copy_occlusions(const std::vector<int>& slots,
+                         PinnedImageBuffer& buffer)
+    {
+        float* images = buffer.begin_copy(slots);
+        cuda_->copy_occlusion_probabilities(slots.data(), slots.size(), images);
+        buffer.end_copy(cuda_->compute_stream());
+    }
 
-#ifdef PROFILING_ACTIVE
-        for (int i = 0; i < NR_SUBTASKS_TO_MEASURE; i++)
-        {
-            time_[i] = 0;
-        }
-        strings_for_subtasks_[SET_OCCLUSION_INDICES] =
-            "Setting occlusion indices";
-        strings_for_subtasks_[CONVERTING_STATE_FORMAT] =
-            "Converting state format";
-        strings_for_subtasks_[RENDERING] = "Rendering step";
-        strings_for_subtasks_[MAPPING] =
-            "Mapping the texture from OpenGL to CUDA";
-        strings_for_subtasks_[WEIGHTING] = "Weighting step";
-        strings_for_subtasks_[UNMAPPING] =
-            "Unmapping the texture and reconverting the likelihoods";
-#endif
+    /**
+     * \brief Starts reading back the depth values of the rendered states
+     *        without blocking, poll_range_image() returns them on a later
+     *        frame. Meant for debugging views which must not stall tracking.
+     */
+    void request_range_image() { opengl_->request_depth_values(nr_poses_); }
 
-        optimize_nr_threads_ = false;
+    /**
+     * \brief The depth values of the newest finished request, one image per
+     *        state
+     *
+     * \return false if no request has finished yet
+     */
+    bool poll_range_image(std::vector<Observation>& range_images)
+    {
+        std::vector<std::vector<float>> depth_values;
+        if (!opengl_->poll_depth_values(depth_values)) return false;
 
-#ifdef OPTIMIZE_NR_THREADS
-        set_optimization_of_thread_nr(true);
-#endif
-        if (optimize_nr_threads_)
+        range_images.resize(depth_values.size());
+        for (size_t i = 0; i < depth_values.size(); i++)
         {
-            max_nr_threads_ = cuda_->get_max_nr_threads();
-            warp_size_ = cuda_->get_warp_size();
-            nr_threads_ = warp_size_;
-            best_time_ = std::numeric_limits<double>::infinity();
-            best_nr_threads_ = nr_threads_;
-            average_time_ = 0;
+            range_images[i] =
+                Eigen::Map<Eigen::MatrixXf>(
+                    depth_values[i].data(), nr_rows_, nr_cols_)
+                    .template cast<Scalar>();
         }
+        return true;
+    }
 
-        optimization_runs_ = 0;
+    /** \brief The destructor */
+    virtual ~KinectImageModelGPU() noexcept
+    {
+        unregister_resource();
+        destroy_trace_events();
     }
 
+private:
+    Eigen::Matrix3d camera_matrix_;
+    int nr_rows_;
+    int nr_cols_;
+    int nr_max_poses_;
+    // number of poses requested on construction, nr_max_poses_ may be less
+    int requested_max_poses_;
+
     /**
-     * \brief computes the loglikelihoods for the given states
-     * Make sure the observation image was set previously, as it is used for
-     * comparison.
-     * \param [in] deltas the states which should be evaluated
-     * \param [in][out] occlusion_indices for each state, this should contain
-     * the index into the occlusion array where the corresponding occlusion
-     * probabilities per pixel are stored
-     * \param [in] update_occlusions whether or not the occlusions should be
-     * updated in this evaluation step
-     * \return the loglikelihoods for the given states
+     * \brief Starts timing the stages of an evaluation, the runs of the
+     *        thread count optimization are not measured
      */
-    RealArray loglikes(const StateArray& deltas,
-                       IntArray& occlusion_indices,
-                       const bool& update_occlusions = false)
+    void restart_stopwatch()
     {
-#ifdef PROFILING_ACTIVE
-        if (!optimize_nr_threads_ && optimization_runs_ != count_)
+        if (optimize_nr_threads_)
         {
-            time_before_ = dbot::hf::get_wall_time();
+            stopwatch_.stop();
         }
-#endif
-
-        if (!observations_set_)
+        else
         {
-            std::cout << "GPU: observations not set" << std::endl;
-            exit(-1);
+            stopwatch_.restart();
         }
+    }
 
-        nr_poses_ = deltas.size();
-        std::vector<float> flog_likelihoods(nr_poses_, 0);
+    void set_nr_of_poses(const int nr_poses)
+    {
+        nr_poses_ = nr_poses;
 
         int tmp_nr_poses;
         if (bufferConfig_->set_nr_of_poses(nr_poses_, tmp_nr_poses))
@@ -342,66 +1069,148 @@ public:
         {
             exit(-1);
         }
+    }
 
-        // transform occlusion indices from size_t to int
-        std::vector<int> occlusion_indices_transformed(occlusion_indices.size(),
-                                                       0);
-        for (size_t i = 0; i < occlusion_indices.size(); i++)
+    /**
+     * \brief Renders the given states and weighs them against the current
+     *        observation. The log likelihoods are copied into
+     *        log_likelihoods, or are left on the device if it is null.
+     */
+    void render_and_weigh(const StateArray& deltas,
+                          const bool update_occlusions,
+                          std::vector<float>* log_likelihoods)
+    {
+        // known at compile time for fixed size states
+        const int nr_objects = State::BODY_COUNT == Eigen::Dynamic
+                                   ? int(box_corners_.size())
+                                   : int(State::BODY_COUNT);
+
+        // the poses are converted straight into the upload buffer of the
+        // renderer. The footprint, the conservative image region covered by
+        // any of the poses, is accumulated on the way.
+        float* model_matrices =
+            cuda_rasterizer_ ? cuda_rasterizer_->begin_pose_upload(nr_poses_)
+                             : opengl_->begin_pose_upload(nr_poses_);
+        ImageRegion footprint;
+
+        // all poses of an object are drawn with the finest level of detail
+        // any of them needs
+        std::vector<int> levels(nr_objects, mesh_levels_.level_count() - 1);
+
+        // the upload buffer may be write combined, the matrices are not
+        // read back from it
+        composition_.base_poses(this->default_poses_);
+        Eigen::Matrix4d homogeneous;
+        const bool persistent = cuda_->persistent_evaluation();
+        if (persistent) pose_regions_.resize(nr_poses_);
+        for (size_t i_state = 0; i_state < size_t(nr_poses_); i_state++)
         {
-            occlusion_indices_transformed[i] = (int)occlusion_indices[i];
-        }
+            ImageRegion pose_region;
+            for (size_t i_obj = 0; i_obj < nr_objects; i_obj++)
+            {
+                composition_.compose(
+                    deltas[i_state], i_obj, homogeneous.data());
+                Eigen::Map<Eigen::Matrix4f>(
+                    model_matrices + (i_state * nr_objects + i_obj) * 16) =
+                    homogeneous.cast<float>();
+
+                pose_region = pose_region.unite(
+                    projected_region(box_corners_[i_obj],
+                                     homogeneous.topLeftCorner(3, 3),
+                                     homogeneous.topRightCorner(3, 1),
+                                     camera_matrix_,
+                                     nr_rows_,
+                                     nr_cols_));
+
+                levels[i_obj] = std::min(
+                    levels[i_obj],
+                    mesh_levels_.select(i_obj,
+                                        homogeneous.topLeftCorner(3, 3),
+                                        homogeneous.topRightCorner(3, 1),
+                                        camera_matrix_));
+            }
 
-        // copy occlusion indices to GPU
-        cuda_->set_occlusion_indices(occlusion_indices_transformed.data(),
-                                     occlusion_indices.size());
+            footprint = footprint.unite(pose_region);
+            if (persistent) pose_regions_[i_state] = pixel_region(pose_region);
+        }
+        if (persistent)
+        {
+            cuda_->set_pose_regions(pose_regions_.data(), nr_poses_);
+        }
+        if (cuda_rasterizer_)
+        {
+            cuda_rasterizer_->set_levels(levels);
+        }
+        else
+        {
+            opengl_->set_levels(levels);
+        }
 
-#ifdef PROFILING_ACTIVE
-        store_time(SET_OCCLUSION_INDICES);
-#endif
+        // only the pixels covered by the poses are evaluated and the
+        // occlusions are only kept around them
+        cuda_->set_evaluation_region(pixel_region(footprint));
+        if (update_occlusions)
+        {
+            cuda_->set_occlusion_region(
+                pixel_region(region_of_interest_.update(footprint)));
+        }
 
-        int nr_objects = vertices_.size();
+        stopwatch_.lap(dbot::ProfileStage::Convert);
 
-        std::vector<std::vector<Eigen::Matrix4f>> poses(
-            nr_poses_, std::vector<Eigen::Matrix4f>(nr_objects));
+        // the mapping and the weighing run on the compute stream, CUDA
+        // events time them for the trace
+        const bool traced = dbot::TraceRecorder::recording();
+        cudaEvent_t* trace_events = trace_events_[trace_slot_];
+        if (traced) align_cuda_clock();
 
-        for (size_t i_state = 0; i_state < size_t(nr_poses_); i_state++)
+        if (cuda_rasterizer_)
         {
-            for (size_t i_obj = 0; i_obj < nr_objects; i_obj++)
+            const CudaRasterizer::Geometry geometry =
+                cuda_rasterizer_->upload_poses(nr_poses_,
+                                               cuda_->compute_stream());
+            const bool fused =
+                fused_evaluation_ && cuda_->map_geometry(geometry);
+            rendered_geometry_ = geometry;
+            depth_rendered_ = !fused;
+            if (!fused)
             {
-                auto pose_0 = this->default_poses_.component(i_obj);
-                auto delta = deltas[i_state].component(i_obj);
-
-                dbot::PoseVector pose;
+                cuda_rasterizer_->render(
+                    geometry, nr_poses_, cuda_->compute_stream());
+            }
 
-                /// \todo: this should be done through the the apply_delta
-                /// function
-                pose.position() =
-                    pose_0.orientation().rotation_matrix() * delta.position() +
-                    pose_0.position();
-                pose.orientation() = pose_0.orientation() * delta.orientation();
+            stopwatch_.lap(dbot::ProfileStage::Render);
 
-                poses[i_state][i_obj] = pose.homogeneous().cast<float>();
+            if (traced)
+            {
+                cudaEventRecord(trace_events[0], cuda_->compute_stream());
+            }
+            if (!fused)
+            {
+                cuda_->map_depth_buffer(cuda_rasterizer_->depth_buffer(),
+                                        cuda_rasterizer_->depth_pitch(),
+                                        cuda_rasterizer_->depth_width(),
+                                        cuda_rasterizer_->depth_height());
             }
         }
+        else
+        {
+            opengl_->render_uploaded_poses(nr_poses_);
 
-#ifdef PROFILING_ACTIVE
-        store_time(CONVERTING_STATE_FORMAT);
-#endif
-
-        opengl_->render(poses);
-
-#ifdef PROFILING_ACTIVE
-        store_time(RENDERING);
-#endif
+            stopwatch_.lap(dbot::ProfileStage::Render);
 
-        cudaGraphicsMapResources(1, &texture_resource_, 0);
-        cudaGraphicsSubResourceGetMappedArray(
-            &texture_array_, texture_resource_, 0, 0);
-        cuda_->map_texture_to_texture_array(texture_array_);
+            if (traced)
+            {
+                cudaEventRecord(trace_events[0], cuda_->compute_stream());
+            }
+            cudaGraphicsMapResources(
+                1, &texture_resource_, cuda_->compute_stream());
+            cudaGraphicsSubResourceGetMappedArray(
+                &texture_array_, texture_resource_, 0, 0);
+            cuda_->map_texture_to_texture_array(texture_array_);
+        }
 
-#ifdef PROFILING_ACTIVE
-        store_time(MAPPING);
-#endif
+        stopwatch_.lap(dbot::ProfileStage::Map);
+        if (traced) cudaEventRecord(trace_events[1], cuda_->compute_stream());
 
         if (optimize_nr_threads_)
         {
@@ -429,15 +1238,35 @@ public:
                 std::cout << std::endl
                           << "Best #threads: " << nr_threads_ << std::endl
                           << std::endl;
+
+                // the best setting is used from the next frame on
+                int tmp_nr_threads;
+                bufferConfig_->set_number_of_threads(nr_threads_,
+                                                     tmp_nr_threads);
+                if (!thread_tuning_cache_.empty())
+                {
+                    LaunchConfigurationCache(thread_tuning_cache_)
+                        .store(thread_tuning_key(), nr_threads_);
+                }
             }
         }
 
-        cuda_->weigh_poses(update_occlusions, flog_likelihoods);
+        if (log_likelihoods)
+        {
+            cuda_->weigh_poses(update_occlusions, *log_likelihoods);
+        }
+        else
+        {
+            cuda_->weigh_poses_on_device(update_occlusions);
+        }
 
         if (optimize_nr_threads_)
         {
             if (nr_threads_ <= max_nr_threads_)
             {
+                // the weights may stay on the device, the kernel has to be
+                // finished for the measurement
+                cudaStreamSynchronize(cuda_->compute_stream());
                 after_weighting_ = dbot::hf::get_wall_time();
                 double time = after_weighting_ - before_weighting_;
                 average_time_ += time;
@@ -458,222 +1287,220 @@ public:
             }
         }
 
-#ifdef PROFILING_ACTIVE
-        store_time(WEIGHTING);
-#endif
+        stopwatch_.lap(dbot::ProfileStage::Weigh);
 
-        cudaGraphicsUnmapResources(1, &texture_resource_, 0);
+        if (traced)
+        {
+            cudaEventRecord(trace_events[2], cuda_->compute_stream());
+            trace_events_pending_[trace_slot_] = true;
+        }
+        trace_slot_ = 1 - trace_slot_;
+        store_cuda_spans();
 
-        if (update_occlusions)
+        if (!cuda_rasterizer_)
         {
-            for (size_t i_state = 0; i_state < occlusion_indices.size();
-                 i_state++)
-                occlusion_indices[i_state] = i_state;
+            cudaGraphicsUnmapResources(
+                1, &texture_resource_, cuda_->compute_stream());
+        }
+    }
+
+    void create_trace_events()
+    {
+        for (int slot = 0; slot < 2; slot++)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                cudaEventCreate(&trace_events_[slot][i]);
+            }
+            trace_events_pending_[slot] = false;
         }
+        cudaEventCreate(&cuda_clock_origin_);
+        cuda_clock_host_time_ = 0;
+        cuda_clock_generation_ = 0;
+        trace_slot_ = 0;
+    }
 
-        // convert
-        RealArray log_likelihoods(flog_likelihoods.size());
-        for (size_t i = 0; i < flog_likelihoods.size(); i++)
-            log_likelihoods[i] = flog_likelihoods[i];
+    void destroy_trace_events()
+    {
+        for (int slot = 0; slot < 2; slot++)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                cudaEventDestroy(trace_events_[slot][i]);
+            }
+        }
+        cudaEventDestroy(cuda_clock_origin_);
+    }
 
-#ifdef PROFILING_ACTIVE
-        store_time(UNMAPPING);
-#endif
+    /**
+     * \brief Records the origin of the CUDA event times at the start of a
+     *        recording. This waits for the compute stream once.
+     */
+    void align_cuda_clock()
+    {
+        const std::uint64_t generation = dbot::TraceRecorder::generation();
+        if (cuda_clock_generation_ == generation) return;
+        cuda_clock_generation_ = generation;
 
-        count_++;
-        return log_likelihoods;
+        cudaEventRecord(cuda_clock_origin_, cuda_->compute_stream());
+        cudaEventSynchronize(cuda_clock_origin_);
+        cuda_clock_host_time_ = dbot::TraceRecorder::now();
+
+        // events of a previous recording are not comparable to the origin
+        trace_events_pending_[0] = trace_events_pending_[1] = false;
     }
 
     /**
-     * \brief Sets the observation image that should be used for comparison in
-     * the
-     * next evaluation step
-     *
-     * \param [in] image the image obtained from the camera
+     * \brief Traces the mapping and weighing of the previous evaluation if
+     *        the GPU has finished it, like the GL timer queries of the
+     *        rasterizer this never waits
      */
-    void set_observation(const Observation& image)
+    void store_cuda_spans()
     {
-        std::vector<float> std_measurement(image.size());
+        cudaEvent_t* trace_events = trace_events_[trace_slot_];
+        if (!trace_events_pending_[trace_slot_]) return;
+        if (cudaEventQuery(trace_events[2]) != cudaSuccess) return;
+        trace_events_pending_[trace_slot_] = false;
 
-        for (int i = 0; i < image.size(); ++i)
+        float milliseconds[3];
+        for (int i = 0; i < 3; i++)
         {
-            std_measurement[i] = image(i);
+            cudaEventElapsedTime(
+                &milliseconds[i], cuda_clock_origin_, trace_events[i]);
         }
 
-        observation_time_ += this->delta_time_;
-
-        cuda_->set_observations(std_measurement.data(), observation_time_);
-        observations_set_ = true;
+        static const char* names[2] = {"map", "weigh"};
+        for (int i = 0; i < 2; i++)
+        {
+            dbot::TraceRecorder::span(
+                names[i],
+                "gpu",
+                cuda_clock_host_time_ + milliseconds[i] * 1e3,
+                (milliseconds[i + 1] - milliseconds[i]) * 1e3,
+                dbot::TraceRecorder::CudaTrack);
+        }
     }
 
-    /** \brief Resets the occlusion probabilities and observation time */
-    virtual void reset()
+    void start_thread_optimization()
     {
-        float default_occlusion_probability = initial_occlusion_prob_;
-        int array_size = nr_rows_ * nr_cols_ * nr_max_poses_;
-
-        std::vector<float> occlusion_probabilities(
-            array_size, default_occlusion_probability);
-
-        cuda_->set_occlusion_probabilities(occlusion_probabilities.data(),
-                                           array_size);
-        //        cuda_->set_occlusion_probabilities(NULL);
+        max_nr_threads_ = cuda_->get_max_nr_threads();
+        warp_size_ = cuda_->get_warp_size();
+        nr_threads_ = warp_size_;
+        best_time_ = std::numeric_limits<double>::infinity();
+        best_nr_threads_ = nr_threads_;
+        average_time_ = 0;
+    }
 
-        observation_time_ = 0;
+    std::string thread_tuning_key()
+    {
+        return LaunchConfigurationCache::key(
+            cuda_->get_device_properties().name,
+            nr_rows_,
+            nr_cols_,
+            nr_max_poses_);
     }
 
-    /** activates automatic optimization of the number of threads */
-    void set_optimization_of_thread_nr(bool shouldOptimize)
+    static CudaEvaluator::PixelRegion pixel_region(const ImageRegion& region)
     {
-        optimize_nr_threads_ = shouldOptimize;
+        CudaEvaluator::PixelRegion pixel_region = {
+            region.row, region.col, region.rows, region.cols};
+        return pixel_region;
     }
 
     /**
-     * \brief Returns the occlusion probabilities for each pixel for a given
-     * state
-     *
-     * \param [in] index the index into the state array of the state you are
-     * interested in
-     * \return an Eigen Matrix containing the occlusion probabilities for each
-     * pixel for the given state
+     * \brief Uploads the image unless it has been prefetched and makes it
+     *        the current observation
      */
-    const Eigen::Map<Observation> get_occlusions(size_t index) const
+    template <typename Image>
+    void activate_observation(const Image& image)
     {
-        std::vector<float> occlusion_probs =
-            cuda_->get_occlusion_probabilities((int)index);
-
-        // convert values to doubles and put them into an Eigen Matrix
-        std::vector<double> occlusion_probs_double(occlusion_probs.begin(),
-                                                   occlusion_probs.end());
-        Eigen::Map<Observation> occlusion_probs_matrix(
-            &occlusion_probs_double[0], nr_rows_, nr_cols_);
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        if (!observation_prefetched_) upload(image);
+        observation_prefetched_ = false;
 
-        return occlusion_probs_matrix;
+        observation_time_ += this->delta_time_;
+        cuda_->activate_observation(observation_time_);
+        observations_set_ = true;
     }
 
     /**
-     * \brief Returns the depth values of the rendered states
-     *
-     * \return an Eigen Matrix containing the depth values per pixel, stored in
-     * a 1D array denoting the respective pose
-      */
-    std::vector<Eigen::Map<Observation>> get_range_image()
+     * \brief Converts the image straight into the pinned staging memory and
+     *        issues the asynchronous upload
+     */
+    template <typename Image>
+    void upload(const Image& image)
     {
-        std::vector<std::vector<float>> depth_values_raw =
-            opengl_->get_depth_values(nr_poses_);
-
-        // convert depth values to doubles
-        std::vector<std::vector<double>> depth_values_raw_double;
-        for (int i = 0; i < depth_values_raw.size(); i++)
+        float* staging = cuda_->begin_observation_upload();
+        for (int i = 0; i < image.size(); ++i)
         {
-            depth_values_raw_double.push_back(std::vector<double>(
-                depth_values_raw[i].begin(), depth_values_raw[i].end()));
+            staging[i] = image(i);
         }
+        cuda_->end_observation_upload();
+    }
 
-        // map values into an Eigen Matrix
-        std::vector<Eigen::Map<Observation>> depth_values;
-
-        for (int i = 0; i < depth_values_raw.size(); i++)
+    void check_cuda_error(const char* msg)
+    {
+        cudaError_t err = cudaGetLastError();
+        if (cudaSuccess != err)
         {
-            Eigen::Map<Observation> tmp(
-                &depth_values_raw_double[i][0], nr_rows_, nr_cols_);
-            depth_values.push_back(tmp);
+            fprintf(
+                stderr, "Cuda error: %s: %s.\n", msg, cudaGetErrorString(err));
+            exit(EXIT_FAILURE);
         }
-
-        return depth_values;
     }
 
-    /** \brief The destructor. If profiling is activated, the time measurements
-     * are
-     * processed and printed out here */
-    virtual ~KinectImageModelGPU() noexcept
+    /**
+     * \brief Allocates the memory and sets the dimensions of how many poses
+     *        will be rendered per row and per column in the texture
+     */
+    void allocate_memory()
     {
-        unregister_resource();
-
-#ifdef PROFILING_ACTIVE
-
-        count_ -= optimization_runs_;
-        if (count_ > 0)
+        int tmp_max_nr_poses;
+        if (bufferConfig_->allocate_memory(nr_max_poses_, tmp_max_nr_poses))
         {
-            std::cout << std::endl
-                      << "Time measurements for the different steps of the "
-                         "evaluation process averaged over "
-                      << count_ << " evaluation calls:" << std::endl
-                      << std::endl;
-
-            double total_time_per_evaluation = 0;
-            for (int i = 0; i < NR_SUBTASKS_TO_MEASURE; i++)
-            {
-                total_time_per_evaluation += time_[i];
-            }
-            total_time_per_evaluation /= count_;
-
-            for (int i = 0; i < NR_SUBTASKS_TO_MEASURE; i++)
-            {
-                std::cout << strings_for_subtasks_[i] << ": \t"
-                          << time_[i] / count_ << " s \t "
-                          << std::setprecision(1)
-                          << time_[i] / count_ * 100 / total_time_per_evaluation
-                          << " %" << std::setprecision(9) << std::endl;
-            }
-            std::cout << "Total time per evaluation call: "
-                      << total_time_per_evaluation << std::endl;
-
-            if (optimization_runs_ > 0)
-            {
-                std::cout << std::endl
-                          << "The best number of threads for this setup was "
-                             "estimated to be "
-                          << nr_threads_ << std::endl;
-            }
+            nr_max_poses_ = tmp_max_nr_poses;
         }
         else
         {
-            std::cout << "No measurement for the different steps of the "
-                         "evaluation was taken. "
-                      << "Most likely, you need to deactivate the optimization "
-                         "for #threads or"
-                      << " let the program run for a longer period of time."
-                      << std::endl;
+            exit(-1);
+        }
 
-            if (optimize_nr_threads_ == true)
-            {
-                std::cout << std::endl
-                          << "The best #threads could not be computed, because "
-                             "the runtime of the program was too short."
-                          << " Please allow the program to run a bit longer to "
-                             "find the best #threads."
-                          << std::endl;
-            }
+        // sets the resolution and rearranges the pose grid accordingly
+        if (bufferConfig_->set_resolution(nr_rows_, nr_cols_, tmp_max_nr_poses))
+        {
+            nr_max_poses_ = tmp_max_nr_poses;
+        }
+        else
+        {
+            exit(-1);
         }
-#endif
     }
 
-private:
-    const Eigen::Matrix3d camera_matrix_;
-    int nr_rows_;
-    int nr_cols_;
-    int nr_max_poses_;
-
-    void store_time(int task)
+    /** \brief Camera of the CUDA rasterizer, clipped like the OpenGL one */
+    CudaRasterizer::Camera rasterizer_camera() const
     {
-        if (!optimize_nr_threads_ && optimization_runs_ != count_)
-        {
-            time_after_ = dbot::hf::get_wall_time();
-            time_[task] += time_after_ - time_before_;
-            time_before_ = time_after_;
-        }
+        CudaRasterizer::Camera camera;
+        camera.fx = camera_matrix_(0, 0);
+        camera.fy = camera_matrix_(1, 1);
+        camera.cx = camera_matrix_(0, 2);
+        camera.cy = camera_matrix_(1, 2);
+        camera.near_plane = 0.4;
+        camera.far_plane = 4;
+        return camera;
     }
 
-    void check_cuda_error(const char* msg)
+    /**
+     * \brief Sizes the depth buffer of the CUDA rasterizer like the texture
+     *        of the OpenGL one, which stays allocated
+     */
+    void allocate_cuda_rasterizer()
     {
-        cudaError_t err = cudaGetLastError();
-        if (cudaSuccess != err)
-        {
-            fprintf(
-                stderr, "Cuda error: %s: %s.\n", msg, cudaGetErrorString(err));
-            exit(EXIT_FAILURE);
-        }
+        cudaStreamSynchronize(cuda_->compute_stream());
+        cuda_->unmap_texture();
+        cuda_rasterizer_->allocate_for_max_poses(
+            cuda_->max_nr_poses(),
+            cuda_->max_nr_poses_per_row(),
+            cuda_->max_nr_poses_per_column());
     }
 
     void register_resource()
@@ -694,6 +1521,7 @@ private:
     {
         if (resource_registered_)
         {
+            cuda_->unmap_texture();
             cudaGraphicsUnregisterResource(texture_resource_);
             check_cuda_error("cudaGraphicsUnregisterResource");
             resource_registered_ = false;
@@ -702,14 +1530,24 @@ private:
 
     // OpenGL handle and input
     boost::shared_ptr<ObjectRasterizer> opengl_;
-    std::vector<std::vector<Eigen::Vector3f>> vertices_;
-    std::vector<std::vector<std::vector<int>>> indices_;
     std::string vertex_shader_path_;
     std::string fragment_shader_path_;
 
     // CUDA handle
     boost::shared_ptr<CudaEvaluator> cuda_;
 
+    // renders instead of opengl_ if set, see set_cuda_rasterization()
+    boost::shared_ptr<CudaRasterizer> cuda_rasterizer_;
+    bool fused_evaluation_;
+
+    // poses of the last weighing, whose depth is only in the buffer of the
+    // CUDA rasterizer if depth_rendered_, see copy_range_images()
+    CudaRasterizer::Geometry rendered_geometry_;
+    bool depth_rendered_;
+
+    // projected bounding box of every pose for the persistent evaluation
+    std::vector<CudaEvaluator::PixelRegion> pose_regions_;
+
     // Buffer configuration handle
     boost::shared_ptr<BufferConfiguration> bufferConfig_;
 
@@ -723,6 +1561,15 @@ private:
     float exponential_rate_;
     std::vector<float> occlusion_probs_;
 
+    // region of the image for which occlusions are stored on the GPU
+    RegionOfInterest region_of_interest_;
+    std::vector<std::vector<Eigen::Vector3d>> box_corners_;
+    PoseComposition composition_;
+
+    // levels of detail of the mesh which the rasterizer holds
+    static constexpr int nr_mesh_levels = 4;
+    MeshLevels mesh_levels_;
+
     // amount of poses and pose distribution in the OpenGL texture
     int nr_poses_;
     int nr_poses_per_row_;
@@ -736,20 +1583,31 @@ private:
     // booleans to ensure correct usage of function calls
     bool observations_set_, resource_registered_;
 
-    // used for time observations
-    static const int NR_SUBTASKS_TO_MEASURE = 6;
-    enum subtasks_to_measure
-    {
-        SET_OCCLUSION_INDICES,
-        CONVERTING_STATE_FORMAT,
-        RENDERING,
-        MAPPING,
-        WEIGHTING,
-        UNMAPPING
-    };
-    double time_[NR_SUBTASKS_TO_MEASURE];
-    std::string strings_for_subtasks_[NR_SUBTASKS_TO_MEASURE];
-    double time_before_, time_after_;
+    // asynchronous observation pipeline
+    bool pipelining_;
+    bool observation_prefetched_;
+
+    // float conversion of double precision observations
+    std::vector<float> observation_buffer_;
+
+    // particle weights which are kept on the GPU
+    bool device_weights_;
+    bool device_weights_reset_;
+    std::vector<float> flog_weights_;
+    std::mutex pipeline_mutex_;
+
+    // times the stages of an evaluation
+    dbot::ProfileStopwatch stopwatch_;
+
+    // start of the mapping, start and end of the weighing of the last two
+    // evaluations, timed on the compute stream for the trace
+    cudaEvent_t trace_events_[2][3];
+    bool trace_events_pending_[2];
+    int trace_slot_;
+    // event and host time in us which align the CUDA events to host time
+    cudaEvent_t cuda_clock_origin_;
+    double cuda_clock_host_time_;
+    std::uint64_t cuda_clock_generation_;
     int count_;
 
     // variables for the optimization runs
@@ -767,5 +1625,8 @@ private:
 
     // optional flag for optimizing the #threads
     bool optimize_nr_threads_;
+
+    // file the optimized #threads is stored in, empty if not cached
+    std::string thread_tuning_cache_;
 };
 }
@@ -0,0 +1,136 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file launch_configuration_cache.h
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace dbot
+{
+/**
+ * \brief Persists the tuned number of threads of the evaluation kernel
+ *        across runs.
+ *
+ * The entries are keyed by the device name, the resolution and the maximum
+ * number of poses and stored one per line as "key<TAB>threads" in a text
+ * file. Stores rewrite the file through a temporary file of the process,
+ * such that a concurrently reading process never sees a partial file and
+ * concurrently storing processes do not write into the same one.
+ */
+class LaunchConfigurationCache
+{
+public:
+    explicit LaunchConfigurationCache(const std::string& path) : path_(path) {}
+
+    const std::string& path() const { return path_; }
+
+    /**
+     * \brief Cache file in the home directory, or in the working directory
+     *        if HOME is not set
+     */
+    static std::string default_path()
+    {
+        const char* home = std::getenv("HOME");
+        const std::string file = ".dbot_launch_configurations";
+        return home ? std::string(home) + "/" + file : file;
+    }
+
+    static std::string key(const std::string& device_name,
+                           int nr_rows,
+                           int nr_cols,
+                           int nr_poses)
+    {
+        std::ostringstream key;
+        for (char c : device_name) key << (c == '\t' || c == '\n' ? ' ' : c);
+        key << " " << nr_rows << "x" << nr_cols << " " << nr_poses;
+        return key.str();
+    }
+
+    /**
+     * \brief Looks up the number of threads, returns false if the key is not
+     *        cached
+     */
+    bool find(const std::string& key, int& nr_threads) const
+    {
+        const std::map<std::string, int> entries = load();
+        auto entry = entries.find(key);
+        if (entry == entries.end()) return false;
+
+        nr_threads = entry->second;
+        return true;
+    }
+
+    /**
+     * \brief Adds or replaces the entry, returns false if the file cannot be
+     *        written
+     */
+    bool store(const std::string& key, int nr_threads) const
+    {
+        std::map<std::string, int> entries = load();
+        entries[key] = nr_threads;
+
+        const std::string tmp_path =
+            path_ + "." + std::to_string(getpid()) + ".tmp";
+        {
+            std::ofstream file(tmp_path.c_str());
+            if (!file) return false;
+            for (const auto& entry : entries)
+            {
+                file << entry.first << "\t" << entry.second << "\n";
+            }
+            if (!file)
+            {
+                std::remove(tmp_path.c_str());
+                return false;
+            }
+        }
+
+        if (std::rename(tmp_path.c_str(), path_.c_str()) != 0)
+        {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::map<std::string, int> load() const
+    {
+        std::map<std::string, int> entries;
+        std::ifstream file(path_.c_str());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const size_t tab = line.rfind('\t');
+            if (tab == std::string::npos) continue;
+
+            const int nr_threads = std::atoi(line.c_str() + tab + 1);
+            if (nr_threads > 0) entries[line.substr(0, tab)] = nr_threads;
+        }
+        return entries;
+    }
+
+private:
+    std::string path_;
+};
+}
@@ -0,0 +1,99 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file launch_configuration_cache_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include <dbot/gpu/launch_configuration_cache.h>
+
+TEST(LaunchConfigurationCacheTests, stores_and_replaces_entries)
+{
+    const std::string path = "launch_configuration_cache_test.txt";
+    std::remove(path.c_str());
+
+    dbot::LaunchConfigurationCache cache(path);
+    const std::string key_a =
+        dbot::LaunchConfigurationCache::key("GeForce GTX 1080", 60, 80, 200);
+    const std::string key_b =
+        dbot::LaunchConfigurationCache::key("GeForce GTX 1080", 120, 160, 200);
+
+    int nr_threads = 0;
+    EXPECT_FALSE(cache.find(key_a, nr_threads));
+
+    ASSERT_TRUE(cache.store(key_a, 128));
+    ASSERT_TRUE(cache.store(key_b, 256));
+    ASSERT_TRUE(cache.store(key_a, 96));
+
+    // a new instance reads the file written by the first one
+    dbot::LaunchConfigurationCache reloaded(path);
+    ASSERT_TRUE(reloaded.find(key_a, nr_threads));
+    EXPECT_EQ(nr_threads, 96);
+    ASSERT_TRUE(reloaded.find(key_b, nr_threads));
+    EXPECT_EQ(nr_threads, 256);
+
+    std::remove(path.c_str());
+}
+
+TEST(LaunchConfigurationCacheTests, ignores_malformed_lines)
+{
+    const std::string path = "launch_configuration_cache_malformed.txt";
+    {
+        std::ofstream file(path.c_str());
+        file << "no separator\n"
+             << "device 1x1 1\tnot a number\n"
+             << "device 1x1 2\t64\n";
+    }
+
+    dbot::LaunchConfigurationCache cache(path);
+    int nr_threads = 0;
+    EXPECT_FALSE(cache.find("device 1x1 1", nr_threads));
+    ASSERT_TRUE(cache.find("device 1x1 2", nr_threads));
+    EXPECT_EQ(nr_threads, 64);
+
+    std::remove(path.c_str());
+}
+
+TEST(LaunchConfigurationCacheTests, stores_through_a_file_of_the_process)
+{
+    const std::string path = "launch_configuration_cache_process.txt";
+    std::remove(path.c_str());
+
+    // a store of another process in progress under the plain name
+    const std::string other_tmp_path = path + ".tmp";
+    {
+        std::ofstream file(other_tmp_path.c_str());
+        file << "other 1x1 1\t32\n";
+    }
+
+    dbot::LaunchConfigurationCache cache(path);
+    ASSERT_TRUE(cache.store("device 1x1 1", 64));
+
+    int nr_threads = 0;
+    EXPECT_FALSE(cache.find("other 1x1 1", nr_threads));
+    ASSERT_TRUE(cache.find("device 1x1 1", nr_threads));
+    EXPECT_EQ(nr_threads, 64);
+
+    std::ifstream other(other_tmp_path.c_str());
+    std::string line;
+    ASSERT_TRUE(bool(std::getline(other, line)));
+    EXPECT_EQ(line, "other 1x1 1\t32");
+
+    std::remove(path.c_str());
+    std::remove(other_tmp_path.c_str());
+}
@@ -0,0 +1,240 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file multi_gpu_kinect_image_model.h
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <dbot/gpu/kinect_image_model_gpu.h>
+#include <dbot/gpu/particle_sharding.h>
+#include <dbot/model/rao_blackwell_sensor.h>
+#include <dbot/thread_pool.h>
+#include <dbot/trace_recorder.h>
+
+namespace dbot
+{
+/**
+ * \brief Kinect image model which splits the particles over several GPUs.
+ *
+ * Every device has its own KinectImageModelGPU, the shard, with its own
+ * rasterizer, evaluator and occlusion buffers. A shard is created, called
+ * and destroyed on a worker thread of its own, on which its OpenGL context
+ * is current and its CUDA device is selected. The log likelihoods of the
+ * shards are gathered in the order of the particles, see ParticleSharding
+ * for how particles and their occlusions move between the shards.
+ *
+ * The sensor has to be called from the thread which created it, since the
+ * first shard runs on the calling thread. The particle weights are not
+ * kept on the devices.
+ */
+template <typename State>
+class MultiGpuKinectImageModel : public RbSensor<State>
+{
+public:
+    typedef RbSensor<State> Base;
+    typedef KinectImageModelGPU<State> Shard;
+
+    typedef typename Base::Observation Observation;
+    typedef typename Base::StateArray StateArray;
+    typedef typename Base::RealArray RealArray;
+    typedef typename Base::IntArray IntArray;
+
+    /**
+     * \brief Creates the shard of a device, evaluating at most
+     *        max_sample_count poses at once
+     */
+    typedef std::function<std::shared_ptr<Shard>(int device,
+                                                 int max_sample_count)>
+        ShardFactory;
+
+public:
+    /**
+     * \param devices           CUDA ordinals of the GPUs, one shard each
+     * \param max_sample_count  of all shards together
+     * \param part_count        number of objects of the state
+     */
+    MultiGpuKinectImageModel(const std::vector<int>& devices,
+                             int max_sample_count,
+                             int part_count,
+                             const ShardFactory& factory,
+                             double delta_time)
+        : Base(delta_time),
+          workers_(devices.size()),
+          shards_(devices.size()),
+          sharding_(devices.size(),
+                    (max_sample_count + devices.size() - 1) / devices.size()),
+          migrated_slots_(devices.size()),
+          migrated_images_(devices.size()),
+          shard_deltas_(devices.size()),
+          shard_indices_(devices.size()),
+          shard_loglikes_(devices.size())
+    {
+        this->default_poses_.recount(part_count);
+        this->default_poses_.setZero();
+
+        const int slots = sharding_.slots_per_shard();
+        on_shards([&](int shard) {
+            shards_[shard] = factory(devices[shard], slots);
+            if (shards_[shard]->max_sample_count() < slots)
+            {
+                std::cout << "GPU " << devices[shard] << ": only "
+                          << shards_[shard]->max_sample_count() << " of "
+                          << slots << " poses fit" << std::endl;
+                exit(-1);
+            }
+        });
+    }
+
+    /** \brief Destroys the shards in their OpenGL contexts */
+    ~MultiGpuKinectImageModel() noexcept
+    {
+        on_shards([&](int shard) { shards_[shard].reset(); });
+    }
+
+    RealArray loglikes(const StateArray& deltas,
+                       IntArray& occlusion_indices,
+                       const bool& update_occlusions = false)
+    {
+        RealArray log_likelihoods;
+        compute_loglikes(
+            deltas, occlusion_indices, update_occlusions, log_likelihoods);
+        return log_likelihoods;
+    }
+
+    void compute_loglikes(const StateArray& deltas,
+                          IntArray& occlusion_indices,
+                          const bool& update_occlusions,
+                          RealArray& log_likelihoods)
+    {
+        dbot::TraceSpan trace_span("loglikes", "multi_gpu_model");
+
+        const int count = deltas.size();
+        sharding_.assign(occlusion_indices.data(), count);
+
+        // all migrated occlusions are read before any slot is overwritten
+        const auto& migrations = sharding_.migrations();
+        migrated_.resize(migrations.size());
+        on_shards([&](int shard) {
+            for (size_t k = 0; k < migrations.size(); k++)
+            {
+                if (migrations[k].source_shard != shard) continue;
+                migrated_[k] = shards_[shard]->occlusion_probabilities(
+                    migrations[k].source_slot);
+            }
+        });
+
+        // the migrated occlusions of a shard are written in one copy
+        log_likelihoods.resize(count);
+        on_shards([&](int shard) {
+            std::vector<int>& slots = migrated_slots_[shard];
+            std::vector<float>& images = migrated_images_[shard];
+            slots.clear();
+            images.clear();
+            for (size_t k = 0; k < migrations.size(); k++)
+            {
+                if (migrations[k].shard != shard) continue;
+                slots.push_back(migrations[k].slot);
+                images.insert(
+                    images.end(), migrated_[k].begin(), migrated_[k].end());
+            }
+            if (!slots.empty())
+            {
+                shards_[shard]->set_occlusion_probabilities(slots, images);
+            }
+
+            const std::vector<int>& particles = sharding_.particles(shard);
+            const std::vector<int>& shard_slots = sharding_.slots(shard);
+            StateArray& shard_deltas = shard_deltas_[shard];
+            IntArray& shard_indices = shard_indices_[shard];
+            shard_deltas.resize(particles.size());
+            shard_indices.resize(particles.size());
+            for (size_t l = 0; l < particles.size(); l++)
+            {
+                // a dummy particle only keeps the shard in step
+                shard_deltas[l] = deltas[std::max(particles[l], 0)];
+                shard_indices[l] = shard_slots[l];
+            }
+
+            shards_[shard]->integrated_poses() = this->default_poses_;
+            shards_[shard]->compute_loglikes(shard_deltas,
+                                             shard_indices,
+                                             update_occlusions,
+                                             shard_loglikes_[shard]);
+
+            for (size_t l = 0; l < particles.size(); l++)
+            {
+                if (particles[l] < 0) continue;
+                log_likelihoods[particles[l]] = shard_loglikes_[shard][l];
+            }
+        });
+
+        if (update_occlusions)
+        {
+            sharding_.commit_update(count);
+            for (int i = 0; i < count; i++) occlusion_indices[i] = i;
+        }
+    }
+
+    using Base::set_observation;
+
+    void set_observation(const Observation& image)
+    {
+        on_shards([&](int shard) { shards_[shard]->set_observation(image); });
+    }
+
+    void set_observation(const DepthImageView& image)
+    {
+        on_shards([&](int shard) { shards_[shard]->set_observation(image); });
+    }
+
+    void reset()
+    {
+        on_shards([&](int shard) { shards_[shard]->reset(); });
+        sharding_.reset();
+    }
+
+    int device_count() const { return int(shards_.size()); }
+
+    const std::shared_ptr<Shard>& shard(int i) const { return shards_[i]; }
+
+private:
+    /** \brief Runs the function for every shard on the worker of the shard */
+    void on_shards(const std::function<void(int shard)>& function)
+    {
+        workers_.parallel_for(shards_.size(), [&](int begin, int end, int) {
+            for (int shard = begin; shard < end; shard++) function(shard);
+        });
+    }
+
+private:
+    // worker i runs shard i, worker 0 is the calling thread
+    ThreadPool workers_;
+    std::vector<std::shared_ptr<Shard>> shards_;
+    ParticleSharding sharding_;
+
+    // occlusions read from the source shards and gathered, with their
+    // slots, for each destination shard
+    std::vector<std::vector<float>> migrated_;
+    std::vector<std::vector<int>> migrated_slots_;
+    std::vector<std::vector<float>> migrated_images_;
+    std::vector<StateArray> shard_deltas_;
+    std::vector<IntArray> shard_indices_;
+    std::vector<RealArray> shard_loglikes_;
+};
+}
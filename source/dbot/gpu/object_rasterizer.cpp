@@ -19,127 +19,92 @@
 
 #include <Eigen/Geometry>  // there is a clash with Success enum and in X.h
 #include <GL/glew.h>
-#include <GL/glx.h>
+#include <dbot/gpu/gpu_resources.h>
 #include <dbot/gpu/object_rasterizer.h>
-#include <dbot/gpu/shader.h>
 #include <dbot/helper_functions.h>
+#include <dbot/memory_planner.h>
+#include <dbot/profiler.h>
+#include <dbot/trace_recorder.h>
 
 using namespace std;
 using namespace Eigen;
 
+namespace
+{
+/* Vertex shader of the instanced rendering. Instance i draws the current
+ * object in pose i. Its model matrix is fetched from a texture buffer and the
+ * vertex is moved into the tile of the pose in the texture holding all
+ * poses. The clip distances cut the triangles at the tile borders, which is
+ * what the per pose viewport did before. */
+const char* instanced_vertex_shader =
+    "#version 330                                                       \n"
+    "                                                                   \n"
+    "layout(location = 0) in vec3 vertexPosition_modelspace;            \n"
+    "out float depth;                                                   \n"
+    "out float gl_ClipDistance[4];                                      \n"
+    "uniform mat4 P;                                                    \n"
+    "uniform mat4 V;                                                    \n"
+    "uniform samplerBuffer model_matrices;                              \n"
+    "uniform int nr_objects;                                            \n"
+    "uniform int object;                                                \n"
+    "uniform int nr_poses_per_row;                                      \n"
+    "uniform int nr_poses_per_col;                                      \n"
+    "                                                                   \n"
+    "void main() {                                                      \n"
+    "    int matrix = 4 * (gl_InstanceID * nr_objects + object);        \n"
+    "    mat4 M = mat4(texelFetch(model_matrices, matrix),              \n"
+    "                  texelFetch(model_matrices, matrix + 1),          \n"
+    "                  texelFetch(model_matrices, matrix + 2),          \n"
+    "                  texelFetch(model_matrices, matrix + 3));         \n"
+    "                                                                   \n"
+    "    vec4 tmp_position = V * M * vec4(vertexPosition_modelspace, 1);\n"
+    "    depth = tmp_position.z;                                        \n"
+    "    vec4 tile_position = P * tmp_position;                         \n"
+    "                                                                   \n"
+    "    float w = tile_position.w;                                     \n"
+    "    gl_ClipDistance[0] = w + tile_position.x;                      \n"
+    "    gl_ClipDistance[1] = w - tile_position.x;                      \n"
+    "    gl_ClipDistance[2] = w + tile_position.y;                      \n"
+    "    gl_ClipDistance[3] = w - tile_position.y;                      \n"
+    "                                                                   \n"
+    "    // the rows of poses are stacked from the top of the texture   \n"
+    "    int tile_col = gl_InstanceID % nr_poses_per_row;               \n"
+    "    int tile_row = nr_poses_per_col - 1                            \n"
+    "                   - gl_InstanceID / nr_poses_per_row;             \n"
+    "    vec2 scale = 1.0 / vec2(nr_poses_per_row, nr_poses_per_col);   \n"
+    "    vec2 offset = scale * (1 + 2 * vec2(tile_col, tile_row)) - 1;  \n"
+    "    gl_Position = vec4(tile_position.xy * scale + w * offset,      \n"
+    "                       tile_position.zw);                          \n"
+    "}                                                                  \n";
+}
+
 ObjectRasterizer::ObjectRasterizer(
-    const std::vector<std::vector<Eigen::Vector3f>> vertices,
-    const std::vector<std::vector<std::vector<int>>> indices,
+    const std::vector<std::shared_ptr<const dbot::FlatMesh>>& levels,
     const std::shared_ptr<dbot::ShaderProvider>& shader_provider,
     const Eigen::Matrix3f camera_matrix,
     const int nr_rows,
     const int nr_cols,
     const float near_plane,
-    const float far_plane)
+    const float far_plane,
+    const dbot::GlContext::Parameters& context)
     :
 
       nr_rows_(nr_rows),
       nr_cols_(nr_cols),
+      texture_nr_rows_(0),
+      texture_nr_cols_(0),
       near_plane_(near_plane),
       far_plane_(far_plane)
 {
-    // ========== CREATE WINDOWLESS OPENGL CONTEXT =========== //
-
-    typedef GLXContext (*glXCreateContextAttribsARBProc)(
-        Display*, GLXFBConfig, GLXContext, Bool, const int*);
-    typedef Bool (*glXMakeContextCurrentARBProc)(
-        Display*, GLXDrawable, GLXDrawable, GLXContext);
-    static glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
-    static glXMakeContextCurrentARBProc glXMakeContextCurrentARB = 0;
-
-    static int visual_attribs[] = {None};
-    int context_attribs[] = {GLX_CONTEXT_MAJOR_VERSION_ARB,
-                             3,
-                             GLX_CONTEXT_MINOR_VERSION_ARB,
-                             2,
-                             None};
-
-    int fbcount = 0;
-    GLXFBConfig* fbc = NULL;
-    GLXPbuffer pbuf;
-
-    /* open display */
-    if (!(dpy_ = XOpenDisplay(0)))
-    {
-        fprintf(stderr, "Failed to open display\n");
-        exit(1);
-    }
-
-    /* get framebuffer configs, any is usable (might want to add proper attribs)
-     */
-    if (!(fbc = glXChooseFBConfig(
-              dpy_, DefaultScreen(dpy_), visual_attribs, &fbcount)))
-    {
-        fprintf(stderr, "Failed to get FBConfig\n");
-        exit(1);
-    }
-
-    /* get the required extensions */
-    glXCreateContextAttribsARB =
-        (glXCreateContextAttribsARBProc)glXGetProcAddressARB(
-            (const GLubyte*)"glXCreateContextAttribsARB");
-    glXMakeContextCurrentARB =
-        (glXMakeContextCurrentARBProc)glXGetProcAddressARB(
-            (const GLubyte*)"glXMakeContextCurrent");
-    if (!(glXCreateContextAttribsARB && glXMakeContextCurrentARB))
-    {
-        fprintf(stderr, "missing support for GLX_ARB_create_context\n");
-        XFree(fbc);
-        exit(1);
-    }
-
-    /* create a context using glXCreateContextAttribsARB */
-    if (!(ctx_ = glXCreateContextAttribsARB(
-              dpy_, fbc[0], 0, True, context_attribs)))
-    {
-        fprintf(stderr, "Failed to create opengl context\n");
-        XFree(fbc);
-        exit(1);
-    }
-
-    /* create temporary pbuffer */
-    int pbuffer_attribs[] = {
-        GLX_PBUFFER_WIDTH, nr_cols_, GLX_PBUFFER_HEIGHT, nr_rows_, None};
-    pbuf = glXCreatePbuffer(dpy_, fbc[0], pbuffer_attribs);
+    // ========== GET THE WINDOWLESS OPENGL CONTEXT OF THE THREAD ========== //
 
-    XFree(fbc);
-    XSync(dpy_, False);
-
-    /* try to make it the current context */
-    if (!glXMakeContextCurrent(dpy_, pbuf, pbuf, ctx_))
-    {
-        /* some drivers do not support context without default framebuffer, so
-         * fallback on
-         * using the default window.
-         */
-        if (!glXMakeContextCurrent(
-                dpy_, DefaultRootWindow(dpy_), DefaultRootWindow(dpy_), ctx_))
-        {
-            fprintf(stderr, "failed to make current\n");
-            exit(1);
-        }
-    }
-
-    /* try it out */
-    printf("vendor: %s\n", (const char*)glGetString(GL_VENDOR));
+    // the context, GLEW and the compiled programs are shared with the other
+    // rasterizers of this thread and outlive this one
+    dbot::GpuResources& resources = dbot::GpuResources::instance();
+    context_ = resources.context(nr_cols_, nr_rows_, context);
 
     check_GL_errors("init windowsless context");
 
-    // Initialize GLEW
-
-    glewExperimental = true;  // Needed for core profile
-    if (glewInit() != GLEW_OK)
-    {
-        fprintf(stderr, "Failed to initialize GLEW\n");
-        exit(EXIT_FAILURE);
-    }
-    check_GL_errors("GLEW init");
-
     // ======================== SET OPENGL OPTIONS ======================== //
 
     // Enable depth test
@@ -164,38 +129,40 @@ ObjectRasterizer::ObjectRasterizer(
 
     max_texture_size_ = min(max_texture_size, max_renderbuffer_size);
 
-    // ========== CHANGE VERTICES AND INDICES FORMATS SO THAT OPENGL CAN READ
-    // THEM =========== //
+    // ========== CONCATENATE THE FLAT MESHES OF ALL LEVELS OF DETAIL ======= //
 
-    std::vector<int> vertices_per_object;
+    // the indices of a mesh are global within it and are shifted by the
+    // vertices of the previous levels
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        const dbot::FlatMesh& mesh = *levels[l];
+        const uint first_vertex = vertices_list_.size() / 3;
+        const int first_index = indices_list_.size();
+
+        vertices_list_.insert(vertices_list_.end(),
+                              mesh.positions().begin(),
+                              mesh.positions().end());
+        for (uint index : mesh.indices())
+        {
+            indices_list_.push_back(first_vertex + index);
+        }
 
-    for (size_t i = 0; i < vertices.size(); i++)
-    {  // each i equals one object
-        object_numbers_.push_back(i);
-        vertices_per_object.push_back(vertices[i].size());
-        for (size_t j = 0; j < vertices[i].size(); j++)
-        {  // each j equals one vertex in that object
-            for (int k = 0; k < vertices[i][j].size(); k++)
-            {  // each k equals one dimension of that vertex
-                vertices_list_.push_back(vertices[i][j][k]);
-            }
+        level_indices_per_object_.push_back(vector<int>());
+        level_start_position_.push_back(vector<int>());
+        for (int i = 0; i < mesh.part_count(); i++)
+        {  // each i equals one object
+            level_indices_per_object_[l].push_back(
+                3 * (mesh.triangle_end(i) - mesh.triangle_begin(i)));
+            level_start_position_[l].push_back(first_index +
+                                               3 * mesh.triangle_begin(i));
         }
     }
 
-    start_position_.push_back(0);
-    int vertex_count = 0;
-    for (size_t i = 0; i < indices.size(); i++)
-    {  // each i equals one object
-        indices_per_object_.push_back(indices[i].size() * 3);
-        start_position_.push_back(start_position_[i] + indices_per_object_[i]);
-        for (size_t j = 0; j < indices[i].size(); j++)
-        {  // each j equals one triangle in that object
-            for (size_t k = 0; k < indices[i][j].size(); k++)
-            {  // each k equals one index for a vertex in that triangle
-                indices_list_.push_back(indices[i][j][k] + vertex_count);
-            }
-        }
-        vertex_count += vertices_per_object[i];
+    indices_per_object_ = level_indices_per_object_[0];
+    start_position_ = level_start_position_[0];
+    for (size_t i = 0; i < indices_per_object_.size(); i++)
+    {
+        object_numbers_.push_back(i);
     }
 
     // ==================== CREATE AND FILL VAO, VBO & element array
@@ -240,6 +207,9 @@ ObjectRasterizer::ObjectRasterizer(
     // create PBO that will be used for copying the depth values to the CPU, if
     // requested
     glGenBuffers(1, &result_buffer_);
+    glGenBuffers(NR_READBACK_BUFFERS, readback_buffers_);
+    readback_slot_ = 0;
+    for (int i = 0; i < NR_READBACK_BUFFERS; i++) readback_fences_[i] = 0;
 
     // ======================= CREATE FRAMEBUFFER OBJECT AND ITS TEXTURES
     // ======================= //
@@ -263,13 +233,63 @@ ObjectRasterizer::ObjectRasterizer(
 
     // ================= COMPILE SHADERS AND GET HANDLES ================= //
 
-    // Create and compile our GLSL program from the shaders
-    shader_ID_ = LoadShaders(shader_provider);
+    // Create and compile our GLSL program from the shaders, unless another
+    // rasterizer already did
+    std::vector<dbot::ShaderSource> sources;
+    sources.push_back({GL_VERTEX_SHADER, shader_provider->vertex_shader()});
+    if (shader_provider->has_geometry_shader())
+    {
+        sources.push_back(
+            {GL_GEOMETRY_SHADER, shader_provider->geometry_shader()});
+    }
+    sources.push_back(
+        {GL_FRAGMENT_SHADER, shader_provider->fragment_shader()});
+    shader_ID_ = resources.program(*context_, sources);
 
     // Set up handles for uniforms
     model_view_matrix_ID_ = glGetUniformLocation(shader_ID_, "MV");
     projection_matrix_ID_ = glGetUniformLocation(shader_ID_, "P");
 
+    // the instanced rendering replaces the vertex shader of the provider. A
+    // geometry shader would expect the outputs of that vertex shader, hence
+    // these providers keep drawing every pose separately.
+    instanced_ = !shader_provider->has_geometry_shader();
+    sources.front() = {GL_VERTEX_SHADER, instanced_vertex_shader};
+    sources.erase(sources.begin() + 1, sources.end() - 1);
+    instanced_shader_ID_ = resources.program(*context_, sources);
+
+    instanced_projection_matrix_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "P");
+    instanced_view_matrix_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "V");
+    instanced_nr_objects_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "nr_objects");
+    instanced_object_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "object");
+    instanced_poses_per_row_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "nr_poses_per_row");
+    instanced_poses_per_col_ID_ =
+        glGetUniformLocation(instanced_shader_ID_, "nr_poses_per_col");
+
+    glUseProgram(instanced_shader_ID_);
+    glUniform1i(glGetUniformLocation(instanced_shader_ID_, "model_matrices"),
+                0);
+
+    // the model matrices of all poses are read from texture buffers, four
+    // RGBA texels per matrix. Persistently mapped buffers need
+    // ARB_buffer_storage, otherwise the poses are staged on the host.
+    persistent_mapping_ = GLEW_ARB_buffer_storage;
+    glGenTextures(NR_POSE_BUFFERS, pose_textures_);
+    for (int i = 0; i < NR_POSE_BUFFERS; i++)
+    {
+        pose_buffers_[i] = 0;
+        mapped_poses_[i] = NULL;
+        pose_fences_[i] = 0;
+    }
+    pose_slot_ = 0;
+    nr_objects_ = indices_per_object_.size();
+    check_GL_errors("instanced rendering setup");
+
     /* The view matrix is constant throughout this class since we are not
        changing the camera position.
        If you are looking to pass a different camera matrix for each render
@@ -290,25 +310,21 @@ ObjectRasterizer::ObjectRasterizer(
 // ========== INITIALIZE & SET DEFAULTS FOR MEASURING EXECUTION TIMES
 // =========== //
 
-#ifdef PROFILING_ACTIVE
-    // generate query objects needed for timing OpenGL commands
-    glGenQueries(NR_SUBROUTINES_TO_MEASURE, time_query_);
-
-    nr_calls_ = 0;
-    time_measurement_ = vector<double>(NR_SUBROUTINES_TO_MEASURE, 0);
+    // generate query objects needed for timing OpenGL commands. There are
+    // two sets, the results of one frame are read during the next one.
+    glGenQueries(2 * (NR_SUBROUTINES_TO_MEASURE + 1), &time_query_[0][0]);
+    query_slot_ = 0;
+    queries_pending_[0] = queries_pending_[1] = false;
     initial_run_ = true;
-
-    strings_for_subroutines.push_back("ATTACH_TEXTURE");
-    strings_for_subroutines.push_back("CLEAR_SCREEN");
-    strings_for_subroutines.push_back("RENDER");
-    strings_for_subroutines.push_back("DETACH_TEXTURE");
+    gl_clock_origin_ = 0;
+    gl_clock_host_time_ = 0;
+    gl_clock_generation_ = 0;
 
     check_GL_errors("Generating time queries");
-#endif
 }
 
 void ObjectRasterizer::render(
-    const std::vector<std::vector<Eigen::Matrix4f>> states,
+    const std::vector<std::vector<Eigen::Matrix4f>>& states,
     std::vector<std::vector<float>>& depth_values)
 {
     render(states);
@@ -316,9 +332,52 @@ void ObjectRasterizer::render(
 }
 
 void ObjectRasterizer::render(
-    const std::vector<std::vector<Eigen::Matrix4f>> states)
+    const std::vector<std::vector<Eigen::Matrix4f>>& states)
+{
+    float* model_matrices = begin_pose_upload(states.size());
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        for (int k = 0; k < nr_objects_; k++)
+        {
+            Map<Matrix4f>(model_matrices + (i * nr_objects_ + k) * 16) =
+                states[i][k];
+        }
+    }
+    render_uploaded_poses(states.size());
+}
+
+float* ObjectRasterizer::begin_pose_upload(const int nr_poses)
+{
+    if (nr_poses > max_nr_poses_)
+    {
+        std::cout << "ERROR (OPENGL): You tried to evaluate more poses ("
+                  << nr_poses << ") than specified by max_poses ("
+                  << max_nr_poses_ << ")." << std::endl;
+        exit(-1);
+    }
+
+    if (!instanced_ || !persistent_mapping_) return staging_poses_.data();
+
+    bind();
+
+    // the buffer was last read three frames ago, the fence has almost
+    // always been passed already
+    GLsync& fence = pose_fences_[pose_slot_];
+    if (fence)
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) ==
+               GL_TIMEOUT_EXPIRED)
+        {
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    return mapped_poses_[pose_slot_];
+}
+
+void ObjectRasterizer::render_uploaded_poses(const int nr_poses)
 {
-    nr_poses_ = states.size();
+    nr_poses_ = nr_poses;
     if (nr_poses_ > max_nr_poses_)
     {
         std::cout << "ERROR (OPENGL): You tried to evaluate more poses ("
@@ -327,12 +386,14 @@ void ObjectRasterizer::render(
         exit(-1);
     }
 
+    bind();
+
     int nr_poses_per_col = ceil(nr_poses_ / (float)max_nr_poses_per_row_);
 
-#ifdef PROFILING_ACTIVE
-    glBeginQuery(GL_TIME_ELAPSED, time_query_[ATTACH_TEXTURE]);
-    nr_calls_++;
-#endif
+    // the queries do not wait for the commands, they are resolved on the GPU
+    const bool measured = dbot::Profiler::active();
+    GLuint* time_query = time_query_[query_slot_];
+    if (measured) glQueryCounter(time_query[ATTACH_TEXTURE], GL_TIMESTAMP);
 
     glFramebufferTexture2D(GL_FRAMEBUFFER,  // 1. fbo target: GL_FRAMEBUFFER
                            GL_COLOR_ATTACHMENT0,  // 2. attachment point
@@ -342,23 +403,118 @@ void ObjectRasterizer::render(
 #ifdef DEBUG
     check_GL_errors("attaching texture to framebuffer");
 #endif
-#ifdef PROFILING_ACTIVE
-    glFinish();
-    glEndQuery(GL_TIME_ELAPSED);
-    glBeginQuery(GL_TIME_ELAPSED, time_query_[CLEAR_SCREEN]);
-#endif
+    if (measured) glQueryCounter(time_query[CLEAR_SCREEN], GL_TIMESTAMP);
 
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
 #ifdef DEBUG
     check_GL_errors("clearing framebuffer");
 #endif
-#ifdef PROFILING_ACTIVE
-    glFinish();
-    glEndQuery(GL_TIME_ELAPSED);
-    glBeginQuery(GL_TIME_ELAPSED, time_query_[RENDER]);
+    if (measured) glQueryCounter(time_query[RENDER], GL_TIMESTAMP);
+
+    if (instanced_)
+    {
+        render_instanced(nr_poses_per_col);
+    }
+    else
+    {
+        render_per_pose(nr_poses_per_col);
+    }
+
+    if (measured) glQueryCounter(time_query[DETACH_TEXTURE], GL_TIMESTAMP);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER,  // 1. fbo target: GL_FRAMEBUFFER
+                           GL_COLOR_ATTACHMENT0,  // 2. attachment point
+                           GL_TEXTURE_2D,  // 3. tex target: GL_TEXTURE_2D
+                           0,              // 4. tex ID
+                           0);
+
+#ifdef DEBUG
+    check_GL_errors("detaching texture from framebuffer");
 #endif
 
+    if (measured)
+    {
+        glQueryCounter(time_query[NR_SUBROUTINES_TO_MEASURE], GL_TIMESTAMP);
+        queries_pending_[query_slot_] = true;
+    }
+    query_slot_ = 1 - query_slot_;
+    store_time_measurements();
+}
+
+void ObjectRasterizer::set_instanced_rendering(bool instanced)
+{
+    instanced_ = instanced;
+}
+
+void ObjectRasterizer::render_instanced(const int nr_poses_per_col)
+{
+    GLuint pose_buffer = pose_buffers_[pose_slot_];
+    if (!persistent_mapping_)
+    {
+        // orphan the buffer, such that the driver does not wait for the
+        // previous frame still reading it
+        const size_t size = nr_poses_ * nr_objects_ * 16 * sizeof(float);
+        glBindBuffer(GL_TEXTURE_BUFFER, pose_buffer);
+        glBufferData(GL_TEXTURE_BUFFER,
+                     staging_poses_.size() * sizeof(float),
+                     NULL,
+                     GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, staging_poses_.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    glUseProgram(instanced_shader_ID_);
+    for (int i = 0; i < 4; i++) glEnable(GL_CLIP_DISTANCE0 + i);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, pose_textures_[pose_slot_]);
+
+    glUniformMatrix4fv(instanced_projection_matrix_ID_,
+                       1,
+                       GL_FALSE,
+                       projection_matrix_.data());
+    glUniformMatrix4fv(
+        instanced_view_matrix_ID_, 1, GL_FALSE, view_matrix_.data());
+    glUniform1i(instanced_nr_objects_ID_, nr_objects_);
+    glUniform1i(instanced_poses_per_row_ID_, max_nr_poses_per_row_);
+    glUniform1i(instanced_poses_per_col_ID_, nr_poses_per_col);
+
+    // the tiles are placed by the vertex shader, one viewport covers them all
+    glViewport(0,
+               0,
+               max_nr_poses_per_row_ * nr_cols_,
+               nr_poses_per_col * nr_rows_);
+
+    // one draw call per object renders it in all poses
+    for (size_t k = 0; k < object_numbers_.size(); k++)
+    {
+        int index = object_numbers_[k];
+        glUniform1i(instanced_object_ID_, index);
+        glDrawElementsInstanced(
+            GL_TRIANGLES,
+            indices_per_object_[index],
+            GL_UNSIGNED_INT,
+            (void*)(start_position_[index] * sizeof(uint)),
+            nr_poses_);
+#ifdef DEBUG
+        check_GL_errors("instanced render call");
+#endif
+    }
+
+    // the buffer may only be written again once these draws have read it
+    if (persistent_mapping_)
+    {
+        pose_fences_[pose_slot_] =
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    pose_slot_ = (pose_slot_ + 1) % NR_POSE_BUFFERS;
+}
+
+void ObjectRasterizer::render_per_pose(const int nr_poses_per_col)
+{
+    // the vertex shader of the provider does not write clip distances
+    glUseProgram(shader_ID_);
+    for (int i = 0; i < 4; i++) glDisable(GL_CLIP_DISTANCE0 + i);
     glUniformMatrix4fv(
         projection_matrix_ID_, 1, GL_FALSE, projection_matrix_.data());
 
@@ -381,8 +537,11 @@ void ObjectRasterizer::render(
             {
                 int index = object_numbers_[k];
 
+                const int pose = max_nr_poses_per_row_ * i + j;
                 model_view_matrix =
-                    view_matrix_ * states[max_nr_poses_per_row_ * i + j][index];
+                    view_matrix_ *
+                    Map<const Matrix4f>(
+                        &staging_poses_[(pose * nr_objects_ + index) * 16]);
                 glUniformMatrix4fv(model_view_matrix_ID_,
                                    1,
                                    GL_FALSE,
@@ -398,28 +557,6 @@ void ObjectRasterizer::render(
             }
         }
     }
-
-#ifdef PROFILING_ACTIVE
-    glFinish();
-    glEndQuery(GL_TIME_ELAPSED);
-    glBeginQuery(GL_TIME_ELAPSED, time_query_[DETACH_TEXTURE]);
-#endif
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER,  // 1. fbo target: GL_FRAMEBUFFER
-                           GL_COLOR_ATTACHMENT0,  // 2. attachment point
-                           GL_TEXTURE_2D,  // 3. tex target: GL_TEXTURE_2D
-                           0,              // 4. tex ID
-                           0);
-
-#ifdef DEBUG
-    check_GL_errors("detaching texture from framebuffer");
-#endif
-
-#ifdef PROFILING_ACTIVE
-    glFinish();
-    glEndQuery(GL_TIME_ELAPSED);
-    store_time_measurements();
-#endif
 }
 
 void ObjectRasterizer::set_objects(vector<int> object_numbers)
@@ -427,6 +564,16 @@ void ObjectRasterizer::set_objects(vector<int> object_numbers)
     object_numbers_ = object_numbers;
 }
 
+void ObjectRasterizer::set_levels(const vector<int>& levels)
+{
+    for (size_t i = 0; i < levels.size() && i < indices_per_object_.size();
+         i++)
+    {
+        indices_per_object_[i] = level_indices_per_object_[levels[i]][i];
+        start_position_[i] = level_start_position_[levels[i]][i];
+    }
+}
+
 void ObjectRasterizer::set_resolution(const int nr_rows, const int nr_cols)
 {
     if (nr_rows > max_texture_size_ || nr_cols > max_texture_size_)
@@ -437,10 +584,22 @@ void ObjectRasterizer::set_resolution(const int nr_rows, const int nr_cols)
         exit(-1);
     }
 
+    // pending copies have the tiling of the old resolution
+    if (nr_rows != nr_rows_ || nr_cols != nr_cols_)
+    {
+        bind();
+        drop_readbacks();
+    }
+
     nr_rows_ = nr_rows;
     nr_cols_ = nr_cols;
 }
 
+void ObjectRasterizer::set_camera_matrix(const Eigen::Matrix3f camera_matrix)
+{
+    setup_projection_matrix(camera_matrix);
+}
+
 void ObjectRasterizer::allocate_textures_for_max_poses(int nr_poses,
                                                        int nr_poses_per_row,
                                                        int nr_poses_per_col)
@@ -457,8 +616,12 @@ void ObjectRasterizer::allocate_textures_for_max_poses(int nr_poses,
     max_nr_poses_ = nr_poses;
     max_nr_poses_per_row_ = nr_poses_per_row;
     max_nr_poses_per_column_ = nr_poses_per_col;
+    texture_nr_rows_ = nr_rows_;
+    texture_nr_cols_ = nr_cols_;
 
+    bind();
     reallocate_buffers();
+    allocate_pose_buffers();
 }
 
 GLuint ObjectRasterizer::get_framebuffer_texture()
@@ -475,13 +638,7 @@ vector<vector<float>> ObjectRasterizer::get_depth_values(int nr_poses)
         exit(-1);
     }
 
-    // ===================== ATTACH TEXTURE TO FRAMEBUFFER ================ //
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER,  // 1. fbo target: GL_FRAMEBUFFER
-                           GL_COLOR_ATTACHMENT0,  // 2. attachment point
-                           GL_TEXTURE_2D,  // 3. tex target: GL_TEXTURE_2D
-                           framebuffer_texture_for_all_poses_,  // 4. tex ID
-                           0);
+    bind();
 
     // ===================== TRANSFER DEPTH VALUES FROM GPU TO CPU == SLOW!!!
     // ================ //
@@ -489,95 +646,144 @@ vector<vector<float>> ObjectRasterizer::get_depth_values(int nr_poses)
     glBindBuffer(GL_PIXEL_PACK_BUFFER, result_buffer_);
     glBindTexture(GL_TEXTURE_2D, framebuffer_texture_for_all_poses_);
     glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    GLfloat* pixel_depth =
-        (GLfloat*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
-
+    vector<vector<float>> depth_values;
+    const GLfloat* pixel_depth =
+        (const GLfloat*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
     if (pixel_depth != (GLfloat*)NULL)
     {
-        int current_nr_poses_per_col = (nr_poses / max_nr_poses_per_row_) + 1;
-        int total_nr_pixels = nr_rows_ * nr_cols_ * max_nr_poses_per_row_ *
-                              current_nr_poses_per_col;
-        vector<float> depth_image(total_nr_pixels,
-                                  numeric_limits<float>::max());
+        depth_values = split_depth_values(pixel_depth, nr_poses_, nr_poses);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        cout << "WARNING: Could not map Pixel Pack Buffer." << endl;
+    }
 
-        int pixels_per_row = max_nr_poses_per_row_ * nr_cols_;
-        int pixels_per_col = current_nr_poses_per_col * nr_rows_;
-        int highest_pixel_per_col = pixels_per_col - 1;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-        // reading OpenGL texture into an array on the CPU (inverted rows)
-        for (int row = 0; row < pixels_per_col; row++)
-        {
-            int inverted_row = highest_pixel_per_col - row;
+#ifdef DEBUG
+    check_GL_errors("copying depth values to CPU");
+#endif
 
-            for (int col = 0; (col < pixels_per_row) &&
-                              (row * pixels_per_row + col < total_nr_pixels);
-                 col++)
-            {
-                int pixel_index = row * pixels_per_row + col;
+    return depth_values;
+}
 
-                depth_image[pixel_index] =
-                    pixel_depth[inverted_row * pixels_per_row + col];
-            }
-        }
+void ObjectRasterizer::request_depth_values(int nr_poses)
+{
+    if (nr_poses > nr_poses_)
+    {
+        std::cout << "ERROR (OPENGL): You tried to read back the depth values "
+                  << "of more poses than you previously rendered." << std::endl;
+        exit(-1);
+    }
 
-        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    bind();
 
-        // subdividing this array into an array per pose
-        vector<vector<float>> depth_image_per_pose(
-            nr_poses, vector<float>(nr_rows_ * nr_cols_, 0));
+    // the oldest request is dropped if it has not been polled
+    const int slot = readback_slot_;
+    if (readback_fences_[slot]) glDeleteSync(readback_fences_[slot]);
 
-        for (int pose_y = 0; pose_y < max_nr_poses_per_column_; pose_y++)
+    // the copy into the PBO is queued behind the rendering, nothing waits
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback_buffers_[slot]);
+    glBindTexture(GL_TEXTURE_2D, framebuffer_texture_for_all_poses_);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback_fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback_rendered_poses_[slot] = nr_poses_;
+    readback_poses_[slot] = nr_poses;
+    readback_slot_ = (slot + 1) % NR_READBACK_BUFFERS;
+
+#ifdef DEBUG
+    check_GL_errors("requesting depth values");
+#endif
+}
+
+bool ObjectRasterizer::poll_depth_values(vector<vector<float>>& depth_values)
+{
+    bind();
+
+    // from the newest request to the oldest, the first finished one is
+    // returned and the older ones are dropped
+    int finished = -1;
+    for (int i = 1; i <= NR_READBACK_BUFFERS; i++)
+    {
+        const int slot =
+            (readback_slot_ + NR_READBACK_BUFFERS - i) % NR_READBACK_BUFFERS;
+        GLsync& fence = readback_fences_[slot];
+        if (!fence) continue;
+
+        if (finished < 0)
         {
-            for (int pose_x = 0;
-                 pose_x < max_nr_poses_per_row_ &&
-                 pose_y * max_nr_poses_per_row_ + pose_x < nr_poses;
-                 pose_x++)
+            // flushing once makes sure the fence is eventually signaled
+            const GLenum status =
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status != GL_ALREADY_SIGNALED &&
+                status != GL_CONDITION_SATISFIED)
             {
-                for (int local_pixel_row = 0; local_pixel_row < nr_rows_;
-                     local_pixel_row++)
-                {
-                    for (int local_pixel_col = 0; local_pixel_col < nr_cols_;
-                         local_pixel_col++)
-                    {
-                        int local_pixel_nr =
-                            local_pixel_row * nr_cols_ + local_pixel_col;
-                        int global_pixel_row =
-                            pose_y * nr_rows_ + local_pixel_row;
-                        int global_pixel_col =
-                            pose_x * nr_cols_ + local_pixel_col;
-                        int global_pixel_nr =
-                            global_pixel_row * pixels_per_row +
-                            global_pixel_col;
-                        int pose_nr = pose_y * max_nr_poses_per_row_ + pose_x;
-
-                        depth_image_per_pose[pose_nr][local_pixel_nr] =
-                            depth_image[global_pixel_nr];
-                    }
-                }
+                continue;
             }
+            finished = slot;
         }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    if (finished < 0) return false;
 
-        return depth_image_per_pose;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback_buffers_[finished]);
+    const GLfloat* pixel_depth =
+        (const GLfloat*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (pixel_depth != (GLfloat*)NULL)
+    {
+        depth_values = split_depth_values(pixel_depth,
+                                          readback_rendered_poses_[finished],
+                                          readback_poses_[finished]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
     }
     else
     {
         cout << "WARNING: Could not map Pixel Pack Buffer." << endl;
     }
-
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-    // ===================== DETACH TEXTURE FROM FRAMEBUFFER ================ //
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER,  // 1. fbo target: GL_FRAMEBUFFER
-                           GL_COLOR_ATTACHMENT0,  // 2. attachment point
-                           GL_TEXTURE_2D,  // 3. tex target: GL_TEXTURE_2D
-                           0,              // 4. tex ID
-                           0);
+    return pixel_depth != (GLfloat*)NULL;
+}
 
-#ifdef DEBUG
-    check_GL_errors("copying depth values to CPU");
-#endif
+vector<vector<float>> ObjectRasterizer::split_depth_values(
+    const GLfloat* pixel_depth,
+    int nr_rendered_poses,
+    int nr_poses) const
+{
+    // the rows of poses are stacked from the top of the rendered area, the
+    // rows of the texture from its bottom. The texture may be wider than the
+    // tiles of the current resolution.
+    const int nr_poses_per_col =
+        ceil(nr_rendered_poses / (float)max_nr_poses_per_row_);
+    const int pixels_per_row = max_nr_poses_per_row_ * texture_nr_cols_;
+    const int highest_pixel_row = nr_poses_per_col * nr_rows_ - 1;
+
+    vector<vector<float>> depth_image_per_pose(
+        nr_poses, vector<float>(nr_rows_ * nr_cols_, 0));
+    for (int pose = 0; pose < nr_poses; pose++)
+    {
+        const int pose_row = pose / max_nr_poses_per_row_;
+        const int pose_col = pose % max_nr_poses_per_row_;
+        for (int row = 0; row < nr_rows_; row++)
+        {
+            const GLfloat* pixels =
+                pixel_depth +
+                (highest_pixel_row - (pose_row * nr_rows_ + row)) *
+                    pixels_per_row +
+                pose_col * nr_cols_;
+            std::copy(pixels,
+                      pixels + nr_cols_,
+                      depth_image_per_pose[pose].begin() + row * nr_cols_);
+        }
+    }
+    return depth_image_per_pose;
 }
 
 int ObjectRasterizer::get_max_texture_size()
@@ -590,9 +796,15 @@ void ObjectRasterizer::get_memory_need_parameters(int nr_rows,
                                                   int& constant_need,
                                                   int& per_pose_need)
 {
-    constant_need = vertices_list_.size() * sizeof(float) +
-                    indices_list_.size() * sizeof(uint);
-    per_pose_need = nr_rows * nr_cols * (8 + sizeof(float));
+    std::uint64_t constant, per_pose;
+    dbot::MemoryPlanner::rasterizer_need(nr_rows,
+                                         nr_cols,
+                                         vertices_list_.size() / 3,
+                                         indices_list_.size(),
+                                         constant,
+                                         per_pose);
+    constant_need = constant;
+    per_pose_need = per_pose;
 }
 
 // ================================================================= //
@@ -601,18 +813,42 @@ void ObjectRasterizer::get_memory_need_parameters(int nr_rows,
 // ================================================================= //
 // ================================================================= //
 
+void ObjectRasterizer::bind()
+{
+    context_->make_current();
+    glBindVertexArray(vertex_array_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+}
+
+void ObjectRasterizer::drop_readbacks()
+{
+    for (int i = 0; i < NR_READBACK_BUFFERS; i++)
+    {
+        if (readback_fences_[i]) glDeleteSync(readback_fences_[i]);
+        readback_fences_[i] = 0;
+    }
+}
+
 void ObjectRasterizer::reallocate_buffers()
 {
-    // ======================= REALLOCATE PBO ======================= //
+    // ======================= REALLOCATE PBOS ======================= //
+
+    // pending copies have the layout of the old textures
+    drop_readbacks();
 
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, result_buffer_);
     // the NULL means this buffer is uninitialized, since I only want to copy
     // values back to the CPU that will be written by the GPU
-    glBufferData(GL_PIXEL_PACK_BUFFER,
-                 max_nr_poses_per_row_ * nr_cols_ * max_nr_poses_per_column_ *
-                     nr_rows_ * sizeof(GLfloat),
-                 NULL,
-                 GL_STREAM_READ);
+    const GLsizeiptr texture_size =
+        max_nr_poses_per_row_ * texture_nr_cols_ * max_nr_poses_per_column_ *
+        texture_nr_rows_ * sizeof(GLfloat);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, result_buffer_);
+    glBufferData(GL_PIXEL_PACK_BUFFER, texture_size, NULL, GL_STREAM_READ);
+    for (int i = 0; i < NR_READBACK_BUFFERS; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback_buffers_[i]);
+        glBufferData(
+            GL_PIXEL_PACK_BUFFER, texture_size, NULL, GL_STREAM_READ);
+    }
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
     // ======================= DETACH TEXTURES FROM FRAMEBUFFER
@@ -636,8 +872,8 @@ void ObjectRasterizer::reallocate_buffers()
     glTexImage2D(GL_TEXTURE_2D,
                  0,
                  GL_R32F,
-                 max_nr_poses_per_row_ * nr_cols_,
-                 max_nr_poses_per_column_ * nr_rows_,
+                 max_nr_poses_per_row_ * texture_nr_cols_,
+                 max_nr_poses_per_column_ * texture_nr_rows_,
                  0,
                  GL_RED,
                  GL_FLOAT,
@@ -647,8 +883,8 @@ void ObjectRasterizer::reallocate_buffers()
     glBindRenderbuffer(GL_RENDERBUFFER, texture_for_z_testing);
     glRenderbufferStorage(GL_RENDERBUFFER,
                           GL_DEPTH_COMPONENT,
-                          max_nr_poses_per_row_ * nr_cols_,
-                          max_nr_poses_per_column_ * nr_rows_);
+                          max_nr_poses_per_row_ * texture_nr_cols_,
+                          max_nr_poses_per_column_ * texture_nr_rows_);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     // ======================= ATTACH NEW TEXTURES TO FRAMEBUFFER
@@ -670,6 +906,73 @@ void ObjectRasterizer::reallocate_buffers()
     glDrawBuffers(1, color_buffers);
 }
 
+void ObjectRasterizer::allocate_pose_buffers()
+{
+    free_pose_buffers();
+
+    const size_t nr_floats = max_nr_poses_ * nr_objects_ * 16;
+    staging_poses_.resize(nr_floats);
+
+    glGenBuffers(NR_POSE_BUFFERS, pose_buffers_);
+    for (int i = 0; i < NR_POSE_BUFFERS; i++)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, pose_buffers_[i]);
+        if (persistent_mapping_)
+        {
+            // the state conversion writes straight into this memory, the
+            // coherent mapping makes the writes visible without a flush
+            const GLbitfield flags = GL_MAP_WRITE_BIT |
+                                     GL_MAP_PERSISTENT_BIT |
+                                     GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_TEXTURE_BUFFER,
+                            nr_floats * sizeof(float),
+                            NULL,
+                            flags);
+            mapped_poses_[i] = (float*)glMapBufferRange(
+                GL_TEXTURE_BUFFER, 0, nr_floats * sizeof(float), flags);
+        }
+        else
+        {
+            glBufferData(GL_TEXTURE_BUFFER,
+                         nr_floats * sizeof(float),
+                         NULL,
+                         GL_STREAM_DRAW);
+        }
+
+        glBindTexture(GL_TEXTURE_BUFFER, pose_textures_[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pose_buffers_[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    pose_slot_ = 0;
+
+    check_GL_errors("allocating the pose buffers");
+}
+
+void ObjectRasterizer::free_pose_buffers()
+{
+    for (int i = 0; i < NR_POSE_BUFFERS; i++)
+    {
+        if (pose_fences_[i])
+        {
+            glClientWaitSync(pose_fences_[i], GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GLuint64(-1));
+            glDeleteSync(pose_fences_[i]);
+            pose_fences_[i] = 0;
+        }
+        if (mapped_poses_[i])
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, pose_buffers_[i]);
+            glUnmapBuffer(GL_TEXTURE_BUFFER);
+            mapped_poses_[i] = NULL;
+        }
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // immutable storage cannot be resized, the buffers are recreated
+    glDeleteBuffers(NR_POSE_BUFFERS, pose_buffers_);
+}
+
 void ObjectRasterizer::setup_view_matrix()
 {
     // =========================== VIEW MATRIX =========================== //
@@ -730,42 +1033,69 @@ Matrix4f ObjectRasterizer::get_projection_matrix(float n,
 
 void ObjectRasterizer::store_time_measurements()
 {
-#ifdef PROFILING_ACTIVE
+    // the queries of the previous frame are reused in the next one. Their
+    // results are taken if the GPU has them ready, otherwise the frame is
+    // not measured. Waiting for them would stall the pipeline.
+    GLuint* time_query = time_query_[query_slot_];
+    if (!queries_pending_[query_slot_]) return;
+    queries_pending_[query_slot_] = false;
+
+    GLint available = 0;
+    glGetQueryObjectiv(time_query[NR_SUBROUTINES_TO_MEASURE],
+                       GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) return;
+
+    // retrieve the timestamps in ns from OpenGL
+    GLuint64 timestamps[NR_SUBROUTINES_TO_MEASURE + 1];
+    for (int i = 0; i <= NR_SUBROUTINES_TO_MEASURE; i++)
+    {
+        glGetQueryObjectui64v(time_query[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
 
-    // retrieve times from OpenGL and store them
-    for (int i = 0; i < NR_SUBROUTINES_TO_MEASURE; i++)
+    if (dbot::TraceRecorder::recording())
     {
-        GLint available = 0;
-        double time_elapsed_s;
-        unsigned int time_elapsed_ns;
+        static const char* names[NR_SUBROUTINES_TO_MEASURE] = {
+            "attach_texture", "clear_screen", "render", "detach_texture"};
 
-        while (!available)
+        align_gl_clock();
+        for (int i = 0; i < NR_SUBROUTINES_TO_MEASURE; i++)
         {
-            glGetQueryObjectiv(
-                time_query_[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            const double begin =
+                gl_clock_host_time_ +
+                GLint64(timestamps[i] - gl_clock_origin_) * 1e-3;
+            const double duration = (timestamps[i + 1] - timestamps[i]) * 1e-3;
+            dbot::TraceRecorder::span(names[i],
+                                      "gpu",
+                                      begin,
+                                      duration,
+                                      dbot::TraceRecorder::OpenGlTrack);
         }
-        glGetQueryObjectuiv(time_query_[i], GL_QUERY_RESULT, &time_elapsed_ns);
-        time_elapsed_s = time_elapsed_ns / (double)1e9;
-        time_measurement_[i] += time_elapsed_s;
     }
 
-    // the first run should not count. Reset all the counters.
+    // the first run should not count
     if (initial_run_)
     {
         initial_run_ = false;
-        for (int i = 0; i < NR_SUBROUTINES_TO_MEASURE; i++)
-        {
-            time_measurement_[i] = 0;
-        }
-
-        nr_calls_ = 0;
+        return;
     }
-#endif
+    dbot::Profiler::record(
+        dbot::ProfileStage::RenderGpu,
+        (timestamps[NR_SUBROUTINES_TO_MEASURE] - timestamps[0]) * 1e-9);
 }
 
-string ObjectRasterizer::get_text_for_enum(int enumVal)
+void ObjectRasterizer::align_gl_clock()
 {
-    return strings_for_subroutines[enumVal];
+    // the offset is taken once per recording, the GPU clock does not drift
+    // noticeably from the host clock within a trace
+    const std::uint64_t generation = dbot::TraceRecorder::generation();
+    if (gl_clock_generation_ == generation) return;
+    gl_clock_generation_ = generation;
+
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    gl_clock_origin_ = gpu_now;
+    gl_clock_host_time_ = dbot::TraceRecorder::now();
 }
 
 void ObjectRasterizer::check_GL_errors(const char* label)
@@ -822,46 +1152,8 @@ bool ObjectRasterizer::check_framebuffer_status()
 
 ObjectRasterizer::~ObjectRasterizer()
 {
-#ifdef PROFILING_ACTIVE
-
-    if (nr_calls_ != 0)
-    {
-        cout << endl
-             << "Time measurements for the different steps of the rendering "
-                "process averaged over "
-             << nr_calls_ << " render calls:" << endl
-             << endl;
-
-        double total_time_per_render = 0;
-
-        for (int i = 0; i < NR_SUBROUTINES_TO_MEASURE; i++)
-        {
-            total_time_per_render += time_measurement_[i];
-        }
-        total_time_per_render /= nr_calls_;
-
-        for (int i = 0; i < NR_SUBROUTINES_TO_MEASURE; i++)
-        {
-            double time_per_subroutine = time_measurement_[i] / nr_calls_;
-
-            cout << get_text_for_enum(i) << ":     "
-                 << "\t " << time_per_subroutine << " s \t " << setprecision(1)
-                 << time_per_subroutine * 100 / total_time_per_render << " %"
-                 << setprecision(9) << endl;
-        }
-
-        cout << "TOTAL TIME PER RENDER CALL : " << total_time_per_render << endl
-             << endl;
-    }
-    else
-    {
-        cout << "The render() function was never called, so there are no time "
-                "measurements of it available."
-             << endl;
-    }
-
-    glDeleteQueries(NR_SUBROUTINES_TO_MEASURE, time_query_);
-#endif
+    bind();
+    glDeleteQueries(2 * (NR_SUBROUTINES_TO_MEASURE + 1), &time_query_[0][0]);
 
     glDisableVertexAttribArray(0);
     glDeleteVertexArrays(1, &vertex_array_);
@@ -869,11 +1161,18 @@ ObjectRasterizer::~ObjectRasterizer()
     glDeleteBuffers(1, &vertex_buffer_);
     glDeleteBuffers(1, &index_buffer_);
     glDeleteBuffers(1, &result_buffer_);
+    drop_readbacks();
+    glDeleteBuffers(NR_READBACK_BUFFERS, readback_buffers_);
 
     glDeleteFramebuffers(1, &framebuffer_);
     glDeleteTextures(1, &framebuffer_texture_for_all_poses_);
     glDeleteRenderbuffers(1, &texture_for_z_testing);
 
-    glDeleteProgram(shader_ID_);
-    glXDestroyContext(dpy_, ctx_);
+    free_pose_buffers();
+    glDeleteTextures(NR_POSE_BUFFERS, pose_textures_);
+
+    // unbinding keeps the next rasterizer in this context from using the
+    // deleted objects, the programs belong to GpuResources
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -21,8 +21,10 @@
 
 #include <Eigen/Dense>
 #include <GL/glew.h>
-#include <GL/glx.h>
+#include <dbot/flat_mesh.h>
+#include <dbot/gpu/gl_context.h>
 #include <dbot/gpu/shader_provider.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -40,22 +42,15 @@ class ObjectRasterizer
 {
 public:
     /**
-     * \brief constructor which takes the vertices and indices that describe the
-     * objects as input. The paths to the
-     * shader files and the instrinsic camera matrix also have to be passed
-     * here.
-     * \param [in]  vertices [object_nr][vertex_nr] = {x, y, z}. This list
-     * should contain, for each object,
-     * a list of 3-dimensional vectors that specify the corners of the triangles
-     * of the object mesh.
-     * \param [in]  indices [object_nr][index_nr][0 - 2] = {index}. This list
-     * should contain the indices
-     * that index the vertices list and tell us which vertices to connect to a
-     * triangle (every group of 3).
-     * For each object, the indices should be in the range of [0, nr_vertices -
-     * 1].
-     * \param [in]  vertex_shader_path path to the vertex shader
-     * \param [in]  fragment_shader_path path to the fragment shader
+     * \brief constructor which takes the levels of detail of the mesh of
+     * all objects as input. The shader provider and the instrinsic camera
+     * matrix also have to be passed here.
+     * \param [in]  levels flat meshes of all objects, one per level of
+     * detail starting with the full one. Object i is part i of each mesh.
+     * The position and index arrays of all levels are uploaded to OpenGL
+     * one after the other, the objects are drawn from level 0 until
+     * set_levels() selects others.
+     * \param [in]  shader_provider provides the shaders of the rasterizer
      * \param [in]  camera_matrix matrix of the intrinsic parameters of the
      * camera
      * \param [in]  nr_rows the number of rows in one sensor image (vertical
@@ -70,18 +65,21 @@ public:
      * not be rendered. This should
      * be similar to the maximum distance up to which the sensor can see
      * objects.
+     * \param [in]  context backend and GPU of the OpenGL context
      */
     ObjectRasterizer(
-        const std::vector<std::vector<Eigen::Vector3f>> vertices,
-        const std::vector<std::vector<std::vector<int>>> indices,
+        const std::vector<std::shared_ptr<const dbot::FlatMesh>>& levels,
         const std::shared_ptr<dbot::ShaderProvider>& shader_provider,
         const Eigen::Matrix3f camera_matrix,
         const int nr_rows,
         const int nr_cols,
         const float near_plane = 0.4,
-        const float far_plane = 4);
+        const float far_plane = 4,
+        const dbot::GlContext::Parameters& context =
+            dbot::GlContext::Parameters());
 
-    /** destructor which deletes the buffers and programs used by openGL */
+    /** destructor which deletes the buffers used by openGL, the context and
+     *  the programs are kept by dbot::GpuResources for the next rasterizer */
     ~ObjectRasterizer();
 
     /**
@@ -99,7 +97,7 @@ public:
      * \param [out] depth_values [pose_nr][0 - nr_pixels] = {depth value of that
      * pixel}
      */
-    void render(const std::vector<std::vector<Eigen::Matrix4f>> states,
+    void render(const std::vector<std::vector<Eigen::Matrix4f>>& states,
                 std::vector<std::vector<float>>& depth_values);
 
     /**
@@ -112,7 +110,28 @@ public:
      * ty, tz}. This should contain the quaternion
      * and the translation for each object per pose.
      */
-    void render(const std::vector<std::vector<Eigen::Matrix4f>> states);
+    void render(const std::vector<std::vector<Eigen::Matrix4f>>& states);
+
+    /**
+     * \brief returns the memory the model matrices of the next render call
+     * have to be written to.
+     * The matrix of object k in pose i is stored column major at
+     * [(i * nr_objects + k) * 16], where nr_objects is the number of objects
+     * passed in the constructor. The memory is a persistently mapped buffer
+     * if the driver supports it, so writing the poses there involves neither
+     * allocations nor further copies. Three buffers are cycled, a buffer is
+     * only handed out again once the GPU has finished reading it.
+     * \param [in]  nr_poses the number of poses which will be written
+     * \return pointer to nr_poses * nr_objects * 16 floats
+     */
+    float* begin_pose_upload(const int nr_poses);
+
+    /**
+     * \brief renders the poses written since begin_pose_upload() into the
+     * texture that can be accessed by CUDA, see render()
+     * \param [in]  nr_poses the number of poses which were written
+     */
+    void render_uploaded_poses(const int nr_poses);
 
     /**
      * \brief sets the objects that should be rendered.
@@ -127,12 +146,38 @@ public:
     void set_objects(std::vector<int> object_numbers);
 
     /**
-     * \brief set a new resolution.
+     * \brief selects the level of detail each object is drawn with
+     * \param [in]  levels [0 - nr_objects] = {level}, one for every object
+     * passed in the constructor
+     */
+    void set_levels(const std::vector<int>& levels);
+
+    /**
+     * \brief switches between drawing each object once for all poses with
+     * instancing and drawing every pose into its own viewport.
+     * The instanced rendering is the default unless the shader provider has
+     * a geometry shader. It uses its own vertex shader, which computes the
+     * depth like the default one, and the fragment shader of the provider.
+     * \param [in]  instanced whether to use instanced rendering
+     */
+    void set_instanced_rendering(bool instanced);
+
+    /**
+     * \brief set a new resolution. Once the textures are allocated, a
+     * resolution they fit only changes the tiling of the poses, a larger one
+     * needs allocate_textures_for_max_poses() again.
      * \param [in]  nr_rows the height of the image
      * \param [in]  nr_cols the width of the image
      */
     void set_resolution(const int nr_rows, const int nr_cols);
 
+    /**
+     * \brief set the intrinsic parameters of the camera at the current
+     * resolution, e.g. after set_resolution()
+     * \param [in]  camera_matrix matrix of the intrinsic parameters
+     */
+    void set_camera_matrix(const Eigen::Matrix3f camera_matrix);
+
     /**
      * \brief allocates memory on the GPU.
      * Use this function to allocate memory for the maximum number of poses that
@@ -159,11 +204,29 @@ public:
     /**
      * \brief returns the rendered depth values of all poses.
      * This function should only be used for debugging. It will be extremely
-     * slow.
+     * slow, request_depth_values() reads them back without blocking.
      * \return [pose_nr][0 - nr_pixels] = {depth value of that pixel}
      */
     std::vector<std::vector<float>> get_depth_values(int nr_poses);
 
+    /**
+     * \brief starts copying the depth values of the last render call into a
+     * pixel pack buffer without waiting for the rendering to finish. A
+     * request which has not been polled yet when two newer ones are made is
+     * dropped.
+     * \param [in] nr_poses the number of poses whose depth values are read
+     */
+    void request_depth_values(int nr_poses);
+
+    /**
+     * \brief returns the depth values of the newest request whose copy has
+     * finished, older requests are dropped. Does not block.
+     * \param [out] depth_values [pose_nr][0 - nr_pixels] = {depth value of
+     * that pixel}
+     * \return false if no requested copy has finished yet
+     */
+    bool poll_depth_values(std::vector<std::vector<float>>& depth_values);
+
     /**
      * \brief returns the constant and per-pose memory needs that OpenGL will
      * have (in bytes)
@@ -187,9 +250,9 @@ public:
     int get_max_texture_size();
 
 private:
-    // OpenGL context variables
-    Display* dpy_;
-    GLXContext ctx_;
+    // OpenGL context shared with the other rasterizers of the thread, it
+    // outlives the objects created in it
+    std::shared_ptr<dbot::GlContext> context_;
 
     // GPU constraints
     GLint max_texture_size_;
@@ -199,6 +262,11 @@ private:
     int nr_rows_;
     int nr_cols_;
 
+    // resolution the textures and PBOs were allocated for, the tiles of
+    // the current resolution are laid out within them
+    int texture_nr_rows_;
+    int texture_nr_cols_;
+
     // values initialized in constructor. Cannot be changed afterwards.
     float near_plane_;
     float far_plane_;
@@ -211,9 +279,12 @@ private:
     int max_nr_poses_per_row_;
     int max_nr_poses_per_column_;
 
-    // needed for OpenGL time measurement
+    // needed for OpenGL time measurement. The queries are timestamps at the
+    // start of each subroutine and one at the end of the last.
     static const int NR_SUBROUTINES_TO_MEASURE = 4;
-    GLuint time_query_[NR_SUBROUTINES_TO_MEASURE];
+    GLuint time_query_[2][NR_SUBROUTINES_TO_MEASURE + 1];
+    int query_slot_;  // the set of queries used by the next render call
+    bool queries_pending_[2];
     enum subroutines_to_measure
     {
         ATTACH_TEXTURE,
@@ -221,10 +292,12 @@ private:
         RENDER,
         DETACH_TEXTURE
     };
-    std::vector<std::string> strings_for_subroutines;
-    std::vector<double> time_measurement_;
-    int nr_calls_;
     bool initial_run_;  // the first run should not count
+    // GPU timestamp in ns and host time in us at which it was taken, they
+    // align the GPU spans of the trace to host time
+    GLint64 gl_clock_origin_;
+    double gl_clock_host_time_;
+    std::uint64_t gl_clock_generation_;
 
     // lists of all vertices and indices of all objects
     std::vector<float> vertices_list_;
@@ -232,6 +305,11 @@ private:
     std::vector<int> indices_per_object_;
     std::vector<int> start_position_;
 
+    // ranges of the objects in the index list per level of detail, the
+    // ones above are those of the selected levels
+    std::vector<std::vector<int>> level_indices_per_object_;
+    std::vector<std::vector<int>> level_start_position_;
+
     // contains a list of object indices which should be rendered
     std::vector<int> object_numbers_;
 
@@ -244,6 +322,30 @@ private:
     GLuint model_view_matrix_ID_;  // ID to which we pass the modelview matrix
     GLuint projection_matrix_ID_;  // ID to which we pass the projection matrix
 
+    // instanced rendering: one draw call per object renders all poses, the
+    // model view matrices are fetched from a texture buffer
+    bool instanced_;
+    GLuint instanced_shader_ID_;
+    GLuint instanced_projection_matrix_ID_;
+    GLuint instanced_view_matrix_ID_;
+    GLuint instanced_nr_objects_ID_;
+    GLuint instanced_object_ID_;
+    GLuint instanced_poses_per_row_ID_;
+    GLuint instanced_poses_per_col_ID_;
+
+    // model matrices of all poses. Three texture buffers are cycled, they
+    // are persistently mapped if persistent_mapping_ is set. Otherwise, and
+    // for the per pose rendering, the matrices are staged on the host.
+    static const int NR_POSE_BUFFERS = 3;
+    bool persistent_mapping_;
+    int nr_objects_;
+    int pose_slot_;
+    GLuint pose_buffers_[NR_POSE_BUFFERS];
+    GLuint pose_textures_[NR_POSE_BUFFERS];
+    float* mapped_poses_[NR_POSE_BUFFERS];
+    GLsync pose_fences_[NR_POSE_BUFFERS];
+    std::vector<float> staging_poses_;
+
     // VAO, VBO and element arrays are needed to store the object meshes
     GLuint vertex_array_;   // The vertex array contains the vertex and index
                             // buffers
@@ -255,6 +357,16 @@ private:
     // PBO for copying results to CPU for debugging
     GLuint result_buffer_;
 
+    // PBOs of the asynchronous copies. Each keeps the number of poses of the
+    // render call, which determines the layout of the tiles, and the fence
+    // of its copy, which is 0 if there is no pending request.
+    static const int NR_READBACK_BUFFERS = 2;
+    int readback_slot_;  // the buffer used by the next request
+    GLuint readback_buffers_[NR_READBACK_BUFFERS];
+    GLsync readback_fences_[NR_READBACK_BUFFERS];
+    int readback_rendered_poses_[NR_READBACK_BUFFERS];
+    int readback_poses_[NR_READBACK_BUFFERS];
+
     // custom framebuffer and its textures for depth (for z-testing) and color
     // (which also represents depth in our case)
     GLuint framebuffer_;
@@ -263,7 +375,25 @@ private:
 
     // ====================== PRIVATE FUNCTIONS ====================== //
 
+    // makes the context current and binds the vertex array and framebuffer
+    // of this rasterizer, others may have bound theirs in the meantime
+    void bind();
     void reallocate_buffers();
+    void drop_readbacks();
+
+    // splits the texture read back from pixel_depth into the images of the
+    // first nr_poses of the nr_rendered_poses rendered ones
+    std::vector<std::vector<float>> split_depth_values(
+        const GLfloat* pixel_depth,
+        int nr_rendered_poses,
+        int nr_poses) const;
+
+    void allocate_pose_buffers();
+    void free_pose_buffers();
+
+    // draw all poses with one instanced call per object, or pose by pose
+    void render_instanced(const int nr_poses_per_col);
+    void render_per_pose(const int nr_poses_per_col);
 
     // set up view- and projection-matrix
     void setup_view_matrix();
@@ -277,7 +407,7 @@ private:
 
     // functions for time measurement
     void store_time_measurements();
-    std::string get_text_for_enum(int enumVal);
+    void align_gl_clock();
 
     // functions for error checking
     void check_GL_errors(const char* label);
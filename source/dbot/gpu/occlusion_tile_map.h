@@ -0,0 +1,270 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_tile_map.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// the view is read by the kernels, the header is included by nvcc without
+// Eigen, see dbot/pose/pose_composition.h
+#ifndef DBOT_HOST_DEVICE
+#ifdef __CUDACC__
+#define DBOT_HOST_DEVICE __host__ __device__
+#else
+#define DBOT_HOST_DEVICE
+#endif
+#endif
+
+namespace dbot
+{
+/**
+ * \brief Bookkeeping of the incremental occlusion update of the
+ *        CudaEvaluator, see CudaEvaluator::set_incremental_occlusions().
+ *
+ * The stored occlusion region is split into tiles of TILE_ROWS x TILE_COLS
+ * pixels, counted row major. The occlusions are kept in two buffers with one
+ * row per slot. Every tile lives in one of the buffers for all slots and
+ * owes the time by which its probabilities still have to be propagated.
+ * Every slot has a map from its tiles to the rows they are read from.
+ *
+ * An update of the slots from their parents writes only the touched tiles,
+ * into the own row of the slot in the buffer the tile is not in. All other
+ * tiles of a slot refer to the row of the tile of its parent, such that the
+ * parent indices compose across updates. Keeping the buffer of a tile
+ * uniform across slots avoids reference counting the rows.
+ *
+ * The map holds the states of the tiles on the host, the rows and the
+ * buffers live on the device and are read through a View.
+ */
+class OcclusionTileMap
+{
+public:
+    /** \brief Size of the tiles in pixels */
+    static const int TILE_ROWS = 8;
+    static const int TILE_COLS = 32;
+
+    /**
+     * \brief Where a tile lives. Its stored probabilities have to be
+     *        propagated by pending_time before use.
+     */
+    struct State
+    {
+        int buffer;
+        float pending_time;
+    };
+
+    /** \brief Rectangle of tiles [row, row + rows) x [col, col + cols) */
+    struct Range
+    {
+        int row, col, rows, cols;
+    };
+
+    /**
+     * \brief Tiles as seen by an update, which is passed to the kernels by
+     *        value. Tile t of slot s is row rows[t * slot_stride + s] of
+     *        buffers[states[t].buffer]. The tiles within touched are
+     *        written by an update, all others are only referred to in
+     *        next_rows. rows is NULL if the update is not incremental.
+     */
+    struct View
+    {
+        const int* rows;
+        int* next_rows;
+        const State* states;
+        void* buffers[2];
+        int slot_stride;
+        int tile_count;
+        int tile_cols;
+        Range touched;
+
+        /** \brief Tile of the stored pixel index of a region of the width */
+        DBOT_HOST_DEVICE int tile(int region_cols, int index) const
+        {
+            const int row = index / region_cols;
+            const int col = index - row * region_cols;
+            return (row / TILE_ROWS) * tile_cols + col / TILE_COLS;
+        }
+
+        DBOT_HOST_DEVICE bool is_touched(int tile) const
+        {
+            const int row = tile / tile_cols;
+            const int col = tile - row * tile_cols;
+            return row >= touched.row && row < touched.row + touched.rows &&
+                   col >= touched.col && col < touched.col + touched.cols;
+        }
+
+        /** \brief Row the tile of the slot is read from */
+        DBOT_HOST_DEVICE int row(int tile, int slot) const
+        {
+            return rows[tile * slot_stride + slot];
+        }
+
+        /**
+         * \brief Row the tile of the slot is read from after an update of
+         *        the slot from the parent slot
+         */
+        DBOT_HOST_DEVICE int next_row(int tile, int slot, int parent) const
+        {
+            return is_touched(tile) ? slot : row(tile, parent);
+        }
+
+        /** \brief Row of a buffer of a region of the given area */
+        template <typename OcclusionType>
+        DBOT_HOST_DEVICE OcclusionType* buffer_row(int buffer,
+                                                   int row,
+                                                   int area) const
+        {
+            return static_cast<OcclusionType*>(buffers[buffer]) +
+                   std::ptrdiff_t(row) * area;
+        }
+    };
+
+public:
+    OcclusionTileMap()
+        : capacity_(0), region_rows_(0), region_cols_(0), resolved_(true)
+    {
+    }
+
+    static int tile_count(int rows, int cols)
+    {
+        return (rows + TILE_ROWS - 1) / TILE_ROWS *
+               ((cols + TILE_COLS - 1) / TILE_COLS);
+    }
+
+    /**
+     * \brief Room for the tiles of every region within the resolution, all
+     *        of them resolved
+     */
+    void allocate(int n_rows, int n_cols)
+    {
+        capacity_ = tile_count(n_rows, n_cols);
+        reset();
+    }
+
+    void clear()
+    {
+        capacity_ = 0;
+        states_.clear();
+        resolved_ = true;
+    }
+
+    /** \brief Number of tiles the device maps of a slot have room for */
+    int capacity() const { return capacity_; }
+
+    /** \brief Size of the stored region the tiles are counted over */
+    void set_region(int rows, int cols)
+    {
+        region_rows_ = rows;
+        region_cols_ = cols;
+    }
+
+    /** \brief Number of tiles of the stored region */
+    int tile_count() const { return tile_count(region_rows_, region_cols_); }
+
+    int tile_cols() const { return (region_cols_ + TILE_COLS - 1) / TILE_COLS; }
+
+    /**
+     * \brief Tiles which cover the pixels [row, row + rows) x [col, col +
+     *        cols) of the stored region, which are clipped to the region
+     */
+    Range touched(int row, int col, int rows, int cols) const
+    {
+        Range range = {0, 0, 0, 0};
+        const int first_row = std::max(row, 0);
+        const int first_col = std::max(col, 0);
+        const int end_row = std::min(row + rows, region_rows_);
+        const int end_col = std::min(col + cols, region_cols_);
+        if (end_row <= first_row || end_col <= first_col) return range;
+
+        range.row = first_row / TILE_ROWS;
+        range.col = first_col / TILE_COLS;
+        range.rows = (end_row + TILE_ROWS - 1) / TILE_ROWS - range.row;
+        range.cols = (end_col + TILE_COLS - 1) / TILE_COLS - range.col;
+        return range;
+    }
+
+    /** \brief States of the tiles of the stored region */
+    const std::vector<State>& states() const { return states_; }
+
+    /**
+     * \brief Every tile of every slot is in its own row of buffer 0 and up
+     *        to date, as its view refers to
+     */
+    bool resolved() const { return resolved_; }
+
+    /**
+     * \brief Records an update which has written the touched tiles of all
+     *        slots. These are in the other buffer now and up to date, all
+     *        others owe the time once more. A NaN time is not known and
+     *        propagates nothing.
+     */
+    void advance(const Range& touched, float delta_time)
+    {
+        View view = View();
+        view.tile_cols = tile_cols();
+        view.touched = touched;
+        for (int t = 0; t < tile_count(); t++)
+        {
+            State& state = states_[t];
+            if (view.is_touched(t))
+            {
+                state.buffer = 1 - state.buffer;
+                state.pending_time = 0;
+            }
+            else if (!std::isnan(delta_time))
+            {
+                state.pending_time += delta_time;
+            }
+        }
+        resolved_ = false;
+    }
+
+    /**
+     * \brief Records that every tile has been moved into the own row of its
+     *        slot in the buffer it was not in and propagated
+     */
+    void move_all()
+    {
+        for (int t = 0; t < tile_count(); t++)
+        {
+            states_[t].buffer = 1 - states_[t].buffer;
+            states_[t].pending_time = 0;
+        }
+    }
+
+    /**
+     * \brief Records that all tiles are in buffer 0 and up to date, the
+     *        rows of the device have to refer to the own row of each slot
+     */
+    void reset()
+    {
+        const State resolved = {0, 0};
+        states_.assign(capacity_, resolved);
+        resolved_ = true;
+    }
+
+private:
+    int capacity_;
+    int region_rows_;
+    int region_cols_;
+    std::vector<State> states_;
+    bool resolved_;
+};
+}
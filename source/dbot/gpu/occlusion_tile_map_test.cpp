@@ -0,0 +1,306 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_tile_map_test.cpp
+ */
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <dbot/gpu/occlusion_tile_map.h>
+
+namespace
+{
+typedef dbot::OcclusionTileMap TileMap;
+
+/** \brief Occlusion model which composes in time like the one of the GPU */
+float propagate(float probability, float time)
+{
+    if (std::isnan(time)) return probability;
+    return 0.1f + (probability - 0.1f) * std::exp(-time);
+}
+
+/** \brief Observation of a pixel of the evaluation region by a slot */
+float observe(float probability, int slot)
+{
+    return 0.5f * probability + 0.05f * slot;
+}
+
+/**
+ * \brief The device side of the incremental update on the host, as done by
+ *        the kernels of the CudaEvaluator
+ */
+struct FakeDevice
+{
+    FakeDevice(int rows, int cols, int slots)
+        : rows(rows), cols(cols), slots(slots)
+    {
+        map.allocate(rows, cols);
+        map.set_region(rows, cols);
+        for (int b = 0; b < 2; b++) buffers[b].assign(slots * area(), 0.f);
+        identity();
+    }
+
+    int area() const { return rows * cols; }
+
+    void identity()
+    {
+        tile_rows.resize(map.capacity() * slots);
+        next_tile_rows.resize(tile_rows.size());
+        for (size_t i = 0; i < tile_rows.size(); i++) tile_rows[i] = i % slots;
+    }
+
+    TileMap::View view(const TileMap::Range& touched)
+    {
+        TileMap::View view = TileMap::View();
+        view.rows = tile_rows.data();
+        view.next_rows = next_tile_rows.data();
+        view.states = map.states().data();
+        view.buffers[0] = buffers[0].data();
+        view.buffers[1] = buffers[1].data();
+        view.slot_stride = slots;
+        view.tile_count = map.tile_count();
+        view.tile_cols = map.tile_cols();
+        view.touched = touched;
+        return view;
+    }
+
+    /** \brief Probability of a pixel of the slot propagated to now */
+    float read(int slot, int index)
+    {
+        const TileMap::View tiles = view(TileMap::Range());
+        const int tile = tiles.tile(cols, index);
+        const TileMap::State state = tiles.states[tile];
+        const float* probs = tiles.buffer_row<float>(
+            state.buffer, tiles.row(tile, slot), area());
+        return propagate(probs[index], state.pending_time);
+    }
+
+    /**
+     * \brief Updates every slot from its parent and observes the pixels of
+     *        the evaluation region
+     */
+    void update(const std::vector<int>& parents,
+                int row,
+                int col,
+                int region_rows,
+                int region_cols,
+                float delta_time)
+    {
+        const TileMap::Range touched =
+            map.touched(row, col, region_rows, region_cols);
+        const TileMap::View tiles = view(touched);
+
+        for (int slot = 0; slot < slots; slot++)
+        {
+            const int parent = parents[slot];
+            for (int t = 0; t < tiles.tile_count; t++)
+            {
+                next_tile_rows[t * slots + slot] =
+                    tiles.next_row(t, slot, parent);
+            }
+
+            for (int index = 0; index < area(); index++)
+            {
+                const int tile = tiles.tile(cols, index);
+                if (!tiles.is_touched(tile)) continue;
+
+                const TileMap::State state = tiles.states[tile];
+                const float* probs = tiles.buffer_row<float>(
+                    state.buffer, tiles.row(tile, parent), area());
+                float* new_probs =
+                    tiles.buffer_row<float>(1 - state.buffer, slot, area());
+                new_probs[index] = propagate(
+                    probs[index],
+                    std::isnan(delta_time) ? state.pending_time
+                                           : state.pending_time + delta_time);
+
+                // the evaluation region lies within the touched tiles
+                const int r = index / cols;
+                const int c = index % cols;
+                if (r >= row && r < row + region_rows && c >= col &&
+                    c < col + region_cols)
+                {
+                    new_probs[index] = observe(new_probs[index], slot);
+                }
+            }
+        }
+
+        map.advance(touched, delta_time);
+        tile_rows.swap(next_tile_rows);
+    }
+
+    /** \brief Moves every tile into the own row of its slot in buffer 0 */
+    void resolve()
+    {
+        move(-1);
+        map.move_all();
+        identity();
+        move(1);
+        map.reset();
+    }
+
+    void move(int from_buffer)
+    {
+        const TileMap::View tiles = view(TileMap::Range());
+        for (int slot = 0; slot < slots; slot++)
+        {
+            for (int index = 0; index < area(); index++)
+            {
+                const int tile = tiles.tile(cols, index);
+                const TileMap::State state = tiles.states[tile];
+                if (from_buffer >= 0 && state.buffer != from_buffer) continue;
+
+                const float* probs = tiles.buffer_row<float>(
+                    state.buffer, tiles.row(tile, slot), area());
+                tiles.buffer_row<float>(1 - state.buffer, slot, area())[index] =
+                    propagate(probs[index], state.pending_time);
+            }
+        }
+    }
+
+    int rows, cols, slots;
+    TileMap map;
+    std::vector<float> buffers[2];
+    std::vector<int> tile_rows;
+    std::vector<int> next_tile_rows;
+};
+}
+
+TEST(OcclusionTileMapTests, parent_rows_resolve_like_the_full_copy)
+{
+    // a region of partial tiles along both edges
+    const int rows = 20;
+    const int cols = 70;
+    const int slots = 5;
+    FakeDevice device(rows, cols, slots);
+    std::vector<std::vector<float>> expected(
+        slots, std::vector<float>(rows * cols, 0.f));
+
+    std::mt19937 generator(5);
+    std::uniform_int_distribution<int> parent(0, slots - 1);
+    std::uniform_int_distribution<int> row(-4, rows - 1);
+    std::uniform_int_distribution<int> col(-10, cols - 1);
+    std::uniform_int_distribution<int> size(1, 24);
+
+    for (int frame = 0; frame < 30; frame++)
+    {
+        std::vector<int> parents(slots);
+        for (int& p : parents) p = parent(generator);
+        const int r = row(generator);
+        const int c = col(generator);
+        const int region_rows = size(generator);
+        const int region_cols = size(generator);
+        const float delta_time = frame % 7 == 3
+                                     ? std::numeric_limits<float>::quiet_NaN()
+                                     : 0.03f * (frame % 4 + 1);
+
+        // every slot copies its parent in full and observes the region
+        std::vector<std::vector<float>> copied(slots);
+        for (int slot = 0; slot < slots; slot++)
+        {
+            copied[slot] = expected[parents[slot]];
+            for (int index = 0; index < rows * cols; index++)
+            {
+                float& value = copied[slot][index];
+                value = propagate(value, delta_time);
+                const int pixel_row = index / cols;
+                const int pixel_col = index % cols;
+                if (pixel_row >= r && pixel_row < r + region_rows &&
+                    pixel_col >= c && pixel_col < c + region_cols)
+                {
+                    value = observe(value, slot);
+                }
+            }
+        }
+        expected = copied;
+        device.update(parents, r, c, region_rows, region_cols, delta_time);
+
+        for (int slot = 0; slot < slots; slot++)
+        {
+            for (int index = 0; index < rows * cols; index++)
+            {
+                ASSERT_NEAR(device.read(slot, index), expected[slot][index],
+                            1e-5)
+                    << "frame " << frame << " slot " << slot;
+            }
+        }
+
+        if (frame % 10 == 9)
+        {
+            device.resolve();
+            ASSERT_TRUE(device.map.resolved());
+            for (int slot = 0; slot < slots; slot++)
+            {
+                for (int index = 0; index < rows * cols; index++)
+                {
+                    ASSERT_NEAR(device.buffers[0][slot * rows * cols + index],
+                                expected[slot][index],
+                                1e-5);
+                }
+            }
+        }
+    }
+}
+
+TEST(OcclusionTileMapTests, touched_tiles_are_clipped_to_the_region)
+{
+    TileMap map;
+    map.allocate(40, 100);
+    map.set_region(20, 70);
+    EXPECT_EQ(map.tile_count(), 3 * 3);
+    EXPECT_EQ(map.tile_cols(), 3);
+
+    const TileMap::Range inside = map.touched(9, 31, 2, 2);
+    EXPECT_EQ(inside.row, 1);
+    EXPECT_EQ(inside.col, 0);
+    EXPECT_EQ(inside.rows, 1);
+    EXPECT_EQ(inside.cols, 2);
+
+    const TileMap::Range clipped = map.touched(-5, 60, 100, 100);
+    EXPECT_EQ(clipped.row, 0);
+    EXPECT_EQ(clipped.col, 1);
+    EXPECT_EQ(clipped.rows, 3);
+    EXPECT_EQ(clipped.cols, 2);
+
+    const TileMap::Range outside = map.touched(20, 0, 4, 4);
+    EXPECT_EQ(outside.rows * outside.cols, 0);
+}
+
+TEST(OcclusionTileMapTests, untouched_tiles_owe_the_time)
+{
+    TileMap map;
+    map.allocate(16, 64);
+    map.set_region(16, 64);
+
+    map.advance(map.touched(0, 0, 1, 1), 0.5f);
+    map.advance(map.touched(0, 0, 1, 1),
+                std::numeric_limits<float>::quiet_NaN());
+    EXPECT_FALSE(map.resolved());
+
+    EXPECT_EQ(map.states()[0].buffer, 0);
+    EXPECT_EQ(map.states()[0].pending_time, 0.f);
+    for (int t = 1; t < map.tile_count(); t++)
+    {
+        EXPECT_EQ(map.states()[t].buffer, 0);
+        EXPECT_FLOAT_EQ(map.states()[t].pending_time, 0.5f);
+    }
+
+    map.reset();
+    EXPECT_TRUE(map.resolved());
+    EXPECT_EQ(map.states()[1].pending_time, 0.f);
+}
@@ -0,0 +1,321 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_sharding.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief Distributes the particles of a filter over several sensors, the
+ *        shards, each of which keeps the occlusions of its own particles.
+ *
+ * The filter refers to occlusions by global indices, slot i holds the
+ * occlusions of particle i of the last update. Every shard stores the
+ * occlusions of the particles it evaluated in slots numbered in the order
+ * of evaluation. The sharding remembers which global index every slot of
+ * every shard holds.
+ *
+ * A particle is evaluated on a shard which holds the occlusions of its
+ * parent where possible, such that resampling mostly keeps particles on
+ * their shard. The remaining ones are placed on shards with room and
+ * their parent occlusions migrate: they are read from the shard holding
+ * them and written into a free slot of the new shard before the
+ * evaluation. The slots a filter no longer refers to are free, since
+ * resampling between two updates only ever drops global indices.
+ *
+ * Every shard evaluates at least one particle, if there are fewer
+ * particles than shards an idle one evaluates a dummy particle with index
+ * -1. This keeps the occlusion time of all shards in step.
+ */
+class ParticleSharding
+{
+public:
+    /** \brief Occlusions to copy from one shard to another */
+    struct Migration
+    {
+        int source_shard;
+        int source_slot;
+        int shard;
+        int slot;
+    };
+
+public:
+    ParticleSharding(int shard_count, int slots_per_shard)
+        : slots_per_shard_(slots_per_shard),
+          particles_(shard_count),
+          slots_(shard_count),
+          slot_globals_(shard_count, std::vector<int>(slots_per_shard, -1)),
+          global_slots_(shard_count),
+          uniform_(true)
+    {
+    }
+
+    int shard_count() const { return int(particles_.size()); }
+    int slots_per_shard() const { return slots_per_shard_; }
+
+    /**
+     * \brief All slots hold the same initial occlusions, any global index
+     *        can be evaluated on any shard
+     */
+    void reset()
+    {
+        uniform_ = true;
+        for (auto& globals : slot_globals_)
+        {
+            std::fill(globals.begin(), globals.end(), -1);
+        }
+        for (auto& slots : global_slots_) slots.clear();
+    }
+
+    /**
+     * \brief Assigns the particles with the given occlusion indices to the
+     *        shards. The migrations have to be carried out before the
+     *        shards evaluate their particles.
+     */
+    void assign(const int* indices, int count)
+    {
+        const int shards = shard_count();
+        if (count > shards * slots_per_shard_)
+        {
+            std::cout << "ParticleSharding: " << count << " particles exceed "
+                      << "the " << shards * slots_per_shard_
+                      << " slots of the shards" << std::endl;
+            exit(-1);
+        }
+
+        capacities_.resize(shards);
+        for (int shard = 0; shard < shards; shard++)
+        {
+            capacities_[shard] =
+                count / shards + (shard < count % shards ? 1 : 0);
+            particles_[shard].clear();
+            slots_[shard].clear();
+        }
+        migrations_.clear();
+
+        if (uniform_)
+        {
+            // contiguous slices, all slots hold the initial occlusions
+            int shard = 0;
+            for (int i = 0; i < count; i++)
+            {
+                while (int(particles_[shard].size()) == capacities_[shard])
+                {
+                    shard++;
+                }
+                place(i, shard, 0);
+            }
+        }
+        else
+        {
+            assign_to_holders(indices, count);
+        }
+
+        for (int shard = 0; shard < shards; shard++)
+        {
+            if (particles_[shard].empty()) place(-1, shard, 0);
+        }
+    }
+
+    /** \brief Particles evaluated by the shard, -1 is a dummy particle */
+    const std::vector<int>& particles(int shard) const
+    {
+        return particles_[shard];
+    }
+
+    /** \brief Occlusion slot on the shard of each of its particles */
+    const std::vector<int>& slots(int shard) const { return slots_[shard]; }
+
+    const std::vector<Migration>& migrations() const { return migrations_; }
+
+    /**
+     * \brief Records that the shards have evaluated their particles with
+     *        an occlusion update, the global indices are the particle
+     *        indices from now on
+     */
+    void commit_update(int count)
+    {
+        for (int shard = 0; shard < shard_count(); shard++)
+        {
+            std::vector<int>& globals = slot_globals_[shard];
+            std::fill(globals.begin(), globals.end(), -1);
+            std::copy(particles_[shard].begin(),
+                      particles_[shard].end(),
+                      globals.begin());
+
+            global_slots_[shard].assign(count, -1);
+            for (size_t slot = 0; slot < particles_[shard].size(); slot++)
+            {
+                const int global = globals[slot];
+                if (global >= 0) global_slots_[shard][global] = slot;
+            }
+        }
+        uniform_ = false;
+    }
+
+private:
+    void place(int particle, int shard, int slot)
+    {
+        particles_[shard].push_back(particle);
+        slots_[shard].push_back(slot);
+    }
+
+    bool has_room(int shard) const
+    {
+        return int(particles_[shard].size()) < capacities_[shard];
+    }
+
+    /** \brief Slot of the global index on the shard, -1 if not held */
+    int slot_of(int shard, int global) const
+    {
+        const std::vector<int>& slots = global_slots_[shard];
+        return global < int(slots.size()) ? slots[global] : -1;
+    }
+
+    void assign_to_holders(const int* indices, int count)
+    {
+        const int shards = shard_count();
+
+        // particles whose parent occlusions are held by a shard with room
+        pending_.clear();
+        for (int i = 0; i < count; i++)
+        {
+            bool placed = false;
+            for (int shard = 0; shard < shards && !placed; shard++)
+            {
+                const int slot = slot_of(shard, indices[i]);
+                if (slot >= 0 && has_room(shard))
+                {
+                    place(i, shard, slot);
+                    placed = true;
+                }
+            }
+            if (!placed) pending_.push_back(i);
+        }
+        if (pending_.empty()) return;
+
+        // the slots used by the placed particles are taken, the others
+        // are free for migrated occlusions
+        used_.assign(shards, std::vector<bool>(slots_per_shard_, false));
+        for (int shard = 0; shard < shards; shard++)
+        {
+            for (int slot : slots_[shard]) used_[shard][slot] = true;
+        }
+
+        // the remaining particles go to shards with room. A shard never
+        // receives more particles than slots, hence it has a free slot
+        // whenever it has room.
+        imports_.clear();
+        for (int i : pending_)
+        {
+            const int global = indices[i];
+
+            int shard = -1;
+            int slot = -1;
+            for (const Import& import : imports_)
+            {
+                if (import.global == global && has_room(import.shard))
+                {
+                    shard = import.shard;
+                    slot = import.slot;
+                    break;
+                }
+            }
+
+            if (shard < 0)
+            {
+                Migration migration;
+                migration.source_shard = -1;
+                for (int source = 0; source < shards; source++)
+                {
+                    const int source_slot = slot_of(source, global);
+                    if (source_slot >= 0)
+                    {
+                        migration.source_shard = source;
+                        migration.source_slot = source_slot;
+                        break;
+                    }
+                }
+                if (migration.source_shard < 0)
+                {
+                    std::cout << "ParticleSharding: no shard holds the "
+                              << "occlusions " << global << std::endl;
+                    exit(-1);
+                }
+
+                while (!has_room(++shard))
+                {
+                }
+                slot = int(std::find(used_[shard].begin(),
+                                     used_[shard].end(),
+                                     false) -
+                           used_[shard].begin());
+                used_[shard][slot] = true;
+
+                migration.shard = shard;
+                migration.slot = slot;
+                migrations_.push_back(migration);
+                imports_.push_back({global, shard, slot});
+            }
+
+            place(i, shard, slot);
+        }
+
+        // the sources are read before any slot is overwritten, the mapping
+        // is updated only now such that all sources above were valid
+        for (const Import& import : imports_)
+        {
+            int& previous = slot_globals_[import.shard][import.slot];
+            if (previous >= 0) global_slots_[import.shard][previous] = -1;
+            previous = import.global;
+            global_slots_[import.shard][import.global] = import.slot;
+        }
+    }
+
+private:
+    struct Import
+    {
+        int global;
+        int shard;
+        int slot;
+    };
+
+    int slots_per_shard_;
+
+    // assignment of the last call
+    std::vector<int> capacities_;
+    std::vector<std::vector<int>> particles_;
+    std::vector<std::vector<int>> slots_;
+    std::vector<Migration> migrations_;
+
+    // global index held by every slot of every shard, -1 if none, and the
+    // inverse mapping
+    std::vector<std::vector<int>> slot_globals_;
+    std::vector<std::vector<int>> global_slots_;
+    bool uniform_;
+
+    // scratch of assign_to_holders()
+    std::vector<int> pending_;
+    std::vector<std::vector<bool>> used_;
+    std::vector<Import> imports_;
+};
+}
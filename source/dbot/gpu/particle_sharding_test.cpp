@@ -0,0 +1,178 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_sharding_test.cpp
+ */
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <dbot/gpu/particle_sharding.h>
+
+namespace
+{
+/**
+ * \brief Shards whose slots hold a label instead of occlusions. An update
+ *        stores the label of the parent with the particle index appended,
+ *        such that the lineage of every slot can be checked.
+ */
+struct FakeShards
+{
+    FakeShards(int shard_count, int slots)
+        : labels(shard_count, std::vector<long>(slots, 0))
+    {
+    }
+
+    /**
+     * \brief Carries out the migrations and evaluates the particles,
+     *        returns the label of every parent seen by the particles
+     */
+    std::vector<long> evaluate(const dbot::ParticleSharding& sharding,
+                               int count,
+                               bool update)
+    {
+        std::vector<long> migrated;
+        for (const auto& migration : sharding.migrations())
+        {
+            migrated.push_back(
+                labels[migration.source_shard][migration.source_slot]);
+        }
+        for (size_t k = 0; k < migrated.size(); k++)
+        {
+            const auto& migration = sharding.migrations()[k];
+            labels[migration.shard][migration.slot] = migrated[k];
+        }
+
+        std::vector<long> parents(count, -1);
+        for (int shard = 0; shard < int(labels.size()); shard++)
+        {
+            const std::vector<int>& particles = sharding.particles(shard);
+            const std::vector<int>& slots = sharding.slots(shard);
+            EXPECT_FALSE(particles.empty());
+            EXPECT_LE(particles.size(), labels[shard].size());
+
+            std::vector<long> updated(labels[shard].size(), -1);
+            for (size_t l = 0; l < particles.size(); l++)
+            {
+                if (particles[l] < 0) continue;
+                parents[particles[l]] = labels[shard][slots[l]];
+                updated[l] = labels[shard][slots[l]] * 1000 + particles[l];
+            }
+            if (update) labels[shard] = updated;
+        }
+        return parents;
+    }
+
+    std::vector<std::vector<long>> labels;
+};
+}
+
+TEST(ParticleShardingTests, particles_see_the_occlusions_of_their_parents)
+{
+    const int shard_count = 3;
+    const int count = 10;
+    dbot::ParticleSharding sharding(shard_count, 4);
+    FakeShards shards(shard_count, 4);
+
+    std::mt19937 generator(3);
+    std::vector<int> indices(count, 0);
+
+    // label of the occlusions which global index i refers to
+    std::vector<long> expected(count, 0);
+    size_t migration_count = 0;
+
+    for (int frame = 0; frame < 20; frame++)
+    {
+        for (int block = 0; block < 3; block++)
+        {
+            const bool update = block == 2;
+
+            sharding.assign(indices.data(), count);
+            migration_count += sharding.migrations().size();
+            const std::vector<long> parents =
+                shards.evaluate(sharding, count, update);
+            for (int i = 0; i < count; i++)
+            {
+                ASSERT_EQ(parents[i], expected[indices[i]]);
+            }
+
+            if (update)
+            {
+                sharding.commit_update(count);
+                for (int i = 0; i < count; i++)
+                {
+                    expected[i] = parents[i] * 1000 + i;
+                    indices[i] = i;
+                }
+                // wrap the labels around before they overflow
+                if (frame % 2 == 1)
+                {
+                    sharding.reset();
+                    shards = FakeShards(shard_count, 4);
+                    std::fill(expected.begin(), expected.end(), 0);
+                    std::fill(indices.begin(), indices.end(), 0);
+                }
+            }
+
+            // resampling concentrated on a few particles, which are mostly
+            // held by one shard
+            std::vector<int> resampled(count);
+            std::uniform_int_distribution<int> parent(0, count / 3);
+            for (int i = 0; i < count; i++)
+            {
+                resampled[i] = indices[parent(generator)];
+            }
+            indices = resampled;
+        }
+    }
+    EXPECT_GT(migration_count, 0u);
+}
+
+TEST(ParticleShardingTests, resampled_particles_stay_on_their_shard)
+{
+    dbot::ParticleSharding sharding(2, 4);
+    std::vector<int> indices(8, 0);
+
+    sharding.assign(indices.data(), 8);
+    sharding.commit_update(8);
+
+    // every particle keeps its parent on the same shard
+    const int swapped[8] = {1, 0, 3, 2, 5, 4, 7, 6};
+    sharding.assign(swapped, 8);
+    EXPECT_TRUE(sharding.migrations().empty());
+
+    // half of the second shard descends from the first one
+    const int shifted[8] = {0, 1, 2, 3, 0, 1, 6, 7};
+    sharding.assign(shifted, 8);
+    ASSERT_EQ(sharding.migrations().size(), 2u);
+    for (const auto& migration : sharding.migrations())
+    {
+        EXPECT_EQ(migration.source_shard, 0);
+        EXPECT_EQ(migration.shard, 1);
+    }
+}
+
+TEST(ParticleShardingTests, idle_shards_evaluate_a_dummy)
+{
+    dbot::ParticleSharding sharding(4, 2);
+    std::vector<int> indices(2, 0);
+
+    sharding.assign(indices.data(), 2);
+    for (int shard = 2; shard < 4; shard++)
+    {
+        ASSERT_EQ(sharding.particles(shard).size(), 1u);
+        EXPECT_EQ(sharding.particles(shard)[0], -1);
+    }
+}
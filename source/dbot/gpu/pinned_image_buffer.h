@@ -0,0 +1,174 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pinned_image_buffer.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <Eigen/Core>
+#include <cuda_runtime.h>
+
+namespace dbot
+{
+/**
+ * \brief Caller owned pinned host memory for up to capacity images, which
+ *        KinectImageModelGPU copies range images or occlusions into without
+ *        blocking.
+ *
+ * A copy is issued on the compute stream of the sensor and completes
+ * asynchronously, ready() tells whether it has, wait() blocks until it has.
+ * The images stay valid until the next copy into the buffer is issued, which
+ * first waits for the previous one. Meant for visualization and logging,
+ * which then never stall the tracking and never reallocate.
+ */
+class PinnedImageBuffer
+{
+public:
+    typedef Eigen::
+        Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+            Image;
+    typedef Eigen::Map<const Image> ImageView;
+
+public:
+    PinnedImageBuffer(int nr_rows, int nr_cols, int capacity)
+        : nr_rows_(nr_rows),
+          nr_cols_(nr_cols),
+          capacity_(capacity),
+          data_(NULL),
+          pending_(false)
+    {
+        cudaHostAlloc((void**)&data_,
+                      sizeof(float) * image_size() * capacity_,
+                      cudaHostAllocDefault);
+        cudaEventCreateWithFlags(&copied_, cudaEventDisableTiming);
+    }
+
+    ~PinnedImageBuffer()
+    {
+        wait();
+        cudaEventDestroy(copied_);
+        cudaFreeHost(data_);
+    }
+
+    PinnedImageBuffer(const PinnedImageBuffer&) = delete;
+    PinnedImageBuffer& operator=(const PinnedImageBuffer&) = delete;
+
+    int nr_rows() const { return nr_rows_; }
+    int nr_cols() const { return nr_cols_; }
+    int image_size() const { return nr_rows_ * nr_cols_; }
+    int capacity() const { return capacity_; }
+
+    /** \brief Number of images of the last copy */
+    int size() const { return int(indices_.size()); }
+
+    /**
+     * \brief Pose or occlusion slot of every image of the last copy, image i
+     *        belongs to indices()[i]
+     */
+    const std::vector<int>& indices() const { return indices_; }
+
+    /** \brief Whether the last copy has completed */
+    bool ready() const
+    {
+        return !pending_ || cudaEventQuery(copied_) == cudaSuccess;
+    }
+
+    /** \brief Blocks until the last copy has completed */
+    void wait() const
+    {
+        if (pending_) cudaEventSynchronize(copied_);
+    }
+
+    /**
+     * \brief Image i of the last copy in row major order, only to be read
+     *        once ready()
+     */
+    const float* image(int i) const
+    {
+        return data_ + size_t(i) * image_size();
+    }
+
+    /**
+     * \brief Image i of the last copy as an nr_rows x nr_cols matrix, only
+     *        to be read once ready()
+     */
+    ImageView view(int i) const
+    {
+        return ImageView(image(i), nr_rows_, nr_cols_);
+    }
+
+    /**
+     * \brief Starts a copy of the images of the given indices. Waits for the
+     *        previous copy and returns the memory to copy into.
+     */
+    float* begin_copy(const std::vector<int>& indices)
+    {
+        if (int(indices.size()) > capacity_)
+        {
+            std::cout << "ERROR: PinnedImageBuffer holds " << capacity_
+                      << " images, " << indices.size() << " were requested."
+                      << std::endl;
+            exit(-1);
+        }
+
+        wait();
+        indices_ = indices;
+        return data_;
+    }
+
+    /**
+     * \brief Marks the end of the copy issued on the stream since
+     *        begin_copy()
+     */
+    void end_copy(cudaStream_t stream)
+    {
+        cudaEventRecord(copied_, stream);
+        pending_ = true;
+    }
+
+private:
+    int nr_rows_;
+    int nr_cols_;
+    int capacity_;
+    float* data_;
+    cudaEvent_t copied_;
+    bool pending_;
+    std::vector<int> indices_;
+};
+
+/**
+ * \brief Indices of the count highest weights in descending order of the
+ *        weights, e.g. the particles a visualization shows
+ */
+template <typename Scalar>
+std::vector<int> best_indices(const Scalar* weights, int size, int count)
+{
+    count = std::min(count, size);
+    std::vector<int> indices(size);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::partial_sort(indices.begin(),
+                      indices.begin() + count,
+                      indices.end(),
+                      [&](int a, int b) { return weights[a] > weights[b]; });
+    indices.resize(count);
+    return indices;
+}
+}
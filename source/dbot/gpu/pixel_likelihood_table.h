@@ -0,0 +1,302 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pixel_likelihood_table.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief Tabulated pixel likelihoods of the CUDA evaluator.
+ *
+ * The table samples the likelihood of an observation given a visible and
+ * an occluded prediction on a regular grid over the observed depth and the
+ * difference prediction - observation, and the likelihood given no
+ * intersection over the observed depth. The kernel reads it through a
+ * texture with linear filtering, which replaces the exponentials, the error
+ * function and the divisions of the analytic model by a single fetch.
+ *
+ * The analytic model and the filtering of the texture unit, including its
+ * 8 bit fractional weights, are reproduced on the host, such that the error
+ * of the table can be bounded before it is used.
+ */
+class PixelLikelihoodTable
+{
+public:
+    /**
+     * \brief Parameters of the pixel model, see CudaEvaluator::init(), and
+     *        of the grid
+     */
+    struct Parameters
+    {
+        Parameters()
+            : tail_weight(0.01f),
+              model_sigma(0.003f),
+              sigma_factor(0.0014247f),
+              max_depth(6.0f),
+              exponential_rate(-std::log(0.5f)),
+              observation_steps(512),
+              difference_steps(512),
+              max_difference(0.1f)
+        {
+        }
+
+        float tail_weight;
+        float model_sigma;
+        float sigma_factor;
+        float max_depth;
+        float exponential_rate;
+
+        /** samples of the observed depth in [0, max_depth] */
+        int observation_steps;
+
+        /** samples of the difference in [-max_difference, max_difference] */
+        int difference_steps;
+        float max_difference;
+    };
+
+    /**
+     * \brief Likelihoods stored in one texel
+     */
+    struct Entry
+    {
+        float visible;
+        float occluded;
+        float no_intersection;
+        float unused;
+    };
+
+public:
+    explicit PixelLikelihoodTable(const Parameters& parameters)
+        : parameters_(parameters)
+    {
+        const Parameters& p = parameters_;
+        observation_step_ = p.max_depth / (p.observation_steps - 1);
+        difference_step_ = 2 * p.max_difference / (p.difference_steps - 1);
+
+        entries_.resize(p.observation_steps * p.difference_steps);
+        for (int row = 0; row < p.observation_steps; row++)
+        {
+            const double observation = row * observation_step_;
+            for (int col = 0; col < p.difference_steps; col++)
+            {
+                const double difference =
+                    col * difference_step_ - p.max_difference;
+                Entry& entry = entries_[row * p.difference_steps + col];
+                entry.visible = visible(observation, difference);
+                entry.occluded = occluded(observation, difference);
+                entry.no_intersection = no_intersection(observation);
+                entry.unused = 0;
+            }
+        }
+    }
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /**
+     * \brief Row major texels, one row per observed depth
+     */
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    /** \brief Texel coordinate scale of the observed depth */
+    float observation_scale() const { return 1.f / observation_step_; }
+
+    /** \brief Texel coordinate scale of the difference */
+    float difference_scale() const { return 1.f / difference_step_; }
+
+    /**
+     * \brief Likelihood given a visible prediction at observation +
+     *        difference
+     */
+    double visible(double observation, double difference) const
+    {
+        const Parameters& p = parameters_;
+        const double sigma = this->sigma(observation);
+        return p.tail_weight / p.max_depth +
+               (1 - p.tail_weight) *
+                   std::exp(-difference * difference / (2 * sigma * sigma)) /
+                   (std::sqrt(2 * M_PI) * sigma);
+    }
+
+    /**
+     * \brief Likelihood given an occluded prediction at observation +
+     *        difference
+     */
+    double occluded(double observation, double difference) const
+    {
+        const Parameters& p = parameters_;
+        const double sigma = this->sigma(observation);
+        const double rate = p.exponential_rate;
+
+        // the grid extends to predictions in front of the camera which never
+        // occur, the smallest positive depth keeps the model finite there
+        const double prediction =
+            std::max(observation + difference, 1e-3 * observation_step_);
+        difference = prediction - observation;
+
+        return p.tail_weight / p.max_depth +
+               (1 - p.tail_weight) * rate *
+                   std::exp(0.5 * rate *
+                            (2 * difference + rate * sigma * sigma)) *
+                   (1 + std::erf((difference + rate * sigma * sigma) /
+                                 (std::sqrt(2.) * sigma))) /
+                   (2 * (std::exp(prediction * rate) - 1));
+    }
+
+    /**
+     * \brief Likelihood given no intersection
+     */
+    double no_intersection(double observation) const
+    {
+        const Parameters& p = parameters_;
+        const double sigma = this->sigma(observation);
+        const double rate = p.exponential_rate;
+
+        return p.tail_weight / p.max_depth +
+               (1 - p.tail_weight) * rate *
+                   std::exp(0.5 * rate *
+                            (-2 * observation + rate * sigma * sigma));
+    }
+
+    /**
+     * \brief Filtered lookup as performed by the texture unit, coordinates
+     *        outside of the grid are clamped
+     */
+    Entry lookup(float observation, float difference) const
+    {
+        const Parameters& p = parameters_;
+        float x = (difference + p.max_difference) / difference_step_;
+        float y = observation / observation_step_;
+        x = std::min(std::max(x, 0.f), float(p.difference_steps - 1));
+        y = std::min(std::max(y, 0.f), float(p.observation_steps - 1));
+
+        const int col = std::min(int(x), p.difference_steps - 2);
+        const int row = std::min(int(y), p.observation_steps - 2);
+
+        // the texture unit stores the weights with 8 fractional bits
+        const float a = std::round((x - col) * 256.f) / 256.f;
+        const float b = std::round((y - row) * 256.f) / 256.f;
+
+        const Entry& e00 = entries_[row * p.difference_steps + col];
+        const Entry& e01 = entries_[row * p.difference_steps + col + 1];
+        const Entry& e10 = entries_[(row + 1) * p.difference_steps + col];
+        const Entry& e11 = entries_[(row + 1) * p.difference_steps + col + 1];
+
+        Entry entry;
+        entry.visible = interpolate(
+            e00.visible, e01.visible, e10.visible, e11.visible, a, b);
+        entry.occluded = interpolate(
+            e00.occluded, e01.occluded, e10.occluded, e11.occluded, a, b);
+        entry.no_intersection = interpolate(e00.no_intersection,
+                                            e01.no_intersection,
+                                            e10.no_intersection,
+                                            e11.no_intersection,
+                                            a,
+                                            b);
+        entry.unused = 0;
+        return entry;
+    }
+
+    /**
+     * \brief Largest relative error of the filtered likelihoods, evaluated
+     *        at the given number of points per cell and direction over the
+     *        observed depths in [min_observation, max_depth].
+     *
+     * The per pixel log likelihood ratio of the evaluator is a ratio of
+     * mixtures of these likelihoods, its error is therefore at most
+     * log((1 + e) / (1 - e)) for a relative error e, see
+     * log_likelihood_error().
+     */
+    double max_relative_error(float min_observation,
+                              int points_per_cell = 4) const
+    {
+        const Parameters& p = parameters_;
+        double max_error = 0;
+
+        const int rows = (p.observation_steps - 1) * points_per_cell;
+        const int cols = (p.difference_steps - 1) * points_per_cell;
+        for (int row = 0; row <= rows; row++)
+        {
+            const double observation =
+                row * observation_step_ / points_per_cell;
+            if (observation < min_observation) continue;
+
+            for (int col = 0; col <= cols; col++)
+            {
+                const double difference =
+                    col * difference_step_ / points_per_cell -
+                    p.max_difference;
+                const Entry entry = lookup(observation, difference);
+
+                max_error = std::max(
+                    max_error,
+                    relative_error(entry.visible,
+                                   visible(observation, difference)));
+                max_error = std::max(
+                    max_error,
+                    relative_error(entry.occluded,
+                                   occluded(observation, difference)));
+                max_error = std::max(
+                    max_error,
+                    relative_error(entry.no_intersection,
+                                   no_intersection(observation)));
+            }
+        }
+
+        return max_error;
+    }
+
+    /**
+     * \brief Bound on the error of the per pixel log likelihood given the
+     *        relative error of the likelihoods
+     */
+    static double log_likelihood_error(double relative_error)
+    {
+        if (relative_error >= 1) return std::numeric_limits<double>::infinity();
+        return std::log((1 + relative_error) / (1 - relative_error));
+    }
+
+private:
+    double sigma(double observation) const
+    {
+        return parameters_.model_sigma +
+               parameters_.sigma_factor * observation * observation;
+    }
+
+    static float interpolate(
+        float v00, float v01, float v10, float v11, float a, float b)
+    {
+        return (1 - b) * ((1 - a) * v00 + a * v01) +
+               b * ((1 - a) * v10 + a * v11);
+    }
+
+    static double relative_error(double approximation, double exact)
+    {
+        return std::fabs(approximation - exact) / exact;
+    }
+
+private:
+    Parameters parameters_;
+    float observation_step_;
+    float difference_step_;
+    std::vector<Entry> entries_;
+};
+}
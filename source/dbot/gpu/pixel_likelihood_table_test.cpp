@@ -0,0 +1,57 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pixel_likelihood_table_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <dbot/gpu/pixel_likelihood_table.h>
+
+TEST(PixelLikelihoodTableTests, texels_match_analytic_model)
+{
+    dbot::PixelLikelihoodTable::Parameters parameters;
+    parameters.observation_steps = 64;
+    parameters.difference_steps = 65;
+    dbot::PixelLikelihoodTable table(parameters);
+
+    // the center column has zero difference, the texel is exact there
+    const int row = 40;
+    const float observation = row / table.observation_scale();
+    const auto& entry = table.entries()[row * 65 + 32];
+    EXPECT_NEAR(entry.visible, table.visible(observation, 0), 1e-3);
+    EXPECT_NEAR(entry.occluded, table.occluded(observation, 0), 1e-4);
+    EXPECT_NEAR(
+        entry.no_intersection, table.no_intersection(observation), 1e-4);
+
+    const auto lookup = table.lookup(observation, 0);
+    EXPECT_FLOAT_EQ(lookup.visible, entry.visible);
+}
+
+TEST(PixelLikelihoodTableTests, default_table_error_bound)
+{
+    dbot::PixelLikelihoodTable::Parameters parameters;
+    dbot::PixelLikelihoodTable table(parameters);
+
+    const double relative_error = table.max_relative_error(0.3f, 2);
+    EXPECT_LT(relative_error, 0.05);
+    EXPECT_LT(dbot::PixelLikelihoodTable::log_likelihood_error(relative_error),
+              0.1);
+
+    // a coarser grid is less accurate
+    dbot::PixelLikelihoodTable::Parameters coarse_parameters;
+    coarse_parameters.difference_steps = 64;
+    dbot::PixelLikelihoodTable coarse(coarse_parameters);
+    EXPECT_GT(coarse.max_relative_error(0.3f, 2), relative_error);
+}
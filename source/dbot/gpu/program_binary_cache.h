@@ -0,0 +1,206 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file program_binary_cache.h
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace dbot
+{
+/**
+ * \brief Persists linked shader program binaries across runs.
+ *
+ * The key holds everything the binary depends on, i.e. the vendor, renderer
+ * and version strings of the driver and the sources of all stages. Each
+ * entry is a file named by the hash of its key which also stores the key
+ * itself, such that a hash collision reads as a miss. Stores write through
+ * a temporary file, a concurrently starting process never reads a partial
+ * binary.
+ */
+class ProgramBinaryCache
+{
+public:
+    /**
+     * \param directory  of the entries, created by the first store. An
+     *                   empty directory disables the cache.
+     */
+    explicit ProgramBinaryCache(const std::string& directory)
+        : directory_(directory)
+    {
+    }
+
+    const std::string& directory() const { return directory_; }
+
+    bool enabled() const { return !directory_.empty(); }
+
+    /**
+     * \brief DBOT_SHADER_CACHE if it is set, where an empty value disables
+     *        the cache, else a directory in the home directory, else none
+     */
+    static std::string default_directory()
+    {
+        const char* directory = std::getenv("DBOT_SHADER_CACHE");
+        if (directory) return directory;
+
+        const char* home = std::getenv("HOME");
+        return home ? std::string(home) + "/.dbot_shader_cache" : "";
+    }
+
+    /** \brief File of the entry of the key */
+    std::string path(const std::string& key) const
+    {
+        // FNV-1a, std::hash is not guaranteed to be stable across builds
+        std::uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : key)
+        {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+        return directory_ + "/" + name;
+    }
+
+    /**
+     * \brief Looks up the binary and its driver specific format, returns
+     *        false if the key is not cached
+     */
+    bool find(const std::string& key,
+              std::uint32_t& format,
+              std::vector<char>& binary) const
+    {
+        if (!enabled()) return false;
+
+        std::ifstream file(path(key).c_str(), std::ios::binary);
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, magic(), sizeof(header.magic)) != 0 ||
+            header.key_size != key.size())
+        {
+            return false;
+        }
+
+        std::string stored_key(key.size(), '\0');
+        if (!file.read(&stored_key[0], stored_key.size()) ||
+            stored_key != key)
+        {
+            return false;
+        }
+
+        // a truncated file must not be handed to the driver
+        const std::streampos begin = file.tellg();
+        file.seekg(0, std::ios::end);
+        if (std::uint64_t(file.tellg() - begin) != header.binary_size)
+        {
+            return false;
+        }
+        file.seekg(begin);
+
+        binary.resize(header.binary_size);
+        if (!file.read(binary.data(), binary.size())) return false;
+
+        format = header.format;
+        return true;
+    }
+
+    /**
+     * \brief Adds or replaces the entry, returns false if the file cannot be
+     *        written
+     */
+    bool store(const std::string& key,
+               std::uint32_t format,
+               const std::vector<char>& binary) const
+    {
+        if (!enabled()) return false;
+
+        // a single level, the parent is the home directory by default
+        if (!make_directory()) return false;
+
+        Header header;
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.format = format;
+        header.key_size = key.size();
+        header.binary_size = binary.size();
+
+        const std::string entry_path = path(key);
+        const std::string tmp_path = entry_path + ".tmp";
+        {
+            std::ofstream file(tmp_path.c_str(), std::ios::binary);
+            if (!file) return false;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(key.data(), key.size());
+            file.write(binary.data(), binary.size());
+            if (!file)
+            {
+                file.close();
+                std::remove(tmp_path.c_str());
+                return false;
+            }
+        }
+
+        return std::rename(tmp_path.c_str(), entry_path.c_str()) == 0;
+    }
+
+private:
+    /**
+     * \brief Creates the cache directory unless it exists, reports why it
+     *        cannot be used otherwise
+     */
+    bool make_directory() const
+    {
+        if (mkdir(directory_.c_str(), 0755) == 0) return true;
+
+        const int error = errno;
+        struct stat status;
+        if (error == EEXIST && stat(directory_.c_str(), &status) == 0 &&
+            S_ISDIR(status.st_mode))
+        {
+            return true;
+        }
+
+        std::cout << "ProgramBinaryCache: cannot use " << directory_ << ": "
+                  << (error == EEXIST ? "not a directory"
+                                      : std::strerror(error))
+                  << std::endl;
+        return false;
+    }
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t format;
+        std::uint32_t reserved = 0;
+        std::uint64_t key_size;
+        std::uint64_t binary_size;
+    };
+
+    static const char* magic() { return "DBOTPRGB"; }
+
+private:
+    std::string directory_;
+};
+}
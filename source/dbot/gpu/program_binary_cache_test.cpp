@@ -0,0 +1,124 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file program_binary_cache_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+#include <dbot/gpu/program_binary_cache.h>
+
+namespace
+{
+/**
+ * \brief Fresh directory under /tmp, independent of the working directory
+ *        in which a file may have the name of the cache
+ */
+std::string temporary_directory()
+{
+    char name[] = "/tmp/program_binary_cache_XXXXXX";
+    return mkdtemp(name) ? name : "";
+}
+}
+
+TEST(ProgramBinaryCacheTests, stores_and_replaces_entries)
+{
+    const std::string directory = temporary_directory();
+    ASSERT_FALSE(directory.empty());
+    dbot::ProgramBinaryCache cache(directory);
+    const std::string key_a = "vendor\nrenderer\n4.5\nvertex a";
+    const std::string key_b = "vendor\nrenderer\n4.5\nvertex b";
+    ASSERT_NE(cache.path(key_a), cache.path(key_b));
+
+    std::uint32_t format = 0;
+    std::vector<char> binary;
+    EXPECT_FALSE(cache.find(key_a, format, binary));
+
+    ASSERT_TRUE(cache.store(key_a, 7, std::vector<char>{1, 2, 3}));
+    ASSERT_TRUE(cache.store(key_b, 8, std::vector<char>{4}));
+    ASSERT_TRUE(cache.store(key_a, 9, std::vector<char>{5, 6}));
+
+    // a new instance reads the files written by the first one
+    dbot::ProgramBinaryCache reloaded(directory);
+    ASSERT_TRUE(reloaded.find(key_a, format, binary));
+    EXPECT_EQ(format, 9u);
+    EXPECT_EQ(binary, std::vector<char>({5, 6}));
+    ASSERT_TRUE(reloaded.find(key_b, format, binary));
+    EXPECT_EQ(format, 8u);
+    EXPECT_EQ(binary, std::vector<char>({4}));
+
+    std::remove(cache.path(key_a).c_str());
+    std::remove(cache.path(key_b).c_str());
+    rmdir(directory.c_str());
+}
+
+TEST(ProgramBinaryCacheTests, rejects_other_keys_and_truncated_files)
+{
+    const std::string directory = temporary_directory();
+    ASSERT_FALSE(directory.empty());
+    dbot::ProgramBinaryCache cache(directory);
+    const std::string key = "vendor\nrenderer\n4.5\nfragment";
+    ASSERT_TRUE(cache.store(key, 1, std::vector<char>(64, 'x')));
+
+    // an entry found under the hash of another key is a miss
+    const std::string path = cache.path(key);
+    const std::string other_key = "vendor\nrenderer\n4.6\nfragment";
+    std::rename(path.c_str(), cache.path(other_key).c_str());
+    std::uint32_t format = 0;
+    std::vector<char> binary;
+    EXPECT_FALSE(cache.find(other_key, format, binary));
+    std::rename(cache.path(other_key).c_str(), path.c_str());
+    EXPECT_TRUE(cache.find(key, format, binary));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+    std::ofstream(path.c_str(), std::ios::binary)
+        .write(content.data(), content.size() - 1);
+    EXPECT_FALSE(cache.find(key, format, binary));
+
+    std::remove(path.c_str());
+    rmdir(directory.c_str());
+}
+
+TEST(ProgramBinaryCacheTests, empty_directory_disables_the_cache)
+{
+    dbot::ProgramBinaryCache cache("");
+    EXPECT_FALSE(cache.enabled());
+    EXPECT_FALSE(cache.store("key", 1, std::vector<char>{1}));
+
+    std::uint32_t format = 0;
+    std::vector<char> binary;
+    EXPECT_FALSE(cache.find("key", format, binary));
+}
+
+TEST(ProgramBinaryCacheTests, file_in_place_of_the_directory_fails_to_store)
+{
+    const std::string directory = temporary_directory();
+    ASSERT_FALSE(directory.empty());
+    const std::string file_path = directory + "/cache";
+    std::ofstream(file_path.c_str()) << "not a directory";
+
+    dbot::ProgramBinaryCache cache(file_path);
+    EXPECT_FALSE(cache.store("key", 1, std::vector<char>{1}));
+
+    std::remove(file_path.c_str());
+    rmdir(directory.c_str());
+}
@@ -99,9 +99,14 @@ GLuint CreateShader(GLenum eShaderType, const std::string& shaderCode)
 // source:
 // http://www.arcsynthesis.org/gltut/Basics/Tut01%20Making%20Shaders.html, Jason
 // L. McKesson, 2012
-GLuint CreateProgram(const std::vector<GLuint>& shaderList)
+GLuint CreateProgram(const std::vector<GLuint>& shaderList, bool retrievable)
 {
     GLuint program = glCreateProgram();
+    if (retrievable)
+    {
+        glProgramParameteri(
+            program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
     for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
         glAttachShader(program, shaderList[iLoop]);
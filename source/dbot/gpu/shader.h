@@ -27,4 +27,6 @@
 
 GLuint LoadShaders(const std::shared_ptr<dbot::ShaderProvider>& shaderProvider);
 GLuint CreateShader(GLenum eShaderType, const std::string& shaderCode);
-GLuint CreateProgram(const std::vector<GLuint>& shaderList);
+// retrievable programs can be read back with glGetProgramBinary
+GLuint CreateProgram(const std::vector<GLuint>& shaderList,
+                     bool retrievable = false);
@@ -0,0 +1,319 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file sigma_point_moments.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace dbot
+{
+/**
+ * \brief Unscented linearization of the body/tail pixel model of the
+ *        Gaussian tracker as reduced by the CUDA evaluator.
+ *
+ * The host computes the sigma points of the belief and the coefficients
+ * which only depend on them. The GPU renders the sigma points, determines
+ * the mean and variance of every pixel under each of them and sums the
+ * information matrix and vector of all pixels, see
+ * CudaEvaluator::reduce_sigma_point_moments(). Only these sums are copied
+ * back, from which the posterior is solved here.
+ *
+ * The per pixel computation of the kernel is reproduced by accumulate(),
+ * such that the reduction can be checked without a GPU.
+ */
+class SigmaPointMoments
+{
+public:
+    typedef Eigen::VectorXd Vector;
+    typedef Eigen::MatrixXd Matrix;
+
+    enum
+    {
+        /** the kernel keeps the gains of a pixel in registers */
+        max_dimension = 12,
+        max_point_count = 2 * max_dimension + 1
+    };
+
+    /**
+     * \brief Body/tail pixel model, see GaussianTrackerBuilder::Parameters::
+     *        Observation
+     */
+    struct Parameters
+    {
+        Parameters()
+            : bg_depth(-1.0),
+              fg_noise_std(0.001),
+              bg_noise_std(0.0005),
+              tail_weight(0.01),
+              uniform_tail_min(0.0),
+              uniform_tail_max(6.0)
+        {
+        }
+
+        /** depth of the pixels the object does not cover, a negative value
+         *  puts them at uniform_tail_max */
+        double bg_depth;
+        double fg_noise_std;
+        double bg_noise_std;
+        double tail_weight;
+        double uniform_tail_min;
+        double uniform_tail_max;
+    };
+
+public:
+    /**
+     * \param alpha, beta, kappa	parameters of the unscented transform
+     */
+    explicit SigmaPointMoments(const Parameters& parameters,
+                               double alpha = 1.0,
+                               double beta = 2.0,
+                               double kappa = 0.0)
+        : alpha_(alpha), beta_(beta), kappa_(kappa), dimension_(0)
+    {
+        bg_depth_ = parameters.bg_depth < 0 ? parameters.uniform_tail_max
+                                            : parameters.bg_depth;
+        fg_variance_ = parameters.fg_noise_std * parameters.fg_noise_std;
+        bg_variance_ = parameters.bg_noise_std * parameters.bg_noise_std;
+        tail_weight_ = parameters.tail_weight;
+
+        const double width =
+            parameters.uniform_tail_max - parameters.uniform_tail_min;
+        tail_mean_ =
+            0.5 * (parameters.uniform_tail_min + parameters.uniform_tail_max);
+        tail_variance_ = width * width / 12.0;
+    }
+
+    /** \brief Number of sums of a state dimension, see accumulate() */
+    static int sum_count(int dimension)
+    {
+        return dimension * (dimension + 1) / 2 + dimension;
+    }
+
+    /**
+     * \brief Computes the sigma points of the belief and the coefficients
+     *        of the linearization
+     */
+    void linearize(const Vector& mean, const Matrix& covariance)
+    {
+        dimension_ = mean.size();
+        if (dimension_ > max_dimension)
+        {
+            std::cout << "ERROR: the GPU Gaussian sensor supports at most "
+                      << int(max_dimension) << " state dimensions, got "
+                      << dimension_ << std::endl;
+            exit(-1);
+        }
+
+        const int n = point_count();
+        const double lambda =
+            alpha_ * alpha_ * (dimension_ + kappa_) - dimension_;
+
+        // the square root through the eigen decomposition also holds for a
+        // semi definite covariance
+        const Eigen::SelfAdjointEigenSolver<Matrix> solver(covariance);
+        const Matrix root =
+            solver.eigenvectors() *
+            solver.eigenvalues().cwiseMax(0).cwiseSqrt().asDiagonal() *
+            std::sqrt(dimension_ + lambda);
+
+        mean_ = mean;
+        points_.resize(dimension_, n);
+        points_.col(0) = mean;
+        for (int i = 0; i < dimension_; i++)
+        {
+            points_.col(1 + i) = mean + root.col(i);
+            points_.col(1 + dimension_ + i) = mean - root.col(i);
+        }
+
+        Vector mean_weights =
+            Vector::Constant(n, 0.5 / (dimension_ + lambda));
+        mean_weights(0) = lambda / (dimension_ + lambda);
+        Vector covariance_weights = mean_weights;
+        covariance_weights(0) += 1 - alpha_ * alpha_ + beta_;
+
+        prior_.compute(covariance);
+        const Matrix weighted_deviations =
+            (points_.colwise() - mean) * covariance_weights.asDiagonal();
+        const Matrix gains = prior_.solve(weighted_deviations);
+
+        coefficients_.resize(2 * n + 2 * dimension_ * n);
+        float* c = coefficients_.data();
+        for (int p = 0; p < n; p++) *c++ = mean_weights(p);
+        for (int p = 0; p < n; p++) *c++ = covariance_weights(p);
+        for (int p = 0; p < n; p++)
+        {
+            for (int i = 0; i < dimension_; i++)
+            {
+                *c++ = weighted_deviations(i, p);
+            }
+        }
+        for (int p = 0; p < n; p++)
+        {
+            for (int i = 0; i < dimension_; i++) *c++ = gains(i, p);
+        }
+    }
+
+    int dimension() const { return dimension_; }
+    int point_count() const { return 2 * dimension_ + 1; }
+
+    /** \brief Sigma points of the last linearize() call, one per column */
+    const Matrix& points() const { return points_; }
+
+    /**
+     * \brief Coefficients of the kernel: the mean weights and the
+     *        covariance weights of the points, then per point the weighted
+     *        deviations from the mean and the gains, i.e. the weighted
+     *        deviations premultiplied with the inverse prior covariance
+     */
+    const std::vector<float>& coefficients() const { return coefficients_; }
+
+    /**
+     * \brief Mean and variance of the observation of a pixel with the
+     *        rendered depth, 0 if the object does not cover it
+     */
+    void pixel_moments(float depth, float& mean, float& variance) const
+    {
+        const bool background = depth == 0;
+        const float body_mean = background ? bg_depth_ : depth;
+        const float body_variance = background ? bg_variance_ : fg_variance_;
+
+        // the variance of the mixture without the cancellation of the
+        // second moment minus the squared mean
+        const float difference = body_mean - tail_mean_;
+        mean = body_mean - tail_weight_ * difference;
+        variance = (1 - tail_weight_) * body_variance +
+                   tail_weight_ * tail_variance_ +
+                   tail_weight_ * (1 - tail_weight_) * difference * difference;
+    }
+
+    /**
+     * \brief Adds the information of a pixel given its rendered depth under
+     *        every sigma point to the sums, as done by the kernel.
+     *
+     * The sums hold the upper triangle of the information matrix row by
+     * row, followed by the information vector.
+     */
+    void accumulate(float observation, const float* depths, double* sums) const
+    {
+        if (!std::isfinite(observation)) return;
+
+        const int n = point_count();
+        const float* mean_weights = coefficients_.data();
+        const float* covariance_weights = mean_weights + n;
+        const float* weighted_deviations = covariance_weights + n;
+        const float* gains = weighted_deviations + dimension_ * n;
+
+        float means[max_point_count];
+        float prediction = 0;
+        float variance = 0;
+        for (int p = 0; p < n; p++)
+        {
+            float point_variance;
+            pixel_moments(depths[p], means[p], point_variance);
+            prediction += mean_weights[p] * means[p];
+            variance += mean_weights[p] * point_variance;
+        }
+
+        float cross[max_dimension] = {0};
+        float gain[max_dimension] = {0};
+        for (int p = 0; p < n; p++)
+        {
+            const float deviation = means[p] - prediction;
+            variance += covariance_weights[p] * deviation * deviation;
+            for (int i = 0; i < dimension_; i++)
+            {
+                cross[i] += weighted_deviations[p * dimension_ + i] * deviation;
+                gain[i] += gains[p * dimension_ + i] * deviation;
+            }
+        }
+
+        float noise = variance;
+        for (int i = 0; i < dimension_; i++) noise -= gain[i] * cross[i];
+        if (!(noise > 0)) return;
+
+        const float residual = (observation - prediction) / noise;
+        int k = 0;
+        for (int i = 0; i < dimension_; i++)
+        {
+            for (int j = i; j < dimension_; j++)
+            {
+                sums[k++] += gain[i] * gain[j] / noise;
+            }
+        }
+        for (int i = 0; i < dimension_; i++) sums[k++] += gain[i] * residual;
+    }
+
+    /**
+     * \brief Solves the posterior of the linearized belief from the sums
+     *        of all pixels
+     */
+    void posterior(const std::vector<double>& sums,
+                   Vector& posterior_mean,
+                   Matrix& posterior_covariance) const
+    {
+        Matrix information_matrix =
+            prior_.solve(Matrix::Identity(dimension_, dimension_));
+        Vector information_vector(dimension_);
+
+        int k = 0;
+        for (int i = 0; i < dimension_; i++)
+        {
+            for (int j = i; j < dimension_; j++)
+            {
+                information_matrix(i, j) += sums[k];
+                if (i != j) information_matrix(j, i) += sums[k];
+                k++;
+            }
+        }
+        for (int i = 0; i < dimension_; i++) information_vector(i) = sums[k++];
+
+        const Eigen::LDLT<Matrix> posterior(information_matrix);
+        posterior_covariance =
+            posterior.solve(Matrix::Identity(dimension_, dimension_));
+        posterior_mean = mean_ + posterior_covariance * information_vector;
+    }
+
+    float bg_depth() const { return bg_depth_; }
+    float fg_variance() const { return fg_variance_; }
+    float bg_variance() const { return bg_variance_; }
+    float tail_weight() const { return tail_weight_; }
+    float tail_mean() const { return tail_mean_; }
+    float tail_variance() const { return tail_variance_; }
+
+private:
+    double alpha_;
+    double beta_;
+    double kappa_;
+
+    float bg_depth_;
+    float fg_variance_;
+    float bg_variance_;
+    float tail_weight_;
+    float tail_mean_;
+    float tail_variance_;
+
+    int dimension_;
+    Vector mean_;
+    Matrix points_;
+    Eigen::LDLT<Matrix> prior_;
+    std::vector<float> coefficients_;
+};
+}
@@ -0,0 +1,179 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file sigma_point_moments_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/filter/parallel_information_update.h>
+#include <dbot/gpu/sigma_point_moments.h>
+
+namespace
+{
+typedef dbot::SigmaPointMoments::Vector Vector;
+typedef dbot::SigmaPointMoments::Matrix Matrix;
+
+const int dimension = 6;
+const int pixel_count = 2000;
+
+/** depth of a pixel as an affine function of the state, every seventh
+ *  pixel is not covered by the object */
+float render(const Matrix& slopes, int pixel, const Vector& point)
+{
+    if (pixel % 7 == 0) return 0;
+    return float(1.0 + 0.01 * slopes.col(pixel).dot(point));
+}
+
+class SigmaPointMomentsTests : public ::testing::Test
+{
+protected:
+    SigmaPointMomentsTests()
+    {
+        srand(3);
+        mean = 0.1 * Vector::Random(dimension);
+        Matrix root = Matrix::Random(dimension, dimension);
+        covariance = 0.01 * (root * root.transpose() +
+                             0.1 * Matrix::Identity(dimension, dimension));
+        slopes = Matrix::Random(dimension, pixel_count);
+        observations = Vector::Constant(pixel_count, 1.0) +
+                       0.002 * Vector::Random(pixel_count);
+
+        parameters.bg_depth = 2.0;
+        parameters.fg_noise_std = 0.003;
+        parameters.bg_noise_std = 0.01;
+        parameters.tail_weight = 0.01;
+        parameters.uniform_tail_min = 0.0;
+        parameters.uniform_tail_max = 4.0;
+    }
+
+    /** reduction of all pixels as performed by the kernel */
+    void reduce(const dbot::SigmaPointMoments& moments,
+                std::vector<double>& sums) const
+    {
+        sums.assign(dbot::SigmaPointMoments::sum_count(dimension), 0);
+        std::vector<float> depths(moments.point_count());
+        for (int pixel = 0; pixel < pixel_count; pixel++)
+        {
+            for (int p = 0; p < moments.point_count(); p++)
+            {
+                depths[p] = render(slopes, pixel, moments.points().col(p));
+            }
+            moments.accumulate(observations(pixel), depths.data(), &sums[0]);
+        }
+    }
+
+    Vector mean;
+    Matrix covariance;
+    Matrix slopes;
+    Vector observations;
+    dbot::SigmaPointMoments::Parameters parameters;
+};
+
+TEST_F(SigmaPointMomentsTests, mixture_moments)
+{
+    dbot::SigmaPointMoments moments(parameters);
+
+    float mean, variance;
+    moments.pixel_moments(1.5f, mean, variance);
+
+    // second moment of the mixture minus its squared mean
+    const double w = parameters.tail_weight;
+    const double body = 1.5;
+    const double body_second = 0.003 * 0.003 + body * body;
+    const double tail_second = 16.0 / 12.0 + 2.0 * 2.0;
+    const double expected_mean = (1 - w) * body + w * 2.0;
+    EXPECT_NEAR(mean, expected_mean, 1e-6);
+    EXPECT_NEAR(variance,
+                (1 - w) * body_second + w * tail_second -
+                    expected_mean * expected_mean,
+                1e-6);
+
+    // the background takes the place of the body
+    moments.pixel_moments(0, mean, variance);
+    EXPECT_NEAR(mean, (1 - w) * 2.0 + w * 2.0, 1e-6);
+
+    parameters.bg_depth = -1;
+    dbot::SigmaPointMoments far_background(parameters);
+    EXPECT_FLOAT_EQ(far_background.bg_depth(), 4.0f);
+}
+
+TEST_F(SigmaPointMomentsTests, matches_parallel_information_update)
+{
+    // with beta = 1 - alpha^2 the mean and the covariance weights agree, as
+    // in the information update
+    const double alpha = 1.2;
+    dbot::SigmaPointMoments moments(parameters, alpha, 1 - alpha * alpha);
+    moments.linearize(mean, covariance);
+    ASSERT_EQ(moments.point_count(), 2 * dimension + 1);
+
+    std::vector<double> sums;
+    reduce(moments, sums);
+    Vector posterior_mean;
+    Matrix posterior_covariance;
+    moments.posterior(sums, posterior_mean, posterior_covariance);
+
+    const double lambda = alpha * alpha * dimension - dimension;
+    Vector weights =
+        Vector::Constant(moments.point_count(), 0.5 / (dimension + lambda));
+    weights(0) = lambda / (dimension + lambda);
+
+    const Matrix& points = moments.points();
+    dbot::ParallelInformationUpdate update;
+    Vector expected_mean;
+    Matrix expected_covariance;
+    update.update(mean,
+                  covariance,
+                  points,
+                  weights,
+                  observations,
+                  [&](int pixel, int point, double& mean, double& variance) {
+                      float m, v;
+                      moments.pixel_moments(
+                          render(slopes, pixel, points.col(point)), m, v);
+                      mean = m;
+                      variance = v;
+                  },
+                  expected_mean,
+                  expected_covariance);
+
+    // the per pixel terms are evaluated in single precision
+    EXPECT_TRUE(posterior_mean.isApprox(expected_mean, 1e-3));
+    EXPECT_TRUE(posterior_covariance.isApprox(expected_covariance, 1e-3));
+
+    // the observations are informative
+    EXPECT_LT(posterior_covariance.trace(), covariance.trace());
+}
+
+TEST_F(SigmaPointMomentsTests, background_is_not_informative)
+{
+    dbot::SigmaPointMoments moments(parameters, 1.2);
+    moments.linearize(mean, covariance);
+
+    std::vector<double> sums(dbot::SigmaPointMoments::sum_count(dimension), 0);
+    std::vector<float> depths(moments.point_count(), 0);
+    for (int pixel = 0; pixel < 100; pixel++)
+    {
+        moments.accumulate(observations(pixel), depths.data(), &sums[0]);
+    }
+
+    Vector posterior_mean;
+    Matrix posterior_covariance;
+    moments.posterior(sums, posterior_mean, posterior_covariance);
+    EXPECT_TRUE(posterior_mean.isApprox(mean, 1e-9));
+    EXPECT_TRUE(posterior_covariance.isApprox(covariance, 1e-9));
+}
+}
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
@@ -73,8 +74,8 @@ inline double get_wall_time()
 }
 
 template <typename T>
-void Compare(const std::vector<T> vector_1,
-             const std::vector<T> vector_2,
+void Compare(const std::vector<T>& vector_1,
+             const std::vector<T>& vector_2,
              char* name_1,
              char* name_2)
 {
@@ -105,8 +106,8 @@ void Compare(const std::vector<T> vector_1,
 }
 
 template <typename T>
-void AverageDifference(const std::vector<T> vector_1,
-                       const std::vector<T> vector_2,
+void AverageDifference(const std::vector<T>& vector_1,
+                       const std::vector<T>& vector_2,
                        char* name_1,
                        char* name_2)
 {
@@ -151,6 +152,23 @@ int IndexNextReal(const std::vector<T>& data,
     return index_next_real;
 }
 
+/**
+ * \brief Same as above for size values starting at data
+ */
+template <typename T>
+int IndexNextReal(const T* data,
+                  int size,
+                  int current_index = -1,
+                  int step_size = 1)
+{
+    int index_next_real = current_index + step_size;
+    while (index_next_real < size && index_next_real >= 0 &&
+           !std::isfinite(data[index_next_real]))
+        index_next_real += step_size;
+
+    return index_next_real;
+}
+
 //  various useful functions
 //  >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 class Structurer2D
@@ -160,6 +178,19 @@ public:
     ~Structurer2D() {}
     template <typename T>
     std::vector<T> Flatten(const std::vector<std::vector<T>>& deep_structure)
+    {
+        std::vector<T> flat_structure;
+        Flatten(deep_structure, flat_structure);
+        return flat_structure;
+    }
+
+    /**
+     * \brief Flattens into flat_structure, which keeps its memory between
+     *        calls of the same total size
+     */
+    template <typename T>
+    void Flatten(const std::vector<std::vector<T>>& deep_structure,
+                 std::vector<T>& flat_structure)
     {
         sizes_.resize(deep_structure.size());
         size_t global_size = 0;
@@ -169,28 +200,43 @@ public:
             global_size += deep_structure[i].size();
         }
 
-        std::vector<T> flat_structure(global_size);
+        flat_structure.resize(global_size);
         size_t global_index = 0;
         for (size_t i = 0; i < deep_structure.size(); i++)
-            for (size_t j = 0; j < deep_structure[i].size(); j++)
-                flat_structure[global_index++] = deep_structure[i][j];
-
-        return flat_structure;
+        {
+            std::copy(deep_structure[i].begin(),
+                      deep_structure[i].end(),
+                      flat_structure.begin() + global_index);
+            global_index += deep_structure[i].size();
+        }
     }
 
     template <typename T>
     std::vector<std::vector<T>> Deepen(const std::vector<T>& flat_structure)
     {
-        std::vector<std::vector<T>> deep_structure(sizes_.size());
+        std::vector<std::vector<T>> deep_structure;
+        Deepen(flat_structure, deep_structure);
+        return deep_structure;
+    }
+
+    /**
+     * \brief Restores the structure of the last Flatten() in deep_structure,
+     *        whose vectors keep their memory between calls
+     */
+    template <typename T>
+    void Deepen(const std::vector<T>& flat_structure,
+                std::vector<std::vector<T>>& deep_structure)
+    {
+        deep_structure.resize(sizes_.size());
 
         size_t global_index = 0;
         for (size_t i = 0; i < deep_structure.size(); i++)
         {
-            deep_structure[i].resize(sizes_[i]);
-            for (size_t j = 0; j < deep_structure[i].size(); j++)
-                deep_structure[i][j] = flat_structure[global_index++];
+            deep_structure[i].assign(
+                flat_structure.begin() + global_index,
+                flat_structure.begin() + global_index + sizes_[i]);
+            global_index += sizes_[i];
         }
-        return deep_structure;
     }
 
 private:
@@ -205,6 +251,20 @@ public:
     template <typename T>
     std::vector<T> Flatten(
         const std::vector<std::vector<std::vector<T>>>& deep_structure)
+    {
+        std::vector<T> flat_structure;
+        Flatten(deep_structure, flat_structure);
+        return flat_structure;
+    }
+
+    /**
+     * \brief Flattens into flat_structure, which keeps its memory between
+     *        calls of the same total size
+     */
+    template <typename T>
+    void Flatten(
+        const std::vector<std::vector<std::vector<T>>>& deep_structure,
+        std::vector<T>& flat_structure)
     {
         size_t global_size = 0;
         sizes_.resize(deep_structure.size());
@@ -218,88 +278,133 @@ public:
             }
         }
 
-        std::vector<T> flat_structure(global_size);
+        flat_structure.resize(global_size);
         size_t global_index = 0;
         for (size_t i = 0; i < deep_structure.size(); i++)
             for (size_t j = 0; j < deep_structure[i].size(); j++)
-                for (size_t k = 0; k < deep_structure[i][j].size(); k++)
-                    flat_structure[global_index++] = deep_structure[i][j][k];
-
-        return flat_structure;
+            {
+                std::copy(deep_structure[i][j].begin(),
+                          deep_structure[i][j].end(),
+                          flat_structure.begin() + global_index);
+                global_index += deep_structure[i][j].size();
+            }
     }
 
     template <typename T>
     std::vector<std::vector<std::vector<T>>> Deepen(
         const std::vector<T>& flat_structure)
+    {
+        std::vector<std::vector<std::vector<T>>> deep_structure;
+        Deepen(flat_structure, deep_structure);
+        return deep_structure;
+    }
+
+    /**
+     * \brief Restores the structure of the last Flatten() in deep_structure,
+     *        whose vectors keep their memory between calls
+     */
+    template <typename T>
+    void Deepen(const std::vector<T>& flat_structure,
+                std::vector<std::vector<std::vector<T>>>& deep_structure)
     {
         size_t global_index = 0;
-        std::vector<std::vector<std::vector<T>>> deep_structure(sizes_.size());
+        deep_structure.resize(sizes_.size());
         for (size_t i = 0; i < deep_structure.size(); i++)
         {
             deep_structure[i].resize(sizes_[i].size());
             for (size_t j = 0; j < deep_structure[i].size(); j++)
             {
-                deep_structure[i][j].resize(sizes_[i][j]);
-                for (size_t k = 0; k < deep_structure[i][j].size(); k++)
-                    deep_structure[i][j][k] = flat_structure[global_index++];
+                deep_structure[i][j].assign(
+                    flat_structure.begin() + global_index,
+                    flat_structure.begin() + global_index + sizes_[i][j]);
+                global_index += sizes_[i][j];
             }
         }
-        return deep_structure;
     }
 
 private:
     std::vector<std::vector<size_t>> sizes_;
 };
 
-// this function will interpolat the vector wherever it is NAN or INF
+/**
+ * \brief Sets data[begin, end) to the line through the values at anchor and
+ *        other, in a loop without dependencies which the compiler vectorizes
+ */
 template <typename T>
-void LinearlyInterpolate(std::vector<T>& data)
+void FillLine(T* data, int begin, int end, int anchor, int other)
 {
-    std::vector<int> limits;
-    limits.push_back(0);
-    limits.push_back(data.size() - 1);
-    std::vector<int> step_direction;
-    step_direction.push_back(1);
-    step_direction.push_back(-1);
+    if (end <= begin) return;
 
-    // extrapolate
-    for (int i = 0; i < 2; i++)
+    const double slope =
+        double(data[other] - data[anchor]) / double(other - anchor);
+    const double base = data[anchor];
+    for (int i = begin; i < end; i++)
     {
-        int index_first_real = IndexNextReal(
-            data, limits[i] - step_direction[i], step_direction[i]);
-        int index_next_real =
-            IndexNextReal(data, index_first_real, step_direction[i]);
-        if (index_next_real >= int(data.size()) || index_next_real < 0) return;
-
-        double slope = double(data[index_next_real] - data[index_first_real]) /
-                       double(index_next_real - index_first_real);
+        data[i] = T(base + double(i - anchor) * slope);
+    }
+}
 
-        for (int j = limits[i]; j != index_first_real; j += step_direction[i])
-            data[j] = data[index_first_real] + (j - index_first_real) * slope;
+/**
+ * \brief Index of the first NAN or INF value in data[index, end), end if
+ *        there is none. Runs of real values are checked in blocks which the
+ *        compiler vectorizes, since x - x is zero only for real x.
+ */
+template <typename T>
+int IndexNextHole(const T* data, int index, int end)
+{
+    const int block = 8;
+    while (index + block <= end)
+    {
+        bool real = true;
+        for (int i = 0; i < block; i++)
+        {
+            real &= data[index + i] - data[index + i] == 0;
+        }
+        if (!real) break;
+        index += block;
     }
+    while (index < end && std::isfinite(data[index])) index++;
 
-    // interpolate
-    int index_current_real =
-        IndexNextReal(data, limits[0] - step_direction[0], step_direction[0]);
-    int index_next_real =
-        IndexNextReal(data, index_current_real, step_direction[0]);
+    return index;
+}
 
-    while (index_next_real < int(data.size()))
-    {
-        double slope =
-            double(data[index_next_real] - data[index_current_real]) /
-            double(index_next_real - index_current_real);
+/**
+ * \brief Interpolates the size values starting at data wherever they are NAN
+ *        or INF, and extrapolates the ends with the slope of their two
+ *        closest real values. Nothing is changed with less than two real
+ *        values. Allocates nothing, e.g. to fill the holes of depth rows in
+ *        place.
+ */
+template <typename T>
+void LinearlyInterpolate(T* data, int size)
+{
+    const int first = IndexNextReal(data, size);
+    const int second = IndexNextReal(data, size, first);
+    if (second >= size) return;
+    const int last = IndexNextReal(data, size, size, -1);
+    const int before_last = IndexNextReal(data, size, last, -1);
 
-        for (int i = index_current_real + 1; i < index_next_real; i++)
-            data[i] =
-                data[index_current_real] + (i - index_current_real) * slope;
+    // extrapolate
+    FillLine(data, 0, first, first, second);
+    FillLine(data, last + 1, size, last, before_last);
 
-        index_current_real = index_next_real;
-        index_next_real =
-            IndexNextReal(data, index_next_real, step_direction[0]);
+    // interpolate every hole between the two real values around it
+    for (int hole = IndexNextHole(data, first, last); hole < last;
+         hole = IndexNextHole(data, hole, last))
+    {
+        const int next = IndexNextReal(data, size, hole);
+        FillLine(data, hole, next, hole - 1, next);
+        hole = next;
     }
 }
 
+// this function will interpolat the vector wherever it is NAN or INF
+template <typename T>
+void LinearlyInterpolate(std::vector<T>& data)
+{
+    LinearlyInterpolate(data.data(), int(data.size()));
+}
+
 template <typename T>
 void PrintVector(std::vector<T> v)
 {
@@ -500,36 +605,43 @@ struct ValueIndex
 
     bool operator<(const ValueIndex& str) const { return (value < str.value); }
 };
+/**
+ * \brief Writes the indices of the size values in ascending order of the
+ *        values into indices, which has to hold size values
+ */
 template <typename T>
-std::vector<int> SortAscend(const std::vector<T>& values)
+void SortAscend(const T* values, int size, int* indices)
 {
-    std::vector<int> indices(values.size());
-
-    std::vector<ValueIndex<T>> values_indices(values.size());
-    for (int i = 0; i < int(values.size()); i++)
-    {
-        values_indices[i].index = i;
-        values_indices[i].value = values[i];
-    }
-
-    std::sort(values_indices.begin(), values_indices.end());
+    std::iota(indices, indices + size, 0);
+    std::sort(indices, indices + size, [values](int a, int b) {
+        return values[a] < values[b];
+    });
+}
 
-    for (int i = 0; i < int(indices.size()); i++)
-        indices[i] = values_indices[i].index;
+/**
+ * \brief Same as above in descending order of the values
+ */
+template <typename T>
+void SortDescend(const T* values, int size, int* indices)
+{
+    SortAscend(values, size, indices);
+    std::reverse(indices, indices + size);
+}
 
+template <typename T>
+std::vector<int> SortAscend(const std::vector<T>& values)
+{
+    std::vector<int> indices(values.size());
+    SortAscend(values.data(), int(values.size()), indices.data());
     return indices;
 }
 
 template <typename T>
 std::vector<int> SortDescend(const std::vector<T>& values)
 {
-    std::vector<int> ascend_indices = SortAscend(values);
-    std::vector<int> descend_indices(ascend_indices.size());
-
-    for (int i = 0; i < int(ascend_indices.size()); i++)
-        descend_indices[i] = ascend_indices[ascend_indices.size() - 1 - i];
-
-    return descend_indices;
+    std::vector<int> indices(values.size());
+    SortDescend(values.data(), int(values.size()), indices.data());
+    return indices;
 }
 
 template <typename T>
@@ -639,24 +751,44 @@ T bound_value(const std::vector<T>& values,
     return values[BoundIndex(values, bound_type)];
 }
 
+/**
+ * \brief Writes f of the size values of input into output, which may be
+ *        input itself
+ */
+template <typename Tin, typename Tout, typename Function>
+void Apply(const Tin* input, int size, Tout* output, Function f)
+{
+    for (int i = 0; i < size; i++) output[i] = f(input[i]);
+}
+
 template <typename Tin, typename Tout>
 std::vector<Tout> Apply(const std::vector<Tin>& input, Tout (*f)(Tin))
 {
     std::vector<Tout> output(input.size());
-    for (size_t i = 0; i < output.size(); i++) output[i] = (*f)(input[i]);
+    Apply(input.data(), int(input.size()), output.data(), f);
 
     return output;
 }
 
+/**
+ * \brief Scales the size values starting at data in place such that they sum
+ *        up to sum
+ */
 template <typename T>
-std::vector<T> SetSum(const std::vector<T>& input, T sum)
+void SetSum(T* data, int size, T sum)
 {
     T old_sum = 0;
-    for (size_t i = 0; i < input.size(); i++) old_sum += input[i];
+    for (int i = 0; i < size; i++) old_sum += data[i];
     T factor = sum / old_sum;
 
-    std::vector<T> output(input.size());
-    for (size_t i = 0; i < input.size(); i++) output[i] = factor * input[i];
+    for (int i = 0; i < size; i++) data[i] *= factor;
+}
+
+template <typename T>
+std::vector<T> SetSum(const std::vector<T>& input, T sum)
+{
+    std::vector<T> output = input;
+    SetSum(output.data(), int(output.size()), sum);
 
     return output;
 }
@@ -0,0 +1,103 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file helper_functions_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <dbot/helper_functions.h>
+
+namespace
+{
+const float hole = std::numeric_limits<float>::quiet_NaN();
+const float infinite = std::numeric_limits<float>::infinity();
+}
+
+TEST(HelperFunctionsTests, interpolates_holes_and_extrapolates_the_ends)
+{
+    std::vector<float> data = {
+        hole, 1, hole, 3, infinite, infinite, infinite, 7, hole, hole};
+    dbot::hf::LinearlyInterpolate(data.data(), int(data.size()));
+    for (int i = 0; i < int(data.size()); i++)
+    {
+        EXPECT_FLOAT_EQ(data[i], i);
+    }
+
+    // the ends keep the slope of their two closest real values
+    std::vector<double> ends = {hole, hole, 2, 2.5, hole, 4, hole};
+    dbot::hf::LinearlyInterpolate(ends);
+    EXPECT_DOUBLE_EQ(ends[0], 1);
+    EXPECT_DOUBLE_EQ(ends[1], 1.5);
+    EXPECT_DOUBLE_EQ(ends[4], 3.25);
+    EXPECT_DOUBLE_EQ(ends[6], 4.75);
+}
+
+TEST(HelperFunctionsTests, leaves_less_than_two_real_values)
+{
+    std::vector<float> data = {hole, hole, 5, hole};
+    dbot::hf::LinearlyInterpolate(data.data(), int(data.size()));
+    EXPECT_TRUE(std::isnan(data[0]));
+    EXPECT_EQ(data[2], 5);
+    EXPECT_TRUE(std::isnan(data[3]));
+
+    dbot::hf::LinearlyInterpolate(data.data(), 0);
+}
+
+TEST(HelperFunctionsTests, sorts_indices_in_place)
+{
+    const std::vector<double> values = {0.3, -1, 2, 0.5};
+    int indices[4];
+    dbot::hf::SortAscend(values.data(), 4, indices);
+    EXPECT_EQ(std::vector<int>(indices, indices + 4),
+              std::vector<int>({1, 0, 3, 2}));
+    EXPECT_EQ(dbot::hf::SortDescend(values), std::vector<int>({2, 3, 0, 1}));
+
+    std::vector<float> weights = {1, 3, 4};
+    dbot::hf::SetSum(weights.data(), 3, 2.f);
+    EXPECT_FLOAT_EQ(weights[0], 0.25);
+    EXPECT_FLOAT_EQ(weights[2], 1);
+
+    dbot::hf::Apply(weights.data(), 3, weights.data(), [](float w) {
+        return 2 * w;
+    });
+    EXPECT_FLOAT_EQ(weights[1], 1.5);
+}
+
+TEST(HelperFunctionsTests, structurer_restores_into_existing_vectors)
+{
+    const std::vector<std::vector<int>> deep = {{1, 2}, {}, {3, 4, 5}};
+    dbot::hf::Structurer2D structurer;
+    std::vector<int> flat;
+    structurer.Flatten(deep, flat);
+    EXPECT_EQ(flat, std::vector<int>({1, 2, 3, 4, 5}));
+
+    std::vector<std::vector<int>> restored;
+    structurer.Deepen(flat, restored);
+    EXPECT_EQ(restored, deep);
+    EXPECT_EQ(structurer.Deepen(flat), deep);
+
+    const std::vector<std::vector<std::vector<int>>> deeper = {
+        {{1}, {2, 3}}, {{4}}};
+    dbot::hf::Structurer3D structurer_3d;
+    structurer_3d.Flatten(deeper, flat);
+    EXPECT_EQ(flat, std::vector<int>({1, 2, 3, 4}));
+    std::vector<std::vector<std::vector<int>>> restored_3d;
+    structurer_3d.Deepen(flat, restored_3d);
+    EXPECT_EQ(restored_3d, deeper);
+}
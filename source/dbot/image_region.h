@@ -0,0 +1,265 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file image_region.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/flat_mesh.h>
+
+namespace dbot
+{
+/**
+ * \brief Axis aligned rectangle of pixels [row, row + rows) x
+ *        [col, col + cols)
+ */
+struct ImageRegion
+{
+    ImageRegion() : row(0), col(0), rows(0), cols(0) {}
+    ImageRegion(int row, int col, int rows, int cols)
+        : row(row), col(col), rows(rows), cols(cols)
+    {
+    }
+
+    static ImageRegion full(int n_rows, int n_cols)
+    {
+        return ImageRegion(0, 0, n_rows, n_cols);
+    }
+
+    int area() const { return rows * cols; }
+    bool empty() const { return rows <= 0 || cols <= 0; }
+    bool contains(int pixel_row, int pixel_col) const
+    {
+        return pixel_row >= row && pixel_row < row + rows && pixel_col >= col &&
+               pixel_col < col + cols;
+    }
+
+    bool contains(const ImageRegion& other) const
+    {
+        return other.empty() ||
+               (other.row >= row && other.col >= col &&
+                other.row + other.rows <= row + rows &&
+                other.col + other.cols <= col + cols);
+    }
+
+    /**
+     * \brief Index of the pixel within the region in row major order or -1
+     *        if the pixel lies outside
+     */
+    int offset(int pixel_row, int pixel_col) const
+    {
+        if (!contains(pixel_row, pixel_col)) return -1;
+        return (pixel_row - row) * cols + (pixel_col - col);
+    }
+
+    /** \brief Smallest region containing this and the other region */
+    ImageRegion unite(const ImageRegion& other) const
+    {
+        if (empty()) return other;
+        if (other.empty()) return *this;
+
+        int min_row = std::min(row, other.row);
+        int min_col = std::min(col, other.col);
+        int max_row = std::max(row + rows, other.row + other.rows);
+        int max_col = std::max(col + cols, other.col + other.cols);
+        return ImageRegion(
+            min_row, min_col, max_row - min_row, max_col - min_col);
+    }
+
+    /** \brief Pixels within both regions */
+    ImageRegion intersect(const ImageRegion& other) const
+    {
+        int min_row = std::max(row, other.row);
+        int min_col = std::max(col, other.col);
+        int max_row = std::min(row + rows, other.row + other.rows);
+        int max_col = std::min(col + cols, other.col + other.cols);
+        if (max_row <= min_row || max_col <= min_col) return ImageRegion();
+        return ImageRegion(
+            min_row, min_col, max_row - min_row, max_col - min_col);
+    }
+
+    /** \brief Grows the region by margin pixels and clips it to the image */
+    ImageRegion pad(int margin, int n_rows, int n_cols) const
+    {
+        if (empty()) return *this;
+
+        int min_row = std::max(0, row - margin);
+        int min_col = std::max(0, col - margin);
+        int max_row = std::min(n_rows, row + rows + margin);
+        int max_col = std::min(n_cols, col + cols + margin);
+        return ImageRegion(
+            min_row, min_col, max_row - min_row, max_col - min_col);
+    }
+
+    bool operator==(const ImageRegion& other) const
+    {
+        return row == other.row && col == other.col && rows == other.rows &&
+               cols == other.cols;
+    }
+
+    bool operator!=(const ImageRegion& other) const
+    {
+        return !(*this == other);
+    }
+
+    int row, col, rows, cols;
+};
+
+/**
+ * \brief Corners of the axis aligned bounding box of each part
+ */
+inline std::vector<std::vector<Eigen::Vector3d>> bounding_box_corners(
+    const std::vector<std::vector<Eigen::Vector3d>>& vertices)
+{
+    std::vector<std::vector<Eigen::Vector3d>> corners(vertices.size());
+    for (size_t part = 0; part < vertices.size(); part++)
+    {
+        if (vertices[part].empty()) continue;
+
+        Eigen::Vector3d min = vertices[part][0];
+        Eigen::Vector3d max = vertices[part][0];
+        for (size_t i = 1; i < vertices[part].size(); i++)
+        {
+            min = min.cwiseMin(vertices[part][i]);
+            max = max.cwiseMax(vertices[part][i]);
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            corners[part].push_back(
+                Eigen::Vector3d(i & 1 ? max(0) : min(0),
+                                i & 2 ? max(1) : min(1),
+                                i & 4 ? max(2) : min(2)));
+        }
+    }
+    return corners;
+}
+
+/**
+ * \brief Same as above for the parts of a flat mesh
+ */
+inline std::vector<std::vector<Eigen::Vector3d>> bounding_box_corners(
+    const FlatMesh& mesh)
+{
+    std::vector<std::vector<Eigen::Vector3d>> vertices(mesh.part_count());
+    for (int part = 0; part < mesh.part_count(); part++)
+    {
+        if (mesh.vertex_begin(part) == mesh.vertex_end(part)) continue;
+
+        // only the extremes are needed, the corners of the bounding box
+        Eigen::Vector3f min = mesh.position(mesh.vertex_begin(part));
+        Eigen::Vector3f max = min;
+        for (int i = mesh.vertex_begin(part); i < mesh.vertex_end(part); i++)
+        {
+            min = min.cwiseMin(mesh.position(i));
+            max = max.cwiseMax(mesh.position(i));
+        }
+        vertices[part].push_back(min.cast<double>());
+        vertices[part].push_back(max.cast<double>());
+    }
+    return bounding_box_corners(vertices);
+}
+
+/**
+ * \brief Conservative image region covered by a part whose bounding box
+ *        corners are transformed by R and t. If a corner lies behind the
+ *        camera, the whole image is returned.
+ */
+inline ImageRegion projected_region(
+    const std::vector<Eigen::Vector3d>& corners,
+    const Eigen::Matrix3d& R,
+    const Eigen::Vector3d& t,
+    const Eigen::Matrix3d& camera_matrix,
+    int n_rows,
+    int n_cols)
+{
+    if (corners.empty()) return ImageRegion();
+
+    double min_row = std::numeric_limits<double>::max();
+    double min_col = std::numeric_limits<double>::max();
+    double max_row = -std::numeric_limits<double>::max();
+    double max_col = -std::numeric_limits<double>::max();
+    for (size_t i = 0; i < corners.size(); i++)
+    {
+        Eigen::Vector3d point = R * corners[i] + t;
+        if (point(2) < 0.001) return ImageRegion::full(n_rows, n_cols);
+
+        Eigen::Vector3d pixel = camera_matrix * point / point(2);
+        min_col = std::min(min_col, pixel(0));
+        max_col = std::max(max_col, pixel(0));
+        min_row = std::min(min_row, pixel(1));
+        max_row = std::max(max_row, pixel(1));
+    }
+
+    int row = std::max(0, int(std::floor(min_row)));
+    int col = std::max(0, int(std::floor(min_col)));
+    int end_row = std::min(n_rows, int(std::ceil(max_row)) + 1);
+    int end_col = std::min(n_cols, int(std::ceil(max_col)) + 1);
+    if (end_row <= row || end_col <= col) return ImageRegion();
+
+    return ImageRegion(row, col, end_row - row, end_col - col);
+}
+
+/**
+ * \brief Region of interest following the screen footprint of an object.
+ *
+ * The region grows immediately when the footprint leaves it and shrinks
+ * only once it is considerably larger than needed, such that it does not
+ * change on every frame.
+ */
+class RegionOfInterest
+{
+public:
+    RegionOfInterest(int n_rows, int n_cols, int margin = 8)
+        : n_rows_(n_rows), n_cols_(n_cols), margin_(margin)
+    {
+    }
+
+    /**
+     * \brief Adapts the region to the footprint and returns the new region
+     */
+    const ImageRegion& update(const ImageRegion& footprint)
+    {
+        ImageRegion padded = footprint.pad(margin_, n_rows_, n_cols_);
+
+        if (!region_.contains(footprint) ||
+            region_.area() > 4 * std::max(padded.area(), 1))
+        {
+            region_ = padded;
+        }
+
+        return region_;
+    }
+
+    void reset() { region_ = ImageRegion(); }
+    const ImageRegion& region() const { return region_; }
+
+    /** \brief Restores a region, e.g. the one of a checkpoint */
+    void set(const ImageRegion& region) { region_ = region; }
+
+private:
+    int n_rows_;
+    int n_cols_;
+    int margin_;
+    ImageRegion region_;
+};
+}
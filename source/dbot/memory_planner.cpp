@@ -0,0 +1,213 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file memory_planner.cpp
+ */
+
+#include <sstream>
+
+#include <fl/util/types.hpp>
+
+#include <dbot/memory_planner.h>
+#include <dbot/model/occlusion_arena.h>
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+
+namespace dbot
+{
+constexpr int MemoryFootprint::component_count;
+
+std::uint64_t MemoryFootprint::host_bytes() const
+{
+    std::uint64_t sum = 0;
+    for (int i = 0; i < component_count; i++)
+    {
+        if (!on_device(MemoryComponent(i))) sum += bytes[i];
+    }
+    return sum;
+}
+
+std::uint64_t MemoryFootprint::device_bytes() const
+{
+    std::uint64_t sum = 0;
+    for (int i = 0; i < component_count; i++)
+    {
+        if (on_device(MemoryComponent(i))) sum += bytes[i];
+    }
+    return sum;
+}
+
+std::string MemoryFootprint::to_json() const
+{
+    std::ostringstream json;
+    json << "{\"components\":{";
+    for (int i = 0; i < component_count; i++)
+    {
+        json << (i > 0 ? "," : "") << "\""
+             << component_name(MemoryComponent(i)) << "\":" << bytes[i];
+    }
+    json << "},\"host\":" << host_bytes() << ",\"device\":" << device_bytes()
+         << "}";
+    return json.str();
+}
+
+const char* MemoryFootprint::component_name(MemoryComponent component)
+{
+    switch (component)
+    {
+        case MemoryComponent::DeviceRenderings: return "device_renderings";
+        case MemoryComponent::DeviceMeshes: return "device_meshes";
+        case MemoryComponent::DeviceObservations: return "device_observations";
+        case MemoryComponent::DeviceOcclusions: return "device_occlusions";
+        case MemoryComponent::HostObservations: return "host_observations";
+        case MemoryComponent::HostOcclusions: return "host_occlusions";
+        case MemoryComponent::HostRenderCache: return "host_render_cache";
+        case MemoryComponent::HostParticles: return "host_particles";
+        case MemoryComponent::HostNoises: return "host_noises";
+        default: return "unknown";
+    }
+}
+
+bool MemoryFootprint::on_device(MemoryComponent component)
+{
+    return component < MemoryComponent::HostObservations;
+}
+
+MemoryFootprint MemoryPlanner::plan(const Configuration& configuration)
+{
+    typedef FreeFloatingRigidBodiesState<> State;
+
+    const std::uint64_t pixels =
+        std::uint64_t(configuration.nr_rows) * configuration.nr_cols;
+    const std::uint64_t poses = configuration.pose_count;
+    const std::uint64_t covered_pixels = pixels * configuration.footprint;
+
+    MemoryFootprint footprint;
+
+    // current, old and the two resampled particle sets of the filter, and
+    // the current and resampled noises
+    footprint[MemoryComponent::HostParticles] =
+        4 * poses * configuration.part_count * State::BODY_SIZE *
+        sizeof(fl::Real);
+    footprint[MemoryComponent::HostNoises] =
+        2 * poses * configuration.part_count * State::POSE_SIZE *
+        sizeof(fl::Real);
+
+    if (configuration.backend == Backend::Cpu)
+    {
+        footprint[MemoryComponent::HostObservations] = pixels * sizeof(float);
+
+        // the occlusion rows and their relayout after resampling
+        footprint[MemoryComponent::HostOcclusions] =
+            2 * poses * covered_pixels *
+            (sizeof(float) + sizeof(OcclusionArena::Frame));
+        footprint[MemoryComponent::HostRenderCache] =
+            poses * covered_pixels * (sizeof(int) + sizeof(float));
+        return footprint;
+    }
+
+    // float conversion of the observation, read back occlusions and the
+    // particle weights
+    footprint[MemoryComponent::HostObservations] =
+        2 * pixels * sizeof(float) + poses * sizeof(float);
+
+    std::uint64_t constant_need, per_pose_need;
+    rasterizer_need(configuration.nr_rows,
+                    configuration.nr_cols,
+                    configuration.vertex_count,
+                    configuration.index_count,
+                    constant_need,
+                    per_pose_need);
+    footprint[MemoryComponent::DeviceMeshes] = constant_need;
+    footprint[MemoryComponent::DeviceRenderings] = poses * per_pose_need;
+
+    evaluator_need(configuration.nr_rows,
+                   configuration.nr_cols,
+                   configuration.occlusion_element_size,
+                   constant_need,
+                   per_pose_need);
+    footprint[MemoryComponent::DeviceObservations] = constant_need;
+    footprint[MemoryComponent::DeviceOcclusions] = poses * per_pose_need;
+
+    return footprint;
+}
+
+void MemoryPlanner::rasterizer_need(int nr_rows,
+                                    int nr_cols,
+                                    int vertex_count,
+                                    int index_count,
+                                    std::uint64_t& constant_need,
+                                    std::uint64_t& per_pose_need)
+{
+    constant_need = std::uint64_t(vertex_count) * 3 * sizeof(float) +
+                    std::uint64_t(index_count) * sizeof(unsigned);
+    // depth texture and renderbuffer of a tile and its pixel buffer
+    per_pose_need = std::uint64_t(nr_rows) * nr_cols * (8 + sizeof(float));
+}
+
+void MemoryPlanner::evaluator_need(int nr_rows,
+                                   int nr_cols,
+                                   int occlusion_element_size,
+                                   std::uint64_t& constant_need,
+                                   std::uint64_t& per_pose_need)
+{
+    const std::uint64_t pixels = std::uint64_t(nr_rows) * nr_cols;
+
+    // the observations, their compacted valid pixels and the staging image
+    // of the occlusions
+    constant_need = pixels * (4 * sizeof(float) + 1);
+    // the two occlusion buffers dominate the need per pose, next to the
+    // weights, the two occlusion regions and the occlusion index
+    per_pose_need = 9 * sizeof(float) + 2 * 4 * sizeof(int) + sizeof(int) +
+                    2 * pixels * occlusion_element_size;
+}
+
+MemoryFootprint MemoryUsage::snapshot()
+{
+    MemoryFootprint footprint;
+    for (int i = 0; i < MemoryFootprint::component_count; i++)
+    {
+        const std::int64_t bytes =
+            counters()[i].load(std::memory_order_relaxed);
+        footprint.bytes[i] = bytes > 0 ? bytes : 0;
+    }
+    return footprint;
+}
+
+std::string MemoryUsage::to_prometheus()
+{
+    const MemoryFootprint footprint = snapshot();
+    const std::string name = "dbot_memory_bytes";
+
+    std::ostringstream text;
+    text << "# HELP " << name << " Memory in use by the tracker components.\n"
+         << "# TYPE " << name << " gauge\n";
+    for (int i = 0; i < MemoryFootprint::component_count; i++)
+    {
+        const MemoryComponent component = MemoryComponent(i);
+        text << name << "{component=\""
+             << MemoryFootprint::component_name(component) << "\",space=\""
+             << (MemoryFootprint::on_device(component) ? "device" : "host")
+             << "\"} " << footprint.bytes[i] << "\n";
+    }
+    return text.str();
+}
+
+MemoryUsage::Counters& MemoryUsage::counters()
+{
+    // value initialized to zero and never destroyed, such that accounts of
+    // static objects can still release their bytes
+    static Counters* counters = new Counters();
+    return *counters;
+}
+}
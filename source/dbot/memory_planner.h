@@ -0,0 +1,233 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file memory_planner.h
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dbot
+{
+/**
+ * \brief Parts of a tracker whose memory is planned and accounted
+ */
+enum class MemoryComponent
+{
+    DeviceRenderings,    // depth textures and buffers the poses render into
+    DeviceMeshes,        // vertex and index buffers of the rasterizer
+    DeviceObservations,  // observation and its valid pixels on the GPU
+    DeviceOcclusions,    // occlusion buffers and per pose state of the GPU
+    HostObservations,    // observation and occlusion staging on the host
+    HostOcclusions,      // occlusion rows of the CPU sensor
+    HostRenderCache,     // sparse renderings of the CPU sensor workers
+    HostParticles,       // particle states of the filter
+    HostNoises,          // noise samples of the filter
+    Count
+};
+
+/**
+ * \brief Bytes of every memory component, either planned or in use
+ */
+struct MemoryFootprint
+{
+    static constexpr int component_count = int(MemoryComponent::Count);
+
+    std::array<std::uint64_t, component_count> bytes{};
+
+    std::uint64_t& operator[](MemoryComponent component)
+    {
+        return bytes[int(component)];
+    }
+
+    std::uint64_t operator[](MemoryComponent component) const
+    {
+        return bytes[int(component)];
+    }
+
+    std::uint64_t host_bytes() const;
+    std::uint64_t device_bytes() const;
+
+    /**
+     * \brief Bytes of every component and the host and device totals as a
+     *        JSON object
+     */
+    std::string to_json() const;
+
+    static const char* component_name(MemoryComponent component);
+    static bool on_device(MemoryComponent component);
+};
+
+/**
+ * \brief Preflight estimate of the memory a tracker configuration needs,
+ *        without creating any of it.
+ *
+ * The device needs are the ones which BufferConfiguration checks against
+ * the global memory before allocating, ObjectRasterizer and CudaEvaluator
+ * report them through this planner. The host needs are upper bounds for
+ * pose footprints of the given fraction of the image.
+ */
+class MemoryPlanner
+{
+public:
+    enum class Backend
+    {
+        Cpu,
+        Gpu
+    };
+
+    struct Configuration
+    {
+        Configuration()
+            : nr_rows(0),
+              nr_cols(0),
+              pose_count(0),
+              part_count(1),
+              backend(Backend::Gpu),
+              occlusion_element_size(sizeof(float)),
+              vertex_count(0),
+              index_count(0),
+              footprint(1)
+        {
+        }
+
+        /** resolution the poses are rendered at */
+        int nr_rows;
+        int nr_cols;
+
+        /** maximum number of particles evaluated at once */
+        int pose_count;
+
+        /** number of objects of the state */
+        int part_count;
+
+        Backend backend;
+
+        /** bytes per occlusion on the GPU, see CudaEvaluator::
+         *  OcclusionStorage */
+        int occlusion_element_size;
+
+        /** vertices and triangle indices of all meshes and their levels */
+        int vertex_count;
+        int index_count;
+
+        /** fraction of the image the poses cover, which bounds the
+         *  occlusion rows and the renderings of the CPU sensor */
+        double footprint;
+    };
+
+public:
+    /** \brief Bytes of every component the configuration needs */
+    static MemoryFootprint plan(const Configuration& configuration);
+
+    /**
+     * \brief Constant and per pose device bytes of ObjectRasterizer for
+     *        meshes of vertex_count vertices and index_count indices
+     */
+    static void rasterizer_need(int nr_rows,
+                                int nr_cols,
+                                int vertex_count,
+                                int index_count,
+                                std::uint64_t& constant_need,
+                                std::uint64_t& per_pose_need);
+
+    /**
+     * \brief Constant and per pose device bytes of CudaEvaluator with
+     *        occlusions of occlusion_element_size bytes
+     */
+    static void evaluator_need(int nr_rows,
+                               int nr_cols,
+                               int occlusion_element_size,
+                               std::uint64_t& constant_need,
+                               std::uint64_t& per_pose_need);
+};
+
+/**
+ * \brief Live byte counters of the memory components summed over all
+ *        trackers of the process, e.g. to check a node against the planned
+ *        footprints of its trackers. They are updated by MemoryAccount.
+ */
+class MemoryUsage
+{
+public:
+    static void add(MemoryComponent component, std::int64_t bytes)
+    {
+        counters()[int(component)].fetch_add(bytes,
+                                             std::memory_order_relaxed);
+    }
+
+    /** \brief Bytes currently in use by all components */
+    static MemoryFootprint snapshot();
+
+    /**
+     * \brief Snapshot in the Prometheus text format, as the gauge
+     *        dbot_memory_bytes labelled by component and space
+     */
+    static std::string to_prometheus();
+
+private:
+    typedef std::array<std::atomic<std::int64_t>,
+                       MemoryFootprint::component_count>
+        Counters;
+
+    static Counters& counters();
+};
+
+/**
+ * \brief Bytes a single object holds of a component, which it keeps up to
+ *        date with set(). The bytes are released from MemoryUsage on
+ *        destruction, copies account for the same bytes once more.
+ */
+class MemoryAccount
+{
+public:
+    explicit MemoryAccount(MemoryComponent component)
+        : component_(component), bytes_(0)
+    {
+    }
+
+    MemoryAccount(const MemoryAccount& other)
+        : component_(other.component_), bytes_(0)
+    {
+        set(other.bytes_);
+    }
+
+    MemoryAccount& operator=(const MemoryAccount& other)
+    {
+        set(other.bytes_);
+        return *this;
+    }
+
+    ~MemoryAccount() { set(0); }
+
+    void set(std::uint64_t bytes)
+    {
+        if (bytes == bytes_) return;
+        MemoryUsage::add(component_,
+                         std::int64_t(bytes) - std::int64_t(bytes_));
+        bytes_ = bytes;
+    }
+
+    std::uint64_t bytes() const { return bytes_; }
+
+private:
+    MemoryComponent component_;
+    std::uint64_t bytes_;
+};
+}
@@ -0,0 +1,129 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file memory_planner_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <fl/util/types.hpp>
+
+#include <dbot/memory_planner.h>
+#include <dbot/model/occlusion_arena.h>
+
+namespace
+{
+dbot::MemoryPlanner::Configuration configuration()
+{
+    dbot::MemoryPlanner::Configuration configuration;
+    configuration.nr_rows = 60;
+    configuration.nr_cols = 80;
+    configuration.pose_count = 100;
+    configuration.part_count = 2;
+    configuration.vertex_count = 1000;
+    configuration.index_count = 6000;
+    return configuration;
+}
+}
+
+TEST(MemoryPlannerTests, plans_the_device_needs_of_the_gpu_backend)
+{
+    const auto footprint = dbot::MemoryPlanner::plan(configuration());
+    const std::uint64_t pixels = 60 * 80;
+
+    EXPECT_EQ(footprint[dbot::MemoryComponent::DeviceMeshes],
+              1000 * 3 * sizeof(float) + 6000 * sizeof(unsigned));
+    EXPECT_EQ(footprint[dbot::MemoryComponent::DeviceRenderings],
+              100 * pixels * 12);
+    EXPECT_EQ(footprint[dbot::MemoryComponent::DeviceObservations],
+              pixels * 17);
+    EXPECT_EQ(footprint[dbot::MemoryComponent::DeviceOcclusions],
+              100 * (9 * 4 + 2 * 16 + 4 + 2 * pixels * 4));
+    EXPECT_EQ(footprint[dbot::MemoryComponent::HostOcclusions], 0u);
+
+    // half precision occlusions halve the dominating buffers
+    auto half = configuration();
+    half.occlusion_element_size = 2;
+    EXPECT_EQ(dbot::MemoryPlanner::plan(half)[
+                  dbot::MemoryComponent::DeviceOcclusions],
+              100 * (9 * 4 + 2 * 16 + 4 + 2 * pixels * 2));
+
+    EXPECT_EQ(footprint.device_bytes() + footprint.host_bytes(),
+              [&] {
+                  std::uint64_t sum = 0;
+                  for (auto bytes : footprint.bytes) sum += bytes;
+                  return sum;
+              }());
+    EXPECT_NE(footprint.to_json().find("\"device_occlusions\":"),
+              std::string::npos);
+}
+
+TEST(MemoryPlannerTests, plans_the_host_needs_of_the_cpu_backend)
+{
+    auto cpu = configuration();
+    cpu.backend = dbot::MemoryPlanner::Backend::Cpu;
+    cpu.footprint = 0.25;
+    const auto footprint = dbot::MemoryPlanner::plan(cpu);
+
+    EXPECT_EQ(footprint.device_bytes(), 0u);
+    EXPECT_EQ(footprint[dbot::MemoryComponent::HostOcclusions],
+              2 * 100 * 1200 * 6);
+    EXPECT_EQ(footprint[dbot::MemoryComponent::HostRenderCache],
+              100 * 1200 * 8);
+    EXPECT_EQ(footprint[dbot::MemoryComponent::HostParticles],
+              4 * 100 * 2 * 12 * sizeof(fl::Real));
+    EXPECT_EQ(footprint[dbot::MemoryComponent::HostNoises],
+              2 * 100 * 2 * 6 * sizeof(fl::Real));
+}
+
+TEST(MemoryPlannerTests, accounts_live_usage)
+{
+    const auto before = dbot::MemoryUsage::snapshot();
+    const auto host_occlusions = [] {
+        return dbot::MemoryUsage::snapshot()
+            [dbot::MemoryComponent::HostOcclusions];
+    };
+
+    {
+        dbot::MemoryAccount account(dbot::MemoryComponent::HostOcclusions);
+        account.set(1000);
+        dbot::MemoryAccount copy = account;
+        EXPECT_EQ(host_occlusions(),
+                  before[dbot::MemoryComponent::HostOcclusions] + 2000);
+        account.set(500);
+        EXPECT_EQ(host_occlusions(),
+                  before[dbot::MemoryComponent::HostOcclusions] + 1500);
+    }
+    EXPECT_EQ(host_occlusions(), before[dbot::MemoryComponent::HostOcclusions]);
+
+    {
+        // every particle gets a row of the region after a remap
+        dbot::OcclusionArena arena(60, 80, 0.1f);
+        const std::vector<int> parents(8, 0);
+        arena.remap(parents.data(), 8, dbot::ImageRegion(0, 0, 10, 20));
+        EXPECT_GE(host_occlusions(),
+                  before[dbot::MemoryComponent::HostOcclusions] +
+                      8 * 200 * (sizeof(float) + 2));
+    }
+    EXPECT_EQ(host_occlusions(), before[dbot::MemoryComponent::HostOcclusions]);
+
+    const std::string text = dbot::MemoryUsage::to_prometheus();
+    EXPECT_NE(text.find("# TYPE dbot_memory_bytes gauge"), std::string::npos);
+    EXPECT_NE(text.find("dbot_memory_bytes{component=\"host_occlusions\","
+                        "space=\"host\"}"),
+              std::string::npos);
+}
@@ -0,0 +1,221 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_cache.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dbot/binary_file.h>
+#include <dbot/mesh_cache.h>
+
+namespace dbot
+{
+namespace
+{
+const char magic[8] = {'D', 'B', 'O', 'T', 'M', 'E', 'S', 'H'};
+const std::uint32_t version = 1;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t source_hash;
+    std::uint64_t vertex_count;
+    std::uint64_t triangle_count;
+};
+
+// the vertices are read and written as they are stored in the vector
+static_assert(sizeof(Eigen::Vector3d) == 3 * sizeof(double),
+              "the cache stores the vertices as three packed doubles");
+
+/**
+ * \brief Continues the 64 bit FNV-1a hash with the given bytes
+ */
+void hash_bytes(const char* bytes, std::size_t size, std::uint64_t& hash)
+{
+    for (std::size_t i = 0; i < size; i++)
+    {
+        const unsigned char byte = bytes[i];
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+}
+
+const std::uint64_t hash_basis = 14695981039346656037ull;
+}
+
+std::string MeshCache::default_directory()
+{
+    const char* directory = std::getenv("DBOT_MESH_CACHE");
+    if (directory) return directory;
+
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.dbot_mesh_cache" : "";
+}
+
+std::string MeshCache::cache_path(const std::string& directory,
+                                  const std::string& mesh_path)
+{
+    std::uint64_t hash = hash_basis;
+    hash_bytes(mesh_path.data(), mesh_path.size(), hash);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)hash);
+    return directory + "/" + name;
+}
+
+bool MeshCache::hash_file(const std::string& path, std::uint64_t& hash)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+
+    hash = hash_basis;
+    char buffer[1 << 16];
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        hash_bytes(buffer, file.gcount(), hash);
+    }
+
+    return true;
+}
+
+bool MeshCache::read(const std::string& path,
+                     std::uint64_t source_hash,
+                     std::vector<Eigen::Vector3d>& vertices,
+                     std::vector<std::vector<int>>& triangle_indices)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != version || header.source_hash != source_hash)
+    {
+        return false;
+    }
+
+    // the vertices and the indices fill the rest of the file
+    const std::uint64_t data_size = remaining_size(file);
+    std::uint64_t vertices_size, indices_size;
+    if (!bounded_product(header.vertex_count,
+                         3 * sizeof(double),
+                         data_size,
+                         vertices_size) ||
+        !bounded_product(header.triangle_count,
+                         3 * sizeof(std::int32_t),
+                         data_size,
+                         indices_size) ||
+        data_size != vertices_size + indices_size)
+    {
+        return false;
+    }
+
+    // the vertices are read straight into the output, the indices are
+    // checked before any triangle is built
+    std::vector<std::int32_t> flat_indices(header.triangle_count * 3);
+    vertices.resize(header.vertex_count);
+    file.read(reinterpret_cast<char*>(vertices.data()),
+              vertices.size() * sizeof(Eigen::Vector3d));
+    file.read(reinterpret_cast<char*>(flat_indices.data()),
+              flat_indices.size() * sizeof(std::int32_t));
+    if (!file) return false;
+
+    for (const std::int32_t index : flat_indices)
+    {
+        if (index < 0 || std::uint64_t(index) >= header.vertex_count)
+        {
+            return false;
+        }
+    }
+
+    // the triangles of a previous mesh keep their memory
+    triangle_indices.resize(header.triangle_count);
+    for (size_t i = 0; i < triangle_indices.size(); i++)
+    {
+        triangle_indices[i].resize(3);
+        std::copy(flat_indices.begin() + 3 * i,
+                  flat_indices.begin() + 3 * i + 3,
+                  triangle_indices[i].begin());
+    }
+
+    return true;
+}
+
+bool MeshCache::write(const std::string& path,
+                      std::uint64_t source_hash,
+                      const std::vector<Eigen::Vector3d>& vertices,
+                      const std::vector<std::vector<int>>& triangle_indices)
+{
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.reserved = 0;
+    header.source_hash = source_hash;
+    header.vertex_count = vertices.size();
+    header.triangle_count = triangle_indices.size();
+
+    std::vector<std::int32_t> flat_indices(triangle_indices.size() * 3);
+    for (size_t i = 0; i < triangle_indices.size(); i++)
+    {
+        if (triangle_indices[i].size() != 3) return false;
+        for (int j = 0; j < 3; j++)
+        {
+            const int index = triangle_indices[i][j];
+            if (index < 0 || size_t(index) >= vertices.size()) return false;
+            flat_indices[3 * i + j] = index;
+        }
+    }
+
+    // a single level, the parent is the home directory by default
+    const std::size_t separator = path.rfind('/');
+    if (separator != std::string::npos && separator > 0)
+    {
+        mkdir(path.substr(0, separator).c_str(), 0755);
+    }
+
+    // readers never see a partially written cache, and processes writing
+    // the same cache do not share their temporary file
+    const std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream file(tmp_path.c_str(), std::ios::binary);
+        if (!file) return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(vertices.data()),
+                   vertices.size() * sizeof(Eigen::Vector3d));
+        file.write(reinterpret_cast<const char*>(flat_indices.data()),
+                   flat_indices.size() * sizeof(std::int32_t));
+        if (!file)
+        {
+            file.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+}
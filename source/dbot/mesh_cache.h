@@ -0,0 +1,81 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_cache.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace dbot
+{
+/**
+ * \brief Binary cache of a parsed mesh file.
+ *
+ * The cache file consists of a fixed header followed by the flat vertex
+ * array (3 doubles per vertex) and the flat triangle index array (3 int32
+ * per triangle), such that it can be read with two bulk reads or mapped
+ * directly. The header holds a hash of the source file, a cache whose hash
+ * does not match the current source is ignored. The caches of all meshes are
+ * kept in one directory, named after a hash of the path of their mesh, such
+ * that meshes of read only packages are cached as well.
+ */
+class MeshCache
+{
+public:
+    /**
+     * \brief DBOT_MESH_CACHE if it is set, where an empty value disables
+     *        the cache, else a directory in the home directory, else none
+     */
+    static std::string default_directory();
+
+    /**
+     * \brief Cache file of the given mesh file in the directory
+     */
+    static std::string cache_path(const std::string& directory,
+                                  const std::string& mesh_path);
+
+    /**
+     * \brief 64 bit FNV-1a hash of the file content. Returns false if the
+     *        file cannot be read.
+     */
+    static bool hash_file(const std::string& path, std::uint64_t& hash);
+
+    /**
+     * \brief Reads the cached mesh. Returns false if the cache does not
+     *        exist, is malformed, refers to vertices it does not hold or
+     *        belongs to a different source.
+     */
+    static bool read(const std::string& path,
+                     std::uint64_t source_hash,
+                     std::vector<Eigen::Vector3d>& vertices,
+                     std::vector<std::vector<int>>& triangle_indices);
+
+    /**
+     * \brief Writes the mesh through a temporary file of the process and
+     *        creates the directory of the cache if needed. Returns false if
+     *        the cache cannot be written or a triangle does not refer to
+     *        three of the vertices.
+     */
+    static bool write(const std::string& path,
+                      std::uint64_t source_hash,
+                      const std::vector<Eigen::Vector3d>& vertices,
+                      const std::vector<std::vector<int>>& triangle_indices);
+};
+}
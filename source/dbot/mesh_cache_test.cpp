@@ -0,0 +1,185 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_cache_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+#include <dbot/mesh_cache.h>
+
+namespace
+{
+void write_file(const std::string& path, const std::string& content)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << content;
+}
+}
+
+TEST(MeshCacheTests, round_trip)
+{
+    const std::string path = "mesh_cache_test.cache";
+
+    std::vector<Eigen::Vector3d> vertices;
+    vertices.push_back(Eigen::Vector3d(0.1, 0.2, 0.3));
+    vertices.push_back(Eigen::Vector3d(-1.0, 2.5, 1e-7));
+    vertices.push_back(Eigen::Vector3d(4.0, 5.0, 6.0));
+    std::vector<std::vector<int>> indices(2, std::vector<int>{0, 1, 2});
+    indices[1] = {2, 1, 0};
+
+    ASSERT_TRUE(dbot::MeshCache::write(path, 42, vertices, indices));
+
+    std::vector<Eigen::Vector3d> read_vertices;
+    std::vector<std::vector<int>> read_indices;
+    ASSERT_TRUE(
+        dbot::MeshCache::read(path, 42, read_vertices, read_indices));
+    ASSERT_EQ(read_vertices.size(), vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        EXPECT_EQ(read_vertices[i], vertices[i]);
+    }
+    EXPECT_EQ(read_indices, indices);
+
+    // a cache of a different source is ignored
+    EXPECT_FALSE(
+        dbot::MeshCache::read(path, 43, read_vertices, read_indices));
+
+    std::remove(path.c_str());
+}
+
+TEST(MeshCacheTests, hash_follows_content)
+{
+    const std::string path = "mesh_cache_test.obj";
+    std::uint64_t hash_a, hash_b, hash_c;
+
+    write_file(path, "v 0 0 0\nf 1 1 1\n");
+    ASSERT_TRUE(dbot::MeshCache::hash_file(path, hash_a));
+    ASSERT_TRUE(dbot::MeshCache::hash_file(path, hash_b));
+    write_file(path, "v 0 0 1\nf 1 1 1\n");
+    ASSERT_TRUE(dbot::MeshCache::hash_file(path, hash_c));
+
+    EXPECT_EQ(hash_a, hash_b);
+    EXPECT_NE(hash_a, hash_c);
+    EXPECT_FALSE(dbot::MeshCache::hash_file("does_not_exist.obj", hash_a));
+
+    std::remove(path.c_str());
+}
+
+TEST(MeshCacheTests, rejects_truncated_cache)
+{
+    const std::string path = "mesh_cache_truncated.cache";
+    std::vector<Eigen::Vector3d> vertices(4, Eigen::Vector3d::Ones());
+    std::vector<std::vector<int>> indices(1, std::vector<int>{0, 1, 2});
+    ASSERT_TRUE(dbot::MeshCache::write(path, 7, vertices, indices));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+    write_file(path, content.substr(0, content.size() - 4));
+
+    std::vector<Eigen::Vector3d> read_vertices;
+    std::vector<std::vector<int>> read_indices;
+    EXPECT_FALSE(dbot::MeshCache::read(path, 7, read_vertices, read_indices));
+
+    std::remove(path.c_str());
+}
+
+TEST(MeshCacheTests, rejects_indices_out_of_range)
+{
+    const std::string path = "mesh_cache_indices.cache";
+    std::vector<Eigen::Vector3d> vertices(3, Eigen::Vector3d::Ones());
+    std::vector<std::vector<int>> indices(1, std::vector<int>{0, 1, 3});
+    EXPECT_FALSE(dbot::MeshCache::write(path, 7, vertices, indices));
+    indices[0][2] = -1;
+    EXPECT_FALSE(dbot::MeshCache::write(path, 7, vertices, indices));
+
+    // the last index of a valid cache points past the vertices
+    indices[0][2] = 2;
+    ASSERT_TRUE(dbot::MeshCache::write(path, 7, vertices, indices));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+    const std::int32_t index = 3;
+    content.replace(content.size() - sizeof(index),
+                    sizeof(index),
+                    reinterpret_cast<const char*>(&index),
+                    sizeof(index));
+    write_file(path, content);
+
+    std::vector<Eigen::Vector3d> read_vertices;
+    std::vector<std::vector<int>> read_indices;
+    EXPECT_FALSE(dbot::MeshCache::read(path, 7, read_vertices, read_indices));
+
+    std::remove(path.c_str());
+}
+
+TEST(MeshCacheTests, caches_in_the_directory)
+{
+    const std::string directory =
+        "mesh_cache_directory_" + std::to_string(getpid());
+    const std::string path =
+        dbot::MeshCache::cache_path(directory, "/some/package/mesh.obj");
+    EXPECT_EQ(path.find(directory + "/"), 0u);
+    EXPECT_NE(path,
+              dbot::MeshCache::cache_path(directory, "/other/mesh.obj"));
+
+    // the directory is created by the first write
+    std::vector<Eigen::Vector3d> vertices(3, Eigen::Vector3d::Ones());
+    std::vector<std::vector<int>> indices(1, std::vector<int>{0, 1, 2});
+    ASSERT_TRUE(dbot::MeshCache::write(path, 7, vertices, indices));
+
+    std::vector<Eigen::Vector3d> read_vertices;
+    std::vector<std::vector<int>> read_indices;
+    EXPECT_TRUE(dbot::MeshCache::read(path, 7, read_vertices, read_indices));
+    EXPECT_EQ(read_indices, indices);
+
+    std::remove(path.c_str());
+    rmdir(directory.c_str());
+}
+
+TEST(MeshCacheTests, rejects_counts_beyond_the_file)
+{
+    const std::string path = "mesh_cache_counts.cache";
+    std::vector<Eigen::Vector3d> vertices(3, Eigen::Vector3d::Ones());
+    std::vector<std::vector<int>> indices(1, std::vector<int>{0, 1, 2});
+    ASSERT_TRUE(dbot::MeshCache::write(path, 7, vertices, indices));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+
+    // 2^61 more vertices of 24 bytes wrap around to the same size in 64 bits
+    const std::size_t vertex_count_offset = 24;
+    const std::uint64_t vertex_count = 3 + (std::uint64_t(1) << 61);
+    content.replace(vertex_count_offset,
+                    sizeof(vertex_count),
+                    reinterpret_cast<const char*>(&vertex_count),
+                    sizeof(vertex_count));
+    write_file(path, content);
+
+    std::vector<Eigen::Vector3d> read_vertices;
+    std::vector<std::vector<int>> read_indices;
+    EXPECT_FALSE(dbot::MeshCache::read(path, 7, read_vertices, read_indices));
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,498 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_levels.cpp
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <queue>
+
+#include <Eigen/LU>
+#include <Eigen/StdVector>
+
+#include <dbot/mesh_levels.h>
+
+namespace dbot
+{
+namespace
+{
+// weight of the planes which keep the border of open surfaces in place
+const double border_weight = 100.0;
+
+// collapses leading to triangles thinner than this, relative to their
+// longest edge, are rejected
+const double min_triangle_quality = 1e-3;
+
+typedef std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>>
+    Quadrics;
+
+Eigen::Matrix4d plane_quadric(const Eigen::Vector3d& normal,
+                              const Eigen::Vector3d& point,
+                              double weight)
+{
+    Eigen::Vector4d plane;
+    plane << normal, -normal.dot(point);
+    return weight * plane * plane.transpose();
+}
+
+double quadric_error(const Eigen::Matrix4d& quadric, const Eigen::Vector3d& p)
+{
+    Eigen::Vector4d point;
+    point << p, 1;
+    return std::max(point.dot(quadric * point), 0.0);
+}
+
+/**
+ * \brief Edge collapse decimation of the triangles of one part (Garland and
+ *        Heckbert). Each collapse merges two vertices into the position
+ *        which minimizes the sum of squared distances to the planes of the
+ *        triangles around both of them.
+ */
+class Decimation
+{
+public:
+    Decimation(const FlatMesh& mesh, int part)
+    {
+        const int first_vertex = mesh.vertex_begin(part);
+        for (int i = first_vertex; i < mesh.vertex_end(part); i++)
+        {
+            positions_.push_back(mesh.position(i).cast<double>());
+        }
+        quadrics_.assign(positions_.size(), Eigen::Matrix4d::Zero());
+        vertex_triangles_.resize(positions_.size());
+        vertex_alive_.assign(positions_.size(), true);
+        versions_.assign(positions_.size(), 0);
+
+        std::map<std::pair<int, int>, std::vector<int>> edges;
+        for (int i = mesh.triangle_begin(part); i < mesh.triangle_end(part);
+             i++)
+        {
+            const std::uint32_t* corners = mesh.triangle(i);
+            const int t = triangles_.size();
+            triangles_.push_back({{int(corners[0]) - first_vertex,
+                                   int(corners[1]) - first_vertex,
+                                   int(corners[2]) - first_vertex}});
+            for (int k = 0; k < 3; k++)
+            {
+                const int a = triangles_[t][k];
+                const int b = triangles_[t][(k + 1) % 3];
+                vertex_triangles_[a].push_back(t);
+                edges[std::make_pair(std::min(a, b), std::max(a, b))]
+                    .push_back(t);
+            }
+
+            const Eigen::Vector3d n = normal(triangles_[t]);
+            const double area = 0.5 * n.norm();
+            if (area == 0) continue;
+            const Eigen::Matrix4d quadric =
+                plane_quadric(n.normalized(), positions_[triangles_[t][0]],
+                              area);
+            for (int k = 0; k < 3; k++) quadrics_[triangles_[t][k]] += quadric;
+        }
+        triangle_alive_.assign(triangles_.size(), true);
+        triangle_count_ = triangles_.size();
+
+        // an edge of only one triangle lies on the border, it is kept in
+        // place by a plane through it perpendicular to the triangle
+        for (const auto& edge : edges)
+        {
+            if (edge.second.size() != 1) continue;
+            const int a = edge.first.first;
+            const int b = edge.first.second;
+            const Eigen::Vector3d side = positions_[b] - positions_[a];
+            const Eigen::Vector3d n =
+                side.cross(normal(triangles_[edge.second[0]]));
+            if (n.norm() == 0) continue;
+            const Eigen::Matrix4d quadric = plane_quadric(
+                n.normalized(), positions_[a],
+                border_weight * side.squaredNorm());
+            quadrics_[a] += quadric;
+            quadrics_[b] += quadric;
+        }
+
+        for (const auto& edge : edges)
+        {
+            push(edge.first.first, edge.first.second);
+        }
+    }
+
+    void collapse_to(int target_triangles)
+    {
+        while (triangle_count_ > target_triangles && !queue_.empty())
+        {
+            const Candidate candidate = queue_.top();
+            queue_.pop();
+            if (!vertex_alive_[candidate.a] || !vertex_alive_[candidate.b] ||
+                versions_[candidate.a] != candidate.version_a ||
+                versions_[candidate.b] != candidate.version_b)
+            {
+                continue;
+            }
+            collapse(candidate);
+        }
+    }
+
+    void result(std::vector<Eigen::Vector3d>& vertices,
+                std::vector<std::vector<int>>& indices) const
+    {
+        std::vector<int> new_index(positions_.size(), -1);
+        for (size_t t = 0; t < triangles_.size(); t++)
+        {
+            if (!triangle_alive_[t]) continue;
+            std::vector<int> triangle(3);
+            for (int k = 0; k < 3; k++)
+            {
+                int& index = new_index[triangles_[t][k]];
+                if (index < 0)
+                {
+                    index = vertices.size();
+                    vertices.push_back(positions_[triangles_[t][k]]);
+                }
+                triangle[k] = index;
+            }
+            indices.push_back(triangle);
+        }
+    }
+
+private:
+    typedef std::array<int, 3> Triangle;
+
+    struct Candidate
+    {
+        double cost;
+        int a;
+        int b;
+        int version_a;
+        int version_b;
+        Eigen::Vector3d position;
+
+        // the queue yields the cheapest collapse first
+        bool operator<(const Candidate& other) const
+        {
+            return cost > other.cost;
+        }
+    };
+
+    Eigen::Vector3d normal(const Triangle& triangle) const
+    {
+        return (positions_[triangle[1]] - positions_[triangle[0]])
+            .cross(positions_[triangle[2]] - positions_[triangle[0]]);
+    }
+
+    void push(int a, int b)
+    {
+        const Eigen::Matrix4d quadric = quadrics_[a] + quadrics_[b];
+
+        // the optimal position is only used if it is well defined and
+        // close to the edge, otherwise the best of the edge points is used
+        Candidate candidate;
+        candidate.position = 0.5 * (positions_[a] + positions_[b]);
+        candidate.cost = quadric_error(quadric, candidate.position);
+        const Eigen::Vector3d points[2] = {positions_[a], positions_[b]};
+        for (const Eigen::Vector3d& point : points)
+        {
+            const double cost = quadric_error(quadric, point);
+            if (cost < candidate.cost)
+            {
+                candidate.cost = cost;
+                candidate.position = point;
+            }
+        }
+
+        Eigen::FullPivLU<Eigen::Matrix3d> lu(quadric.topLeftCorner<3, 3>());
+        if (lu.isInvertible())
+        {
+            const Eigen::Vector3d optimum =
+                lu.solve(-quadric.topRightCorner<3, 1>());
+            const double length = (positions_[a] - positions_[b]).norm();
+            const double cost = quadric_error(quadric, optimum);
+            if ((optimum - 0.5 * (positions_[a] + positions_[b])).norm() <
+                    length &&
+                cost < candidate.cost)
+            {
+                candidate.cost = cost;
+                candidate.position = optimum;
+            }
+        }
+
+        candidate.a = a;
+        candidate.b = b;
+        candidate.version_a = versions_[a];
+        candidate.version_b = versions_[b];
+        queue_.push(candidate);
+    }
+
+    std::vector<int> neighbors(int vertex) const
+    {
+        std::vector<int> result;
+        for (int t : vertex_triangles_[vertex])
+        {
+            if (!triangle_alive_[t]) continue;
+            for (int k = 0; k < 3; k++)
+            {
+                if (triangles_[t][k] != vertex)
+                {
+                    result.push_back(triangles_[t][k]);
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    bool contains(const Triangle& triangle, int vertex) const
+    {
+        return triangle[0] == vertex || triangle[1] == vertex ||
+               triangle[2] == vertex;
+    }
+
+    /**
+     * \brief Whether the triangles around the vertex which do not contain
+     *        the other one keep their orientation and do not degenerate
+     *        if the vertex moves to the position
+     */
+    bool keeps_triangles(int vertex,
+                         int other,
+                         const Eigen::Vector3d& position) const
+    {
+        for (int t : vertex_triangles_[vertex])
+        {
+            if (!triangle_alive_[t] || contains(triangles_[t], other))
+            {
+                continue;
+            }
+
+            Triangle moved = triangles_[t];
+            Eigen::Vector3d corners[3];
+            double longest_edge = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                corners[k] =
+                    moved[k] == vertex ? position : positions_[moved[k]];
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                longest_edge = std::max(
+                    longest_edge,
+                    (corners[(k + 1) % 3] - corners[k]).squaredNorm());
+            }
+            const Eigen::Vector3d new_normal =
+                (corners[1] - corners[0]).cross(corners[2] - corners[0]);
+            if (new_normal.dot(normal(triangles_[t])) <= 0 ||
+                new_normal.norm() < min_triangle_quality * longest_edge)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void collapse(const Candidate& candidate)
+    {
+        const int a = candidate.a;
+        const int b = candidate.b;
+
+        // the surface stays manifold only if the vertices adjacent to both
+        // are exactly the third corners of the triangles on the edge
+        int shared_triangles = 0;
+        for (int t : vertex_triangles_[a])
+        {
+            if (triangle_alive_[t] && contains(triangles_[t], b))
+            {
+                shared_triangles++;
+            }
+        }
+        const std::vector<int> neighbors_a = neighbors(a);
+        const std::vector<int> neighbors_b = neighbors(b);
+        std::vector<int> common;
+        std::set_intersection(neighbors_a.begin(), neighbors_a.end(),
+                              neighbors_b.begin(), neighbors_b.end(),
+                              std::back_inserter(common));
+        if (shared_triangles == 0 || int(common.size()) != shared_triangles)
+        {
+            return;
+        }
+
+        if (!keeps_triangles(a, b, candidate.position) ||
+            !keeps_triangles(b, a, candidate.position))
+        {
+            return;
+        }
+
+        positions_[a] = candidate.position;
+        quadrics_[a] += quadrics_[b];
+        for (int t : vertex_triangles_[b])
+        {
+            if (!triangle_alive_[t]) continue;
+            if (contains(triangles_[t], a))
+            {
+                triangle_alive_[t] = false;
+                triangle_count_--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                if (triangles_[t][k] == b) triangles_[t][k] = a;
+            }
+            vertex_triangles_[a].push_back(t);
+        }
+        vertex_alive_[b] = false;
+        vertex_triangles_[b].clear();
+        versions_[a]++;
+
+        std::vector<int>& triangles_a = vertex_triangles_[a];
+        triangles_a.erase(std::remove_if(triangles_a.begin(),
+                                         triangles_a.end(),
+                                         [this](int t) {
+                                             return !triangle_alive_[t];
+                                         }),
+                          triangles_a.end());
+
+        for (int neighbor : neighbors(a))
+        {
+            push(a, neighbor);
+        }
+    }
+
+private:
+    std::vector<Eigen::Vector3d> positions_;
+    Quadrics quadrics_;
+    std::vector<Triangle> triangles_;
+    std::vector<bool> triangle_alive_;
+    std::vector<std::vector<int>> vertex_triangles_;
+    std::vector<bool> vertex_alive_;
+    std::vector<int> versions_;
+    std::priority_queue<Candidate> queue_;
+    int triangle_count_;
+};
+}
+
+MeshLevels::MeshLevels()
+    : levels_(1, std::make_shared<FlatMesh>()), pixels_per_triangle_(2.0f)
+{
+}
+
+MeshLevels::MeshLevels(const std::shared_ptr<const FlatMesh>& mesh)
+    : levels_(1, mesh), pixels_per_triangle_(2.0f)
+{
+    compute_bounding_spheres();
+}
+
+MeshLevels::MeshLevels(const std::shared_ptr<const FlatMesh>& mesh,
+                       int max_levels,
+                       int min_triangles,
+                       float pixels_per_triangle)
+    : levels_(1, mesh), pixels_per_triangle_(pixels_per_triangle)
+{
+    while (int(levels_.size()) < max_levels)
+    {
+        auto coarser = std::make_shared<FlatMesh>(
+            simplify(*levels_.back(), 0.5, min_triangles));
+        if (coarser->triangle_count() == levels_.back()->triangle_count())
+        {
+            break;
+        }
+        levels_.push_back(coarser);
+    }
+    compute_bounding_spheres();
+}
+
+FlatMesh MeshLevels::simplify(const FlatMesh& mesh,
+                              double ratio,
+                              int min_triangles)
+{
+    FlatMesh::Vertices vertices(mesh.part_count());
+    FlatMesh::TriangleIndices indices(mesh.part_count());
+    for (int part = 0; part < mesh.part_count(); part++)
+    {
+        const int triangles =
+            mesh.triangle_end(part) - mesh.triangle_begin(part);
+        const int target =
+            std::max(int(std::ceil(ratio * triangles)), min_triangles);
+
+        Decimation decimation(mesh, part);
+        if (target < triangles) decimation.collapse_to(target);
+        decimation.result(vertices[part], indices[part]);
+    }
+    return FlatMesh(vertices, indices);
+}
+
+int MeshLevels::select(int part,
+                       const Eigen::Matrix3d& rotation,
+                       const Eigen::Vector3d& translation,
+                       const Eigen::Matrix3d& camera_matrix) const
+{
+    if (levels_.size() == 1) return 0;
+
+    const double depth = (rotation * centers_[part] + translation)(2);
+    const double near_depth = depth - radii_[part];
+    if (near_depth <= 0) return 0;
+
+    const double focal_length =
+        std::max(camera_matrix(0, 0), camera_matrix(1, 1));
+    const double projected_radius = focal_length * radii_[part] / near_depth;
+    const double max_triangles =
+        M_PI * projected_radius * projected_radius / pixels_per_triangle_;
+
+    for (size_t level = 0; level + 1 < levels_.size(); level++)
+    {
+        const FlatMesh& mesh = *levels_[level];
+        if (mesh.triangle_end(part) - mesh.triangle_begin(part) <=
+            max_triangles)
+        {
+            return level;
+        }
+    }
+    return levels_.size() - 1;
+}
+
+void MeshLevels::compute_bounding_spheres()
+{
+    // the sphere around the center of the bounding box of the full mesh
+    // also contains the coarser levels up to the small shifts of the
+    // merged vertices
+    const FlatMesh& mesh = *levels_.front();
+    centers_.resize(mesh.part_count());
+    radii_.resize(mesh.part_count());
+    for (int part = 0; part < mesh.part_count(); part++)
+    {
+        Eigen::Vector3d min = Eigen::Vector3d::Constant(
+            std::numeric_limits<double>::infinity());
+        Eigen::Vector3d max = -min;
+        for (int i = mesh.vertex_begin(part); i < mesh.vertex_end(part); i++)
+        {
+            min = min.cwiseMin(mesh.position(i).cast<double>());
+            max = max.cwiseMax(mesh.position(i).cast<double>());
+        }
+
+        centers_[part] = Eigen::Vector3d::Zero();
+        radii_[part] = 0;
+        if (mesh.vertex_end(part) == mesh.vertex_begin(part)) continue;
+
+        centers_[part] = 0.5 * (min + max);
+        for (int i = mesh.vertex_begin(part); i < mesh.vertex_end(part); i++)
+        {
+            radii_[part] = std::max(
+                radii_[part],
+                (mesh.position(i).cast<double>() - centers_[part]).norm());
+        }
+    }
+}
+}
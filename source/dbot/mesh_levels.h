@@ -0,0 +1,106 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_levels.h
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/flat_mesh.h>
+
+namespace dbot
+{
+/**
+ * \brief Levels of detail of a mesh, level 0 is the full mesh and every
+ *        further level is a quadric error decimation of the previous one.
+ *
+ * All levels have the same parts. The level a part is rendered with is
+ * chosen from the projected size of its bounding sphere, such that the
+ * triangles of the part do not get much smaller than a few pixels.
+ */
+class MeshLevels
+{
+public:
+    /**
+     * \brief Creates a single level without parts
+     */
+    MeshLevels();
+
+    /**
+     * \brief Holds the mesh as the only level, no simplification is done
+     */
+    explicit MeshLevels(const std::shared_ptr<const FlatMesh>& mesh);
+
+    /**
+     * \brief Decimates the mesh into at most max_levels levels, each with
+     *        about half of the triangles of the previous one
+     *
+     * \param min_triangles  parts are not decimated below this count, no
+     *                       further level is created once no part can be
+     *                       reduced any more
+     * \param pixels_per_triangle  projected bounding sphere area in pixels
+     *                             per triangle below which a coarser level
+     *                             is selected
+     */
+    MeshLevels(const std::shared_ptr<const FlatMesh>& mesh,
+               int max_levels,
+               int min_triangles = 64,
+               float pixels_per_triangle = 2.0f);
+
+    /**
+     * \brief Quadric error edge collapse of every part down to about
+     *        ratio times its triangles, but not below min_triangles
+     */
+    static FlatMesh simplify(const FlatMesh& mesh,
+                             double ratio,
+                             int min_triangles);
+
+    int level_count() const { return int(levels_.size()); }
+
+    const FlatMesh& level(int level) const { return *levels_[level]; }
+
+    const std::vector<std::shared_ptr<const FlatMesh>>& levels() const
+    {
+        return levels_;
+    }
+
+    /**
+     * \brief Finest level whose triangles of the part do not exceed the
+     *        projected area of its bounding sphere divided by
+     *        pixels_per_triangle, the coarsest level if none does.
+     *        A part which reaches behind the camera gets level 0.
+     */
+    int select(int part,
+               const Eigen::Matrix3d& rotation,
+               const Eigen::Vector3d& translation,
+               const Eigen::Matrix3d& camera_matrix) const;
+
+private:
+    void compute_bounding_spheres();
+
+private:
+    std::vector<std::shared_ptr<const FlatMesh>> levels_;
+
+    /** bounding sphere of each part in the frame of the part */
+    std::vector<Eigen::Vector3d> centers_;
+    std::vector<double> radii_;
+
+    float pixels_per_triangle_;
+};
+}
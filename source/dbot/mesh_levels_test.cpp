@@ -0,0 +1,165 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file mesh_levels_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include <dbot/mesh_levels.h>
+
+namespace
+{
+/**
+ * \brief Unit sphere as a subdivided octahedron with outward triangles
+ */
+std::shared_ptr<const dbot::FlatMesh> sphere(int subdivisions)
+{
+    std::vector<Eigen::Vector3d> vertices = {Eigen::Vector3d(1, 0, 0),
+                                             Eigen::Vector3d(-1, 0, 0),
+                                             Eigen::Vector3d(0, 1, 0),
+                                             Eigen::Vector3d(0, -1, 0),
+                                             Eigen::Vector3d(0, 0, 1),
+                                             Eigen::Vector3d(0, 0, -1)};
+    std::vector<std::vector<int>> triangles = {{0, 2, 4},
+                                               {2, 1, 4},
+                                               {1, 3, 4},
+                                               {3, 0, 4},
+                                               {2, 0, 5},
+                                               {1, 2, 5},
+                                               {3, 1, 5},
+                                               {0, 3, 5}};
+
+    for (int i = 0; i < subdivisions; i++)
+    {
+        std::map<std::pair<int, int>, int> midpoints;
+        auto midpoint = [&](int a, int b) {
+            auto key = std::make_pair(std::min(a, b), std::max(a, b));
+            auto it = midpoints.find(key);
+            if (it != midpoints.end()) return it->second;
+            vertices.push_back((vertices[a] + vertices[b]).normalized());
+            midpoints[key] = vertices.size() - 1;
+            return int(vertices.size() - 1);
+        };
+
+        std::vector<std::vector<int>> finer;
+        for (const std::vector<int>& t : triangles)
+        {
+            const int ab = midpoint(t[0], t[1]);
+            const int bc = midpoint(t[1], t[2]);
+            const int ca = midpoint(t[2], t[0]);
+            finer.push_back({t[0], ab, ca});
+            finer.push_back({ab, t[1], bc});
+            finer.push_back({ca, bc, t[2]});
+            finer.push_back({ab, bc, ca});
+        }
+        triangles = finer;
+    }
+
+    return std::make_shared<dbot::FlatMesh>(
+        dbot::FlatMesh::Vertices(1, vertices),
+        dbot::FlatMesh::TriangleIndices(1, triangles));
+}
+}
+
+TEST(MeshLevelsTests, simplify_keeps_a_closed_surface_close_to_the_input)
+{
+    auto mesh = sphere(4);
+    ASSERT_EQ(mesh->triangle_count(), 2048);
+
+    const dbot::FlatMesh simple = dbot::MeshLevels::simplify(*mesh, 0.25, 64);
+    EXPECT_LE(simple.triangle_count(), 512);
+    EXPECT_GE(simple.triangle_count(), 64);
+
+    // every undirected edge is shared by two triangles of opposite direction
+    std::map<std::pair<int, int>, int> edges;
+    for (int i = 0; i < simple.triangle_count(); i++)
+    {
+        const std::uint32_t* t = simple.triangle(i);
+        for (int k = 0; k < 3; k++)
+        {
+            ++edges[std::make_pair(int(t[k]), int(t[(k + 1) % 3]))];
+        }
+    }
+    for (const auto& edge : edges)
+    {
+        EXPECT_EQ(edge.second, 1);
+        EXPECT_EQ(edges.count(std::make_pair(edge.first.second,
+                                             edge.first.first)),
+                  1u);
+    }
+
+    for (int i = 0; i < simple.vertex_count(); i++)
+    {
+        EXPECT_NEAR(simple.position(i).norm(), 1.0, 0.05);
+    }
+}
+
+TEST(MeshLevelsTests, levels_halve_the_triangles)
+{
+    dbot::MeshLevels levels(sphere(4), 4, 64);
+
+    ASSERT_EQ(levels.level_count(), 4);
+    EXPECT_EQ(levels.level(0).triangle_count(), 2048);
+    for (int i = 1; i < levels.level_count(); i++)
+    {
+        EXPECT_LE(levels.level(i).triangle_count(),
+                  levels.level(i - 1).triangle_count() / 2 + 1);
+        EXPECT_EQ(levels.level(i).part_count(), 1);
+    }
+}
+
+TEST(MeshLevelsTests, select_coarsens_with_distance)
+{
+    dbot::MeshLevels levels(sphere(4), 4, 64);
+    Eigen::Matrix3d camera_matrix;
+    camera_matrix << 500, 0, 320, 0, 500, 240, 0, 0, 1;
+    const Eigen::Matrix3d R = Eigen::Matrix3d::Identity();
+
+    // a radius of 250 pixels fits the full mesh
+    EXPECT_EQ(levels.select(0, R, Eigen::Vector3d(0, 0, 3), camera_matrix), 0);
+
+    // a few pixels only take the coarsest level
+    EXPECT_EQ(levels.select(0, R, Eigen::Vector3d(0, 0, 500), camera_matrix),
+              levels.level_count() - 1);
+
+    int previous = 0;
+    for (double depth = 2; depth < 500; depth *= 1.5)
+    {
+        const int level =
+            levels.select(0, R, Eigen::Vector3d(0, 0, depth), camera_matrix);
+        EXPECT_GE(level, previous);
+        previous = level;
+    }
+
+    // behind or around the camera the full mesh is used
+    EXPECT_EQ(levels.select(0, R, Eigen::Vector3d(0, 0, 0.5), camera_matrix),
+              0);
+}
+
+TEST(MeshLevelsTests, single_level_is_not_simplified)
+{
+    auto mesh = sphere(2);
+    dbot::MeshLevels levels(mesh);
+
+    ASSERT_EQ(levels.level_count(), 1);
+    EXPECT_EQ(levels.levels()[0], mesh);
+    EXPECT_EQ(levels.select(0,
+                            Eigen::Matrix3d::Identity(),
+                            Eigen::Vector3d(0, 0, 1000),
+                            Eigen::Matrix3d::Identity()),
+              0);
+}
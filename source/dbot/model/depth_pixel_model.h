@@ -31,6 +31,7 @@
 
 #include <Eigen/Dense>
 #include <cstdlib>
+#include <dbot/model/sigma_point_render_table.h>
 #include <dbot/pose/pose_hashing.h>
 #include <dbot/rigid_body_renderer.h>
 #include <fl/distribution/cauchy_distribution.hpp>
@@ -59,19 +60,29 @@ public:
     typedef std::unordered_map<State, State, dbot::PoseHash<State>>
         PoseCacheMap;
 
-    typedef std::unordered_map<State, Eigen::VectorXd, dbot::PoseHash<State>>
-        RenderCacheMap;
+    /** renderings of the sigma points, shared by the models of all pixels */
+    typedef dbot::SigmaPointRenderTable<State> RenderTable;
 
 public:
+    /**
+     * \param render_cache_capacity	renderings kept across the updates
+     * \param render_cache_precision	rendered poses which agree to this
+     *                              precision in m and rad share a rendering
+     */
     DepthPixelModel(const std::shared_ptr<dbot::RigidBodyRenderer>& renderer,
                     Real bg_depth,
                     Real fg_sigma,
                     Real bg_sigma,
-                    int state_dim = DimensionOf<State>::Value)
+                    int state_dim = DimensionOf<State>::Value,
+                    int render_cache_capacity = 64,
+                    double render_cache_precision = 1e-4)
         : state_dim_(state_dim), renderer_(renderer), id_(0)
     {
         mutex = std::make_shared<std::mutex>();
-        render_cache_ = std::make_shared<RenderCacheMap>();
+        render_table_ = std::make_shared<RenderTable>(
+            renderer_->n_rows_ * renderer_->n_cols_,
+            render_cache_capacity,
+            render_cache_precision);
         poses_cache_ = std::make_shared<PoseCacheMap>();
 
         // setup backgroud density
@@ -94,7 +105,7 @@ public:
         fg_density_ = other.fg_density_;
         mutex = other.mutex;
         nominal_pose_ = other.nominal_pose_;
-        render_cache_ = other.render_cache_;
+        render_table_ = other.render_table_;
         poses_cache_ = other.poses_cache_;
     }
 
@@ -120,43 +131,37 @@ public:
     virtual int state_dimension() const { return state_dim_; }
     virtual int id() const { return id_; }
     virtual void id(int new_id) { id_ = new_id; }
+    /**
+     * \brief Sets the pose around which the next update linearizes and
+     *        starts a new update of the render table. The renderings of
+     *        former updates are reused if a sigma point ends up in the same
+     *        pose.
+     */
     void nominal_pose(const State& p)
     {
         std::lock_guard<std::mutex> lock(*mutex);
 
-        render_cache_->clear();
+        render_table_->next_update();
         nominal_pose_ = p;
     }
 
+    /**
+     * \brief Renderings shared by the models of all pixels, e.g. for its
+     *        hit rate
+     */
+    const RenderTable& render_table() const { return *render_table_; }
+
     virtual std::string name() const { return "DepthPixelModel"; }
     virtual std::string description() const { return "DepthPixelModel"; }
 private:
     /** \cond internal */
-    void map(const State& pose, Eigen::VectorXd& obsrv_image) const
+    void map(const State& pose, dbot::SparseDepthImages& rendering) const
     {
-        renderer_->set_poses({pose.component(0).affine()});
-        renderer_->Render(depth_rendering_);
-
-        convert(depth_rendering_, obsrv_image);
-    }
-
-    void convert(const std::vector<float>& depth,
-                 Eigen::VectorXd& obsrv_image) const
-    {
-        const int pixel_count = depth.size();
-        obsrv_image.resize(pixel_count, 1);
-
-        for (int i = 0; i < pixel_count; ++i)
-        {
-            if (!std::isinf(depth[i]))
-            {
-                obsrv_image(i, 0) = depth[i];
-            }
-            else
-            {
-                obsrv_image(i, 0) = std::numeric_limits<double>::infinity();
-            }
-        }
+        renderer_->RenderSparse({{pose.component(0).affine()}},
+                                renderer_->camera_matrix_,
+                                renderer_->n_rows_,
+                                renderer_->n_cols_,
+                                rendering);
     }
 
     const Gaussian<Obsrv>& density(const State& state) const
@@ -174,10 +179,15 @@ private:
 
     Obsrv depth(const State& current_state) const
     {
-        RenderCacheMap& render_cache_ = *this->render_cache_;
+        RenderTable& render_table = *this->render_table_;
         PoseCacheMap& poses_cache_ = *this->poses_cache_;
 
-        if (render_cache_.find(current_state) == render_cache_.end())
+        // the table is shared by the copies of all pixels, which the filter
+        // may evaluate from several threads
+        std::lock_guard<std::mutex> lock(*mutex);
+
+        int point = render_table.find(current_state);
+        if (point < 0)
         {
             State current_pose = current_state;
 
@@ -192,15 +202,17 @@ private:
                 nominal_pose_.component(0).orientation() *
                 current_state.component(0).orientation();
 
-            std::lock_guard<std::mutex> lock(*mutex);
-            map(current_pose, render_cache_[current_state]);
+            point = render_table.insert(
+                current_state,
+                current_pose.component(0).pose(),
+                [&](dbot::SparseDepthImages& rendering) {
+                    map(current_pose, rendering);
+                });
             poses_cache_[current_state] = current_pose;
         }
 
-        assert(render_cache_.find(current_state) != render_cache_.end());
-
         Obsrv depth;
-        depth(0) = render_cache_[current_state](id_);
+        depth(0) = render_table.depth(id_, point);
 
         return depth;
     }
@@ -213,7 +225,6 @@ private:
     mutable Gaussian<Obsrv> bg_density_;
 
     mutable std::shared_ptr<std::mutex> mutex;
-    mutable std::vector<float> depth_rendering_;
     std::shared_ptr<dbot::RigidBodyRenderer> renderer_;
 
 private:
@@ -221,7 +232,7 @@ private:
     mutable State nominal_pose_;
 
 public:
-    mutable std::shared_ptr<RenderCacheMap> render_cache_;
+    mutable std::shared_ptr<RenderTable> render_table_;
     mutable std::shared_ptr<PoseCacheMap> poses_cache_;
 };
 }
@@ -0,0 +1,246 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gaussian_image_model.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/filter/parallel_information_update.h>
+#include <dbot/gpu/sigma_point_moments.h>
+#include <dbot/pose/pose_composition.h>
+#include <dbot/rigid_body_renderer.h>
+
+namespace dbot
+{
+/**
+ * \brief Measurement update of the Gaussian tracker on the CPU.
+ *
+ * The unscented sigma points of the belief are rendered in one sparse batch
+ * and every pixel is linearized over them with the body/tail moments of
+ * SigmaPointMoments, as done on the GPU by GaussianImageModelGPU. The
+ * information of the pixels is summed by a ParallelInformationUpdate. Only
+ * the pixels covered by at least one sigma point are visited, the others
+ * have the same moments under all points and carry no information. The
+ * states are deltas from the nominal pose as for the DepthPixelModel.
+ */
+template <typename State>
+class GaussianImageModel
+{
+public:
+    typedef ParallelInformationUpdate::Vector Vector;
+    typedef ParallelInformationUpdate::Matrix Matrix;
+    typedef RigidBodyRenderer::Affine Affine;
+
+public:
+    /**
+     * \param renderer		renders at its camera matrix and resolution
+     * \param parameters	body/tail pixel model
+     * \param ut_alpha		spread of the sigma points
+     */
+    GaussianImageModel(const std::shared_ptr<RigidBodyRenderer>& renderer,
+                       const SigmaPointMoments::Parameters& parameters,
+                       double ut_alpha,
+                       int thread_count = 1)
+        : renderer_(renderer),
+          moments_(parameters),
+          ut_alpha_(ut_alpha),
+          update_(thread_count),
+          slots_(renderer->n_rows_ * renderer->n_cols_, -1)
+    {
+    }
+
+    /** \param cpus  CPUs the threads are placed on, see ThreadPool */
+    void set_thread_count(int thread_count,
+                          const ThreadPool::CpuSet& cpus = ThreadPool::CpuSet())
+    {
+        update_.set_thread_count(thread_count, cpus);
+    }
+
+    int thread_count() const { return update_.thread_count(); }
+
+    /**
+     * \brief Sets the pose the deltas of the states are applied to
+     */
+    void nominal_pose(const State& pose) { nominal_pose_ = pose; }
+
+    const State& nominal_pose() const { return nominal_pose_; }
+
+    /**
+     * \brief Sets the depth image, one value per pixel in row major order.
+     *        Pixels without a finite value are skipped.
+     */
+    void set_observation(const Eigen::VectorXd& image) { image_ = image; }
+
+    /**
+     * \brief Updates the belief given by the mean delta and its covariance
+     *        with the current observation
+     */
+    void update(const State& mean,
+                const Matrix& covariance,
+                State& posterior_mean,
+                Matrix& posterior_covariance)
+    {
+        sigma_points(mean, covariance);
+        render();
+
+        const int point_count = points_.cols();
+        Vector delta;
+        update_.update(mean,
+                       covariance,
+                       points_,
+                       weights_,
+                       observations_,
+                       [&](int pixel, int point, double& m, double& v) {
+                           float pixel_mean, pixel_variance;
+                           moments_.pixel_moments(
+                               depths_[pixel * point_count + point],
+                               pixel_mean,
+                               pixel_variance);
+                           m = pixel_mean;
+                           v = pixel_variance;
+                       },
+                       delta,
+                       posterior_covariance);
+        posterior_mean = State(delta);
+    }
+
+private:
+    /**
+     * \brief Unscented sigma points, whose mean and covariance weights agree
+     *        as required by the information update
+     */
+    void sigma_points(const Vector& mean, const Matrix& covariance)
+    {
+        const int dimension = mean.size();
+        const double lambda = ut_alpha_ * ut_alpha_ * dimension - dimension;
+
+        // the square root through the eigen decomposition also holds for a
+        // semi definite covariance
+        const Eigen::SelfAdjointEigenSolver<Matrix> solver(covariance);
+        const Matrix root =
+            solver.eigenvectors() *
+            solver.eigenvalues().cwiseMax(0).cwiseSqrt().asDiagonal() *
+            std::sqrt(dimension + lambda);
+
+        points_.resize(dimension, 2 * dimension + 1);
+        points_.col(0) = mean;
+        for (int i = 0; i < dimension; i++)
+        {
+            points_.col(1 + i) = mean + root.col(i);
+            points_.col(1 + dimension + i) = mean - root.col(i);
+        }
+
+        weights_ = Vector::Constant(points_.cols(), 0.5 / (dimension + lambda));
+        weights_(0) = lambda / (dimension + lambda);
+    }
+
+    /**
+     * \brief Renders the sigma points applied to the nominal pose and
+     *        collects the depths of the covered pixels, 0 where a point
+     *        does not cover the pixel
+     */
+    void render()
+    {
+        const int point_count = points_.cols();
+        const int body_count = nominal_pose_.count();
+
+        composition_.base_poses(nominal_pose_);
+        poses_.resize(point_count);
+        Eigen::Matrix4d homogeneous;
+        for (int point = 0; point < point_count; point++)
+        {
+            poses_[point].resize(body_count);
+            for (int body = 0; body < body_count; body++)
+            {
+                composition_.compose(
+                    points_.col(point), body, homogeneous.data());
+                poses_[point][body].matrix() = homogeneous;
+            }
+        }
+        renderer_->RenderSparse(poses_,
+                                renderer_->camera_matrix_,
+                                renderer_->n_rows_,
+                                renderer_->n_cols_,
+                                renderings_);
+
+        // one slot per covered pixel with a finite observation
+        pixels_.clear();
+        for (int point = 0; point < point_count; point++)
+        {
+            for (int k = renderings_.begin(point); k < renderings_.end(point);
+                 k++)
+            {
+                const int pixel = renderings_.indices[k];
+                if (slots_[pixel] >= 0 || !std::isfinite(image_(pixel)))
+                {
+                    continue;
+                }
+                slots_[pixel] = pixels_.size();
+                pixels_.push_back(pixel);
+            }
+        }
+
+        observations_.resize(pixels_.size());
+        for (size_t i = 0; i < pixels_.size(); i++)
+        {
+            observations_(i) = image_(pixels_[i]);
+        }
+
+        depths_.assign(pixels_.size() * point_count, 0);
+        for (int point = 0; point < point_count; point++)
+        {
+            for (int k = renderings_.begin(point); k < renderings_.end(point);
+                 k++)
+            {
+                const int slot = slots_[renderings_.indices[k]];
+                if (slot >= 0)
+                {
+                    depths_[slot * point_count + point] = renderings_.depths[k];
+                }
+            }
+        }
+
+        for (int pixel : pixels_) slots_[pixel] = -1;
+    }
+
+private:
+    std::shared_ptr<RigidBodyRenderer> renderer_;
+    SigmaPointMoments moments_;
+    double ut_alpha_;
+    ParallelInformationUpdate update_;
+
+    State nominal_pose_;
+    PoseComposition composition_;
+    Eigen::VectorXd image_;
+
+    Matrix points_;
+    Vector weights_;
+    std::vector<std::vector<Affine>> poses_;
+    SparseDepthImages renderings_;
+
+    // covered pixels, their slot within the image and the depths of each
+    // slot under all sigma points
+    std::vector<int> pixels_;
+    std::vector<int> slots_;
+    Vector observations_;
+    std::vector<float> depths_;
+};
+}
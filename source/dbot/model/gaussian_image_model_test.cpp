@@ -0,0 +1,170 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file gaussian_image_model_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <vector>
+
+#include <dbot/model/gaussian_image_model.h>
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+
+namespace
+{
+typedef dbot::FreeFloatingRigidBodiesState<> State;
+typedef dbot::GaussianImageModel<State> Model;
+typedef dbot::RigidBodyRenderer::Affine Affine;
+
+class GaussianImageModelTests : public ::testing::Test
+{
+protected:
+    GaussianImageModelTests() : n_rows_(60), n_cols_(80), nominal_(1)
+    {
+        // cube of 10 cm centered at the origin
+        std::vector<Eigen::Vector3d> vertices;
+        for (int i = 0; i < 8; ++i)
+        {
+            vertices.push_back(Eigen::Vector3d((i & 1) ? 0.05 : -0.05,
+                                               (i & 2) ? 0.05 : -0.05,
+                                               (i & 4) ? 0.05 : -0.05));
+        }
+
+        int faces[12][3] = {{0, 2, 1},
+                            {1, 2, 3},
+                            {4, 5, 6},
+                            {5, 7, 6},
+                            {0, 1, 4},
+                            {1, 5, 4},
+                            {2, 6, 3},
+                            {3, 6, 7},
+                            {0, 4, 2},
+                            {2, 4, 6},
+                            {1, 3, 5},
+                            {3, 7, 5}};
+        std::vector<std::vector<int>> indices;
+        for (int i = 0; i < 12; ++i)
+        {
+            indices.push_back(std::vector<int>(faces[i], faces[i] + 3));
+        }
+
+        Eigen::Matrix3d camera_matrix;
+        camera_matrix << 100, 0, n_cols_ / 2., 0, 100, n_rows_ / 2., 0, 0, 1;
+
+        renderer_ = std::make_shared<dbot::RigidBodyRenderer>(
+            std::vector<std::vector<Eigen::Vector3d>>(1, vertices),
+            std::vector<std::vector<std::vector<int>>>(1, indices),
+            camera_matrix,
+            n_rows_,
+            n_cols_);
+
+        nominal_.component(0).position() = Eigen::Vector3d(0.01, 0.01, 0.5);
+        parameters_.bg_depth = 1.0;
+
+        // the velocities do not change the rendering
+        covariance_ = Eigen::MatrixXd::Zero(12, 12);
+        covariance_.diagonal().head(3).setConstant(2.5e-5);
+        covariance_.diagonal().segment(3, 3).setConstant(1e-3);
+        covariance_.diagonal().tail(6).setConstant(1e-4);
+    }
+
+    /** \brief Depth image of the cube shifted along x in front of the
+     *         background */
+    Eigen::VectorXd observation(double shift) const
+    {
+        Affine pose = nominal_.component(0).affine();
+        pose.pretranslate(Eigen::Vector3d(shift, 0, 0));
+
+        dbot::SparseDepthImages rendering;
+        renderer_->RenderSparse({{pose}},
+                                renderer_->camera_matrix_,
+                                n_rows_,
+                                n_cols_,
+                                rendering);
+
+        Eigen::VectorXd image =
+            Eigen::VectorXd::Constant(n_rows_ * n_cols_, parameters_.bg_depth);
+        for (int k = rendering.begin(0); k < rendering.end(0); k++)
+        {
+            image(rendering.indices[k]) = rendering.depths[k];
+        }
+        return image;
+    }
+
+    void update(Model& model,
+                const Eigen::VectorXd& image,
+                State& mean,
+                Eigen::MatrixXd& covariance)
+    {
+        State zero(1);
+        model.nominal_pose(nominal_);
+        model.set_observation(image);
+        model.update(zero, covariance_, mean, covariance);
+    }
+
+    dbot::SigmaPointMoments::Parameters parameters_;
+    int n_rows_;
+    int n_cols_;
+    State nominal_;
+    Eigen::MatrixXd covariance_;
+    std::shared_ptr<dbot::RigidBodyRenderer> renderer_;
+};
+}
+
+TEST_F(GaussianImageModelTests, moves_towards_the_observation)
+{
+    Model model(renderer_, parameters_, 1.0);
+
+    State mean;
+    Eigen::MatrixXd covariance;
+    update(model, observation(0.004), mean, covariance);
+    EXPECT_GT(mean(0), 0.0);
+    EXPECT_LT(mean(0), 0.004);
+    EXPECT_LT(covariance(0, 0), covariance_(0, 0));
+
+    update(model, observation(-0.004), mean, covariance);
+    EXPECT_LT(mean(0), 0.0);
+    EXPECT_GT(mean(0), -0.004);
+}
+
+TEST_F(GaussianImageModelTests, result_does_not_depend_on_the_threads)
+{
+    Model serial(renderer_, parameters_, 1.0, 1);
+    Model parallel(renderer_, parameters_, 1.0, 3);
+    const Eigen::VectorXd image = observation(0.002);
+
+    State serial_mean, parallel_mean;
+    Eigen::MatrixXd serial_covariance, parallel_covariance;
+    update(serial, image, serial_mean, serial_covariance);
+    update(parallel, image, parallel_mean, parallel_covariance);
+
+    EXPECT_TRUE(serial_mean.isApprox(parallel_mean, 1e-12));
+    EXPECT_TRUE(serial_covariance.isApprox(parallel_covariance, 1e-12));
+}
+
+TEST_F(GaussianImageModelTests, missing_observations_are_not_informative)
+{
+    Model model(renderer_, parameters_, 1.0);
+    const Eigen::VectorXd image = Eigen::VectorXd::Constant(
+        n_rows_ * n_cols_, std::numeric_limits<double>::quiet_NaN());
+
+    State mean;
+    Eigen::MatrixXd covariance;
+    update(model, image, mean, covariance);
+
+    EXPECT_TRUE(mean.isZero(1e-12));
+    EXPECT_TRUE(covariance.isApprox(covariance_, 1e-9));
+}
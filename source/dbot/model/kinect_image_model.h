@@ -30,13 +30,23 @@
 
 #include <Eigen/Core>
 #include <dbot/model/kinect_pixel_model.h>
+#include <dbot/model/occlusion_arena.h>
+#include <dbot/image_region.h>
+#include <dbot/memory_planner.h>
 #include <dbot/model/occlusion_model.h>
 #include <dbot/model/rao_blackwell_sensor.h>
 #include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/pose/pose_composition.h>
 #include <dbot/pose/pose_vector.h>
+#include <dbot/profiler.h>
 #include <dbot/rigid_body_renderer.h>
+#include <dbot/thread_pool.h>
 #include <dbot/traits.h>
 #include <fl/util/assertions.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -58,15 +68,23 @@ struct Traits<KinectImageModel<Scalar, State, OBJECTS>>
     typedef RbSensor<State> SensorBase;
     typedef typename SensorBase::Observation Observation;
 
-    typedef std::shared_ptr<dbot::RigidBodyRenderer> ObjectRendererPtr;
-    typedef std::shared_ptr<dbot::KinectPixelModel> PixelSensorPtr;
-    typedef std::shared_ptr<dbot::OcclusionModel> OcclusionModelPtr;
+    // the models are only used through their const interfaces and may be
+    // shared among sensors evaluated concurrently
+    typedef std::shared_ptr<const dbot::RigidBodyRenderer> ObjectRendererPtr;
+    typedef std::shared_ptr<const dbot::KinectPixelModel> PixelSensorPtr;
+    typedef std::shared_ptr<const dbot::OcclusionModel> OcclusionModelPtr;
 };
 }
 
 /**
  * \class ImageSensorCPU
  *
+ * The renderer, the pixel model and the occlusion model are stateless during
+ * loglikes(): the poses, predictions and occlusions are passed to their const
+ * batch functions explicitly. All mutable state, the occlusions and the
+ * observation, is owned by the sensor, hence several trackers and threads may
+ * share one set of models without locks.
+ *
  * \ingroup distributions
  * \ingroup sensors
  */
@@ -90,6 +108,13 @@ public:
     typedef typename Eigen::Transform<fl::Real, 3, Eigen::Affine> Affine;
 
     // TODO: DO WE NEED ALL OF THIS IN THE CONSTRUCTOR??
+    /**
+     * \param thread_count     Number of threads the particles are distributed
+     *                         on
+     * \param cpus             CPUs the threads are placed on. The buffers
+     *                         which the loops touch first are allocated on
+     *                         the node of the CPUs.
+     */
     KinectImageModel(const Eigen::Matrix3d& camera_matrix,
                      const size_t& n_rows,
                      const size_t& n_cols,
@@ -97,7 +122,9 @@ public:
                      const PixelSensorPtr sensor,
                      const OcclusionModelPtr occlusion_transition,
                      const float& initial_occlusion,
-                     const double& delta_time)
+                     const double& delta_time,
+                     const int& thread_count = 1,
+                     const ThreadPool::CpuSet& cpus = ThreadPool::CpuSet())
         : camera_matrix_(camera_matrix),
           n_rows_(n_rows),
           n_cols_(n_cols),
@@ -105,14 +132,25 @@ public:
           object_model_(object_renderer),
           sensor_(sensor),
           occlusion_transition_(occlusion_transition),
+          occlusions_(n_rows, n_cols, initial_occlusion),
+          region_of_interest_(n_rows, n_cols),
           observation_time_(0),
+          observations_account_(MemoryComponent::HostObservations),
+          render_cache_account_(MemoryComponent::HostRenderCache),
           Base(delta_time)
     {
-        static_assert_base(State, dbot::RigidBodiesState<OBJECTS>);
+        // the fixed size states of DBOT_FIXED_SIZE_STATE are rigid bodies
+        // states of their own size
+        static_assert_base(State,
+                           dbot::RigidBodiesState<State::SizeAtCompileTime>);
 
         this->default_poses_.recount(object_model_->vertices().size());
         this->default_poses_.setZero();
 
+        box_corners_ = bounding_box_corners(object_model_->mesh());
+
+        set_thread_count(thread_count, cpus);
+
         reset();
     }
 
@@ -121,146 +159,432 @@ public:
                        IntArray& indices,
                        const bool& update = false)
     {
-        std::vector<std::vector<float>> new_occlusions(deltas.size());
-        std::vector<std::vector<double>> new_occlusion_times(deltas.size());
-
-        RealArray log_likes = RealArray::Zero(deltas.size());
-        for (size_t i_state = 0; i_state < size_t(deltas.size()); i_state++)
-        {
-            if (update)
-            {
-                new_occlusions[i_state] = occlusions_[indices[i_state]];
-                new_occlusion_times[i_state] =
-                    occlusion_times_[indices[i_state]];
-            }
-
-            // render the object model -----------------------------------------
-            int body_count = deltas[i_state].count();
-            std::vector<Affine> poses(body_count);
-            for (size_t i_obj = 0; i_obj < body_count; i_obj++)
-            {
-                auto pose_0 = this->default_poses_.component(i_obj);
-                auto delta = deltas[i_state].component(i_obj);
-
-                dbot::PoseVector pose;
+        RealArray log_likes;
+        compute_loglikes(deltas, indices, update, log_likes);
+        return log_likes;
+    }
 
-                /// \todo: this should be done through the the apply_delta
-                /// function
-                pose.position() =
-                    pose_0.orientation().rotation_matrix() * delta.position() +
-                    pose_0.position();
-                pose.orientation() = pose_0.orientation() * delta.orientation();
+    void compute_loglikes(const StateArray& deltas,
+                          IntArray& indices,
+                          const bool& update,
+                          RealArray& log_likes)
+    {
+        log_likes.resize(deltas.size());
+        composition_.base_poses(this->default_poses_);
 
-                poses[i_obj] = pose.affine();
-            }
-            object_model_->set_poses(poses);
-            std::vector<int> intersect_indices;
-            std::vector<float> predictions;
-            object_model_->Render(camera_matrix_,
-                                  n_rows_,
-                                  n_cols_,
-                                  intersect_indices,
-                                  predictions);
-
-            // compute likelihoods ---------------------------------------------
-            for (size_t i = 0; i < size_t(predictions.size()); i++)
-            {
-                if (std::isnan(observations_[intersect_indices[i]]))
-                {
-                    log_likes[i_state] += log(1.);
-                }
-                else
-                {
-                    double delta_time = observation_time_ -
-                                        occlusion_times_[indices[i_state]]
-                                                        [intersect_indices[i]];
-
-                    occlusion_transition_->Condition(
-                        delta_time,
-                        occlusions_[indices[i_state]][intersect_indices[i]]);
-
-                    float occlusion =
-                        occlusion_transition_->MapStandardGaussian();
-
-                    sensor_->Condition(predictions[i], false);
-                    float p_obsIpred_vis =
-                        sensor_->Probability(
-                            observations_[intersect_indices[i]]) *
-                        (1.0 - occlusion);
-
-                    sensor_->Condition(predictions[i], true);
-                    float p_obsIpred_occl =
-                        sensor_->Probability(
-                            observations_[intersect_indices[i]]) *
-                        occlusion;
-
-                    sensor_->Condition(std::numeric_limits<float>::infinity(),
-                                       true);
-                    float p_obsIinf = sensor_->Probability(
-                        observations_[intersect_indices[i]]);
-
-                    log_likes[i_state] +=
-                        log((p_obsIpred_vis + p_obsIpred_occl) / p_obsIinf);
-
-                    // we update the occlusion with the observations
-                    if (update)
-                    {
-                        new_occlusions[i_state][intersect_indices[i]] =
-                            p_obsIpred_occl /
-                            (p_obsIpred_vis + p_obsIpred_occl);
-                        new_occlusion_times[i_state][intersect_indices[i]] =
-                            observation_time_;
-                    }
-                }
-            }
-        }
+        // resampling turns into a remapping of the occlusion rows. After it
+        // particle i owns row i exclusively and may update it in place. The
+        // rows only cover the region of interest around all particles.
         if (update)
         {
-            occlusions_ = new_occlusions;
-            occlusion_times_ = new_occlusion_times;
+            occlusions_.remap(indices.data(),
+                              deltas.size(),
+                              region_of_interest_.update(footprint(deltas)),
+                              thread_pool_.get());
             for (size_t i_state = 0; i_state < indices.size(); i_state++)
                 indices[i_state] = i_state;
         }
-        return log_likes;
+
+        // every particle is scored by exactly one worker which only writes
+        // the entries of that particle
+        thread_pool_->parallel_for(
+            deltas.size(),
+            [&](int begin, int end, int worker_index) {
+                Worker& worker = workers_[worker_index];
+                dbot::ProfileStopwatch stopwatch;
+                stopwatch.restart();
+
+                // the particles of the range are rendered in one batch
+                worker.batch_poses.resize(end - begin);
+                for (int i_state = begin; i_state < end; i_state++)
+                {
+                    compose(deltas[i_state],
+                            worker.batch_poses[i_state - begin]);
+                }
+                object_model_->RenderSparse(worker.batch_poses,
+                                            camera_matrix_,
+                                            n_rows_,
+                                            n_cols_,
+                                            worker.renderings);
+                stopwatch.lap(dbot::ProfileStage::Render);
+
+                for (int i_state = begin; i_state < end; i_state++)
+                {
+                    log_likes[i_state] = loglike(
+                        worker, i_state - begin, indices[i_state], update);
+                }
+                stopwatch.lap(dbot::ProfileStage::Weigh);
+            });
+
+        account_memory();
     }
 
+    /**
+     * \brief Sets the number of threads used by loglikes(). All threads share
+     *        the models, each one only owns its scratch memory.
+     *
+     * \param cpus  CPUs the threads are placed on, see ThreadPool
+     */
+    void set_thread_count(int thread_count,
+                          const ThreadPool::CpuSet& cpus = ThreadPool::CpuSet())
+    {
+        thread_pool_ = std::make_shared<ThreadPool>(thread_count, cpus);
+        workers_.resize(thread_pool_->thread_count());
+    }
+
+    int thread_count() const { return thread_pool_->thread_count(); }
+
     void set_observation(const Observation& image)
     {
         assert(image.rows() == image.size());
         assert(image.cols() == 1);
 
-        std::vector<float> std_measurement(image.size());
-
+        observations_.resize(image.size());
         for (int i = 0; i < image.size(); ++i)
         {
-            std_measurement[i] = image(i, 0);
+            observations_[i] = image(i, 0);
         }
+        mark_valid_observations();
+        advance_observation();
+    }
 
-        set_observation(std_measurement, this->delta_time_);
+    void set_observation(const DepthImageView& image)
+    {
+        observations_.assign(image.data(), image.data() + image.size());
+        mark_valid_observations();
+        advance_observation();
+    }
+
+    void set_observation(const DepthImageView& image,
+                         const std::vector<int>& valid_pixels)
+    {
+        observations_.assign(image.data(), image.data() + image.size());
+        valid_observations_.assign(observations_.size(), 0);
+        for (int pixel : valid_pixels) valid_observations_[pixel] = 1;
+        advance_observation();
+    }
+
+    /**
+     * \brief Sets a uint16 or RVL coded frame. Returns false and keeps
+     *        the observation if the frame does not have the resolution of
+     *        the sensor or cannot be decoded.
+     */
+    bool set_observation(const EncodedDepthFrame& frame)
+    {
+        if (frame.pixels != n_rows_ * n_cols_) return false;
+
+        // decoded aside, a code which ends early leaves the observation
+        decoded_observations_.resize(frame.pixels);
+        if (!DepthDecoding::decode(frame, decoded_observations_.data()))
+        {
+            return false;
+        }
+        observations_.swap(decoded_observations_);
+        mark_valid_observations();
+        advance_observation();
+        return true;
     }
 
     virtual void reset()
     {
-        occlusions_.resize(1);
-        occlusions_[0] =
-            std::vector<float>(n_rows_ * n_cols_, initial_occlusion_);
-        occlusion_times_.resize(1);
-        occlusion_times_[0] = std::vector<double>(n_rows_ * n_cols_, 0);
+        occlusions_.reset();
+        region_of_interest_.reset();
         observation_time_ = 0;
     }
 
+    bool save_occlusions(const IntArray& indices, OcclusionSnapshot& snapshot)
+    {
+        snapshot.region = occlusions_.region();
+        snapshot.particle_count = indices.size();
+        snapshot.observation_time = observation_time_;
+        snapshot.occlusion_time = 0;
+        snapshot.outside_occlusion = initial_occlusion_;
+        snapshot.occlusions.clear();
+        occlusions_.save(indices.data(),
+                         indices.size(),
+                         snapshot.occlusions,
+                         update_frames_);
+
+        snapshot.times.resize(update_frames_.size());
+        for (size_t i = 0; i < update_frames_.size(); i++)
+        {
+            snapshot.times[i] =
+                observation_time_ -
+                occlusions_.age(update_frames_[i]) * this->delta_time_;
+        }
+        return true;
+    }
+
+    bool load_occlusions(const OcclusionSnapshot& snapshot)
+    {
+        const ImageRegion& region = snapshot.region;
+        const size_t size = size_t(snapshot.particle_count) * region.area();
+        if (!ImageRegion::full(n_rows_, n_cols_).contains(region) ||
+            snapshot.occlusions.size() != size ||
+            (!snapshot.times.empty() && snapshot.times.size() != size))
+        {
+            return false;
+        }
+
+        // the update frames count back from the frame of the observation
+        // time, a sensor without per pixel times updated all pixels at once
+        const int frame = std::min(
+            frames(snapshot.observation_time),
+            int(std::numeric_limits<OcclusionArena::Frame>::max()));
+        update_frames_.resize(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            const double time = snapshot.times.empty()
+                                    ? snapshot.occlusion_time
+                                    : snapshot.times[i];
+            const int age = frames(snapshot.observation_time - time);
+            update_frames_[i] = OcclusionArena::Frame(std::max(frame - age, 0));
+        }
+
+        occlusions_.load(region,
+                         snapshot.particle_count,
+                         snapshot.occlusions.data(),
+                         update_frames_.data(),
+                         frame);
+        region_of_interest_.set(region);
+        observation_time_ = snapshot.observation_time;
+        return true;
+    }
+
     // TODO: TYPES
     const std::vector<float> Occlusions(size_t index) const
     {
-        return occlusions_[index];
+        std::vector<float> occlusions(occlusions_.pixel_count());
+        for (size_t i = 0; i < occlusions.size(); i++)
+        {
+            occlusions[i] = occlusions_.occlusion(index, i);
+        }
+        return occlusions;
+    }
+
+    /**
+     * \brief Region of the image for which occlusions are stored
+     */
+    const ImageRegion& occlusion_region() const
+    {
+        return occlusions_.region();
     }
 
 private:
-    void set_observation(const std::vector<float>& observations,
-                         const Scalar& delta_time)
+    /**
+     * \brief Scratch memory owned by a single worker thread
+     */
+    struct Worker
+    {
+        std::vector<Affine> poses;
+        ImageRegion footprint;
+
+        // sparse renderings of the particles scored in one batch
+        std::vector<std::vector<Affine>> batch_poses;
+        dbot::SparseDepthImages renderings;
+
+        // visible pixels with a valid observation and their offsets within
+        // the occlusion rows
+        std::vector<int> pixel_offsets;
+        std::vector<float> valid_predictions;
+        std::vector<float> valid_observations;
+        std::vector<double> occlusion_ages;
+        std::vector<float> prior_occlusions;
+        std::vector<float> posterior_occlusions;
+        std::vector<float> terms;
+    };
+
+    /** \brief Number of frames closest to the given time span */
+    int frames(double time) const
+    {
+        if (!(this->delta_time_ > 0)) return 0;
+        return std::max(int(std::lround(time / this->delta_time_)), 0);
+    }
+
+    /**
+     * \brief Poses of all parts for the given deviation from the default
+     *        poses
+     */
+    void compose(const State& delta_state, std::vector<Affine>& poses) const
+    {
+        // known at compile time for fixed size states
+        const int body_count = State::BODY_COUNT == Eigen::Dynamic
+                                   ? delta_state.count()
+                                   : int(State::BODY_COUNT);
+        poses.resize(body_count);
+        for (int i_obj = 0; i_obj < body_count; i_obj++)
+        {
+            composition_.compose(delta_state, i_obj, poses[i_obj].data());
+        }
+    }
+
+    /**
+     * \brief Updates the accounted memory of the observation and of the
+     *        renderings the workers keep
+     */
+    void account_memory()
     {
-        observations_ = observations;
-        observation_time_ += delta_time;
+        size_t render_cache = 0;
+        for (const Worker& worker : workers_)
+        {
+            render_cache +=
+                worker.renderings.offsets.capacity() * sizeof(int) +
+                worker.renderings.indices.capacity() * sizeof(int) +
+                worker.renderings.depths.capacity() * sizeof(float);
+        }
+        render_cache_account_.set(render_cache);
+        observations_account_.set(
+            (observations_.capacity() + decoded_observations_.capacity()) *
+                sizeof(float) +
+            valid_observations_.capacity());
+    }
+
+    /**
+     * \brief Marks the observed pixels which are not NaN, once per frame
+     */
+    void mark_valid_observations()
+    {
+        valid_observations_.resize(observations_.size());
+        for (size_t i = 0; i < observations_.size(); i++)
+        {
+            valid_observations_[i] = !std::isnan(observations_[i]);
+        }
+    }
+
+    /**
+     * \brief Moves the occlusions on to a newly set observation
+     */
+    void advance_observation()
+    {
+        observation_time_ += this->delta_time_;
+        occlusions_.advance_frame();
+    }
+
+    /**
+     * \brief Conservative image region covered by any of the particles
+     */
+    ImageRegion footprint(const StateArray& deltas)
+    {
+        for (size_t i = 0; i < workers_.size(); i++)
+        {
+            workers_[i].footprint = ImageRegion();
+        }
+
+        thread_pool_->parallel_for(
+            deltas.size(), [&](int begin, int end, int worker_index) {
+                Worker& worker = workers_[worker_index];
+                for (int i_state = begin; i_state < end; i_state++)
+                {
+                    compose(deltas[i_state], worker.poses);
+                    for (size_t i = 0; i < worker.poses.size(); i++)
+                    {
+                        worker.footprint = worker.footprint.unite(
+                            projected_region(box_corners_[i],
+                                             worker.poses[i].rotation(),
+                                             worker.poses[i].translation(),
+                                             camera_matrix_,
+                                             n_rows_,
+                                             n_cols_));
+                    }
+                }
+            });
+
+        ImageRegion region;
+        for (size_t i = 0; i < workers_.size(); i++)
+        {
+            region = region.unite(workers_[i].footprint);
+        }
+        return region;
+    }
+
+    /**
+     * \brief Log-likelihood of the particle rendered in the given sparse
+     *        rendering of the worker. If update is set, the occlusion row
+     *        of the particle is updated in place.
+     */
+    double loglike(Worker& worker,
+                   const int& rendering,
+                   const int& index,
+                   const bool& update)
+    {
+        const float* occlusions = occlusions_.occlusions(index);
+        const OcclusionArena::Frame* update_frames =
+            occlusions_.update_frames(index);
+
+        const int* intersect_indices =
+            worker.renderings.indices.data() +
+            worker.renderings.begin(rendering);
+        const float* predictions = worker.renderings.depths.data() +
+                                   worker.renderings.begin(rendering);
+
+        // gather the pixels with valid observations ---------------------------
+        const size_t max_count = worker.renderings.count(rendering);
+        worker.pixel_offsets.resize(max_count);
+        worker.valid_predictions.resize(max_count);
+        worker.valid_observations.resize(max_count);
+        worker.occlusion_ages.resize(max_count);
+        worker.prior_occlusions.resize(max_count);
+        worker.posterior_occlusions.resize(max_count);
+        worker.terms.resize(max_count);
+
+        // every pixel is written to the next slot, which only advances for
+        // valid observations, such that the gather does not branch on them
+        int count = 0;
+        for (size_t i = 0; i < max_count; i++)
+        {
+            const int pixel = intersect_indices[i];
+
+            // pixels outside of the region have never been updated
+            const int offset = occlusions_.offset(pixel);
+            double age = observation_time_;
+            float occlusion = initial_occlusion_;
+            if (offset >= 0)
+            {
+                age = occlusions_.age(update_frames[offset]) *
+                      this->delta_time_;
+                occlusion = occlusions[offset];
+            }
+
+            worker.pixel_offsets[count] = offset;
+            worker.valid_predictions[count] = predictions[i];
+            worker.valid_observations[count] = observations_[pixel];
+            worker.occlusion_ages[count] = age;
+            worker.prior_occlusions[count] = occlusion;
+            count += valid_observations_[pixel];
+        }
+
+        // propagate the occlusions to the observation time
+        occlusion_transition_->BatchPropagate(count,
+                                              worker.occlusion_ages.data(),
+                                              worker.prior_occlusions.data(),
+                                              worker.prior_occlusions.data());
+
+        // compute likelihoods -------------------------------------------------
+        double log_like =
+            sensor_->BatchLogLikelihoodRatio(count,
+                                             worker.valid_predictions.data(),
+                                             worker.valid_observations.data(),
+                                             worker.prior_occlusions.data(),
+                                             worker.posterior_occlusions.data(),
+                                             worker.terms.data());
+
+        // we update the occlusion with the observations
+        if (update)
+        {
+            float* new_occlusions = occlusions_.mutable_occlusions(index);
+            OcclusionArena::Frame* new_update_frames =
+                occlusions_.mutable_update_frames(index);
+            for (int i = 0; i < count; i++)
+            {
+                const int offset = worker.pixel_offsets[i];
+                if (offset < 0) continue;
+
+                new_occlusions[offset] = worker.posterior_occlusions[i];
+                new_update_frames[offset] = occlusions_.frame();
+            }
+        }
+
+        return log_like;
     }
 
     // TODO: WE PROBABLY DONT NEED ALL OF THIS
@@ -275,12 +599,29 @@ private:
     PixelSensorPtr sensor_;
     OcclusionModelPtr occlusion_transition_;
 
+    // threading
+    std::shared_ptr<ThreadPool> thread_pool_;
+    std::vector<Worker> workers_;
+
     // occlusion parameters
-    std::vector<std::vector<float>> occlusions_;
-    std::vector<std::vector<double>> occlusion_times_;
+    OcclusionArena occlusions_;
+    RegionOfInterest region_of_interest_;
+    std::vector<std::vector<Eigen::Vector3d>> box_corners_;
 
-    // observed data
+    // default poses of the current loglikes() call as matrices
+    PoseComposition composition_;
+
+    // conversion buffer of the snapshots
+    std::vector<OcclusionArena::Frame> update_frames_;
+
+    // observed data and whether each pixel is not NaN
     std::vector<float> observations_;
+    std::vector<std::uint8_t> valid_observations_;
+    std::vector<float> decoded_observations_;
     double observation_time_;
+
+    // host memory in MemoryUsage
+    MemoryAccount observations_account_;
+    MemoryAccount render_cache_account_;
 };
 }
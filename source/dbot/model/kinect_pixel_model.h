@@ -29,6 +29,7 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
 #include <dbot/traits.h>
 #include <iostream>
@@ -74,34 +75,53 @@ public:
           tail_weight_(tail_weight),
           model_sigma_(model_sigma),
           sigma_factor_(sigma_factor),
-          max_depth_(max_depth)
+          max_depth_(max_depth),
+          f_lambda_(lambda_),
+          f_model_sigma_(model_sigma),
+          f_sigma_factor_(sigma_factor),
+          f_tail_weight_div_max_depth_(tail_weight / max_depth),
+          f_one_minus_tail_weight_(1 - tail_weight),
+          f_one_div_sqrt_of_two_(1. / std::sqrt(2.)),
+          f_one_div_sqrt_of_two_pi_(1. / std::sqrt(2 * M_PI))
     {
     }
 
     virtual ~KinectPixelModel() noexcept {}
     virtual Scalar Probability(const Observation& observation) const
+    {
+        return Probability(observation, prediction_, occlusion_);
+    }
+
+    /**
+     * \brief Probability of the observation given the predicted depth and
+     *        whether the pixel is occluded. Does not depend on Condition(),
+     *        hence one instance may be shared among threads.
+     */
+    Scalar Probability(const Observation& observation,
+                       const Scalar& prediction,
+                       const bool& occlusion) const
     {
         // todo: if the prediction is infinite, the prob should not depend on
         // visibility. it does not matter
         // for the algorithm right now, but it should be changed
         Scalar probability;
         Scalar sigma = model_sigma_ + sigma_factor_ * observation * observation;
-        if (!occlusion_)
+        if (!occlusion)
         {
-            if (std::isinf(prediction_))  // if the prediction_ is infinite we return
-                                     // the limit
+            if (std::isinf(prediction))  // if the prediction is infinite we
+                                         // return the limit
                 probability = tail_weight_ / max_depth_;
             else
                 probability = tail_weight_ / max_depth_ +
                               (1 - tail_weight_) *
-                                  std::exp(-(pow(prediction_ - observation, 2) /
+                                  std::exp(-(pow(prediction - observation, 2) /
                                              (2 * sigma * sigma))) /
                                   (sqrt(2 * M_PI) * sigma);
         }
         else
         {
-            if (std::isinf(prediction_))  // if the prediction_ is infinite we return
-                                     // the limit
+            if (std::isinf(prediction))  // if the prediction is infinite we
+                                         // return the limit
             {
                 probability =
                     tail_weight_ / max_depth_ +
@@ -114,12 +134,12 @@ public:
                 probability = tail_weight_ / max_depth_ +
                               (1 - tail_weight_) * lambda_ *
                                   std::exp(0.5 * lambda_ *
-                                           (2 * prediction_ - 2 * observation +
+                                           (2 * prediction - 2 * observation +
                                             lambda_ * sigma * sigma)) *
-                                  (1 + erf((prediction_ - observation +
+                                  (1 + erf((prediction - observation +
                                             lambda_ * sigma * sigma) /
                                            (sqrt(2) * sigma))) /
-                                  (2 * (std::exp(prediction_ * lambda_) - 1));
+                                  (2 * (std::exp(prediction * lambda_) - 1));
             }
         }
 
@@ -131,15 +151,129 @@ public:
         return std::log(Probability(observation));
     }
 
+    Scalar LogProbability(const Observation& observation,
+                          const Scalar& prediction,
+                          const bool& occlusion) const
+    {
+        return std::log(Probability(observation, prediction, occlusion));
+    }
+
     virtual void Condition(const Scalar& prediction, const bool& occlusion)
     {
         prediction_ = prediction;
         occlusion_ = occlusion;
     }
 
+    /**
+     * \brief Scores count pixels at once in single precision, using the same
+     *        fused form of the model as the CUDA implementation.
+     *
+     * All predictions must be finite and all observations valid. The pixel
+     * terms are evaluated as Eigen array expressions over blocks of pixels,
+     * whose exp and log use the packet math of Eigen, and summed up
+     * afterwards, see kinect_pixel_model_benchmark. Eigen 3.2 has no array
+     * erf, it is taken per element from std::erf. This function is const
+     * and does not depend on Condition(), hence one instance may be shared
+     * among threads.
+     *
+     * \param predictions             Rendered depths
+     * \param observations            Observed depths
+     * \param occlusions              Prior occlusion probabilities
+     * \param posterior_occlusions    Receives the occlusion probabilities
+     *                                conditioned on the observations
+     * \param terms                   Scratch memory of count floats
+     *
+     * \return Sum over all pixels of
+     *         log(p(obs | prediction) / p(obs | infinite prediction))
+     */
+    double BatchLogLikelihoodRatio(const int count,
+                                   const float* predictions,
+                                   const float* observations,
+                                   const float* occlusions,
+                                   float* posterior_occlusions,
+                                   float* terms) const
+    {
+        // the temporaries of a block live on the stack
+        typedef Eigen::Array<float, Eigen::Dynamic, 1, 0, batch_block, 1>
+            Block;
+        typedef Eigen::Map<const Eigen::ArrayXf> Input;
+        typedef Eigen::Map<Eigen::ArrayXf> Output;
+
+        const float lambda = f_lambda_;
+        const float tail = f_tail_weight_div_max_depth_;
+        const float body = f_one_minus_tail_weight_;
+
+        for (int begin = 0; begin < count; begin += batch_block)
+        {
+            const int size = std::min(int(batch_block), count - begin);
+            const Input observation(observations + begin, size);
+            const Input prediction(predictions + begin, size);
+            const Input occlusion(occlusions + begin, size);
+
+            const Block sigma =
+                f_model_sigma_ + f_sigma_factor_ * observation.square();
+            const Block sigma_sq = sigma.square();
+            const Block pred_minus_obs = prediction - observation;
+
+            const Block p_visible =
+                tail + body * f_one_div_sqrt_of_two_pi_ *
+                           (-pred_minus_obs.square() / (2 * sigma_sq)).exp() /
+                           sigma;
+
+            const Block p_occluded =
+                tail +
+                body * lambda *
+                    (0.5f * lambda * (2 * pred_minus_obs + lambda * sigma_sq))
+                        .exp() *
+                    (1 + ((pred_minus_obs + lambda * sigma_sq) *
+                          f_one_div_sqrt_of_two_ / sigma)
+                             .unaryExpr(Erf())) /
+                    (2 * ((prediction * lambda).exp() - 1));
+
+            const Block p_infinite =
+                tail +
+                body * lambda *
+                    (0.5f * lambda * (-2 * observation + lambda * sigma_sq))
+                        .exp();
+
+            const Block p_obsIpred_occl = p_occluded * occlusion;
+            const Block p_obsIpred =
+                p_visible * (1 - occlusion) + p_obsIpred_occl;
+
+            Output(terms + begin, size) = (p_obsIpred / p_infinite).log();
+            Output(posterior_occlusions + begin, size) =
+                p_obsIpred_occl / p_obsIpred;
+        }
+
+        double sum = 0;
+        for (int i = 0; i < count; i++)
+        {
+            sum += terms[i];
+        }
+        return sum;
+    }
+
 private:
+    /** std::erf as an Eigen functor */
+    struct Erf
+    {
+        typedef float result_type;
+        float operator()(float x) const { return std::erf(x); }
+    };
+
+    /** pixels of a block of BatchLogLikelihoodRatio() */
+    enum
+    {
+        batch_block = 64
+    };
+
     const Scalar lambda_, tail_weight_, model_sigma_, sigma_factor_, max_depth_;
 
+    // single precision parameters of the batch evaluation
+    const float f_lambda_, f_model_sigma_, f_sigma_factor_;
+    const float f_tail_weight_div_max_depth_, f_one_minus_tail_weight_;
+    const float f_one_div_sqrt_of_two_, f_one_div_sqrt_of_two_pi_;
+
     Scalar prediction_;
     bool occlusion_;
 };
@@ -0,0 +1,88 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file kinect_pixel_model_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <dbot/model/kinect_pixel_model.h>
+
+TEST(KinectPixelModelTests, batch_matches_per_pixel_evaluation)
+{
+    dbot::KinectPixelModel model;
+
+    std::vector<float> predictions;
+    std::vector<float> observations;
+    std::vector<float> occlusions;
+    // more than one block of the batch evaluation
+    for (int i = 0; i < 150; ++i)
+    {
+        predictions.push_back(0.5 + 0.01 * i);
+        observations.push_back(0.5 + 0.01 * i + 0.004 * ((i % 7) - 3));
+        occlusions.push_back(0.0066 * i);
+    }
+
+    const int count = predictions.size();
+    std::vector<float> posteriors(count);
+    std::vector<float> terms(count);
+    double batch_sum = model.BatchLogLikelihoodRatio(count,
+                                                     predictions.data(),
+                                                     observations.data(),
+                                                     occlusions.data(),
+                                                     posteriors.data(),
+                                                     terms.data());
+
+    double sum = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        model.Condition(predictions[i], false);
+        double p_vis = model.Probability(observations[i]) * (1 - occlusions[i]);
+        model.Condition(predictions[i], true);
+        double p_occl = model.Probability(observations[i]) * occlusions[i];
+        model.Condition(std::numeric_limits<float>::infinity(), true);
+        double p_inf = model.Probability(observations[i]);
+
+        double term = std::log((p_vis + p_occl) / p_inf);
+        EXPECT_NEAR(terms[i], term, 1e-3 * std::max(1., std::fabs(term)));
+        EXPECT_NEAR(posteriors[i], p_occl / (p_vis + p_occl), 1e-4);
+        sum += term;
+    }
+
+    EXPECT_NEAR(batch_sum, sum, 1e-3 * std::fabs(sum));
+}
+
+TEST(KinectPixelModelTests, stateless_probability_matches_conditioned_one)
+{
+    const dbot::KinectPixelModel shared;
+    dbot::KinectPixelModel conditioned;
+
+    const double infinity = std::numeric_limits<double>::infinity();
+    for (double prediction : {0.8, 1.2, infinity})
+    {
+        for (bool occlusion : {false, true})
+        {
+            conditioned.Condition(prediction, occlusion);
+            EXPECT_DOUBLE_EQ(shared.Probability(1.0, prediction, occlusion),
+                             conditioned.Probability(1.0));
+            EXPECT_DOUBLE_EQ(
+                shared.LogProbability(1.0, prediction, occlusion),
+                conditioned.LogProbability(1.0));
+        }
+    }
+}
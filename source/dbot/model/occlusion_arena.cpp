@@ -0,0 +1,278 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_arena.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <dbot/model/occlusion_arena.h>
+
+namespace dbot
+{
+const int OcclusionArena::FRAME_SHIFT;
+
+OcclusionArena::OcclusionArena(int n_rows,
+                               int n_cols,
+                               float initial_occlusion)
+    : n_rows_(n_rows),
+      n_cols_(n_cols),
+      initial_occlusion_(initial_occlusion),
+      frame_(0),
+      row_count_(0),
+      account_(MemoryComponent::HostOcclusions)
+{
+    reset();
+}
+
+void OcclusionArena::reset()
+{
+    region_ = ImageRegion();
+    frame_ = 0;
+    row_count_ = 1;
+    occlusions_.clear();
+    frames_.clear();
+
+    rows_.assign(1, 0);
+    account_memory();
+}
+
+void OcclusionArena::advance_frame()
+{
+    if (frame_ == std::numeric_limits<Frame>::max())
+    {
+        for (size_t i = 0; i < frames_.size(); i++)
+        {
+            frames_[i] =
+                frames_[i] > FRAME_SHIFT ? frames_[i] - FRAME_SHIFT : 0;
+        }
+        frame_ -= FRAME_SHIFT;
+    }
+    frame_++;
+}
+
+void OcclusionArena::remap(const int* parents,
+                           int count,
+                           const ImageRegion& region,
+                           ThreadPool* thread_pool)
+{
+    if (region != region_)
+    {
+        relayout(parents, count, region, thread_pool);
+    }
+    else
+    {
+        remap(parents, count, thread_pool);
+    }
+}
+
+void OcclusionArena::remap(const int* parents,
+                           int count,
+                           ThreadPool* thread_pool)
+{
+    // count the children of every physical row ---------------------------
+    references_.assign(row_count_, 0);
+    for (int i = 0; i < count; i++)
+    {
+        references_[rows_[parents[i]]]++;
+    }
+
+    free_rows_.clear();
+    for (int row = row_count_ - 1; row >= 0; row--)
+    {
+        if (references_[row] == 0) free_rows_.push_back(row);
+    }
+
+    // the first child takes over the row, the others get a copy ----------
+    next_rows_.resize(count);
+    copy_sources_.clear();
+    copy_targets_.clear();
+    for (int i = 0; i < count; i++)
+    {
+        int row = rows_[parents[i]];
+
+        if (references_[row] > 0)
+        {
+            // mark the row as taken
+            references_[row] = -references_[row];
+            next_rows_[i] = row;
+        }
+        else
+        {
+            int target = allocate_row();
+            copy_sources_.push_back(row);
+            copy_targets_.push_back(target);
+            next_rows_[i] = target;
+        }
+    }
+
+    // copy the shared rows ------------------------------------------------
+    if (thread_pool)
+    {
+        thread_pool->parallel_for(
+            copy_sources_.size(), [&](int begin, int end, int /*worker*/) {
+                for (int i = begin; i < end; i++)
+                {
+                    copy_row(copy_sources_[i], copy_targets_[i]);
+                }
+            });
+    }
+    else
+    {
+        for (size_t i = 0; i < copy_sources_.size(); i++)
+        {
+            copy_row(copy_sources_[i], copy_targets_[i]);
+        }
+    }
+
+    rows_.swap(next_rows_);
+}
+
+void OcclusionArena::save(const int* particles,
+                          int count,
+                          std::vector<float>& occlusions,
+                          std::vector<Frame>& update_frames) const
+{
+    const size_t area = region_.area();
+    occlusions.reserve(occlusions.size() + size_t(count) * area);
+    update_frames.reserve(update_frames.size() + size_t(count) * area);
+    for (int i = 0; i < count; i++)
+    {
+        const float* row_occlusions = this->occlusions(particles[i]);
+        const Frame* row_frames = this->update_frames(particles[i]);
+        occlusions.insert(
+            occlusions.end(), row_occlusions, row_occlusions + area);
+        update_frames.insert(
+            update_frames.end(), row_frames, row_frames + area);
+    }
+}
+
+void OcclusionArena::load(const ImageRegion& region,
+                          int count,
+                          const float* occlusions,
+                          const Frame* update_frames,
+                          int frame)
+{
+    const size_t size = size_t(count) * region.area();
+    occlusions_.assign(occlusions, occlusions + size);
+    frames_.assign(update_frames, update_frames + size);
+
+    region_ = region;
+    frame_ = frame;
+    row_count_ = count;
+    rows_.resize(count);
+    for (int i = 0; i < count; i++) rows_[i] = i;
+    account_memory();
+}
+
+int OcclusionArena::allocate_row()
+{
+    if (!free_rows_.empty())
+    {
+        int row = free_rows_.back();
+        free_rows_.pop_back();
+        return row;
+    }
+
+    // grow the arena by one row, vector growth keeps this amortized
+    int row = row_count_++;
+    occlusions_.resize(size_t(row_count_) * region_.area());
+    frames_.resize(size_t(row_count_) * region_.area());
+    account_memory();
+    return row;
+}
+
+void OcclusionArena::account_memory()
+{
+    account_.set(
+        (occlusions_.capacity() + next_occlusions_.capacity()) *
+            sizeof(float) +
+        (frames_.capacity() + next_frames_.capacity()) * sizeof(Frame));
+}
+
+void OcclusionArena::copy_row(int source, int target)
+{
+    const size_t area = region_.area();
+    const size_t from = size_t(source) * area;
+    const size_t to = size_t(target) * area;
+
+    std::copy(occlusions_.begin() + from,
+              occlusions_.begin() + from + area,
+              occlusions_.begin() + to);
+    std::copy(frames_.begin() + from,
+              frames_.begin() + from + area,
+              frames_.begin() + to);
+}
+
+void OcclusionArena::relayout(const int* parents,
+                              int count,
+                              const ImageRegion& region,
+                              ThreadPool* thread_pool)
+{
+    // every particle gets a fresh row in the new layout, row i for particle i
+    const size_t area = region.area();
+    next_occlusions_.resize(size_t(count) * area);
+    next_frames_.resize(size_t(count) * area);
+
+    const ImageRegion old_region = region_;
+    auto copy = [&](int begin, int end, int /*worker*/) {
+        for (int i = begin; i < end; i++)
+        {
+            const size_t old_row =
+                size_t(rows_[parents[i]]) * old_region.area();
+            float* occlusions = next_occlusions_.data() + size_t(i) * area;
+            Frame* frames = next_frames_.data() + size_t(i) * area;
+
+            for (int row = 0; row < region.rows; row++)
+            {
+                for (int col = 0; col < region.cols; col++)
+                {
+                    int k = old_region.offset(row + region.row,
+                                              col + region.col);
+                    int target = row * region.cols + col;
+                    if (k < 0)
+                    {
+                        occlusions[target] = initial_occlusion_;
+                        frames[target] = 0;
+                    }
+                    else
+                    {
+                        occlusions[target] = occlusions_[old_row + k];
+                        frames[target] = frames_[old_row + k];
+                    }
+                }
+            }
+        }
+    };
+
+    if (thread_pool)
+    {
+        thread_pool->parallel_for(count, copy);
+    }
+    else
+    {
+        copy(0, count, 0);
+    }
+
+    occlusions_.swap(next_occlusions_);
+    frames_.swap(next_frames_);
+
+    region_ = region;
+    row_count_ = count;
+    rows_.resize(count);
+    for (int i = 0; i < count; i++) rows_[i] = i;
+    account_memory();
+}
+}
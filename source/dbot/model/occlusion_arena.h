@@ -0,0 +1,220 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_arena.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <dbot/image_region.h>
+#include <dbot/memory_planner.h>
+#include <dbot/thread_pool.h>
+
+namespace dbot
+{
+/**
+ * \brief Per particle pixel occlusion probabilities and their update times.
+ *
+ * All rows live in two contiguous structure-of-arrays buffers, one for the
+ * probabilities and one for the update frames. The update time of a pixel is
+ * kept as the 16 bit number of the frame in which it was last updated, see
+ * advance_frame(), which halves the memory next to the probabilities
+ * compared to double time stamps. Particles refer to physical rows
+ * through a row table such that resampling is an index remapping: a row
+ * which is inherited by a single particle is handed over without copying,
+ * only rows inherited by several particles are duplicated (copy-on-write).
+ * The row table is double buffered and swapped on remap(). The buffers
+ * keep their capacity, i.e. rows are recycled and never freed.
+ *
+ * A row only covers the region of interest of the arena. Pixels outside of
+ * it have never been seen by any particle and hence carry the initial
+ * occlusion probability and the update frame zero.
+ */
+class OcclusionArena
+{
+public:
+    typedef std::uint16_t Frame;
+
+    /**
+     * \brief Frames after which the update frames are shifted down, see
+     *        advance_frame(). Older updates all have the age of the shift,
+     *        by which time any occlusion has long reached its stationary
+     *        probability.
+     */
+    static const int FRAME_SHIFT = 1 << 15;
+
+public:
+    OcclusionArena(int n_rows, int n_cols, float initial_occlusion);
+
+    /**
+     * \brief Resets the arena to a single particle, an empty region of
+     *        interest and frame zero
+     */
+    void reset();
+
+    /**
+     * \brief Starts the next frame. Before the frame number overflows, the
+     *        frame number and all update frames are shifted down by
+     *        FRAME_SHIFT, clamped at zero.
+     */
+    void advance_frame();
+
+    /** \brief Number of the current frame */
+    int frame() const { return frame_; }
+
+    /** \brief Frames since the given update frame */
+    int age(Frame update_frame) const { return frame_ - update_frame; }
+
+    /**
+     * \brief Lets particle i of the new generation descend from particle
+     *        parents[i] of the current one and moves the rows to the given
+     *        region of interest.
+     *
+     * Pixels which leave the region are forgotten, pixels which enter it
+     * start with the initial occlusion probability. Copies are distributed
+     * on the given thread pool if there is one. Row pointers obtained before
+     * are invalidated.
+     */
+    void remap(const int* parents,
+               int count,
+               const ImageRegion& region,
+               ThreadPool* thread_pool = nullptr);
+
+    /**
+     * \brief Same as above, keeping the current region of interest
+     */
+    void remap(const int* parents,
+               int count,
+               ThreadPool* thread_pool = nullptr);
+
+    /**
+     * \brief Appends the rows of the given particles to occlusions and
+     *        update_frames, one row of region().area() values per particle
+     */
+    void save(const int* particles,
+              int count,
+              std::vector<float>& occlusions,
+              std::vector<Frame>& update_frames) const;
+
+    /**
+     * \brief Replaces all rows by count rows of the given region as written
+     *        by save(), particle i owns row i afterwards. The update frames
+     *        may not lie beyond frame.
+     */
+    void load(const ImageRegion& region,
+              int count,
+              const float* occlusions,
+              const Frame* update_frames,
+              int frame);
+
+    int pixel_count() const { return n_rows_ * n_cols_; }
+    int particle_count() const { return rows_.size(); }
+    int row_count() const { return row_count_; }
+    const ImageRegion& region() const { return region_; }
+    float initial_occlusion() const { return initial_occlusion_; }
+
+    /**
+     * \brief Offset of an image pixel within a row or -1 if it lies outside
+     *        of the region of interest
+     */
+    int offset(int pixel) const
+    {
+        return region_.offset(pixel / n_cols_, pixel % n_cols_);
+    }
+
+    const float* occlusions(int particle) const
+    {
+        return occlusions_.data() + size_t(rows_[particle]) * region_.area();
+    }
+
+    const Frame* update_frames(int particle) const
+    {
+        return frames_.data() + size_t(rows_[particle]) * region_.area();
+    }
+
+    /**
+     * \brief Write access to the row of the given particle. Particles never
+     *        share rows after remap(), hence this does not affect others.
+     */
+    float* mutable_occlusions(int particle)
+    {
+        return occlusions_.data() + size_t(rows_[particle]) * region_.area();
+    }
+
+    Frame* mutable_update_frames(int particle)
+    {
+        return frames_.data() + size_t(rows_[particle]) * region_.area();
+    }
+
+    /**
+     * \brief Occlusion probability of an image pixel of the given particle
+     */
+    float occlusion(int particle, int pixel) const
+    {
+        int k = offset(pixel);
+        return k < 0 ? initial_occlusion_ : occlusions(particle)[k];
+    }
+
+    /**
+     * \brief Last update frame of an image pixel of the given particle
+     */
+    Frame update_frame(int particle, int pixel) const
+    {
+        int k = offset(pixel);
+        return k < 0 ? 0 : update_frames(particle)[k];
+    }
+
+private:
+    int allocate_row();
+    void copy_row(int source, int target);
+    void relayout(const int* parents,
+                  int count,
+                  const ImageRegion& region,
+                  ThreadPool* thread_pool);
+
+    /** \brief Updates the accounted capacity of the rows */
+    void account_memory();
+
+private:
+    int n_rows_;
+    int n_cols_;
+    float initial_occlusion_;
+    ImageRegion region_;
+    int frame_;
+
+    // row major storage of all physical rows
+    int row_count_;
+    std::vector<float> occlusions_;
+    std::vector<Frame> frames_;
+
+    // target buffers of a region change, kept for their capacity
+    std::vector<float> next_occlusions_;
+    std::vector<Frame> next_frames_;
+
+    // particle -> physical row, double buffered
+    std::vector<int> rows_;
+    std::vector<int> next_rows_;
+
+    // remap scratch memory
+    std::vector<int> references_;
+    std::vector<int> free_rows_;
+    std::vector<int> copy_sources_;
+    std::vector<int> copy_targets_;
+
+    MemoryAccount account_;
+};
+}
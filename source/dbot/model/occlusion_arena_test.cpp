@@ -0,0 +1,181 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_arena_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/model/occlusion_arena.h>
+
+namespace
+{
+typedef std::vector<std::vector<float>> Rows;
+
+void write(dbot::OcclusionArena& arena, Rows& reference, int generation)
+{
+    for (int i = 0; i < arena.particle_count(); ++i)
+    {
+        int pixel = (i + generation) % arena.pixel_count();
+        float value = 0.01f * (generation * 31 + i);
+        arena.mutable_occlusions(i)[pixel] = value;
+        arena.mutable_update_frames(i)[pixel] = generation;
+        reference[i][pixel] = value;
+    }
+}
+
+void expect_equal(const dbot::OcclusionArena& arena, const Rows& reference)
+{
+    ASSERT_EQ(arena.particle_count(), int(reference.size()));
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        for (int k = 0; k < arena.pixel_count(); ++k)
+        {
+            EXPECT_EQ(arena.occlusion(i, k), reference[i][k]);
+        }
+    }
+}
+}
+
+TEST(OcclusionArenaTests, reset_sets_initial_occlusion)
+{
+    dbot::OcclusionArena arena(2, 5, 0.1f);
+
+    EXPECT_EQ(arena.particle_count(), 1);
+    EXPECT_TRUE(arena.region().empty());
+    for (int k = 0; k < arena.pixel_count(); ++k)
+    {
+        EXPECT_EQ(arena.occlusion(0, k), 0.1f);
+        EXPECT_EQ(arena.update_frame(0, k), 0);
+    }
+}
+
+TEST(OcclusionArenaTests, remap_matches_row_copies)
+{
+    const int pixel_count = 16;
+    dbot::OcclusionArena arena(4, 4, 0.1f);
+    const dbot::ImageRegion region = dbot::ImageRegion::full(4, 4);
+    Rows reference(1, std::vector<float>(pixel_count, 0.1f));
+
+    dbot::ThreadPool pool(2);
+
+    const int parent_sets[4][6] = {{0, 0, 0, 0, 0, 0},
+                                   {5, 4, 3, 2, 1, 0},
+                                   {1, 1, 2, 2, 2, 5},
+                                   {3, 3, 3, 3, 0, 0}};
+    for (int generation = 0; generation < 4; ++generation)
+    {
+        const int* parents = parent_sets[generation];
+
+        Rows next;
+        for (int i = 0; i < 6; ++i) next.push_back(reference[parents[i]]);
+        reference = next;
+
+        arena.remap(parents, 6, region, generation % 2 ? &pool : nullptr);
+        expect_equal(arena, reference);
+
+        write(arena, reference, generation);
+        expect_equal(arena, reference);
+    }
+
+    // rows are recycled, the arena never holds more rows than needed
+    EXPECT_LE(arena.row_count(), 6);
+}
+
+TEST(OcclusionArenaTests, region_change_keeps_overlap)
+{
+    dbot::OcclusionArena arena(4, 4, 0.1f);
+
+    const int parents[2] = {0, 0};
+    arena.remap(parents, 2, dbot::ImageRegion(0, 0, 2, 2));
+    EXPECT_EQ(arena.offset(5), 3);
+    EXPECT_EQ(arena.offset(2), -1);
+
+    // pixel (1, 1) of particle 1
+    arena.mutable_occlusions(1)[3] = 0.7f;
+    arena.mutable_update_frames(1)[3] = 2;
+
+    const int swapped[2] = {1, 0};
+    arena.remap(swapped, 2, dbot::ImageRegion(1, 1, 3, 3));
+    EXPECT_EQ(arena.region(), dbot::ImageRegion(1, 1, 3, 3));
+    EXPECT_EQ(arena.occlusion(0, 5), 0.7f);
+    EXPECT_EQ(arena.update_frame(0, 5), 2);
+    EXPECT_EQ(arena.occlusion(1, 5), 0.1f);
+
+    // pixels entering the region start from the initial occlusion
+    EXPECT_EQ(arena.occlusion(0, 15), 0.1f);
+    EXPECT_EQ(arena.update_frame(0, 15), 0);
+    EXPECT_EQ(arena.occlusion(0, 0), 0.1f);
+}
+
+TEST(OcclusionArenaTests, save_and_load_resolve_shared_rows)
+{
+    const int pixel_count = 16;
+    dbot::OcclusionArena arena(4, 4, 0.1f);
+    const dbot::ImageRegion region = dbot::ImageRegion::full(4, 4);
+    Rows reference(1, std::vector<float>(pixel_count, 0.1f));
+
+    const int parents[3] = {0, 0, 0};
+    arena.remap(parents, 3, region);
+    reference.assign(3, reference[0]);
+    write(arena, reference, 5);
+
+    // particles 0 and 1 descend from particle 1, one of them gets a copy
+    const int shared[3] = {1, 1, 2};
+    Rows next = {reference[1], reference[1], reference[2]};
+    arena.remap(shared, 3);
+    reference = next;
+
+    std::vector<float> occlusions;
+    std::vector<dbot::OcclusionArena::Frame> frames;
+    const int particles[3] = {2, 0, 1};
+    arena.save(particles, 3, occlusions, frames);
+    ASSERT_EQ(occlusions.size(), size_t(3 * region.area()));
+    ASSERT_EQ(frames.size(), occlusions.size());
+
+    dbot::OcclusionArena loaded(4, 4, 0.1f);
+    loaded.load(region, 3, occlusions.data(), frames.data(), 7);
+    EXPECT_EQ(loaded.frame(), 7);
+    EXPECT_EQ(loaded.region(), region);
+    EXPECT_EQ(loaded.row_count(), 3);
+    expect_equal(loaded, {reference[2], reference[0], reference[1]});
+    for (int k = 0; k < pixel_count; ++k)
+    {
+        EXPECT_EQ(loaded.update_frame(1, k), arena.update_frame(0, k));
+    }
+}
+
+TEST(OcclusionArenaTests, frame_overflow_keeps_recent_ages)
+{
+    dbot::OcclusionArena arena(2, 2, 0.1f);
+    const int parents[1] = {0};
+    arena.remap(parents, 1, dbot::ImageRegion::full(2, 2));
+
+    for (int i = 0; i < 65530; ++i) arena.advance_frame();
+    arena.mutable_update_frames(0)[0] = arena.frame();
+    arena.mutable_update_frames(0)[1] = 10;
+
+    for (int i = 0; i < 20; ++i) arena.advance_frame();
+    EXPECT_LT(arena.frame(), 65535);
+    EXPECT_EQ(arena.age(arena.update_frame(0, 0)), 20);
+
+    // updates older than the shift saturate at its age
+    EXPECT_EQ(arena.age(arena.update_frame(0, 1)),
+              arena.frame() - arena.update_frame(0, 1));
+    EXPECT_GE(arena.age(arena.update_frame(0, 1)),
+              dbot::OcclusionArena::FRAME_SHIFT);
+    EXPECT_EQ(arena.update_frame(0, 1), 0);
+}
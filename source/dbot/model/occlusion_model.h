@@ -29,6 +29,10 @@
 
 #pragma once
 
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
 // TODO: THIS IS JUST A LINEAR GAUSSIAN PROCESS WITH NO NOISE, SHOULD DISAPPEAR
 namespace dbot
 {
@@ -41,6 +45,22 @@ namespace dbot
  */
 class OcclusionModel
 {
+public:
+    /**
+     * \brief Propagation of any occlusion probability p over a fixed time,
+     *        which is affine: scale * p + offset
+     */
+    struct Transition
+    {
+        float scale;
+        float offset;
+
+        float operator()(float occlusion) const
+        {
+            return scale * occlusion + offset;
+        }
+    };
+
 public:
     // the prob of source being object given source was object one sec ago,
     // and prob of source being object given one sec ago source was not object
@@ -63,17 +83,28 @@ public:
 
     virtual double MapStandardGaussian() const
     {
-        double pow_c_time = std::exp(delta_time_*log_c_);
+        return Propagate(delta_time_, occlusion_probability_);
+    }
+
+    /**
+     * \brief Occlusion probability delta_time after it was
+     *        occlusion_probability. Does not depend on Condition(), hence one
+     *        instance may be shared among threads.
+     */
+    double Propagate(const double& delta_time,
+                     const double& occlusion_probability) const
+    {
+        double pow_c_time = std::exp(delta_time*log_c_);
 
         double new_occlusion_probability =
-                1. - (pow_c_time*(1.-occlusion_probability_) +
+                1. - (pow_c_time*(1.-occlusion_probability) +
                     (1 - p_occluded_occluded_)*(pow_c_time-1.)/(c_-1.));
 
         if(new_occlusion_probability < 0.0 || new_occlusion_probability > 1.0)
         {
             if(std::fabs(c_ - 1.0) < 0.000000001)
             {
-                new_occlusion_probability = occlusion_probability_;
+                new_occlusion_probability = occlusion_probability;
             }
             else
             {
@@ -85,6 +116,74 @@ public:
         return new_occlusion_probability;
     }
 
+    /**
+     * \brief Coefficients of the propagation over delta_time. With
+     *        a = c^delta_time the probability becomes
+     *        a * p + p_occluded_visible * (1 - a) / (1 - c), which tends to
+     *        p + p_occluded_visible * delta_time for c = 1.
+     */
+    Transition transition(const double& delta_time) const
+    {
+        const double pow_c_time = std::exp(delta_time * log_c_);
+
+        Transition transition;
+        transition.scale = float(pow_c_time);
+        if (std::fabs(c_ - 1.0) < 0.000000001)
+        {
+            transition.offset = float(p_occluded_visible_ * delta_time);
+        }
+        else
+        {
+            transition.offset =
+                float(p_occluded_visible_ * (1. - pow_c_time) / (1. - c_));
+        }
+        return transition;
+    }
+
+    /**
+     * \brief Propagates count occlusion probabilities over the same time,
+     *        occlusions and propagated may be the same array
+     */
+    void BatchPropagate(const Transition& transition,
+                        const int count,
+                        const float* occlusions,
+                        float* propagated) const
+    {
+        const float scale = transition.scale;
+        const float offset = transition.offset;
+        for (int i = 0; i < count; i++)
+        {
+            propagated[i] = scale * occlusions[i] + offset;
+        }
+    }
+
+    /**
+     * \brief Propagates count occlusion probabilities by their delta times,
+     *        occlusions and propagated may be the same array. The delta
+     *        times are mostly equal, a transition is only computed when the
+     *        delta time changes.
+     */
+    void BatchPropagate(const int count,
+                        const double* delta_times,
+                        const float* occlusions,
+                        float* propagated) const
+    {
+        int begin = 0;
+        while (begin < count)
+        {
+            int end = begin + 1;
+            while (end < count && delta_times[end] == delta_times[begin])
+            {
+                end++;
+            }
+            BatchPropagate(transition(delta_times[begin]),
+                           end - begin,
+                           occlusions + begin,
+                           propagated + begin);
+            begin = end;
+        }
+    }
+
 private:
     // conditionals
     double occlusion_probability_, delta_time_;
@@ -0,0 +1,68 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_model_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/model/occlusion_model.h>
+
+TEST(OcclusionModelTests, transition_matches_the_propagation)
+{
+    const dbot::OcclusionModel model(0.1, 0.7);
+
+    for (double delta_time : {0.0, 0.033, 1.0, 5.0})
+    {
+        const dbot::OcclusionModel::Transition transition =
+            model.transition(delta_time);
+        for (float occlusion : {0.0f, 0.1f, 0.5f, 0.9f, 1.0f})
+        {
+            EXPECT_NEAR(transition(occlusion),
+                        model.Propagate(delta_time, occlusion),
+                        1e-6);
+        }
+    }
+}
+
+TEST(OcclusionModelTests, constant_process_keeps_the_occlusions)
+{
+    const dbot::OcclusionModel model(0.0, 1.0);
+
+    const dbot::OcclusionModel::Transition transition = model.transition(2.0);
+    EXPECT_FLOAT_EQ(transition(0.3f), 0.3f);
+    EXPECT_FLOAT_EQ(transition(1.0f), 1.0f);
+}
+
+TEST(OcclusionModelTests, batch_propagates_each_pixel_by_its_own_time)
+{
+    const dbot::OcclusionModel model(0.1, 0.7);
+
+    const std::vector<double> delta_times = {0.033, 0.033, 2.0, 0.033};
+    std::vector<float> occlusions = {0.1f, 0.2f, 0.3f, 0.4f};
+    const std::vector<float> priors = occlusions;
+    model.BatchPropagate(occlusions.size(),
+                         delta_times.data(),
+                         occlusions.data(),
+                         occlusions.data());
+
+    for (size_t i = 0; i < occlusions.size(); i++)
+    {
+        EXPECT_NEAR(occlusions[i],
+                    model.Propagate(delta_times[i], priors[i]),
+                    1e-6);
+    }
+}
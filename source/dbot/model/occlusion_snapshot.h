@@ -0,0 +1,62 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file occlusion_snapshot.h
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <dbot/image_region.h>
+
+namespace dbot
+{
+/**
+ * \brief Copy of the occlusion probabilities a sensor keeps for its
+ *        particles, see RbSensor::save_occlusions().
+ *
+ * Row i holds the probabilities of particle i within the region in row
+ * major order, independent of how the sensor shares rows between
+ * particles. Pixels outside of the region carry outside_occlusion. Sensors
+ * which keep an update time per pixel store it in times, the others leave
+ * times empty and state the time shared by all pixels in occlusion_time.
+ */
+struct OcclusionSnapshot
+{
+    OcclusionSnapshot()
+        : particle_count(0),
+          observation_time(0),
+          occlusion_time(0),
+          outside_occlusion(0)
+    {
+    }
+
+    bool empty() const { return particle_count == 0; }
+
+    ImageRegion region;
+    int particle_count;
+
+    /** time of the last observation the sensor received */
+    double observation_time;
+
+    /** last update of all pixels if there are no times per pixel */
+    double occlusion_time;
+    float outside_occlusion;
+
+    /** particle_count rows of region.area() values */
+    std::vector<float> occlusions;
+    std::vector<double> times;
+};
+}
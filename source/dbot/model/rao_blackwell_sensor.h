@@ -28,15 +28,51 @@
 
 #pragma once
 
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <vector>
+
 #include <Eigen/Core>
 
 #include <fl/util/types.hpp>
+#include <dbot/depth_decoding.h>
+#include <dbot/depth_image_view.h>
+#include <dbot/model/occlusion_snapshot.h>
 #include <dbot/pose/pose_vector.h>
 #include <dbot/pose/pose_velocity_vector.h>
 #include <dbot/pose/free_floating_rigid_bodies_state.h>
 
 namespace dbot
 {
+/**
+ * \brief Thrown by the particle weight functions of a sensor which does not
+ *        keep the particle weights, see RbSensor::has_device_weights()
+ */
+class NoDeviceWeightsException : public std::exception
+{
+    const char* what() const noexcept
+    {
+        return "The sensor does not keep the particle weights.";
+    }
+};
+
+/**
+ * \brief Poses the deltas of the states are applied to, of the same fixed
+ *        size as the states if these have one
+ */
+template <typename State>
+struct RbSensorPoses
+{
+    typedef dbot::FreeFloatingRigidBodiesState<> Type;
+};
+
+template <int BodyCount>
+struct RbSensorPoses<dbot::FreeFloatingRigidBodiesState<BodyCount>>
+{
+    typedef dbot::FreeFloatingRigidBodiesState<BodyCount> Type;
+};
+
 /// \todo this observation model is now specific to rigid body rendering,
 /// terminology should be adapted accordingly.
 template <typename State_>
@@ -53,7 +89,7 @@ public:
 //    typedef State PoseArray;
 
     /// \todo: this should be a different type, only containing poses
-    typedef dbot::FreeFloatingRigidBodiesState<> PoseArray;
+    typedef typename RbSensorPoses<State>::Type PoseArray;
 
 public:
     /// constructor and destructor *********************************************
@@ -64,6 +100,18 @@ public:
                                IntArray& indices,
                                const bool& update = false) = 0;
 
+    /**
+     * \brief Same as loglikes() but writes into log_likelihoods. Sensors
+     *        which override this reuse the memory of log_likelihoods.
+     */
+    virtual void compute_loglikes(const StateArray& deviations,
+                                  IntArray& indices,
+                                  const bool& update,
+                                  RealArray& log_likelihoods)
+    {
+        log_likelihoods = loglikes(deviations, indices, update);
+    }
+
     // compute the loglikelihoods without keeping track of the occulsions
     virtual RealArray loglikes(const StateArray& deviations)
     {
@@ -72,13 +120,143 @@ public:
         return loglikes(deviations, zero_indices, false);
     }
 
+    /// particle weights kept by the sensor ************************************
+    /**
+     * \brief Whether the sensor keeps the particle weights itself, e.g. on
+     *        the GPU. The filter then calls compute_device_weights() instead
+     *        of compute_loglikes() and never sees the log likelihoods. The
+     *        filter checks it before calling any of the functions below,
+     *        which throw a NoDeviceWeightsException by default.
+     */
+    virtual bool has_device_weights() const { return false; }
+
+    /**
+     * \brief Evaluates the deviations, adds the change of their log
+     *        likelihoods to the kept weights and normalizes them. The
+     *        occlusion indices are kept by the sensor as well.
+     *
+     * \return the KL divergence of the weights from the uniform distribution
+     */
+    virtual fl::Real compute_device_weights(const StateArray& deviations,
+                                            const bool update)
+    {
+        throw NoDeviceWeightsException();
+    }
+
+    /**
+     * \brief Systematic resampling of the kept weights with the given
+     *        uniform offset in [0, 1). Returns the parent of every particle.
+     */
+    virtual void resample_device_weights(const fl::Real offset,
+                                         IntArray& parents)
+    {
+        throw NoDeviceWeightsException();
+    }
+
+    /** \brief Returns the normalized log weights kept by the sensor */
+    virtual void device_log_weights(RealArray& log_weights)
+    {
+        throw NoDeviceWeightsException();
+    }
+
+    /**
+     * \brief Replaces the kept weights by the given normalized log weights,
+     *        e.g. those of a checkpoint. The occlusion indices are reset as
+     *        by a compute_device_weights() after reset().
+     */
+    virtual void set_device_log_weights(const RealArray& log_weights)
+    {
+        throw NoDeviceWeightsException();
+    }
+
+    /// checkpoints ************************************************************
+    /**
+     * \brief Copies the occlusions of the particles, particle i refers to
+     *        the occlusions at indices[i]. Sensors which keep the occlusion
+     *        indices themselves ignore indices. Returns false if the sensor
+     *        does not keep occlusions.
+     */
+    virtual bool save_occlusions(const IntArray& indices,
+                                 OcclusionSnapshot& snapshot)
+    {
+        return false;
+    }
+
+    /**
+     * \brief Restores the occlusions of save_occlusions(), particle i then
+     *        refers to the occlusions at index i. Returns false and keeps
+     *        the occlusions if the snapshot does not fit the sensor.
+     */
+    virtual bool load_occlusions(const OcclusionSnapshot& snapshot)
+    {
+        return false;
+    }
+
     /// accessors **************************************************************
     virtual void set_observation(const Observation& image) = 0;
+
+    /**
+     * \brief Sets the observation from a float depth image. Sensors which
+     *        work in single precision take the values without a double
+     *        precision copy, the default implementation converts the image.
+     */
+    virtual void set_observation(const DepthImageView& image)
+    {
+        set_observation(Observation(image.cast<fl::Real>()));
+    }
+
+    /**
+     * \brief Sets the observation from a float depth image with the
+     *        ascending indices of its pixels which are not NaN, such that
+     *        sensors need not test every pixel. The default implementation
+     *        ignores the list.
+     */
+    virtual void set_observation(const DepthImageView& image,
+                                 const std::vector<int>& valid_pixels)
+    {
+        set_observation(image);
+    }
+
+    /**
+     * \brief Sets the observation from a uint16 or RVL coded depth frame.
+     *        Sensors decode it straight into their own float buffer, the
+     *        default implementation decodes into a float image first.
+     *        Returns false and keeps the observation if the frame cannot
+     *        be decoded.
+     */
+    virtual bool set_observation(const EncodedDepthFrame& frame)
+    {
+        decoded_observation_.resize(frame.pixels);
+        if (!DepthDecoding::decode(frame, decoded_observation_.data()))
+        {
+            return false;
+        }
+        set_observation(DepthImageView(decoded_observation_.data(),
+                                       decoded_observation_.size()));
+        return true;
+    }
+
+    /**
+     * \brief Switches to observations of another resolution with the given
+     *        camera matrix, e.g. downsampled ones under load. Resets the
+     *        occlusions. Returns false and keeps the resolution if the
+     *        sensor cannot change it, as the default implementation does.
+     */
+    virtual bool set_resolution(int nr_rows,
+                                int nr_cols,
+                                const Eigen::Matrix3d& camera_matrix)
+    {
+        return false;
+    }
+
     virtual PoseArray& integrated_poses() { return default_poses_; }
     virtual void reset() = 0;
 
 protected:
     fl::Real delta_time_;
     PoseArray default_poses_;
+
+    /** float image of the default encoded set_observation() */
+    std::vector<float> decoded_observation_;
 };
 }
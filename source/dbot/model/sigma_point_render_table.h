@@ -0,0 +1,286 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file sigma_point_render_table.h
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/pose/pose_hashing.h>
+#include <dbot/rigid_body_renderer.h>
+
+namespace dbot
+{
+/**
+ * \brief Depth renderings of the sigma points of the filter updates, stored
+ *        pixel major in one contiguous float matrix.
+ *
+ * A point is rendered once, when it is first seen during the update, and
+ * is identified by its id from then on. The filter evaluates the pixel
+ * models for the same sequence of points at every pixel, hence a lookup
+ * first checks the point seen last and its successor and only hashes the
+ * point if neither matches.
+ *
+ * The renderings are kept across updates in a bounded least recently used
+ * cache keyed on the quantized rendered pose. Points which are rendered in
+ * the same pose, e.g. sigma points which only differ in the velocities, or
+ * the points of consecutive updates of a slowly moving object share one
+ * rendering. The renderings of the points of the current update are never
+ * evicted, the cache grows beyond its capacity if they do not fit.
+ *
+ * The table is not synchronized, the pixel models which share it have to
+ * guard it, as DepthPixelModel does with a mutex shared by its copies.
+ */
+template <typename State>
+class SigmaPointRenderTable
+{
+public:
+    /** \brief Rendered pose of all parts, the key of the cache */
+    typedef Eigen::VectorXd Pose;
+
+public:
+    /**
+     * \param capacity		renderings which are kept across updates
+     * \param pose_precision	poses which agree to this precision share a
+     *                      rendering
+     */
+    explicit SigmaPointRenderTable(int pixel_count,
+                                   int capacity = 64,
+                                   double pose_precision = 1e-6)
+        : pixel_count_(pixel_count),
+          capacity_(capacity),
+          last_id_(-1),
+          update_(0),
+          cached_(16,
+                  PoseHash<Pose>(pose_precision),
+                  PoseEqual<Pose>(pose_precision)),
+          hits_(0),
+          misses_(0)
+    {
+    }
+
+    /**
+     * \brief Forgets all points and renderings but keeps the memory
+     */
+    void clear()
+    {
+        next_update();
+        slots_.clear();
+        cached_.clear();
+    }
+
+    /**
+     * \brief Forgets the points of the last update, their renderings stay
+     *        in the cache
+     */
+    void next_update()
+    {
+        points_.clear();
+        columns_.clear();
+        ids_.clear();
+        last_id_ = -1;
+        update_++;
+    }
+
+    /** \brief Number of points of the current update */
+    int size() const { return int(points_.size()); }
+    int pixel_count() const { return pixel_count_; }
+    int capacity() const { return capacity_; }
+
+    /** \brief Number of renderings held, of this and former updates */
+    int rendering_count() const { return int(slots_.size()); }
+
+    /**
+     * \brief Id of the point or -1 if the point has not been rendered yet
+     */
+    int find(const State& point) const
+    {
+        if (last_id_ >= 0)
+        {
+            if (points_[last_id_] == point) return last_id_;
+
+            const int next = (last_id_ + 1) % size();
+            if (points_[next] == point) return last_id_ = next;
+        }
+
+        auto it = ids_.find(point);
+        if (it == ids_.end()) return -1;
+        return last_id_ = it->second;
+    }
+
+    /**
+     * \brief Adds the point and returns its id. render(rendering) has to
+     *        fill the first rendering of the given sparse depth images. The
+     *        rendering is not shared with other points.
+     */
+    template <typename Render>
+    int insert(const State& point, Render render)
+    {
+        misses_++;
+        const int column = acquire_column();
+        fill(column, render);
+        slots_[column].cached = false;
+        return add(point, column);
+    }
+
+    /**
+     * \brief Same as above, but reuses the rendering of the pose if it is
+     *        cached. Otherwise the point is rendered and cached, possibly in
+     *        place of the least recently used rendering.
+     */
+    template <typename Render>
+    int insert(const State& point, const Pose& pose, Render render)
+    {
+        auto it = cached_.find(pose);
+        if (it != cached_.end())
+        {
+            hits_++;
+            return add(point, it->second);
+        }
+
+        misses_++;
+        const int column = acquire_column();
+        fill(column, render);
+        slots_[column].cached = true;
+        slots_[column].pose = pose;
+        cached_[pose] = column;
+        return add(point, column);
+    }
+
+    /**
+     * \brief Depth of the pixel in the rendering of the point with the
+     *        given id, infinity if the object does not cover the pixel
+     */
+    float depth(int pixel, int id) const
+    {
+        return depths_(pixel, columns_[id]);
+    }
+
+    /** \brief Inserted points whose rendering was found in the cache */
+    std::uint64_t hits() const { return hits_; }
+
+    /** \brief Inserted points which had to be rendered */
+    std::uint64_t misses() const { return misses_; }
+
+    double hit_rate() const
+    {
+        const std::uint64_t total = hits_ + misses_;
+        return total > 0 ? double(hits_) / total : 0;
+    }
+
+    void reset_statistics() { hits_ = misses_ = 0; }
+
+private:
+    typedef Eigen::
+        Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+            DepthMatrix;
+
+    /** \brief Rendering in one column of depths_ */
+    struct Slot
+    {
+        Pose pose;
+        bool cached;
+        /** last update the rendering was used in */
+        std::uint64_t update;
+    };
+
+    /**
+     * \brief Column for a new rendering: a new one while the capacity is
+     *        not reached, otherwise the least recently used one which is
+     *        not used by the current update
+     */
+    int acquire_column()
+    {
+        int column = -1;
+        if (int(slots_.size()) >= capacity_)
+        {
+            for (int i = 0; i < int(slots_.size()); i++)
+            {
+                if (slots_[i].update == update_) continue;
+                if (column < 0 || slots_[i].update < slots_[column].update)
+                {
+                    column = i;
+                }
+            }
+        }
+
+        if (column >= 0)
+        {
+            if (slots_[column].cached) cached_.erase(slots_[column].pose);
+            return column;
+        }
+
+        column = slots_.size();
+        slots_.push_back(Slot());
+        if (column >= depths_.cols())
+        {
+            depths_.conservativeResize(pixel_count_,
+                                       std::max(8, 2 * int(depths_.cols())));
+        }
+        return column;
+    }
+
+    template <typename Render>
+    void fill(int column, Render& render)
+    {
+        render(rendering_);
+        depths_.col(column).setConstant(
+            std::numeric_limits<float>::infinity());
+        for (int k = rendering_.begin(0); k < rendering_.end(0); k++)
+        {
+            depths_(rendering_.indices[k], column) = rendering_.depths[k];
+        }
+    }
+
+    int add(const State& point, int column)
+    {
+        const int id = size();
+        slots_[column].update = update_;
+        points_.push_back(point);
+        columns_.push_back(column);
+        ids_[point] = id;
+        last_id_ = id;
+        return id;
+    }
+
+private:
+    int pixel_count_;
+    int capacity_;
+
+    // row p holds the depths of pixel p for all renderings
+    DepthMatrix depths_;
+    SparseDepthImages rendering_;
+    std::vector<Slot> slots_;
+
+    // points of the current update and the columns of their renderings
+    std::vector<State> points_;
+    std::vector<int> columns_;
+    std::unordered_map<State, int, PoseHash<State>> ids_;
+    mutable int last_id_;
+
+    std::uint64_t update_;
+    std::unordered_map<Pose, int, PoseHash<Pose>, PoseEqual<Pose>> cached_;
+
+    std::uint64_t hits_;
+    std::uint64_t misses_;
+};
+}
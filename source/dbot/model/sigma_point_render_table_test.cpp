@@ -0,0 +1,153 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file sigma_point_render_table_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <dbot/model/sigma_point_render_table.h>
+
+namespace
+{
+typedef dbot::SigmaPointRenderTable<dbot::PoseVector> Table;
+
+dbot::PoseVector point(double x)
+{
+    dbot::PoseVector pose;
+    pose.setZero();
+    pose(0) = x;
+    return pose;
+}
+
+/** renders a single pixel at the given depth */
+int insert(Table& table, const dbot::PoseVector& pose, int pixel, float depth)
+{
+    return table.insert(pose, [&](dbot::SparseDepthImages& rendering) {
+        rendering.clear();
+        rendering.indices.push_back(pixel);
+        rendering.depths.push_back(depth);
+        rendering.offsets.push_back(1);
+    });
+}
+}
+
+TEST(SigmaPointRenderTableTests, points_keep_their_renderings)
+{
+    Table table(4);
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_EQ(table.find(point(i)), -1);
+        EXPECT_EQ(insert(table, point(i), i % 4, float(i)), i);
+    }
+
+    // sequential, repeated and random order lookups
+    for (int i = 0; i < 20; i++) EXPECT_EQ(table.find(point(i)), i);
+    EXPECT_EQ(table.find(point(19)), 19);
+    EXPECT_EQ(table.find(point(0)), 0);
+    EXPECT_EQ(table.find(point(7)), 7);
+    EXPECT_EQ(table.find(point(0.5)), -1);
+
+    for (int i = 0; i < 20; i++)
+    {
+        for (int pixel = 0; pixel < 4; pixel++)
+        {
+            const float depth = table.depth(pixel, i);
+            if (pixel == i % 4)
+            {
+                EXPECT_EQ(depth, float(i));
+            }
+            else
+            {
+                EXPECT_FALSE(std::isfinite(depth));
+            }
+        }
+    }
+
+    table.clear();
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_EQ(table.find(point(3)), -1);
+    EXPECT_EQ(insert(table, point(3), 2, 1.f), 0);
+    EXPECT_EQ(table.depth(2, 0), 1.f);
+}
+
+TEST(SigmaPointRenderTableTests, poses_share_renderings)
+{
+    Table table(4, 3);
+    int renders = 0;
+    auto render = [&](dbot::SparseDepthImages& rendering) {
+        renders++;
+        rendering.clear();
+        rendering.indices.push_back(1);
+        rendering.depths.push_back(float(renders));
+        rendering.offsets.push_back(1);
+    };
+
+    // two points in the same pose are rendered once
+    EXPECT_EQ(table.insert(point(1), point(10), render), 0);
+    EXPECT_EQ(table.insert(point(2), point(10), render), 1);
+    EXPECT_EQ(renders, 1);
+    EXPECT_EQ(table.depth(1, 1), 1.f);
+    EXPECT_EQ(table.rendering_count(), 1);
+
+    // the next update finds the rendering of the pose again
+    table.next_update();
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_EQ(table.find(point(1)), -1);
+    EXPECT_EQ(table.insert(point(3), point(10), render), 0);
+    EXPECT_EQ(renders, 1);
+    EXPECT_EQ(table.depth(1, 0), 1.f);
+    EXPECT_EQ(table.hits(), 2u);
+    EXPECT_EQ(table.misses(), 1u);
+    EXPECT_DOUBLE_EQ(table.hit_rate(), 2. / 3.);
+}
+
+TEST(SigmaPointRenderTableTests, least_recently_used_rendering_is_evicted)
+{
+    Table table(4, 2);
+    int renders = 0;
+    auto render = [&](dbot::SparseDepthImages& rendering) {
+        renders++;
+        rendering.clear();
+        rendering.indices.push_back(0);
+        rendering.depths.push_back(float(renders));
+        rendering.offsets.push_back(1);
+    };
+
+    table.insert(point(0), point(0), render);
+    table.next_update();
+    table.insert(point(1), point(1), render);
+    table.next_update();
+
+    // pose 0 is used least recently and makes room for pose 2
+    table.insert(point(1), point(1), render);
+    table.insert(point(2), point(2), render);
+    EXPECT_EQ(renders, 3);
+    EXPECT_EQ(table.rendering_count(), 2);
+
+    // the points of the current update are kept beyond the capacity
+    table.insert(point(3), point(3), render);
+    EXPECT_EQ(table.rendering_count(), 3);
+    EXPECT_EQ(table.depth(0, 0), 2.f);
+    EXPECT_EQ(table.depth(0, 1), 3.f);
+    EXPECT_EQ(table.depth(0, 2), 4.f);
+
+    // and stay in the cache
+    table.next_update();
+    table.insert(point(3), point(3), render);
+    EXPECT_EQ(renders, 4);
+    table.insert(point(0), point(0), render);
+    EXPECT_EQ(renders, 5);
+}
@@ -21,6 +21,12 @@
 
 namespace dbot
 {
+namespace
+{
+// levels of detail generated for the renderers, including the full mesh
+const int level_count = 4;
+}
+
 ObjectModel::ObjectModel(const std::shared_ptr<ObjectModelLoader>& loader,
                          bool center)
 {
@@ -34,6 +40,26 @@ void ObjectModel::load_from(const std::shared_ptr<ObjectModelLoader>& loader,
     compute_centers(centers_);
 
     if (center) center_vertices(centers_, vertices_);
+
+    mesh_levels_ = MeshLevels(
+        std::make_shared<FlatMesh>(vertices_, triangle_indices_), level_count);
+}
+
+void ObjectModel::append(const ObjectModel& object_model)
+{
+    vertices_.insert(vertices_.end(),
+                     object_model.vertices_.begin(),
+                     object_model.vertices_.end());
+    triangle_indices_.insert(triangle_indices_.end(),
+                             object_model.triangle_indices_.begin(),
+                             object_model.triangle_indices_.end());
+    centers_.insert(centers_.end(),
+                    object_model.centers_.begin(),
+                    object_model.centers_.end());
+
+    auto joint_mesh = std::make_shared<FlatMesh>(*mesh());
+    joint_mesh->append(*object_model.mesh());
+    mesh_levels_ = MeshLevels(joint_mesh, level_count);
 }
 
 auto ObjectModel::vertices() const -> const Vertices &
@@ -46,6 +72,16 @@ auto ObjectModel::triangle_indices() const -> const TriangleIndecies &
     return triangle_indices_;
 }
 
+auto ObjectModel::mesh() const -> const std::shared_ptr<const FlatMesh> &
+{
+    return mesh_levels_.levels().front();
+}
+
+const MeshLevels& ObjectModel::mesh_levels() const
+{
+    return mesh_levels_;
+}
+
 const std::vector<Eigen::Vector3d>& ObjectModel::centers() const
 {
     return centers_;
@@ -26,6 +26,8 @@
 
 #include <fl/util/types.hpp>
 
+#include <dbot/flat_mesh.h>
+#include <dbot/mesh_levels.h>
 #include <dbot/object_model_loader.h>
 
 namespace dbot
@@ -44,10 +46,29 @@ public:
     void load_from(const std::shared_ptr<ObjectModelLoader>& loader,
                    bool center);
 
+    /**
+     * \brief Appends the parts of the given model after the parts of this
+     *        model, e.g. to render several objects in one pass
+     */
+    void append(const ObjectModel& object_model);
+
     const Vertices& vertices() const;
 
     const TriangleIndecies& triangle_indices() const;
 
+    /**
+     * \brief Contiguous copy of the vertices and triangles which is shared
+     *        by the renderers. It is replaced, not modified, when the model
+     *        changes.
+     */
+    const std::shared_ptr<const FlatMesh>& mesh() const;
+
+    /**
+     * \brief Decimated levels of detail of mesh(), which is their level 0.
+     *        They are generated when the model is loaded.
+     */
+    const MeshLevels& mesh_levels() const;
+
     const std::vector<Eigen::Vector3d>& centers() const;
 
     int count_parts() const;
@@ -63,5 +84,7 @@ private:
 
     std::vector<std::vector<Eigen::Vector3d>> vertices_;
     std::vector<std::vector<std::vector<int>>> triangle_indices_;
+
+    MeshLevels mesh_levels_;
 };
 }
@@ -0,0 +1,227 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pixel_selection.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <dbot/pixel_selection.h>
+
+namespace dbot
+{
+PixelSelection::PixelSelection(const Eigen::Matrix3d& camera_matrix,
+                               int n_rows,
+                               int n_cols,
+                               const BoxCorners& box_corners,
+                               const Parameters& parameters)
+    : camera_matrix_(camera_matrix),
+      n_rows_(n_rows),
+      n_cols_(n_cols),
+      box_corners_(box_corners),
+      parameters_(parameters),
+      generator_(parameters.seed)
+{
+}
+
+bool PixelSelection::parse_selection(const std::string& name,
+                                     Selection& selection)
+{
+    if (name == "all")
+        selection = Selection::all;
+    else if (name == "region")
+        selection = Selection::region;
+    else if (name == "random")
+        selection = Selection::random;
+    else if (name == "stratified")
+        selection = Selection::stratified;
+    else if (name == "edge_weighted")
+        selection = Selection::edge_weighted;
+    else
+        return false;
+    return true;
+}
+
+const std::vector<int>& PixelSelection::select(
+    const std::vector<Eigen::Matrix4d>& poses,
+    const Eigen::VectorXd& observation)
+{
+    indices_.clear();
+
+    if (parameters_.selection == Selection::all)
+    {
+        region_ = ImageRegion::full(n_rows_, n_cols_);
+        select_region();
+        return indices_;
+    }
+
+    ImageRegion footprint;
+    const int parts = std::min(poses.size(), box_corners_.size());
+    for (int part = 0; part < parts; part++)
+    {
+        footprint = footprint.unite(
+            projected_region(box_corners_[part],
+                             poses[part].topLeftCorner(3, 3),
+                             poses[part].topRightCorner(3, 1),
+                             camera_matrix_,
+                             n_rows_,
+                             n_cols_));
+    }
+    region_ = footprint.pad(parameters_.margin, n_rows_, n_cols_);
+    if (region_.empty()) return indices_;
+
+    const double fraction = std::min(std::max(parameters_.fraction, 0.), 1.);
+    const int count = int(std::lround(fraction * region_.area()));
+
+    switch (parameters_.selection)
+    {
+        case Selection::random:
+            select_random(count);
+            break;
+        case Selection::stratified:
+            select_stratified(fraction);
+            break;
+        case Selection::edge_weighted:
+            select_edge_weighted(observation, count);
+            break;
+        default:
+            select_region();
+            break;
+    }
+
+    std::sort(indices_.begin(), indices_.end());
+    return indices_;
+}
+
+void PixelSelection::mask(const Eigen::VectorXd& observation,
+                          Eigen::VectorXd& masked) const
+{
+    masked.setConstant(
+        observation.size(), std::numeric_limits<double>::quiet_NaN());
+    for (int pixel : indices_)
+    {
+        masked(pixel) = observation(pixel);
+    }
+}
+
+void PixelSelection::select_region()
+{
+    indices_.reserve(region_.area());
+    for (int row = region_.row; row < region_.row + region_.rows; row++)
+    {
+        for (int col = region_.col; col < region_.col + region_.cols; col++)
+        {
+            indices_.push_back(row * n_cols_ + col);
+        }
+    }
+}
+
+void PixelSelection::select_random(int count)
+{
+    select_region();
+
+    // partial Fisher-Yates shuffle of the first count pixels
+    for (int i = 0; i < count; i++)
+    {
+        std::uniform_int_distribution<int> pick(i, int(indices_.size()) - 1);
+        std::swap(indices_[i], indices_[pick(generator_)]);
+    }
+    indices_.resize(count);
+}
+
+void PixelSelection::select_stratified(double fraction)
+{
+    if (fraction <= 0) return;
+
+    // square cells of about 1 / fraction pixels, the cells at the far
+    // borders of the region may be smaller
+    const int cell = std::max(1, int(std::lround(1. / std::sqrt(fraction))));
+    for (int row = region_.row; row < region_.row + region_.rows; row += cell)
+    {
+        const int rows = std::min(cell, region_.row + region_.rows - row);
+        for (int col = region_.col; col < region_.col + region_.cols;
+             col += cell)
+        {
+            const int cols = std::min(cell, region_.col + region_.cols - col);
+            std::uniform_int_distribution<int> pick(0, rows * cols - 1);
+            const int k = pick(generator_);
+            indices_.push_back((row + k / cols) * n_cols_ + col + k % cols);
+        }
+    }
+}
+
+void PixelSelection::select_edge_weighted(const Eigen::VectorXd& observation,
+                                          int count)
+{
+    // weighted sampling without replacement: the count pixels with the
+    // largest keys u^(1 / w) are drawn, here compared as log(u) / w
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    keys_.clear();
+    keys_.reserve(region_.area());
+    for (int row = region_.row; row < region_.row + region_.rows; row++)
+    {
+        for (int col = region_.col; col < region_.col + region_.cols; col++)
+        {
+            const double weight = edge_weight(observation, row, col);
+            const double u = std::max(uniform(generator_),
+                                      std::numeric_limits<double>::min());
+            keys_.push_back(
+                std::make_pair(std::log(u) / weight, row * n_cols_ + col));
+        }
+    }
+
+    count = std::min(count, int(keys_.size()));
+    std::nth_element(keys_.begin(),
+                     keys_.begin() + count,
+                     keys_.end(),
+                     [](const std::pair<double, int>& a,
+                        const std::pair<double, int>& b) {
+                         return a.first > b.first;
+                     });
+    for (int i = 0; i < count; i++)
+    {
+        indices_.push_back(keys_[i].second);
+    }
+}
+
+double PixelSelection::edge_weight(const Eigen::VectorXd& observation,
+                                   int row,
+                                   int col) const
+{
+    // pixels without depth are skipped by the filter, they are drawn last
+    const double depth = observation(row * n_cols_ + col);
+    if (!std::isfinite(depth)) return 0;
+
+    // largest depth difference to the four neighbours, a neighbour without
+    // depth counts as an edge
+    double difference = 0;
+    const int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (int i = 0; i < 4; i++)
+    {
+        const int r = row + neighbours[i][0];
+        const int c = col + neighbours[i][1];
+        if (r < 0 || r >= n_rows_ || c < 0 || c >= n_cols_) continue;
+
+        const double other = observation(r * n_cols_ + c);
+        difference = std::isfinite(other)
+                         ? std::max(difference, std::abs(other - depth))
+                         : std::numeric_limits<double>::infinity();
+    }
+
+    const double edge = std::min(difference / parameters_.edge_depth, 1.);
+    return parameters_.flat_weight + (1 - parameters_.flat_weight) * edge;
+}
+}
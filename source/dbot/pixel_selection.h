@@ -0,0 +1,158 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pixel_selection.h
+ */
+
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/image_region.h>
+
+namespace dbot
+{
+/**
+ * \brief Selects the pixels a measurement update of the Gaussian tracker
+ *        processes.
+ *
+ * Apart from Selection::all, only pixels within the projected bounding
+ * boxes of the parts, padded by a margin for the motion of the frame, are
+ * selected. Within that region all pixels, a random subset, one random
+ * pixel per cell of a grid or a subset drawn with probabilities growing
+ * with the depth gradient are kept. The pixels which are not selected are
+ * set to NaN in the observation, which the filters skip.
+ *
+ * The selected pixels are not reweighted, hence a smaller fraction lowers
+ * the information of an update, which counters the correlation of
+ * neighbouring pixels the pixel models neglect.
+ */
+class PixelSelection
+{
+public:
+    enum class Selection
+    {
+        /** every pixel of the image */
+        all,
+        /** every pixel of the region */
+        region,
+        /** a uniformly random subset of the region */
+        random,
+        /** one random pixel per cell of a grid over the region */
+        stratified,
+        /** a random subset of the region, pixels at depth edges are drawn
+         *  with a higher probability */
+        edge_weighted
+    };
+
+    struct Parameters
+    {
+        Parameters()
+            : selection(Selection::all),
+              margin(16),
+              fraction(0.25),
+              edge_depth(0.02),
+              flat_weight(0.1),
+              seed(0)
+        {
+        }
+
+        Selection selection;
+
+        /** pixels the projected bounding boxes are padded with */
+        int margin;
+
+        /** fraction of the pixels of the region which is selected by the
+         *  random, stratified and edge weighted selections */
+        double fraction;
+
+        /** depth difference to a neighbour in m above which a pixel has
+         *  the full weight of the edge weighted selection */
+        double edge_depth;
+
+        /** weight of a pixel without depth gradient relative to an edge */
+        double flat_weight;
+
+        unsigned seed;
+    };
+
+    typedef std::vector<std::vector<Eigen::Vector3d>> BoxCorners;
+
+public:
+    /**
+     * \param box_corners	bounding box corners of each part, see
+     *                      bounding_box_corners()
+     */
+    PixelSelection(const Eigen::Matrix3d& camera_matrix,
+                   int n_rows,
+                   int n_cols,
+                   const BoxCorners& box_corners,
+                   const Parameters& parameters = Parameters());
+
+    /**
+     * \brief Parses "all", "region", "random", "stratified" or
+     *        "edge_weighted"
+     */
+    static bool parse_selection(const std::string& name, Selection& selection);
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /**
+     * \brief Selects the pixels of the row major observation given the pose
+     *        of each part and returns their ascending indices
+     */
+    const std::vector<int>& select(const std::vector<Eigen::Matrix4d>& poses,
+                                   const Eigen::VectorXd& observation);
+
+    /** \brief Ascending indices of the last selection */
+    const std::vector<int>& indices() const { return indices_; }
+
+    /** \brief Region of the last selection */
+    const ImageRegion& region() const { return region_; }
+
+    /**
+     * \brief Copy of the observation with NaN at the pixels which are not
+     *        selected
+     */
+    void mask(const Eigen::VectorXd& observation,
+              Eigen::VectorXd& masked) const;
+
+private:
+    void select_region();
+    void select_random(int count);
+    void select_stratified(double fraction);
+    void select_edge_weighted(const Eigen::VectorXd& observation, int count);
+    double edge_weight(const Eigen::VectorXd& observation,
+                       int row,
+                       int col) const;
+
+private:
+    Eigen::Matrix3d camera_matrix_;
+    int n_rows_;
+    int n_cols_;
+    BoxCorners box_corners_;
+    Parameters parameters_;
+
+    std::mt19937 generator_;
+    ImageRegion region_;
+    std::vector<int> indices_;
+
+    // keys of the weighted sampling without replacement
+    std::vector<std::pair<double, int>> keys_;
+};
+}
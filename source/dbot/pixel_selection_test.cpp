@@ -0,0 +1,170 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pixel_selection_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include <dbot/pixel_selection.h>
+
+namespace
+{
+const int n_rows = 60;
+const int n_cols = 80;
+
+class PixelSelectionTests : public ::testing::Test
+{
+protected:
+    PixelSelectionTests()
+    {
+        camera_matrix << 100, 0, 40, 0, 100, 30, 0, 0, 1;
+
+        // a 10 cm cube 1 m in front of the camera covers 10 x 10 pixels
+        std::vector<std::vector<Eigen::Vector3d>> vertices(1);
+        vertices[0].push_back(Eigen::Vector3d(-0.05, -0.05, -0.05));
+        vertices[0].push_back(Eigen::Vector3d(0.05, 0.05, 0.05));
+        corners = dbot::bounding_box_corners(vertices);
+
+        Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+        pose(2, 3) = 1.0;
+        poses.push_back(pose);
+
+        // a step in depth along column 40
+        observation.resize(n_rows * n_cols);
+        for (int row = 0; row < n_rows; row++)
+        {
+            for (int col = 0; col < n_cols; col++)
+            {
+                observation(row * n_cols + col) = col < 40 ? 1.0 : 1.5;
+            }
+        }
+    }
+
+    dbot::PixelSelection create(dbot::PixelSelection::Selection selection,
+                                double fraction = 0.25)
+    {
+        dbot::PixelSelection::Parameters parameters;
+        parameters.selection = selection;
+        parameters.margin = 5;
+        parameters.fraction = fraction;
+        return dbot::PixelSelection(
+            camera_matrix, n_rows, n_cols, corners, parameters);
+    }
+
+    Eigen::Matrix3d camera_matrix;
+    dbot::PixelSelection::BoxCorners corners;
+    std::vector<Eigen::Matrix4d> poses;
+    Eigen::VectorXd observation;
+};
+
+void expect_within(const std::vector<int>& indices,
+                   const dbot::ImageRegion& region)
+{
+    EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+    EXPECT_EQ(std::set<int>(indices.begin(), indices.end()).size(),
+              indices.size());
+    for (int pixel : indices)
+    {
+        EXPECT_TRUE(region.contains(pixel / n_cols, pixel % n_cols));
+    }
+}
+}
+
+TEST_F(PixelSelectionTests, all_and_region)
+{
+    auto all = create(dbot::PixelSelection::Selection::all);
+    EXPECT_EQ(int(all.select(poses, observation).size()), n_rows * n_cols);
+
+    auto region = create(dbot::PixelSelection::Selection::region);
+    const auto& indices = region.select(poses, observation);
+
+    // the projection of the cube, about 11 x 11 pixels, and the margin
+    const dbot::ImageRegion& r = region.region();
+    EXPECT_TRUE(r.contains(dbot::ImageRegion(25, 35, 10, 10)));
+    EXPECT_LE(r.rows, 11 + 2 * 5 + 2);
+    EXPECT_EQ(int(indices.size()), r.area());
+    expect_within(indices, r);
+
+    // behind the camera nothing is selected
+    poses[0](2, 3) = -1.0;
+    EXPECT_EQ(int(region.select(poses, observation).size()), n_rows * n_cols);
+    poses[0](0, 3) = 10.0;
+    poses[0](2, 3) = 1.0;
+    EXPECT_TRUE(region.select(poses, observation).empty());
+}
+
+TEST_F(PixelSelectionTests, random_and_stratified_subsets)
+{
+    auto random = create(dbot::PixelSelection::Selection::random);
+    const std::vector<int> first = random.select(poses, observation);
+    const int area = random.region().area();
+    EXPECT_EQ(int(first.size()), int(std::lround(0.25 * area)));
+    expect_within(first, random.region());
+    EXPECT_NE(random.select(poses, observation), first);
+
+    // one pixel per 2 x 2 cell
+    auto stratified = create(dbot::PixelSelection::Selection::stratified);
+    const auto& indices = stratified.select(poses, observation);
+    const dbot::ImageRegion& r = stratified.region();
+    EXPECT_EQ(int(indices.size()), ((r.rows + 1) / 2) * ((r.cols + 1) / 2));
+    expect_within(indices, r);
+    std::set<int> cells;
+    for (int pixel : indices)
+    {
+        const int row = (pixel / n_cols - r.row) / 2;
+        const int col = (pixel % n_cols - r.col) / 2;
+        cells.insert(row * r.cols + col);
+    }
+    EXPECT_EQ(cells.size(), indices.size());
+}
+
+TEST_F(PixelSelectionTests, edge_weighted_prefers_depth_edges)
+{
+    auto edges = create(dbot::PixelSelection::Selection::edge_weighted, 0.1);
+    const auto& indices = edges.select(poses, observation);
+    expect_within(indices, edges.region());
+    ASSERT_FALSE(indices.empty());
+
+    // two of the about thirty columns of the region lie at the step
+    int at_edge = 0;
+    for (int pixel : indices)
+    {
+        const int col = pixel % n_cols;
+        if (col == 39 || col == 40) at_edge++;
+    }
+    EXPECT_GT(at_edge, int(indices.size()) / 4);
+}
+
+TEST_F(PixelSelectionTests, mask_keeps_the_selected_pixels)
+{
+    auto region = create(dbot::PixelSelection::Selection::region);
+    region.select(poses, observation);
+
+    Eigen::VectorXd masked;
+    region.mask(observation, masked);
+    ASSERT_EQ(masked.size(), observation.size());
+    int kept = 0;
+    for (int i = 0; i < masked.size(); i++)
+    {
+        if (std::isnan(masked(i))) continue;
+        EXPECT_EQ(masked(i), observation(i));
+        kept++;
+    }
+    EXPECT_EQ(kept, int(region.indices().size()));
+}
@@ -63,7 +63,27 @@ public:
         return ax;
     }
     virtual AngleAxis angle_axis() const { return AngleAxis(angle(), axis()); }
-    virtual Quaternion quaternion() const { return Quaternion(angle_axis()); }
+    virtual Quaternion quaternion() const
+    {
+        // straight from the vector instead of through the normalized axis,
+        // the Taylor expansion of sin(angle / 2) / angle is exact to double
+        // precision below the threshold
+        const Scalar squared_angle = this->squaredNorm();
+        Scalar w, scale;
+        if (squared_angle < Scalar(1e-8))
+        {
+            w = 1 - squared_angle / 8;
+            scale = Scalar(0.5) - squared_angle / 48;
+        }
+        else
+        {
+            const Scalar angle = std::sqrt(squared_angle);
+            w = std::cos(angle / 2);
+            scale = std::sin(angle / 2) / angle;
+        }
+        return Quaternion(
+            w, scale * (*this)(0), scale * (*this)(1), scale * (*this)(2));
+    }
     virtual RotationMatrix rotation_matrix() const
     {
         return RotationMatrix(quaternion());
@@ -82,7 +102,14 @@ public:
     }
     virtual void quaternion(const Quaternion& quat)
     {
-        angle_axis(AngleAxis(quat));
+        // the angle axis of the quaternion, with the angle in [0, Pi], as
+        // AngleAxis(quat) without the normalization of the axis
+        const Scalar norm = quat.vec().norm();
+        const Scalar w = std::abs(quat.w());
+        Scalar scale =
+            norm < Scalar(1e-12) ? 2 / w : 2 * std::atan2(norm, w) / norm;
+        if (quat.w() < 0) scale = -scale;
+        *this = scale * quat.vec();
     }
     virtual void rotation_matrix(const RotationMatrix& rot_mat)
     {
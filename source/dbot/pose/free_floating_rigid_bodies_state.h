@@ -19,6 +19,7 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <Eigen/StdVector>
 
 #include <dbot/pose/rigid_bodies_state.h>
 
@@ -47,6 +48,7 @@ public:
     {
         BODY_SIZE = Types::BODY_SIZE,
         POSE_SIZE = Types::POSE_SIZE,
+        BODY_COUNT = BodyCount
     };
 
     typedef typename Base::State State;
@@ -152,3 +154,7 @@ public:
     }
 };
 }
+
+// the state of one body is a vectorizable fixed size vector, standard vectors
+// of it use the aligned allocator
+EIGEN_DEFINE_STL_VECTOR_SPECIALIZATION(dbot::FreeFloatingRigidBodiesState<1>)
@@ -0,0 +1,89 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_cache.h
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/pose/euler_vector.h>
+
+namespace dbot
+{
+/**
+ * \brief Positions, quaternions and rotation matrices of the bodies of a
+ *        FreeFloatingRigidBodiesState, kept side by side.
+ *
+ * The conversions of an Euler vector are computed once per body instead of
+ * once per use, e.g. when all particles of the filter are expressed
+ * relative to their mean.
+ */
+class PoseCache
+{
+public:
+    typedef Eigen::Matrix<Real, 3, 1> Vector;
+    typedef Eigen::Quaternion<Real> Quaternion;
+    typedef Eigen::Matrix<Real, 3, 3> RotationMatrix;
+
+public:
+    /** \brief Caches the poses of all bodies of the state */
+    template <typename State>
+    void set(const State& state)
+    {
+        const int bodies = state.count();
+        positions_.resize(bodies);
+        inverse_quaternions_.resize(bodies);
+        inverse_rotations_.resize(bodies);
+        for (int body = 0; body < bodies; body++)
+        {
+            const EulerVector orientation = state.component(body).orientation();
+            positions_[body] = state.component(body).position();
+            inverse_quaternions_[body] = orientation.quaternion().conjugate();
+            inverse_rotations_[body] =
+                inverse_quaternions_[body].toRotationMatrix();
+        }
+    }
+
+    int body_count() const { return positions_.size(); }
+
+    /**
+     * \brief Same as state.subtract(cached), the poses of the state are
+     *        expressed relative to the cached ones
+     */
+    template <typename State>
+    void subtract_from(State& state) const
+    {
+        for (int body = 0; body < body_count(); body++)
+        {
+            auto pose = state.component(body);
+            pose.position() =
+                inverse_rotations_[body] * (pose.position() - positions_[body]);
+
+            const EulerVector orientation = pose.orientation();
+            pose.orientation().quaternion(inverse_quaternions_[body] *
+                                          orientation.quaternion());
+        }
+    }
+
+private:
+    std::vector<Vector> positions_;
+    std::vector<Quaternion, Eigen::aligned_allocator<Quaternion>>
+        inverse_quaternions_;
+    std::vector<RotationMatrix> inverse_rotations_;
+};
+}
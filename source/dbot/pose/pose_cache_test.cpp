@@ -0,0 +1,81 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_cache_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/pose/pose_cache.h>
+
+namespace
+{
+typedef dbot::FreeFloatingRigidBodiesState<> State;
+
+State random_state(int bodies, double angle_scale)
+{
+    State state(bodies);
+    state.setRandom();
+    for (int body = 0; body < bodies; body++)
+    {
+        state.component(body).orientation() =
+            angle_scale * Eigen::Vector3d::Random();
+    }
+    return state;
+}
+}
+
+TEST(PoseCacheTests, quaternion_conversions_match_angle_axis)
+{
+    srand(1);
+    for (double scale : {0.0, 1e-7, 1e-3, 1.0, 3.0})
+    {
+        const dbot::EulerVector euler = scale * Eigen::Vector3d::Random();
+
+        const Eigen::Quaterniond expected(
+            Eigen::AngleAxisd(euler.angle(), euler.axis()));
+        EXPECT_TRUE(euler.quaternion().coeffs().isApprox(expected.coeffs(),
+                                                         1e-12))
+            << "scale " << scale;
+
+        // the quaternion of the opposite sign gives the same vector
+        dbot::EulerVector back;
+        back.quaternion(expected);
+        EXPECT_TRUE((back - euler).isZero(1e-12)) << "scale " << scale;
+        back.quaternion(Eigen::Quaterniond(-expected.coeffs()));
+        EXPECT_TRUE((back - euler).isZero(1e-12)) << "scale " << scale;
+    }
+}
+
+TEST(PoseCacheTests, subtract_from_matches_subtract)
+{
+    srand(2);
+    const int bodies = 2;
+    const State mean = random_state(bodies, 1.0);
+
+    dbot::PoseCache cache;
+    cache.set(mean);
+    ASSERT_EQ(cache.body_count(), bodies);
+
+    for (int i = 0; i < 20; i++)
+    {
+        State expected = random_state(bodies, 0.05 * i);
+        State state = expected;
+
+        expected.subtract(mean);
+        cache.subtract_from(state);
+        EXPECT_TRUE(state.isApprox(expected, 1e-10));
+    }
+}
@@ -0,0 +1,186 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_composition.h
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#ifndef DBOT_HOST_DEVICE
+#ifdef __CUDACC__
+#define DBOT_HOST_DEVICE __host__ __device__
+#else
+#define DBOT_HOST_DEVICE
+#endif
+#endif
+
+namespace dbot
+{
+/**
+ * \brief Column major rotation matrix of an Euler vector, i.e. the rotation
+ *        axis scaled by the angle, see EulerVector::rotation_matrix()
+ */
+template <typename Scalar>
+DBOT_HOST_DEVICE inline void euler_vector_rotation(const Scalar* euler,
+                                                   Scalar* rotation)
+{
+    const Scalar x = euler[0];
+    const Scalar y = euler[1];
+    const Scalar z = euler[2];
+    const Scalar squared_angle = x * x + y * y + z * z;
+
+    // Rodrigues' formula R = I + a K + b K^2 with the cross product matrix
+    // K, the Taylor expansions of a and b are exact to the precision of
+    // double below the threshold
+    Scalar a, b;
+    if (squared_angle < Scalar(1e-8))
+    {
+        a = 1 - squared_angle / 6;
+        b = Scalar(0.5) - squared_angle / 24;
+    }
+    else
+    {
+        const Scalar angle = std::sqrt(squared_angle);
+        a = std::sin(angle) / angle;
+        b = (1 - std::cos(angle)) / squared_angle;
+    }
+
+    rotation[0] = 1 - b * (y * y + z * z);
+    rotation[1] = a * z + b * x * y;
+    rotation[2] = -a * y + b * x * z;
+    rotation[3] = -a * z + b * x * y;
+    rotation[4] = 1 - b * (x * x + z * z);
+    rotation[5] = a * x + b * y * z;
+    rotation[6] = a * y + b * x * z;
+    rotation[7] = -a * x + b * y * z;
+    rotation[8] = 1 - b * (x * x + y * y);
+}
+
+/**
+ * \brief Applies a delta pose to a base pose as PoseBase::apply_delta()
+ *
+ * \param base		column major homogeneous matrix of the base pose
+ * \param delta		position and Euler vector of the delta
+ * \param matrix	column major homogeneous matrix of the composed pose
+ */
+template <typename Scalar, typename Output>
+DBOT_HOST_DEVICE inline void compose_pose(const Scalar* base,
+                                          const Scalar* delta,
+                                          Output* matrix)
+{
+    Scalar rotation[9];
+    euler_vector_rotation(delta + 3, rotation);
+
+    for (int col = 0; col < 3; col++)
+    {
+        const Scalar* column = rotation + col * 3;
+        for (int row = 0; row < 3; row++)
+        {
+            matrix[col * 4 + row] =
+                Output(base[row] * column[0] + base[4 + row] * column[1] +
+                       base[8 + row] * column[2]);
+        }
+        matrix[col * 4 + 3] = 0;
+    }
+    for (int row = 0; row < 3; row++)
+    {
+        matrix[12 + row] =
+            Output(base[row] * delta[0] + base[4 + row] * delta[1] +
+                   base[8 + row] * delta[2] + base[12 + row]);
+    }
+    matrix[15] = 1;
+}
+
+/**
+ * \brief Composes batches of delta states with the poses of the bodies.
+ *
+ * The base poses are converted to homogeneous matrices once, each delta
+ * then costs one rotation of its Euler vector and a matrix product, written
+ * straight into the buffer of the caller, e.g. the pose upload buffer of
+ * the rasterizer. The base matrices can be copied to a device where
+ * compose_pose() applies the deltas the same way.
+ */
+class PoseComposition
+{
+public:
+    enum
+    {
+        BODY_SIZE = 12,
+        MATRIX_SIZE = 16
+    };
+
+public:
+    /**
+     * \brief Sets the poses the deltas are applied to, a
+     *        FreeFloatingRigidBodiesState
+     */
+    template <typename Poses>
+    void base_poses(const Poses& poses)
+    {
+        base_.resize(poses.count() * MATRIX_SIZE);
+        for (int body = 0; body < poses.count(); body++)
+        {
+            Eigen::Map<Eigen::Matrix4d> matrix(&base_[body * MATRIX_SIZE]);
+            matrix = poses.component(body).homogeneous();
+        }
+    }
+
+    int body_count() const { return base_.size() / MATRIX_SIZE; }
+
+    /** \brief Column major homogeneous matrices of the base poses */
+    const std::vector<double>& base_matrices() const { return base_; }
+
+    /**
+     * \brief Writes the column major homogeneous matrix of the given body
+     *        of the delta state applied to its base pose
+     */
+    template <typename Delta, typename Output>
+    void compose(const Delta& delta, int body, Output* matrix) const
+    {
+        compose_pose(&base_[body * MATRIX_SIZE],
+                     delta.data() + body * BODY_SIZE,
+                     matrix);
+    }
+
+    /**
+     * \brief Writes the matrices of all bodies of the deltas begin to end,
+     *        the one of body j of delta i at (i * body_count() + j) * 16
+     */
+    template <typename Deltas, typename Output>
+    void compose(const Deltas& deltas,
+                 int begin,
+                 int end,
+                 Output* matrices) const
+    {
+        const int bodies = body_count();
+        for (int i = begin; i < end; i++)
+        {
+            for (int body = 0; body < bodies; body++)
+            {
+                compose(deltas[i],
+                        body,
+                        matrices + (i * bodies + body) * MATRIX_SIZE);
+            }
+        }
+    }
+
+private:
+    std::vector<double> base_;
+};
+}
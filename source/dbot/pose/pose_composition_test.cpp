@@ -0,0 +1,109 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_composition_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/pose/free_floating_rigid_bodies_state.h>
+#include <dbot/pose/pose_composition.h>
+
+namespace
+{
+typedef dbot::FreeFloatingRigidBodiesState<> State;
+
+/** the composition of the trackers before the batch API */
+Eigen::Matrix4d reference(const State& base, const State& delta, int body)
+{
+    auto pose_0 = base.component(body);
+    auto pose_delta = delta.component(body);
+
+    dbot::PoseVector pose;
+    pose.position() =
+        pose_0.orientation().rotation_matrix() * pose_delta.position() +
+        pose_0.position();
+    pose.orientation() = pose_0.orientation() * pose_delta.orientation();
+    return pose.homogeneous();
+}
+
+State random_state(int bodies, double angle_scale)
+{
+    State state(bodies);
+    for (int body = 0; body < bodies; body++)
+    {
+        state.component(body).position() = Eigen::Vector3d::Random();
+        state.component(body).orientation() =
+            angle_scale * Eigen::Vector3d::Random();
+    }
+    return state;
+}
+}
+
+TEST(PoseCompositionTests, rotation_of_euler_vectors)
+{
+    srand(1);
+    for (double scale : {0.0, 1e-6, 1e-3, 1.0, 3.0})
+    {
+        const dbot::EulerVector euler = scale * Eigen::Vector3d::Random();
+
+        Eigen::Matrix3d rotation;
+        dbot::euler_vector_rotation(euler.data(), rotation.data());
+        EXPECT_TRUE(rotation.isApprox(euler.rotation_matrix(), 1e-12))
+            << "scale " << scale;
+    }
+}
+
+TEST(PoseCompositionTests, matches_apply_delta)
+{
+    srand(2);
+    const int bodies = 3;
+    const State base = random_state(bodies, 1.0);
+
+    Eigen::Array<State, -1, 1> deltas(5);
+    for (int i = 0; i < deltas.size(); i++)
+    {
+        deltas[i] = random_state(bodies, i == 0 ? 0.0 : 0.1 * i);
+    }
+
+    dbot::PoseComposition composition;
+    composition.base_poses(base);
+    ASSERT_EQ(composition.body_count(), bodies);
+
+    std::vector<double> matrices(deltas.size() * bodies * 16);
+    std::vector<float> float_matrices(matrices.size());
+    composition.compose(deltas, 0, deltas.size(), matrices.data());
+    composition.compose(deltas, 1, deltas.size(), float_matrices.data());
+
+    for (int i = 0; i < deltas.size(); i++)
+    {
+        for (int body = 0; body < bodies; body++)
+        {
+            const int offset = (i * bodies + body) * 16;
+            const Eigen::Matrix4d expected = reference(base, deltas[i], body);
+            EXPECT_TRUE(Eigen::Map<Eigen::Matrix4d>(&matrices[offset])
+                            .isApprox(expected, 1e-12));
+            if (i == 0) continue;
+            EXPECT_TRUE(Eigen::Map<Eigen::Matrix4f>(&float_matrices[offset])
+                            .isApprox(expected.cast<float>(), 1e-6f));
+        }
+    }
+
+    // a single body written into an affine transform
+    Eigen::Affine3d affine;
+    composition.compose(deltas[2], 1, affine.matrix().data());
+    EXPECT_TRUE(affine.matrix().isApprox(reference(base, deltas[2], 1)));
+}
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <Eigen/Dense>
 
@@ -28,63 +30,93 @@
 
 namespace dbot
 {
-template <typename Vector>
-class PoseHash;
-
-template <>
-class PoseHash<PoseVector>
+namespace internal
 {
-public:
-    std::size_t operator()(const PoseVector& s) const
-    {
-        /* primes */
-        static constexpr int p1 = 15487457;
-        static constexpr int p2 = 24092821;
-        static constexpr int p3 = 73856093;
-        static constexpr int p4 = 19349663;
-        static constexpr int p5 = 83492791;
-        static constexpr int p6 = 17353159;
-
-        /* map size */
-        static constexpr int n = 1200;
-
-        /* precision */
-        static constexpr int c = 1000000;
+/**
+ * \brief 64 bit finalizer of splitmix64, every input bit affects every
+ *        output bit
+ */
+inline std::uint64_t mix_bits(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
 
-        return ((int(s(0, 0) * c) * p1) ^ (int(s(1, 0) * c) * p2) ^
-                (int(s(2, 0) * c) * p3) ^ (int(s(3, 0) * c) * p4) ^
-                (int(s(4, 0) * c) * p5) ^ (int(s(5, 0) * c) * p6) % n);
-    }
-};
+/**
+ * \brief Coefficient rounded to the nearest multiple of the precision
+ */
+inline std::int64_t quantize(double value, double inverse_precision)
+{
+    return std::llround(value * inverse_precision);
+}
+}
 
-template <>
-class PoseHash<PoseVelocityVector>
+/**
+ * \brief Hash of a pose or state vector which is quantized to the given
+ *        precision. Vectors whose coefficients quantize to the same values
+ *        have the same hash, in particular equal vectors do.
+ *
+ * Each quantized coefficient is mixed into the hash with a full 64 bit
+ * avalanche step, hence nearby poses are spread over all buckets.
+ */
+template <typename Vector>
+class PoseHash
 {
 public:
-    std::size_t operator()(const PoseVelocityVector& s) const
+    explicit PoseHash(double precision = 1e-6)
+        : inverse_precision_(1. / precision)
     {
-        auto h = PoseHash<PoseVector>();
-
-        std::size_t hash = h(s.pose());
+    }
 
-        return hash;
+    std::size_t operator()(const Vector& s) const
+    {
+        std::uint64_t hash = 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < int(s.size()); ++i)
+        {
+            const std::uint64_t q = std::uint64_t(
+                internal::quantize(s(i), inverse_precision_));
+            hash = internal::mix_bits(hash + q + 0x9e3779b97f4a7c15ULL);
+        }
+        return std::size_t(hash);
     }
+
+private:
+    double inverse_precision_;
 };
-template <>
-class PoseHash<FreeFloatingRigidBodiesState<>>
+
+/**
+ * \brief Equality under the quantization of PoseHash with the same
+ *        precision. Unlike operator==, poses which differ by less than the
+ *        precision compare equal.
+ */
+template <typename Vector>
+class PoseEqual
 {
 public:
-    std::size_t operator()(const FreeFloatingRigidBodiesState<>& s) const
+    explicit PoseEqual(double precision = 1e-6)
+        : inverse_precision_(1. / precision)
     {
-        auto h = PoseHash<PoseVector>();
+    }
 
-        std::size_t hash = 0;
-        for (int i = 0; i < s.count(); ++i)
+    bool operator()(const Vector& a, const Vector& b) const
+    {
+        if (a.size() != b.size()) return false;
+        for (int i = 0; i < int(a.size()); ++i)
         {
-            hash += h(s.component(i).pose());
+            if (internal::quantize(a(i), inverse_precision_) !=
+                internal::quantize(b(i), inverse_precision_))
+            {
+                return false;
+            }
         }
-
-        return hash;
+        return true;
     }
+
+private:
+    double inverse_precision_;
 };
 }
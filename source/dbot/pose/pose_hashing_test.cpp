@@ -0,0 +1,117 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file pose_hashing_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <dbot/pose/pose_hashing.h>
+
+namespace
+{
+typedef dbot::PoseVector Pose;
+
+/**
+ * \brief Unscented sigma points of a Gaussian with diagonal covariance
+ *        around the given mean, as generated by the Gaussian tracker
+ */
+std::vector<Pose> sigma_points(const Pose& mean, const Pose& deviations)
+{
+    const double scale = std::sqrt(double(mean.size()) + 1.);
+    std::vector<Pose> points(1, mean);
+    for (int i = 0; i < mean.size(); i++)
+    {
+        Pose point = mean;
+        point(i) += scale * deviations(i);
+        points.push_back(point);
+        point(i) -= 2 * scale * deviations(i);
+        points.push_back(point);
+    }
+    return points;
+}
+}
+
+TEST(PoseHashTests, quantized_poses_share_hash_and_equality)
+{
+    dbot::PoseHash<Pose> hash(1e-4);
+    dbot::PoseEqual<Pose> equal(1e-4);
+
+    Pose a;
+    a << 0.1, -0.2, 0.7, 0.01, 0.02, -0.03;
+    Pose b = a;
+    b(2) += 1e-6;
+    Pose c = a;
+    c(2) += 1e-3;
+
+    EXPECT_EQ(hash(a), hash(b));
+    EXPECT_TRUE(equal(a, b));
+    EXPECT_FALSE(equal(a, c));
+    EXPECT_NE(hash(a), hash(c));
+}
+
+TEST(PoseHashTests, sigma_point_collision_rate)
+{
+    std::mt19937 generator(1);
+    std::normal_distribution<double> normal;
+
+    // the sigma points of consecutive frames of a slowly moving object
+    std::vector<Pose> points;
+    Pose mean;
+    mean << 0, 0, 0.8, 0, 0, 0;
+    Pose deviations;
+    deviations << 1e-3, 1e-3, 1e-3, 1e-2, 1e-2, 1e-2;
+    for (int frame = 0; frame < 2000; frame++)
+    {
+        for (int i = 0; i < mean.size(); i++)
+        {
+            mean(i) += 0.2 * deviations(i) * normal(generator);
+        }
+        std::vector<Pose> frame_points = sigma_points(mean, deviations);
+        points.insert(points.end(), frame_points.begin(), frame_points.end());
+    }
+
+    typedef std::
+        unordered_set<Pose, dbot::PoseHash<Pose>, dbot::PoseEqual<Pose>>
+            PoseSet;
+    PoseSet set(points.begin(), points.end());
+
+    // full 64 bit hash collisions among distinct points
+    std::unordered_map<std::size_t, int> hashes;
+    for (const Pose& point : set) hashes[set.hash_function()(point)]++;
+    const int hash_collisions = int(set.size() - hashes.size());
+
+    // points sharing their bucket with another point, compared to ideal
+    // uniform hashing
+    int shared = 0;
+    for (size_t bucket = 0; bucket < set.bucket_count(); bucket++)
+    {
+        if (set.bucket_size(bucket) > 1) shared += set.bucket_size(bucket);
+    }
+    const double load = double(set.size()) / set.bucket_count();
+    const double shared_rate = double(shared) / set.size();
+    const double ideal_rate = 1. - std::exp(-load);
+
+    int found = 0;
+    for (const Pose& point : points) found += int(set.count(point));
+
+    EXPECT_EQ(found, int(points.size()));
+    EXPECT_EQ(hash_collisions, 0);
+    EXPECT_LT(shared_rate, 1.5 * ideal_rate + 0.01);
+}
@@ -0,0 +1,352 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file profiler.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <dbot/profiler.h>
+
+namespace dbot
+{
+constexpr int Profiler::stage_count;
+constexpr int Profiler::bucket_count;
+
+namespace
+{
+/**
+ * \brief Counters of one thread. They are only written by their thread,
+ *        the atomics allow reading them while the thread records.
+ */
+struct Counters
+{
+    struct Stage
+    {
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> sum_ns;
+        std::atomic<std::uint64_t> max_ns;
+        std::atomic<std::uint64_t> buckets[Profiler::bucket_count];
+    };
+
+    Counters() { clear(); }
+
+    void clear()
+    {
+        for (Stage& stage : stages)
+        {
+            stage.count.store(0, std::memory_order_relaxed);
+            stage.sum_ns.store(0, std::memory_order_relaxed);
+            stage.max_ns.store(0, std::memory_order_relaxed);
+            for (auto& bucket : stage.buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void add_to(Profiler::Snapshot& snapshot) const
+    {
+        for (int i = 0; i < Profiler::stage_count; i++)
+        {
+            const Stage& stage = stages[i];
+            Profiler::Histogram& histogram = snapshot[i];
+            histogram.count += stage.count.load(std::memory_order_relaxed);
+            histogram.sum +=
+                stage.sum_ns.load(std::memory_order_relaxed) * 1e-9;
+            histogram.max = std::max(
+                histogram.max,
+                stage.max_ns.load(std::memory_order_relaxed) * 1e-9);
+            for (int b = 0; b < Profiler::bucket_count; b++)
+            {
+                histogram.buckets[b] +=
+                    stage.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Stage stages[Profiler::stage_count];
+};
+
+struct ThreadCounters;
+
+/**
+ * \brief Counters of all running threads and the merged histograms of the
+ *        finished ones
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<const ThreadCounters*> threads;
+    Profiler::Snapshot finished;
+    // bumped by reset(), threads clear their counters when they see it
+    std::atomic<std::uint64_t> generation{0};
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+struct ThreadCounters
+{
+    ThreadCounters() : generation(registry().generation.load())
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().threads.push_back(this);
+    }
+
+    ~ThreadCounters()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        add_to(r.finished);
+        for (size_t i = 0; i < r.threads.size(); i++)
+        {
+            if (r.threads[i] == this)
+            {
+                r.threads.erase(r.threads.begin() + i);
+                break;
+            }
+        }
+    }
+
+    /**
+     * \brief Adds the counters unless they predate the last reset
+     */
+    void add_to(Profiler::Snapshot& snapshot) const
+    {
+        if (generation.load(std::memory_order_acquire) ==
+            registry().generation.load())
+        {
+            counters.add_to(snapshot);
+        }
+    }
+
+    Counters counters;
+    std::atomic<std::uint64_t> generation;
+};
+
+Counters& thread_counters()
+{
+    static thread_local ThreadCounters local;
+
+    const std::uint64_t generation =
+        registry().generation.load(std::memory_order_relaxed);
+    if (local.generation.load(std::memory_order_relaxed) != generation)
+    {
+        local.counters.clear();
+        local.generation.store(generation, std::memory_order_release);
+    }
+    return local.counters;
+}
+
+void increment(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+{
+    // there is a single writer, no read modify write is needed
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+bool enabled_by_environment()
+{
+    const char* value = std::getenv("DBOT_PROFILING");
+    return value != nullptr && std::string(value) != "0" &&
+           std::string(value) != "";
+}
+}
+
+std::atomic<bool>& Profiler::enabled_flag()
+{
+    static std::atomic<bool> flag(enabled_by_environment());
+    return flag;
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+    enabled_flag().store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::add(ProfileStage stage, double seconds)
+{
+    Counters::Stage& counters = thread_counters().stages[int(stage)];
+    const std::uint64_t ns =
+        seconds > 0 ? std::uint64_t(std::llround(seconds * 1e9)) : 0;
+
+    increment(counters.count, 1);
+    increment(counters.sum_ns, ns);
+    increment(counters.buckets[bucket_index(seconds)], 1);
+    if (ns > counters.max_ns.load(std::memory_order_relaxed))
+    {
+        counters.max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::record(ProfileStage stage,
+                      Clock::time_point begin,
+                      Clock::time_point end)
+{
+    if (enabled())
+    {
+        add(stage, std::chrono::duration<double>(end - begin).count());
+    }
+    TraceRecorder::span(stage_name(stage), "stage", begin, end);
+}
+
+void Profiler::reset()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.finished = Snapshot();
+    r.generation++;
+}
+
+auto Profiler::snapshot() -> Snapshot
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // the running threads only clear their counters on their next record
+    // after a reset, until then their old values are skipped
+    Snapshot snapshot = r.finished;
+    for (const ThreadCounters* thread : r.threads)
+    {
+        thread->add_to(snapshot);
+    }
+    return snapshot;
+}
+
+const char* Profiler::stage_name(ProfileStage stage)
+{
+    switch (stage)
+    {
+        case ProfileStage::Frame:
+            return "frame";
+        case ProfileStage::Convert:
+            return "convert";
+        case ProfileStage::Upload:
+            return "upload";
+        case ProfileStage::Render:
+            return "render";
+        case ProfileStage::RenderGpu:
+            return "render_gpu";
+        case ProfileStage::Map:
+            return "map";
+        case ProfileStage::Weigh:
+            return "weigh";
+        case ProfileStage::Resample:
+            return "resample";
+        case ProfileStage::Propose:
+            return "propose";
+        default:
+            return "unknown";
+    }
+}
+
+double Profiler::bucket_bound(int i)
+{
+    return std::ldexp(1e-6, i);
+}
+
+int Profiler::bucket_index(double seconds)
+{
+    const double microseconds = seconds * 1e6;
+    if (!(microseconds > 1)) return 0;
+
+    // 2^(e-1) <= microseconds < 2^e, the bound 2^e is inclusive
+    int exponent;
+    const double mantissa = std::frexp(microseconds, &exponent);
+    if (mantissa == 0.5) exponent--;
+    return std::min(exponent, bucket_count - 1);
+}
+
+double Profiler::Histogram::quantile(double q) const
+{
+    if (count == 0) return 0;
+
+    const double rank = q * count;
+    std::uint64_t cumulative = 0;
+    for (int i = 0; i < bucket_count - 1; i++)
+    {
+        cumulative += buckets[i];
+        if (cumulative >= rank && cumulative > 0)
+        {
+            return std::min(bucket_bound(i), max);
+        }
+    }
+    return max;
+}
+
+std::string Profiler::to_json()
+{
+    const Snapshot stages = snapshot();
+
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\"stages\":{";
+    for (int i = 0; i < stage_count; i++)
+    {
+        const Histogram& h = stages[i];
+        json << (i > 0 ? "," : "") << "\"" << stage_name(ProfileStage(i))
+             << "\":{\"count\":" << h.count << ",\"sum\":" << h.sum
+             << ",\"mean\":" << h.mean() << ",\"max\":" << h.max
+             << ",\"p50\":" << h.quantile(0.5) << ",\"p90\":" << h.quantile(0.9)
+             << ",\"p99\":" << h.quantile(0.99) << ",\"buckets\":[";
+        for (int b = 0; b < bucket_count; b++)
+        {
+            json << (b > 0 ? "," : "") << h.buckets[b];
+        }
+        json << "]}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+std::string Profiler::to_prometheus()
+{
+    const Snapshot stages = snapshot();
+    const std::string name = "dbot_stage_duration_seconds";
+
+    std::ostringstream text;
+    text.precision(9);
+    text << "# HELP " << name << " Duration of the tracking stages.\n"
+         << "# TYPE " << name << " histogram\n";
+    for (int i = 0; i < stage_count; i++)
+    {
+        const Histogram& h = stages[i];
+        const std::string stage =
+            std::string("stage=\"") + stage_name(ProfileStage(i)) + "\"";
+
+        // prometheus buckets are cumulative
+        std::uint64_t cumulative = 0;
+        for (int b = 0; b < bucket_count - 1; b++)
+        {
+            cumulative += h.buckets[b];
+            text << name << "_bucket{" << stage << ",le=\"" << bucket_bound(b)
+                 << "\"} " << cumulative << "\n";
+        }
+        text << name << "_bucket{" << stage << ",le=\"+Inf\"} " << h.count
+             << "\n"
+             << name << "_sum{" << stage << "} " << h.sum << "\n"
+             << name << "_count{" << stage << "} " << h.count << "\n";
+    }
+    return text.str();
+}
+}
@@ -0,0 +1,213 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file profiler.h
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <dbot/trace_recorder.h>
+
+namespace dbot
+{
+/**
+ * \brief Stages of a tracking step which are timed by the Profiler
+ */
+enum class ProfileStage
+{
+    Frame,      // a whole call of Tracker::track()
+    Convert,    // conversion of states and observations between formats
+    Upload,     // copies of poses and indices to the GPU
+    Render,     // rendering of the particle poses
+    RenderGpu,  // GPU execution time of the rendering, from timer queries
+    Map,        // mapping of the rendered textures between OpenGL and CUDA
+    Weigh,      // evaluation of the particle likelihoods
+    Resample,   // resampling of the particles
+    Propose,    // sampling of the noise and propagation of the particles
+    Count
+};
+
+/**
+ * \brief Runtime switchable latency histograms of the tracking stages.
+ *
+ * Every thread records into its own counters, hence recording never takes a
+ * lock. When profiling is disabled a record costs a single relaxed load.
+ * Profiling is initially enabled if the environment variable DBOT_PROFILING
+ * is set to a value other than 0.
+ *
+ * The histograms have power of two buckets starting at one microsecond,
+ * the quantiles are the upper bounds of the buckets they fall into. While
+ * the TraceRecorder is recording, the timed stages are traced as spans.
+ */
+class Profiler
+{
+public:
+    typedef TraceRecorder::Clock Clock;
+
+    static constexpr int stage_count = int(ProfileStage::Count);
+
+    /** \brief Upper bound of bucket i is 2^i microseconds, the last bucket
+     *         takes everything above */
+    static constexpr int bucket_count = 32;
+
+    /**
+     * \brief Merged histogram of one stage over all threads
+     */
+    struct Histogram
+    {
+        std::uint64_t count = 0;
+        double sum = 0;
+        double max = 0;
+        std::array<std::uint64_t, bucket_count> buckets{};
+
+        double mean() const { return count > 0 ? sum / count : 0; }
+
+        /** \brief Estimate of the q quantile in seconds, q in [0, 1] */
+        double quantile(double q) const;
+    };
+
+    typedef std::array<Histogram, stage_count> Snapshot;
+
+public:
+    static bool enabled()
+    {
+        return enabled_flag().load(std::memory_order_relaxed);
+    }
+
+    static void set_enabled(bool enabled);
+
+    /**
+     * \brief Whether stages have to be timed, either for the histograms or
+     *        for the trace
+     */
+    static bool active() { return enabled() || TraceRecorder::recording(); }
+
+    /**
+     * \brief Adds a duration in seconds to the histogram of the stage
+     */
+    static void record(ProfileStage stage, double seconds)
+    {
+        if (enabled()) add(stage, seconds);
+    }
+
+    /**
+     * \brief Adds the duration to the histogram of the stage and traces it
+     *        as a span of the calling thread
+     */
+    static void record(ProfileStage stage,
+                       Clock::time_point begin,
+                       Clock::time_point end);
+
+    /**
+     * \brief Clears the histograms of all threads
+     */
+    static void reset();
+
+    /**
+     * \brief Histograms of all stages, merged over all threads including
+     *        the ones which have finished
+     */
+    static Snapshot snapshot();
+
+    static const char* stage_name(ProfileStage stage);
+
+    /**
+     * \brief Snapshot as a JSON object holding count, sum, mean, max, p50,
+     *        p90 and p99 in seconds and the bucket counts of every stage
+     */
+    static std::string to_json();
+
+    /**
+     * \brief Snapshot in the Prometheus text format, as the histogram
+     *        dbot_stage_duration_seconds labelled by stage
+     */
+    static std::string to_prometheus();
+
+    /** \brief Upper bound of bucket i in seconds */
+    static double bucket_bound(int i);
+
+    /** \brief Bucket a duration in seconds falls into */
+    static int bucket_index(double seconds);
+
+private:
+    static std::atomic<bool>& enabled_flag();
+    static void add(ProfileStage stage, double seconds);
+};
+
+/**
+ * \brief Records the time from its construction to its destruction into
+ *        a stage. The clock is not read while profiling and tracing are
+ *        disabled.
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileStage stage)
+        : stage_(stage), running_(Profiler::active())
+    {
+        if (running_) start_ = Profiler::Clock::now();
+    }
+
+    ~ProfileScope()
+    {
+        if (running_) Profiler::record(stage_, start_, Profiler::Clock::now());
+    }
+
+private:
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+
+private:
+    ProfileStage stage_;
+    bool running_;
+    Profiler::Clock::time_point start_;
+};
+
+/**
+ * \brief Times consecutive stages of a sequence, every lap() records the
+ *        time since the previous lap or the restart
+ */
+class ProfileStopwatch
+{
+public:
+    ProfileStopwatch() : running_(false) {}
+
+    void restart()
+    {
+        running_ = Profiler::active();
+        if (running_) last_ = Profiler::Clock::now();
+    }
+
+    void lap(ProfileStage stage)
+    {
+        if (!running_) return;
+        const Profiler::Clock::time_point now = Profiler::Clock::now();
+        Profiler::record(stage, last_, now);
+        last_ = now;
+    }
+
+    /** \brief Stops recording until the next restart */
+    void stop() { running_ = false; }
+
+private:
+    bool running_;
+    Profiler::Clock::time_point last_;
+};
+}
@@ -0,0 +1,101 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file profiler_test.cpp
+ */
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <dbot/profiler.h>
+
+using dbot::ProfileStage;
+using dbot::Profiler;
+
+TEST(ProfilerTests, buckets_are_powers_of_two_microseconds)
+{
+    EXPECT_EQ(Profiler::bucket_index(0), 0);
+    EXPECT_EQ(Profiler::bucket_index(1e-6), 0);
+    EXPECT_EQ(Profiler::bucket_index(1.5e-6), 1);
+    EXPECT_EQ(Profiler::bucket_index(2e-6), 1);
+    EXPECT_EQ(Profiler::bucket_index(3e-6), 2);
+    EXPECT_EQ(Profiler::bucket_index(1e4), Profiler::bucket_count - 1);
+    EXPECT_DOUBLE_EQ(Profiler::bucket_bound(3), 8e-6);
+}
+
+TEST(ProfilerTests, nothing_is_recorded_when_disabled)
+{
+    Profiler::set_enabled(false);
+    Profiler::reset();
+    Profiler::record(ProfileStage::Render, 0.01);
+    {
+        dbot::ProfileScope scope(ProfileStage::Render);
+    }
+
+    EXPECT_EQ(Profiler::snapshot()[int(ProfileStage::Render)].count, 0u);
+}
+
+TEST(ProfilerTests, histograms_are_merged_over_threads)
+{
+    Profiler::set_enabled(true);
+    Profiler::reset();
+
+    Profiler::record(ProfileStage::Weigh, 0.001);
+    std::thread worker([]() {
+        for (int i = 0; i < 99; i++)
+        {
+            Profiler::record(ProfileStage::Weigh, 0.0001);
+        }
+    });
+    worker.join();
+
+    const Profiler::Histogram weigh =
+        Profiler::snapshot()[int(ProfileStage::Weigh)];
+    EXPECT_EQ(weigh.count, 100u);
+    EXPECT_NEAR(weigh.sum, 0.001 + 99 * 0.0001, 1e-9);
+    EXPECT_DOUBLE_EQ(weigh.max, 0.001);
+
+    // 100 us falls into the bucket up to 128 us, the maximum caps p100
+    EXPECT_DOUBLE_EQ(weigh.quantile(0.5), 128e-6);
+    EXPECT_DOUBLE_EQ(weigh.quantile(1.0), 0.001);
+
+    Profiler::reset();
+    EXPECT_EQ(Profiler::snapshot()[int(ProfileStage::Weigh)].count, 0u);
+    Profiler::set_enabled(false);
+}
+
+TEST(ProfilerTests, exports_name_every_stage)
+{
+    Profiler::set_enabled(true);
+    Profiler::reset();
+    Profiler::record(ProfileStage::Frame, 0.03);
+    Profiler::set_enabled(false);
+
+    const std::string json = Profiler::to_json();
+    const std::string prometheus = Profiler::to_prometheus();
+    for (int i = 0; i < Profiler::stage_count; i++)
+    {
+        const std::string name = Profiler::stage_name(ProfileStage(i));
+        EXPECT_NE(json.find("\"" + name + "\""), std::string::npos);
+        EXPECT_NE(prometheus.find("stage=\"" + name + "\""),
+                  std::string::npos);
+    }
+    EXPECT_NE(json.find("\"frame\":{\"count\":1,"), std::string::npos);
+    EXPECT_NE(prometheus.find("dbot_stage_duration_seconds_count{"
+                              "stage=\"frame\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(prometheus.find("stage=\"frame\",le=\"+Inf\"} 1\n"),
+              std::string::npos);
+}
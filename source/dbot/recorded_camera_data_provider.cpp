@@ -0,0 +1,128 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file recorded_camera_data_provider.cpp
+ */
+
+#include <iostream>
+#include <thread>
+
+#include <dbot/recorded_camera_data_provider.h>
+
+namespace dbot
+{
+RecordedCameraDataProvider::RecordedCameraDataProvider(
+    const std::shared_ptr<const DepthStream>& stream,
+    int downsampling_factor,
+    Playback playback,
+    bool loop)
+    : stream_(stream),
+      downsampling_factor_(downsampling_factor),
+      playback_(playback),
+      loop_(loop),
+      frame_(0),
+      frame_number_(1)
+{
+    if (!stream_ || stream_->frame_count() == 0)
+    {
+        std::cout << "RecordedCameraDataProvider: the stream has no frames"
+                  << std::endl;
+        exit(-1);
+    }
+
+    rows_ = stream_->resolution().height / downsampling_factor_;
+    cols_ = stream_->resolution().width / downsampling_factor_;
+    depth_.resize(rows_ * cols_);
+    decode_frame();
+    playback_start_ = Clock::now();
+}
+
+bool RecordedCameraDataProvider::next_frame()
+{
+    if (frame_ + 1 < stream_->frame_count())
+    {
+        frame_++;
+    }
+    else if (loop_)
+    {
+        frame_ = 0;
+        playback_start_ = Clock::now();
+    }
+    else
+    {
+        return false;
+    }
+
+    if (playback_ == Playback::RecordedSpeed)
+    {
+        const double offset =
+            stream_->timestamp(frame_) - stream_->timestamp(0);
+        std::this_thread::sleep_until(
+            playback_start_ +
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(offset)));
+    }
+
+    decode_frame();
+    frame_number_++;
+    return true;
+}
+
+void RecordedCameraDataProvider::decode_frame()
+{
+    stream_->decode(frame_, downsampling_factor_, depth_.data());
+}
+
+Eigen::MatrixXd RecordedCameraDataProvider::depth_image() const
+{
+    return Eigen::Map<const Eigen::Matrix<float,
+                                          Eigen::Dynamic,
+                                          Eigen::Dynamic,
+                                          Eigen::RowMajor>>(
+               depth_.data(), rows_, cols_)
+        .cast<double>();
+}
+
+Eigen::VectorXd RecordedCameraDataProvider::depth_image_vector() const
+{
+    return depth_.cast<double>();
+}
+
+DepthImageView RecordedCameraDataProvider::depth_image_view() const
+{
+    return DepthImageView(depth_.data(), depth_.size());
+}
+
+Eigen::Matrix3d RecordedCameraDataProvider::camera_matrix() const
+{
+    Eigen::Matrix3d camera_matrix = stream_->camera_matrix();
+    camera_matrix.topRows(2) /= downsampling_factor_;
+    return camera_matrix;
+}
+
+std::string RecordedCameraDataProvider::frame_id() const
+{
+    return stream_->frame_id();
+}
+
+int RecordedCameraDataProvider::downsampling_factor() const
+{
+    return downsampling_factor_;
+}
+
+CameraData::Resolution RecordedCameraDataProvider::native_resolution() const
+{
+    return stream_->resolution();
+}
+}
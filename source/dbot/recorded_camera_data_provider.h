@@ -0,0 +1,114 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file recorded_camera_data_provider.h
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <Eigen/Dense>
+
+#include <dbot/camera_data_provider.h>
+#include <dbot/depth_stream.h>
+
+namespace dbot
+{
+/**
+ * \brief Plays back a recorded DepthStream, e.g. for reproducible
+ *        benchmarks and regression runs.
+ *
+ * The provider serves the current frame until next_frame() is called. The
+ * depth is decoded straight into a float buffer which depth_image_view()
+ * returns without copying.
+ */
+class RecordedCameraDataProvider : public CameraDataProvider
+{
+public:
+    enum class Playback
+    {
+        RecordedSpeed,  // next_frame() waits for the recorded frame time
+        MaximumSpeed    // next_frame() returns immediately
+    };
+
+public:
+    /**
+     * \brief Serves the first frame of the stream, which has to be open
+     *        and hold at least one frame
+     *
+     * \param loop  whether playback restarts after the last frame
+     */
+    RecordedCameraDataProvider(const std::shared_ptr<const DepthStream>& stream,
+                               int downsampling_factor,
+                               Playback playback = Playback::MaximumSpeed,
+                               bool loop = false);
+
+    virtual ~RecordedCameraDataProvider() {}
+
+    /**
+     * \brief Advances to the next frame. Returns false at the end of a
+     *        stream which is not looped, the last frame is kept then.
+     */
+    bool next_frame();
+
+    /** \brief Index of the current frame in the stream */
+    std::size_t frame_index() const { return frame_; }
+
+    /** \brief Recording time of the current frame in seconds */
+    double timestamp() const { return stream_->timestamp(frame_); }
+
+    /** \brief Ground truth poses of the objects in the current frame */
+    DepthStream::Poses ground_truth() const { return stream_->poses(frame_); }
+
+    const std::shared_ptr<const DepthStream>& stream() const
+    {
+        return stream_;
+    }
+
+    virtual Eigen::MatrixXd depth_image() const;
+    virtual Eigen::VectorXd depth_image_vector() const;
+    virtual DepthImageView depth_image_view() const;
+    virtual Eigen::Matrix3d camera_matrix() const;
+    virtual std::string frame_id() const;
+    virtual int downsampling_factor() const;
+    virtual CameraData::Resolution native_resolution() const;
+
+    /** \brief Counts the frames served, also across loops */
+    virtual std::uint64_t frame_number() const { return frame_number_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void decode_frame();
+
+private:
+    std::shared_ptr<const DepthStream> stream_;
+    int downsampling_factor_;
+    Playback playback_;
+    bool loop_;
+
+    std::size_t frame_;
+    std::uint64_t frame_number_;
+    int rows_;
+    int cols_;
+    Eigen::VectorXf depth_;
+
+    // wall time at which the first frame of the playback was served
+    Clock::time_point playback_start_;
+};
+}
@@ -17,18 +17,67 @@
  */
 
 #include <dbot/rigid_body_renderer.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <limits>
+#include <map>
 
 using namespace std;
 using namespace Eigen;
 
 using namespace dbot;
 
+namespace
+{
+// side length of the square pixel blocks of the coarse depth buffer
+const int block_size = 8;
+
+// triangles with a vertex closer to the camera plane than this are dropped
+const float min_vertex_depth = 0.001f;
+
+/**
+ * \brief Whether every directed edge of the mesh is matched by exactly one
+ *        opposite edge and the enclosed volume is positive, i.e. whether
+ *        the triangles form a closed surface with outward normals.
+ */
+bool is_closed_outward(const FlatMesh& mesh, int part)
+{
+    map<pair<int, int>, int> edges;
+    double volume = 0;
+    for (int i = mesh.triangle_begin(part); i < mesh.triangle_end(part); i++)
+    {
+        const std::uint32_t* triangle = mesh.triangle(i);
+        for (int k = 0; k < 3; k++)
+        {
+            ++edges[make_pair(triangle[k], triangle[(k + 1) % 3])];
+        }
+        const Vector3d a = mesh.position(triangle[0]).cast<double>();
+        const Vector3d b = mesh.position(triangle[1]).cast<double>();
+        const Vector3d c = mesh.position(triangle[2]).cast<double>();
+        volume += a.dot(b.cross(c));
+    }
+
+    for (auto it = edges.begin(); it != edges.end(); ++it)
+    {
+        auto opposite =
+            edges.find(make_pair(it->first.second, it->first.first));
+        if (it->second != 1 || opposite == edges.end() ||
+            opposite->second != 1)
+        {
+            return false;
+        }
+    }
+    return volume > 0;
+}
+}
+
 RigidBodyRenderer::RigidBodyRenderer(
     const std::vector<std::vector<Eigen::Vector3d>>& vertices,
     const std::vector<std::vector<std::vector<int>>>& indices)
-    : n_rows_(0), n_cols_(0), vertices_(vertices), indices_(indices)
+    : n_rows_(0),
+      n_cols_(0),
+      levels_(std::make_shared<FlatMesh>(vertices, indices))
 {
     camera_matrix_.setZero();
     init();
@@ -43,8 +92,26 @@ RigidBodyRenderer::RigidBodyRenderer(
     : camera_matrix_(camera_matrix),
       n_rows_(n_rows),
       n_cols_(n_cols),
-      vertices_(vertices),
-      indices_(indices)
+      levels_(std::make_shared<FlatMesh>(vertices, indices))
+{
+    init();
+}
+
+RigidBodyRenderer::RigidBodyRenderer(const MeshLevels& levels)
+    : n_rows_(0), n_cols_(0), levels_(levels)
+{
+    camera_matrix_.setZero();
+    init();
+}
+
+RigidBodyRenderer::RigidBodyRenderer(const MeshLevels& levels,
+                                     Matrix camera_matrix,
+                                     int n_rows,
+                                     int n_cols)
+    : camera_matrix_(camera_matrix),
+      n_rows_(n_rows),
+      n_cols_(n_cols),
+      levels_(levels)
 {
     init();
 }
@@ -52,8 +119,9 @@ RigidBodyRenderer::RigidBodyRenderer(
 void RigidBodyRenderer::init()
 {
     /// initialize poses *******************************************************
-    R_.resize(vertices_.size());
-    t_.resize(vertices_.size());
+    const FlatMesh& mesh = levels_.level(0);
+    R_.resize(mesh.part_count());
+    t_.resize(mesh.part_count());
 
     for (size_t i = 0; i < R_.size(); i++)
     {
@@ -61,32 +129,39 @@ void RigidBodyRenderer::init()
         t_[i] = Vector::Zero();
     }
 
-    /// compute normals ********************************************************
-    normals_.clear();
-    for (size_t part_index = 0; part_index < indices_.size(); part_index++)
+    normals_.resize(levels_.level_count());
+    closed_parts_.resize(levels_.level_count());
+    for (int level = 0; level < levels_.level_count(); level++)
     {
-        vector<Vector3d> part_normals(indices_[part_index].size());
-        for (int triangle_index = 0; triangle_index < int(part_normals.size());
+        const FlatMesh& level_mesh = levels_.level(level);
+
+        /// compute normals ****************************************************
+        std::vector<Vector>& normals = normals_[level];
+        normals.resize(level_mesh.triangle_count());
+        for (int triangle_index = 0;
+             triangle_index < level_mesh.triangle_count();
              triangle_index++)
         {
+            const std::uint32_t* triangle = level_mesh.triangle(triangle_index);
+            Vector3d corners[3];
+            for (int i = 0; i < 3; i++)
+            {
+                corners[i] = level_mesh.position(triangle[i]).cast<double>();
+            }
+
             // compute the three cross products and make sure that they yield
-            // the same normal
-            vector<Vector3d> temp_normals(3);
+            // the same normal. The decimated levels contain no degenerate
+            // triangles by construction and are not checked.
+            Vector3d temp_normals[3];
             for (int vertex_index = 0; vertex_index < 3; vertex_index++)
                 temp_normals[vertex_index] =
-                    ((vertices_[part_index][indices_[part_index][triangle_index]
-                                                    [(vertex_index + 1) % 3]] -
-                      vertices_[part_index][indices_[part_index][triangle_index]
-                                                    [vertex_index]])
-                         .cross(vertices_[part_index]
-                                         [indices_[part_index][triangle_index]
-                                                  [(vertex_index + 2) % 3]] -
-                                vertices_[part_index]
-                                         [indices_[part_index][triangle_index]
-                                                  [(vertex_index + 1) % 3]]))
+                    ((corners[(vertex_index + 1) % 3] - corners[vertex_index])
+                         .cross(corners[(vertex_index + 2) % 3] -
+                                corners[(vertex_index + 1) % 3]))
                         .normalized();
 
-            for (int vertex_index = 0; vertex_index < 3; vertex_index++)
+            for (int vertex_index = 0; level == 0 && vertex_index < 3;
+                 vertex_index++)
                 if (!temp_normals[vertex_index].isApprox(
                         temp_normals[(vertex_index + 1) % 3]))
                 {
@@ -99,9 +174,17 @@ void RigidBodyRenderer::init()
                          << temp_normals[(vertex_index + 1) % 3] << endl;
                     exit(-1);
                 }
-            part_normals[triangle_index] = temp_normals[0];
+            normals[triangle_index] = temp_normals[0];
+        }
+
+        /// find the parts which allow back-face culling ***********************
+        closed_parts_[level].resize(level_mesh.part_count());
+        for (int part_index = 0; part_index < level_mesh.part_count();
+             part_index++)
+        {
+            closed_parts_[level][part_index] =
+                is_closed_outward(level_mesh, part_index);
         }
-        normals_.push_back(part_normals);
     }
 }
 
@@ -109,225 +192,473 @@ RigidBodyRenderer::~RigidBodyRenderer()
 {
 }
 
-// todo: does not handle the case properly when the depth is around zero or
-// negative
 void RigidBodyRenderer::Render(Matrix camera_matrix,
                                int n_rows,
                                int n_cols,
                                std::vector<float>& depth_image) const
 {
-    Matrix3d inv_camera_matrix = camera_matrix.inverse();
+    RenderScratch scratch;
+    depth_image.resize(n_rows * n_cols);
+    render(R_, t_, camera_matrix, n_rows, n_cols, depth_image.data(), scratch);
+}
+
+void RigidBodyRenderer::Render(Matrix camera_matrix,
+                               int n_rows,
+                               int n_cols,
+                               std::vector<int>& intersect_indices,
+                               std::vector<float>& depth) const
+{
+    RenderScratch scratch;
+    render_tile(R_, t_, camera_matrix, n_rows, n_cols, scratch.tile, scratch);
+
+    intersect_indices.clear();
+    depth.clear();
+    append(scratch.tile.data(), scratch, n_cols, intersect_indices, depth);
+}
+
+void RigidBodyRenderer::Render(const std::vector<Affine>& poses,
+                               const Matrix& camera_matrix,
+                               int n_rows,
+                               int n_cols,
+                               std::vector<float>& depth_image) const
+{
+    RenderScratch scratch;
+    split_poses(poses, scratch);
+    depth_image.resize(n_rows * n_cols);
+    render(scratch.R,
+           scratch.t,
+           camera_matrix,
+           n_rows,
+           n_cols,
+           depth_image.data(),
+           scratch);
+}
+
+void RigidBodyRenderer::Render(const std::vector<Affine>& poses,
+                               const Matrix& camera_matrix,
+                               int n_rows,
+                               int n_cols,
+                               std::vector<int>& intersect_indices,
+                               std::vector<float>& depth,
+                               std::vector<float>& depth_image) const
+{
+    // only the tile of the image covered by the parts is rendered
+    RenderScratch scratch;
+    split_poses(poses, scratch);
+    render_tile(scratch.R,
+                scratch.t,
+                camera_matrix,
+                n_rows,
+                n_cols,
+                depth_image,
+                scratch);
+
+    intersect_indices.clear();
+    depth.clear();
+    append(depth_image.data(), scratch, n_cols, intersect_indices, depth);
+}
+
+void RigidBodyRenderer::RenderBatch(
+    const std::vector<std::vector<Affine>>& poses,
+    const Matrix& camera_matrix,
+    int n_rows,
+    int n_cols,
+    std::vector<float>& depth_images) const
+{
+    depth_images.resize(poses.size() * n_rows * n_cols);
+    RenderBatch(poses, camera_matrix, n_rows, n_cols, depth_images.data());
+}
+
+void RigidBodyRenderer::RenderBatch(
+    const std::vector<std::vector<Affine>>& poses,
+    const Matrix& camera_matrix,
+    int n_rows,
+    int n_cols,
+    float* depth_images) const
+{
+    // the scratch memory is shared among all hypotheses of the batch
+    RenderScratch scratch;
+
+    const size_t pixel_count = size_t(n_rows) * n_cols;
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        split_poses(poses[i], scratch);
+        render(scratch.R,
+               scratch.t,
+               camera_matrix,
+               n_rows,
+               n_cols,
+               depth_images + i * pixel_count,
+               scratch);
+    }
+}
 
-    // we project all the points into image space
+void RigidBodyRenderer::RenderSparse(
+    const std::vector<std::vector<Affine>>& poses,
+    const Matrix& camera_matrix,
+    int n_rows,
+    int n_cols,
+    SparseDepthImages& images) const
+{
+    images.clear();
+
+    RenderScratch scratch;
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        split_poses(poses[i], scratch);
+        render_tile(scratch.R,
+                    scratch.t,
+                    camera_matrix,
+                    n_rows,
+                    n_cols,
+                    scratch.tile,
+                    scratch);
+        append(scratch.tile.data(),
+               scratch,
+               n_cols,
+               images.indices,
+               images.depths);
+        images.offsets.push_back(images.indices.size());
+    }
+}
+
+void RigidBodyRenderer::split_poses(const std::vector<Affine>& poses,
+                                    RenderScratch& scratch) const
+{
+    scratch.R.resize(poses.size());
+    scratch.t.resize(poses.size());
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        scratch.R[i] = poses[i].rotation();
+        scratch.t[i] = poses[i].translation();
+    }
+}
+
+void RigidBodyRenderer::append(const float* tile,
+                               const RenderScratch& scratch,
+                               int n_cols,
+                               std::vector<int>& intersect_indices,
+                               std::vector<float>& depth)
+{
+    // fill the depths into the depth vector -------------------------------
+    const size_t tile_size = scratch.tile_rows * scratch.tile_cols;
+    size_t count = intersect_indices.size();
+    intersect_indices.resize(count + tile_size);
+    depth.resize(count + tile_size);
+    for (int row = 0; row < scratch.tile_rows; row++)
+    {
+        const float* line = tile + row * scratch.tile_cols;
+        const int first_pixel =
+            (scratch.tile_row + row) * n_cols + scratch.tile_col;
+        for (int col = 0; col < scratch.tile_cols; col++)
+        {
+            if (line[col] != numeric_limits<float>::infinity())
+            {
+                intersect_indices[count] = first_pixel + col;
+                depth[count] = line[col];
+                count++;
+            }
+        }
+    }
+    intersect_indices.resize(count);
+    depth.resize(count);
+}
+
+void RigidBodyRenderer::render(const std::vector<Matrix>& R,
+                               const std::vector<Vector>& t,
+                               const Matrix& camera_matrix,
+                               int n_rows,
+                               int n_cols,
+                               float* depth_image,
+                               RenderScratch& scratch) const
+{
+    render_tile(R, t, camera_matrix, n_rows, n_cols, scratch.tile, scratch);
+
+    std::fill(depth_image,
+              depth_image + n_rows * n_cols,
+              numeric_limits<float>::infinity());
+    for (int row = 0; row < scratch.tile_rows; row++)
+    {
+        const float* line = scratch.tile.data() + row * scratch.tile_cols;
+        std::copy(line,
+                  line + scratch.tile_cols,
+                  depth_image + (scratch.tile_row + row) * n_cols +
+                      scratch.tile_col);
+    }
+}
+
+// todo: does not handle the case properly when the depth is around zero or
+// negative
+void RigidBodyRenderer::render_tile(const std::vector<Matrix>& R,
+                                    const std::vector<Vector>& t,
+                                    const Matrix& camera_matrix,
+                                    int n_rows,
+                                    int n_cols,
+                                    std::vector<float>& tile,
+                                    RenderScratch& scratch) const
+{
+    const float infinity = numeric_limits<float>::infinity();
+    const Matrix3f camera = camera_matrix.cast<float>();
+
+    // the inverse depth along the ray through (col, row) is affine in the
+    // pixel coordinates, ray_plane maps the normal of a plane to its
+    // coefficients
+    const Matrix3f ray_plane =
+        camera_matrix.inverse().transpose().cast<float>();
+
+    // each part is rendered with the level of detail which fits its
+    // projected size. Its vertices are stored at the place of the vertices
+    // of the part in the full mesh, a decimated part has fewer of them.
     // --------------------------------------------------------
-    vector<vector<Vector3d>> trans_vertices(vertices_.size());
-    vector<vector<Vector2d>> image_vertices(vertices_.size());
+    const FlatMesh& full_mesh = levels_.level(0);
+    const int part_count = full_mesh.part_count();
+    vector<int>& levels = scratch.levels;
+    levels.resize(part_count);
+    for (int part_index = 0; part_index < part_count; part_index++)
+    {
+        levels[part_index] = levels_.select(
+            part_index, R[part_index], t[part_index], camera_matrix);
+    }
 
-    for (int part_index = 0; part_index < int(vertices_.size()); part_index++)
+    // we project all the points into image space and find the tile which
+    // contains the vertices in front of the camera
+    // --------------------------------------------------------
+    vector<Vector3f>& trans_vertices = scratch.trans_vertices;
+    vector<Vector2f>& image_vertices = scratch.image_vertices;
+    trans_vertices.resize(full_mesh.vertex_count());
+    image_vertices.resize(full_mesh.vertex_count());
+
+    int min_row = n_rows;
+    int max_row = -1;
+    int min_col = n_cols;
+    int max_col = -1;
+    for (int part_index = 0; part_index < part_count; part_index++)
     {
-        image_vertices[part_index].resize(vertices_[part_index].size());
-        trans_vertices[part_index].resize(vertices_[part_index].size());
-        for (int point_index = 0;
-             point_index < int(vertices_[part_index].size());
+        const FlatMesh& mesh = levels_.level(levels[part_index]);
+        const int shift =
+            full_mesh.vertex_begin(part_index) - mesh.vertex_begin(part_index);
+        const Matrix3f part_R = R[part_index].cast<float>();
+        const Vector3f part_t = t[part_index].cast<float>();
+        for (int point_index = mesh.vertex_begin(part_index);
+             point_index < mesh.vertex_end(part_index);
              point_index++)
         {
-            trans_vertices[part_index][point_index] =
-                R_[part_index] * vertices_[part_index][point_index] +
-                t_[part_index];
-            image_vertices[part_index][point_index] =
-                (camera_matrix * trans_vertices[part_index][point_index] /
-                 trans_vertices[part_index][point_index](2))
-                    .topRows(2);
+            const Vector3f vertex =
+                part_R * mesh.position(point_index) + part_t;
+            const Vector2f image_vertex =
+                (camera * vertex / vertex(2)).topRows(2);
+            trans_vertices[point_index + shift] = vertex;
+            image_vertices[point_index + shift] = image_vertex;
+
+            if (vertex(2) < min_vertex_depth) continue;
+            min_col = std::min(min_col, int(std::ceil(image_vertex(0))));
+            max_col = std::max(max_col, int(std::floor(image_vertex(0))));
+            min_row = std::min(min_row, int(std::ceil(image_vertex(1))));
+            max_row = std::max(max_row, int(std::floor(image_vertex(1))));
         }
     }
 
+    scratch.tile_row = std::max(min_row, 0);
+    scratch.tile_col = std::max(min_col, 0);
+    scratch.tile_rows = std::max(std::min(max_row, n_rows - 1) + 1 -
+                                     scratch.tile_row,
+                                 0);
+    scratch.tile_cols = std::max(std::min(max_col, n_cols - 1) + 1 -
+                                     scratch.tile_col,
+                                 0);
+    if (scratch.tile_rows == 0 || scratch.tile_cols == 0)
+    {
+        scratch.tile_rows = 0;
+        scratch.tile_cols = 0;
+    }
+
+    const int tile_row = scratch.tile_row;
+    const int tile_col = scratch.tile_col;
+    const int tile_rows = scratch.tile_rows;
+    const int tile_cols = scratch.tile_cols;
+    tile.assign(tile_rows * tile_cols, infinity);
+
+    // the coarse depth buffer holds the maximum depth of each block, a
+    // triangle which is behind it cannot change any pixel of the block
+    const int block_cols = (tile_cols + block_size - 1) / block_size;
+    const int block_rows = (tile_rows + block_size - 1) / block_size;
+    vector<float>& block_depths = scratch.block_depths;
+    block_depths.assign(block_rows * block_cols, infinity);
+
     // we find the intersections with the triangles and the depths
     // ---------------------------------------------------
-    depth_image =
-        vector<float>(n_rows * n_cols, numeric_limits<float>::infinity());
-
-    for (int part_index = 0; part_index < int(indices_.size()); part_index++)
+    for (int part_index = 0; part_index < part_count; part_index++)
     {
-        for (int triangle_index = 0;
-             triangle_index < int(indices_[part_index].size());
+        const int level = levels[part_index];
+        const FlatMesh& mesh = levels_.level(level);
+        const int shift =
+            full_mesh.vertex_begin(part_index) - mesh.vertex_begin(part_index);
+        const bool closed = closed_parts_[level][part_index];
+        for (int triangle_index = mesh.triangle_begin(part_index);
+             triangle_index < mesh.triangle_end(part_index);
              triangle_index++)
         {
-            vector<Vector2d> vertices(3);
-            Vector2d center(Vector2d::Zero());
-
-            // find the min and max indices to be checked
-            // ------------------------------------------------------------
-            int min_row = numeric_limits<int>::max();
-            int max_row = -numeric_limits<int>::max();
-            int min_col = numeric_limits<int>::max();
-            int max_col = -numeric_limits<int>::max();
-            bool behind_camera = false;
+            const std::uint32_t* triangle = mesh.triangle(triangle_index);
+            const Vector3f* vertices[3];
+            Vector2f points[3];
             for (int i = 0; i < 3; i++)
             {
-                vertices[i] =
-                    image_vertices[part_index]
-                                  [indices_[part_index][triangle_index][i]];
-                center += vertices[i] / 3.;
-                min_row = ceil(float(vertices[i](1))) < min_row
-                              ? ceil(float(vertices[i](1)))
-                              : min_row;
-                max_row = floor(float(vertices[i](1))) > max_row
-                              ? floor(float(vertices[i](1)))
-                              : max_row;
-                min_col = ceil(float(vertices[i](0))) < min_col
-                              ? ceil(float(vertices[i](0)))
-                              : min_col;
-                max_col = floor(float(vertices[i](0))) > max_col
-                              ? floor(float(vertices[i](0)))
-                              : max_col;
-
-                // how should this be handled properly? for now if some vertex
-                // in a triangle comes to lie behind camera
-                // we just discard that triangle.
-                if (trans_vertices[part_index]
-                                  [indices_[part_index][triangle_index][i]](2) <
-                    0.001)
-                    behind_camera = true;
+                vertices[i] = &trans_vertices[triangle[i] + shift];
+                points[i] = image_vertices[triangle[i] + shift];
             }
-            if (behind_camera) continue;
 
-            // make sure all of them are inside of image
-            // -----------------------------------------------------------------
-            min_row = min_row >= 0 ? min_row : 0;
-            max_row = max_row < n_rows ? max_row : (n_rows - 1);
-            min_col = min_col >= 0 ? min_col : 0;
-            max_col = max_col < n_cols ? max_col : (n_cols - 1);
-
-            // check whether triangle is inside image
-            // ----------------------------------------------------------------------
-            if (max_row < 0 || min_row >= n_rows || max_col < 0 ||
-                min_col >= n_cols || max_row < min_row || max_col < min_col)
-                continue;
-
-            // we find the line params of the triangle sides
+            // how should this be handled properly? for now if some vertex
+            // in a triangle comes to lie behind camera we just discard that
+            // triangle.
+            const float min_depth =
+                std::min((*vertices[0])(2),
+                         std::min((*vertices[1])(2), (*vertices[2])(2)));
+            if (min_depth < min_vertex_depth) continue;
+
+            // the camera looks at the inside of a closed surface through
+            // the triangles which face away from it, they are always hidden
+            const Vector3f normal =
+                (R[part_index] * normals_[level][triangle_index])
+                    .cast<float>();
+            const float offset = normal.dot(*vertices[0]);
+            if (closed && offset >= 0) continue;
+            const Vector3f plane = ray_plane * normal;
+
+            // edge functions which are non-negative inside of the triangle
             // ---------------------------------------------------------------
-            vector<float> slopes(3);
-            vector<bool> boundary_type(3);
-            const bool upper = true;
-            const bool lower = false;
-
+            const float area = (points[1] - points[0]).x() *
+                                   (points[2] - points[0]).y() -
+                               (points[1] - points[0]).y() *
+                                   (points[2] - points[0]).x();
+            if (area == 0) continue;  // if triangle is degenerate we continue
+            const float orientation = area > 0 ? 1.f : -1.f;
+
+            float edge_x[3];
+            float edge_y[3];
             for (int i = 0; i < 3; i++)
             {
-                Vector2d side = vertices[(i + 1) % 3] - vertices[i];
-                slopes[i] = side(1) / side(0);
-
-                // we determine whether the line limits the triangle on top or
-                // on the bottom
-                if (vertices[i](1) + slopes[i] * (center(0) - vertices[i](0)) >
-                    center(1))
-                    boundary_type[i] = upper;
-                else
-                    boundary_type[i] = lower;
+                const Vector2f side = points[(i + 1) % 3] - points[i];
+                edge_x[i] = orientation * side.x();
+                edge_y[i] = orientation * side.y();
             }
 
-            if (boundary_type[0] == boundary_type[1] &&
-                boundary_type[0] ==
-                    boundary_type[2])  // if triangle is degenerate we continue
-                continue;
-
-            for (int col = min_col; col <= max_col; col++)
+            // make sure all of them are inside of the tile
+            // -----------------------------------------------------------------
+            const int first_col = std::max(
+                int(std::ceil(std::min(
+                    points[0].x(), std::min(points[1].x(), points[2].x())))),
+                tile_col);
+            const int last_col = std::min(
+                int(std::floor(std::max(
+                    points[0].x(), std::max(points[1].x(), points[2].x())))),
+                tile_col + tile_cols - 1);
+            const int first_row = std::max(
+                int(std::ceil(std::min(
+                    points[0].y(), std::min(points[1].y(), points[2].y())))),
+                tile_row);
+            const int last_row = std::min(
+                int(std::floor(std::max(
+                    points[0].y(), std::max(points[1].y(), points[2].y())))),
+                tile_row + tile_rows - 1);
+            if (last_col < first_col || last_row < first_row) continue;
+
+            for (int block_row = (first_row - tile_row) / block_size;
+                 block_row <= (last_row - tile_row) / block_size;
+                 block_row++)
             {
-                float min_row_given_col = -numeric_limits<float>::max();
-                float max_row_given_col = numeric_limits<float>::max();
-
-                // the min_row is the max lower boundary at that column, and the
-                // max_row is the min upper boundary at that column
-                for (int i = 0; i < 3; i++)
+                const int block_first_row = tile_row + block_row * block_size;
+                const int block_last_row =
+                    std::min(block_first_row + block_size,
+                             tile_row + tile_rows) -
+                    1;
+                const int row_begin = std::max(first_row, block_first_row);
+                const int row_end = std::min(last_row, block_last_row);
+
+                for (int block_col = (first_col - tile_col) / block_size;
+                     block_col <= (last_col - tile_col) / block_size;
+                     block_col++)
                 {
-                    if (boundary_type[i] == lower)
+                    float& block_depth =
+                        block_depths[block_row * block_cols + block_col];
+                    if (min_depth >= block_depth) continue;
+
+                    const int block_first_col =
+                        tile_col + block_col * block_size;
+                    const int block_last_col =
+                        std::min(block_first_col + block_size,
+                                 tile_col + tile_cols) -
+                        1;
+                    const int col_begin = std::max(first_col, block_first_col);
+                    const int col_end = std::min(last_col, block_last_col);
+
+                    // the block is skipped if it is entirely outside of one
+                    // edge, i.e. if the edge function is negative at the
+                    // corner where it is largest
+                    bool outside = false;
+                    for (int i = 0; i < 3; i++)
                     {
-                        float lowe_Rboundary = ceil(
-                            float(vertices[i](1) +
-                                  slopes[i] * (float(col) - vertices[i](0))));
-                        min_row_given_col = lowe_Rboundary > min_row_given_col
-                                                ? lowe_Rboundary
-                                                : min_row_given_col;
+                        const float col = -edge_y[i] > 0 ? col_end : col_begin;
+                        const float row = edge_x[i] > 0 ? row_end : row_begin;
+                        outside |= edge_x[i] * (row - points[i].y()) -
+                                       edge_y[i] * (col - points[i].x()) <
+                                   0;
                     }
-                    else
+                    if (outside) continue;
+
+                    // the pixels within the block, the inner loop combines
+                    // the tests with masks and stores through a select. It
+                    // has no control flow, GCC vectorizes it at -O3 but not
+                    // with the cheap cost model of -O2
+                    int covered = 0;
+                    for (int row = row_begin; row <= row_end; row++)
                     {
-                        float upper_boundary = floor(
-                            float(vertices[i](1) +
-                                  slopes[i] * (float(col) - vertices[i](0))));
-                        max_row_given_col = upper_boundary < max_row_given_col
-                                                ? upper_boundary
-                                                : max_row_given_col;
+                        float* line = tile.data() +
+                                      (row - tile_row) * tile_cols;
+                        const float row_0 = edge_x[0] * (row - points[0].y());
+                        const float row_1 = edge_x[1] * (row - points[1].y());
+                        const float row_2 = edge_x[2] * (row - points[2].y());
+                        const float row_plane = plane(1) * row + plane(2);
+
+                        for (int col = col_begin; col <= col_end; col++)
+                        {
+                            const float e0 =
+                                row_0 - edge_y[0] * (col - points[0].x());
+                            const float e1 =
+                                row_1 - edge_y[1] * (col - points[1].x());
+                            const float e2 =
+                                row_2 - edge_y[2] * (col - points[2].x());
+                            const float depth = std::fabs(
+                                offset / (row_plane + plane(0) * col));
+                            const float stored = line[col - tile_col];
+                            const int inside = (e0 >= 0) & (e1 >= 0) &
+                                               (e2 >= 0) & (depth < stored);
+                            line[col - tile_col] = inside ? depth : stored;
+                            covered |= inside;
+                        }
                     }
-                }
+                    if (!covered) continue;
 
-                // we push back the indices of the intersections and the
-                // corresponding depths ------------------------------------
-                Vector3d normal =
-                    R_[part_index] * normals_[part_index][triangle_index];
-                float offset = normal.dot(
-                    trans_vertices[part_index]
-                                  [indices_[part_index][triangle_index][0]]);
-                for (int row = int(min_row_given_col);
-                     row <= int(max_row_given_col);
-                     row++)
-                    if (row >= 0 && row < n_rows && col >= 0 && col < n_cols)
+                    // update the coarse depth of the block
+                    float max_depth = 0;
+                    for (int row = block_first_row; row <= block_last_row;
+                         row++)
                     {
-                        //						intersec_tindices.push_back(row*n_cols
-                        //+
-                        // col);
-                        // we find the intersection between the ray and the
-                        // triangle --------------------------------------------
-                        Vector3d line_vector =
-                            inv_camera_matrix *
-                            Vector3d(
-                                col, row, 1);  // the depth is the z component
-                        float depth =
-                            std::fabs(offset / normal.dot(line_vector));
-                        // if(depth > 0.5)
-                        depth_image[row * n_cols + col] =
-                            depth < depth_image[row * n_cols + col]
-                                ? depth
-                                : depth_image[row * n_cols + col];
+                        const float* line =
+                            tile.data() + (row - tile_row) * tile_cols;
+                        for (int col = block_first_col; col <= block_last_col;
+                             col++)
+                        {
+                            max_depth =
+                                std::max(max_depth, line[col - tile_col]);
+                        }
                     }
+                    block_depth = max_depth;
+                }
             }
         }
     }
 }
 
-// todo: does not handle the case properly when the depth is around zero or
-// negative
-void RigidBodyRenderer::Render(Matrix camera_matrix,
-                               int n_rows,
-                               int n_cols,
-                               std::vector<int>& intersect_indices,
-                               std::vector<float>& depth) const
-{
-    vector<float> depth_image;
-
-    Render(camera_matrix, n_rows, n_cols, depth_image);
-
-    // fill the depths into the depth vector -------------------------------
-    intersect_indices.clear();
-    depth.clear();
-    intersect_indices.resize(n_rows * n_cols);
-    depth.resize(n_rows * n_cols);
-    int count = 0;
-    for (int row = 0; row < n_rows; row++)
-    {
-        for (int col = 0; col < n_cols; col++)
-        {
-            if (depth_image[row * n_cols + col] !=
-                numeric_limits<float>::infinity())
-            {
-                intersect_indices[count] = row * n_cols + col;
-                depth[count] = depth_image[row * n_cols + col];
-                count++;
-            }
-        }
-    }
-    intersect_indices.resize(count);
-    depth.resize(count);
-}
-
 void RigidBodyRenderer::Render(std::vector<float>& depth_image) const
 {
     assert(!camera_matrix_.isZero());
@@ -340,14 +671,15 @@ void RigidBodyRenderer::Render(std::vector<float>& depth_image) const
 std::vector<std::vector<RigidBodyRenderer::Vector>>
 RigidBodyRenderer::vertices() const
 {
-    vector<vector<Vector3d>> trans_vertices(vertices_.size());
+    const FlatMesh& mesh = levels_.level(0);
+    vector<vector<Vector3d>> trans_vertices(mesh.part_count());
 
-    for (int o = 0; o < int(vertices_.size()); o++)
+    for (int o = 0; o < mesh.part_count(); o++)
     {
-        trans_vertices[o].resize(vertices_[o].size());
-        for (int p = 0; p < int(vertices_[o].size()); p++)
+        for (int p = mesh.vertex_begin(o); p < mesh.vertex_end(o); p++)
         {
-            trans_vertices[o][p] = R_[o] * vertices_[o][p] + t_[o];
+            trans_vertices[o].push_back(
+                R_[o] * mesh.position(p).cast<double>() + t_[o]);
         }
     }
     return trans_vertices;
@@ -14,12 +14,61 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <dbot/flat_mesh.h>
+#include <dbot/mesh_levels.h>
 #include <dbot/pose/rigid_bodies_state.h>
+#include <limits>
 #include <memory>
 #include <vector>
 
 namespace dbot
 {
+/**
+ * \brief Depth renderings of a batch of poses which only hold the pixels
+ *        covered by the object, in compressed sparse row layout.
+ *
+ * Rendering i consists of the pixels indices[k] at depths[k] for
+ * offsets[i] <= k < offsets[i + 1], in ascending pixel order.
+ */
+struct SparseDepthImages
+{
+    SparseDepthImages() : offsets(1, 0) {}
+
+    /** \brief Removes all renderings but keeps the memory */
+    void clear()
+    {
+        offsets.assign(1, 0);
+        indices.clear();
+        depths.clear();
+    }
+
+    int size() const { return int(offsets.size()) - 1; }
+    int begin(int i) const { return offsets[i]; }
+    int end(int i) const { return offsets[i + 1]; }
+    int count(int i) const { return end(i) - begin(i); }
+
+    /**
+     * \brief Depth of the pixel in rendering i or infinity if the pixel is
+     *        not covered
+     */
+    float depth(int i, int pixel) const
+    {
+        auto first = indices.begin() + begin(i);
+        auto last = indices.begin() + end(i);
+        auto it = std::lower_bound(first, last, pixel);
+        if (it == last || *it != pixel)
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        return depths[it - indices.begin()];
+    }
+
+    std::vector<int> offsets;
+    std::vector<int> indices;
+    std::vector<float> depths;
+};
+
 class RigidBodyRenderer
 {
 public:
@@ -39,8 +88,25 @@ public:
                       int n_rows,
                       int n_cols);
 
+    /**
+     * \brief Renders the levels of detail of a mesh, which are shared and
+     *        not copied. Each part is rendered with the level selected from
+     *        its projected size in the given pose.
+     */
+    explicit RigidBodyRenderer(const MeshLevels& levels);
+
+    RigidBodyRenderer(const MeshLevels& levels,
+                      Matrix camera_matrix,
+                      int n_rows,
+                      int n_cols);
+
     virtual ~RigidBodyRenderer();
 
+    /** \brief The full resolution mesh */
+    const FlatMesh& mesh() const { return levels_.level(0); }
+
+    const MeshLevels& levels() const { return levels_; }
+
     void Render(Matrix camera_matrix,
                 int n_rows,
                 int n_cols,
@@ -54,6 +120,66 @@ public:
 
     void Render(std::vector<float>& depth_image) const;
 
+    /**
+     * \brief Renders the parts in the given poses without using or modifying
+     *        the poses set by set_poses(). Safe to call from several threads.
+     */
+    void Render(const std::vector<Affine>& poses,
+                const Matrix& camera_matrix,
+                int n_rows,
+                int n_cols,
+                std::vector<float>& depth_image) const;
+
+    /**
+     * \brief Same as above but only returns the intersected pixels.
+     *        depth_image is used as scratch memory for the dense rendering.
+     */
+    void Render(const std::vector<Affine>& poses,
+                const Matrix& camera_matrix,
+                int n_rows,
+                int n_cols,
+                std::vector<int>& intersect_indices,
+                std::vector<float>& depth,
+                std::vector<float>& depth_image) const;
+
+    /**
+     * \brief Renders a batch of pose hypotheses, each holding the poses of
+     *        all parts, into one contiguous buffer. The depth image of
+     *        hypothesis i starts at i * n_rows * n_cols.
+     *
+     * Does not touch any mutable member state and may therefore be called
+     * concurrently from several threads.
+     */
+    void RenderBatch(const std::vector<std::vector<Affine>>& poses,
+                     const Matrix& camera_matrix,
+                     int n_rows,
+                     int n_cols,
+                     std::vector<float>& depth_images) const;
+
+    /**
+     * \brief Same as above, writing into preallocated memory of at least
+     *        poses.size() * n_rows * n_cols floats.
+     */
+    void RenderBatch(const std::vector<std::vector<Affine>>& poses,
+                     const Matrix& camera_matrix,
+                     int n_rows,
+                     int n_cols,
+                     float* depth_images) const;
+
+    /**
+     * \brief Renders a batch of pose hypotheses into sparse depth images,
+     *        replacing the content of images. Only the pixels covered by
+     *        the parts are emitted, the memory of images is reused.
+     *
+     * Does not touch any mutable member state and may therefore be called
+     * concurrently from several threads.
+     */
+    void RenderSparse(const std::vector<std::vector<Affine>>& poses,
+                      const Matrix& camera_matrix,
+                      int n_rows,
+                      int n_cols,
+                      SparseDepthImages& images) const;
+
     template <typename RigidbodyState>
     void Render(const RigidbodyState& state, std::vector<float>& depth_vector)
 
@@ -132,16 +258,80 @@ private:
      */
     void init();
 
+    /**
+     * \brief Memory reused between the hypotheses of one rendering call
+     */
+    struct RenderScratch
+    {
+        std::vector<Matrix> R;
+        std::vector<Vector> t;
+        // level of detail of each part
+        std::vector<int> levels;
+        // transformed and projected vertices of the mesh
+        std::vector<Eigen::Vector3f> trans_vertices;
+        std::vector<Eigen::Vector2f> image_vertices;
+
+        /** maximum depth within each block of the tile */
+        std::vector<float> block_depths;
+        std::vector<float> tile;
+
+        /** image bounds of the tile, the image is empty outside of it */
+        int tile_row;
+        int tile_col;
+        int tile_rows;
+        int tile_cols;
+    };
+
+    /**
+     * \brief Renders the parts into the smallest tile of the image which
+     *        contains all their projected vertices. The bounds of the tile
+     *        are stored in the scratch memory.
+     */
+    void render_tile(const std::vector<Matrix>& R,
+                     const std::vector<Vector>& t,
+                     const Matrix& camera_matrix,
+                     int n_rows,
+                     int n_cols,
+                     std::vector<float>& tile,
+                     RenderScratch& scratch) const;
+
+    /**
+     * \brief Renders the dense n_rows x n_cols depth image
+     */
+    void render(const std::vector<Matrix>& R,
+                const std::vector<Vector>& t,
+                const Matrix& camera_matrix,
+                int n_rows,
+                int n_cols,
+                float* depth_image,
+                RenderScratch& scratch) const;
+
+    void split_poses(const std::vector<Affine>& poses,
+                     RenderScratch& scratch) const;
+
+    /**
+     * \brief Appends the covered pixels of the tile and their depths
+     */
+    static void append(const float* tile,
+                       const RenderScratch& scratch,
+                       int n_cols,
+                       std::vector<int>& intersect_indices,
+                       std::vector<float>& depth);
+
     // protected:
 public:
     Matrix camera_matrix_;
     int n_rows_;
     int n_cols_;
 
-    // triangles
-    std::vector<std::vector<Vector>> vertices_;
+    // levels of detail and the normals of their triangles, normals_[l][i]
+    // belongs to triangle i of level l
+    MeshLevels levels_;
     std::vector<std::vector<Vector>> normals_;
-    std::vector<std::vector<std::vector<int>>> indices_;
+
+    // parts with a closed, outward oriented surface whose back faces can
+    // be culled, per level
+    std::vector<std::vector<bool>> closed_parts_;
 
     // state
     std::vector<Matrix> R_;
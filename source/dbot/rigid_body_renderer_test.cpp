@@ -0,0 +1,263 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file rigid_body_renderer_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <dbot/rigid_body_renderer.h>
+
+class RigidBodyRendererTests : public ::testing::Test
+{
+protected:
+    typedef dbot::RigidBodyRenderer::Affine Affine;
+
+    RigidBodyRendererTests() : n_rows_(60), n_cols_(80)
+    {
+        // unit cube centered at the origin
+        std::vector<Eigen::Vector3d> vertices;
+        for (int i = 0; i < 8; ++i)
+        {
+            vertices.push_back(Eigen::Vector3d(
+                (i & 1) ? 0.05 : -0.05,
+                (i & 2) ? 0.05 : -0.05,
+                (i & 4) ? 0.05 : -0.05));
+        }
+
+        int faces[12][3] = {{0, 2, 1},
+                            {1, 2, 3},
+                            {4, 5, 6},
+                            {5, 7, 6},
+                            {0, 1, 4},
+                            {1, 5, 4},
+                            {2, 6, 3},
+                            {3, 6, 7},
+                            {0, 4, 2},
+                            {2, 4, 6},
+                            {1, 3, 5},
+                            {3, 7, 5}};
+        std::vector<std::vector<int>> indices;
+        for (int i = 0; i < 12; ++i)
+        {
+            indices.push_back(
+                std::vector<int>(faces[i], faces[i] + 3));
+        }
+
+        camera_matrix_ << 100, 0, n_cols_ / 2., 0, 100, n_rows_ / 2., 0, 0, 1;
+
+        renderer_ = std::make_shared<dbot::RigidBodyRenderer>(
+            std::vector<std::vector<Eigen::Vector3d>>(1, vertices),
+            std::vector<std::vector<std::vector<int>>>(1, indices));
+    }
+
+    std::vector<Affine> pose(double x, double angle) const
+    {
+        Affine affine = Affine::Identity();
+        affine.translate(Eigen::Vector3d(x, 0.01, 0.5));
+        affine.rotate(
+            Eigen::AngleAxisd(angle, Eigen::Vector3d(1, 1, 0).normalized()));
+        return std::vector<Affine>(1, affine);
+    }
+
+    int n_rows_;
+    int n_cols_;
+    Eigen::Matrix3d camera_matrix_;
+    std::shared_ptr<dbot::RigidBodyRenderer> renderer_;
+};
+
+TEST_F(RigidBodyRendererTests, batch_matches_single_renderings)
+{
+    std::vector<std::vector<Affine>> poses;
+    poses.push_back(pose(0.0, 0.0));
+    poses.push_back(pose(0.05, 0.4));
+    poses.push_back(pose(-0.08, 1.2));
+
+    std::vector<float> batch;
+    renderer_->RenderBatch(poses, camera_matrix_, n_rows_, n_cols_, batch);
+    ASSERT_EQ(batch.size(), poses.size() * n_rows_ * n_cols_);
+
+    for (size_t i = 0; i < poses.size(); ++i)
+    {
+        std::vector<float> single;
+        renderer_->set_poses(poses[i]);
+        renderer_->Render(camera_matrix_, n_rows_, n_cols_, single);
+
+        int hits = 0;
+        for (size_t k = 0; k < single.size(); ++k)
+        {
+            EXPECT_EQ(single[k], batch[i * n_rows_ * n_cols_ + k]);
+            if (std::isfinite(single[k])) hits++;
+        }
+        EXPECT_GT(hits, 0);
+    }
+}
+
+TEST_F(RigidBodyRendererTests, pose_rendering_leaves_member_poses_untouched)
+{
+    std::vector<float> depth_image;
+    renderer_->Render(
+        pose(0.0, 0.3), camera_matrix_, n_rows_, n_cols_, depth_image);
+
+    EXPECT_TRUE(renderer_->R_[0].isIdentity());
+    EXPECT_TRUE(renderer_->t_[0].isZero());
+}
+
+TEST_F(RigidBodyRendererTests, sparse_rendering_matches_dense_rendering)
+{
+    std::vector<float> dense;
+    renderer_->Render(pose(0.02, 0.7), camera_matrix_, n_rows_, n_cols_, dense);
+
+    std::vector<int> intersect_indices;
+    std::vector<float> depth;
+    std::vector<float> scratch;
+    renderer_->Render(pose(0.02, 0.7),
+                      camera_matrix_,
+                      n_rows_,
+                      n_cols_,
+                      intersect_indices,
+                      depth,
+                      scratch);
+
+    size_t count = 0;
+    for (size_t k = 0; k < dense.size(); ++k)
+    {
+        if (!std::isfinite(dense[k])) continue;
+        ASSERT_LT(count, intersect_indices.size());
+        EXPECT_EQ(intersect_indices[count], int(k));
+        EXPECT_EQ(depth[count], dense[k]);
+        count++;
+    }
+    EXPECT_EQ(count, intersect_indices.size());
+}
+
+TEST_F(RigidBodyRendererTests, front_face_depth)
+{
+    std::vector<float> depth_image;
+    renderer_->Render(
+        pose(0.0, 0.0), camera_matrix_, n_rows_, n_cols_, depth_image);
+
+    // the ray through the principal point hits the face at z = 0.45
+    EXPECT_NEAR(depth_image[n_rows_ / 2 * n_cols_ + n_cols_ / 2], 0.45, 1e-5);
+    EXPECT_FALSE(std::isfinite(depth_image[0]));
+}
+
+TEST_F(RigidBodyRendererTests, sparse_batch_matches_dense_batch)
+{
+    std::vector<std::vector<Affine>> poses;
+    poses.push_back(pose(0.0, 0.2));
+    poses.push_back(pose(1.0, 0.0));  // outside of the image
+    poses.push_back(pose(-0.05, 0.9));
+
+    std::vector<float> dense;
+    renderer_->RenderBatch(poses, camera_matrix_, n_rows_, n_cols_, dense);
+
+    dbot::SparseDepthImages sparse;
+    renderer_->RenderSparse(poses, camera_matrix_, n_rows_, n_cols_, sparse);
+    ASSERT_EQ(sparse.size(), int(poses.size()));
+    EXPECT_EQ(sparse.count(1), 0);
+
+    const int pixel_count = n_rows_ * n_cols_;
+    for (int i = 0; i < sparse.size(); ++i)
+    {
+        int count = 0;
+        for (int k = 0; k < pixel_count; ++k)
+        {
+            const float expected = dense[i * pixel_count + k];
+            if (std::isfinite(expected)) count++;
+            EXPECT_EQ(sparse.depth(i, k), expected);
+        }
+        EXPECT_EQ(sparse.count(i), count);
+    }
+}
+
+TEST_F(RigidBodyRendererTests, decimated_level_matches_full_mesh)
+{
+    // the faces of the cube as 8 x 8 grids, which the decimation can reduce
+    // without changing the surface
+    const int n = 8;
+    std::vector<Eigen::Vector3d> vertices;
+    std::vector<std::vector<int>> indices;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            const int first = vertices.size();
+            for (int i = 0; i <= n; i++)
+            {
+                for (int j = 0; j <= n; j++)
+                {
+                    Eigen::Vector3d vertex;
+                    vertex(axis) = 0.05 * side;
+                    vertex((axis + 1) % 3) = 0.1 * i / n - 0.05;
+                    vertex((axis + 2) % 3) = 0.1 * j / n - 0.05;
+                    vertices.push_back(vertex);
+                }
+            }
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    const int a = first + i * (n + 1) + j;
+                    const int b = a + n + 1;
+                    if (side > 0)
+                    {
+                        indices.push_back({a, b, a + 1});
+                        indices.push_back({a + 1, b, b + 1});
+                    }
+                    else
+                    {
+                        indices.push_back({a, a + 1, b});
+                        indices.push_back({a + 1, b + 1, b});
+                    }
+                }
+            }
+        }
+    }
+
+    auto mesh = std::make_shared<dbot::FlatMesh>(
+        dbot::FlatMesh::Vertices(1, vertices),
+        dbot::FlatMesh::TriangleIndices(1, indices));
+    const dbot::MeshLevels full_levels(mesh);
+    const dbot::MeshLevels decimated_levels(mesh, 3, 12);
+    dbot::RigidBodyRenderer full(full_levels);
+    dbot::RigidBodyRenderer decimated(decimated_levels);
+
+    const std::vector<Affine> poses = pose(0.02, 0.4);
+    ASSERT_GT(decimated.levels().level_count(), 1);
+    ASSERT_GT(decimated.levels().select(0,
+                                        poses[0].rotation(),
+                                        poses[0].translation(),
+                                        camera_matrix_),
+              0);
+
+    std::vector<float> full_image;
+    std::vector<float> decimated_image;
+    full.Render(poses, camera_matrix_, n_rows_, n_cols_, full_image);
+    decimated.Render(poses, camera_matrix_, n_rows_, n_cols_, decimated_image);
+
+    // pixels on the silhouette may flip with the changed triangulation
+    int differing_pixels = 0;
+    for (size_t i = 0; i < full_image.size(); i++)
+    {
+        if (std::isinf(full_image[i]) || std::isinf(decimated_image[i]))
+        {
+            differing_pixels += full_image[i] != decimated_image[i];
+            continue;
+        }
+        EXPECT_NEAR(full_image[i], decimated_image[i], 1e-4);
+    }
+    EXPECT_LE(differing_pixels, 4);
+}
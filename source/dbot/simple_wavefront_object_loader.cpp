@@ -17,13 +17,18 @@
  * \author Jan Issac (jan.issac@gmail.com)
  */
 
+#include <dbot/mesh_cache.h>
 #include <dbot/simple_wavefront_object_loader.h>
 
 namespace dbot
 {
 SimpleWavefrontObjectModelLoader::SimpleWavefrontObjectModelLoader(
-    const ObjectResourceIdentifier& ori)
-    : ori_(ori)
+    const ObjectResourceIdentifier& ori,
+    bool use_cache,
+    const std::string& cache_directory)
+    : ori_(ori),
+      use_cache_(use_cache && !cache_directory.empty()),
+      cache_directory_(cache_directory)
 {
 }
 
@@ -36,12 +41,32 @@ void SimpleWavefrontObjectModelLoader::load(
 
     for (size_t i = 0; i < ori_.count_meshes(); i++)
     {
+        const std::string mesh_path = ori_.mesh_path(i);
+        const std::string cache_path =
+            MeshCache::cache_path(cache_directory_, mesh_path);
+
+        std::uint64_t hash = 0;
+        const bool hashed = use_cache_ && MeshCache::hash_file(mesh_path, hash);
+        if (hashed &&
+            MeshCache::read(cache_path, hash, vertices[i], triangle_indices[i]))
+        {
+            continue;
+        }
+
         ObjectFileReader file_reader;
-        file_reader.set_filename(ori_.mesh_path(i));
+        file_reader.set_filename(mesh_path);
         file_reader.Read();
 
         vertices[i] = *file_reader.get_vertices();
         triangle_indices[i] = *file_reader.get_indices();
+
+        // a cache which cannot be written only costs the parsing on the next
+        // load
+        if (hashed)
+        {
+            MeshCache::write(
+                cache_path, hash, vertices[i], triangle_indices[i]);
+        }
     }
 }
 }
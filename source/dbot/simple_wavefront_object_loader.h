@@ -13,16 +13,30 @@
 
 #pragma once
 
+#include <string>
+
+#include <dbot/mesh_cache.h>
 #include <dbot/object_file_reader.h>
 #include <dbot/object_model_loader.h>
 #include <dbot/object_resource_identifier.h>
 
 namespace dbot
 {
+/**
+ * \brief Loads the meshes of an ObjectResourceIdentifier from Wavefront
+ *        files.
+ *
+ * With use_cache, the parsed meshes are written into a binary MeshCache in
+ * the cache directory on the first load and read from it on later loads,
+ * until the mesh file changes. An empty cache directory disables the cache.
+ */
 class SimpleWavefrontObjectModelLoader : public ObjectModelLoader
 {
 public:
-    SimpleWavefrontObjectModelLoader(const ObjectResourceIdentifier& ori);
+    SimpleWavefrontObjectModelLoader(const ObjectResourceIdentifier& ori,
+                                     bool use_cache = true,
+                                     const std::string& cache_directory =
+                                         MeshCache::default_directory());
 
     void load(
         std::vector<std::vector<Eigen::Vector3d>>& vertices,
@@ -30,5 +44,7 @@ public:
 
 private:
     ObjectResourceIdentifier ori_;
+    bool use_cache_;
+    std::string cache_directory_;
 };
 }
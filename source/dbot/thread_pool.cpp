@@ -0,0 +1,271 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file thread_pool.cpp
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <dbot/thread_pool.h>
+#include <dbot/trace_recorder.h>
+
+namespace dbot
+{
+namespace
+{
+std::uint64_t next_pool_id()
+{
+    static std::atomic<std::uint64_t> next_id(1);
+    return next_id++;
+}
+
+/**
+ * \brief Restricts the calling thread to the CPUs while it exists and
+ *        restores the CPUs the thread could run on before
+ */
+class ScopedPlacement
+{
+public:
+    explicit ScopedPlacement(const ThreadPool::CpuSet& cpus)
+    {
+        if (cpus.empty()) return;
+
+        // nothing to restore if the thread already runs on the set
+        ThreadPool::CpuSet sorted = cpus;
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        ThreadPool::CpuSet previous = ThreadPool::available_cpus();
+        if (previous == sorted) return;
+
+        if (!ThreadPool::restrict_thread(cpus))
+        {
+            std::cout << "Could not restrict the thread to the CPUs of the "
+                      << "pool" << std::endl;
+            return;
+        }
+        previous_.swap(previous);
+    }
+
+    ~ScopedPlacement()
+    {
+        if (!previous_.empty()) ThreadPool::restrict_thread(previous_);
+    }
+
+private:
+    ThreadPool::CpuSet previous_;
+};
+}
+
+ThreadPool::ThreadPool(int thread_count, const CpuSet& cpus)
+    : thread_count_(thread_count < 1 ? 1 : thread_count),
+      cpus_(cpus),
+      id_(next_pool_id()),
+      task_(nullptr),
+      count_(0),
+      generation_(0),
+      pending_(0),
+      stop_(false)
+{
+    for (int worker = 1; worker < thread_count_; ++worker)
+    {
+        threads_.push_back(std::thread(&ThreadPool::work, this, worker));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_condition_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallel_for(int count, const Task& task)
+{
+    if (count <= 0) return;
+
+    const ScopedPlacement placement(cpus_);
+
+    if (thread_count_ == 1)
+    {
+        task(0, count, 0);
+        return;
+    }
+
+    // only one loop may be in flight at a time
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        pending_ = thread_count_ - 1;
+        ++generation_;
+    }
+    start_condition_.notify_all();
+
+    run_chunk(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this]() { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+int ThreadPool::thread_count() const
+{
+    return thread_count_;
+}
+
+const ThreadPool::CpuSet& ThreadPool::cpus() const
+{
+    return cpus_;
+}
+
+int ThreadPool::worker_cpu(int worker) const
+{
+    if (cpus_.empty()) return -1;
+    return cpus_[worker % cpus_.size()];
+}
+
+ThreadPool::CpuSet ThreadPool::parse_cpu_list(const std::string& list)
+{
+    CpuSet cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        int first, last;
+        char dash;
+        std::istringstream bounds(range);
+        if (!(bounds >> first)) continue;
+        if (!(bounds >> dash >> last) || dash != '-') last = first;
+        for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+ThreadPool::CpuSet ThreadPool::node_cpus(int node)
+{
+    std::ifstream file("/sys/devices/system/node/node" +
+                       std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!std::getline(file, list)) return CpuSet();
+    return parse_cpu_list(list);
+}
+
+ThreadPool::CpuSet ThreadPool::available_cpus()
+{
+    CpuSet cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+bool ThreadPool::restrict_thread(const CpuSet& cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+int ThreadPool::current_cpu()
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+void ThreadPool::run_chunk(int worker)
+{
+    int begin = int((long(count_) * worker) / thread_count_);
+    int end = int((long(count_) * (worker + 1)) / thread_count_);
+
+    if (begin < end) (*task_)(begin, end, worker);
+}
+
+void ThreadPool::work(int worker)
+{
+    int generation = 0;
+
+    if (!cpus_.empty())
+    {
+        const int cpu = worker_cpu(worker);
+        if (!restrict_thread(CpuSet(1, cpu)))
+        {
+            std::cout << "Could not pin pool worker " << worker << " to CPU "
+                      << cpu << std::endl;
+        }
+        TraceRecorder::name_thread("pool " + std::to_string(id_) +
+                                   " worker " + std::to_string(worker) +
+                                   " cpu " + std::to_string(cpu));
+    }
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_condition_.wait(lock, [this, generation]() {
+                return stop_ || generation_ != generation;
+            });
+
+            if (stop_) return;
+            generation = generation_;
+        }
+
+        run_chunk(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_;
+        }
+        done_condition_.notify_one();
+    }
+}
+}
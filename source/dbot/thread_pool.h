@@ -0,0 +1,130 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file thread_pool.h
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief Fixed size pool of worker threads executing data parallel loops.
+ *
+ * The calling thread always takes part in the work as worker 0, hence a pool
+ * of size one does not spawn any thread and runs everything serially.
+ *
+ * A pool may be placed on a set of CPUs, e.g. the ones of a NUMA node. Worker
+ * w is then pinned to the CPU w modulo the size of the set. A thread calling
+ * parallel_for() is restricted to the whole set for the duration of the
+ * loop, such that the buffers it touches first within the loop are on its
+ * node, and runs on its previous CPUs again afterwards. The workers name
+ * their tracks of the TraceRecorder after their CPU. Placement is only
+ * supported on Linux and ignored elsewhere.
+ */
+class ThreadPool
+{
+public:
+    typedef std::shared_ptr<ThreadPool> Ptr;
+
+    /**
+     * \brief Task operating on the index range [begin, end) on the given
+     *        worker
+     */
+    typedef std::function<void(int begin, int end, int worker)> Task;
+
+    /** \brief Ids of logical CPUs as the operating system numbers them */
+    typedef std::vector<int> CpuSet;
+
+public:
+    /**
+     * \brief Creates a pool with thread_count workers including the calling
+     *        thread. Values smaller than one are treated as one.
+     *
+     * \param cpus  CPUs the workers are placed on, not placed if empty
+     */
+    explicit ThreadPool(int thread_count, const CpuSet& cpus = CpuSet());
+
+    ~ThreadPool();
+
+    /**
+     * \brief Splits [0, count) into one contiguous chunk per worker and blocks
+     *        until all chunks have been processed.
+     *
+     * The chunk boundaries only depend on count and thread_count(), so a
+     * worker always processes the same indices for the same input.
+     */
+    void parallel_for(int count, const Task& task);
+
+    int thread_count() const;
+
+    const CpuSet& cpus() const;
+
+    /** \brief CPU the worker is pinned to, -1 if the pool is not placed */
+    int worker_cpu(int worker) const;
+
+    /**
+     * \brief Parses a CPU list as in /sys and taskset, e.g. "0-3,8,10-11"
+     */
+    static CpuSet parse_cpu_list(const std::string& list);
+
+    /** \brief CPUs of the NUMA node, empty if the node is unknown */
+    static CpuSet node_cpus(int node);
+
+    /** \brief CPUs the calling thread may currently run on */
+    static CpuSet available_cpus();
+
+    /**
+     * \brief Restricts the calling thread to the CPUs, returns false if
+     *        that is not possible
+     */
+    static bool restrict_thread(const CpuSet& cpus);
+
+    /** \brief CPU the calling thread runs on, -1 if unknown */
+    static int current_cpu();
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void run_chunk(int worker);
+    void work(int worker);
+
+private:
+    int thread_count_;
+    CpuSet cpus_;
+    std::uint64_t id_;
+    std::vector<std::thread> threads_;
+
+    std::mutex call_mutex_;
+    std::mutex mutex_;
+    std::condition_variable start_condition_;
+    std::condition_variable done_condition_;
+
+    const Task* task_;
+    int count_;
+    int generation_;
+    int pending_;
+    bool stop_;
+};
+}
@@ -0,0 +1,110 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file thread_pool_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include <dbot/thread_pool.h>
+
+TEST(ThreadPoolTests, every_index_is_visited_once)
+{
+    dbot::ThreadPool pool(4);
+
+    std::vector<int> visits(1001, 0);
+    pool.parallel_for(visits.size(), [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) visits[i]++;
+    });
+
+    for (size_t i = 0; i < visits.size(); ++i)
+    {
+        EXPECT_EQ(visits[i], 1);
+    }
+}
+
+TEST(ThreadPoolTests, chunks_are_deterministic)
+{
+    dbot::ThreadPool pool(3);
+
+    std::vector<int> first(100, -1);
+    std::vector<int> second(100, -1);
+    pool.parallel_for(first.size(), [&](int begin, int end, int worker) {
+        for (int i = begin; i < end; ++i) first[i] = worker;
+    });
+    pool.parallel_for(second.size(), [&](int begin, int end, int worker) {
+        for (int i = begin; i < end; ++i) second[i] = worker;
+    });
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.front(), 0);
+    EXPECT_EQ(first.back(), 2);
+}
+
+TEST(ThreadPoolTests, single_thread_runs_in_caller)
+{
+    dbot::ThreadPool pool(0);
+    EXPECT_EQ(pool.thread_count(), 1);
+
+    std::thread::id id;
+    pool.parallel_for(10, [&](int, int, int) {
+        id = std::this_thread::get_id();
+    });
+
+    EXPECT_EQ(id, std::this_thread::get_id());
+}
+
+TEST(ThreadPoolTests, parses_cpu_lists)
+{
+    EXPECT_EQ(dbot::ThreadPool::parse_cpu_list("0-3,8,10-11\n"),
+              dbot::ThreadPool::CpuSet({0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_TRUE(dbot::ThreadPool::parse_cpu_list("").empty());
+}
+
+TEST(ThreadPoolTests, workers_are_pinned_to_their_cpus)
+{
+    const dbot::ThreadPool::CpuSet available =
+        dbot::ThreadPool::available_cpus();
+    if (available.empty()) return;
+
+    // the caller is restricted to the whole set during the loop and the
+    // workers wrap around the set if there are more of them than CPUs
+    const size_t cpu_count = std::min<size_t>(2, available.size());
+    const dbot::ThreadPool::CpuSet cpus(available.begin(),
+                                        available.begin() + cpu_count);
+    {
+        dbot::ThreadPool pool(3, cpus);
+        EXPECT_EQ(pool.worker_cpu(1), cpus[1 % cpus.size()]);
+        EXPECT_EQ(pool.worker_cpu(2), cpus[0]);
+
+        std::vector<int> worker_cpus(3, -1);
+        dbot::ThreadPool::CpuSet caller_cpus;
+        pool.parallel_for(3, [&](int, int, int worker) {
+            worker_cpus[worker] = dbot::ThreadPool::current_cpu();
+            if (worker == 0)
+            {
+                caller_cpus = dbot::ThreadPool::available_cpus();
+            }
+        });
+        EXPECT_EQ(worker_cpus[1], pool.worker_cpu(1));
+        EXPECT_EQ(worker_cpus[2], pool.worker_cpu(2));
+        EXPECT_EQ(caller_cpus, cpus);
+
+        // the caller runs on its previous CPUs after the loop
+        EXPECT_EQ(dbot::ThreadPool::available_cpus(), available);
+    }
+    EXPECT_EQ(dbot::ThreadPool::available_cpus(), available);
+}
@@ -0,0 +1,224 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file trace_recorder.cpp
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <dbot/trace_recorder.h>
+
+namespace dbot
+{
+namespace
+{
+struct Event
+{
+    const char* name;
+    const char* category;
+    double begin;
+    double duration;
+    int track;
+    int index;
+};
+
+struct Recording
+{
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::map<int, std::string> track_names;
+    std::atomic<TraceRecorder::Clock::rep> epoch{0};
+    std::atomic<std::uint64_t> generation{0};
+};
+
+Recording& trace()
+{
+    static Recording instance;
+    return instance;
+}
+
+int thread_track()
+{
+    static std::atomic<int> next_track(1);
+    static thread_local int track = next_track++;
+    return track;
+}
+
+/**
+ * \brief Starts recording if DBOT_TRACE is set and saves the trace to the
+ *        file it names at exit
+ */
+struct EnvironmentTrace
+{
+    EnvironmentTrace()
+    {
+        const char* path = std::getenv("DBOT_TRACE");
+        if (path == nullptr || std::string(path).empty()) return;
+
+        path_ = path;
+        TraceRecorder::start();
+    }
+
+    ~EnvironmentTrace()
+    {
+        if (path_.empty()) return;
+
+        TraceRecorder::stop();
+        if (!TraceRecorder::save(path_))
+        {
+            std::cout << "Could not write trace to " << path_ << std::endl;
+        }
+    }
+
+    std::string path_;
+};
+
+EnvironmentTrace environment_trace;
+
+void write_track_name(std::ostream& json,
+                      int track,
+                      const std::string& name)
+{
+    json << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << track << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+}
+
+std::atomic<bool>& TraceRecorder::recording_flag()
+{
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+void TraceRecorder::start()
+{
+    Recording& r = trace();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    // a few seconds of tracking fit in without growing the buffer
+    r.events.clear();
+    r.events.reserve(1 << 16);
+    r.epoch.store(Clock::now().time_since_epoch().count());
+    r.generation++;
+    recording_flag().store(true);
+}
+
+void TraceRecorder::stop()
+{
+    recording_flag().store(false);
+}
+
+std::uint64_t TraceRecorder::generation()
+{
+    return trace().generation.load();
+}
+
+double TraceRecorder::microseconds(Clock::time_point time)
+{
+    const Clock::duration since_start =
+        time.time_since_epoch() -
+        Clock::duration(trace().epoch.load(std::memory_order_relaxed));
+    return std::chrono::duration<double, std::micro>(since_start).count();
+}
+
+void TraceRecorder::span(const char* name,
+                         const char* category,
+                         Clock::time_point begin,
+                         Clock::time_point end,
+                         int index)
+{
+    if (!recording()) return;
+
+    span(name,
+         category,
+         microseconds(begin),
+         std::chrono::duration<double, std::micro>(end - begin).count(),
+         thread_track(),
+         index);
+}
+
+void TraceRecorder::span(const char* name,
+                         const char* category,
+                         double begin,
+                         double duration,
+                         int track,
+                         int index)
+{
+    if (!recording()) return;
+
+    Recording& r = trace();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.events.push_back({name, category, begin, duration, track, index});
+}
+
+void TraceRecorder::name_thread(const std::string& name)
+{
+    Recording& r = trace();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.track_names[thread_track()] = name;
+}
+
+std::size_t TraceRecorder::size()
+{
+    Recording& r = trace();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.events.size();
+}
+
+std::string TraceRecorder::to_json()
+{
+    Recording& r = trace();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+         << "\"args\":{\"name\":\"dbot\"}}";
+    write_track_name(json, OpenGlTrack, "GPU OpenGL");
+    write_track_name(json, CudaTrack, "GPU CUDA");
+    for (const auto& track_name : r.track_names)
+    {
+        write_track_name(json, track_name.first, track_name.second);
+    }
+
+    for (const Event& event : r.events)
+    {
+        json << ",{\"name\":\"" << event.name << "\",\"cat\":\""
+             << event.category << "\",\"ph\":\"X\",\"ts\":" << event.begin
+             << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":"
+             << event.track;
+        if (event.index >= 0)
+        {
+            json << ",\"args\":{\"index\":" << event.index << "}";
+        }
+        json << "}";
+    }
+    json << "]}";
+    return json.str();
+}
+
+bool TraceRecorder::save(const std::string& path)
+{
+    std::ofstream file(path.c_str());
+    file << to_json();
+    return bool(file);
+}
+}
@@ -0,0 +1,161 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file trace_recorder.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace dbot
+{
+/**
+ * \brief Records timed spans of the tracking pipeline as Chrome trace
+ *        events, which can be opened in chrome://tracing or Perfetto.
+ *
+ * Host spans are put on the track of the thread which recorded them. Spans
+ * measured on the GPU are put on named tracks, their timestamps have to be
+ * converted to host time by the caller. The names and categories of the
+ * spans are not copied and have to be string literals.
+ *
+ * Recording is switched with start() and stop(). If the environment
+ * variable DBOT_TRACE holds a file name, recording starts with the program
+ * and the trace is saved to that file at exit.
+ */
+class TraceRecorder
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /** \brief Tracks of the spans measured on the GPU */
+    enum GpuTrack
+    {
+        OpenGlTrack = 1000000,
+        CudaTrack
+    };
+
+public:
+    static bool recording()
+    {
+        return recording_flag().load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Drops all recorded spans and starts recording. Timestamps are
+     *        relative to this call.
+     */
+    static void start();
+
+    static void stop();
+
+    /**
+     * \brief Incremented by every start(). GPU clocks which are aligned to
+     *        host time should be aligned again when it changes.
+     */
+    static std::uint64_t generation();
+
+    /** \brief Microseconds since the last start() */
+    static double microseconds(Clock::time_point time);
+    static double now() { return microseconds(Clock::now()); }
+
+    /**
+     * \brief Adds a span of the calling thread, ignored when not recording
+     */
+    static void span(const char* name,
+                     const char* category,
+                     Clock::time_point begin,
+                     Clock::time_point end,
+                     int index = -1);
+
+    /**
+     * \brief Adds a span in microseconds since start() on the given track,
+     *        ignored when not recording
+     *
+     * \param index  shown as an argument of the span if not negative
+     */
+    static void span(const char* name,
+                     const char* category,
+                     double begin,
+                     double duration,
+                     int track,
+                     int index = -1);
+
+    /**
+     * \brief Names the track of the calling thread. Unlike the spans the
+     *        name is kept across start() and is also stored when not
+     *        recording.
+     */
+    static void name_thread(const std::string& name);
+
+    /** \brief Number of spans recorded since the last start() */
+    static std::size_t size();
+
+    /**
+     * \brief The recorded spans in the Chrome trace event JSON format
+     */
+    static std::string to_json();
+
+    /**
+     * \brief Writes to_json() to the file, returns false if that fails
+     */
+    static bool save(const std::string& path);
+
+private:
+    static std::atomic<bool>& recording_flag();
+};
+
+/**
+ * \brief Records the time from its construction to its destruction as a
+ *        span of the calling thread
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(const char* name, const char* category, int index = -1)
+        : name_(name),
+          category_(category),
+          index_(index),
+          running_(TraceRecorder::recording())
+    {
+        if (running_) begin_ = TraceRecorder::Clock::now();
+    }
+
+    ~TraceSpan()
+    {
+        if (running_)
+        {
+            TraceRecorder::span(name_,
+                                category_,
+                                begin_,
+                                TraceRecorder::Clock::now(),
+                                index_);
+        }
+    }
+
+private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+private:
+    const char* name_;
+    const char* category_;
+    int index_;
+    bool running_;
+    TraceRecorder::Clock::time_point begin_;
+};
+}
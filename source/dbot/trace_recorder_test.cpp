@@ -0,0 +1,81 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file trace_recorder_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <dbot/profiler.h>
+#include <dbot/trace_recorder.h>
+
+using dbot::TraceRecorder;
+
+TEST(TraceRecorderTests, spans_are_ignored_when_not_recording)
+{
+    TraceRecorder::start();
+    TraceRecorder::stop();
+    {
+        dbot::TraceSpan span("idle", "test");
+    }
+    TraceRecorder::span("gpu", "test", 0.0, 1.0, TraceRecorder::CudaTrack);
+
+    EXPECT_EQ(TraceRecorder::size(), 0u);
+}
+
+TEST(TraceRecorderTests, start_drops_previous_spans)
+{
+    TraceRecorder::start();
+    TraceRecorder::span("gpu", "test", 0.0, 1.0, TraceRecorder::CudaTrack);
+    const std::uint64_t generation = TraceRecorder::generation();
+    TraceRecorder::start();
+    TraceRecorder::stop();
+
+    EXPECT_EQ(TraceRecorder::size(), 0u);
+    EXPECT_EQ(TraceRecorder::generation(), generation + 1);
+}
+
+TEST(TraceRecorderTests, stages_are_traced_without_histograms)
+{
+    dbot::Profiler::set_enabled(false);
+    TraceRecorder::start();
+    {
+        dbot::TraceSpan span("sampling_block", "filter", 3);
+        dbot::ProfileScope scope(dbot::ProfileStage::Propose);
+    }
+    TraceRecorder::span("weigh", "gpu", 10.0, 2.5, TraceRecorder::CudaTrack);
+    TraceRecorder::stop();
+
+    EXPECT_EQ(TraceRecorder::size(), 3u);
+
+    const std::string json = TraceRecorder::to_json();
+    EXPECT_NE(json.find("\"name\":\"propose\",\"cat\":\"stage\",\"ph\":\"X\""),
+              std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"sampling_block\""), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"index\":3}"), std::string::npos);
+    EXPECT_NE(json.find("\"ts\":10.000,\"dur\":2.500,\"pid\":1,\"tid\":" +
+                        std::to_string(int(TraceRecorder::CudaTrack))),
+              std::string::npos);
+    EXPECT_NE(json.find("\"GPU CUDA\""), std::string::npos);
+}
+
+TEST(TraceRecorderTests, thread_names_are_kept_across_recordings)
+{
+    TraceRecorder::name_thread("tracker");
+    TraceRecorder::start();
+    TraceRecorder::stop();
+
+    EXPECT_NE(TraceRecorder::to_json().find("\"args\":{\"name\":\"tracker\"}"),
+              std::string::npos);
+}
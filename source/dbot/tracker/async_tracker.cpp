@@ -0,0 +1,150 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file async_tracker.cpp
+ */
+
+#include <algorithm>
+
+#include <dbot/tracker/async_tracker.h>
+
+namespace dbot
+{
+AsyncTracker::AsyncTracker(const std::shared_ptr<Tracker>& tracker,
+                           int capacity,
+                           const Callback& callback)
+    : tracker_(tracker),
+      callback_(callback),
+      slots_(std::max(capacity, 1)),
+      slot_frames_(slots_.size()),
+      first_(0),
+      size_(0),
+      latest_frame_(0),
+      submitted_count_(0),
+      dropped_count_(0),
+      tracked_count_(0),
+      busy_(false),
+      stop_(false)
+{
+    thread_ = std::thread(&AsyncTracker::work, this);
+}
+
+AsyncTracker::~AsyncTracker()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+size_t AsyncTracker::submit(const DepthImageView& image)
+{
+    size_t frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        push(frame) = image;
+    }
+    condition_.notify_one();
+
+    return frame;
+}
+
+size_t AsyncTracker::submit(const Obsrv& image)
+{
+    size_t frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        push(frame) = image.cast<float>();
+    }
+    condition_.notify_one();
+
+    return frame;
+}
+
+Eigen::VectorXf& AsyncTracker::push(size_t& frame)
+{
+    const int capacity = slots_.size();
+    if (size_ == capacity)
+    {
+        first_ = (first_ + 1) % capacity;
+        size_--;
+        dropped_count_++;
+    }
+
+    const int slot = (first_ + size_) % capacity;
+    size_++;
+
+    frame = submitted_count_++;
+    slot_frames_[slot] = frame;
+
+    return slots_[slot];
+}
+
+bool AsyncTracker::latest(State& state, size_t& frame) const
+{
+    if (tracked_count_ == 0) return false;
+
+    std::lock_guard<std::mutex> lock(latest_mutex_);
+    state = latest_;
+    frame = latest_frame_;
+
+    return true;
+}
+
+void AsyncTracker::wait() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return size_ == 0 && !busy_; });
+}
+
+void AsyncTracker::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        condition_.wait(lock, [this] { return size_ > 0 || stop_; });
+        if (stop_) break;
+
+        // take the oldest frame out of the queue, the swap leaves the
+        // storage of the previous frame in the slot for reuse
+        frame_.swap(slots_[first_]);
+        const size_t frame = slot_frames_[first_];
+        first_ = (first_ + 1) % int(slots_.size());
+        size_--;
+        busy_ = true;
+        lock.unlock();
+
+        const State state =
+            tracker_->track(DepthImageView(frame_.data(), frame_.size()));
+        {
+            std::lock_guard<std::mutex> latest_lock(latest_mutex_);
+            latest_ = state;
+            latest_frame_ = frame;
+        }
+        tracked_count_++;
+        if (callback_) callback_(state, frame);
+
+        lock.lock();
+        busy_ = false;
+        done_condition_.notify_all();
+    }
+
+    // frames which are still queued are dropped
+    dropped_count_ += size_;
+    size_ = 0;
+    done_condition_.notify_all();
+}
+}
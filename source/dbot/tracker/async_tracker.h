@@ -0,0 +1,150 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file async_tracker.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/depth_image_view.h>
+#include <dbot/tracker/tracker.h>
+
+namespace dbot
+{
+/**
+ * \brief Runs a tracker on a dedicated worker thread.
+ *
+ * Frames are submitted into a bounded queue and submit() returns
+ * immediately. If the filter falls behind and the queue is full, the oldest
+ * queued frame is dropped, such that the latency stays bounded and the
+ * filter always continues with the newest frames. With a capacity of one
+ * the queue is a single slot holding the newest frame.
+ *
+ * The estimates are published through the callback, which is called on the
+ * worker thread, and through latest().
+ */
+class AsyncTracker
+{
+public:
+    typedef Tracker::State State;
+    typedef Tracker::Obsrv Obsrv;
+
+    /**
+     * \brief Called on the worker thread with the estimate and the sequence
+     *        number of the submitted frame it belongs to
+     */
+    typedef std::function<void(const State& state, size_t frame)> Callback;
+
+public:
+    /**
+     * \brief Creates the worker thread
+     *
+     * \param tracker
+     *     Initialized tracker which is only used by the worker from now on
+     * \param capacity
+     *     Maximum number of queued frames, at least one
+     */
+    explicit AsyncTracker(const std::shared_ptr<Tracker>& tracker,
+                          int capacity = 1,
+                          const Callback& callback = Callback());
+
+    /**
+     * \brief Processes the frame which is currently tracked, drops the
+     *        queued ones and joins the worker
+     */
+    ~AsyncTracker();
+
+    /**
+     * \brief Queues a copy of the frame and returns its sequence number
+     */
+    size_t submit(const DepthImageView& image);
+
+    /**
+     * \brief Same as above for a double precision image
+     */
+    size_t submit(const Obsrv& image);
+
+    /**
+     * \brief Copies the most recent estimate into state and returns the
+     *        sequence number of its frame. Returns false if no frame has been
+     *        tracked yet.
+     */
+    bool latest(State& state, size_t& frame) const;
+
+    /**
+     * \brief Blocks until all submitted frames are tracked or dropped
+     */
+    void wait() const;
+
+    /** \brief Number of submitted frames */
+    size_t submitted_count() const { return submitted_count_; }
+
+    /** \brief Number of frames dropped because the queue was full */
+    size_t dropped_count() const { return dropped_count_; }
+
+    /** \brief Number of tracked frames */
+    size_t tracked_count() const { return tracked_count_; }
+
+    int capacity() const { return int(slots_.size()); }
+
+private:
+    AsyncTracker(const AsyncTracker&);
+    AsyncTracker& operator=(const AsyncTracker&);
+
+    /**
+     * \brief Returns the slot the next frame is written to, dropping the
+     *        oldest frame if the queue is full. Requires mutex_.
+     */
+    Eigen::VectorXf& push(size_t& frame);
+
+    void work();
+
+private:
+    std::shared_ptr<Tracker> tracker_;
+    Callback callback_;
+
+    // ring buffer of the queued frames, the storage of the slots is kept and
+    // swapped with the frame of the worker
+    std::vector<Eigen::VectorXf> slots_;
+    std::vector<size_t> slot_frames_;
+    int first_;
+    int size_;
+    Eigen::VectorXf frame_;
+
+    State latest_;
+    size_t latest_frame_;
+    mutable std::mutex latest_mutex_;
+
+    std::atomic<size_t> submitted_count_;
+    std::atomic<size_t> dropped_count_;
+    std::atomic<size_t> tracked_count_;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    mutable std::condition_variable done_condition_;
+    bool busy_;
+    bool stop_;
+};
+}
@@ -0,0 +1,141 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file async_tracker_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <dbot/tracker/async_tracker.h>
+
+namespace
+{
+/**
+ * Loads an object of one triangle, such that the trackers also run with
+ * fixed size states
+ */
+class TriangleLoader : public dbot::ObjectModelLoader
+{
+public:
+    void load(std::vector<std::vector<Eigen::Vector3d>>& vertices,
+              std::vector<std::vector<std::vector<int>>>& triangle_indices)
+        const
+    {
+        vertices.assign(1,
+                        {Eigen::Vector3d(0, 0, 0),
+                         Eigen::Vector3d(0.1, 0, 0),
+                         Eigen::Vector3d(0, 0.1, 0)});
+        triangle_indices.assign(1, {{0, 1, 2}});
+    }
+};
+
+std::shared_ptr<dbot::ObjectModel> triangle_model()
+{
+    return std::make_shared<dbot::ObjectModel>(
+        std::make_shared<TriangleLoader>(), false);
+}
+
+/**
+ * Tracker of a one part object model which records the first depth of every
+ * tracked frame
+ */
+class RecordingTracker : public dbot::Tracker
+{
+public:
+    explicit RecordingTracker(int delay_ms)
+        : Tracker(triangle_model(), 1.0, false),
+          delay_ms_(delay_ms)
+    {
+    }
+
+    State on_track(const Obsrv& image)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+        std::lock_guard<std::mutex> lock(frames_mutex_);
+        frames_.push_back(image(0));
+        return State(1);
+    }
+
+    State on_initialize(const std::vector<State>&)
+    {
+        return State(1);
+    }
+
+    std::vector<double> frames()
+    {
+        std::lock_guard<std::mutex> lock(frames_mutex_);
+        return frames_;
+    }
+
+private:
+    int delay_ms_;
+    std::mutex frames_mutex_;
+    std::vector<double> frames_;
+};
+
+Eigen::VectorXf image(float depth)
+{
+    return Eigen::VectorXf::Constant(4, depth);
+}
+}
+
+TEST(AsyncTrackerTests, tracks_frames_in_order)
+{
+    auto tracker = std::make_shared<RecordingTracker>(0);
+    dbot::AsyncTracker async_tracker(tracker, 16);
+
+    for (int i = 0; i < 10; i++)
+    {
+        const Eigen::VectorXf frame = image(i);
+        async_tracker.submit(dbot::DepthImageView(frame.data(), frame.size()));
+    }
+    async_tracker.wait();
+
+    const std::vector<double> frames = tracker->frames();
+    ASSERT_EQ(frames.size(), 10);
+    for (int i = 0; i < 10; i++) EXPECT_EQ(frames[i], i);
+    EXPECT_EQ(async_tracker.dropped_count(), 0);
+    EXPECT_EQ(async_tracker.tracked_count(), 10);
+
+    dbot::AsyncTracker::State state;
+    size_t frame;
+    ASSERT_TRUE(async_tracker.latest(state, frame));
+    EXPECT_EQ(frame, 9);
+}
+
+TEST(AsyncTrackerTests, slow_tracker_keeps_newest_frame)
+{
+    auto tracker = std::make_shared<RecordingTracker>(20);
+    dbot::AsyncTracker async_tracker(tracker, 1);
+
+    for (int i = 0; i < 10; i++)
+    {
+        const Eigen::VectorXf frame = image(i);
+        async_tracker.submit(dbot::DepthImageView(frame.data(), frame.size()));
+    }
+    async_tracker.wait();
+
+    // the worker is busy with one of the first frames while the others
+    // replace each other in the slot, the last one is always tracked
+    const std::vector<double> frames = tracker->frames();
+    ASSERT_LT(frames.size(), 10);
+    EXPECT_EQ(frames.back(), 9);
+    EXPECT_EQ(async_tracker.dropped_count() + async_tracker.tracked_count(),
+              10);
+}
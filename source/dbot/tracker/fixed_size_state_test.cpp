@@ -0,0 +1,106 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+
+/**
+ * \file fixed_size_state_test.cpp
+ *
+ * Built with DBOT_FIXED_SIZE_STATE only, like the rest of the tree
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <dbot/model/rao_blackwell_sensor.h>
+#include <dbot/tracker/tracker.h>
+
+namespace
+{
+typedef dbot::Tracker::State State;
+
+/**
+ * Loads one triangle per part
+ */
+class TriangleLoader : public dbot::ObjectModelLoader
+{
+public:
+    explicit TriangleLoader(int part_count) : part_count_(part_count) {}
+
+    void load(std::vector<std::vector<Eigen::Vector3d>>& vertices,
+              std::vector<std::vector<std::vector<int>>>& triangle_indices)
+        const
+    {
+        vertices.assign(part_count_,
+                        {Eigen::Vector3d(0, 0, 0),
+                         Eigen::Vector3d(0.1, 0, 0),
+                         Eigen::Vector3d(0, 0.1, 0)});
+        triangle_indices.assign(part_count_, {{0, 1, 2}});
+    }
+
+private:
+    int part_count_;
+};
+
+class StaticTracker : public dbot::Tracker
+{
+public:
+    explicit StaticTracker(int part_count)
+        : Tracker(std::make_shared<dbot::ObjectModel>(
+                      std::make_shared<TriangleLoader>(part_count), false),
+                  1.0,
+                  false)
+    {
+    }
+
+    State on_track(const Obsrv&) { return State(1); }
+    State on_initialize(const std::vector<State>&) { return State(1); }
+};
+}
+
+TEST(FixedSizeStateTests, states_and_poses_have_the_size_of_one_body)
+{
+    EXPECT_EQ(int(dbot::Tracker::BodyCount), 1);
+    EXPECT_EQ(int(State::RowsAtCompileTime), int(State::BODY_SIZE));
+    EXPECT_EQ(int(dbot::Tracker::Noise::RowsAtCompileTime),
+              int(State::POSE_SIZE));
+
+    const bool same_poses =
+        std::is_same<dbot::RbSensor<State>::PoseArray, State>::value;
+    EXPECT_TRUE(same_poses);
+}
+
+TEST(FixedSizeStateTests, vectors_of_states_are_aligned)
+{
+    std::vector<State> states;
+    for (int i = 0; i < 33; i++)
+    {
+        states.push_back(State(1));
+        states.back().setConstant(i);
+    }
+
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        EXPECT_EQ(std::uintptr_t(states[i].data()) % 16, 0u);
+        EXPECT_EQ(states[i](0), double(i));
+    }
+}
+
+TEST(FixedSizeStateTests, tracker_rejects_objects_of_other_part_counts)
+{
+    EXPECT_NO_THROW(StaticTracker(1));
+    EXPECT_THROW(StaticTracker(2), dbot::WrongPartCountException);
+    EXPECT_THROW(StaticTracker(0), dbot::WrongPartCountException);
+}
@@ -23,6 +23,10 @@
 
 #include <dbot/tracker/gaussian_tracker.h>
 
+#ifdef DBOT_BUILD_GPU
+#include <dbot/gpu/gaussian_image_model_gpu.h>
+#endif
+
 namespace dbot
 {
 GaussianTracker::GaussianTracker(
@@ -65,7 +69,34 @@ auto GaussianTracker::on_track(const Obsrv& obsrv) -> State
     belief_.mean(zero_pose);
 
     filter_->predict(belief_, zero_input(), belief_);
-    filter_->update(belief_, obsrv, belief_);
+
+    // pixels which are not selected are NaN, as the invalid ones, and
+    // skipped by the update
+    const Obsrv* update_obsrv = &obsrv;
+    if (pixel_selection_)
+    {
+        selection_poses_.resize(old_pose.count());
+        for (int i = 0; i < old_pose.count(); i++)
+        {
+            selection_poses_[i] = old_pose.component(i).homogeneous();
+        }
+        pixel_selection_->select(selection_poses_, obsrv);
+        pixel_selection_->mask(obsrv, selected_obsrv_);
+        update_obsrv = &selected_obsrv_;
+    }
+
+    if (gpu_sensor_)
+    {
+        update_on_gpu(old_pose, *update_obsrv);
+    }
+    else if (cpu_sensor_)
+    {
+        update_on_cpu(old_pose, *update_obsrv);
+    }
+    else
+    {
+        filter_->update(belief_, *update_obsrv, belief_);
+    }
 
     State delta_mean = belief_.mean();
     State new_pose = old_pose;
@@ -75,4 +106,32 @@ auto GaussianTracker::on_track(const Obsrv& obsrv) -> State
 
     return belief_.mean();
 }
+
+void GaussianTracker::update_on_gpu(const State& nominal_pose,
+                                    const Obsrv& obsrv)
+{
+#ifdef DBOT_BUILD_GPU
+    gpu_sensor_->nominal_pose(nominal_pose);
+    gpu_sensor_->set_observation(obsrv);
+
+    State mean;
+    Eigen::MatrixXd covariance;
+    gpu_sensor_->update(belief_.mean(), belief_.covariance(), mean, covariance);
+    belief_.mean(mean);
+    belief_.covariance(covariance);
+#endif
+}
+
+void GaussianTracker::update_on_cpu(const State& nominal_pose,
+                                    const Obsrv& obsrv)
+{
+    cpu_sensor_->nominal_pose(nominal_pose);
+    cpu_sensor_->set_observation(obsrv);
+
+    State mean;
+    Eigen::MatrixXd covariance;
+    cpu_sensor_->update(belief_.mean(), belief_.covariance(), mean, covariance);
+    belief_.mean(mean);
+    belief_.covariance(covariance);
+}
 }
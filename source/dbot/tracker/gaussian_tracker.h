@@ -30,6 +30,8 @@
 #pragma once
 
 #include <dbot/model/depth_pixel_model.h>
+#include <dbot/model/gaussian_image_model.h>
+#include <dbot/pixel_selection.h>
 #include <dbot/tracker/tracker.h>
 #include <fl/filter/gaussian/robust_multi_sensor_gaussian_filter.hpp>
 #include <fl/model/sensor/body_tail_sensor.hpp>
@@ -39,6 +41,9 @@
 
 namespace dbot
 {
+template <typename State>
+class GaussianImageModelGPU;
+
 class GaussianTracker : public Tracker
 {
 public:
@@ -76,6 +81,13 @@ public:
 
     typedef typename fl::Traits<Filter>::Belief Belief;
 
+    /** measurement update on the GPU, replaces the one of the filter */
+    typedef GaussianImageModelGPU<State> GpuSensor;
+
+    /** parallel measurement update on the CPU, replaces the one of the
+     *  filter */
+    typedef GaussianImageModel<State> CpuSensor;
+
 public:
     /**
      * \brief Creates the tracker
@@ -101,6 +113,7 @@ public:
      *     Current observation image
      */
     State on_track(const Obsrv& image);
+    using Tracker::on_track;
 
     /**
      * \brief Initializes the particle filter with the given initial states and
@@ -110,8 +123,56 @@ public:
      */
     State on_initialize(const std::vector<State>& initial_states);
 
+    /**
+     * \brief Updates the belief with the given GPU sensor instead of the
+     *        sensor of the filter, which then only predicts. Null returns to
+     *        the update of the filter.
+     */
+    void set_gpu_sensor(const std::shared_ptr<GpuSensor>& gpu_sensor)
+    {
+        gpu_sensor_ = gpu_sensor;
+    }
+
+    /**
+     * \brief Updates the belief with the given CPU sensor instead of the
+     *        sensor of the filter, unless a GPU sensor is set. Null returns
+     *        to the update of the filter.
+     */
+    void set_cpu_sensor(const std::shared_ptr<CpuSensor>& cpu_sensor)
+    {
+        cpu_sensor_ = cpu_sensor;
+    }
+
+    /**
+     * \brief Restricts the measurement updates to the pixels selected
+     *        around the current pose. Null updates with all pixels.
+     */
+    void set_pixel_selection(
+        const std::shared_ptr<PixelSelection>& pixel_selection)
+    {
+        pixel_selection_ = pixel_selection;
+    }
+
+private:
+    /**
+     * \brief Measurement update of the belief by the GPU sensor, the mean
+     *        of the belief is a delta from the nominal pose
+     */
+    void update_on_gpu(const State& nominal_pose, const Obsrv& obsrv);
+
+    /**
+     * \brief Measurement update of the belief by the CPU sensor, the mean
+     *        of the belief is a delta from the nominal pose
+     */
+    void update_on_cpu(const State& nominal_pose, const Obsrv& obsrv);
+
 private:
     std::shared_ptr<Filter> filter_;
+    std::shared_ptr<GpuSensor> gpu_sensor_;
+    std::shared_ptr<CpuSensor> cpu_sensor_;
+    std::shared_ptr<PixelSelection> pixel_selection_;
+    std::vector<Eigen::Matrix4d> selection_poses_;
+    Obsrv selected_obsrv_;
     Belief belief_;
 };
 }
@@ -0,0 +1,147 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file multi_object_tracker.cpp
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include <dbot/tracker/multi_object_tracker.h>
+
+namespace dbot
+{
+std::shared_ptr<ObjectModel> MultiObjectTracker::combine(
+    const std::vector<std::shared_ptr<ObjectModel>>& object_models)
+{
+    auto combined = std::make_shared<ObjectModel>();
+    for (auto& object_model : object_models)
+    {
+        combined->append(*object_model);
+    }
+
+    return combined;
+}
+
+MultiObjectTracker::MultiObjectTracker(
+    const std::shared_ptr<Tracker>& tracker,
+    const std::vector<std::shared_ptr<ObjectModel>>& object_models)
+    : tracker_(tracker)
+{
+    first_parts_.push_back(0);
+    for (auto& object_model : object_models)
+    {
+        first_parts_.push_back(first_parts_.back() +
+                               object_model->count_parts());
+    }
+
+    if (first_parts_.back() != tracker_->object_model()->count_parts())
+    {
+        std::cout << "the objects have " << first_parts_.back()
+                  << " parts while the model of the tracker has "
+                  << tracker_->object_model()->count_parts() << std::endl;
+        exit(-1);
+    }
+}
+
+void MultiObjectTracker::initialize(
+    const std::vector<std::vector<State>>& initial_states)
+{
+    if (int(initial_states.size()) != object_count())
+    {
+        std::cout << "got initial states for " << initial_states.size()
+                  << " objects while tracking " << object_count()
+                  << std::endl;
+        exit(-1);
+    }
+
+    size_t state_count = 0;
+    for (auto& object_states : initial_states)
+    {
+        state_count = std::max(state_count, object_states.size());
+    }
+
+    std::vector<State> joint_states(state_count);
+    std::vector<State> object_states(object_count());
+    for (size_t i = 0; i < state_count; i++)
+    {
+        for (int object = 0; object < object_count(); object++)
+        {
+            const std::vector<State>& states = initial_states[object];
+            object_states[object] = states[i % states.size()];
+        }
+        joint_states[i] = join(object_states);
+    }
+
+    tracker_->initialize(joint_states);
+}
+
+auto MultiObjectTracker::track(const Obsrv& image) -> std::vector<State>
+{
+    return split(tracker_->track(image));
+}
+
+auto MultiObjectTracker::track(const DepthImageView& image)
+    -> std::vector<State>
+{
+    return split(tracker_->track(image));
+}
+
+auto MultiObjectTracker::join(const std::vector<State>& object_states) const
+    -> State
+{
+    State state(first_parts_.back());
+    for (int object = 0; object < object_count(); object++)
+    {
+        const int first_part = first_parts_[object];
+        const int part_count = first_parts_[object + 1] - first_part;
+        if (object_states[object].count() != part_count)
+        {
+            std::cout << "the state of object " << object << " has "
+                      << object_states[object].count()
+                      << " parts instead of " << part_count << std::endl;
+            exit(-1);
+        }
+
+        for (int part = 0; part < part_count; part++)
+        {
+            state.component(first_part + part) =
+                object_states[object].component(part);
+        }
+    }
+
+    return state;
+}
+
+auto MultiObjectTracker::split(const State& state) const
+    -> std::vector<State>
+{
+    std::vector<State> object_states;
+    object_states.reserve(object_count());
+    for (int object = 0; object < object_count(); object++)
+    {
+        const int first_part = first_parts_[object];
+        const int part_count = first_parts_[object + 1] - first_part;
+
+        State object_state(part_count);
+        for (int part = 0; part < part_count; part++)
+        {
+            object_state.component(part) = state.component(first_part + part);
+        }
+        object_states.push_back(object_state);
+    }
+
+    return object_states;
+}
+}
@@ -0,0 +1,106 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file multi_object_tracker.h
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <dbot/object_model.h>
+#include <dbot/tracker/tracker.h>
+
+namespace dbot
+{
+/**
+ * \brief Front end which tracks several independent objects with a single
+ *        tracker.
+ *
+ * The objects are appended into one object model, see combine(), from
+ * which one tracker is built as for a single object. Its state holds the
+ * poses of all objects, hence all of them are rendered in one pass, the
+ * observation is uploaded once per frame and occlusions between the objects
+ * are part of the likelihood. The tracker samples every part in its own
+ * sampling block, such that the poses of the different objects are proposed
+ * independently.
+ *
+ * The front end maps between the joint state and the states of the
+ * individual objects.
+ */
+class MultiObjectTracker
+{
+public:
+    typedef Tracker::State State;
+    typedef Tracker::Obsrv Obsrv;
+
+public:
+    /**
+     * \brief Returns the parts of all objects appended in the given order
+     */
+    static std::shared_ptr<ObjectModel> combine(
+        const std::vector<std::shared_ptr<ObjectModel>>& object_models);
+
+    /**
+     * \brief Creates the front end
+     *
+     * \param tracker
+     *     Tracker built on combine(object_models)
+     * \param object_models
+     *     Models of the tracked objects
+     */
+    MultiObjectTracker(
+        const std::shared_ptr<Tracker>& tracker,
+        const std::vector<std::shared_ptr<ObjectModel>>& object_models);
+
+    /**
+     * \brief Initializes the tracker given a list of initial states for
+     *        every object. The lists may differ in length, the shorter ones
+     *        are repeated.
+     */
+    void initialize(const std::vector<std::vector<State>>& initial_states);
+
+    /**
+     * \brief Performs a single filter step for all objects and returns the
+     *        state of each object
+     */
+    std::vector<State> track(const Obsrv& image);
+
+    /**
+     * \brief Same as above on a float depth image
+     */
+    std::vector<State> track(const DepthImageView& image);
+
+    /**
+     * \brief Composes the joint state from the states of the objects
+     */
+    State join(const std::vector<State>& object_states) const;
+
+    /**
+     * \brief Splits the joint state into the states of the objects
+     */
+    std::vector<State> split(const State& state) const;
+
+    int object_count() const { return int(first_parts_.size()) - 1; }
+
+    const std::shared_ptr<Tracker>& tracker() const { return tracker_; }
+
+private:
+    std::shared_ptr<Tracker> tracker_;
+
+    // object i owns the parts [first_parts_[i], first_parts_[i + 1])
+    std::vector<int> first_parts_;
+};
+}
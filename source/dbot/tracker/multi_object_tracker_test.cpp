@@ -0,0 +1,227 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file multi_object_tracker_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <dbot/tracker/multi_object_tracker.h>
+
+namespace
+{
+typedef dbot::MultiObjectTracker::State State;
+
+/**
+ * Loads one triangle per part
+ */
+class TriangleLoader : public dbot::ObjectModelLoader
+{
+public:
+    explicit TriangleLoader(int part_count) : part_count_(part_count) {}
+
+    void load(std::vector<std::vector<Eigen::Vector3d>>& vertices,
+              std::vector<std::vector<std::vector<int>>>& triangle_indices)
+        const
+    {
+        vertices.assign(part_count_,
+                        {Eigen::Vector3d(0, 0, 0),
+                         Eigen::Vector3d(0.1, 0, 0),
+                         Eigen::Vector3d(0, 0.1, 0)});
+        triangle_indices.assign(part_count_, {{0, 1, 2}});
+    }
+
+private:
+    int part_count_;
+};
+
+std::shared_ptr<dbot::ObjectModel> model(int part_count)
+{
+    return std::make_shared<dbot::ObjectModel>(
+        std::make_shared<TriangleLoader>(part_count), false);
+}
+
+/**
+ * Parts of the tracked objects. States of a fixed size hold exactly one
+ * part, hence only a single object of one part is tracked then.
+ */
+std::vector<std::shared_ptr<dbot::ObjectModel>> object_models()
+{
+#ifdef DBOT_FIXED_SIZE_STATE
+    return {model(1)};
+#else
+    return {model(1), model(2), model(1)};
+#endif
+}
+
+/**
+ * Tracker which records its initial states and returns a given state
+ */
+class RecordingTracker : public dbot::Tracker
+{
+public:
+    explicit RecordingTracker(const std::shared_ptr<dbot::ObjectModel>& model)
+        : Tracker(model, 1.0, false)
+    {
+    }
+
+    State on_track(const Obsrv&) { return tracked; }
+
+    State on_initialize(const std::vector<State>& initial_states)
+    {
+        initialized = initial_states;
+        return initial_states.front();
+    }
+
+    State tracked;
+    std::vector<State> initialized;
+};
+
+/** \brief State of the given number of parts at distinct positions */
+State state(int part_count, double offset)
+{
+    State state(part_count);
+    for (int part = 0; part < part_count; part++)
+    {
+        state.component(part).position() =
+            Eigen::Vector3d(offset + part, 0.5 * part, -offset);
+    }
+    return state;
+}
+
+class MultiObjectTrackerTests : public ::testing::Test
+{
+protected:
+    MultiObjectTrackerTests()
+        : models_(object_models()),
+          tracker_(std::make_shared<RecordingTracker>(
+              dbot::MultiObjectTracker::combine(models_))),
+          multi_tracker_(tracker_, models_)
+    {
+    }
+
+    int part_count() const
+    {
+        return tracker_->object_model()->count_parts();
+    }
+
+    std::vector<std::shared_ptr<dbot::ObjectModel>> models_;
+    std::shared_ptr<RecordingTracker> tracker_;
+    dbot::MultiObjectTracker multi_tracker_;
+};
+}
+
+TEST_F(MultiObjectTrackerTests, split_is_the_inverse_of_join)
+{
+    ASSERT_EQ(multi_tracker_.object_count(), int(models_.size()));
+
+    const State joint = state(part_count(), 0.25);
+    const std::vector<State> objects = multi_tracker_.split(joint);
+    ASSERT_EQ(objects.size(), models_.size());
+
+    // the objects own consecutive parts of the joint state
+    int first_part = 0;
+    for (size_t object = 0; object < objects.size(); object++)
+    {
+        ASSERT_EQ(objects[object].count(), models_[object]->count_parts());
+        for (int part = 0; part < objects[object].count(); part++)
+        {
+            EXPECT_TRUE(objects[object].component(part).position().isApprox(
+                joint.component(first_part + part).position()));
+        }
+        first_part += objects[object].count();
+    }
+
+    EXPECT_TRUE(multi_tracker_.join(objects).isApprox(joint));
+}
+
+TEST_F(MultiObjectTrackerTests, initialize_repeats_the_shorter_lists)
+{
+    // three states of the first object, one of every other
+    std::vector<std::vector<State>> initial_states;
+    for (size_t object = 0; object < models_.size(); object++)
+    {
+        const int parts = models_[object]->count_parts();
+        std::vector<State> states;
+        for (int i = 0; i < (object == 0 ? 3 : 1); i++)
+        {
+            states.push_back(state(parts, object + 0.1 * i));
+        }
+        initial_states.push_back(states);
+    }
+
+    multi_tracker_.initialize(initial_states);
+
+    ASSERT_EQ(tracker_->initialized.size(), 3u);
+    for (size_t i = 0; i < tracker_->initialized.size(); i++)
+    {
+        ASSERT_EQ(tracker_->initialized[i].count(), part_count());
+        const std::vector<State> objects =
+            multi_tracker_.split(tracker_->initialized[i]);
+        EXPECT_TRUE(objects[0].isApprox(initial_states[0][i]));
+        for (size_t object = 1; object < objects.size(); object++)
+        {
+            EXPECT_TRUE(objects[object].isApprox(initial_states[object][0]));
+        }
+    }
+}
+
+TEST_F(MultiObjectTrackerTests, track_returns_the_states_of_the_objects)
+{
+    // one initial state per object
+    std::vector<std::vector<State>> initial_states;
+    for (const State& object_state :
+         multi_tracker_.split(state(part_count(), 0.0)))
+    {
+        initial_states.push_back(std::vector<State>(1, object_state));
+    }
+    multi_tracker_.initialize(initial_states);
+
+    // the moving average of rate 1 is the tracked state
+    tracker_->tracked = state(part_count(), 0.75);
+    const std::vector<State> objects =
+        multi_tracker_.track(dbot::Tracker::Obsrv::Zero(4));
+    ASSERT_EQ(objects.size(), models_.size());
+    EXPECT_TRUE(multi_tracker_.join(objects).isApprox(tracker_->tracked));
+}
+
+TEST_F(MultiObjectTrackerTests, mismatched_part_counts_exit)
+{
+    // the reasons go to the standard output, only the exits are checked
+
+    // the objects have one part more than the model of the tracker
+    std::vector<std::shared_ptr<dbot::ObjectModel>> models = models_;
+    models.push_back(model(1));
+    EXPECT_EXIT(dbot::MultiObjectTracker(tracker_, models),
+                ::testing::ExitedWithCode(255),
+                "");
+
+    // one list of initial states per object
+    EXPECT_EXIT(multi_tracker_.initialize(std::vector<std::vector<State>>(
+                    models.size(), std::vector<State>(1, state(1, 0)))),
+                ::testing::ExitedWithCode(255),
+                "");
+
+#ifndef DBOT_FIXED_SIZE_STATE
+    // a state of the first object with the parts of the second one, which
+    // fixed size states of one part cannot express
+    std::vector<State> objects = multi_tracker_.split(state(part_count(), 0));
+    objects[0] = objects[1];
+    EXPECT_EXIT(multi_tracker_.join(objects),
+                ::testing::ExitedWithCode(255),
+                "");
+#endif
+}
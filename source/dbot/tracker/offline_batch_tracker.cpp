@@ -0,0 +1,165 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file offline_batch_tracker.cpp
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <dbot/depth_image_view.h>
+#include <dbot/depth_stream.h>
+#include <dbot/tracker/offline_batch_tracker.h>
+
+namespace dbot
+{
+struct OfflineBatchTracker::Worker
+{
+    Worker()
+        : next(NULL),
+          nr_rows(0),
+          nr_cols(0),
+          sequence_count(0),
+          failed_count(0),
+          frame_count(0)
+    {
+    }
+
+    std::atomic<std::size_t>* next;
+
+    // the tracker is kept for the next sequence of the same camera
+    std::shared_ptr<Tracker> tracker;
+    Eigen::Matrix3d camera_matrix;
+    int nr_rows;
+    int nr_cols;
+
+    std::vector<float> depth;
+
+    std::size_t sequence_count;
+    std::size_t failed_count;
+    std::size_t frame_count;
+};
+
+OfflineBatchTracker::OfflineBatchTracker(const Factory& factory,
+                                         const Parameters& parameters,
+                                         const Callback& callback)
+    : factory_(factory), parameters_(parameters), callback_(callback)
+{
+    if (parameters_.worker_count < 1 || parameters_.downsampling_factor < 1)
+    {
+        std::cout << "ERROR: OfflineBatchTracker needs at least one worker "
+                     "and a downsampling factor of at least one."
+                  << std::endl;
+        exit(-1);
+    }
+}
+
+auto OfflineBatchTracker::run(const std::vector<Sequence>& sequences)
+    -> Statistics
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::atomic<std::size_t> next(0);
+    std::vector<Worker> workers(
+        std::min<std::size_t>(parameters_.worker_count, sequences.size()));
+    std::vector<std::thread> threads;
+    for (auto& worker : workers)
+    {
+        worker.next = &next;
+        threads.emplace_back(&OfflineBatchTracker::work,
+                             this,
+                             std::cref(sequences),
+                             std::ref(worker));
+    }
+    for (auto& thread : threads) thread.join();
+
+    Statistics statistics;
+    for (const auto& worker : workers)
+    {
+        statistics.sequence_count += worker.sequence_count;
+        statistics.failed_count += worker.failed_count;
+        statistics.frame_count += worker.frame_count;
+    }
+    statistics.seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    return statistics;
+}
+
+void OfflineBatchTracker::work(const std::vector<Sequence>& sequences,
+                               Worker& worker)
+{
+    const int factor = parameters_.downsampling_factor;
+
+    DepthStream stream;
+    for (std::size_t index = (*worker.next)++; index < sequences.size();
+         index = (*worker.next)++)
+    {
+        const Sequence& sequence = sequences[index];
+        if (!stream.open(sequence.path) || stream.frame_count() == 0)
+        {
+            std::cout << "WARNING: cannot track the sequence " << sequence.path
+                      << std::endl;
+            worker.failed_count++;
+            continue;
+        }
+
+        Eigen::Matrix3d camera_matrix = stream.camera_matrix();
+        camera_matrix.topRows(2) /= factor;
+        const int nr_rows = stream.resolution().height / factor;
+        const int nr_cols = stream.resolution().width / factor;
+
+        if (!worker.tracker || worker.nr_rows != nr_rows ||
+            worker.nr_cols != nr_cols ||
+            !worker.camera_matrix.isApprox(camera_matrix))
+        {
+            worker.tracker.reset();
+            worker.tracker = factory_(camera_matrix, nr_rows, nr_cols);
+            worker.camera_matrix = camera_matrix;
+            worker.nr_rows = nr_rows;
+            worker.nr_cols = nr_cols;
+        }
+
+        if (sequence.initial_states.empty())
+        {
+            const DepthStream::Poses poses = stream.poses(0);
+            State state(poses.size());
+            for (std::size_t i = 0; i < poses.size(); i++)
+            {
+                state.component(i).affine(poses[i].cast<fl::Real>());
+            }
+            worker.tracker->initialize(std::vector<State>(1, state));
+        }
+        else
+        {
+            worker.tracker->initialize(sequence.initial_states);
+        }
+
+        worker.depth.resize(nr_rows * nr_cols);
+        for (std::size_t frame = 0; frame < stream.frame_count(); frame++)
+        {
+            stream.decode(frame, factor, worker.depth.data());
+            const State state = worker.tracker->track(
+                DepthImageView(worker.depth.data(), worker.depth.size()));
+            if (callback_) callback_(index, frame, state);
+        }
+
+        worker.sequence_count++;
+        worker.frame_count += stream.frame_count();
+    }
+}
+}
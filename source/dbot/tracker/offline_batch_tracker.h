@@ -0,0 +1,136 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file offline_batch_tracker.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <dbot/tracker/tracker.h>
+
+namespace dbot
+{
+/**
+ * \brief Tracks many recorded DepthStream sequences concurrently for the
+ *        highest number of frames per second over the whole dataset.
+ *
+ * Every worker thread takes the next untracked sequence, tracks all of its
+ * frames as fast as possible and moves on, such that the GPU work of one
+ * worker overlaps with the resampling and the decoding of the others and
+ * the device stays busy between the frames of a single sequence.
+ *
+ * The trackers are created by the factory on the worker thread which uses
+ * them, so trackers created through the GpuResources of that thread share
+ * its GL context, shaders and object models. A worker keeps its tracker for
+ * the next sequence of the same camera and resolution and initializes it
+ * again, otherwise it creates a new one.
+ */
+class OfflineBatchTracker
+{
+public:
+    typedef Tracker::State State;
+
+    /**
+     * \brief Creates a tracker for the camera matrix and the resolution of
+     *        the downsampled frames, called on the worker thread
+     */
+    typedef std::function<std::shared_ptr<Tracker>(
+        const Eigen::Matrix3d& camera_matrix, int nr_rows, int nr_cols)>
+        Factory;
+
+    /**
+     * \brief Called on the worker thread with the estimate of every frame
+     */
+    typedef std::function<void(
+        std::size_t sequence, std::size_t frame, const State& state)>
+        Callback;
+
+    struct Sequence
+    {
+        /** path of the DepthStream file */
+        std::string path;
+
+        /** states to initialize the tracker with, the ground truth poses of
+         *  the first frame if empty */
+        std::vector<State> initial_states;
+    };
+
+    struct Parameters
+    {
+        Parameters() : worker_count(2), downsampling_factor(1) {}
+
+        /** number of sequences tracked concurrently */
+        int worker_count;
+
+        /** factor by which the recorded frames are downsampled */
+        int downsampling_factor;
+    };
+
+    struct Statistics
+    {
+        Statistics()
+            : sequence_count(0), failed_count(0), frame_count(0), seconds(0)
+        {
+        }
+
+        double frames_per_second() const
+        {
+            return seconds > 0 ? frame_count / seconds : 0;
+        }
+
+        /** number of tracked sequences */
+        std::size_t sequence_count;
+
+        /** number of sequences which could not be opened */
+        std::size_t failed_count;
+
+        /** number of tracked frames of all sequences */
+        std::size_t frame_count;
+
+        /** wall time of the run */
+        double seconds;
+    };
+
+public:
+    OfflineBatchTracker(const Factory& factory,
+                        const Parameters& parameters = Parameters(),
+                        const Callback& callback = Callback());
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /**
+     * \brief Tracks all frames of all sequences and returns once they are
+     *        tracked
+     */
+    Statistics run(const std::vector<Sequence>& sequences);
+
+private:
+    struct Worker;
+
+    void work(const std::vector<Sequence>& sequences, Worker& worker);
+
+private:
+    Factory factory_;
+    Parameters parameters_;
+    Callback callback_;
+};
+}
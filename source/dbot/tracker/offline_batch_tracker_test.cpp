@@ -0,0 +1,204 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file offline_batch_tracker_test.cpp
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dbot/depth_stream.h>
+#include <dbot/tracker/offline_batch_tracker.h>
+
+namespace
+{
+/**
+ * Loads an object of one triangle, such that the trackers also run with
+ * fixed size states
+ */
+class TriangleLoader : public dbot::ObjectModelLoader
+{
+public:
+    void load(std::vector<std::vector<Eigen::Vector3d>>& vertices,
+              std::vector<std::vector<std::vector<int>>>& triangle_indices)
+        const
+    {
+        vertices.assign(1,
+                        {Eigen::Vector3d(0, 0, 0),
+                         Eigen::Vector3d(0.1, 0, 0),
+                         Eigen::Vector3d(0, 0.1, 0)});
+        triangle_indices.assign(1, {{0, 1, 2}});
+    }
+};
+
+std::shared_ptr<dbot::ObjectModel> triangle_model()
+{
+    return std::make_shared<dbot::ObjectModel>(
+        std::make_shared<TriangleLoader>(), false);
+}
+
+/**
+ * Tracker of a one part object model which returns the first depth of every
+ * frame as the number of its state
+ */
+class DepthTracker : public dbot::Tracker
+{
+public:
+    DepthTracker()
+        : Tracker(triangle_model(), 1.0, false),
+          initialized_count(0)
+    {
+    }
+
+    State on_track(const Obsrv& image)
+    {
+        first_depth = image(0);
+        return State(1);
+    }
+
+    State on_initialize(const std::vector<State>&)
+    {
+        initialized_count++;
+        return State(1);
+    }
+
+    double first_depth;
+    int initialized_count;
+};
+
+class OfflineBatchTrackerTests : public testing::Test
+{
+protected:
+    ~OfflineBatchTrackerTests()
+    {
+        for (const auto& path : paths_) boost::filesystem::remove(path);
+    }
+
+    /**
+     * \brief Records frame_count frames of the constant depth of the
+     *        sequence plus a tenth of the frame
+     */
+    dbot::OfflineBatchTracker::Sequence record(int width,
+                                               int height,
+                                               int sequence,
+                                               int frame_count)
+    {
+        const std::string path =
+            (boost::filesystem::temp_directory_path() /
+             boost::filesystem::unique_path("dbot_batch_%%%%%%%%"))
+                .string();
+        paths_.push_back(path);
+
+        dbot::CameraData::Resolution resolution;
+        resolution.width = width;
+        resolution.height = height;
+        Eigen::Matrix3d camera_matrix;
+        camera_matrix << 10, 0, width / 2., 0, 10, height / 2., 0, 0, 1;
+
+        dbot::DepthStreamWriter writer(
+            path, camera_matrix, resolution, "/camera", 1);
+        for (int i = 0; i < frame_count; i++)
+        {
+            writer.add_frame(
+                0.05 * i,
+                Eigen::MatrixXd::Constant(height, width, sequence + 0.1 * i),
+                dbot::DepthStream::Poses(1, Eigen::Affine3d::Identity()));
+        }
+        writer.close();
+
+        dbot::OfflineBatchTracker::Sequence result;
+        result.path = path;
+        return result;
+    }
+
+    std::vector<std::string> paths_;
+};
+}
+
+TEST_F(OfflineBatchTrackerTests, tracks_all_frames_of_all_sequences)
+{
+    std::vector<dbot::OfflineBatchTracker::Sequence> sequences;
+    for (int i = 0; i < 5; i++) sequences.push_back(record(8, 6, i + 1, 4));
+    sequences.push_back(dbot::OfflineBatchTracker::Sequence());
+    sequences.back().path = "/nonexistent/dbot_batch";
+
+    std::mutex mutex;
+    std::map<std::size_t, std::vector<std::size_t>> frames;
+    dbot::OfflineBatchTracker::Parameters parameters;
+    parameters.worker_count = 3;
+    parameters.downsampling_factor = 2;
+    dbot::OfflineBatchTracker batch(
+        [&](const Eigen::Matrix3d& camera_matrix, int nr_rows, int nr_cols) {
+            EXPECT_EQ(nr_rows, 3);
+            EXPECT_EQ(nr_cols, 4);
+            EXPECT_DOUBLE_EQ(camera_matrix(0, 0), 5);
+            EXPECT_DOUBLE_EQ(camera_matrix(1, 2), 1.5);
+            return std::make_shared<DepthTracker>();
+        },
+        parameters,
+        [&](std::size_t sequence,
+            std::size_t frame,
+            const dbot::OfflineBatchTracker::State&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            EXPECT_EQ(frames[sequence].size(), frame);
+            frames[sequence].push_back(frame);
+        });
+
+    const auto statistics = batch.run(sequences);
+    EXPECT_EQ(statistics.sequence_count, 5u);
+    EXPECT_EQ(statistics.failed_count, 1u);
+    EXPECT_EQ(statistics.frame_count, 20u);
+    EXPECT_GT(statistics.frames_per_second(), 0);
+    EXPECT_EQ(frames.size(), 5u);
+    for (const auto& sequence : frames)
+    {
+        EXPECT_EQ(sequence.second.size(), 4u);
+    }
+}
+
+TEST_F(OfflineBatchTrackerTests, reuses_the_tracker_of_the_same_camera)
+{
+    std::vector<dbot::OfflineBatchTracker::Sequence> sequences = {
+        record(8, 6, 1, 2), record(8, 6, 2, 3), record(4, 2, 3, 1)};
+
+    std::vector<std::shared_ptr<DepthTracker>> trackers;
+    dbot::OfflineBatchTracker::Parameters parameters;
+    parameters.worker_count = 1;
+    std::vector<double> last_depths(sequences.size());
+    dbot::OfflineBatchTracker batch(
+        [&](const Eigen::Matrix3d&, int, int) {
+            trackers.push_back(std::make_shared<DepthTracker>());
+            return trackers.back();
+        },
+        parameters,
+        [&](std::size_t sequence,
+            std::size_t,
+            const dbot::OfflineBatchTracker::State&) {
+            last_depths[sequence] = trackers.back()->first_depth;
+        });
+
+    const auto statistics = batch.run(sequences);
+    EXPECT_EQ(statistics.frame_count, 6u);
+    ASSERT_EQ(trackers.size(), 2u);
+    EXPECT_EQ(trackers[0]->initialized_count, 2);
+    EXPECT_EQ(trackers[1]->initialized_count, 1);
+    EXPECT_NEAR(last_depths[0], 1.1, 1e-3);
+    EXPECT_NEAR(last_depths[1], 2.2, 1e-3);
+    EXPECT_NEAR(last_depths[2], 3.0, 1e-3);
+}
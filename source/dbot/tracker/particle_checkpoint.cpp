@@ -0,0 +1,275 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_checkpoint.cpp
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <dbot/binary_file.h>
+#include <dbot/tracker/particle_checkpoint.h>
+
+namespace dbot
+{
+namespace
+{
+const char magic[8] = {'D', 'B', 'O', 'T', 'C', 'K', 'P', 'T'};
+const std::uint32_t version = 1;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t body_count;
+    std::uint64_t particle_count;
+    std::uint64_t occlusion_particle_count;
+    std::int32_t region[4];
+    double observation_time;
+    double occlusion_time;
+    float outside_occlusion;
+    std::uint32_t has_times;
+};
+
+typedef ParticleCheckpoint::State State;
+
+void write_state(std::ofstream& file, const State& state)
+{
+    file.write(reinterpret_cast<const char*>(state.data()),
+               state.size() * sizeof(double));
+}
+
+void read_state(std::ifstream& file, int body_count, State& state)
+{
+    state = State(body_count);
+    file.read(reinterpret_cast<char*>(state.data()),
+              state.size() * sizeof(double));
+}
+}
+
+bool ParticleCheckpoint::read(const std::string& path,
+                              ParticleCheckpoint& checkpoint)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != version || header.body_count == 0 ||
+        (Tracker::BodyCount != Eigen::Dynamic &&
+         header.body_count != std::uint32_t(Tracker::BodyCount)) ||
+        header.region[2] < 0 || header.region[3] < 0 ||
+        (header.occlusion_particle_count != 0 &&
+         header.occlusion_particle_count != header.particle_count))
+    {
+        return false;
+    }
+
+    // every particle has a state and a weight, and every occlusion a
+    // float, each of them bounded by the rest of the file on its own
+    const std::uint64_t data_size = remaining_size(file);
+    const std::uint64_t doubles = data_size / sizeof(double);
+    const std::uint64_t floats = data_size / sizeof(float);
+    const std::uint64_t state_size =
+        std::uint64_t(header.body_count) * State::BODY_SIZE;
+    std::uint64_t states_size, region_size, occlusion_size;
+    if (header.particle_count >= doubles ||
+        !bounded_product(
+            header.particle_count + 1, state_size, doubles, states_size) ||
+        !bounded_product(header.occlusion_particle_count,
+                         std::uint64_t(header.region[2]),
+                         floats,
+                         region_size) ||
+        !bounded_product(region_size,
+                         std::uint64_t(header.region[3]),
+                         floats,
+                         occlusion_size) ||
+        data_size !=
+            (states_size + header.particle_count) * sizeof(double) +
+                occlusion_size * sizeof(float) +
+                (header.has_times ? occlusion_size * sizeof(double) : 0))
+    {
+        return false;
+    }
+
+    read_state(file, header.body_count, checkpoint.integrated_poses);
+    checkpoint.particles.resize(header.particle_count);
+    for (size_t i = 0; i < checkpoint.particles.size(); i++)
+    {
+        read_state(file, header.body_count, checkpoint.particles[i]);
+    }
+    checkpoint.log_weights.resize(header.particle_count);
+    file.read(reinterpret_cast<char*>(checkpoint.log_weights.data()),
+              checkpoint.log_weights.size() * sizeof(double));
+
+    OcclusionSnapshot& occlusions = checkpoint.occlusions;
+    occlusions.region = ImageRegion(header.region[0],
+                                    header.region[1],
+                                    header.region[2],
+                                    header.region[3]);
+    occlusions.particle_count = header.occlusion_particle_count;
+    occlusions.observation_time = header.observation_time;
+    occlusions.occlusion_time = header.occlusion_time;
+    occlusions.outside_occlusion = header.outside_occlusion;
+    occlusions.occlusions.resize(occlusion_size);
+    occlusions.times.resize(header.has_times ? occlusion_size : 0);
+    file.read(reinterpret_cast<char*>(occlusions.occlusions.data()),
+              occlusions.occlusions.size() * sizeof(float));
+    file.read(reinterpret_cast<char*>(occlusions.times.data()),
+              occlusions.times.size() * sizeof(double));
+
+    return bool(file);
+}
+
+bool ParticleCheckpoint::write(const std::string& path,
+                               const ParticleCheckpoint& checkpoint)
+{
+    const OcclusionSnapshot& occlusions = checkpoint.occlusions;
+    const int body_count = checkpoint.integrated_poses.count();
+    const size_t occlusion_size =
+        size_t(occlusions.particle_count) * occlusions.region.area();
+    if (body_count == 0 ||
+        checkpoint.log_weights.size() != checkpoint.particles.size() ||
+        (occlusions.particle_count != 0 &&
+         size_t(occlusions.particle_count) != checkpoint.particles.size()) ||
+        occlusions.occlusions.size() != occlusion_size ||
+        (!occlusions.times.empty() &&
+         occlusions.times.size() != occlusion_size))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < checkpoint.particles.size(); i++)
+    {
+        if (checkpoint.particles[i].count() != body_count) return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.body_count = body_count;
+    header.particle_count = checkpoint.particles.size();
+    header.occlusion_particle_count = occlusions.particle_count;
+    header.region[0] = occlusions.region.row;
+    header.region[1] = occlusions.region.col;
+    header.region[2] = occlusions.region.rows;
+    header.region[3] = occlusions.region.cols;
+    header.observation_time = occlusions.observation_time;
+    header.occlusion_time = occlusions.occlusion_time;
+    header.outside_occlusion = occlusions.outside_occlusion;
+    header.has_times = !occlusions.times.empty();
+
+    // readers never see a partially written checkpoint
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path.c_str(), std::ios::binary);
+        if (!file) return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_state(file, checkpoint.integrated_poses);
+        for (size_t i = 0; i < checkpoint.particles.size(); i++)
+        {
+            write_state(file, checkpoint.particles[i]);
+        }
+        file.write(
+            reinterpret_cast<const char*>(checkpoint.log_weights.data()),
+            checkpoint.log_weights.size() * sizeof(double));
+        file.write(reinterpret_cast<const char*>(occlusions.occlusions.data()),
+                   occlusions.occlusions.size() * sizeof(float));
+        file.write(reinterpret_cast<const char*>(occlusions.times.data()),
+                   occlusions.times.size() * sizeof(double));
+        if (!file)
+        {
+            file.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path)
+    : path_(path), failed_count_(0), pending_(false), stop_(false)
+{
+    thread_ = std::thread(&CheckpointWriter::work, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+bool CheckpointWriter::busy() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+bool CheckpointWriter::submit(ParticleCheckpoint& checkpoint)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_ || stop_) return false;
+
+        std::swap(checkpoint_, checkpoint);
+        pending_ = true;
+    }
+    condition_.notify_one();
+    return true;
+}
+
+void CheckpointWriter::wait() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return !pending_; });
+}
+
+int CheckpointWriter::failed_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_count_;
+}
+
+void CheckpointWriter::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        condition_.wait(lock, [this] { return pending_ || stop_; });
+
+        // a pending checkpoint is still written when stopping
+        if (!pending_) return;
+
+        // submit() does not touch the checkpoint while it is pending
+        lock.unlock();
+        const bool written = ParticleCheckpoint::write(path_, checkpoint_);
+        lock.lock();
+
+        if (!written) failed_count_++;
+        pending_ = false;
+        done_condition_.notify_all();
+    }
+}
+}
@@ -0,0 +1,126 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_checkpoint.h
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dbot/model/occlusion_snapshot.h>
+#include <dbot/tracker/tracker.h>
+
+namespace dbot
+{
+/**
+ * \brief Belief of a ParticleTracker from which a restarted process
+ *        resumes tracking, see ParticleTracker::resume().
+ *
+ * The file consists of a fixed header followed by the flat arrays of the
+ * integrated poses, the particles, the log weights, the occlusion rows and
+ * the occlusion times, all in native byte order. It is written through a
+ * temporary file, hence readers never see a partially written checkpoint.
+ */
+struct ParticleCheckpoint
+{
+    typedef Tracker::State State;
+
+    /** poses the particle deltas are applied to */
+    State integrated_poses;
+
+    /** deltas from the integrated poses */
+    std::vector<State> particles;
+
+    /** normalized log weights of the particles */
+    std::vector<double> log_weights;
+
+    /** occlusions of the sensor, empty if it does not keep any */
+    OcclusionSnapshot occlusions;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /**
+     * \brief Reads the checkpoint. Returns false if the file does not
+     *        exist or is malformed.
+     */
+    static bool read(const std::string& path, ParticleCheckpoint& checkpoint);
+
+    /**
+     * \brief Writes the checkpoint. Returns false if the file cannot be
+     *        written.
+     */
+    static bool write(const std::string& path,
+                      const ParticleCheckpoint& checkpoint);
+};
+
+/**
+ * \brief Writes checkpoints on a background thread such that the frame loop
+ *        only pays for the copy of the belief.
+ *
+ * A checkpoint submitted while the previous one is still being written is
+ * dropped, the next period writes a newer one anyway.
+ */
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(const std::string& path);
+
+    /** \brief Finishes the checkpoint being written and joins the thread */
+    ~CheckpointWriter();
+
+    const std::string& path() const { return path_; }
+
+    /** \brief Whether the thread is still writing the last checkpoint */
+    bool busy() const;
+
+    /**
+     * \brief Swaps the checkpoint into the writer and writes it, checkpoint
+     *        receives the buffers of the previous one for reuse. Returns
+     *        false and leaves checkpoint untouched if the writer is busy.
+     */
+    bool submit(ParticleCheckpoint& checkpoint);
+
+    /** \brief Blocks until the submitted checkpoint is written */
+    void wait() const;
+
+    /** \brief Number of checkpoints which could not be written */
+    int failed_count() const;
+
+private:
+    CheckpointWriter(const CheckpointWriter&);
+    CheckpointWriter& operator=(const CheckpointWriter&);
+
+    void work();
+
+private:
+    std::string path_;
+    ParticleCheckpoint checkpoint_;
+    int failed_count_;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    mutable std::condition_variable done_condition_;
+    bool pending_;
+    bool stop_;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+}
@@ -0,0 +1,157 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file particle_checkpoint_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <dbot/tracker/particle_checkpoint.h>
+
+namespace
+{
+typedef dbot::ParticleCheckpoint::State State;
+
+dbot::ParticleCheckpoint make_checkpoint(int particle_count)
+{
+    dbot::ParticleCheckpoint checkpoint;
+    checkpoint.integrated_poses = State(1);
+    checkpoint.integrated_poses.setRandom();
+    for (int i = 0; i < particle_count; i++)
+    {
+        State particle(1);
+        particle.setRandom();
+        checkpoint.particles.push_back(particle);
+        checkpoint.log_weights.push_back(-0.1 * i);
+    }
+
+    dbot::OcclusionSnapshot& occlusions = checkpoint.occlusions;
+    occlusions.region = dbot::ImageRegion(1, 2, 3, 4);
+    occlusions.particle_count = particle_count;
+    occlusions.observation_time = 1.5;
+    occlusions.outside_occlusion = 0.1f;
+    for (int i = 0; i < particle_count * occlusions.region.area(); i++)
+    {
+        occlusions.occlusions.push_back(0.01f * i);
+        occlusions.times.push_back(0.5 * i);
+    }
+    return checkpoint;
+}
+}
+
+TEST(ParticleCheckpointTests, round_trip)
+{
+    const std::string path = "particle_checkpoint_test.ckpt";
+    const dbot::ParticleCheckpoint checkpoint = make_checkpoint(3);
+    ASSERT_TRUE(dbot::ParticleCheckpoint::write(path, checkpoint));
+
+    dbot::ParticleCheckpoint read;
+    ASSERT_TRUE(dbot::ParticleCheckpoint::read(path, read));
+    EXPECT_EQ(read.integrated_poses, checkpoint.integrated_poses);
+    ASSERT_EQ(read.particles.size(), checkpoint.particles.size());
+    for (size_t i = 0; i < checkpoint.particles.size(); i++)
+    {
+        EXPECT_EQ(read.particles[i], checkpoint.particles[i]);
+    }
+    EXPECT_EQ(read.log_weights, checkpoint.log_weights);
+
+    const dbot::OcclusionSnapshot& occlusions = read.occlusions;
+    EXPECT_EQ(occlusions.region, checkpoint.occlusions.region);
+    EXPECT_EQ(occlusions.particle_count, 3);
+    EXPECT_EQ(occlusions.observation_time, 1.5);
+    EXPECT_EQ(occlusions.outside_occlusion, 0.1f);
+    EXPECT_EQ(occlusions.occlusions, checkpoint.occlusions.occlusions);
+    EXPECT_EQ(occlusions.times, checkpoint.occlusions.times);
+
+    std::remove(path.c_str());
+}
+
+TEST(ParticleCheckpointTests, truncated_file_is_rejected)
+{
+    const std::string path = "particle_checkpoint_test.ckpt";
+    ASSERT_TRUE(dbot::ParticleCheckpoint::write(path, make_checkpoint(2)));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+    std::ofstream(path.c_str(), std::ios::binary)
+        .write(content.data(), content.size() - 4);
+
+    dbot::ParticleCheckpoint read;
+    EXPECT_FALSE(dbot::ParticleCheckpoint::read(path, read));
+    EXPECT_FALSE(dbot::ParticleCheckpoint::read("does_not_exist.ckpt", read));
+
+    std::remove(path.c_str());
+}
+
+TEST(ParticleCheckpointTests, counts_beyond_the_file_are_rejected)
+{
+    const std::string path = "particle_checkpoint_test.ckpt";
+    ASSERT_TRUE(dbot::ParticleCheckpoint::write(path, make_checkpoint(2)));
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    file.close();
+
+    // 2^61 more particles wrap around to the same size in 64 bits, both for
+    // the states with the weights and for the occlusions of the 3 x 4 region
+    const std::size_t particle_count_offset = 16;
+    const std::uint64_t counts[2] = {2 + (std::uint64_t(1) << 61),
+                                     2 + (std::uint64_t(1) << 61)};
+    content.replace(particle_count_offset,
+                    sizeof(counts),
+                    reinterpret_cast<const char*>(counts),
+                    sizeof(counts));
+    std::ofstream(path.c_str(), std::ios::binary)
+        .write(content.data(), content.size());
+
+    dbot::ParticleCheckpoint read;
+    EXPECT_FALSE(dbot::ParticleCheckpoint::read(path, read));
+
+    std::remove(path.c_str());
+}
+
+TEST(ParticleCheckpointTests, writer_drops_while_busy)
+{
+    const std::string path = "particle_checkpoint_test.ckpt";
+    dbot::ParticleCheckpoint read;
+    {
+        dbot::CheckpointWriter writer(path);
+
+        dbot::ParticleCheckpoint first = make_checkpoint(2);
+        ASSERT_TRUE(writer.submit(first));
+
+        // the second one is dropped unless the first is already written, it
+        // then receives the buffers of the first
+        dbot::ParticleCheckpoint second = make_checkpoint(4);
+        const bool accepted = writer.submit(second);
+        EXPECT_EQ(second.particles.size(), accepted ? 2u : 4u);
+
+        writer.wait();
+        EXPECT_FALSE(writer.busy());
+        EXPECT_EQ(writer.failed_count(), 0);
+
+        ASSERT_TRUE(dbot::ParticleCheckpoint::read(path, read));
+        EXPECT_EQ(read.particles.size(), accepted ? 4u : 2u);
+    }
+
+    std::remove(path.c_str());
+}
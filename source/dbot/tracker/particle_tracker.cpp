@@ -21,6 +21,8 @@
  *
  */
 
+#include <algorithm>
+
 #include <dbot/tracker/particle_tracker.h>
 
 namespace dbot
@@ -33,7 +35,12 @@ ParticleTracker::ParticleTracker(
     bool center_object_frame)
     : Tracker(object_model, update_rate, center_object_frame),
       filter_(filter),
-      evaluation_count_(evaluation_count)
+      evaluation_count_(evaluation_count),
+      camera_matrix_(Eigen::Matrix3d::Identity()),
+      nr_rows_(0),
+      nr_cols_(0),
+      checkpoint_period_(0),
+      frames_since_checkpoint_(0)
 {
 }
 
@@ -43,12 +50,7 @@ auto ParticleTracker::on_initialize(
     filter_->set_particles(initial_states);
     filter_->resample(evaluation_count_ / filter_->sampling_blocks().size());
 
-    State delta_mean = filter_->belief().mean();
-
-    for (size_t i = 0; i < filter_->belief().size(); i++)
-    {
-        filter_->belief().location(i).subtract(delta_mean);
-    }
+    State delta_mean = filter_->recenter();
 
     auto& integrated_poses = filter_->sensor()->integrated_poses();
     integrated_poses.apply_delta(delta_mean);
@@ -58,14 +60,250 @@ auto ParticleTracker::on_initialize(
 
 auto ParticleTracker::on_track(const Obsrv& image) -> State
 {
+    if (preprocessor_)
+    {
+        // the preprocessor works on float images
+        float_image_.resize(image.size());
+        for (int i = 0; i < image.size(); i++) float_image_[i] = image(i);
+        return on_track(DepthImageView(float_image_.data(), image.size()));
+    }
+
     filter_->filter(image, zero_input());
 
-    State delta_mean = filter_->belief().mean();
+    State state = integrate_delta_mean();
+    adapt_sample_count();
+    write_checkpoint();
+    return state;
+}
 
-    for (size_t i = 0; i < filter_->belief().size(); i++)
+auto ParticleTracker::on_track(const DepthImageView& image) -> State
+{
+    if (preprocessor_)
     {
-        filter_->belief().location(i).subtract(delta_mean);
+        // downsampled to the working resolution
+        preprocessor_->process(image, nr_rows_, nr_cols_, working_frame_);
+        return filter(working_frame_.view(), &working_frame_.valid_pixels);
     }
+    return filter(image, nullptr);
+}
+
+auto ParticleTracker::on_track(const DepthPreprocessor::Frame& frame) -> State
+{
+    if (preprocessor_) return on_track(frame.view());
+    return filter(frame.view(), &frame.valid_pixels);
+}
+
+void ParticleTracker::set_sample_count_adaptation(
+    const std::shared_ptr<SampleCountAdaptation>& adaptation)
+{
+    sample_count_adaptation_ = adaptation;
+}
+
+void ParticleTracker::set_time_budget(double seconds)
+{
+    filter_->set_time_budget(seconds);
+}
+
+void ParticleTracker::set_max_sample_count(int count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    apply_max_sample_count(count);
+}
+
+void ParticleTracker::set_max_block_count(int count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    apply_max_block_count(count);
+}
+
+void ParticleTracker::set_camera(const Eigen::Matrix3d& camera_matrix,
+                                 int nr_rows,
+                                 int nr_cols)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    camera_matrix_ = camera_matrix;
+    nr_rows_ = nr_rows;
+    nr_cols_ = nr_cols;
+}
+
+bool ParticleTracker::set_downsampling(int factor)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return apply_downsampling(factor);
+}
+
+int ParticleTracker::downsampling() const
+{
+    return preprocessor_ ? preprocessor_->parameters().factor : 1;
+}
+
+void ParticleTracker::set_quality(const QualityLevel& level)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (level.sample_count > 0) apply_max_sample_count(level.sample_count);
+    apply_max_block_count(level.sampling_blocks);
+    apply_downsampling(level.downsampling);
+}
+
+void ParticleTracker::set_checkpoint(const std::string& path, int period)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    checkpoint_writer_.reset();
+    if (!path.empty())
+    {
+        checkpoint_writer_.reset(new CheckpointWriter(path));
+    }
+    checkpoint_period_ = std::max(period, 1);
+    frames_since_checkpoint_ = 0;
+}
+
+void ParticleTracker::save_checkpoint(ParticleCheckpoint& checkpoint)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    copy_checkpoint(checkpoint);
+}
+
+bool ParticleTracker::resume(const std::string& path)
+{
+    ParticleCheckpoint checkpoint;
+    if (!ParticleCheckpoint::read(path, checkpoint)) return false;
+    return resume(checkpoint);
+}
+
+bool ParticleTracker::resume(const ParticleCheckpoint& checkpoint)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (checkpoint.particles.empty() ||
+        checkpoint.integrated_poses.count() != object_model_->count_parts())
+    {
+        return false;
+    }
+
+    Filter::RealArray log_weights(checkpoint.log_weights.size());
+    for (size_t i = 0; i < checkpoint.log_weights.size(); i++)
+    {
+        log_weights[i] = checkpoint.log_weights[i];
+    }
+    filter_->load(checkpoint.particles, log_weights, checkpoint.occlusions);
+
+    auto& integrated_poses = filter_->sensor()->integrated_poses();
+    integrated_poses = checkpoint.integrated_poses;
+    moving_average_ = to_model_coordinate_system(integrated_poses);
+    frames_since_checkpoint_ = 0;
+
+    return true;
+}
+
+void ParticleTracker::write_checkpoint()
+{
+    if (!checkpoint_writer_) return;
+    if (++frames_since_checkpoint_ < checkpoint_period_) return;
+
+    // a busy writer is retried on the next frame
+    if (checkpoint_writer_->busy()) return;
+
+    copy_checkpoint(checkpoint_);
+    if (checkpoint_writer_->submit(checkpoint_)) frames_since_checkpoint_ = 0;
+}
+
+void ParticleTracker::copy_checkpoint(ParticleCheckpoint& checkpoint)
+{
+    Filter::RealArray log_weights;
+    filter_->save(checkpoint.particles, log_weights, checkpoint.occlusions);
+
+    checkpoint.log_weights.resize(log_weights.size());
+    for (int i = 0; i < log_weights.size(); i++)
+    {
+        checkpoint.log_weights[i] = log_weights[i];
+    }
+    checkpoint.integrated_poses = filter_->sensor()->integrated_poses();
+}
+
+void ParticleTracker::adapt_sample_count()
+{
+    if (!sample_count_adaptation_) return;
+    if (filter_->sensor()->has_device_weights()) return;
+
+    // the particles are deltas from the integrated poses at this point,
+    // the bins measure their spread around the estimate
+    const int sample_count =
+        sample_count_adaptation_->sample_count(filter_->belief());
+    if (sample_count != filter_->belief().size())
+    {
+        filter_->resample(sample_count);
+    }
+}
+
+void ParticleTracker::apply_max_sample_count(int count)
+{
+    if (sample_count_adaptation_)
+    {
+        sample_count_adaptation_->set_max_sample_count(count);
+    }
+    else if (count != filter_->belief().size() &&
+             !filter_->sensor()->has_device_weights())
+    {
+        filter_->resample(count);
+    }
+}
+
+void ParticleTracker::apply_max_block_count(int count)
+{
+    filter_->set_max_block_count(count);
+}
+
+bool ParticleTracker::apply_downsampling(int factor)
+{
+    factor = std::max(factor, 1);
+    if (factor == downsampling()) return true;
+    if (nr_rows_ <= 0 || nr_cols_ <= 0) return false;
+
+    DepthPreprocessor::Parameters parameters;
+    parameters.factor = factor;
+    std::unique_ptr<DepthPreprocessor> preprocessor(
+        new DepthPreprocessor(parameters));
+    if (!filter_->sensor()->set_resolution(
+            nr_rows_ / factor,
+            nr_cols_ / factor,
+            preprocessor->camera_matrix(camera_matrix_)))
+    {
+        return false;
+    }
+
+    if (factor > 1)
+    {
+        preprocessor_ = std::move(preprocessor);
+    }
+    else
+    {
+        preprocessor_.reset();
+    }
+    return true;
+}
+
+auto ParticleTracker::filter(const DepthImageView& image,
+                             const std::vector<int>* valid_pixels) -> State
+{
+    if (valid_pixels)
+    {
+        filter_->filter(image, *valid_pixels, zero_input());
+    }
+    else
+    {
+        filter_->filter(image, zero_input());
+    }
+
+    State state = integrate_delta_mean();
+    adapt_sample_count();
+    write_checkpoint();
+    return state;
+}
+
+auto ParticleTracker::integrate_delta_mean() -> State
+{
+    State delta_mean = filter_->recenter();
 
     auto& integrated_poses = filter_->sensor()->integrated_poses();
     integrated_poses.apply_delta(delta_mean);
@@ -30,9 +30,17 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <fl/model/transition/interface/transition_function.hpp>
 
+#include <dbot/depth_preprocessor.h>
+#include <dbot/tracker/particle_checkpoint.h>
+#include <dbot/tracker/quality_controller.h>
 #include <dbot/tracker/tracker.h>
+#include <dbot/filter/kld_sampling.h>
 #include <dbot/filter/rao_blackwell_coordinate_particle_filter.h>
 
 namespace dbot
@@ -47,6 +55,7 @@ public:
     typedef RbSensor<State> Sensor;
 
     typedef RaoBlackwellCoordinateParticleFilter<Transition, Sensor> Filter;
+    typedef KldSampling<State> SampleCountAdaptation;
 
 public:
     /**
@@ -79,6 +88,18 @@ public:
      */
     State on_track(const Obsrv& image);
 
+    /**
+     * \brief perform a single filter step without converting the float
+     *        image to double precision
+     */
+    State on_track(const DepthImageView& image);
+
+    /**
+     * \brief perform a single filter step on a preprocessed frame, the
+     *        sensor only visits its valid pixels
+     */
+    State on_track(const DepthPreprocessor::Frame& frame);
+
     /**
      * \brief Initializes the particle filter with the given initial states and
      *    the number of evaluations
@@ -87,8 +108,143 @@ public:
      */
     State on_initialize(const std::vector<State>& initial_states);
 
+    /**
+     * \brief Adapts the number of particles after every frame to the spread
+     *        of the belief within the bounds of the adaptation, instead of
+     *        keeping evaluation_count / sampling blocks particles. Passing
+     *        nullptr restores the fixed count. The maximum must not exceed
+     *        the number of poses the sensor has been created for.
+     *
+     * The adaptation is skipped while the sensor keeps the weights on the
+     * device, since those are tied to the order of the particles there.
+     */
+    void set_sample_count_adaptation(
+        const std::shared_ptr<SampleCountAdaptation>& adaptation);
+
+    /**
+     * \brief Sets the time in seconds the filter step of a frame should take
+     *        at most, zero disables the budget. Blocks which do not fit into
+     *        the budget are sampled jointly, see
+     *        RaoBlackwellCoordinateParticleFilter::set_time_budget().
+     */
+    void set_time_budget(double seconds);
+
+    /**
+     * \brief Current number of particles
+     */
+    int sample_count() { return filter_->belief().size(); }
+
+    /**
+     * \brief Limits the number of particles. With an adaptation this is its
+     *        maximum, otherwise the particles are resampled to the count. It
+     *        must not exceed the number of poses the sensor has been created
+     *        for.
+     */
+    void set_max_sample_count(int count);
+
+    /**
+     * \brief Limits the number of sampling blocks evaluated one by one, see
+     *        RaoBlackwellCoordinateParticleFilter::set_max_block_count()
+     */
+    void set_max_block_count(int count);
+
+    /**
+     * \brief Camera matrix and resolution of the frames passed to track(),
+     *        which set_downsampling() reduces
+     */
+    void set_camera(const Eigen::Matrix3d& camera_matrix,
+                    int nr_rows,
+                    int nr_cols);
+
+    /**
+     * \brief Downsamples the frames by the factor before they are tracked,
+     *        if the sensor can switch its resolution, see
+     *        RbSensor::set_resolution(). Resets the occlusions. Returns false
+     *        and keeps the resolution if the sensor cannot switch or the
+     *        camera has not been set.
+     */
+    bool set_downsampling(int factor);
+
+    int downsampling() const;
+
+    /**
+     * \brief Applies a level chosen by a QualityController, e.g. as its
+     *        callback
+     */
+    void set_quality(const QualityLevel& level);
+
+    /**
+     * \brief Writes a checkpoint of the belief to path every period frames.
+     *        The belief is copied on the tracking thread, the file is written
+     *        on a background thread. An empty path disables checkpoints.
+     */
+    void set_checkpoint(const std::string& path, int period);
+
+    /**
+     * \brief Copies the particles, their weights, the occlusions of the
+     *        sensor and the integrated poses into checkpoint
+     */
+    void save_checkpoint(ParticleCheckpoint& checkpoint);
+
+    /**
+     * \brief Resumes tracking from a checkpoint instead of initialize(),
+     *        e.g. after a restart of the process. Returns false and keeps the
+     *        belief if the checkpoint cannot be read or belongs to an object
+     *        with a different number of parts. Occlusions which do not fit
+     *        the sensor start over.
+     */
+    bool resume(const std::string& path);
+
+    bool resume(const ParticleCheckpoint& checkpoint);
+
+private:
+    /**
+     * \brief Moves the mean of the particle deltas into the integrated
+     *        poses of the sensor and returns them
+     */
+    State integrate_delta_mean();
+
+    /**
+     * \brief Resamples the particles to the count given by the adaptation
+     */
+    void adapt_sample_count();
+
+    /**
+     * \brief Filters the image and its valid pixels, all pixels are visited
+     *        if valid_pixels is null
+     */
+    State filter(const DepthImageView& image,
+                 const std::vector<int>* valid_pixels);
+
+    void apply_max_sample_count(int count);
+    void apply_max_block_count(int count);
+    bool apply_downsampling(int factor);
+
+    /**
+     * \brief Hands a checkpoint to the writer once the period has passed
+     *        and the writer is idle. Requires mutex_.
+     */
+    void write_checkpoint();
+
+    void copy_checkpoint(ParticleCheckpoint& checkpoint);
+
 private:
     std::shared_ptr<Filter> filter_;
     int evaluation_count_;
+    std::shared_ptr<SampleCountAdaptation> sample_count_adaptation_;
+
+    // resolution of the frames passed to track() and the downsampling of
+    // them to the working resolution of the sensor
+    Eigen::Matrix3d camera_matrix_;
+    int nr_rows_;
+    int nr_cols_;
+    std::unique_ptr<DepthPreprocessor> preprocessor_;
+    DepthPreprocessor::Frame working_frame_;
+    std::vector<float> float_image_;
+
+    std::unique_ptr<CheckpointWriter> checkpoint_writer_;
+    ParticleCheckpoint checkpoint_;
+    int checkpoint_period_;
+    int frames_since_checkpoint_;
 };
 }
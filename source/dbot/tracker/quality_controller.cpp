@@ -0,0 +1,242 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file quality_controller.cpp
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <dbot/tracker/quality_controller.h>
+
+namespace dbot
+{
+QualityController::QualityController(const std::vector<QualityLevel>& levels,
+                                     const Parameters& parameters)
+    : levels_(levels), parameters_(parameters)
+{
+    if (levels_.empty())
+    {
+        std::cout << "ERROR: QualityController needs at least one level."
+                  << std::endl;
+        exit(-1);
+    }
+}
+
+int QualityController::add_tracker(const std::string& name,
+                                   const Apply& apply)
+{
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Entry entry;
+        entry.name = name;
+        entry.apply = apply;
+        entry.level = 0;
+        entry.applied_level = 0;
+        entry.frame_time = 0;
+        entry.frames_since_change = 0;
+        entry.change_count = 0;
+        entries_.push_back(entry);
+        index = int(entries_.size()) - 1;
+    }
+
+    if (apply) apply(levels_[0]);
+    return index;
+}
+
+void QualityController::record(int tracker, double frame_time)
+{
+    Apply apply;
+    QualityLevel level;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = entries_[tracker];
+
+        // the average starts over at every level
+        entry.frames_since_change++;
+        entry.frame_time =
+            entry.frames_since_change == 1
+                ? frame_time
+                : entry.frame_time +
+                      parameters_.smoothing * (frame_time - entry.frame_time);
+
+        if (settled(entry))
+        {
+            const int cheapest = int(levels_.size()) - 1;
+            double total = 0;
+            for (const Entry& e : entries_) total += e.frame_time;
+            const bool node_fits =
+                parameters_.node_frame_time <= 0 ||
+                total < parameters_.upgrade_ratio * parameters_.node_frame_time;
+
+            if (entry.frame_time > parameters_.target_frame_time &&
+                entry.level < cheapest)
+            {
+                change(entry, entry.level + 1);
+            }
+            else if (entry.frame_time <
+                         parameters_.upgrade_ratio *
+                             parameters_.target_frame_time &&
+                     entry.level > 0 && node_fits)
+            {
+                change(entry, entry.level - 1);
+            }
+        }
+        balance();
+
+        // a level chosen for this tracker takes effect with its next frame
+        if (entry.level != entry.applied_level)
+        {
+            entry.applied_level = entry.level;
+            entry.frames_since_change = 0;
+            apply = entry.apply;
+            level = levels_[entry.level];
+        }
+    }
+
+    if (apply) apply(level);
+}
+
+int QualityController::level(int tracker) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[tracker].level;
+}
+
+double QualityController::frame_time(int tracker) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[tracker].frame_time;
+}
+
+int QualityController::change_count(int tracker) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_[tracker].change_count;
+}
+
+void QualityController::change(Entry& entry, int level)
+{
+    entry.level = level;
+    entry.change_count++;
+}
+
+bool QualityController::settled(const Entry& entry) const
+{
+    return entry.level == entry.applied_level &&
+           entry.frames_since_change >= parameters_.hold_frames;
+}
+
+void QualityController::balance()
+{
+    if (parameters_.node_frame_time <= 0) return;
+
+    double total = 0;
+    for (const Entry& entry : entries_) total += entry.frame_time;
+    if (total <= parameters_.node_frame_time) return;
+
+    // the most expensive tracker gives up quality first, once its frame
+    // time has settled
+    Entry* expensive = NULL;
+    for (Entry& entry : entries_)
+    {
+        if (entry.level + 1 >= int(levels_.size())) continue;
+        if (!expensive || entry.frame_time > expensive->frame_time)
+        {
+            expensive = &entry;
+        }
+    }
+    if (expensive && settled(*expensive))
+    {
+        change(*expensive, expensive->level + 1);
+    }
+}
+
+std::string QualityController::to_json() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\"trackers\":{";
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        const Entry& entry = entries_[i];
+        const QualityLevel& level = levels_[entry.level];
+        json << (i > 0 ? "," : "") << "\"" << entry.name
+             << "\":{\"level\":" << entry.level
+             << ",\"sample_count\":" << level.sample_count
+             << ",\"downsampling\":" << level.downsampling
+             << ",\"sampling_blocks\":" << level.sampling_blocks
+             << ",\"frame_time\":" << entry.frame_time
+             << ",\"changes\":" << entry.change_count << "}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+std::string QualityController::to_prometheus() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    struct Metric
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+    };
+    const Metric metrics[] = {
+        {"dbot_quality_level", "gauge", "Quality level of the tracker."},
+        {"dbot_quality_sample_count",
+         "gauge",
+         "Number of particles of the quality level."},
+        {"dbot_quality_downsampling",
+         "gauge",
+         "Downsampling factor of the quality level."},
+        {"dbot_quality_sampling_blocks",
+         "gauge",
+         "Sampling blocks of the quality level, 0 for all."},
+        {"dbot_quality_frame_time_seconds",
+         "gauge",
+         "Smoothed frame time of the tracker."},
+        {"dbot_quality_changes_total",
+         "counter",
+         "Number of quality level changes of the tracker."}};
+
+    std::ostringstream text;
+    text.precision(9);
+    for (int m = 0; m < 6; m++)
+    {
+        text << "# HELP " << metrics[m].name << " " << metrics[m].help << "\n"
+             << "# TYPE " << metrics[m].name << " " << metrics[m].type
+             << "\n";
+        for (const Entry& entry : entries_)
+        {
+            const QualityLevel& level = levels_[entry.level];
+            const double values[] = {double(entry.level),
+                                     double(level.sample_count),
+                                     double(level.downsampling),
+                                     double(level.sampling_blocks),
+                                     entry.frame_time,
+                                     double(entry.change_count)};
+            text << metrics[m].name << "{tracker=\"" << entry.name << "\"} "
+                 << values[m] << "\n";
+        }
+    }
+    return text.str();
+}
+}
@@ -0,0 +1,175 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file quality_controller.h
+ */
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dbot
+{
+/**
+ * \brief Settings of a tracker which trade accuracy for frame time
+ */
+struct QualityLevel
+{
+    QualityLevel(int sample_count = 0, int downsampling = 1, int blocks = 0)
+        : sample_count(sample_count),
+          downsampling(downsampling),
+          sampling_blocks(blocks)
+    {
+    }
+
+    /** number of particles, or their maximum with an adaptive count, zero
+     *  keeps the count of the tracker */
+    int sample_count;
+
+    /** factor by which the frames are downsampled before tracking */
+    int downsampling;
+
+    /** number of sampling blocks evaluated one by one at most, the remaining
+     *  ones are sampled jointly. Zero evaluates all. */
+    int sampling_blocks;
+};
+
+/**
+ * \brief Holds the frame time of several trackers at a target by moving them
+ *        up and down a ladder of quality levels.
+ *
+ * Every tracker reports the duration of its frames through record(). A
+ * tracker whose smoothed frame time exceeds the target moves to the next
+ * cheaper level, one which stays well below it moves back to the previous
+ * better level. With a node budget the sum of the frame times of all
+ * trackers is held below it as well, by degrading the most expensive tracker
+ * which can still be degraded, once its frame time has settled. After a
+ * change a tracker keeps its level for hold_frames frames, while its frame
+ * time settles at the new level.
+ *
+ * The level of a tracker is applied by its callback on the thread which
+ * records its frames, between two of its frames, so the callback never runs
+ * concurrently with the tracking of that tracker. The chosen levels and the
+ * frame times are reported by to_json() and to_prometheus().
+ */
+class QualityController
+{
+public:
+    typedef std::function<void(const QualityLevel&)> Apply;
+
+    struct Parameters
+    {
+        Parameters()
+            : target_frame_time(1. / 30.),
+              node_frame_time(0),
+              upgrade_ratio(0.6),
+              smoothing(0.2),
+              hold_frames(15)
+        {
+        }
+
+        /** frame time in seconds every tracker should stay below */
+        double target_frame_time;
+
+        /** sum of the frame times of all trackers in seconds which should
+         *  not be exceeded, zero if the trackers do not share resources */
+        double node_frame_time;
+
+        /** a better level is chosen below this fraction of the target */
+        double upgrade_ratio;
+
+        /** weight of a new frame time in the moving average */
+        double smoothing;
+
+        /** frames without a change after a change */
+        int hold_frames;
+    };
+
+public:
+    /**
+     * \param levels  from the best to the cheapest, trackers start with the
+     *                first one
+     */
+    explicit QualityController(const std::vector<QualityLevel>& levels,
+                               const Parameters& parameters = Parameters());
+
+    const Parameters& parameters() const { return parameters_; }
+    const std::vector<QualityLevel>& levels() const { return levels_; }
+
+    /**
+     * \brief Adds a tracker at the best level which is applied right away,
+     *        returns its index for record()
+     */
+    int add_tracker(const std::string& name, const Apply& apply);
+
+    /**
+     * \brief Records the duration of a frame of the tracker in seconds and
+     *        applies a new level of it if one has been chosen. To be called
+     *        after every frame on the thread tracking it.
+     */
+    void record(int tracker, double frame_time);
+
+    /** \brief Index of the current level of the tracker */
+    int level(int tracker) const;
+
+    /** \brief Smoothed frame time of the tracker in seconds */
+    double frame_time(int tracker) const;
+
+    /** \brief Number of level changes of the tracker */
+    int change_count(int tracker) const;
+
+    /**
+     * \brief Level, settings, smoothed frame time and number of changes of
+     *        every tracker as a JSON object
+     */
+    std::string to_json() const;
+
+    /**
+     * \brief The same as gauges in the Prometheus text format, labelled by
+     *        tracker
+     */
+    std::string to_prometheus() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        Apply apply;
+        int level;
+        int applied_level;
+        double frame_time;
+        int frames_since_change;
+        int change_count;
+    };
+
+    /** \brief Moves the tracker to the level, requires mutex_ */
+    void change(Entry& entry, int level);
+
+    /** \brief Whether the tracker may change its level, requires mutex_ */
+    bool settled(const Entry& entry) const;
+
+    /** \brief Applies the node budget to all trackers, requires mutex_ */
+    void balance();
+
+private:
+    std::vector<QualityLevel> levels_;
+    Parameters parameters_;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+}
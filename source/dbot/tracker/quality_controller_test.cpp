@@ -0,0 +1,125 @@
+/*
+ * This is part of the Bayesian Object Tracking (bot),
+ * (https://github.com/bayesian-object-tracking)
+ *
+ * Copyright (c) 2015 Max Planck Society,
+ * 				 Autonomous Motion Department,
+ * 			     Institute for Intelligent Systems
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License License (GNU GPL). A copy of the license can be found in the LICENSE
+ * file distributed with this source code.
+ */
+
+/**
+ * \file quality_controller_test.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <dbot/tracker/quality_controller.h>
+
+namespace
+{
+std::vector<dbot::QualityLevel> ladder()
+{
+    return {dbot::QualityLevel(400, 1, 0),
+            dbot::QualityLevel(200, 1, 0),
+            dbot::QualityLevel(200, 2, 1)};
+}
+
+dbot::QualityController::Parameters parameters()
+{
+    dbot::QualityController::Parameters parameters;
+    parameters.target_frame_time = 0.030;
+    parameters.upgrade_ratio = 0.5;
+    parameters.smoothing = 1;
+    parameters.hold_frames = 2;
+    return parameters;
+}
+}
+
+TEST(QualityControllerTests, degrades_under_load_and_recovers)
+{
+    dbot::QualityController controller(ladder(), parameters());
+
+    std::vector<int> applied;
+    const int tracker = controller.add_tracker(
+        "duck", [&](const dbot::QualityLevel& level) {
+            applied.push_back(level.sample_count);
+        });
+    EXPECT_EQ(applied, std::vector<int>({400}));
+
+    // the first slow frame is within the hold time
+    controller.record(tracker, 0.040);
+    EXPECT_EQ(controller.level(tracker), 0);
+    controller.record(tracker, 0.040);
+    EXPECT_EQ(controller.level(tracker), 1);
+    EXPECT_EQ(applied, std::vector<int>({400, 200}));
+
+    // the held level is not left while its frame time settles
+    controller.record(tracker, 0.040);
+    EXPECT_EQ(controller.level(tracker), 1);
+    controller.record(tracker, 0.040);
+    EXPECT_EQ(controller.level(tracker), 2);
+
+    // the cheapest level is kept however slow the frames are
+    for (int i = 0; i < 4; i++) controller.record(tracker, 0.100);
+    EXPECT_EQ(controller.level(tracker), 2);
+
+    // between the thresholds nothing changes, far below the target the
+    // better level comes back
+    for (int i = 0; i < 4; i++) controller.record(tracker, 0.020);
+    EXPECT_EQ(controller.level(tracker), 2);
+    controller.record(tracker, 0.010);
+    controller.record(tracker, 0.010);
+    EXPECT_EQ(controller.level(tracker), 1);
+    EXPECT_EQ(controller.change_count(tracker), 3);
+    EXPECT_EQ(applied.size(), 4u);
+}
+
+TEST(QualityControllerTests, node_budget_degrades_the_most_expensive_tracker)
+{
+    dbot::QualityController::Parameters node = parameters();
+    node.node_frame_time = 0.040;
+    dbot::QualityController controller(ladder(), node);
+
+    int cheap_applied = 0;
+    const int cheap = controller.add_tracker(
+        "cheap", [&](const dbot::QualityLevel&) { cheap_applied++; });
+    const int expensive = controller.add_tracker("expensive", nullptr);
+
+    // both trackers meet the target, together they exceed the node budget
+    for (int i = 0; i < 2; i++)
+    {
+        controller.record(cheap, 0.015);
+        controller.record(expensive, 0.028);
+    }
+    EXPECT_EQ(controller.level(cheap), 0);
+    EXPECT_EQ(controller.level(expensive), 1);
+    EXPECT_EQ(cheap_applied, 1);
+}
+
+TEST(QualityControllerTests, reports_the_chosen_levels)
+{
+    dbot::QualityController controller(ladder(), parameters());
+    const int tracker = controller.add_tracker("duck", nullptr);
+    controller.record(tracker, 0.040);
+    controller.record(tracker, 0.040);
+
+    const std::string text = controller.to_prometheus();
+    EXPECT_NE(text.find("# TYPE dbot_quality_level gauge"), std::string::npos);
+    EXPECT_NE(text.find("dbot_quality_level{tracker=\"duck\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("dbot_quality_sample_count{tracker=\"duck\"} 200\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("dbot_quality_changes_total{tracker=\"duck\"} 1\n"),
+              std::string::npos);
+
+    const std::string json = controller.to_json();
+    EXPECT_NE(json.find("\"duck\":{\"level\":1,\"sample_count\":200"),
+              std::string::npos);
+}
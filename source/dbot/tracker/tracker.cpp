@@ -11,18 +11,40 @@
  * file distributed with this source code.
  */
 
+#include <cstdlib>
+#include <iostream>
+
 #include <fl/util/profiling.hpp>
+#include <dbot/profiler.h>
 #include <dbot/tracker/tracker.h>
 
 namespace dbot
 {
+namespace
+{
+/**
+ * \brief Number of parts of the object, checked against the fixed size of
+ *        the states before any state of the tracker is created
+ */
+int checked_part_count(const std::shared_ptr<ObjectModel>& object_model)
+{
+    const int part_count = object_model->count_parts();
+    if (Tracker::BodyCount != Eigen::Dynamic &&
+        part_count != Tracker::BodyCount)
+    {
+        throw WrongPartCountException(Tracker::BodyCount, part_count);
+    }
+    return part_count;
+}
+}
+
 Tracker::Tracker(const std::shared_ptr<ObjectModel> &object_model,
                              double update_rate,
                              bool center_object_frame)
     : object_model_(object_model),
       update_rate_(update_rate),
       center_object_frame_(center_object_frame),
-      moving_average_(object_model_->count_parts())
+      moving_average_(checked_part_count(object_model_))
 {
 }
 
@@ -71,6 +93,19 @@ void Tracker::move_average(const Tracker::State& new_state,
 auto Tracker::track(const Obsrv& image) -> State
 {
     std::lock_guard<std::mutex> lock(mutex_);
+    ProfileScope frame(ProfileStage::Frame);
+
+    move_average(to_model_coordinate_system(on_track(image)),
+                 moving_average_,
+                 update_rate_);
+
+    return moving_average_;
+}
+
+auto Tracker::track(const DepthImageView& image) -> State
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProfileScope frame(ProfileStage::Frame);
 
     move_average(to_model_coordinate_system(on_track(image)),
                  moving_average_,
@@ -79,6 +114,28 @@ auto Tracker::track(const Obsrv& image) -> State
     return moving_average_;
 }
 
+auto Tracker::track(const DepthPreprocessor::Frame& frame) -> State
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProfileScope profile(ProfileStage::Frame);
+
+    move_average(to_model_coordinate_system(on_track(frame)),
+                 moving_average_,
+                 update_rate_);
+
+    return moving_average_;
+}
+
+auto Tracker::on_track(const DepthImageView& image) -> State
+{
+    return on_track(Obsrv(image.cast<fl::Real>()));
+}
+
+auto Tracker::on_track(const DepthPreprocessor::Frame& frame) -> State
+{
+    return on_track(frame.view());
+}
+
 auto Tracker::to_center_coordinate_system(
     const Tracker::State& state) -> State
 {
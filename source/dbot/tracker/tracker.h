@@ -20,9 +20,12 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <dbot/depth_image_view.h>
+#include <dbot/depth_preprocessor.h>
 #include <dbot/object_model.h>
 #include <dbot/pose/free_floating_rigid_bodies_state.h>
 #include <dbot/pose/pose_vector.h>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -30,17 +33,57 @@
 
 namespace dbot
 {
+/**
+ * \brief Thrown if a tracker of fixed size states is created for an object
+ *        of another number of parts, see DBOT_FIXED_SIZE_STATE
+ */
+class WrongPartCountException : public std::exception
+{
+public:
+    WrongPartCountException(int body_count, int part_count)
+        : message_("The tracker is built with fixed size states of " +
+                   std::to_string(body_count) + " part, the object has " +
+                   std::to_string(part_count) + ".")
+    {
+    }
+
+    const char* what() const noexcept { return message_.c_str(); }
+
+private:
+    std::string message_;
+};
+
 /**
  * \brief Abstract ObjectTracker context
  */
 class Tracker
 {
 public:
-    typedef dbot::FreeFloatingRigidBodiesState<> State;
+#ifdef DBOT_FIXED_SIZE_STATE
+    /** a single rigid body, the states and noises have a fixed size */
+    enum
+    {
+        BodyCount = 1
+    };
+#else
+    enum
+    {
+        BodyCount = Eigen::Dynamic
+    };
+#endif
+
+    typedef dbot::FreeFloatingRigidBodiesState<BodyCount> State;
     typedef Eigen::Matrix<fl::Real, Eigen::Dynamic, 1> Obsrv;
-    typedef Eigen::Matrix<fl::Real, Eigen::Dynamic, 1> Noise;
+    typedef Eigen::Matrix<fl::Real,
+                          BodyCount == Eigen::Dynamic
+                              ? Eigen::Dynamic
+                              : BodyCount * State::POSE_SIZE,
+                          1>
+        Noise;
     typedef Eigen::Matrix<fl::Real, Eigen::Dynamic, 1> Input;
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
 public:
     /**
      * \brief Creates the tracker
@@ -51,6 +94,9 @@ public:
      *     Object model instance
      * \param update_rate
      *     Moving average update rate
+     *
+     * \throws WrongPartCountException if the states have a fixed size and
+     *         the object another number of parts
      */
     Tracker(const std::shared_ptr<ObjectModel>& object_model,
             double update_rate,
@@ -63,6 +109,20 @@ public:
      */
     virtual State on_track(const Obsrv& image) = 0;
 
+    /**
+     * \brief Hook function which is called when tracking on a float depth
+     *        image. The default implementation converts the image to Obsrv.
+     */
+    virtual State on_track(const DepthImageView& image);
+
+    /**
+     * \brief Hook function which is called when tracking on a preprocessed
+     *        frame, whose valid pixels the tracker may use instead of
+     *        testing every pixel. The default implementation tracks on the
+     *        depth of the frame.
+     */
+    virtual State on_track(const DepthPreprocessor::Frame& frame);
+
     /**
      * \brief Hook function which is called during initialization
      * \return Initial belief state
@@ -77,6 +137,18 @@ public:
      */
     virtual State track(const Obsrv& image);
 
+    /**
+     * \brief perform a single filter step on a float depth image, e.g. a
+     *        view of the camera driver buffer
+     */
+    virtual State track(const DepthImageView& image);
+
+    /**
+     * \brief perform a single filter step on a preprocessed frame, see
+     *        CameraData::depth_frame()
+     */
+    virtual State track(const DepthPreprocessor::Frame& frame);
+
     /**
      * \brief Initializes the particle filter with the given initial states and
      *     the number of evaluations
@@ -123,6 +195,14 @@ public:
      */
     Input zero_input() const;
 
+    /**
+     * \brief Object model the tracker renders
+     */
+    const std::shared_ptr<ObjectModel>& object_model() const
+    {
+        return object_model_;
+    }
+
 protected:
     std::shared_ptr<ObjectModel> object_model_;
     State moving_average_;
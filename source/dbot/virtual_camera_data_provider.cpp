@@ -26,7 +26,8 @@ VirtualCameraDataProvider::VirtualCameraDataProvider(
     int downsampling_factor,
     const std::string& frame_id)
     : downsampling_factor_(downsampling_factor),
-      frame_id_(frame_id)
+      frame_id_(frame_id),
+      frame_number_(1)
 {
     native_resolution_.width = 640;
     native_resolution_.height = 480;
@@ -78,4 +79,11 @@ CameraData::Resolution VirtualCameraDataProvider::native_resolution() const
 {
     return native_resolution_;
 }
+
+void VirtualCameraDataProvider::set_depth_image(
+    const Eigen::MatrixXd& depth_image)
+{
+    depth_image_ = depth_image;
+    frame_number_++;
+}
 }
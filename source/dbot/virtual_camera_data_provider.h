@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <Eigen/Dense>
 
@@ -71,11 +72,24 @@ public:
      */
     virtual CameraData::Resolution native_resolution() const;
 
+    /**
+     * \brief Counts the images set by set_depth_image()
+     */
+    virtual std::uint64_t frame_number() const { return frame_number_; }
+
+    /**
+     * \brief Sets the image returned by the depth image accessors, e.g. a
+     *        rendering of a synthetic scene. It is expected to have the
+     *        native resolution divided by the downsampling factor.
+     */
+    void set_depth_image(const Eigen::MatrixXd& depth_image);
+
 protected:
     int downsampling_factor_;
     std::string frame_id_;
     Eigen::Matrix3d camera_matrix_;
     CameraData::Resolution native_resolution_;
     Eigen::MatrixXd depth_image_;
+    std::uint64_t frame_number_;
 };
 }
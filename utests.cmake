@@ -13,3 +13,207 @@ dbot_add_test(
     NAME    file_shader_provider_test
     SOURCES source/dbot/file_shader_provider_test.cpp
     LIBS	  ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    thread_pool
+    SOURCES source/dbot/thread_pool_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    profiler
+    SOURCES source/dbot/profiler_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    trace_recorder
+    SOURCES source/dbot/trace_recorder_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    rigid_body_renderer
+    SOURCES source/dbot/rigid_body_renderer_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    kinect_pixel_model
+    SOURCES source/dbot/model/kinect_pixel_model_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    occlusion_arena
+    SOURCES source/dbot/model/occlusion_arena_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    occlusion_model
+    SOURCES source/dbot/model/occlusion_model_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    rao_blackwell_coordinate_particle_filter
+    SOURCES source/dbot/filter/rao_blackwell_coordinate_particle_filter_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    resampling
+    SOURCES source/dbot/filter/resampling_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    batch_gaussian
+    SOURCES source/dbot/filter/batch_gaussian_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    sigma_point_render_table
+    SOURCES source/dbot/model/sigma_point_render_table_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    pose_hashing
+    SOURCES source/dbot/pose/pose_hashing_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    pose_composition
+    SOURCES source/dbot/pose/pose_composition_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    pose_cache
+    SOURCES source/dbot/pose/pose_cache_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    parallel_information_update
+    SOURCES source/dbot/filter/parallel_information_update_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    gaussian_image_model
+    SOURCES source/dbot/model/gaussian_image_model_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    depth_preprocessor
+    SOURCES source/dbot/depth_preprocessor_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    pixel_selection
+    SOURCES source/dbot/pixel_selection_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    async_tracker
+    SOURCES source/dbot/tracker/async_tracker_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    particle_checkpoint
+    SOURCES source/dbot/tracker/particle_checkpoint_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    quality_controller
+    SOURCES source/dbot/tracker/quality_controller_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    offline_batch_tracker
+    SOURCES source/dbot/tracker/offline_batch_tracker_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    multi_object_tracker
+    SOURCES source/dbot/tracker/multi_object_tracker_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+if(DBOT_FIXED_SIZE_STATE)
+    dbot_add_test(
+        NAME    fixed_size_state
+        SOURCES source/dbot/tracker/fixed_size_state_test.cpp
+        LIBS    ${dbot_LIBRARIES})
+endif(DBOT_FIXED_SIZE_STATE)
+
+dbot_add_test(
+    NAME    kld_sampling
+    SOURCES source/dbot/filter/kld_sampling_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    pixel_likelihood_table
+    SOURCES source/dbot/gpu/pixel_likelihood_table_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    launch_configuration_cache
+    SOURCES source/dbot/gpu/launch_configuration_cache_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    program_binary_cache
+    SOURCES source/dbot/gpu/program_binary_cache_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    particle_sharding
+    SOURCES source/dbot/gpu/particle_sharding_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    occlusion_tile_map
+    SOURCES source/dbot/gpu/occlusion_tile_map_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    coarse_to_fine_selection
+    SOURCES source/dbot/gpu/coarse_to_fine_selection_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    sigma_point_moments
+    SOURCES source/dbot/gpu/sigma_point_moments_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    mesh_cache
+    SOURCES source/dbot/mesh_cache_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    flat_mesh
+    SOURCES source/dbot/flat_mesh_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    mesh_levels
+    SOURCES source/dbot/mesh_levels_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    depth_stream
+    SOURCES source/dbot/depth_stream_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    depth_decoding
+    SOURCES source/dbot/depth_decoding_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    helper_functions
+    SOURCES source/dbot/helper_functions_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+dbot_add_test(
+    NAME    memory_planner
+    SOURCES source/dbot/memory_planner_test.cpp
+    LIBS    ${dbot_LIBRARIES})
+
+if(DBOT_BUILD_GPU)
+    dbot_add_test(
+        NAME    gl_context
+        SOURCES source/dbot/gpu/gl_context_test.cpp
+        LIBS    ${dbot_LIBRARIES})
+endif(DBOT_BUILD_GPU)